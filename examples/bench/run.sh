@@ -0,0 +1,96 @@
+#!/bin/bash
+# End-to-end benchmarks: every program here is timed in the evaluator
+# (eval: interpreting and staging), in C emission (emit), in the C
+# compiler (cc) and as the compiled binary (run). Times are medians of
+# BENCH_RUNS runs (default 5), in milliseconds. Each program's
+# `;; expect:` line must show up in the generated C or the binary's
+# output. Rows are printed and appended to BENCH_RESULTS (default
+# bench-results.tsv) so runs can be compared over time.
+#
+# Usage: examples/bench/run.sh [program ...]   (names without .purple)
+
+cd "$(dirname "$0")/../.." || exit 1
+
+PURPLE=./purple_c
+CC=${CC:-gcc}
+RUNS=${BENCH_RUNS:-5}
+RESULTS=${BENCH_RESULTS:-bench-results.tsv}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+if [ ! -x "$PURPLE" ]; then
+    echo "Build purple_c first (make)" >&2
+    exit 1
+fi
+
+now_ns() { date +%s%N; }
+
+median() { sort -n | awk '{ v[NR] = $1 } END { print (NR % 2) ? v[(NR + 1) / 2] : (v[NR / 2] + v[NR / 2 + 1]) / 2 }'; }
+
+if [ $# -gt 0 ]; then
+    programs=()
+    for name in "$@"; do programs+=("examples/bench/$name.purple"); done
+else
+    programs=(examples/bench/*.purple)
+fi
+
+[ -f "$RESULTS" ] || printf 'date\tcommit\tprogram\teval_ms\temit_ms\tcc_ms\trun_ms\tc_bytes\n' > "$RESULTS"
+stamp=$(date -u +%Y-%m-%dT%H:%M:%SZ)
+commit=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+
+printf '%-10s %10s %10s %10s %10s %10s\n' program eval_ms emit_ms cc_ms run_ms c_bytes
+FAIL=0
+for src in "${programs[@]}"; do
+    name=$(basename "$src" .purple)
+    if [ ! -f "$src" ]; then
+        echo "$name: no such program" >&2
+        FAIL=1
+        continue
+    fi
+    expected=$(sed -n 's/^;; expect: //p' "$src")
+
+    # eval and emit as --time reports them
+    : > "$WORK/eval" ; : > "$WORK/emit"
+    for _ in $(seq "$RUNS"); do
+        if ! "$PURPLE" --time --file "$src" > "$WORK/$name.c" 2> "$WORK/time"; then
+            echo "$name: compilation failed" >&2
+            FAIL=1
+            continue 2
+        fi
+        sed -n 's/^Time: eval \([0-9.]*\) ms, emit \([0-9.]*\) ms$/\1 \2/p' "$WORK/time" |
+            { read -r e m; echo "$e" >> "$WORK/eval"; echo "$m" >> "$WORK/emit"; }
+    done
+
+    : > "$WORK/cc"
+    for _ in $(seq "$RUNS"); do
+        start=$(now_ns)
+        if ! $CC -O2 -w -o "$WORK/$name" "$WORK/$name.c" -lpthread; then
+            echo "$name: generated C does not build" >&2
+            FAIL=1
+            continue 2
+        fi
+        echo $(( ($(now_ns) - start) / 1000 )) >> "$WORK/cc"
+    done
+
+    : > "$WORK/run"
+    for _ in $(seq "$RUNS"); do
+        start=$(now_ns)
+        "$WORK/$name" > "$WORK/out"
+        echo $(( ($(now_ns) - start) / 1000 )) >> "$WORK/run"
+    done
+
+    if [ -n "$expected" ] && ! cat "$WORK/$name.c" "$WORK/out" | grep -Fq "$expected"; then
+        echo "$name: expected \"$expected\"" >&2
+        FAIL=1
+    fi
+
+    eval_ms=$(median < "$WORK/eval")
+    emit_ms=$(median < "$WORK/emit")
+    cc_ms=$(median < "$WORK/cc" | awk '{ printf "%.3f", $1 / 1000 }')
+    run_ms=$(median < "$WORK/run" | awk '{ printf "%.3f", $1 / 1000 }')
+    bytes=$(wc -c < "$WORK/$name.c")
+    printf '%-10s %10s %10s %10s %10s %10s\n' "$name" "$eval_ms" "$emit_ms" "$cc_ms" "$run_ms" "$bytes"
+    printf '%s\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n' "$stamp" "$commit" "$name" "$eval_ms" "$emit_ms" "$cc_ms" "$run_ms" "$bytes" >> "$RESULTS"
+done
+
+exit $FAIL
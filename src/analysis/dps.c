@@ -2,6 +2,7 @@
 // Source: "Destination-passing style for efficient memory management" (FHPC 2017)
 
 #include "dps.h"
+#include "../util/emit.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,9 +20,9 @@ DPSInfo* analyze_dps(Value* expr) {
     if (!expr) return info;
 
     // Check for direct allocations (mk_int, mk_pair, cons)
-    if (expr->tag == T_CELL) {
+    if (val_tag(expr) == T_CELL) {
         Value* head = expr->cell.car;
-        if (head && head->tag == T_SYM) {
+        if (head && val_tag(head) == T_SYM) {
             if (strcmp(head->s, "lift") == 0 ||
                 strcmp(head->s, "cons") == 0) {
                 info->returns_fresh = 1;
@@ -36,7 +37,7 @@ DPSInfo* analyze_dps(Value* expr) {
 
 // Check if a lambda is a DPS candidate
 int is_dps_candidate(Value* lambda) {
-    if (!lambda || lambda->tag != T_LAMBDA) return 0;
+    if (!lambda || val_tag(lambda) != T_LAMBDA) return 0;
 
     // Analyze lambda body for fresh allocations in return position
     Value* body = lambda->lam.body;
@@ -56,130 +57,205 @@ DPSCandidate* find_dps_candidates(Value* program) {
     return NULL;
 }
 
-// Generate DPS runtime support
-void gen_dps_runtime(void) {
-    printf("\n// Phase 9: Destination-Passing Style (DPS) Runtime\n");
-    printf("// Enables stack allocation of return values\n\n");
+static int is_form(Value* e, const char* op) {
+    return e && val_tag(e) == T_CELL && car(e) && val_tag(car(e)) == T_SYM &&
+           strcmp(car(e)->s, op) == 0;
+}
 
-    // Destination type for pre-allocated slots
-    printf("typedef struct Dest {\n");
-    printf("    Obj* ptr;       // Pointer to destination memory\n");
-    printf("    int is_stack;   // 1 if stack-allocated, 0 if heap\n");
-    printf("} Dest;\n\n");
+// Index just past the parenthesized group opening at code[open], skipping
+// string and character literals (0 if unbalanced)
+static size_t group_end(const char* code, size_t open) {
+    int depth = 0;
+    for (size_t i = open; code[i]; i++) {
+        char c = code[i];
+        if (c == '"' || c == '\'') {
+            for (i++; code[i] && code[i] != c; i++) {
+                if (code[i] == '\\' && code[i + 1]) i++;
+            }
+            if (!code[i]) return 0;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+// Constructors a destination can stand in for
+static const struct { const char* alloc; const char* write; } DEST_WRITES[] = {
+    { "mk_pair(", "write_pair(&" },
+    { "mk_int(", "write_int(&" },
+};
 
-    // Create stack destination
-    printf("// Allocate destination on stack\n");
-    printf("#define STACK_DEST(name) \\\n");
-    printf("    Obj name##_storage; \\\n");
-    printf("    Dest name = { &name##_storage, 1 }\n\n");
+char* dps_write_code(const char* code, const char* dest) {
+    if (!code || !dest) return NULL;
+    for (size_t i = 0; i < sizeof(DEST_WRITES) / sizeof(DEST_WRITES[0]); i++) {
+        size_t plen = strlen(DEST_WRITES[i].alloc);
+        if (strncmp(code, DEST_WRITES[i].alloc, plen) != 0) continue;
+        size_t len = strlen(code);
+        if (group_end(code, plen - 1) != len) return NULL;
+
+        size_t size = strlen(DEST_WRITES[i].write) + strlen(dest) + 2 + (len - plen) + 1;
+        char* out = malloc(size);
+        if (!out) return NULL;
+        snprintf(out, size, "%s%s, %s", DEST_WRITES[i].write, dest, code + plen);
+        return out;
+    }
+    return NULL;
+}
+
+// Operators that read a cell without keeping it: one operand, or any
+// number for arithmetic (whose result is always a new integer)
+static const char* const CELL_READERS[] = { "car", "cdr", "fst", "snd", "null?", NULL };
+static const char* const VALUE_READERS[] = {
+    "+", "-", "*", "/", "%", "=", "<", ">", "<=", ">=", "not", NULL
+};
+
+static int is_var(Value* e, const char* var) {
+    return e && val_tag(e) == T_SYM && strcmp(e->s, var) == 0;
+}
+
+// var occurs anywhere in e outside quote
+static int occurs(Value* e, const char* var) {
+    if (!e || val_tag(e) != T_CELL) return e && val_tag(e) == T_SYM && strcmp(e->s, var) == 0;
+    if (is_form(e, "quote")) return 0;
+    for (; val_tag(e) == T_CELL; e = cdr(e)) {
+        if (occurs(car(e), var)) return 1;
+    }
+    return occurs(e, var);
+}
+
+// var only occurs in e as the operand of a cell reader, outside lambdas
+static int only_read(Value* e, const char* var) {
+    if (!e || val_tag(e) != T_CELL) return !(e && val_tag(e) == T_SYM && strcmp(e->s, var) == 0);
+    if (is_form(e, "quote")) return 1;
+    if (is_form(e, "lambda")) return !occurs(e, var);
+    Value* args = cdr(e);
+    if (val_tag(args) == T_CELL && is_nil(cdr(args)) && is_var(car(args), var)) {
+        for (int i = 0; CELL_READERS[i]; i++) {
+            if (is_form(e, CELL_READERS[i])) return 1;
+        }
+    }
+    for (int i = 0; VALUE_READERS[i]; i++) {
+        if (!is_form(e, VALUE_READERS[i])) continue;
+        for (; val_tag(args) == T_CELL; args = cdr(args)) {
+            if (!is_var(car(args), var) && !only_read(car(args), var)) return 0;
+        }
+        return !is_var(args, var);
+    }
+    for (; val_tag(e) == T_CELL; e = cdr(e)) {
+        if (!only_read(car(e), var)) return 0;
+    }
+    return only_read(e, var);
+}
+
+DPSClass classify_dps_binding(Value* val_form, const char* code, Value* body,
+                              const char* var, Shape shape) {
+    // Cyclic cells are released through the deferred queue, which needs
+    // a heap cell
+    if (!val_form || !var || shape == SHAPE_CYCLIC) return DPS_NONE;
+    if (!code || (strncmp(code, "mk_pair(", 8) != 0 && strncmp(code, "mk_int(", 7) != 0)) return DPS_NONE;
+    if (val_tag(val_form) != T_CELL || is_form(val_form, "quote")) return DPS_NONE;
+    if (!only_read(body, var)) return DPS_NONE;
+    // The block's own allocation, or a call whose inlined body returns one
+    if (is_form(val_form, "cons") || is_form(val_form, "lift")) return DPS_STACK;
+    return DPS_CALLER_OWNED;
+}
+
+const char* dps_class_name(DPSClass c) {
+    switch (c) {
+        case DPS_STACK: return "stack";
+        case DPS_CALLER_OWNED: return "caller-owned";
+        case DPS_PIPELINE: return "pipeline";
+        default: return "none";
+    }
+}
+
+// Generate DPS runtime support (Dest, STACK_DEST and the write_*
+// constructors are core: see gen_core_runtime)
+void gen_dps_runtime(void) {
+    emit("\n// Phase 9: Destination-Passing Style (DPS) Runtime\n");
+    emit("// Enables stack allocation of return values\n\n");
 
     // Create heap destination
-    printf("// Allocate destination on heap\n");
-    printf("Dest heap_dest() {\n");
-    printf("    Dest d;\n");
-    printf("    d.ptr = malloc(sizeof(Obj));\n");
-    printf("    if (!d.ptr) { d.is_stack = 0; return d; }  // Return with NULL ptr on OOM\n");
-    printf("    d.is_stack = 0;\n");
-    printf("    return d;\n");
-    printf("}\n\n");
-
-    // DPS-style integer constructor
-    printf("// Write integer to destination\n");
-    printf("Obj* write_int(Dest* dest, long value) {\n");
-    printf("    if (!dest || !dest->ptr) return NULL;\n");
-    printf("    dest->ptr->mark = 1;\n");
-    printf("    dest->ptr->scc_id = -1;\n");
-    printf("    dest->ptr->is_pair = 0;\n");
-    printf("    dest->ptr->scan_tag = 0;\n");
-    printf("    dest->ptr->i = value;\n");
-    printf("    return dest->ptr;\n");
-    printf("}\n\n");
-
-    // DPS-style pair constructor
-    printf("// Write pair to destination\n");
-    printf("Obj* write_pair(Dest* dest, Obj* a, Obj* b) {\n");
-    printf("    if (!dest || !dest->ptr) return NULL;\n");
-    printf("    dest->ptr->mark = 1;\n");
-    printf("    dest->ptr->scc_id = -1;\n");
-    printf("    dest->ptr->is_pair = 1;\n");
-    printf("    dest->ptr->scan_tag = 0;\n");
-    printf("    dest->ptr->a = a;\n");
-    printf("    dest->ptr->b = b;\n");
-    printf("    return dest->ptr;\n");
-    printf("}\n\n");
+    emit("// Allocate destination on heap\n");
+    emit("Dest heap_dest() {\n");
+    emit("    Dest d;\n");
+    emit("    d.ptr = slab_alloc(sizeof(Obj));\n");
+    emit("    if (!d.ptr) { d.is_stack = 0; return d; }  // Return with NULL ptr on OOM\n");
+    emit("    d.is_stack = 0;\n");
+    emit("    return d;\n");
+    emit("}\n\n");
 
     // DPS-aware add function
-    printf("// DPS arithmetic - write result to destination\n");
-    printf("Obj* add_dps(Dest* dest, Obj* a, Obj* b) {\n");
-    printf("    if (!a || !b) return write_int(dest, 0);\n");
-    printf("    return write_int(dest, a->i + b->i);\n");
-    printf("}\n\n");
+    emit("// DPS arithmetic - write result to destination\n");
+    emit("Obj* add_dps(Dest* dest, Obj* a, Obj* b) {\n");
+    emit("    if (!a || !b) return write_int(dest, 0);\n");
+    emit("    return write_int(dest, a->i + b->i);\n");
+    emit("}\n\n");
 
-    printf("Obj* sub_dps(Dest* dest, Obj* a, Obj* b) {\n");
-    printf("    if (!a || !b) return write_int(dest, 0);\n");
-    printf("    return write_int(dest, a->i - b->i);\n");
-    printf("}\n\n");
+    emit("Obj* sub_dps(Dest* dest, Obj* a, Obj* b) {\n");
+    emit("    if (!a || !b) return write_int(dest, 0);\n");
+    emit("    return write_int(dest, a->i - b->i);\n");
+    emit("}\n\n");
 
     // Pipeline support - map with destination array
-    printf("// DPS map - write results to destination array\n");
-    printf("// Enables zero-allocation pipelines\n");
-    printf("typedef Obj* (*MapFn)(Obj*);\n\n");
-
-    printf("void map_dps(Dest* dests, MapFn f, Obj** inputs, int count) {\n");
-    printf("    if (!dests || !f || !inputs) return;\n");
-    printf("    for (int i = 0; i < count; i++) {\n");
-    printf("        if (!dests[i].ptr) continue;\n");
-    printf("        Obj* result = f(inputs[i]);\n");
-    printf("        if (!result) continue;\n");
-    printf("        dests[i].ptr->mark = result->mark;\n");
-    printf("        dests[i].ptr->scc_id = result->scc_id;\n");
-    printf("        dests[i].ptr->is_pair = result->is_pair;\n");
-    printf("        if (result->is_pair) {\n");
-    printf("            dests[i].ptr->a = result->a;\n");
-    printf("            dests[i].ptr->b = result->b;\n");
-    printf("        } else {\n");
-    printf("            dests[i].ptr->i = result->i;\n");
-    printf("        }\n");
-    printf("    }\n");
-    printf("}\n\n");
+    emit("// DPS map - write results to destination array\n");
+    emit("// Enables zero-allocation pipelines\n");
+    emit("typedef Obj* (*MapFn)(Obj*);\n\n");
+
+    emit("void map_dps(Dest* dests, MapFn f, Obj** inputs, int count) {\n");
+    emit("    if (!dests || !f || !inputs) return;\n");
+    emit("    for (int i = 0; i < count; i++) {\n");
+    emit("        if (!dests[i].ptr) continue;\n");
+    emit("        Obj* result = f(inputs[i]);\n");
+    emit("        if (!result) continue;\n");
+    emit("        OBJ_COPY_HDR(dests[i].ptr, result);\n");
+    emit("        if (OBJ_IS_PAIR(result)) {\n");
+    emit("            dests[i].ptr->a = result->a;\n");
+    emit("            dests[i].ptr->b = result->b;\n");
+    emit("        } else {\n");
+    emit("            dests[i].ptr->i = result->i;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n\n");
 
     // Fold with destination
-    printf("// DPS fold - accumulate into destination\n");
-    printf("typedef Obj* (*FoldFn)(Obj*, Obj*);\n\n");
-
-    printf("Obj* fold_dps(Dest* dest, FoldFn f, Obj* init, Obj** inputs, int count) {\n");
-    printf("    if (!dest || !dest->ptr) return NULL;\n");
-    printf("    Obj* acc = init;\n");
-    printf("    for (int i = 0; i < count; i++) {\n");
-    printf("        acc = f(acc, inputs[i]);\n");
-    printf("    }\n");
-    printf("    // Write final result to destination\n");
-    printf("    if (!acc) return NULL;\n");
-    printf("    dest->ptr->mark = acc->mark;\n");
-    printf("    dest->ptr->scc_id = acc->scc_id;\n");
-    printf("    dest->ptr->is_pair = acc->is_pair;\n");
-    printf("    if (acc->is_pair) {\n");
-    printf("        dest->ptr->a = acc->a;\n");
-    printf("        dest->ptr->b = acc->b;\n");
-    printf("    } else {\n");
-    printf("        dest->ptr->i = acc->i;\n");
-    printf("    }\n");
-    printf("    return dest->ptr;\n");
-    printf("}\n\n");
+    emit("// DPS fold - accumulate into destination\n");
+    emit("typedef Obj* (*FoldFn)(Obj*, Obj*);\n\n");
+
+    emit("Obj* fold_dps(Dest* dest, FoldFn f, Obj* init, Obj** inputs, int count) {\n");
+    emit("    if (!dest || !dest->ptr) return NULL;\n");
+    emit("    Obj* acc = init;\n");
+    emit("    for (int i = 0; i < count; i++) {\n");
+    emit("        acc = f(acc, inputs[i]);\n");
+    emit("    }\n");
+    emit("    // Write final result to destination\n");
+    emit("    if (!acc) return NULL;\n");
+    emit("    OBJ_COPY_HDR(dest->ptr, acc);\n");
+    emit("    if (OBJ_IS_PAIR(acc)) {\n");
+    emit("        dest->ptr->a = acc->a;\n");
+    emit("        dest->ptr->b = acc->b;\n");
+    emit("    } else {\n");
+    emit("        dest->ptr->i = acc->i;\n");
+    emit("    }\n");
+    emit("    return dest->ptr;\n");
+    emit("}\n\n");
 }
 
 // Generate DPS-transformed function
 void gen_dps_function(DPSCandidate* candidate, Value* body) {
     if (!candidate) return;
 
-    printf("// DPS-transformed: %s\n", candidate->func_name);
-    printf("Obj* %s_dps(Dest* dest", candidate->func_name);
+    emit("// DPS-transformed: %s\n", candidate->func_name);
+    emit("Obj* %s_dps(Dest* dest", candidate->func_name);
     // Would add other parameters here
-    printf(") {\n");
+    emit(") {\n");
 
     // Generate body with DPS writes instead of allocations
     (void)body;  // Full implementation would transform body
 
-    printf("    return dest->ptr;\n");
-    printf("}\n\n");
+    emit("    return dest->ptr;\n");
+    emit("}\n\n");
 }
@@ -6,6 +6,7 @@
 #define DPS_H
 
 #include "../types.h"
+#include "shape.h"
 
 // DPS candidate classification
 typedef enum {
@@ -41,6 +42,27 @@ int is_dps_candidate(Value* lambda);
 // Find all DPS candidates in program
 DPSCandidate* find_dps_candidates(Value* program);
 
+// -- Destinations in emitted code --
+// Lambdas are inlined by the staged evaluator, so an emitted call is
+// its callee's body in place and the let block binding the result is
+// the caller: it provides the destination, and the fresh cell is
+// written there instead of being allocated.
+
+// Where a let binding's value can be written (DPS_NONE: the heap, as
+// before). val_form is the binding's source, code what it compiled to.
+// The cell must die with the block: var may only be read in body (by
+// car, cdr, fst, snd, null? or arithmetic), never stored, passed on or
+// captured
+DPSClass classify_dps_binding(Value* val_form, const char* code, Value* body,
+                              const char* var, Shape shape);
+
+// code, one whole mk_pair(A, B) or mk_int(N) call, as
+// write_pair(&dest, A, B) or write_int(&dest, N) (NULL if it is not
+// one, or on OOM)
+char* dps_write_code(const char* code, const char* dest);
+
+const char* dps_class_name(DPSClass c);
+
 // Generate DPS runtime support
 void gen_dps_runtime(void);
 
@@ -11,6 +11,7 @@ AnalysisContext* mk_analysis_ctx(void) {
     AnalysisContext* ctx = malloc(sizeof(AnalysisContext));
     if (!ctx) return NULL;
     ctx->vars = NULL;
+    symindex_init(&ctx->index);
     ctx->current_depth = 0;
     ctx->in_lambda = 0;
     return ctx;
@@ -25,17 +26,13 @@ void free_analysis_ctx(AnalysisContext* ctx) {
         free(v);
         v = next;
     }
+    symindex_destroy(&ctx->index);
     free(ctx);
 }
 
 VarUsage* find_var(AnalysisContext* ctx, const char* name) {
     if (!ctx || !name) return NULL;
-    VarUsage* v = ctx->vars;
-    while (v) {
-        if (strcmp(v->name, name) == 0) return v;
-        v = v->next;
-    }
-    return NULL;
+    return symindex_get(&ctx->index, name);
 }
 
 void add_var(AnalysisContext* ctx, const char* name) {
@@ -52,6 +49,11 @@ void add_var(AnalysisContext* ctx, const char* name) {
     v->escape_class = ESCAPE_NONE;
     v->captured_by_lambda = 0;
     v->freed = 0;
+    if (!symindex_put(&ctx->index, v->name, v)) {
+        free(v->name);
+        free(v);
+        return;
+    }
     v->next = ctx->vars;
     ctx->vars = v;
 }
@@ -82,7 +84,7 @@ void analyze_expr(Value* expr, AnalysisContext* ctx) {
 
     ctx->current_depth++;
 
-    switch (expr->tag) {
+    switch (val_tag(expr)) {
         case T_SYM:
             record_use(ctx, expr->s);
             break;
@@ -91,7 +93,7 @@ void analyze_expr(Value* expr, AnalysisContext* ctx) {
             Value* op = car(expr);
             Value* args = cdr(expr);
 
-            if (op && op->tag == T_SYM) {
+            if (op && val_tag(op) == T_SYM) {
                 if (strcmp(op->s, "quote") == 0) {
                     // Don't analyze quoted expressions
                 } else if (strcmp(op->s, "lambda") == 0) {
@@ -134,7 +136,7 @@ void analyze_expr(Value* expr, AnalysisContext* ctx) {
 void analyze_escape(Value* expr, AnalysisContext* ctx, EscapeClass context) {
     if (!expr || !ctx || is_nil(expr)) return;
 
-    switch (expr->tag) {
+    switch (val_tag(expr)) {
         case T_SYM: {
             VarUsage* v = find_var(ctx, expr->s);
             if (v && context > v->escape_class) {
@@ -146,7 +148,7 @@ void analyze_escape(Value* expr, AnalysisContext* ctx, EscapeClass context) {
             Value* op = car(expr);
             Value* args = cdr(expr);
 
-            if (op && op->tag == T_SYM) {
+            if (op && val_tag(op) == T_SYM) {
                 if (strcmp(op->s, "lambda") == 0) {
                     int saved = ctx->in_lambda;
                     ctx->in_lambda = 1;
@@ -175,7 +177,7 @@ void analyze_escape(Value* expr, AnalysisContext* ctx, EscapeClass context) {
                         Value* bind = car(b);
                         if (!is_nil(bind)) {
                             Value* sym = car(bind);
-                            if (sym && sym->tag == T_SYM) {
+                            if (sym && val_tag(sym) == T_SYM) {
                                 VarUsage* v = find_var(ctx, sym->s);
                                 if (v) v->escape_class = ESCAPE_GLOBAL;
                             }
@@ -194,7 +196,7 @@ void analyze_escape(Value* expr, AnalysisContext* ctx, EscapeClass context) {
                 } else if (strcmp(op->s, "set!") == 0) {
                     // set! mutates variable - mark as escaping
                     Value* target = car(args);
-                    if (target && target->tag == T_SYM) {
+                    if (target && val_tag(target) == T_SYM) {
                         VarUsage* v = find_var(ctx, target->s);
                         if (v) v->escape_class = ESCAPE_GLOBAL;
                     }
@@ -234,9 +236,9 @@ void analyze_escape(Value* expr, AnalysisContext* ctx, EscapeClass context) {
 static int is_bound(Value* bound, Value* sym) {
     while (!is_nil(bound)) {
         Value* pair = car(bound);
-        if (pair && pair->tag == T_CELL) {
+        if (pair && val_tag(pair) == T_CELL) {
             Value* key = car(pair);
-            if (key && key->tag == T_SYM && sym && sym->tag == T_SYM &&
+            if (key && val_tag(key) == T_SYM && sym && val_tag(sym) == T_SYM &&
                 strcmp(key->s, sym->s) == 0) {
                 return 1;
             }
@@ -254,7 +256,7 @@ static Value* extend_bound(Value* bound, Value* sym) {
 void find_free_vars(Value* expr, Value* bound, char*** free_vars, int* count) {
     if (!expr || is_nil(expr)) return;
 
-    if (expr->tag == T_SYM) {
+    if (val_tag(expr) == T_SYM) {
         if (!is_bound(bound, expr)) {
             // Add to free vars if not already present
             for (int i = 0; i < *count; i++) {
@@ -271,11 +273,11 @@ void find_free_vars(Value* expr, Value* bound, char*** free_vars, int* count) {
         return;
     }
 
-    if (expr->tag == T_CELL) {
+    if (val_tag(expr) == T_CELL) {
         Value* op = car(expr);
         Value* args = cdr(expr);
 
-        if (op && op->tag == T_SYM) {
+        if (op && val_tag(op) == T_SYM) {
             if (strcmp(op->s, "quote") == 0) {
                 return;
             }
@@ -2,6 +2,7 @@
 #define PURPLE_ESCAPE_H
 
 #include "../types.h"
+#include "../util/symindex.h"
 
 // -- Escape Analysis --
 // Determines where values may escape to
@@ -23,7 +24,8 @@ typedef struct VarUsage {
 } VarUsage;
 
 typedef struct AnalysisContext {
-    VarUsage* vars;
+    VarUsage* vars;              // Newest first
+    SymIndex index;              // Name -> innermost VarUsage
     int current_depth;
     int in_lambda;
 } AnalysisContext;
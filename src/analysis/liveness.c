@@ -0,0 +1,487 @@
+#define _POSIX_C_SOURCE 200809L
+#include "liveness.h"
+#include "escape.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WORD_BITS 64
+
+static int grow_nodes(CFGNode*** arr, int* capacity) {
+    if (*capacity > INT_MAX / 2) return 0;
+    int new_cap = *capacity ? *capacity * 2 : 4;
+    CFGNode** tmp = realloc(*arr, new_cap * sizeof(CFGNode*));
+    if (!tmp) return 0;
+    *arr = tmp;
+    *capacity = new_cap;
+    return 1;
+}
+
+static void free_cfg_node(CFGNode* n) {
+    free(n->succs);
+    free(n->preds);
+    free(n->uses);
+    free(n);
+}
+
+// -- Construction --
+
+CFGNode* mk_cfg_node(CFG* cfg, Value* expr) {
+    if (!cfg) return NULL;
+    CFGNode* n = calloc(1, sizeof(CFGNode));
+    if (!n) return NULL;
+    n->id = cfg->node_count;
+    n->expr = expr;
+    n->def = -1;
+
+    if (cfg->node_count >= cfg->node_capacity &&
+        !grow_nodes(&cfg->nodes, &cfg->node_capacity)) {
+        free(n);
+        return NULL;
+    }
+    cfg->nodes[cfg->node_count++] = n;
+    return n;
+}
+
+int add_cfg_edge(CFGNode* from, CFGNode* to) {
+    if (!from || !to) return 0;
+    for (int i = 0; i < from->succ_count; i++) {
+        if (from->succs[i] == to) return 1;
+    }
+    if (from->succ_count >= from->succ_capacity && !grow_nodes(&from->succs, &from->succ_capacity)) return 0;
+    if (to->pred_count >= to->pred_capacity && !grow_nodes(&to->preds, &to->pred_capacity)) return 0;
+    from->succs[from->succ_count++] = to;
+    to->preds[to->pred_count++] = from;
+    return 1;
+}
+
+CFG* mk_cfg(void) {
+    CFG* cfg = calloc(1, sizeof(CFG));
+    if (!cfg) return NULL;
+    symindex_init(&cfg->vars);
+    cfg->entry = mk_cfg_node(cfg, NULL);
+    cfg->exit = mk_cfg_node(cfg, NULL);
+    if (!cfg->entry || !cfg->exit) {
+        free_cfg(cfg);
+        return NULL;
+    }
+    return cfg;
+}
+
+void free_cfg(CFG* cfg) {
+    if (!cfg) return;
+    for (int i = 0; i < cfg->node_count; i++) free_cfg_node(cfg->nodes[i]);
+    free(cfg->nodes);
+    for (int i = 0; i < cfg->var_count; i++) free(cfg->var_names[i]);
+    free(cfg->var_names);
+    symindex_destroy(&cfg->vars);
+    free(cfg->live_bits);
+    free(cfg);
+}
+
+// -- Variables --
+
+// A new variable number for name (every binding gets its own, so an inner
+// binding never kills an outer one of the same name)
+static int new_var(CFG* cfg, const char* name) {
+    if (cfg->var_count >= cfg->var_capacity) {
+        if (cfg->var_capacity > INT_MAX / 2) return -1;
+        int new_cap = cfg->var_capacity ? cfg->var_capacity * 2 : 16;
+        char** tmp = realloc(cfg->var_names, new_cap * sizeof(char*));
+        if (!tmp) return -1;
+        cfg->var_names = tmp;
+        cfg->var_capacity = new_cap;
+    }
+    char* dup = strdup(name);
+    if (!dup) return -1;
+    cfg->var_names[cfg->var_count] = dup;
+    return cfg->var_count++;
+}
+
+int cfg_var(CFG* cfg, const char* name) {
+    void* found = symindex_get(&cfg->vars, name);
+    if (found) return (int)(intptr_t)found - 1;
+    int v = new_var(cfg, name);
+    if (v < 0) return -1;
+    if (!symindex_put(&cfg->vars, cfg->var_names[v], (void*)(intptr_t)(v + 1))) return -1;
+    return v;
+}
+
+int cfg_find_var(CFG* cfg, const char* name) {
+    void* found = symindex_get(&cfg->vars, name);
+    if (found) return (int)(intptr_t)found - 1;
+    for (int i = 0; i < cfg->var_count; i++) {
+        if (strcmp(cfg->var_names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static int add_use(CFGNode* node, int v) {
+    if (v < 0) return 0;
+    for (int i = 0; i < node->use_count; i++) {
+        if (node->uses[i] == v) return 1;
+    }
+    if (node->use_count >= node->use_capacity) {
+        if (node->use_capacity > INT_MAX / 2) return 0;
+        int new_cap = node->use_capacity ? node->use_capacity * 2 : 4;
+        int* tmp = realloc(node->uses, new_cap * sizeof(int));
+        if (!tmp) return 0;
+        node->uses = tmp;
+        node->use_capacity = new_cap;
+    }
+    node->uses[node->use_count++] = v;
+    return 1;
+}
+
+int cfg_add_use(CFG* cfg, CFGNode* node, const char* name) {
+    return add_use(node, cfg_var(cfg, name));
+}
+
+int cfg_set_def(CFG* cfg, CFGNode* node, const char* name) {
+    node->def = cfg_var(cfg, name);
+    return node->def >= 0;
+}
+
+// -- Building from the AST --
+// cfg->vars always maps a name to its innermost binding in scope; a
+// scope records what each name it binds shadowed, to restore on exit.
+
+typedef struct Shadow {
+    const char* name;
+    int prev;                 // Number the name had, or -1
+} Shadow;
+
+typedef struct Builder {
+    CFG* cfg;
+    Shadow* shadows;
+    int shadow_count;
+    int shadow_capacity;
+} Builder;
+
+static int bind_var(Builder* b, const char* name) {
+    CFG* cfg = b->cfg;
+    if (b->shadow_count >= b->shadow_capacity) {
+        if (b->shadow_capacity > INT_MAX / 2) return -1;
+        int new_cap = b->shadow_capacity ? b->shadow_capacity * 2 : 16;
+        Shadow* tmp = realloc(b->shadows, new_cap * sizeof(Shadow));
+        if (!tmp) return -1;
+        b->shadows = tmp;
+        b->shadow_capacity = new_cap;
+    }
+    void* found = symindex_get(&cfg->vars, name);
+    int v = new_var(cfg, name);
+    if (v < 0 || !symindex_put(&cfg->vars, cfg->var_names[v], (void*)(intptr_t)(v + 1))) return -1;
+    b->shadows[b->shadow_count].name = cfg->var_names[v];
+    b->shadows[b->shadow_count].prev = found ? (int)(intptr_t)found - 1 : -1;
+    b->shadow_count++;
+    return v;
+}
+
+static void unbind_to(Builder* b, int mark) {
+    CFG* cfg = b->cfg;
+    while (b->shadow_count > mark) {
+        Shadow* s = &b->shadows[--b->shadow_count];
+        if (s->prev < 0) {
+            symindex_remove(&cfg->vars, s->name);
+        } else {
+            // Replacing never grows the index, so this cannot fail
+            symindex_put(&cfg->vars, s->name, (void*)(intptr_t)(s->prev + 1));
+        }
+    }
+}
+
+static CFGNode* build(Builder* b, Value* expr, CFGNode* cur);
+
+static CFGNode* step(Builder* b, Value* expr, CFGNode* cur) {
+    CFGNode* n = mk_cfg_node(b->cfg, expr);
+    if (!n || !add_cfg_edge(cur, n)) return NULL;
+    return n;
+}
+
+static CFGNode* build_seq(Builder* b, Value* forms, CFGNode* cur) {
+    for (; cur && val_tag(forms) == T_CELL; forms = cdr(forms)) cur = build(b, car(forms), cur);
+    return cur;
+}
+
+// Symbols are read by the node that consumes them, so an argument stays
+// live up to the call it is passed to; other operands get their own steps
+static CFGNode* build_call(Builder* b, Value* expr, CFGNode* cur) {
+    for (Value* l = expr; cur && val_tag(l) == T_CELL; l = cdr(l)) {
+        if (val_tag(car(l)) != T_SYM) cur = build(b, car(l), cur);
+    }
+    CFGNode* n = cur ? step(b, expr, cur) : NULL;
+    for (Value* l = expr; n && val_tag(l) == T_CELL; l = cdr(l)) {
+        if (val_tag(car(l)) == T_SYM && !add_use(n, cfg_var(b->cfg, car(l)->s))) return NULL;
+    }
+    return n;
+}
+
+static CFGNode* build_lambda(Builder* b, Value* expr, CFGNode* cur) {
+    CFGNode* n = step(b, expr, cur);
+    if (!n) return NULL;
+    char** free_vars = NULL;
+    int count = 0;
+    find_free_vars(expr, NULL, &free_vars, &count);
+    int ok = 1;
+    for (int i = 0; i < count; i++) {
+        if (ok && !add_use(n, cfg_var(b->cfg, free_vars[i]))) ok = 0;
+        free(free_vars[i]);
+    }
+    free(free_vars);
+    return ok ? n : NULL;
+}
+
+static CFGNode* build_if(Builder* b, Value* args, CFGNode* cur) {
+    CFGNode* test = build(b, car(args), cur);
+    if (!test) return NULL;
+    Value* branches = cdr(args);
+    CFGNode* then_end = build(b, car(branches), test);
+    CFGNode* else_end = is_nil(cdr(branches)) ? test : build(b, car(cdr(branches)), test);
+    CFGNode* join = (then_end && else_end) ? mk_cfg_node(b->cfg, NULL) : NULL;
+    if (!join || !add_cfg_edge(then_end, join) || !add_cfg_edge(else_end, join)) return NULL;
+    return join;
+}
+
+// (let ((x v) ...) body...): each value, then the node defining its name
+// (letrec defines every name before the values, which may capture them)
+static CFGNode* define(Builder* b, Value* bind, Value* name, CFGNode* cur) {
+    CFGNode* def = step(b, bind, cur);
+    if (!def || (def->def = bind_var(b, name->s)) < 0) return NULL;
+    return def;
+}
+
+static Value* binding_name(Value* bind) {
+    Value* name = val_tag(bind) == T_CELL ? car(bind) : bind;
+    return val_tag(name) == T_SYM ? name : NULL;
+}
+
+static CFGNode* build_let(Builder* b, Value* args, int recursive, CFGNode* cur) {
+    int mark = b->shadow_count;
+    Value* bindings = car(args);
+    if (recursive) {
+        for (Value* l = bindings; cur && val_tag(l) == T_CELL; l = cdr(l)) {
+            Value* name = binding_name(car(l));
+            if (name) cur = define(b, car(l), name, cur);
+        }
+    }
+    for (Value* l = bindings; cur && val_tag(l) == T_CELL; l = cdr(l)) {
+        Value* bind = car(l);
+        Value* name = binding_name(bind);
+        if (!name) continue;
+        if (val_tag(bind) == T_CELL && val_tag(cdr(bind)) == T_CELL) cur = build(b, car(cdr(bind)), cur);
+        if (cur && !recursive) cur = define(b, bind, name, cur);
+    }
+    cur = cur ? build_seq(b, cdr(args), cur) : NULL;
+    unbind_to(b, mark);
+    return cur;
+}
+
+static CFGNode* build(Builder* b, Value* expr, CFGNode* cur) {
+    if (!expr || is_nil(expr)) return cur;
+    if (val_tag(expr) == T_SYM) {
+        CFGNode* n = step(b, expr, cur);
+        if (!n || !add_use(n, cfg_var(b->cfg, expr->s))) return NULL;
+        return n;
+    }
+    if (val_tag(expr) != T_CELL) return cur;
+
+    Value* op = car(expr);
+    Value* args = cdr(expr);
+    if (val_tag(op) == T_SYM) {
+        if (strcmp(op->s, "quote") == 0) return cur;
+        if (strcmp(op->s, "lambda") == 0) return build_lambda(b, expr, cur);
+        if (strcmp(op->s, "if") == 0) return build_if(b, args, cur);
+        if (strcmp(op->s, "let") == 0) return build_let(b, args, 0, cur);
+        if (strcmp(op->s, "letrec") == 0) return build_let(b, args, 1, cur);
+        if (strcmp(op->s, "do") == 0) return build_seq(b, args, cur);
+        if (strcmp(op->s, "set!") == 0 && val_tag(car(args)) == T_SYM) {
+            cur = build_seq(b, cdr(args), cur);
+            CFGNode* n = cur ? step(b, expr, cur) : NULL;
+            if (!n || (n->def = cfg_var(b->cfg, car(args)->s)) < 0) return NULL;
+            return n;
+        }
+    }
+    return build_call(b, expr, cur);
+}
+
+CFG* cfg_build(Value* expr) {
+    CFG* cfg = mk_cfg();
+    if (!cfg) return NULL;
+    Builder b = { cfg, NULL, 0, 0 };
+    CFGNode* last = build(&b, expr, cfg->entry);
+    free(b.shadows);
+    if (!last || !add_cfg_edge(last, cfg->exit)) {
+        free_cfg(cfg);
+        return NULL;
+    }
+    return cfg;
+}
+
+// -- Dataflow --
+
+static int test_bit(const uint64_t* set, int v) {
+    return (int)((set[v / WORD_BITS] >> (v % WORD_BITS)) & 1);
+}
+
+// Nodes in postorder from the entry (exit side first); unreachable ones last
+static int* postorder(CFG* cfg) {
+    int n = cfg->node_count;
+    int* order = malloc(n * sizeof(int));
+    int* stack = malloc(n * sizeof(int));
+    int* next_succ = calloc(n, sizeof(int));
+    char* seen = calloc(n, 1);
+    if (!order || !stack || !next_succ || !seen) {
+        free(order);
+        order = NULL;
+        goto done;
+    }
+
+    int count = 0;
+    for (int start = cfg->entry->id; start < n; start++) {
+        if (seen[start]) continue;
+        int sp = 0;
+        stack[sp++] = start;
+        seen[start] = 1;
+        while (sp > 0) {
+            CFGNode* node = cfg->nodes[stack[sp - 1]];
+            if (next_succ[node->id] < node->succ_count) {
+                CFGNode* s = node->succs[next_succ[node->id]++];
+                if (!seen[s->id]) {
+                    seen[s->id] = 1;
+                    stack[sp++] = s->id;
+                }
+            } else {
+                order[count++] = node->id;
+                sp--;
+            }
+        }
+    }
+
+done:
+    free(stack);
+    free(next_succ);
+    free(seen);
+    return order;
+}
+
+int compute_liveness(CFG* cfg) {
+    int n = cfg->node_count;
+    int words = cfg->var_count ? (cfg->var_count + WORD_BITS - 1) / WORD_BITS : 1;
+    free(cfg->live_bits);
+    cfg->live_bits = NULL;
+    for (int i = 0; i < n; i++) cfg->nodes[i]->live_in = cfg->nodes[i]->live_out = NULL;
+    cfg->visits = 0;
+
+    if ((size_t)n * 2 > SIZE_MAX / sizeof(uint64_t) / (size_t)words) return 0;
+    uint64_t* bits = calloc((size_t)n * 2 * words, sizeof(uint64_t));
+    uint64_t* scratch = malloc(words * sizeof(uint64_t));
+    int* queue = postorder(cfg);
+    char* queued = malloc(n);
+    if (!bits || !scratch || !queue || !queued) {
+        free(bits);
+        free(scratch);
+        free(queue);
+        free(queued);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        cfg->nodes[i]->live_in = bits + (size_t)i * 2 * words;
+        cfg->nodes[i]->live_out = cfg->nodes[i]->live_in + words;
+    }
+    cfg->live_bits = bits;
+    cfg->words = words;
+
+    // Circular worklist holding each node at most once, seeded with all
+    memset(queued, 1, n);
+    int head = 0;
+    int pending = n;
+    while (pending > 0) {
+        CFGNode* node = cfg->nodes[queue[head]];
+        head = (head + 1) % n;
+        pending--;
+        queued[node->id] = 0;
+        cfg->visits++;
+
+        uint64_t* out = node->live_out;
+        memset(out, 0, words * sizeof(uint64_t));
+        for (int j = 0; j < node->succ_count; j++) {
+            const uint64_t* in = node->succs[j]->live_in;
+            for (int w = 0; w < words; w++) out[w] |= in[w];
+        }
+
+        memcpy(scratch, out, words * sizeof(uint64_t));
+        if (node->def >= 0) scratch[node->def / WORD_BITS] &= ~(1ULL << (node->def % WORD_BITS));
+        for (int j = 0; j < node->use_count; j++) {
+            scratch[node->uses[j] / WORD_BITS] |= 1ULL << (node->uses[j] % WORD_BITS);
+        }
+        if (memcmp(scratch, node->live_in, words * sizeof(uint64_t)) == 0) continue;
+        memcpy(node->live_in, scratch, words * sizeof(uint64_t));
+
+        for (int j = 0; j < node->pred_count; j++) {
+            CFGNode* p = node->preds[j];
+            if (queued[p->id]) continue;
+            queued[p->id] = 1;
+            queue[(head + pending) % n] = p->id;
+            pending++;
+        }
+    }
+
+    free(scratch);
+    free(queue);
+    free(queued);
+    return 1;
+}
+
+int is_live_in(CFG* cfg, CFGNode* node, const char* var) {
+    int v = cfg_find_var(cfg, var);
+    return v >= 0 && v < cfg->words * WORD_BITS && node->live_in && test_bit(node->live_in, v);
+}
+
+int is_live_out(CFG* cfg, CFGNode* node, const char* var) {
+    int v = cfg_find_var(cfg, var);
+    return v >= 0 && v < cfg->words * WORD_BITS && node->live_out && test_bit(node->live_out, v);
+}
+
+FreePoint* find_free_points(CFG* cfg, const char* var) {
+    FreePoint* points = NULL;
+    int v = cfg_find_var(cfg, var);
+    if (v < 0 || v >= cfg->words * WORD_BITS || !cfg->live_bits) return NULL;
+
+    for (int i = cfg->node_count - 1; i >= 0; i--) {
+        CFGNode* node = cfg->nodes[i];
+        if (!test_bit(node->live_in, v)) continue;
+
+        int dies_on_some_edge = 0;
+        int dies_on_all_edges = 1;
+        for (int j = 0; j < node->succ_count; j++) {
+            if (!test_bit(node->succs[j]->live_in, v)) {
+                dies_on_some_edge = 1;
+            } else {
+                dies_on_all_edges = 0;
+            }
+        }
+        if (!dies_on_some_edge) continue;
+
+        FreePoint* fp = malloc(sizeof(FreePoint));
+        if (!fp) continue;  // Skip on OOM
+        fp->var_name = strdup(var);
+        if (!fp->var_name) {
+            free(fp);
+            continue;
+        }
+        fp->node_id = node->id;
+        fp->is_conditional = !dies_on_all_edges;
+        fp->next = points;
+        points = fp;
+    }
+    return points;
+}
+
+void free_free_points(FreePoint* points) {
+    while (points) {
+        FreePoint* next = points->next;
+        free(points->var_name);
+        free(points);
+        points = next;
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef PURPLE_LIVENESS_H
+#define PURPLE_LIVENESS_H
+
+#include <stdint.h>
+#include "../types.h"
+#include "../util/symindex.h"
+
+// -- Liveness for Non-Lexical Lifetimes --
+// Reference: Rust Borrow Checker - free at the earliest safe point, not
+// at scope end. A CFG with one node per evaluation step; variables are
+// numbered as they are first mentioned and every live set is a bitset
+// over those numbers. compute_liveness runs a worklist seeded in
+// postorder (reverse postorder of the reversed graph), so a node is only
+// revisited when a successor's live-in actually grew.
+
+typedef struct CFGNode {
+    int id;
+    Value* expr;              // AST node (NULL: entry, exit, join, def)
+    struct CFGNode** succs;
+    int succ_count;
+    int succ_capacity;
+    struct CFGNode** preds;
+    int pred_count;
+    int pred_capacity;
+
+    int* uses;                // Variable numbers read here
+    int use_count;
+    int use_capacity;
+    int def;                  // Variable number bound here, or -1
+
+    uint64_t* live_in;        // Bitsets, valid after compute_liveness
+    uint64_t* live_out;
+} CFGNode;
+
+typedef struct CFG {
+    CFGNode* entry;
+    CFGNode* exit;
+    CFGNode** nodes;
+    int node_count;
+    int node_capacity;
+
+    char** var_names;         // Number -> name (owned)
+    int var_count;
+    int var_capacity;
+    SymIndex vars;            // Name -> number + 1
+
+    uint64_t* live_bits;      // Every node's live_in and live_out
+    int words;                // Bitset words per set
+    int visits;               // Node visits made by the last compute_liveness
+} CFG;
+
+// Construction (NULL on OOM). free_cfg takes NULL.
+CFG* mk_cfg(void);
+CFGNode* mk_cfg_node(CFG* cfg, Value* expr);
+int add_cfg_edge(CFGNode* from, CFGNode* to);
+void free_cfg(CFG* cfg);
+
+// Variable numbering: the number of name, interned on first use (-1 on OOM)
+int cfg_var(CFG* cfg, const char* name);
+// Number of name if it was ever mentioned, else -1
+int cfg_find_var(CFG* cfg, const char* name);
+int cfg_add_use(CFG* cfg, CFGNode* node, const char* name);
+int cfg_set_def(CFG* cfg, CFGNode* node, const char* name);
+
+// Build the CFG of an expression, entry -> expr -> exit. if branches
+// and joins; let, letrec and set! define their names; a lambda is one
+// node using its free variables (NULL on OOM)
+CFG* cfg_build(Value* expr);
+
+// Dataflow: live_in = uses ∪ (live_out - def), live_out = ∪ succs' live_in
+// (0 on OOM, leaving no live sets)
+int compute_liveness(CFG* cfg);
+int is_live_in(CFG* cfg, CFGNode* node, const char* var);
+int is_live_out(CFG* cfg, CFGNode* node, const char* var);
+
+// Where each variable can be freed (earliest point where no longer live)
+typedef struct FreePoint {
+    char* var_name;
+    int node_id;
+    int is_conditional;       // Still live along some other edge
+    struct FreePoint* next;
+} FreePoint;
+
+// Nodes where var is live on entry but dead along some outgoing edge
+FreePoint* find_free_points(CFG* cfg, const char* var);
+void free_free_points(FreePoint* points);
+
+#endif // PURPLE_LIVENESS_H
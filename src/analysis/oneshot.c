@@ -0,0 +1,163 @@
+#include "oneshot.h"
+#include <string.h>
+
+static int is_cell(Value* v) {
+    return v && val_tag(v) == T_CELL;
+}
+
+// The names that may only be called in tail position: k, and the loops
+// that reach it. Symbols are interned, so membership is identity; bodies
+// may already be resolved, and an address keeps its symbol.
+static int is_member(Value* sym, Value* names) {
+    for (; is_cell(names); names = cdr(names)) {
+        if (car(names) == sym) return 1;
+    }
+    return 0;
+}
+
+// The variable e refers to: a symbol, or one the resolver addressed
+static Value* ref_sym(Value* e) {
+    if (!e) return NULL;
+    if (val_tag(e) == T_SYM) return e;
+    if (val_tag(e) == T_LREF) return e->lref.sym;
+    return NULL;
+}
+
+// names without the ones `bound` shadows
+static Value* without(Value* names, Value* bound) {
+    Value* kept = NULL;
+    for (; is_cell(names); names = cdr(names)) {
+        if (!is_member(car(names), bound)) kept = mk_cell(car(names), kept);
+    }
+    return kept;
+}
+
+static int is_op(Value* e, const char* name) {
+    return e && val_tag(e) == T_SYM && strcmp(e->s, name) == 0;
+}
+
+// Any occurrence of a name in e (shadowing ignored: that only refuses more)
+static int mentions(Value* e, Value* names) {
+    if (!e) return 0;
+    if (ref_sym(e)) return is_member(ref_sym(e), names);
+    if (!is_cell(e)) return 0;
+    if (is_op(car(e), "quote")) return 0;
+    for (; is_cell(e); e = cdr(e)) {
+        if (mentions(car(e), names)) return 1;
+    }
+    return mentions(e, names);
+}
+
+// The symbols of a binding list ((x v) ...), or of a parameter list
+static Value* bound_names(Value* bindings, int params) {
+    Value* names = NULL;
+    for (; is_cell(bindings); bindings = cdr(bindings)) {
+        Value* sym = params ? car(bindings) : car(car(bindings));
+        if (sym && val_tag(sym) == T_SYM) names = mk_cell(sym, names);
+    }
+    if (params && bindings && val_tag(bindings) == T_SYM) names = mk_cell(bindings, names);
+    return names;
+}
+
+static int tail_only(Value* e, int tail, Value* names);
+
+// Every element of list, none in tail position
+static int tail_only_list(Value* list, Value* names) {
+    for (; is_cell(list); list = cdr(list)) {
+        if (!tail_only(car(list), 0, names)) return 0;
+    }
+    return !ref_sym(list) || !is_member(ref_sym(list), names);
+}
+
+// Operands in order, the last one in the form's position
+static int tail_only_seq(Value* list, int tail, Value* names) {
+    for (; is_cell(list); list = cdr(list)) {
+        int last = is_nil(cdr(list));
+        if (!tail_only(car(list), last && tail, names)) return 0;
+    }
+    return 1;
+}
+
+static int is_lambda(Value* e) {
+    return is_cell(e) && is_op(car(e), "lambda") && is_cell(cdr(e));
+}
+
+// A letrec in tail position: its lambdas that reach a name become names
+// themselves, so their bodies are tail positions too
+static int tail_only_letrec(Value* bindings, Value* body, Value* names) {
+    Value* inner = without(names, bound_names(bindings, 0));
+    int grew = 1;
+    while (grew) {
+        grew = 0;
+        for (Value* b = bindings; is_cell(b); b = cdr(b)) {
+            Value* sym = car(car(b));
+            Value* val = car(cdr(car(b)));
+            if (!sym || val_tag(sym) != T_SYM || is_member(sym, inner)) continue;
+            if (is_lambda(val) && mentions(val, inner)) {
+                inner = mk_cell(sym, inner);
+                grew = 1;
+            }
+        }
+    }
+    for (Value* b = bindings; is_cell(b); b = cdr(b)) {
+        Value* sym = car(car(b));
+        Value* val = car(cdr(car(b)));
+        if (sym && val_tag(sym) == T_SYM && is_member(sym, inner) && is_lambda(val)) {
+            Value* params = car(cdr(val));
+            if (!tail_only(car(cdr(cdr(val))), 1, without(inner, bound_names(params, 1)))) return 0;
+        } else if (!tail_only(val, 0, inner)) {
+            return 0;
+        }
+    }
+    return tail_only(body, 1, inner);
+}
+
+static int tail_only(Value* e, int tail, Value* names) {
+    if (!e || is_nil(names)) return 1;
+    if (ref_sym(e)) return !is_member(ref_sym(e), names);
+    if (!is_cell(e)) return 1;
+
+    Value* op = car(e);
+    Value* args = cdr(e);
+    if (ref_sym(op) && is_member(ref_sym(op), names)) {
+        return tail && tail_only_list(args, names);
+    }
+
+    if (is_op(op, "quote")) return 1;
+    if (is_op(op, "if")) {
+        return tail_only(car(args), 0, names) &&
+               tail_only(car(cdr(args)), tail, names) &&
+               tail_only(car(cdr(cdr(args))), tail, names);
+    }
+    if (is_op(op, "do") || is_op(op, "and") || is_op(op, "or")) {
+        return tail_only_seq(args, tail, names);
+    }
+    if (is_op(op, "let") && is_cell(args)) {
+        for (Value* b = car(args); is_cell(b); b = cdr(b)) {
+            if (!tail_only(car(cdr(car(b))), 0, names)) return 0;
+        }
+        return tail_only(car(cdr(args)), tail, without(names, bound_names(car(args), 0)));
+    }
+    if (is_op(op, "letrec") && is_cell(args)) {
+        if (tail) return tail_only_letrec(car(args), car(cdr(args)), names);
+        Value* inner = without(names, bound_names(car(args), 0));
+        return tail_only_list(car(args), inner) && tail_only(car(cdr(args)), 0, inner);
+    }
+    if (is_op(op, "lambda") && is_cell(args)) {
+        // May run at any later time: no name may occur in it
+        return !mentions(cdr(args), without(names, bound_names(car(args), 1)));
+    }
+    return tail_only_list(e, names);
+}
+
+int cont_escape_only(Value* proc) {
+    if (!is_lambda(proc)) return 0;
+    Value* params = car(cdr(proc));
+    Value* body = cdr(cdr(proc));
+    if (!is_cell(params) || !is_nil(cdr(params))) return 0;
+    Value* k = car(params);
+    if (!k || val_tag(k) != T_SYM) return 0;
+    if (!is_cell(body) || !is_nil(cdr(body))) return 0;
+    Value* names = mk_cell(k, NULL);
+    return names && tail_only(car(body), 1, names);
+}
@@ -0,0 +1,20 @@
+#ifndef PURPLE_ONESHOT_H
+#define PURPLE_ONESHOT_H
+
+#include "../types.h"
+
+// -- Escape-Only Continuations --
+// (call/cc (lambda (k) body)) whose k is only ever called in tail
+// position of body never has to unwind anything: calling k there is
+// returning its argument from the call/cc, so the evaluators run body
+// like a let binding k, with no jmp_buf, context or MEnv. Tail position
+// carries through if, do, and, or, let and letrec bodies, and into the
+// lambdas of a letrec whose names are themselves only called in tail
+// position: early exit from a loop or a search. Any other use of k
+// (passed, stored, set!, called under another call or from a lambda that
+// may run later) keeps the general continuation.
+
+// proc is such a (lambda (k) body) form
+int cont_escape_only(Value* proc);
+
+#endif // PURPLE_ONESHOT_H
@@ -0,0 +1,375 @@
+#include "pipeline.h"
+#include "../memory/arena.h"
+#include "../util/swissmap.h"
+#include <string.h>
+
+// Analyses a visit is made for
+#define P_USE    1u   // analyze_expr
+#define P_ESC    2u   // analyze_escape
+#define P_SHAPE  4u   // analyze_shapes_expr
+#define P_RC     8u   // rcopt_analyze_expr
+
+#define FACTS_BLOCK 16384
+
+// -- Setup --
+
+void pipeline_init(AnalysisPipeline* p, AnalysisContext* escape, ShapeContext* shape,
+                   RCOptContext* rcopt) {
+    p->escape = escape;
+    p->shape = shape;
+    p->rcopt = rcopt;
+    p->facts = NULL;
+    p->arena = NULL;
+}
+
+int pipeline_keep_facts(AnalysisPipeline* p) {
+    if (p->facts) return 1;
+    p->facts = swissmap_new();
+    p->arena = arena_create(FACTS_BLOCK);
+    if (!p->facts || !p->arena) {
+        swissmap_free(p->facts);
+        arena_destroy(p->arena);
+        p->facts = NULL;
+        p->arena = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+static void free_fact_vars(void* key, void* value, void* ctx) {
+    (void)key;
+    (void)ctx;
+    NodeFacts* f = value;
+    for (int i = 0; i < f->free_count; i++) free(f->free_vars[i]);
+    free(f->free_vars);
+}
+
+void pipeline_destroy(AnalysisPipeline* p) {
+    if (!p) return;
+    if (p->facts) {
+        swissmap_foreach(p->facts, free_fact_vars, NULL);
+        swissmap_free(p->facts);
+        arena_destroy(p->arena);
+    }
+    p->facts = NULL;
+    p->arena = NULL;
+}
+
+static unsigned full_mask(AnalysisPipeline* p) {
+    return (p->escape ? P_USE | P_ESC : 0) | (p->shape ? P_SHAPE : 0) | (p->rcopt ? P_RC : 0);
+}
+
+// Record for a list node, made on first visit (NULL if facts are not kept)
+static NodeFacts* facts_for(AnalysisPipeline* p, Value* node) {
+    if (!p->facts) return NULL;
+    NodeFacts* f = swissmap_get(p->facts, node);
+    if (f) return f;
+    f = arena_alloc(p->arena, sizeof(NodeFacts));
+    if (!f) return NULL;
+    memset(f, 0, sizeof(NodeFacts));
+    f->shape = SHAPE_UNKNOWN;
+    f->escape = ESCAPE_NONE;
+    Value* op = car(node);
+    f->fresh = op && val_tag(op) == T_SYM &&
+               (strcmp(op->s, "lift") == 0 || strcmp(op->s, "cons") == 0);
+    swissmap_put(p->facts, node, f);
+    return f;
+}
+
+NodeFacts* pipeline_facts(AnalysisPipeline* p, Value* node) {
+    if (!p || !p->facts || !node) return NULL;
+    return swissmap_get(p->facts, node);
+}
+
+char** pipeline_free_vars(AnalysisPipeline* p, Value* lambda, int* count) {
+    if (count) *count = 0;
+    if (!p || !lambda || val_tag(lambda) != T_CELL) return NULL;
+    NodeFacts* f = facts_for(p, lambda);
+    if (!f) return NULL;
+    if (!f->free_done) {
+        find_free_vars(lambda, NULL, &f->free_vars, &f->free_count);
+        f->free_done = 1;
+    }
+    if (count) *count = f->free_count;
+    return f->free_vars;
+}
+
+// -- Traversal --
+// Each case lists what every analysis does at that form; children are
+// visited with the analyses that reach them, in each analysis's own order.
+
+static void visit(AnalysisPipeline* p, Value* e, unsigned m, EscapeClass c);
+
+static void set_shape(AnalysisPipeline* p, unsigned m, Shape s) {
+    if (m & P_SHAPE) p->shape->result_shape = s;
+}
+
+static Shape last_shape(AnalysisPipeline* p) {
+    return p->shape->result_shape;
+}
+
+// rcopt stops at an improper tail; the other walks read it as nil
+static unsigned list_mask(Value* list, unsigned m) {
+    return val_tag(list) == T_CELL ? m : m & ~P_RC;
+}
+
+// Arguments in order, escaping as call arguments; shapes joined into *joined
+static void visit_args(AnalysisPipeline* p, Value* args, unsigned m, Shape* joined) {
+    for (; !is_nil(args); args = cdr(args)) {
+        unsigned am = list_mask(args, m);
+        visit(p, car(args), am, ESCAPE_ARG);
+        if (am & P_SHAPE) *joined = shape_join(*joined, last_shape(p));
+    }
+}
+
+static void visit_let(AnalysisPipeline* p, Value* e, unsigned m, unsigned body_m, EscapeClass c) {
+    Value* args = cdr(e);
+    Value* bindings = car(args);
+    Value* body = car(cdr(args));
+
+    for (; !is_nil(bindings); bindings = cdr(bindings)) {
+        Value* bind = car(bindings);
+        Value* sym = car(bind);
+        Value* val = car(cdr(bind));
+        unsigned vm = m & P_SHAPE;
+        if (!is_nil(bind) && !is_nil(cdr(bind))) vm |= m & (P_USE | P_ESC);
+        if (val_tag(bindings) == T_CELL) vm |= m & P_RC;
+
+        RCOptSummary* summary = (vm & P_RC) ? rcopt_begin_binding(p->rcopt, val) : NULL;
+        visit(p, val, vm, ESCAPE_NONE);
+        if ((vm & P_SHAPE) && sym && val_tag(sym) == T_SYM) add_shape(p->shape, sym->s, last_shape(p));
+        if (vm & P_RC) rcopt_bind(p->rcopt, sym, val, summary);
+    }
+    visit(p, body, body_m, c);
+}
+
+static void visit_lambda(AnalysisPipeline* p, Value* e, unsigned m) {
+    Value* args = cdr(e);
+    Value* body = car(cdr(args));
+    unsigned bm = m & P_RC;
+    if (!is_nil(args) && !is_nil(cdr(args))) bm |= m & (P_USE | P_ESC);
+
+    // Parameters are scoped to the body, and borrowed unless summarized
+    int scoped = (bm & P_RC) ? rcopt_enter_lambda(p->rcopt, e) : 0;
+    int saved_in_lambda = 0;
+    if (m & P_USE) {
+        saved_in_lambda = p->escape->in_lambda;
+        p->escape->in_lambda = 1;
+    }
+    visit(p, body, bm, ESCAPE_GLOBAL);
+    if (m & P_USE) p->escape->in_lambda = saved_in_lambda;
+    if (scoped) rcopt_pop_scope(p->rcopt);
+
+    // A closure is a TREE
+    set_shape(p, m, SHAPE_TREE);
+}
+
+static void visit_letrec(AnalysisPipeline* p, Value* e, unsigned m, EscapeClass c) {
+    Value* op = car(e);
+    Value* args = cdr(e);
+    Value* bindings = car(args);
+    Value* rest = cdr(args);
+
+    // rcopt summarizes the group before it walks the values: it gets a
+    // walk of its own
+    if (m & P_RC) rcopt_analyze_expr(p->rcopt, e);
+    m &= ~P_RC;
+
+    // Usage reads the form as a call: the binding list is its first
+    // argument, the body its second
+    visit(p, op, m & P_USE, ESCAPE_ARG);
+    if (!is_nil(args)) visit(p, bindings, m & P_USE, ESCAPE_ARG);
+
+    // Escape and shape: every bound name first, then the values
+    for (Value* b = bindings; !is_nil(b); b = cdr(b)) {
+        Value* sym = car(car(b));
+        if (!sym || val_tag(sym) != T_SYM) continue;
+        if (m & P_ESC) {
+            VarUsage* v = find_var(p->escape, sym->s);
+            if (v) v->escape_class = ESCAPE_GLOBAL;
+        }
+        if (m & P_SHAPE) add_shape(p->shape, sym->s, SHAPE_CYCLIC);
+    }
+    for (Value* b = bindings; !is_nil(b); b = cdr(b)) {
+        Value* bind = car(b);
+        Value* sym = car(bind);
+        unsigned vm = m & P_SHAPE;
+        if (!is_nil(bind) && !is_nil(cdr(bind))) vm |= m & P_ESC;
+        visit(p, car(cdr(bind)), vm, ESCAPE_GLOBAL);
+        if ((vm & P_SHAPE) && sym && val_tag(sym) == T_SYM) add_shape(p->shape, sym->s, last_shape(p));
+    }
+
+    unsigned bm = m & (P_ESC | P_SHAPE);
+    if (!is_nil(rest)) bm |= m & P_USE;
+    visit(p, car(rest), bm, c);
+
+    // Anything past the body is an argument to usage only
+    if (!is_nil(rest)) {
+        Shape ignored = SHAPE_UNKNOWN;
+        visit_args(p, cdr(rest), m & P_USE, &ignored);
+    }
+}
+
+static void visit_set(AnalysisPipeline* p, Value* e, unsigned m) {
+    Value* op = car(e);
+    Value* args = cdr(e);
+    Value* target = car(args);
+    Value* value = car(cdr(args));
+    int has_value = !is_nil(cdr(args));
+
+    visit(p, op, m & P_USE, ESCAPE_ARG);
+    if (!is_nil(args)) visit(p, target, m & P_USE, ESCAPE_ARG);
+
+    // set! mutates the variable: it escapes, and may now close a cycle
+    if (target && val_tag(target) == T_SYM) {
+        if (m & P_ESC) {
+            VarUsage* v = find_var(p->escape, target->s);
+            if (v) v->escape_class = ESCAPE_GLOBAL;
+        }
+        if (m & P_SHAPE) add_shape(p->shape, target->s, SHAPE_CYCLIC);
+    }
+
+    unsigned vm = m & P_RC;
+    if (has_value) vm |= m & (P_USE | P_ESC);
+    visit(p, value, vm, ESCAPE_GLOBAL);
+    if (has_value) {
+        Shape ignored = SHAPE_UNKNOWN;
+        visit_args(p, cdr(cdr(args)), m & P_USE, &ignored);
+    }
+
+    // set! creates an alias
+    if ((m & P_RC) && target && val_tag(target) == T_SYM && value && val_tag(value) == T_SYM) {
+        rcopt_define_alias(p->rcopt, target->s, value->s);
+    }
+    set_shape(p, m, SHAPE_CYCLIC);
+}
+
+// if, cons and lift: usage, escape and rcopt see a call; shape reads the
+// first `shaped` arguments into shapes[] (nil ones are TREE)
+static void visit_shaped_args(AnalysisPipeline* p, Value* args, unsigned m, int shaped, Shape* shapes) {
+    for (int i = 0; i < shaped; i++) shapes[i] = SHAPE_TREE;
+    for (int i = 0; !is_nil(args); args = cdr(args), i++) {
+        unsigned am = list_mask(args, m & (P_USE | P_ESC | P_RC));
+        if (i < shaped) am |= m & P_SHAPE;
+        visit(p, car(args), am, ESCAPE_ARG);
+        if (i < shaped && (am & P_SHAPE)) shapes[i] = last_shape(p);
+    }
+}
+
+static void visit_cell(AnalysisPipeline* p, Value* e, unsigned m, EscapeClass c) {
+    Value* op = car(e);
+    Value* args = cdr(e);
+    const char* name = (op && val_tag(op) == T_SYM) ? op->s : NULL;
+    Shape shapes[3];
+
+    if (name && strcmp(name, "let") == 0) {
+        visit_let(p, e, m, m, c);
+    } else if (name && strcmp(name, "lambda") == 0) {
+        visit_lambda(p, e, m);
+    } else if (name && strcmp(name, "letrec") == 0) {
+        visit_letrec(p, e, m, c);
+    } else if (name && strcmp(name, "set!") == 0) {
+        visit_set(p, e, m);
+    } else if (name && strcmp(name, "if") == 0) {
+        // Shape joins the branches
+        visit(p, op, m & P_RC, ESCAPE_ARG);
+        visit_shaped_args(p, args, m, 3, shapes);
+        if (m & P_RC) rcopt_note_call(p->rcopt, op, args);
+        set_shape(p, m, shape_join(shapes[1], shapes[2]));
+    } else if (name && strcmp(name, "cons") == 0) {
+        // A cons of unshared trees is a tree
+        visit(p, op, m & (P_USE | P_RC), ESCAPE_ARG);
+        visit_shaped_args(p, args, m, 2, shapes);
+        if (m & P_RC) rcopt_note_call(p->rcopt, op, args);
+        if (m & P_SHAPE) {
+            Shape s;
+            if (shapes[0] == SHAPE_TREE && shapes[1] == SHAPE_TREE) {
+                s = may_alias(p->shape, car(args), car(cdr(args))) ? SHAPE_DAG : SHAPE_TREE;
+            } else {
+                s = shape_join(shapes[0], shapes[1]);
+                if (s == SHAPE_TREE) s = SHAPE_DAG;
+            }
+            set_shape(p, m, s);
+        }
+    } else if (name && strcmp(name, "lift") == 0) {
+        // lift keeps its argument's shape
+        visit(p, op, m & (P_USE | P_RC), ESCAPE_ARG);
+        visit_shaped_args(p, args, m, 1, shapes);
+        if (m & P_RC) rcopt_note_call(p->rcopt, op, args);
+        set_shape(p, m, shapes[0]);
+    } else {
+        // Calls (and quote, which only usage skips): shapes of all parts joined
+        unsigned om = m & (P_SHAPE | P_RC);
+        if (!name || strcmp(name, "quote") != 0) om |= m & P_USE;
+        if (!name) om |= m & P_ESC;
+        unsigned am = m;
+        if (name && strcmp(name, "quote") == 0) am &= ~P_USE;
+
+        Shape joined = SHAPE_UNKNOWN;
+        visit(p, op, om, ESCAPE_ARG);
+        if (om & P_SHAPE) joined = shape_join(joined, last_shape(p));
+        visit_args(p, args, am, &joined);
+        if (m & P_RC) rcopt_note_call(p->rcopt, op, args);
+        if (shape_fresh_tree_call(name)) joined = SHAPE_TREE;
+        set_shape(p, m, joined == SHAPE_UNKNOWN ? SHAPE_DAG : joined);
+    }
+}
+
+static void visit(AnalysisPipeline* p, Value* e, unsigned m, EscapeClass c) {
+    if (!m) return;
+    if (is_nil(e)) {
+        set_shape(p, m, SHAPE_TREE);
+        return;
+    }
+    if (m & P_USE) p->escape->current_depth++;
+
+    switch (val_tag(e)) {
+        case T_SYM:
+            if (m & P_USE) record_use(p->escape, e->s);
+            if (m & P_ESC) {
+                VarUsage* v = find_var(p->escape, e->s);
+                if (v && c > v->escape_class) v->escape_class = c;
+            }
+            if (m & P_SHAPE) {
+                ShapeInfo* s = find_shape(p->shape, e->s);
+                p->shape->result_shape = s ? s->shape : SHAPE_UNKNOWN;
+            }
+            if (m & P_RC) rcopt_mark_used(p->rcopt, e->s);
+            break;
+
+        case T_CELL: {
+            visit_cell(p, e, m, c);
+            NodeFacts* f = facts_for(p, e);
+            if (f) {
+                if ((m & P_ESC) && c > f->escape) f->escape = c;
+                if (m & P_SHAPE) f->shape = last_shape(p);
+            }
+            break;
+        }
+
+        case T_INT:
+            set_shape(p, m, SHAPE_TREE);
+            break;
+
+        default:
+            set_shape(p, m, SHAPE_UNKNOWN);
+            break;
+    }
+
+    if (m & P_USE) p->escape->current_depth--;
+}
+
+// -- Entry Points --
+
+void pipeline_run(AnalysisPipeline* p, Value* expr, EscapeClass context) {
+    if (!p) return;
+    visit(p, expr, full_mask(p), context);
+}
+
+void pipeline_run_let(AnalysisPipeline* p, Value* let_form, EscapeClass context) {
+    if (!p || !let_form || val_tag(let_form) != T_CELL) return;
+    unsigned m = full_mask(p);
+    visit_let(p, let_form, m & P_SHAPE, m, context);
+    NodeFacts* f = facts_for(p, let_form);
+    if (f && (m & P_SHAPE)) f->shape = last_shape(p);
+}
@@ -0,0 +1,58 @@
+#ifndef PURPLE_PIPELINE_H
+#define PURPLE_PIPELINE_H
+
+#include "../types.h"
+#include "escape.h"
+#include "shape.h"
+#include "rcopt.h"
+
+// -- Fused Analysis Pipeline --
+// Runs usage counting (analyze_expr), escape analysis (analyze_escape),
+// shape analysis (analyze_shapes_expr) and RC optimization
+// (rcopt_analyze_expr) in one traversal. Each visit carries the set of
+// analyses that would reach the node on their own walk, so every context
+// ends up exactly as if its analysis had walked the tree alone; where the
+// walks agree (almost everywhere) a node is visited once for all of them.
+
+// What the analyses learned about one list node
+typedef struct NodeFacts {
+    Shape shape;             // Shape of the node's value (SHAPE_UNKNOWN if not shaped)
+    EscapeClass escape;      // Strongest context the node is evaluated in
+    int fresh;               // Returns a fresh allocation: the DPS criterion
+    int free_done;           // Lambdas: free variables computed
+    char** free_vars;
+    int free_count;
+} NodeFacts;
+
+typedef struct AnalysisPipeline {
+    AnalysisContext* escape; // Usage and escape (NULL: skip both)
+    ShapeContext* shape;     // NULL: skip
+    RCOptContext* rcopt;     // NULL: skip
+    struct SwissMap* facts;  // Value* -> NodeFacts*, list nodes only (NULL: not kept)
+    struct Arena* arena;     // NodeFacts storage
+} AnalysisPipeline;
+
+// Set up over the given contexts (which stay the caller's); NULL ones are
+// skipped. Facts are not kept unless pipeline_keep_facts is called
+// (0 on OOM)
+void pipeline_init(AnalysisPipeline* p, AnalysisContext* escape, ShapeContext* shape,
+                   RCOptContext* rcopt);
+int pipeline_keep_facts(AnalysisPipeline* p);
+void pipeline_destroy(AnalysisPipeline* p);
+
+// Analyze expr with every context, escape starting from `context`
+void pipeline_run(AnalysisPipeline* p, Value* expr, EscapeClass context);
+
+// Analyze a let form the way the let compiler does: shapes for the
+// whole form (so its own bindings get a shape), usage, escape and RC
+// optimization for the body only
+void pipeline_run_let(AnalysisPipeline* p, Value* let_form, EscapeClass context);
+
+// Facts for a list node, or NULL if it was not visited or facts are not kept
+NodeFacts* pipeline_facts(AnalysisPipeline* p, Value* node);
+
+// Free variables of a lambda form, computed on first request and cached
+// with its facts (NULL if the pipeline keeps no facts)
+char** pipeline_free_vars(AnalysisPipeline* p, Value* lambda, int* count);
+
+#endif // PURPLE_PIPELINE_H
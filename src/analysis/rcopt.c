@@ -23,29 +23,84 @@ RCOptContext* mk_rcopt_context(void) {
     RCOptContext* ctx = malloc(sizeof(RCOptContext));
     if (!ctx) return NULL;
     ctx->vars = NULL;
+    symindex_init(&ctx->index);
+    ctx->scopes = NULL;
+    ctx->scope_depth = 0;
+    ctx->scope_capacity = 0;
+    ctx->defined = 0;
     ctx->current_point = 0;
     ctx->eliminated = 0;
+    ctx->pending = NULL;
+    ctx->pending_lambda = NULL;
     return ctx;
 }
 
+static void free_info(RCOptInfo* info) {
+    free(info->var_name);
+    free(info->alias_of);
+    for (int i = 0; i < info->alias_count; i++) {
+        free(info->aliases[i]);
+    }
+    free(info->aliases);
+    rcopt_free_summary(info->summary);
+    free(info);
+}
+
 /* Free RC optimization context */
 void free_rcopt_context(RCOptContext* ctx) {
     if (!ctx) return;
     RCOptInfo* info = ctx->vars;
     while (info) {
         RCOptInfo* next = info->next;
-        free(info->var_name);
-        free(info->alias_of);
-        for (int i = 0; i < info->alias_count; i++) {
-            free(info->aliases[i]);
-        }
-        free(info->aliases);
-        free(info);
+        free_info(info);
         info = next;
     }
+    symindex_destroy(&ctx->index);
+    free(ctx->scopes);
     free(ctx);
 }
 
+/* Make info the innermost binding of its name */
+static RCOptInfo* link_var(RCOptContext* ctx, RCOptInfo* info) {
+    info->consumed_at = 0;
+    info->summary = NULL;
+    info->shadowed = symindex_get(&ctx->index, info->var_name);
+    if (!symindex_put(&ctx->index, info->var_name, info)) {
+        free_info(info);
+        return NULL;
+    }
+    info->next = ctx->vars;
+    ctx->vars = info;
+    ctx->defined++;
+    return info;
+}
+
+int rcopt_push_scope(RCOptContext* ctx) {
+    if (!ctx) return 0;
+    if (ctx->scope_depth == ctx->scope_capacity) {
+        int cap = ctx->scope_capacity ? ctx->scope_capacity * 2 : 8;
+        RCOptInfo** scopes = realloc(ctx->scopes, (size_t)cap * sizeof(RCOptInfo*));
+        if (!scopes) return 0;
+        ctx->scopes = scopes;
+        ctx->scope_capacity = cap;
+    }
+    ctx->scopes[ctx->scope_depth++] = ctx->vars;
+    return 1;
+}
+
+void rcopt_pop_scope(RCOptContext* ctx) {
+    if (!ctx || ctx->scope_depth == 0) return;
+    RCOptInfo* mark = ctx->scopes[--ctx->scope_depth];
+    while (ctx->vars != mark) {
+        RCOptInfo* info = ctx->vars;
+        ctx->vars = info->next;
+        /* Newest first, so info is the indexed binding of its name */
+        if (info->shadowed) symindex_put(&ctx->index, info->shadowed->var_name, info->shadowed);
+        else symindex_remove(&ctx->index, info->var_name);
+        free_info(info);
+    }
+}
+
 /* Advance program point */
 static int next_point(RCOptContext* ctx) {
     ctx->current_point++;
@@ -55,14 +110,7 @@ static int next_point(RCOptContext* ctx) {
 /* Find variable info */
 RCOptInfo* rcopt_find_var(RCOptContext* ctx, const char* name) {
     if (!ctx || !name) return NULL;
-    RCOptInfo* info = ctx->vars;
-    while (info) {
-        if (strcmp(info->var_name, name) == 0) {
-            return info;
-        }
-        info = info->next;
-    }
-    return NULL;
+    return symindex_get(&ctx->index, name);
 }
 
 /* Add alias to variable */
@@ -111,10 +159,7 @@ RCOptInfo* rcopt_define_var(RCOptContext* ctx, const char* name) {
     info->alias_count = 0;
     info->alias_capacity = 0;
 
-    info->next = ctx->vars;
-    ctx->vars = info;
-
-    return info;
+    return link_var(ctx, info);
 }
 
 /* Define a variable as an alias of another */
@@ -156,10 +201,7 @@ RCOptInfo* rcopt_define_alias(RCOptContext* ctx, const char* name, const char* a
     add_alias(original, name);
     add_alias(info, alias_of);
 
-    info->next = ctx->vars;
-    ctx->vars = info;
-
-    return info;
+    return link_var(ctx, info);
 }
 
 /* Define a borrowed reference (no RC ops needed) */
@@ -183,10 +225,7 @@ RCOptInfo* rcopt_define_borrowed(RCOptContext* ctx, const char* name) {
     info->alias_count = 0;
     info->alias_capacity = 0;
 
-    info->next = ctx->vars;
-    ctx->vars = info;
-
-    return info;
+    return link_var(ctx, info);
 }
 
 /* Mark a variable as used */
@@ -220,6 +259,12 @@ RCOptimization rcopt_get_inc_ref(RCOptContext* ctx, const char* name) {
         }
     }
 
+    /* Moved into a consuming call at its last use: no inc, no dec */
+    if (info->is_unique && info->consumed_at && info->consumed_at == info->last_used_at) {
+        ctx->eliminated++;
+        return RC_OPT_ELIDE_ALL;
+    }
+
     return RC_OPT_NONE;
 }
 
@@ -246,6 +291,15 @@ RCOptimization rcopt_get_dec_ref(RCOptContext* ctx, const char* name) {
         }
     }
 
+    /* Handed to a consuming call: the callee owns it from there on */
+    if (info->consumed_at) {
+        if (info->is_unique && info->consumed_at == info->last_used_at) {
+            ctx->eliminated++;
+            return RC_OPT_ELIDE_ALL;
+        }
+        return RC_OPT_NONE;
+    }
+
     /* If proven unique, can use direct free */
     if (info->is_unique) {
         ctx->eliminated++;
@@ -274,11 +328,467 @@ const char* rcopt_get_free_function(RCOptContext* ctx, const char* name, int sha
     }
 }
 
+/* -- Interprocedural summaries -- */
+
+void rcopt_free_summary(RCOptSummary* summary) {
+    if (!summary) return;
+    free(summary->params);
+    free(summary);
+}
+
+static RCOptSummary* mk_summary(int param_count) {
+    RCOptSummary* s = malloc(sizeof(RCOptSummary));
+    if (!s) return NULL;
+    s->param_count = param_count;
+    s->params = calloc(param_count ? (size_t)param_count : 1, sizeof(RCParamMode));
+    if (!s->params) {
+        free(s);
+        return NULL;
+    }
+    s->returns_unique = 1;
+    s->returns_param = -1;
+    return s;
+}
+
+RCOptSummary* rcopt_find_summary(RCOptContext* ctx, const char* fn) {
+    RCOptInfo* info = rcopt_find_var(ctx, fn);
+    return info ? info->summary : NULL;
+}
+
+/* Primitives that only read their arguments; the first group returns
+ * immediates, the second a part of an argument */
+static const char* const borrowing_prims[] = {
+    "+", "-", "*", "/", "%", "=", "<", ">", "<=", ">=", "not", "null?", "box?",
+    "display", "print", "newline", "vector?", "vector-length", "vector-ref", "vector-dot", NULL,
+    "car", "cdr", "fst", "snd", "unbox", NULL
+};
+
+/* 1: returns an immediate, 0: returns a part of an argument, -1: not borrowing */
+static int borrowing_prim(const char* name) {
+    int immediate = 1;
+    for (int i = 0; ; i++) {
+        if (!borrowing_prims[i]) {
+            if (!immediate) return -1;
+            immediate = 0;
+            continue;
+        }
+        if (strcmp(borrowing_prims[i], name) == 0) return immediate;
+    }
+}
+
+/* Constructors store their arguments and return a fresh object */
+static int is_constructor(const char* name) {
+    return strcmp(name, "cons") == 0 || strcmp(name, "lift") == 0 || strcmp(name, "box") == 0;
+}
+
+/* Names bound inside the body being summarized: each is either an alias
+ * of a parameter or something else (-1) */
+typedef struct Summarizer {
+    RCOptContext* ctx;
+    Value* params;
+    RCOptSummary* s;
+    const char** names;
+    int* param_of;
+    int count;
+    int capacity;
+    int ret;               /* Parameter returned so far: -2 none yet, -1 mixed */
+    int oom;
+} Summarizer;
+
+static void sum_push(Summarizer* S, const char* name, int param) {
+    if (S->count == S->capacity) {
+        int cap = S->capacity ? S->capacity * 2 : 8;
+        const char** names = realloc(S->names, (size_t)cap * sizeof(char*));
+        if (names) S->names = names;
+        int* param_of = realloc(S->param_of, (size_t)cap * sizeof(int));
+        if (param_of) S->param_of = param_of;
+        if (!names || !param_of) {
+            S->oom = 1;
+            return;
+        }
+        S->capacity = cap;
+    }
+    S->names[S->count] = name;
+    S->param_of[S->count] = param;
+    S->count++;
+}
+
+/* Is name bound in the body (1), a parameter (index in *param), or neither */
+static int sum_lookup(Summarizer* S, const char* name, int* param) {
+    *param = -1;
+    for (int i = S->count - 1; i >= 0; i--) {
+        if (strcmp(S->names[i], name) == 0) {
+            *param = S->param_of[i];
+            return 1;
+        }
+    }
+    int i = 0;
+    for (Value* p = S->params; !is_nil(p) && val_tag(p) == T_CELL; p = cdr(p), i++) {
+        Value* param_sym = car(p);
+        if (param_sym && val_tag(param_sym) == T_SYM && strcmp(param_sym->s, name) == 0) {
+            *param = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int sum_param(Summarizer* S, Value* e) {
+    int param = -1;
+    if (e && val_tag(e) == T_SYM) sum_lookup(S, e->s, &param);
+    return param;
+}
+
+static void sum_consume(Summarizer* S, int param) {
+    if (param >= 0 && param < S->s->param_count) S->s->params[param] = RC_PARAM_CONSUMED;
+}
+
+/* A path returns parameter `param` as is (-1: something else) */
+static void sum_return(Summarizer* S, int param) {
+    S->ret = (S->ret == -2 || S->ret == param) ? param : -1;
+}
+
+/* Every parameter mentioned under a lambda is captured */
+static void sum_capture(Summarizer* S, Value* e) {
+    if (!e || is_nil(e)) return;
+    if (val_tag(e) == T_SYM) {
+        sum_consume(S, sum_param(S, e));
+        return;
+    }
+    if (val_tag(e) != T_CELL) return;
+    Value* op = car(e);
+    if (op && val_tag(op) == T_SYM && strcmp(op->s, "quote") == 0) return;
+    for (; !is_nil(e) && val_tag(e) == T_CELL; e = cdr(e)) sum_capture(S, car(e));
+}
+
+static void sum_expr(Summarizer* S, Value* e, int tail);
+
+/* Arguments of a call: parameters passed where consume(i) holds are consumed */
+static void sum_args(Summarizer* S, Value* args, RCOptSummary* callee, int consume_all) {
+    int i = 0;
+    for (; !is_nil(args) && val_tag(args) == T_CELL; args = cdr(args), i++) {
+        Value* arg = car(args);
+        if (arg && val_tag(arg) == T_SYM) {
+            int consumed = consume_all || (callee && (i >= callee->param_count ||
+                                                      callee->params[i] == RC_PARAM_CONSUMED));
+            if (consumed) sum_consume(S, sum_param(S, arg));
+        } else {
+            sum_expr(S, arg, 0);
+        }
+    }
+}
+
+static void sum_let(Summarizer* S, Value* args, int recursive, int tail) {
+    int mark = S->count;
+    Value* bindings = car(args);
+    if (recursive) {
+        for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+            Value* sym = car(car(b));
+            if (sym && val_tag(sym) == T_SYM) sum_push(S, sym->s, -1);
+        }
+    }
+    for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+        Value* sym = car(car(b));
+        Value* val = car(cdr(car(b)));
+        sum_expr(S, val, 0);
+        if (!recursive && sym && val_tag(sym) == T_SYM) sum_push(S, sym->s, sum_param(S, val));
+    }
+    sum_expr(S, car(cdr(args)), tail);
+    S->count = mark;
+}
+
+static void sum_expr(Summarizer* S, Value* e, int tail) {
+    if (!e || is_nil(e) || val_tag(e) == T_INT) {
+        if (tail) sum_return(S, -1);
+        return;
+    }
+    if (val_tag(e) == T_SYM) {
+        if (!tail) return;
+        int param = sum_param(S, e);
+        sum_consume(S, param);
+        sum_return(S, param);
+        S->s->returns_unique = 0;
+        return;
+    }
+    if (val_tag(e) != T_CELL) {
+        if (tail) sum_return(S, -1);
+        return;
+    }
+
+    Value* op = car(e);
+    Value* args = cdr(e);
+    const char* name = (op && val_tag(op) == T_SYM) ? op->s : NULL;
+    int local = 0;
+    if (name) {
+        int ignored;
+        local = sum_lookup(S, name, &ignored);
+    }
+
+    if (name && !local) {
+        if (strcmp(name, "quote") == 0) {
+            if (tail) {
+                sum_return(S, -1);
+                S->s->returns_unique = 0;
+            }
+            return;
+        }
+        if (strcmp(name, "if") == 0) {
+            sum_expr(S, car(args), 0);
+            sum_expr(S, car(cdr(args)), tail);
+            sum_expr(S, car(cdr(cdr(args))), tail);
+            return;
+        }
+        if (strcmp(name, "let") == 0 || strcmp(name, "letrec") == 0) {
+            sum_let(S, args, name[3] == 'r', tail);
+            return;
+        }
+        if (strcmp(name, "lambda") == 0) {
+            int mark = S->count;
+            for (Value* p = car(args); !is_nil(p) && val_tag(p) == T_CELL; p = cdr(p)) {
+                if (car(p) && val_tag(car(p)) == T_SYM) sum_push(S, car(p)->s, -1);
+            }
+            sum_capture(S, car(cdr(args)));
+            S->count = mark;
+            if (tail) sum_return(S, -1);
+            return;
+        }
+        if (strcmp(name, "set!") == 0) {
+            Value* value = car(cdr(args));
+            if (value && val_tag(value) == T_SYM) sum_consume(S, sum_param(S, value));
+            else sum_expr(S, value, 0);
+            if (tail) {
+                sum_return(S, -1);
+                S->s->returns_unique = 0;
+            }
+            return;
+        }
+        if (strcmp(name, "do") == 0) {
+            for (; !is_nil(args) && val_tag(args) == T_CELL; args = cdr(args)) {
+                sum_expr(S, car(args), tail && is_nil(cdr(args)));
+            }
+            return;
+        }
+        if (is_constructor(name)) {
+            sum_args(S, args, NULL, 1);
+            if (tail) sum_return(S, -1);
+            return;
+        }
+        int prim = borrowing_prim(name);
+        if (prim >= 0) {
+            sum_args(S, args, NULL, 0);
+            if (tail) {
+                sum_return(S, -1);
+                if (!prim) S->s->returns_unique = 0;
+            }
+            return;
+        }
+        RCOptSummary* callee = rcopt_find_summary(S->ctx, name);
+        if (callee) {
+            sum_args(S, args, callee, 0);
+            if (tail) {
+                int returned = -1;
+                if (callee->returns_param >= 0) {
+                    Value* a = args;
+                    for (int i = 0; i < callee->returns_param && !is_nil(a) && val_tag(a) == T_CELL; i++) a = cdr(a);
+                    if (!is_nil(a) && val_tag(a) == T_CELL) returned = sum_param(S, car(a));
+                }
+                sum_return(S, returned);
+                if (!callee->returns_unique) S->s->returns_unique = 0;
+            }
+            return;
+        }
+    }
+
+    /* Unknown callee: it may keep anything passed to it */
+    if (!name) sum_expr(S, op, 0);
+    sum_args(S, args, NULL, 1);
+    if (tail) {
+        sum_return(S, -1);
+        S->s->returns_unique = 0;
+    }
+}
+
+RCOptSummary* rcopt_summarize_lambda(RCOptContext* ctx, Value* lambda) {
+    if (!ctx || !lambda || val_tag(lambda) != T_CELL) return NULL;
+    Value* params = car(cdr(lambda));
+    int count = 0;
+    for (Value* p = params; !is_nil(p) && val_tag(p) == T_CELL; p = cdr(p)) count++;
+
+    Summarizer S = { ctx, params, mk_summary(count), NULL, NULL, 0, 0, -2, 0 };
+    if (!S.s) return NULL;
+    sum_expr(&S, car(cdr(cdr(lambda))), 1);
+    S.s->returns_param = S.ret >= 0 ? S.ret : -1;
+    free(S.names);
+    free(S.param_of);
+    if (S.oom) {
+        rcopt_free_summary(S.s);
+        return NULL;
+    }
+    return S.s;
+}
+
+static int is_lambda(Value* e) {
+    return e && val_tag(e) == T_CELL && car(e) && val_tag(car(e)) == T_SYM &&
+           strcmp(car(e)->s, "lambda") == 0;
+}
+
+static int same_summary(RCOptSummary* a, RCOptSummary* b) {
+    if (a->param_count != b->param_count || a->returns_unique != b->returns_unique ||
+        a->returns_param != b->returns_param) return 0;
+    return memcmp(a->params, b->params, (size_t)a->param_count * sizeof(RCParamMode)) == 0;
+}
+
+/* Cap on letrec fixpoint rounds; modes and uniqueness only ever weaken,
+ * so this is only reached by returns_param flip-flopping */
+#define SUMMARY_MAX_ROUNDS 32
+
+/* Summaries for a letrec group, whose names are already defined: start
+ * optimistic (everything borrowed, results unique) and recompute every
+ * member against the others until nothing changes */
+static void summarize_group(RCOptContext* ctx, Value* bindings) {
+    for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+        Value* sym = car(car(b));
+        Value* val = car(cdr(car(b)));
+        RCOptInfo* info = (sym && val_tag(sym) == T_SYM) ? rcopt_find_var(ctx, sym->s) : NULL;
+        if (!info || !is_lambda(val)) continue;
+        int count = 0;
+        for (Value* p = car(cdr(val)); !is_nil(p) && val_tag(p) == T_CELL; p = cdr(p)) count++;
+        rcopt_free_summary(info->summary);
+        info->summary = mk_summary(count);
+    }
+
+    int changed = 1;
+    for (int round = 0; changed && round < SUMMARY_MAX_ROUNDS; round++) {
+        changed = 0;
+        for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+            Value* sym = car(car(b));
+            RCOptInfo* info = (sym && val_tag(sym) == T_SYM) ? rcopt_find_var(ctx, sym->s) : NULL;
+            if (!info || !info->summary) continue;
+            RCOptSummary* s = rcopt_summarize_lambda(ctx, car(cdr(car(b))));
+            if (!s) continue;
+            if (same_summary(s, info->summary)) {
+                rcopt_free_summary(s);
+            } else {
+                rcopt_free_summary(info->summary);
+                info->summary = s;
+                changed = 1;
+            }
+        }
+    }
+    if (!changed) return;
+
+    /* No fixpoint: keep what is monotone, drop the returned parameter */
+    for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+        Value* sym = car(car(b));
+        RCOptInfo* info = (sym && val_tag(sym) == T_SYM) ? rcopt_find_var(ctx, sym->s) : NULL;
+        if (info && info->summary) info->summary->returns_param = -1;
+    }
+}
+
+/* -- Walk hooks -- */
+
+RCOptSummary* rcopt_begin_binding(RCOptContext* ctx, Value* val) {
+    if (!ctx || !is_lambda(val)) return NULL;
+    RCOptSummary* s = rcopt_summarize_lambda(ctx, val);
+    ctx->pending = s;
+    ctx->pending_lambda = val;
+    return s;
+}
+
+int rcopt_enter_lambda(RCOptContext* ctx, Value* lambda) {
+    RCOptSummary* s = NULL;
+    if (ctx->pending_lambda == lambda) {
+        s = ctx->pending;
+        ctx->pending = NULL;
+        ctx->pending_lambda = NULL;
+    }
+
+    /* Parameters are borrowed unless the summary says the function
+     * consumes them, and only visible in the body */
+    int scoped = rcopt_push_scope(ctx);
+    int i = 0;
+    for (Value* params = car(cdr(lambda)); !is_nil(params) && val_tag(params) == T_CELL; params = cdr(params), i++) {
+        Value* param = car(params);
+        if (!param || val_tag(param) != T_SYM) continue;
+        if (s && i < s->param_count && s->params[i] == RC_PARAM_CONSUMED) {
+            RCOptInfo* owned = rcopt_define_var(ctx, param->s);
+            if (owned) owned->is_unique = 0;
+        } else {
+            rcopt_define_borrowed(ctx, param->s);
+        }
+    }
+    return scoped;
+}
+
+/* The argument a summarized call returns as is, if it is a variable */
+static Value* returned_arg(RCOptSummary* s, Value* args) {
+    if (!s || s->returns_param < 0) return NULL;
+    for (int i = 0; i < s->returns_param && !is_nil(args) && val_tag(args) == T_CELL; i++) args = cdr(args);
+    if (is_nil(args) || val_tag(args) != T_CELL) return NULL;
+    Value* arg = car(args);
+    return (arg && val_tag(arg) == T_SYM) ? arg : NULL;
+}
+
+void rcopt_bind(RCOptContext* ctx, Value* sym, Value* val, RCOptSummary* summary) {
+    if (ctx && ctx->pending == summary) {
+        ctx->pending = NULL;
+        ctx->pending_lambda = NULL;
+    }
+    if (!ctx || !sym || val_tag(sym) != T_SYM) {
+        rcopt_free_summary(summary);
+        return;
+    }
+
+    RCOptInfo* info;
+    RCOptSummary* callee = NULL;
+    if (val && val_tag(val) == T_CELL && car(val) && val_tag(car(val)) == T_SYM) {
+        callee = rcopt_find_summary(ctx, car(val)->s);
+    }
+    Value* same = returned_arg(callee, cdr(val));
+    if (val && val_tag(val) == T_SYM) {
+        /* Value is a variable - creates alias */
+        info = rcopt_define_alias(ctx, sym->s, val->s);
+    } else if (same) {
+        /* The call hands back its argument */
+        info = rcopt_define_alias(ctx, sym->s, same->s);
+    } else {
+        /* Fresh allocation, unless a summarized callee says otherwise */
+        info = rcopt_define_var(ctx, sym->s);
+        if (info && callee && !callee->returns_unique) info->is_unique = 0;
+    }
+
+    if (info) info->summary = summary;
+    else rcopt_free_summary(summary);
+}
+
+void rcopt_note_call(RCOptContext* ctx, Value* op, Value* args) {
+    if (!ctx || !op || val_tag(op) != T_SYM) return;
+    RCOptSummary* s = rcopt_find_summary(ctx, op->s);
+    if (!s) return;
+    int i = 0;
+    for (; !is_nil(args) && val_tag(args) == T_CELL; args = cdr(args), i++) {
+        Value* arg = car(args);
+        if (!arg || val_tag(arg) != T_SYM) continue;
+        if (i < s->param_count && s->params[i] == RC_PARAM_BORROWED) continue;
+        RCOptInfo* info = rcopt_find_var(ctx, arg->s);
+        if (info) info->consumed_at = info->last_used_at;
+    }
+}
+
+RCOptimization rcopt_get_call_arg(RCOptContext* ctx, const char* fn, int index) {
+    RCOptSummary* s = (ctx && fn) ? rcopt_find_summary(ctx, fn) : NULL;
+    if (!s || index < 0 || index >= s->param_count || s->params[index] != RC_PARAM_BORROWED) {
+        return RC_OPT_NONE;
+    }
+    ctx->eliminated++;
+    return RC_OPT_ELIDE_INC;
+}
+
 /* Analyze expression for RC optimization */
 void rcopt_analyze_expr(RCOptContext* ctx, Value* expr) {
     if (!ctx || !expr || is_nil(expr)) return;
 
-    switch (expr->tag) {
+    switch (val_tag(expr)) {
         case T_INT:
         case T_NIL:
             /* Literals - no RC tracking needed */
@@ -293,32 +803,19 @@ void rcopt_analyze_expr(RCOptContext* ctx, Value* expr) {
             Value* op = car(expr);
             Value* args = cdr(expr);
 
-            if (op && op->tag == T_SYM) {
+            if (op && val_tag(op) == T_SYM) {
                 /* LET binding */
                 if (strcmp(op->s, "let") == 0) {
                     Value* bindings = car(args);
                     Value* body = car(cdr(args));
 
-                    /* Process bindings */
-                    while (!is_nil(bindings) && bindings->tag == T_CELL) {
+                    /* Process bindings: value first, then the name */
+                    while (!is_nil(bindings) && val_tag(bindings) == T_CELL) {
                         Value* bind = car(bindings);
-                        Value* sym = car(bind);
                         Value* val_expr = car(cdr(bind));
-
-                        /* Analyze value expression first */
+                        RCOptSummary* summary = rcopt_begin_binding(ctx, val_expr);
                         rcopt_analyze_expr(ctx, val_expr);
-
-                        /* Define variable */
-                        if (sym && sym->tag == T_SYM) {
-                            if (val_expr && val_expr->tag == T_SYM) {
-                                /* Value is a variable - creates alias */
-                                rcopt_define_alias(ctx, sym->s, val_expr->s);
-                            } else {
-                                /* Fresh allocation */
-                                rcopt_define_var(ctx, sym->s);
-                            }
-                        }
-
+                        rcopt_bind(ctx, car(bind), val_expr, summary);
                         bindings = cdr(bindings);
                     }
 
@@ -327,6 +824,28 @@ void rcopt_analyze_expr(RCOptContext* ctx, Value* expr) {
                     return;
                 }
 
+                /* LETREC: every name, then the group's summaries, then
+                 * the values (closures, so fresh) and the body */
+                if (strcmp(op->s, "letrec") == 0) {
+                    Value* bindings = car(args);
+                    for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+                        Value* sym = car(car(b));
+                        if (sym && val_tag(sym) == T_SYM) rcopt_define_var(ctx, sym->s);
+                    }
+                    summarize_group(ctx, bindings);
+                    for (Value* b = bindings; !is_nil(b) && val_tag(b) == T_CELL; b = cdr(b)) {
+                        Value* sym = car(car(b));
+                        Value* val_expr = car(cdr(car(b)));
+                        if (sym && val_tag(sym) == T_SYM && is_lambda(val_expr)) {
+                            ctx->pending = rcopt_find_summary(ctx, sym->s);
+                            ctx->pending_lambda = val_expr;
+                        }
+                        rcopt_analyze_expr(ctx, val_expr);
+                    }
+                    rcopt_analyze_expr(ctx, car(cdr(args)));
+                    return;
+                }
+
                 /* SET! */
                 if (strcmp(op->s, "set!") == 0) {
                     Value* target = car(args);
@@ -335,7 +854,7 @@ void rcopt_analyze_expr(RCOptContext* ctx, Value* expr) {
                     rcopt_analyze_expr(ctx, value);
 
                     /* set! creates an alias */
-                    if (target && target->tag == T_SYM && value && value->tag == T_SYM) {
+                    if (target && val_tag(target) == T_SYM && value && val_tag(value) == T_SYM) {
                         rcopt_define_alias(ctx, target->s, value->s);
                     }
                     return;
@@ -343,30 +862,22 @@ void rcopt_analyze_expr(RCOptContext* ctx, Value* expr) {
 
                 /* LAMBDA */
                 if (strcmp(op->s, "lambda") == 0) {
-                    Value* params = car(args);
-                    Value* body = car(cdr(args));
-
-                    /* Parameters are borrowed */
-                    while (!is_nil(params) && params->tag == T_CELL) {
-                        Value* param = car(params);
-                        if (param && param->tag == T_SYM) {
-                            rcopt_define_borrowed(ctx, param->s);
-                        }
-                        params = cdr(params);
-                    }
-
-                    /* Analyze body */
-                    rcopt_analyze_expr(ctx, body);
+                    int scoped = rcopt_enter_lambda(ctx, expr);
+                    rcopt_analyze_expr(ctx, car(cdr(args)));
+                    if (scoped) rcopt_pop_scope(ctx);
                     return;
                 }
             }
 
-            /* Default: analyze all subexpressions */
+            /* Default: analyze all subexpressions, then what the call
+             * does with its arguments */
             rcopt_analyze_expr(ctx, op);
-            while (!is_nil(args) && args->tag == T_CELL) {
-                rcopt_analyze_expr(ctx, car(args));
-                args = cdr(args);
+            Value* rest = args;
+            while (!is_nil(rest) && val_tag(rest) == T_CELL) {
+                rcopt_analyze_expr(ctx, car(rest));
+                rest = cdr(rest);
             }
+            rcopt_note_call(ctx, op, args);
             break;
         }
 
@@ -383,15 +894,8 @@ void rcopt_get_stats(RCOptContext* ctx, int* total, int* eliminated) {
         return;
     }
 
-    /* Count total variables (assume 2 RC ops per var: inc + dec) */
-    int count = 0;
-    RCOptInfo* info = ctx->vars;
-    while (info) {
-        count++;
-        info = info->next;
-    }
-
-    if (total) *total = count * 2;
+    /* Total variables (assume 2 RC ops per var: inc + dec) */
+    if (total) *total = ctx->defined * 2;
     if (eliminated) *eliminated = ctx->eliminated;
 }
 
@@ -15,6 +15,7 @@
 #define RCOPT_H
 
 #include "../types.h"
+#include "../util/symindex.h"
 
 /* RC Optimization types */
 typedef enum {
@@ -26,6 +27,20 @@ typedef enum {
     RC_OPT_ELIDE_ALL       /* Eliminate all RC ops (unique + owned) */
 } RCOptimization;
 
+/* How a function treats one of its parameters */
+typedef enum {
+    RC_PARAM_BORROWED = 0, /* Only read: the caller keeps ownership */
+    RC_PARAM_CONSUMED      /* Stored, captured or returned: ownership moves to the callee */
+} RCParamMode;
+
+/* Per-function summary, for RC optimization across calls */
+typedef struct RCOptSummary {
+    int param_count;
+    RCParamMode* params;
+    int returns_unique;    /* Result is always a fresh allocation */
+    int returns_param;     /* Parameter every path returns as is, or -1 */
+} RCOptSummary;
+
 /* RC optimization info for a variable */
 typedef struct RCOptInfo {
     char* var_name;
@@ -37,14 +52,24 @@ typedef struct RCOptInfo {
     char** aliases;        /* List of other variables that alias this one */
     int alias_count;
     int alias_capacity;
+    int consumed_at;       /* Point where a call took ownership, or 0 */
+    RCOptSummary* summary; /* Bound to a lambda: its summary (owned) */
+    struct RCOptInfo* shadowed;  /* Outer binding of the same name */
     struct RCOptInfo* next;
 } RCOptInfo;
 
 /* RC optimization context */
 typedef struct RCOptContext {
-    RCOptInfo* vars;       /* Linked list of variable info */
+    RCOptInfo* vars;       /* Linked list of variable info, newest first */
+    SymIndex index;        /* Name -> innermost RCOptInfo */
+    RCOptInfo** scopes;    /* vars at each open scope's push */
+    int scope_depth;
+    int scope_capacity;
+    int defined;           /* Variables defined, including popped ones */
     int current_point;     /* Current program point counter */
     int eliminated;        /* Count of eliminated RC operations */
+    RCOptSummary* pending; /* Summary for the lambda being bound (not owned) */
+    Value* pending_lambda;
 } RCOptContext;
 
 /* Create/destroy context */
@@ -56,6 +81,11 @@ RCOptInfo* rcopt_define_var(RCOptContext* ctx, const char* name);
 RCOptInfo* rcopt_define_alias(RCOptContext* ctx, const char* name, const char* alias_of);
 RCOptInfo* rcopt_define_borrowed(RCOptContext* ctx, const char* name);
 
+/* Scopes: pop frees the variables defined since the matching push and
+ * makes the names they shadowed visible again (0 on OOM) */
+int rcopt_push_scope(RCOptContext* ctx);
+void rcopt_pop_scope(RCOptContext* ctx);
+
 /* Mark variable usage */
 void rcopt_mark_used(RCOptContext* ctx, const char* name);
 
@@ -69,6 +99,26 @@ const char* rcopt_get_free_function(RCOptContext* ctx, const char* name, int sha
 /* Analyze expression for RC optimization */
 void rcopt_analyze_expr(RCOptContext* ctx, Value* expr);
 
+/* Walk hooks, shared by rcopt_analyze_expr and the fused pipeline:
+ * begin_binding summarizes a lambda value before it is analyzed (NULL
+ * for other values), enter_lambda scopes the parameters of a lambda by
+ * its summary and returns whether a scope was pushed, bind defines the
+ * name once the value is analyzed (taking the summary), and note_call
+ * records arguments a summarized callee consumes */
+RCOptSummary* rcopt_begin_binding(RCOptContext* ctx, Value* val);
+int rcopt_enter_lambda(RCOptContext* ctx, Value* lambda);
+void rcopt_bind(RCOptContext* ctx, Value* sym, Value* val, RCOptSummary* summary);
+void rcopt_note_call(RCOptContext* ctx, Value* op, Value* args);
+
+/* Interprocedural summaries: computed against the summaries of the
+ * callees in scope; letrec groups are iterated to a fixpoint */
+RCOptSummary* rcopt_summarize_lambda(RCOptContext* ctx, Value* lambda);
+RCOptSummary* rcopt_find_summary(RCOptContext* ctx, const char* fn);
+void rcopt_free_summary(RCOptSummary* summary);
+
+/* Passing an argument: RC_OPT_ELIDE_INC when fn only borrows it */
+RCOptimization rcopt_get_call_arg(RCOptContext* ctx, const char* fn, int index);
+
 /* Get statistics */
 void rcopt_get_stats(RCOptContext* ctx, int* total, int* eliminated);
 
@@ -0,0 +1,92 @@
+#include "report.h"
+#include "../util/dstring.h"
+#include <pthread.h>
+
+// Records so far, each a JSON object ending in ",\n"; NULL while off
+static DString* records = NULL;
+static pthread_mutex_t records_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void report_enable(int on) {
+    pthread_mutex_lock(&records_lock);
+    if (records) ds_free(records);
+    records = on ? ds_new() : NULL;
+    pthread_mutex_unlock(&records_lock);
+}
+
+int report_enabled(void) {
+    return records != NULL;
+}
+
+static void append_json_string(DString* ds, const char* s) {
+    if (!s) {
+        ds_append(ds, "null");
+        return;
+    }
+    ds_append_char(ds, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            ds_append_char(ds, '\\');
+            ds_append_char(ds, (char)c);
+        } else if (c < 0x20) {
+            ds_printf(ds, "\\u%04x", c);
+        } else {
+            ds_append_char(ds, (char)c);
+        }
+    }
+    ds_append_char(ds, '"');
+}
+
+static const char* escape_name(EscapeClass e) {
+    switch (e) {
+        case ESCAPE_ARG: return "arg";
+        case ESCAPE_GLOBAL: return "global";
+        default: return "none";
+    }
+}
+
+void report_binding(const DecisionRecord* r) {
+    DString* rec = ds_new();
+    if (!rec) return;
+    ds_append(rec, "    {\"name\": ");
+    append_json_string(rec, r->name);
+    if (r->pos.line > 0) {
+        ds_printf(rec, ", \"line\": %d, \"col\": %d", r->pos.line, r->pos.col);
+    } else {
+        ds_append(rec, ", \"line\": null, \"col\": null");
+    }
+    ds_printf(rec, ", \"shape\": \"%s\", \"escape\": \"%s\", \"rc\": \"%s\"",
+              shape_to_string(r->shape), escape_name(r->escape), rcopt_string(r->rc));
+    ds_printf(rec, ", \"alloc\": \"%s\", \"dps\": \"%s\", \"freeze_point\": %s",
+              r->reused ? "reused" : r->dps != DPS_NONE ? "destination" : "heap",
+              dps_class_name(r->dps), r->freeze_point ? "true" : "false");
+    ds_append(rec, ", \"free\": ");
+    append_json_string(rec, r->free_fn);
+    ds_append(rec, ", \"reason\": ");
+    append_json_string(rec, r->reason);
+    ds_append(rec, "},\n");
+
+    pthread_mutex_lock(&records_lock);
+    if (records) ds_append(records, ds_cstr(rec));
+    pthread_mutex_unlock(&records_lock);
+    ds_free(rec);
+}
+
+int report_write(FILE* out, const char* source) {
+    DString* doc = ds_new();
+    if (!doc) return 0;
+    ds_append(doc, "{\"source\": ");
+    append_json_string(doc, source);
+    ds_append(doc, ",\n  \"bindings\": [\n");
+    pthread_mutex_lock(&records_lock);
+    if (records && ds_len(records) > 0) {
+        // Drop the last record's separator
+        ds_append_len(doc, ds_cstr(records), ds_len(records) - 2);
+        ds_append_char(doc, '\n');
+    }
+    pthread_mutex_unlock(&records_lock);
+    ds_append(doc, "  ]}\n");
+    int ok = fputs(ds_cstr(doc), out) >= 0 && fflush(out) == 0;
+    ds_free(doc);
+    return ok;
+}
@@ -0,0 +1,43 @@
+#ifndef PURPLE_REPORT_H
+#define PURPLE_REPORT_H
+
+#include <stdio.h>
+#include "../types.h"
+#include "../parser/parser.h"
+#include "escape.h"
+#include "shape.h"
+#include "rcopt.h"
+#include "dps.h"
+
+// -- Decision Report --
+// Why each let binding the compiler emitted is freed the way it is: the
+// verdicts of the analyses (shape, escape, RC optimization, DPS, freeze
+// points) next to the allocation and free they led to. Collected while
+// enabled and written as JSON (--report), one record per binding keyed
+// to its source position, in the order the bindings were compiled.
+
+typedef struct DecisionRecord {
+    const char* name;
+    SourcePos pos;            // The (name value) form; line 0 if unknown
+    Shape shape;
+    EscapeClass escape;
+    RCOptimization rc;        // rcopt_get_dec_ref for the binding
+    DPSClass dps;             // DPS_NONE unless it went in a destination
+    int reused;               // Its cell was rebuilt in place (FBIP)
+    int freeze_point;         // Cyclic and never set! after construction
+    const char* free_fn;      // Free emitted for it, NULL if none
+    const char* reason;       // Why that free (or none)
+} DecisionRecord;
+
+// Start collecting into an empty report, or stop and drop it
+void report_enable(int on);
+int report_enabled(void);
+
+// Add one binding (safe from any thread)
+void report_binding(const DecisionRecord* r);
+
+// Write what was collected; source names the input ("-" for stdin).
+// 0 on a write error
+int report_write(FILE* out, const char* source);
+
+#endif // PURPLE_REPORT_H
@@ -0,0 +1,127 @@
+#include "reuse.h"
+#include <string.h>
+
+// Operators whose result is a new integer, whatever their arguments
+static const char* const FRESH_OPS[] = {
+    "+", "-", "*", "/", "%", "=", "<", ">", "<=", ">=", "not", NULL
+};
+
+static int is_sym(Value* e, const char* name) {
+    return e && val_tag(e) == T_SYM && strcmp(e->s, name) == 0;
+}
+
+static int is_form(Value* e, const char* op) {
+    return e && val_tag(e) == T_CELL && is_sym(car(e), op);
+}
+
+// (acc var), exactly
+static int is_access(Value* e, const char* acc, const char* var) {
+    if (!is_form(e, acc)) return 0;
+    Value* args = cdr(e);
+    return val_tag(args) == T_CELL && is_sym(car(args), var) && is_nil(cdr(args));
+}
+
+// var only occurs as (car var) or (cdr var) in e
+static int only_accessed(Value* e, const char* var) {
+    if (!e || is_nil(e)) return 1;
+    if (val_tag(e) == T_SYM) return strcmp(e->s, var) != 0;
+    if (val_tag(e) != T_CELL) return 1;
+    if (is_access(e, "car", var) || is_access(e, "cdr", var)) return 1;
+    if (is_form(e, "quote")) return 1;
+    for (; val_tag(e) == T_CELL; e = cdr(e)) {
+        if (!only_accessed(car(e), var)) return 0;
+    }
+    return is_nil(e) || only_accessed(e, var);
+}
+
+static int fresh_op(Value* e) {
+    if (!e || val_tag(e) != T_CELL || !car(e) || val_tag(car(e)) != T_SYM) return 0;
+    for (int i = 0; FRESH_OPS[i]; i++) {
+        if (strcmp(car(e)->s, FRESH_OPS[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// How the new field `e` relates to var's old fields (-1: not reusable).
+// A fresh value must be unable to share an old child, which could be
+// anything the binding's value referenced: only integers qualify.
+static int classify(Value* e, int field, const char* var) {
+    static const char* const acc[2] = { "car", "cdr" };
+    if (is_access(e, acc[field], var)) return REUSE_KEEP;
+    if (is_access(e, acc[1 - field], var)) return REUSE_SWAP;
+    if (e && val_tag(e) == T_INT) return REUSE_FRESH;
+    if (fresh_op(e) && only_accessed(e, var)) return REUSE_FRESH;
+    return -1;
+}
+
+// The names the in-place rewrite relies on are not rebound here
+static int rebinds_builtins(Value* bindings) {
+    for (; val_tag(bindings) == T_CELL; bindings = cdr(bindings)) {
+        Value* bind = car(bindings);
+        Value* sym = val_tag(bind) == T_CELL ? car(bind) : bind;
+        if (is_sym(sym, "cons") || is_sym(sym, "car") || is_sym(sym, "cdr")) return 1;
+    }
+    return 0;
+}
+
+// var occurs anywhere in e outside quote
+static int mentions(Value* e, const char* var) {
+    if (!e || is_nil(e)) return 0;
+    if (val_tag(e) == T_SYM) return strcmp(e->s, var) == 0;
+    if (val_tag(e) != T_CELL || is_form(e, "quote")) return 0;
+    for (; val_tag(e) == T_CELL; e = cdr(e)) {
+        if (mentions(car(e), var)) return 1;
+    }
+    return mentions(e, var);
+}
+
+// Some other binding's value mentions var, so it may share x or a child
+static int aliased_by_binding(Value* bindings, Value* self, const char* var) {
+    for (; val_tag(bindings) == T_CELL; bindings = cdr(bindings)) {
+        Value* bind = car(bindings);
+        if (bind == self || val_tag(bind) != T_CELL || val_tag(cdr(bind)) != T_CELL) continue;
+        if (mentions(car(cdr(bind)), var)) return 1;
+    }
+    return 0;
+}
+
+int find_inplace_reuse(Value* let_form, ReuseMatch* match) {
+    if (!is_form(let_form, "let") || !match) return 0;
+    Value* args = cdr(let_form);
+    if (val_tag(args) != T_CELL || val_tag(cdr(args)) != T_CELL) return 0;
+    Value* bindings = car(args);
+    Value* body = car(cdr(args));
+
+    // The body must be exactly (cons A B)
+    if (!is_form(body, "cons") || rebinds_builtins(bindings)) return 0;
+    Value* fields = cdr(body);
+    if (val_tag(fields) != T_CELL || val_tag(cdr(fields)) != T_CELL || !is_nil(cdr(cdr(fields)))) return 0;
+    Value* a = car(fields);
+    Value* b = car(cdr(fields));
+
+    for (Value* bs = bindings; val_tag(bs) == T_CELL; bs = cdr(bs)) {
+        Value* bind = car(bs);
+        if (val_tag(bind) != T_CELL || !car(bind) || val_tag(car(bind)) != T_SYM) continue;
+        // Only a cell this let allocated is known to be unshared
+        if (val_tag(cdr(bind)) != T_CELL || !is_form(car(cdr(bind)), "cons")) continue;
+        const char* var = car(bind)->s;
+        if (aliased_by_binding(bindings, bind, var)) continue;
+
+        int ka = classify(a, 0, var);
+        int kb = classify(b, 1, var);
+        if (ka < 0 || kb < 0) continue;
+        // An old child carried into both fields would be shared
+        if ((ka == REUSE_KEEP && kb == REUSE_SWAP) || (ka == REUSE_SWAP && kb == REUSE_KEEP)) continue;
+
+        match->var = car(bind);
+        match->fields[0] = a;
+        match->fields[1] = b;
+        match->kind[0] = (ReuseField)ka;
+        match->kind[1] = (ReuseField)kb;
+        // Old car is carried by a kept car or a swapped cdr, and vice versa
+        match->release[0] = ka != REUSE_KEEP && kb != REUSE_SWAP;
+        match->release[1] = kb != REUSE_KEEP && ka != REUSE_SWAP;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef PURPLE_REUSE_H
+#define PURPLE_REUSE_H
+
+#include "../types.h"
+
+// -- FBIP In-Place Reuse --
+// Koka's "functional but in-place": a let whose body rebuilds one of its
+// own fresh cells, (cons A B) over a binding x that is only read through
+// (car x) and (cdr x), can write the new fields into x instead of
+// allocating. x is then provably unique at compile time, so the generated
+// code needs no RC check, and a field that keeps the old child is not
+// written or released at all.
+
+typedef enum {
+    REUSE_KEEP,    // The old field as is: (car x) for car, (cdr x) for cdr
+    REUSE_SWAP,    // The other old field
+    REUSE_FRESH    // New value that cannot share an old child
+} ReuseField;
+
+typedef struct ReuseMatch {
+    Value* var;          // The binding reused
+    Value* fields[2];    // New car and cdr expressions
+    ReuseField kind[2];
+    int release[2];      // Old car / cdr carried into neither field: drop it
+} ReuseMatch;
+
+// Find a binding of let_form its body can update in place (0: none)
+int find_inplace_reuse(Value* let_form, ReuseMatch* match);
+
+#endif // PURPLE_REUSE_H
@@ -22,6 +22,7 @@ ShapeContext* mk_shape_context(void) {
     ShapeContext* ctx = malloc(sizeof(ShapeContext));
     if (!ctx) return NULL;
     ctx->shapes = NULL;
+    symindex_init(&ctx->index);
     ctx->changed = 0;
     ctx->next_alias_group = 1;
     ctx->result_shape = SHAPE_UNKNOWN;
@@ -37,17 +38,13 @@ void free_shape_context(ShapeContext* ctx) {
         free(s);
         s = next;
     }
+    symindex_destroy(&ctx->index);
     free(ctx);
 }
 
 ShapeInfo* find_shape(ShapeContext* ctx, const char* name) {
     if (!ctx || !name) return NULL;
-    ShapeInfo* s = ctx->shapes;
-    while (s) {
-        if (strcmp(s->var_name, name) == 0) return s;
-        s = s->next;
-    }
-    return NULL;
+    return symindex_get(&ctx->index, name);
 }
 
 void add_shape(ShapeContext* ctx, const char* name, Shape shape) {
@@ -71,18 +68,23 @@ void add_shape(ShapeContext* ctx, const char* name, Shape shape) {
     s->shape = shape;
     s->confidence = 100;
     s->alias_group = ctx->next_alias_group++;
+    if (!symindex_put(&ctx->index, s->var_name, s)) {
+        free(s->var_name);
+        free(s);
+        return;
+    }
     s->next = ctx->shapes;
     ctx->shapes = s;
 }
 
 Shape lookup_shape(ShapeContext* ctx, Value* expr) {
     if (!ctx || !expr) return SHAPE_UNKNOWN;
-    if (expr->tag == T_SYM) {
+    if (val_tag(expr) == T_SYM) {
         ShapeInfo* s = find_shape(ctx, expr->s);
         return s ? s->shape : SHAPE_UNKNOWN;
     }
     // Literals are always TREE (no sharing)
-    if (expr->tag == T_INT || expr->tag == T_NIL) {
+    if (val_tag(expr) == T_INT || val_tag(expr) == T_NIL) {
         return SHAPE_TREE;
     }
     return SHAPE_UNKNOWN;
@@ -91,16 +93,16 @@ Shape lookup_shape(ShapeContext* ctx, Value* expr) {
 int may_alias(ShapeContext* ctx, Value* a, Value* b) {
     if (!a || !b) return 0;
     // Same variable definitely aliases
-    if (a->tag == T_SYM && b->tag == T_SYM && a->s && b->s && strcmp(a->s, b->s) == 0) {
+    if (val_tag(a) == T_SYM && val_tag(b) == T_SYM && a->s && b->s && strcmp(a->s, b->s) == 0) {
         return 1;
     }
     // Different literals never alias
-    if ((a->tag == T_INT || a->tag == T_NIL) &&
-        (b->tag == T_INT || b->tag == T_NIL)) {
+    if ((val_tag(a) == T_INT || val_tag(a) == T_NIL) &&
+        (val_tag(b) == T_INT || val_tag(b) == T_NIL)) {
         return 0;
     }
     // Check alias groups if both are variables
-    if (a->tag == T_SYM && b->tag == T_SYM && a->s && b->s) {
+    if (val_tag(a) == T_SYM && val_tag(b) == T_SYM && a->s && b->s) {
         ShapeInfo* sa = find_shape(ctx, a->s);
         ShapeInfo* sb = find_shape(ctx, b->s);
         if (sa && sb && sa->alias_group == sb->alias_group) {
@@ -118,7 +120,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
         return;
     }
 
-    switch (expr->tag) {
+    switch (val_tag(expr)) {
         case T_INT:
         case T_NIL:
             ctx->result_shape = SHAPE_TREE;
@@ -134,7 +136,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
             Value* op = car(expr);
             Value* args = cdr(expr);
 
-            if (op && op->tag == T_SYM) {
+            if (op && val_tag(op) == T_SYM) {
                 // CONS creates tree structure (unless aliased args)
                 if (strcmp(op->s, "cons") == 0) {
                     Value* car_arg = car(args);
@@ -172,7 +174,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
                         Value* val_expr = car(cdr(bind));
 
                         analyze_shapes_expr(val_expr, ctx);
-                        if (sym && sym->tag == T_SYM) {
+                        if (sym && val_tag(sym) == T_SYM) {
                             add_shape(ctx, sym->s, ctx->result_shape);
                         }
 
@@ -193,7 +195,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
                     while (!is_nil(b)) {
                         Value* bind = car(b);
                         Value* sym = car(bind);
-                        if (sym && sym->tag == T_SYM) {
+                        if (sym && val_tag(sym) == T_SYM) {
                             add_shape(ctx, sym->s, SHAPE_CYCLIC);
                         }
                         b = cdr(b);
@@ -207,7 +209,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
                         Value* val_expr = car(cdr(bind));
 
                         analyze_shapes_expr(val_expr, ctx);
-                        if (sym && sym->tag == T_SYM) {
+                        if (sym && val_tag(sym) == T_SYM) {
                             add_shape(ctx, sym->s, ctx->result_shape);
                         }
 
@@ -221,7 +223,7 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
                 // SET! can create cycles
                 if (strcmp(op->s, "set!") == 0) {
                     Value* target = car(args);
-                    if (target && target->tag == T_SYM) {
+                    if (target && val_tag(target) == T_SYM) {
                         add_shape(ctx, target->s, SHAPE_CYCLIC);
                     }
                     ctx->result_shape = SHAPE_CYCLIC;
@@ -257,6 +259,13 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
                 }
             }
 
+            // Fresh results own all they hold
+            if (op && val_tag(op) == T_SYM && shape_fresh_tree_call(op->s)) {
+                for (; !is_nil(args); args = cdr(args)) analyze_shapes_expr(car(args), ctx);
+                ctx->result_shape = SHAPE_TREE;
+                return;
+            }
+
             // Default: analyze all subexpressions and join their shapes
             Shape result = SHAPE_UNKNOWN;
             analyze_shapes_expr(op, ctx);
@@ -277,6 +286,17 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx) {
     }
 }
 
+int shape_fresh_tree_call(const char* name) {
+    static const char* const fresh[] = {
+        "vector", "make-vector", "list->vector", "vector-map", "vector-filter", "vector-add", NULL
+    };
+    if (!name) return 0;
+    for (int i = 0; fresh[i]; i++) {
+        if (strcmp(fresh[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
 const char* shape_free_strategy(Shape s) {
     switch (s) {
         case SHAPE_TREE: return "free_tree";
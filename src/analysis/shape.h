@@ -2,6 +2,7 @@
 #define PURPLE_SHAPE_H
 
 #include "../types.h"
+#include "../util/symindex.h"
 
 // -- Phase 2: Shape Analysis (Ghiya-Hendren) --
 // Classifies pointers as TREE/DAG/CYCLIC at compile time
@@ -22,7 +23,8 @@ typedef struct ShapeInfo {
 } ShapeInfo;
 
 typedef struct ShapeContext {
-    ShapeInfo* shapes;
+    ShapeInfo* shapes;   // Newest first
+    SymIndex index;      // Name -> ShapeInfo
     int changed;         // For fixpoint iteration
     int next_alias_group;
     Shape result_shape;  // Shape of last expression result
@@ -48,4 +50,8 @@ void analyze_shapes_expr(Value* expr, ShapeContext* ctx);
 // Get shape-based free strategy
 const char* shape_free_strategy(Shape s);
 
+// A primitive whose result is always fresh and shares nothing with its
+// arguments (the vector constructors and bulk operations): TREE
+int shape_fresh_tree_call(const char* name);
+
 #endif // PURPLE_SHAPE_H
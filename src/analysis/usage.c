@@ -0,0 +1,87 @@
+#define _POSIX_C_SOURCE 200809L
+#include "usage.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Sections each section calls into. Everything builds on the Obj core;
+// the core's weak-ref hook is stubbed out when RT_WEAK is absent.
+static const struct {
+    RuntimeFeature feature;
+    unsigned needs;
+} RUNTIME_DEPS[] = {
+    { RT_WEAK,       RT_CORE },
+    { RT_PERCEUS,    RT_CORE },
+    { RT_SCC,        RT_CORE },
+    { RT_DEFERRED,   RT_CORE },
+    { RT_ARENA,      RT_CORE },
+    { RT_DPS,        RT_CORE },
+    { RT_EXCEPTION,  RT_CORE },
+    { RT_CONCURRENT, RT_CORE },
+    { RT_SCANNER,    RT_CORE },
+    { RT_VECTOR,     RT_CORE },
+};
+
+unsigned runtime_with_deps(unsigned features) {
+    unsigned prev;
+    do {
+        prev = features;
+        for (size_t i = 0; i < sizeof(RUNTIME_DEPS) / sizeof(RUNTIME_DEPS[0]); i++) {
+            if (features & RUNTIME_DEPS[i].feature) features |= RUNTIME_DEPS[i].needs;
+        }
+    } while (features != prev);
+    return features;
+}
+
+// What a symbol occurring anywhere in the program can pull into the output.
+// Quoted data counts too: run and EM evaluate it.
+static unsigned symbol_features(const char* s) {
+    if (strcmp(s, "lift") == 0) return RT_CORE;
+    // Shape analysis marks letrec and set! bindings CYCLIC -> deferred_release
+    if (strcmp(s, "letrec") == 0 || strcmp(s, "set!") == 0) return RT_DEFERRED;
+    if (strcmp(s, "scan") == 0) return RT_SCANNER;
+    // vector, make-vector, vector-map, list->vector, ...
+    if (strstr(s, "vector")) return RT_VECTOR;
+    // Programs read at run time are unknown: keep everything
+    if (strcmp(s, "read") == 0) return RT_ALL;
+    return 0;
+}
+
+unsigned analyze_runtime_usage(Value* expr) {
+    unsigned features = 0;
+
+    // Explicit stack: programs can nest deeper than the C stack allows
+    size_t cap = 64;
+    size_t top = 0;
+    Value** stack = malloc(cap * sizeof(Value*));
+    if (!stack) return RT_ALL;
+    stack[top++] = expr;
+
+    while (top > 0) {
+        Value* v = stack[--top];
+        while (v && val_tag(v) == T_CELL) {
+            Value* head = v->cell.car;
+            if (head && val_tag(head) == T_CELL) {
+                if (top == cap) {
+                    Value** grown = realloc(stack, cap * 2 * sizeof(Value*));
+                    if (!grown) {
+                        free(stack);
+                        return RT_ALL;
+                    }
+                    stack = grown;
+                    cap *= 2;
+                }
+                stack[top++] = head;
+            } else if (head && val_tag(head) == T_SYM && head->s) {
+                features |= symbol_features(head->s);
+            }
+            v = v->cell.cdr;
+        }
+        if (v && val_tag(v) == T_SYM && v->s) features |= symbol_features(v->s);
+    }
+    free(stack);
+
+    // Code only originates from lift and scan; without them the output
+    // is just the result comment
+    if (!(features & (RT_CORE | RT_SCANNER))) return 0;
+    return runtime_with_deps(features);
+}
@@ -0,0 +1,31 @@
+#ifndef PURPLE_USAGE_H
+#define PURPLE_USAGE_H
+
+#include "../types.h"
+
+// -- Runtime Feature Usage --
+// Decides which generated runtime sections a program can reach, so the
+// emitter leaves the rest out of the translation unit.
+
+typedef enum {
+    RT_CORE       = 1 << 0,   // Obj, slab allocator, RC/free primitives, arithmetic
+    RT_WEAK       = 1 << 1,   // Weak reference registry
+    RT_PERCEUS    = 1 << 2,   // try_reuse / reuse_as_*
+    RT_SCC        = 1 << 3,   // Tarjan SCC freezing
+    RT_DEFERRED   = 1 << 4,   // Deferred RC for cyclic shapes
+    RT_ARENA      = 1 << 5,
+    RT_DPS        = 1 << 6,   // Destination-passing helpers
+    RT_EXCEPTION  = 1 << 7,   // Landing pads and cleanup frames
+    RT_CONCURRENT = 1 << 8,   // Atomic RC, channels, threads
+    RT_SCANNER    = 1 << 9,   // ASAP scanner for List
+    RT_VECTOR     = 1 << 10,  // Unboxed vectors and their bulk primitives
+    RT_ALL        = (1 << 11) - 1
+} RuntimeFeature;
+
+// Sections the program may need, closed over section dependencies
+unsigned analyze_runtime_usage(Value* expr);
+
+// Add every section the given ones depend on
+unsigned runtime_with_deps(unsigned features);
+
+#endif // PURPLE_USAGE_H
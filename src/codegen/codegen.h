@@ -4,6 +4,8 @@
 #include "../types.h"
 #include "../analysis/shape.h"
 #include "../analysis/escape.h"
+#include "../analysis/liveness.h"
+#include "../util/dstring.h"
 
 // -- Code Generation --
 
@@ -11,6 +13,16 @@
 Value* emit_c_call(const char* fn, Value* a, Value* b);
 Value* lift_value(Value* v);
 char* val_to_c_expr(Value* v);
+// v as code: lifted code itself, or its C expression (NULL if none)
+Value* code_of(Value* v);
+// Append v's C expression to ds (0 if v has none, leaving ds partial)
+int val_write_c(DString* ds, Value* v);
+
+// deftype records: the pair chain for a field list, and the constant
+// access path of field `slot` in a record of field_count fields
+// (the last field is the cdr of the last pair); see is_record
+char* record_to_c_expr(Value* fields);
+void record_field_path(CodeBuilder* cb, Value* obj, int slot, int field_count);
 
 // ASAP scanner generation
 void gen_asap_scanner(const char* type_name, int is_list);
@@ -63,6 +75,7 @@ void analyze_back_edges(void);
 void gen_struct_def(TypeDef* t);
 void gen_release_func(TypeDef* t);
 void gen_weak_ref_runtime(void);
+void gen_weak_ref_stub(void);      // No-op invalidation hook when weak refs are unused
 
 // Perceus reuse
 typedef struct ReusePair {
@@ -75,17 +88,19 @@ typedef struct ReusePair {
 void gen_perceus_runtime(void);
 void gen_reuse_alloc(ReusePair* pair, char* buf, int buf_size);
 
-// NLL free point generation
-typedef struct FreePoint {
-    char* var_name;
-    int node_id;
-    int is_conditional;
-    struct FreePoint* next;
-} FreePoint;
-
+// NLL free point generation (FreePoint from liveness.h)
 void gen_nll_free(FreePoint* fp, char* buf, int buf_size);
 
 // Runtime header generation
-void gen_runtime_header(void);
+void gen_runtime_banner(void);     // Banner and #includes only
+void gen_runtime_header(void);     // Banner + object layout + core runtime
+void gen_obj_layout(void);         // Obj struct and OBJ_* accessors
+void gen_core_runtime(void);       // Slab, free list and RC core
+void gen_arith_runtime(void);      // Primitives called by lifted code
+void gen_vector_runtime(void);     // Vectors and their bulk operations
+void gen_runtime_decls(void);      // purple_rt.h for the precompiled runtime
+void gen_stats_decls(void);        // PurpleStats and STAT_* (-DPURPLE_STATS)
+void gen_stats_sites(void);        // mk_int/mk_pair calls record their site
+void gen_stats_runtime(void);      // Counters and their JSON dump
 
 #endif // PURPLE_CODEGEN_H
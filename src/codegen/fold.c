@@ -0,0 +1,220 @@
+#include "fold.h"
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -- Int Primitives --
+// Compile-time twins of the runtime's long helpers (gen_arith_runtime)
+
+static long fold_add(long a, long b) {
+    if ((b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b)) return 0;
+    return a + b;
+}
+
+static long fold_sub(long a, long b) {
+    if ((b < 0 && a > LONG_MAX + b) || (b > 0 && a < LONG_MIN + b)) return 0;
+    return a - b;
+}
+
+static long fold_mul(long a, long b) {
+    if (a > 0 && b > 0 && a > LONG_MAX / b) return 0;
+    if (a > 0 && b < 0 && b < LONG_MIN / a) return 0;
+    if (a < 0 && b > 0 && a < LONG_MIN / b) return 0;
+    if (a < 0 && b < 0 && a < LONG_MAX / b) return 0;
+    return a * b;
+}
+
+static long fold_div(long a, long b) {
+    if (b == 0 || (a == LONG_MIN && b == -1)) return 0;
+    return a / b;
+}
+
+static long fold_mod(long a, long b) {
+    if (b == 0 || (a == LONG_MIN && b == -1)) return 0;
+    return a % b;
+}
+
+static long fold_eq(long a, long b) { return a == b; }
+static long fold_lt(long a, long b) { return a < b; }
+static long fold_gt(long a, long b) { return a > b; }
+static long fold_le(long a, long b) { return a <= b; }
+static long fold_ge(long a, long b) { return a >= b; }
+
+typedef struct IntOp {
+    const char* fn;       // Boxed runtime primitive
+    const char* helper;   // Unboxed long helper, or NULL for an infix operator
+    const char* infix;
+    long (*fold)(long, long);
+} IntOp;
+
+static const IntOp INT_OPS[] = {
+    { "add",    "add_l", NULL, fold_add },
+    { "sub",    "sub_l", NULL, fold_sub },
+    { "mul",    "mul_l", NULL, fold_mul },
+    { "div_op", "div_l", NULL, fold_div },
+    { "mod_op", "mod_l", NULL, fold_mod },
+    { "eq_op",  NULL,    "==", fold_eq },
+    { "lt_op",  NULL,    "<",  fold_lt },
+    { "gt_op",  NULL,    ">",  fold_gt },
+    { "le_op",  NULL,    "<=", fold_le },
+    { "ge_op",  NULL,    ">=", fold_ge },
+};
+
+static int find_int_op(const char* fn) {
+    for (size_t i = 0; i < sizeof(INT_OPS) / sizeof(INT_OPS[0]); i++) {
+        if (strcmp(INT_OPS[i].fn, fn) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// -- IR --
+
+// An identifier or a field path over one, (x)->a->b: cheap and pure, so
+// it can be tested for nil and then read
+static int is_pure_path(const char* s) {
+    if (!s || !*s) return 0;
+    char prev = '\0';
+    for (const char* p = s; *p; p++) {
+        char c = *p;
+        if (c == '(' && (isalnum((unsigned char)prev) || prev == '_')) return 0;  // A call
+        if (c == '-' && p[1] != '>') return 0;
+        if (!isalnum((unsigned char)c) && c != '_' && c != '(' && c != ')' && c != '-' && c != '>') return 0;
+        if (c == '>' && prev != '-') return 0;
+        prev = c;
+    }
+    return !isdigit((unsigned char)s[0]);
+}
+
+// Longer code is not a path worth unboxing, and is not flattened to
+// find out
+#define PATH_MAX_LEN 1024
+
+// The ir an operand contributes, or NULL if it has no int structure
+static Value* operand_ir(Value* v) {
+    if (!v) return NULL;
+    if (val_tag(v) == T_INT) return v;
+    if (val_tag(v) != T_CODE) return NULL;
+    if (v->ir) return v->ir;
+    return code_len(v) <= PATH_MAX_LEN && is_pure_path(code_text(v)) ? v : NULL;
+}
+
+// An op node is (op . ((a . b) . long)): long is its rendering as a long
+// expression, built once with the node and shared by every node above
+// it, so a chain renders in time linear in its length
+static Value* node_long(Value* ir) { return cdr(cdr(ir)); }
+
+static Value* render_long(Value* ir) {
+    if (val_tag(ir) != T_INT) return node_long(ir);
+    if (val_int(ir) == LONG_MIN) return mk_code("LONG_MIN");
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%ld", val_int(ir));
+    return mk_code(buf);
+}
+
+static void render_operand(CodeBuilder* cb, Value* ir) {
+    if (val_tag(ir) == T_CODE) {
+        cb_code(cb, ir);
+        cb_text(cb, "->i");
+    } else {
+        cb_code(cb, render_long(ir));
+    }
+}
+
+// An op node as a long; a nil leaf operand makes the whole step 0, as
+// the runtime primitive's NULL check does
+static Value* render_node(const IntOp* op, Value* a, Value* b) {
+    int guard_a = val_tag(a) == T_CODE;
+    int guard_b = val_tag(b) == T_CODE && !(guard_a && strcmp(code_text(a), code_text(b)) == 0);
+
+    CodeBuilder cb;
+    cb_init(&cb);
+    if (guard_a || guard_b) {
+        cb_text(&cb, "(");
+        if (guard_a) cb_code(&cb, a);
+        if (guard_a && guard_b) cb_text(&cb, " && ");
+        if (guard_b) cb_code(&cb, b);
+        cb_text(&cb, " ? ");
+    }
+    if (op->helper) {
+        cb_textf(&cb, "%s(", op->helper);
+        render_operand(&cb, a);
+        cb_text(&cb, ", ");
+        render_operand(&cb, b);
+        cb_text(&cb, ")");
+    } else {
+        cb_text(&cb, "(");
+        render_operand(&cb, a);
+        cb_textf(&cb, " %s ", op->infix);
+        render_operand(&cb, b);
+        cb_text(&cb, ")");
+    }
+    if (guard_a || guard_b) cb_text(&cb, " : 0)");
+    return cb_finish(&cb);
+}
+
+// Boxed code for an int ir: mk_int(<long expression>)
+static Value* code_for_ir(Value* ir) {
+    Value* lng = render_long(ir);
+    if (!lng) return NULL;
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "mk_int(");
+    cb_code(&cb, lng);
+    cb_text(&cb, ")");
+    Value* code = cb_finish(&cb);
+    if (code) code->ir = ir;
+    return code;
+}
+
+Value* lift_int(long i) {
+    return code_for_ir(mk_int(i));
+}
+
+Value* lift_long(Value* lng) {
+    if (!lng || val_tag(lng) != T_CODE) return NULL;
+    Value* node = mk_cell(mk_int(-1), mk_cell(mk_int(0), lng));
+    return node ? code_for_ir(node) : NULL;
+}
+
+int code_int_value(Value* code, long* out) {
+    if (!code || val_tag(code) != T_CODE || !code->ir || val_tag(code->ir) != T_INT) return 0;
+    *out = val_int(code->ir);
+    return 1;
+}
+
+Value* code_unboxed(Value* v) {
+    Value* ir = operand_ir(v);
+    if (!ir) return NULL;
+    if (val_tag(ir) != T_CODE) return render_long(ir);
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "(");
+    cb_code(&cb, ir);
+    cb_text(&cb, " ? ");
+    cb_code(&cb, ir);
+    cb_text(&cb, "->i : 0)");
+    return cb_finish(&cb);
+}
+
+Value* fold_lifted_op(const char* fn, Value* a, Value* b) {
+    // not_op of a constant: nil leaves make it 1, so only constants fold
+    long k;
+    if (strcmp(fn, "not_op") == 0) return code_int_value(a, &k) ? lift_int(!k) : NULL;
+
+    int op = find_int_op(fn);
+    if (op < 0) return NULL;
+    Value* ia = operand_ir(a);
+    Value* ib = operand_ir(b);
+    if (!ia || !ib) return NULL;
+
+    // Both known: the result is a constant
+    if (val_tag(ia) == T_INT && val_tag(ib) == T_INT) {
+        return lift_int(INT_OPS[op].fold(val_int(ia), val_int(ib)));
+    }
+
+    Value* lng = render_node(&INT_OPS[op], ia, ib);
+    Value* node = lng ? mk_cell(mk_int(op), mk_cell(mk_cell(ia, ib), lng)) : NULL;
+    return node ? code_for_ir(node) : NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef PURPLE_FOLD_H
+#define PURPLE_FOLD_H
+
+#include "../types.h"
+
+// -- Partial Evaluation of Lifted Arithmetic --
+// Collapsing towers: a lifted operation whose operands are all known is
+// computed at compile time, and a chain of int operations is emitted as
+// one unboxed long expression boxed once at the top, instead of a
+// runtime call (and an allocation) per step. Lifted code that is known
+// to be an int keeps its structure in its ir field:
+//
+//   T_INT                 a constant the code evaluates to
+//   (op . ((a . b) . l))  an int primitive over two ir operands, l being
+//                         its long expression (shared code)
+//   T_CODE                a leaf: an Obj* path (x, (x)->a, ...) read as ->i
+//   (-1 . (0 . l))        an opaque long expression l (lift_long)
+//
+// Folding and unboxing keep the runtime primitives' semantics: overflow
+// and division by zero give 0, and so does a nil leaf operand.
+
+// Lifted int constant: mk_int(i), carrying i
+Value* lift_int(long i);
+
+// Lifted code for the C long expression lng (a loop variable, say):
+// mk_int(lng) where it is boxed, lng itself inside int chains
+Value* lift_long(Value* lng);
+
+// The constant lifted code folded to (0 if it is not one)
+int code_int_value(Value* code, long* out);
+
+// v as an unboxed long expression: a constant, a folded chain, or a
+// leaf path read as ->i (0 when nil). NULL when v has no int structure
+Value* code_unboxed(Value* v);
+
+// fn(a, b) for a runtime int primitive (add, sub, mul, div_op, mod_op
+// and the comparisons), folded or unboxed. NULL when fn is not one of
+// them or an operand has no int structure: the caller emits the call
+Value* fold_lifted_op(const char* fn, Value* a, Value* b);
+
+#endif // PURPLE_FOLD_H
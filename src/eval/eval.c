@@ -1,12 +1,30 @@
 #include "eval.h"
+#include "resolve.h"
+#include "vm.h"
+#include "profile.h"
+#include "vector.h"
 #include "../codegen/codegen.h"
+#include "../codegen/fold.h"
 #include "../analysis/escape.h"
 #include "../analysis/shape.h"
+#include "../analysis/pipeline.h"
+#include "../analysis/reuse.h"
+#include "../analysis/dps.h"
+#include "../analysis/oneshot.h"
+#include "../analysis/report.h"
 #include "../util/dstring.h"
+#include "../util/hashmap.h"
+#include "../memory/concurrent.h"
+#include "../memory/scc.h"
 #include <stdio.h>
 #include <string.h>
 #include <limits.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
 
 // -- Symbol Table --
 
@@ -33,10 +51,17 @@ Value* SYM_PROMPT = NULL;
 Value* SYM_CONTROL = NULL;
 Value* SYM_GO = NULL;
 Value* SYM_SELECT = NULL;
-static Value* SYM_UNINIT = NULL;
+Value* SYM_DEFTYPE = NULL;
+Value* SYM_UNINIT = NULL;  // letrec placeholder, never a real value
 
 // -- Global Environment --
-static Value* global_env = NULL;
+// Interned symbol -> (sym . val) binding cell
+static HashMap* global_env = NULL;
+
+static void register_special_forms(void);
+static void node_reset(void);
+static void node_shared_enter(void);
+static void node_shared_leave(void);
 
 void init_syms(void) {
     NIL = alloc_val(T_NIL);
@@ -62,43 +87,102 @@ void init_syms(void) {
     SYM_CONTROL = mk_sym("control");
     SYM_GO = mk_sym("go");
     SYM_SELECT = mk_sym("select");
+    SYM_DEFTYPE = mk_sym("deftype");
     SYM_UNINIT = alloc_val(T_PRIM);
     if (SYM_UNINIT) {
         SYM_UNINIT->prim = NULL;
     }
-    global_env = NIL;  // Initialize global environment
+    // Initialize global environment
+    if (global_env) hashmap_free(global_env);
+    global_env = hashmap_new_arena(64);
+    resolve_reset();
+    vm_reset();
+    node_reset();
+    register_special_forms();
+}
+
+// Writes into state that may predate the running form (see eval.h)
+static unsigned long mutation_count = 0;
+
+// Parallel processes spawned but not finished, and whether this thread is
+// running them (see Work-Stealing Scheduler)
+static long go_pending = 0;
+static __thread int sched_parallel = 0;
+
+unsigned long eval_mutation_count(void) {
+    return mutation_count;
+}
+
+// Called before every such write. Pending parallel processes read state as
+// it was when they were spawned, so they finish before it changes.
+static void note_mutation(void) {
+    if (sched_parallel) {
+        __atomic_fetch_add(&mutation_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (go_pending) scheduler_sync();
+    mutation_count++;
+}
+
+static int go_live(void);
+
+void eval_drop_caches(void) {
+    // Suspended processes are still running these nodes
+    if (go_live()) return;
+    vm_reset();
+    node_reset();
 }
 
 // -- Global Environment Functions --
 
 void global_define(Value* sym, Value* val) {
-    if (!sym || sym->tag != T_SYM) return;
+    if (!sym || val_tag(sym) != T_SYM) return;
+    note_mutation();
 
     // Check if already defined, update if so
-    Value* env = global_env;
-    while (!is_nil(env)) {
-        Value* pair = car(env);
-        if (pair && sym_eq(car(pair), sym)) {
-            // Update existing binding
-            pair->cell.cdr = val;
-            return;
-        }
-        env = cdr(env);
+    if (profile_active && val && val_tag(val) == T_LAMBDA) profile_name(val->lam.body, sym->s);
+
+    Value* pair = hashmap_get(global_env, sym);
+    if (pair) {
+        pair->cell.cdr = val;
+        return;
     }
-    // Not found, prepend new binding
-    global_env = mk_cell(mk_cell(sym, val), global_env);
+    pair = mk_cell(sym, val);
+    if (!pair) return;
+    hashmap_put(global_env, sym, pair);
 }
 
 Value* global_lookup(Value* sym) {
-    if (!sym || sym->tag != T_SYM) return NULL;
-    return env_lookup(global_env, sym);
+    if (!sym || val_tag(sym) != T_SYM) return NULL;
+    Value* pair = hashmap_get(global_env, sym);
+    return pair ? pair->cell.cdr : NULL;
+}
+
+int global_set(Value* sym, Value* val) {
+    if (!sym || val_tag(sym) != T_SYM) return 0;
+    Value* pair = hashmap_get(global_env, sym);
+    if (!pair) return 0;  // Not defined
+    note_mutation();
+    pair->cell.cdr = val;
+    return 1;
 }
 
 int env_set(Value* env, Value* sym, Value* val) {
     while (!is_nil(env)) {
+        if (val_tag(env) == T_FRAME) {
+            int slot = frame_slot(env, sym);
+            if (slot >= 0) {
+                note_mutation();
+                env->frame.slots[slot] = val;
+                return 1;  // Found and set
+            }
+            env = env->frame.next;
+            continue;
+        }
         Value* pair = car(env);
         if (pair && sym_eq(car(pair), sym)) {
             // Mutate the binding in place
+            note_mutation();
             pair->cell.cdr = val;
             return 1;  // Found and set
         }
@@ -108,9 +192,28 @@ int env_set(Value* env, Value* sym, Value* val) {
 }
 
 // -- Environment --
+// An environment is a chain of T_FRAME activation records (lambda, let,
+// letrec) and (sym . val) cells pushed by env_extend.
+
+// Slot bound to sym in a frame, or -1. Later binders shadow earlier ones.
+int frame_slot(Value* frame, Value* sym) {
+    int found = -1;
+    int i = 0;
+    for (Value* n = frame->frame.names; n && val_tag(n) == T_CELL && i < frame->frame.count;
+         n = n->cell.cdr, i++) {
+        if (n->cell.car == sym && frame->frame.slots[i]) found = i;
+    }
+    return found;
+}
 
 Value* env_lookup(Value* env, Value* sym) {
     while (!is_nil(env)) {
+        if (val_tag(env) == T_FRAME) {
+            int slot = frame_slot(env, sym);
+            if (slot >= 0) return env->frame.slots[slot];
+            env = env->frame.next;
+            continue;
+        }
         Value* pair = car(env);
         if (sym_eq(car(pair), sym)) return cdr(pair);
         env = cdr(env);
@@ -118,6 +221,34 @@ Value* env_lookup(Value* env, Value* sym) {
     return NULL;
 }
 
+// Assoc-list view of an environment, innermost binding first.
+// Used by reflective access (get-meta) so frames still read as lists.
+Value* env_to_list(Value* env) {
+    Value* head = NIL;
+    Value* tail = NULL;
+    while (!is_nil(env)) {
+        if (val_tag(env) == T_FRAME) {
+            for (int i = env->frame.count - 1; i >= 0; i--) {
+                if (!env->frame.slots[i]) continue;
+                Value* n = env->frame.names;
+                for (int j = 0; j < i && n; j++) n = cdr(n);
+                Value* cell = mk_cell(mk_cell(car(n), env->frame.slots[i]), NIL);
+                if (tail) tail->cell.cdr = cell;
+                else head = cell;
+                tail = cell;
+            }
+            env = env->frame.next;
+            continue;
+        }
+        Value* cell = mk_cell(car(env), NIL);
+        if (tail) tail->cell.cdr = cell;
+        else head = cell;
+        tail = cell;
+        env = cdr(env);
+    }
+    return head;
+}
+
 Value* env_extend(Value* env, Value* sym, Value* val) {
     return mk_cell(mk_cell(sym, val), env);
 }
@@ -145,6 +276,61 @@ Value* mk_menv(Value* parent, Value* env) {
     return v;
 }
 
+// -- Tail Calls --
+// A form in tail position (if branches, let/letrec/lambda bodies, the last
+// form of do/and/or) records its continuation here instead of recursing,
+// and eval loops on it in the same C frame.
+//
+// When the new scope only swaps the environment (every handler is the
+// default), `env` is set instead of allocating a body MEnv; eval then
+// rebinds one activation record that it owns across iterations.
+
+struct Node;
+
+typedef struct TailCall {
+    Value* expr;
+    Value* menv;
+    Value* env;     // Non-NULL: run expr under menv's handlers with this env
+    struct Node* node;  // Compiled form of expr, when the caller has it
+} TailCall;
+
+static Value* tail_to(TailCall* tail, Value* expr, Value* menv) {
+    if (is_nil(expr)) return NIL;
+    tail->expr = expr;
+    tail->menv = menv;
+    return NIL;
+}
+
+static Value* tail_with_env(TailCall* tail, Value* expr, Value* menv, Value* env) {
+    if (is_nil(expr)) return NIL;
+    tail->expr = expr;
+    tail->menv = menv;
+    tail->env = env;
+    return NIL;
+}
+
+static int menv_has_default_handlers(Value* menv) {
+    return menv->menv.h_app == h_app_default &&
+           menv->menv.h_let == h_let_default &&
+           menv->menv.h_if == h_if_default &&
+           menv->menv.h_lit == h_lit_default &&
+           menv->menv.h_var == h_var_default;
+}
+
+static Value* run_node(struct Node* n, Value* menv);
+
+// Run a pending tail call from a non-looping caller (handler entry points)
+static Value* finish_tail(Value* result, TailCall* tail) {
+    if (!tail->expr && !tail->node) return result;
+    Value* menv = tail->menv;
+    if (tail->env) {
+        menv = mk_menv(menv->menv.parent, tail->env);
+        if (!menv) return NIL;
+    }
+    if (tail->node) return run_node(tail->node, menv);
+    return eval(tail->expr, menv);
+}
+
 // -- Default Handlers --
 
 Value* h_lit_default(Value* exp, Value* menv) {
@@ -171,6 +357,55 @@ Value* h_var_default(Value* exp, Value* menv) {
     return NIL;
 }
 
+// Lexically addressed variable: skip `depth` frames and read the slot.
+// (sym . val) cells between frames come from set-meta!/control and shadow.
+Value* eval_lref(Value* ref, Value* menv) {
+    Value* sym = ref->lref.sym;
+    if (menv->menv.h_var != h_var_default) return menv->menv.h_var(sym, menv);
+
+    Value* env = menv->menv.env;
+    int depth = ref->lref.depth;
+    while (env && val_tag(env) != T_NIL) {
+        if (val_tag(env) == T_FRAME) {
+            if (depth == 0) {
+                if (ref->lref.slot >= env->frame.count) break;
+                Value* v = env->frame.slots[ref->lref.slot];
+                if (!v) break;
+                if (v == SYM_UNINIT) {
+                    printf("Error: Uninitialized letrec binding %s\n", sym->s);
+                    return NIL;
+                }
+                return v;
+            }
+            depth--;
+            env = env->frame.next;
+        } else if (val_tag(env) == T_CELL) {
+            Value* pair = env->cell.car;
+            if (pair && val_tag(pair) == T_CELL && pair->cell.car == sym) {
+                return pair->cell.cdr;
+            }
+            env = env->cell.cdr;
+        } else {
+            break;
+        }
+    }
+    return h_var_default(sym, menv);
+}
+
+// Fresh frame for a lambda application; surplus args are dropped and
+// missing ones stay unbound, as with the old per-argument env_extend.
+static Value* bind_params(Value* params, Value* args, Value* closure_env) {
+    int n = resolve_param_count(params);
+    Value* frame = mk_frame(params, n, closure_env);
+    if (!frame) return NULL;
+    Value* a = args;
+    for (int i = 0; i < n && !is_nil(a); i++) {
+        frame->frame.slots[i] = car(a);
+        a = cdr(a);
+    }
+    return frame;
+}
+
 Value* eval_list(Value* list, Value* menv) {
     if (is_nil(list)) return NIL;
     Value* h = eval(car(list), menv);
@@ -178,34 +413,44 @@ Value* eval_list(Value* list, Value* menv) {
     return mk_cell(h, t);
 }
 
-Value* h_app_default(Value* exp, Value* menv) {
+static Value* app_step(Value* exp, Value* menv, TailCall* tail) {
     Value* f_expr = car(exp);
     Value* args_expr = cdr(exp);
 
     Value* fn = eval(f_expr, menv);
     if (!fn) return NIL;  // Guard: fn could be NULL
+
+    // Binary primitive fast path: no argument list is consed
+    if (val_tag(fn) == T_PRIM && fn->prim2) {
+        Value* rest = cdr(args_expr);
+        if (rest && val_tag(rest) == T_CELL && is_nil(cdr(rest))) {
+            Value* a = eval(car(args_expr), menv);
+            Value* b = eval(car(rest), menv);
+            if (!a || !b) return NIL;
+            return fn->prim2(a, b);
+        }
+    }
+
     Value* args = eval_list(args_expr, menv);
 
-    if (fn->tag == T_PRIM) return fn->prim(args, menv);
+    if (val_tag(fn) == T_PRIM) return fn->prim(args, menv);
 
     // Handle continuation invocation
-    if (fn->tag == T_CONT) {
+    if (val_tag(fn) == T_CONT) {
         Value* arg = is_nil(args) ? NIL : car(args);
         return invoke_continuation(fn, arg);
     }
 
-    if (fn->tag == T_LAMBDA) {
+    if (val_tag(fn) == T_LAMBDA) {
         Value* params = fn->lam.params;
         Value* body = fn->lam.body;
         Value* closure_env = fn->lam.env;
 
-        Value* new_env = closure_env;
-        Value* p = params;
-        Value* a = args;
-        while (!is_nil(p) && !is_nil(a)) {
-            new_env = env_extend(new_env, car(p), car(a));
-            p = cdr(p);
-            a = cdr(a);
+        Value* new_env = bind_params(params, args, closure_env);
+        if (!new_env) return NIL;
+
+        if (menv_has_default_handlers(menv)) {
+            return tail_with_env(tail, body, menv, new_env);
         }
 
         Value* body_menv = mk_menv(menv->menv.parent, new_env);
@@ -214,7 +459,7 @@ Value* h_app_default(Value* exp, Value* menv) {
         body_menv->menv.h_let = menv->menv.h_let;
         body_menv->menv.h_if = menv->menv.h_if;
 
-        return eval(body, body_menv);
+        return tail_to(tail, body, body_menv);
     }
 
     char* fn_str = val_to_str(fn);
@@ -223,6 +468,11 @@ Value* h_app_default(Value* exp, Value* menv) {
     return NIL;
 }
 
+Value* h_app_default(Value* exp, Value* menv) {
+    TailCall tail = { NULL, NULL, NULL, NULL };
+    return finish_tail(app_step(exp, menv, &tail), &tail);
+}
+
 // Binding info for multi-let
 typedef struct BindingInfo {
     Value* sym;
@@ -230,23 +480,27 @@ typedef struct BindingInfo {
     struct BindingInfo* next;
 } BindingInfo;
 
-Value* h_let_default(Value* exp, Value* menv) {
+static Value* let_finish(Value* exp, Value* menv, BindingInfo* bind_list,
+                         Value* names, int count, int any_code, int oom, TailCall* tail);
+
+static Value* let_step(Value* exp, Value* menv, TailCall* tail) {
     Value* args = cdr(exp);
     Value* bindings = car(args);
-    Value* body = car(cdr(args));
 
     int any_code = 0;
     int oom = 0;
+    int count = 0;
     Value* check_bindings = bindings;
-    Value* new_env = menv->menv.env;
 
     BindingInfo* bind_list = NULL;
     BindingInfo* bind_tail = NULL;
+    Value* names = NIL;
+    Value* names_tail = NULL;
 
     while (!is_nil(check_bindings)) {
         Value* bind = car(check_bindings);
         Value* sym = car(bind);
-        if (!sym || sym->tag != T_SYM || !sym->s) {
+        if (!sym || val_tag(sym) != T_SYM || !sym->s) {
             check_bindings = cdr(check_bindings);
             continue;  // Skip malformed binding
         }
@@ -254,7 +508,7 @@ Value* h_let_default(Value* exp, Value* menv) {
         Value* val = eval(val_expr, menv);
         if (!val) val = NIL;  // Guard against NULL from allocation failure
 
-        if (val->tag == T_CODE) any_code = 1;
+        if (val_tag(val) == T_CODE) any_code = 1;
 
         BindingInfo* info = malloc(sizeof(BindingInfo));
         if (!info) {
@@ -272,9 +526,96 @@ Value* h_let_default(Value* exp, Value* menv) {
             bind_list = bind_tail = info;
         }
 
+        Value* name_cell = mk_cell(sym, NIL);
+        if (!name_cell) {
+            oom = 1;
+            break;
+        }
+        if (names_tail) names_tail->cell.cdr = name_cell;
+        else names = name_cell;
+        names_tail = name_cell;
+        count++;
+
         check_bindings = cdr(check_bindings);
     }
 
+    return let_finish(exp, menv, bind_list, names, count, any_code, oom, tail);
+}
+
+// The (name value) form binding name in let_form (NULL if none)
+static Value* let_binding(Value* let_form, const char* name) {
+    for (Value* b = car(cdr(let_form)); val_tag(b) == T_CELL; b = cdr(b)) {
+        Value* bind = car(b);
+        if (val_tag(bind) == T_CELL && car(bind) && val_tag(car(bind)) == T_SYM &&
+            strcmp(car(bind)->s, name) == 0 && val_tag(cdr(bind)) == T_CELL) {
+            return bind;
+        }
+    }
+    return NULL;
+}
+
+// Source of the value bound to name in let_form (NULL if none)
+static Value* let_binding_form(Value* let_form, const char* name) {
+    Value* bind = let_binding(let_form, name);
+    return bind ? car(cdr(bind)) : NULL;
+}
+
+// FBIP: the body (cons A B) written into the cell of reuse->var, which
+// is unique, so no RC check; kept fields are neither written nor
+// released. NULL if a field does not compile.
+static Value* compile_inplace_reuse(ReuseMatch* reuse, Value* body, Value* menv) {
+    static const char* const field_names[2] = { "a", "b" };
+    const char* var = reuse->var->s;
+    Value* field_exprs[2] = { car(cdr(body)), car(cdr(cdr(body))) };
+    Value* code[2] = { NULL, NULL };
+
+    for (int i = 0; i < 2; i++) {
+        if (reuse->kind[i] != REUSE_FRESH) continue;
+        code[i] = code_of(eval(field_exprs[i], menv));
+        if (!code[i]) return NULL;
+    }
+
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_textf(&cb, "({ /* FBIP: %s reused in place */", var);
+    for (int i = 0; i < 2; i++) {
+        if (reuse->kind[i] == REUSE_FRESH) {
+            cb_textf(&cb, " Obj* _f%s = ", field_names[i]);
+            cb_code(&cb, code[i]);
+            cb_text(&cb, ";");
+        }
+        if (reuse->kind[i] == REUSE_SWAP) cb_textf(&cb, " Obj* _f%s = (%s)->%s;", field_names[i], var, field_names[1 - i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (reuse->release[i]) cb_textf(&cb, " dec_ref((%s)->%s);", var, field_names[i]);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (reuse->kind[i] != REUSE_KEEP) cb_textf(&cb, " (%s)->%s = _f%s;", var, field_names[i], field_names[i]);
+    }
+    cb_textf(&cb, " %s; })", var);
+    return cb_finish(&cb);
+}
+
+// Code in a C block: lifted code as is, anything else as its printed
+// form (NULL for nothing)
+static void cb_block_value(CodeBuilder* cb, Value* v) {
+    if (v && val_tag(v) == T_CODE) {
+        cb_code(cb, v);
+        return;
+    }
+    char* s = val_to_str(v);
+    cb_text(cb, s ? s : "NULL");
+    free(s);
+}
+
+// Second half of let once the binders are evaluated: build the frame, or
+// the C block when any value is code, and continue with the body.
+static Value* let_finish(Value* exp, Value* menv, BindingInfo* bind_list,
+                         Value* names, int count, int any_code, int oom, TailCall* tail) {
+    Value* body = car(cdr(cdr(exp)));
+    Value* new_env = oom ? NULL : mk_frame(names, count, menv->menv.env);
+    if (!new_env) oom = 1;
+
     if (oom) {
         printf("Error: Out of memory while building let bindings\n");
         while (bind_list) {
@@ -288,7 +629,7 @@ Value* h_let_default(Value* exp, Value* menv) {
     if (any_code) {
         BindingInfo* b = bind_list;
         while (b) {
-            if (b->val->tag != T_CODE) {
+            if (val_tag(b->val) != T_CODE) {
                 char* tmp = val_to_c_expr(b->val);
                 if (!tmp) {
                     any_code = 0;
@@ -310,13 +651,29 @@ Value* h_let_default(Value* exp, Value* menv) {
             b = b->next;
         }
 
-        analyze_expr(body, ctx);
-        analyze_escape(body, ctx, ESCAPE_GLOBAL);
-        analyze_shapes_expr(exp, shape_ctx);
-
-        DString* all_decls = ds_new();
+        // Analyses work on symbols, not lexical addresses; one walk
+        // covers usage, escape and shapes (and RC optimization, which
+        // only the decision report reads)
+        int reporting = report_enabled();
+        RCOptContext* rc_ctx = reporting ? mk_rcopt_context() : NULL;
+        FreezePoint* freeze_points = reporting ? detect_freeze_points(resolve_source_form(exp)) : NULL;
+        AnalysisPipeline pipeline;
+        pipeline_init(&pipeline, ctx, shape_ctx, rc_ctx);
+        pipeline_run_let(&pipeline, resolve_source_form(exp), ESCAPE_GLOBAL);
+        pipeline_destroy(&pipeline);
+
+        // A body rebuilding one of our fresh cells writes into it instead
+        ReuseMatch reuse;
+        int reusing = find_inplace_reuse(resolve_source_form(exp), &reuse);
+        const char* reuse_free_fn = NULL;
+
+        // Declarations share the bindings' code; frees are names only
+        CodeBuilder block;
+        cb_init(&block);
+        cb_text(&block, "({\n");
         DString* all_frees = ds_new();
         b = bind_list;
+        int slot = 0;
         while (b) {
             VarUsage* usage = find_var(ctx, b->sym->s);
             int is_captured = usage ? usage->captured_by_lambda : 0;
@@ -326,35 +683,79 @@ Value* h_let_default(Value* exp, Value* menv) {
             ShapeInfo* shape_info = find_shape(shape_ctx, b->sym->s);
             Shape var_shape = shape_info ? shape_info->shape : SHAPE_UNKNOWN;
 
-            char* val_str = NULL;
-            if (b->val->tag == T_CODE) {
-                val_str = b->val->s;
-            } else {
-                val_str = val_to_c_expr(b->val);
-                if (!val_str) {
-                    printf("Error: cannot compile non-literal let binding for %s\n", b->sym->s);
-                    break;
-                }
+            Value* val_code = code_of(b->val);
+            if (!val_code) {
+                printf("Error: cannot compile non-literal let binding for %s\n", b->sym->s);
+                break;
             }
 
-            if (b->val->tag != T_CODE) {
-                if (b->val->tag == T_INT) {
-                    ds_printf(all_decls, "  Obj* %s = mk_int(%ld);\n", b->sym->s, b->val->i);
-                } else {
-                    ds_printf(all_decls, "  Obj* %s = %s;\n", b->sym->s, val_str);
+            int reused = reusing && !reuse_free_fn && strcmp(b->sym->s, reuse.var->s) == 0 &&
+                         val_tag(b->val) == T_CODE;
+
+            // A fresh cell that dies with the block goes in a destination here
+            // Only a constructor's text is inspected, so only that is flattened
+            DPSClass dps = DPS_NONE;
+            char* dps_code = NULL;
+            const char* val_str = NULL;
+            if (val_tag(b->val) == T_CODE && !reused && !is_captured && use_count > 0 &&
+                escape_class != ESCAPE_GLOBAL &&
+                (code_starts_with(val_code, "mk_pair(") || code_starts_with(val_code, "mk_int("))) {
+                val_str = code_text(val_code);
+                Value* src = resolve_source_form(exp);
+                dps = classify_dps_binding(let_binding_form(src, b->sym->s), val_str,
+                                           car(cdr(cdr(src))), b->sym->s, var_shape);
+                if (dps != DPS_NONE) {
+                    char dest[128];
+                    snprintf(dest, sizeof(dest), "_d_%s", b->sym->s);
+                    dps_code = dps_write_code(val_str, dest);
+                    if (!dps_code) dps = DPS_NONE;
                 }
+            }
+
+            if (dps_code) {
+                cb_textf(&block, "  STACK_DEST(_d_%s); // DPS: %s (%s)\n",
+                         b->sym->s, b->sym->s, dps_class_name(dps));
+                cb_textf(&block, "  Obj* %s = ", b->sym->s);
+                cb_text(&block, dps_code);
+                cb_text(&block, ";\n");
+                free(dps_code);
             } else {
-                ds_printf(all_decls, "  Obj* %s = %s;\n", b->sym->s, val_str);
+                cb_textf(&block, "  Obj* %s = ", b->sym->s);
+                cb_code(&block, val_code);
+                cb_text(&block, ";\n");
             }
 
             const char* free_fn = shape_free_strategy(var_shape);
-
-            if (is_captured) {
+            const char* freed = NULL;
+            const char* reason;
+
+            if (reused) {
+                // Its cell becomes the result: nothing to free
+                reuse_free_fn = free_fn;
+                reason = "cell reused by the body";
+            } else if (is_captured) {
                 ds_printf(all_frees, "  // %s captured by closure - no free\n", b->sym->s);
+                reason = "captured by a closure";
             } else if (use_count == 0) {
-                ds_printf(all_decls, "  %s(%s); // unused\n", free_fn, b->sym->s);
+                cb_textf(&block, "  %s(%s); // unused\n", free_fn, b->sym->s);
+                freed = free_fn;
+                reason = "unused";
             } else if (escape_class == ESCAPE_GLOBAL) {
                 ds_printf(all_frees, "  // %s escapes to return - no free\n", b->sym->s);
+                reason = "escapes to the result";
+            } else if (dps != DPS_NONE && strncmp(val_str, "mk_int(", 7) == 0) {
+                ds_printf(all_frees, "  // %s lives in _d_%s - no free\n", b->sym->s, b->sym->s);
+                reason = "lives in its destination";
+            } else if (dps != DPS_NONE) {
+                // The cell goes with the block; its children are still ours
+                DString* temp = ds_new();
+                ds_printf(temp, "  %s((%s)->a); %s((%s)->b); // ASAP Clean (cell in _d_%s)\n",
+                          free_fn, b->sym->s, free_fn, b->sym->s, b->sym->s);
+                ds_append(temp, ds_cstr(all_frees));
+                ds_free(all_frees);
+                all_frees = temp;
+                freed = free_fn;
+                reason = "children freed at scope end, cell in its destination";
             } else {
                 DString* temp = ds_new();
                 ds_printf(temp, "  %s(%s); // ASAP Clean (shape: %s)\n",
@@ -365,17 +766,43 @@ Value* h_let_default(Value* exp, Value* menv) {
                 ds_append(temp, ds_cstr(all_frees));
                 ds_free(all_frees);
                 all_frees = temp;
+                freed = free_fn;
+                reason = "dies at scope end";
+            }
+
+            if (reporting) {
+                Value* bind = let_binding(resolve_source_form(exp), b->sym->s);
+                DecisionRecord rec = {0};
+                rec.name = b->sym->s;
+                if (!bind || !source_pos(bind, &rec.pos)) rec.pos.line = 0;
+                rec.shape = var_shape;
+                rec.escape = escape_class;
+                rec.rc = rcopt_get_dec_ref(rc_ctx, b->sym->s);
+                rec.dps = dps;
+                rec.reused = reused;
+                for (FreezePoint* fp = freeze_points; fp && bind; fp = fp->next) {
+                    if (fp->expr == car(cdr(bind)) && strcmp(fp->var_name, b->sym->s) == 0) {
+                        rec.freeze_point = fp->is_cyclic;
+                    }
+                }
+                rec.free_fn = freed;
+                rec.reason = reason;
+                report_binding(&rec);
             }
 
-            Value* ref = mk_code(b->sym->s);
-            new_env = env_extend(new_env, b->sym, ref);
+            // The body sees the variable; a folded constant stays known
+            // through it, so reads of x keep folding
+            Value* var_code = mk_code(b->sym->s);
+            long k;
+            if (var_code && code_int_value(b->val, &k)) var_code->ir = b->val->ir;
+            new_env->frame.slots[slot++] = var_code;
 
-            if (b->val->tag != T_CODE) free(val_str);
             b = b->next;
         }
+        if (rc_ctx) free_rcopt_context(rc_ctx);
+        free_freeze_points(freeze_points);
 
         if (b) {
-            ds_free(all_decls);
             ds_free(all_frees);
             free_analysis_ctx(ctx);
             free_shape_context(shape_ctx);
@@ -389,7 +816,6 @@ Value* h_let_default(Value* exp, Value* menv) {
 
         Value* body_menv = mk_menv(menv->menv.parent, new_env);
         if (!body_menv) {
-            ds_free(all_decls);
             ds_free(all_frees);
             free_analysis_ctx(ctx);
             free_shape_context(shape_ctx);
@@ -403,17 +829,24 @@ Value* h_let_default(Value* exp, Value* menv) {
         body_menv->menv.h_app = menv->menv.h_app;
         body_menv->menv.h_let = menv->menv.h_let;
 
-        Value* res = eval(body, body_menv);
-        int sres_owned = (!res || res->tag != T_CODE);
-        char* sres = (res && res->tag == T_CODE) ? res->s : val_to_str(res);
-
-        DString* block = ds_new();
-        ds_printf(block, "({\n%s  Obj* _res = %s;\n%s  _res;\n})",
-                  ds_cstr(all_decls), sres ? sres : "NULL", ds_cstr(all_frees));
+        Value* res = NULL;
+        if (reuse_free_fn) {
+            res = compile_inplace_reuse(&reuse, body, body_menv);
+            if (!res) {
+                ds_printf(all_frees, "  %s(%s); // ASAP Clean\n", reuse_free_fn, reuse.var->s);
+                reuse_free_fn = NULL;
+            }
+        }
+        if (!reuse_free_fn) {
+            res = eval(body, body_menv);
+        }
 
-        if (sres_owned) free(sres);
+        cb_text(&block, "  Obj* _res = ");
+        cb_block_value(&block, res);
+        cb_text(&block, ";\n");
+        cb_text(&block, ds_cstr(all_frees));
+        cb_text(&block, "  _res;\n})");
 
-        ds_free(all_decls);
         ds_free(all_frees);
         free_analysis_ctx(ctx);
         free_shape_context(shape_ctx);
@@ -424,18 +857,25 @@ Value* h_let_default(Value* exp, Value* menv) {
             bind_list = next;
         }
 
-        char* code_str = ds_take(block);
-        Value* result = mk_code(code_str);
-        free(code_str);
-        return result;
+        return cb_finish(&block);
     }
 
     BindingInfo* b = bind_list;
+    int slot = 0;
     while (b) {
-        new_env = env_extend(new_env, b->sym, b->val);
+        new_env->frame.slots[slot++] = b->val;
         b = b->next;
     }
 
+    if (menv_has_default_handlers(menv)) {
+        while (bind_list) {
+            BindingInfo* next = bind_list->next;
+            free(bind_list);
+            bind_list = next;
+        }
+        return tail_with_env(tail, body, menv, new_env);
+    }
+
     Value* body_menv = mk_menv(menv->menv.parent, new_env);
     if (!body_menv) {
         while (bind_list) {
@@ -454,7 +894,12 @@ Value* h_let_default(Value* exp, Value* menv) {
         bind_list = next;
     }
 
-    return eval(body, body_menv);
+    return tail_to(tail, body, body_menv);
+}
+
+Value* h_let_default(Value* exp, Value* menv) {
+    TailCall tail = { NULL, NULL, NULL, NULL };
+    return finish_tail(let_step(exp, menv, &tail), &tail);
 }
 
 // Helper: Check if a code string is a simple variable name (identifier)
@@ -470,7 +915,30 @@ static int is_simple_var_name(const char* s) {
     return 1;
 }
 
-Value* h_if_default(Value* exp, Value* menv) {
+// Code-level if: both branches are generated under a C conditional
+static Value* if_code(Value* c, Value* then_expr, Value* else_expr, Value* menv) {
+    Value* t = eval(then_expr, menv);
+    Value* e = eval(else_expr, menv);
+    // Use a block expression that stores condition in temp variable
+    // to avoid memory leak from evaluating the condition
+    // Check for NULL before dereferencing to handle OOM in condition
+    // Don't dec_ref if condition is a simple variable name - it's managed by its scope
+    // (a name is short: longer code is not flattened to find out)
+    int simple = code_len(c) < 64 && is_simple_var_name(code_text(c));
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "({ Obj* _cond = ");
+    cb_code(&cb, c);
+    cb_text(&cb, "; Obj* _r = (_cond && _cond->i) ? (");
+    cb_block_value(&cb, t);
+    cb_text(&cb, ") : (");
+    cb_block_value(&cb, e);
+    // Complex expression - may allocate, so dec_ref after use
+    cb_text(&cb, simple ? "); _r; })" : "); if (_cond) dec_ref(_cond); _r; })");
+    return cb_finish(&cb);
+}
+
+static Value* if_step(Value* exp, Value* menv, TailCall* tail) {
     Value* args = cdr(exp);
     Value* cond_expr = car(args);
     Value* then_expr = car(cdr(args));
@@ -478,446 +946,1143 @@ Value* h_if_default(Value* exp, Value* menv) {
 
     Value* c = eval(cond_expr, menv);
 
-    if (is_code(c)) {
-        Value* t = eval(then_expr, menv);
-        Value* e = eval(else_expr, menv);
-        int st_owned = (!t || t->tag != T_CODE);
-        int se_owned = (!e || e->tag != T_CODE);
-        char* st = (t && t->tag == T_CODE) ? t->s : val_to_str(t);
-        char* se = (e && e->tag == T_CODE) ? e->s : val_to_str(e);
-        DString* ds = ds_new();
-        // Use a block expression that stores condition in temp variable
-        // to avoid memory leak from evaluating the condition
-        // Check for NULL before dereferencing to handle OOM in condition
-        // Don't dec_ref if condition is a simple variable name - it's managed by its scope
-        if (is_simple_var_name(c->s)) {
-            // Simple variable reference - no dec_ref needed (scope manages it)
-            ds_printf(ds, "({ Obj* _cond = %s; Obj* _r = (_cond && _cond->i) ? (%s) : (%s); _r; })",
-                      c->s, st ? st : "NULL", se ? se : "NULL");
-        } else {
-            // Complex expression - may allocate, so dec_ref after use
-            ds_printf(ds, "({ Obj* _cond = %s; Obj* _r = (_cond && _cond->i) ? (%s) : (%s); if (_cond) dec_ref(_cond); _r; })",
-                      c->s, st ? st : "NULL", se ? se : "NULL");
-        }
-        if (st_owned) free(st);
-        if (se_owned) free(se);
-        char* code_str = ds_take(ds);
-        Value* result = mk_code(code_str);
-        free(code_str);
-        return result;
-    }
+    // A lifted condition that folded to a constant picks its branch now
+    long k;
+    if (code_int_value(c, &k)) return tail_to(tail, k ? then_expr : else_expr, menv);
+    if (is_code(c)) return if_code(c, then_expr, else_expr, menv);
+    if (!is_nil(c)) return tail_to(tail, then_expr, menv);
+    else return tail_to(tail, else_expr, menv);
+}
 
-    if (!is_nil(c)) return eval(then_expr, menv);
-    else return eval(else_expr, menv);
+Value* h_if_default(Value* exp, Value* menv) {
+    TailCall tail = { NULL, NULL, NULL, NULL };
+    return finish_tail(if_step(exp, menv, &tail), &tail);
 }
 
-// -- Evaluator --
+// -- Special Forms --
+// Each special-form symbol carries a slot index (Value.sym_form) assigned in
+// init_syms, so eval dispatches in one table load instead of a compare chain.
 
-Value* eval(Value* expr, Value* menv) {
-    if (is_nil(expr)) return NIL;
-    if (!menv) return NIL;  // NULL check for menv
-    if (expr->tag == T_INT) return menv->menv.h_lit(expr, menv);
-    if (expr->tag == T_CODE) return expr;
-
-    if (expr->tag == T_SYM) {
-        return menv->menv.h_var(expr, menv);
-    }
-
-    if (expr->tag == T_CELL) {
-        Value* op = car(expr);
-        Value* args = cdr(expr);
-
-        if (sym_eq(op, SYM_QUOTE)) return car(args);
-        if (sym_eq(op, SYM_LIFT)) return lift_value(eval(car(args), menv));
-
-        if (sym_eq(op, SYM_IF)) return menv->menv.h_if(expr, menv);
-        if (sym_eq(op, SYM_LET)) return menv->menv.h_let(expr, menv);
-
-        // letrec - recursive let binding
-        if (sym_eq(op, SYM_LETREC)) {
-            Value* bindings = car(args);
-            Value* body = car(cdr(args));
-
-            // First pass: extend env with placeholders
-            Value* new_env = menv->menv.env;
-            Value* b = bindings;
-        while (!is_nil(b)) {
-            Value* bind = car(b);
-            Value* sym = car(bind);
-            new_env = env_extend(new_env, sym, SYM_UNINIT);  // Placeholder
-            b = cdr(b);
-        }
-
-            // Create new menv for evaluating bindings
-            Value* rec_menv = mk_menv(menv->menv.parent, new_env);
-            if (!rec_menv) return NIL;
-            rec_menv->menv.h_app = menv->menv.h_app;
-            rec_menv->menv.h_let = menv->menv.h_let;
-            rec_menv->menv.h_if = menv->menv.h_if;
-
-            // Second pass: evaluate and update bindings
-            b = bindings;
-            while (!is_nil(b)) {
-                Value* bind = car(b);
-                Value* val_expr = car(cdr(bind));
-                Value* val = eval(val_expr, rec_menv);
-
-                // Update the placeholder in environment
-                // Find and update the binding
-                Value* e = new_env;
-                Value* sym = car(bind);
-                while (!is_nil(e)) {
-                    Value* pair = car(e);
-                    if (sym_eq(car(pair), sym)) {
-                        pair->cell.cdr = val;
-                        break;
-                    }
-                    e = cdr(e);
-                }
-                b = cdr(b);
-            }
+typedef Value* (*SpecialFormFn)(Value* expr, Value* args, Value* menv, TailCall* tail);
 
-            return eval(body, rec_menv);
-        }
-
-        // Short-circuit and
-        if (sym_eq(op, SYM_AND)) {
-            Value* rest = args;
-            Value* result = SYM_T;
-            while (!is_nil(rest)) {
-                result = eval(car(rest), menv);
-                if (is_code(result)) {
-                    // At code level, generate && chain
-                    Value* remaining = cdr(rest);
-                    while (!is_nil(remaining)) {
-                        Value* next = eval(car(remaining), menv);
-                        char* sr = result->s;
-                        char* sn = is_code(next) ? next->s : val_to_str(next);
-                        if (!sn) sn = strdup("NULL");
-                        DString* ds = ds_new();
-                        ds_printf(ds, "(%s && %s)", sr, sn);
-                        if (!is_code(next)) free(sn);
-                        char* code_str = ds_take(ds);
-                        result = mk_code(code_str);
-                        free(code_str);
-                        remaining = cdr(remaining);
-                    }
-                    return result;
-                }
-                if (is_nil(result)) return NIL;
-                rest = cdr(rest);
-            }
-            return result;
-        }
-
-        // Short-circuit or
-        if (sym_eq(op, SYM_OR)) {
-            Value* rest = args;
-            while (!is_nil(rest)) {
-                Value* result = eval(car(rest), menv);
-                if (is_code(result)) {
-                    // At code level, generate || chain
-                    Value* remaining = cdr(rest);
-                    while (!is_nil(remaining)) {
-                        Value* next = eval(car(remaining), menv);
-                        char* sr = result->s;
-                        char* sn = is_code(next) ? next->s : val_to_str(next);
-                        if (!sn) sn = strdup("NULL");
-                        DString* ds = ds_new();
-                        ds_printf(ds, "(%s || %s)", sr, sn);
-                        if (!is_code(next)) free(sn);
-                        char* code_str = ds_take(ds);
-                        result = mk_code(code_str);
-                        free(code_str);
-                        remaining = cdr(remaining);
-                    }
-                    return result;
-                }
-                if (!is_nil(result)) return result;
-                rest = cdr(rest);
-            }
-            return NIL;
-        }
+enum {
+    SF_NONE = 0,
+    SF_QUOTE, SF_LIFT, SF_IF, SF_LET, SF_LETREC, SF_AND, SF_OR, SF_LAMBDA,
+    SF_EM, SF_SET_META, SF_SCAN, SF_SET_BANG, SF_DEFINE, SF_DO,
+    SF_CALL_CC, SF_PROMPT, SF_CONTROL, SF_GO, SF_SELECT, SF_DEFTYPE,
+    SF_GET_META,
+    SF_COUNT
+};
 
-        if (sym_eq(op, SYM_LAMBDA)) {
-            Value* params = car(args);
-            Value* body = car(cdr(args));
-            return mk_lambda(params, body, menv->menv.env);
-        }
+static Value* sf_quote(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)menv; (void)tail;
+    return car(args);
+}
 
-        if (sym_eq(op, SYM_EM)) {
-            Value* e = car(args);
-            Value* parent = menv->menv.parent;
-            if (is_nil(parent)) {
-                parent = mk_menv(NIL, NIL);
-                if (!parent) return NIL;
-                menv->menv.parent = parent;
-            }
-            return eval(e, parent);
-        }
+static Value* sf_lift(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return lift_value(eval(car(args), menv));
+}
 
-        if (sym_eq(op, SYM_SET_META)) {
-            Value* key = eval(car(args), menv);
-            if (!key || key->tag != T_SYM) key = car(args);
-            Value* val = eval(car(cdr(args)), menv);
-            if (sym_eq_str(key, "add")) {
-                menv->menv.env = env_extend(menv->menv.env, mk_sym("+"), val);
-            }
-            return NIL;
-        }
+static Value* sf_if(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)args;
+    if (menv->menv.h_if == h_if_default) return if_step(expr, menv, tail);
+    return menv->menv.h_if(expr, menv);
+}
 
-        if (sym_eq(op, SYM_SCAN)) {
-            Value* type_sym = eval(car(args), menv);
-            Value* val = eval(car(cdr(args)), menv);
-            if (!type_sym || type_sym->tag != T_SYM || !type_sym->s) return NIL;
-            if (!val) return NIL;
-            char* sval = (val->tag == T_CODE) ? val->s : val_to_str(val);
-            if (!sval) return NIL;
-            DString* ds = ds_new();
-            ds_printf(ds, "scan_%s(%s); // ASAP Mark", type_sym->s, sval);
-            if (val->tag != T_CODE) free(sval);
-            char* code_str = ds_take(ds);
-            Value* result = mk_code(code_str);
-            free(code_str);
-            return result;
-        }
-
-        // set! - mutate existing variable binding
-        if (sym_eq(op, SYM_SET_BANG)) {
-            Value* var_sym = car(args);
-            if (!var_sym || var_sym->tag != T_SYM) {
-                return mk_error("set!: first argument must be a symbol");
-            }
-            Value* new_val = eval(car(cdr(args)), menv);
-            // Try local env first
-            if (env_set(menv->menv.env, var_sym, new_val)) {
-                return new_val;
-            }
-            // Try global env
-            if (env_set(global_env, var_sym, new_val)) {
-                return new_val;
-            }
-            printf("Error: set!: unbound variable %s\n", var_sym->s);
-            return mk_error("set!: unbound variable");
-        }
-
-        // define - create global binding
-        if (sym_eq(op, SYM_DEFINE)) {
-            Value* first = car(args);
-            // Case 1: (define (name args...) body) - function shorthand
-            if (first && first->tag == T_CELL) {
-                Value* name = car(first);
-                if (!name || name->tag != T_SYM) {
-                    return mk_error("define: function name must be a symbol");
-                }
-                Value* params = cdr(first);
-                Value* body = car(cdr(args));
-                Value* lam = mk_lambda(params, body, menv->menv.env);
-                global_define(name, lam);
-                return name;
-            }
-            // Case 2: (define name value)
-            if (!first || first->tag != T_SYM) {
-                return mk_error("define: first argument must be a symbol or (name args...)");
-            }
-            if (is_nil(cdr(args))) {
-                return mk_error("define: requires a value");
-            }
-            Value* val = eval(car(cdr(args)), menv);
-            global_define(first, val);
-            return first;
-        }
-
-        // do - evaluate sequence, return last result
-        if (sym_eq(op, SYM_DO)) {
-            Value* result = NIL;
-            Value* rest = args;
-            while (!is_nil(rest)) {
-                result = eval(car(rest), menv);
-                rest = cdr(rest);
-            }
-            return result;
-        }
+static Value* sf_let(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)args;
+    if (menv->menv.h_let == h_let_default) return let_step(expr, menv, tail);
+    return menv->menv.h_let(expr, menv);
+}
 
-        // call/cc - call with current continuation
-        if (sym_eq(op, SYM_CALL_CC)) {
-            return eval_call_cc(args, menv);
-        }
+// letrec - recursive let binding
+static Value* sf_letrec(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr;
+    Value* bindings = car(args);
+    Value* body = car(cdr(args));
 
-        // prompt - establish delimiter for control
-        if (sym_eq(op, SYM_PROMPT)) {
-            return eval_prompt(args, menv);
-        }
+    // First pass: one frame with a placeholder per binding
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    int count = 0;
+    Value* b = bindings;
+    while (!is_nil(b)) {
+        Value* cell = mk_cell(car(car(b)), NIL);
+        if (!cell) return NIL;
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+        count++;
+        b = cdr(b);
+    }
+    Value* new_env = mk_frame(names, count, menv->menv.env);
+    if (!new_env) return NIL;
+    for (int i = 0; i < count; i++) {
+        new_env->frame.slots[i] = SYM_UNINIT;  // Placeholder
+    }
 
-        // control - capture delimited continuation
-        if (sym_eq(op, SYM_CONTROL)) {
-            return eval_control(args, menv);
-        }
+    // Create new menv for evaluating bindings
+    Value* rec_menv = mk_menv(menv->menv.parent, new_env);
+    if (!rec_menv) return NIL;
+    rec_menv->menv.h_app = menv->menv.h_app;
+    rec_menv->menv.h_let = menv->menv.h_let;
+    rec_menv->menv.h_if = menv->menv.h_if;
+
+    // Second pass: evaluate and fill the placeholders
+    b = bindings;
+    for (int i = 0; i < count; i++) {
+        Value* val_expr = car(cdr(car(b)));
+        Value* val = eval(val_expr, rec_menv);
+        new_env->frame.slots[i] = val ? val : NIL;
+        b = cdr(b);
+    }
 
-        // go - spawn green thread
-        if (sym_eq(op, SYM_GO)) {
-            return eval_go(args, menv);
-        }
+    return tail_to(tail, body, rec_menv);
+}
 
-        // select - wait on multiple channels
-        if (sym_eq(op, SYM_SELECT)) {
-            return eval_select(args, menv);
-        }
+// Short-circuit and
+// ((a op b) op c) ... for a code operand followed by the rest, written
+// into one buffer: each operand is copied once, however long the chain
+static Value* logic_chain_code(Value* result, Value* rest, const char* op, Value* menv) {
+    if (is_nil(rest)) return result;
+    CodeBuilder cb;
+    cb_init(&cb);
+    for (Value* r = rest; !is_nil(r); r = cdr(r)) cb_text(&cb, "(");
+    cb_code(&cb, result);
+    for (; !is_nil(rest); rest = cdr(rest)) {
+        cb_textf(&cb, " %s ", op);
+        cb_block_value(&cb, eval(car(rest), menv));
+        cb_text(&cb, ")");
+    }
+    return cb_finish(&cb);
+}
 
-        // deftype - define user type
-        if (sym_eq_str(op, "deftype")) {
-            return eval_deftype(args, menv);
+static Value* sf_and(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr;
+    Value* rest = args;
+    Value* result = SYM_T;
+    while (!is_nil(rest)) {
+        if (is_nil(cdr(rest))) {
+            // Last operand: its value (code or not) is the result
+            return tail_to(tail, car(rest), menv);
         }
+        result = eval(car(rest), menv);
+        if (is_code(result)) {
+            // At code level, generate && chain
+            return logic_chain_code(result, cdr(rest), "&&", menv);
+        }
+        if (is_nil(result)) return NIL;
+        rest = cdr(rest);
+    }
+    return result;
+}
 
-        return menv->menv.h_app(expr, menv);
+// Short-circuit or
+static Value* sf_or(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr;
+    Value* rest = args;
+    while (!is_nil(rest)) {
+        if (is_nil(cdr(rest))) {
+            return tail_to(tail, car(rest), menv);
+        }
+        Value* result = eval(car(rest), menv);
+        if (is_code(result)) {
+            // At code level, generate || chain
+            return logic_chain_code(result, cdr(rest), "||", menv);
+        }
+        if (!is_nil(result)) return result;
+        rest = cdr(rest);
     }
     return NIL;
 }
 
-// -- Primitives --
-
-// Helper: safely get two int args, return 0 on error
-static int get_two_args(Value* args, Value** a, Value** b) {
-    if (!args || is_nil(args)) return 0;
-    *a = car(args);
-    if (!*a) return 0;
-    Value* rest = cdr(args);
-    if (!rest || is_nil(rest)) return 0;
-    *b = car(rest);
-    if (!*b) return 0;
-    return 1;
+static Value* sf_lambda(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* params = car(args);
+    node_shared_enter();
+    Value* body = resolve_lambda_body(args, params, car(cdr(args)));
+    node_shared_leave();
+    return mk_lambda(params, body, menv->menv.env);
 }
 
-Value* prim_add(Value* args, Value* menv) {
-    (void)menv;
-    Value* a; Value* b;
-    if (!get_two_args(args, &a, &b)) return NIL;
-    if (is_code(a) || is_code(b)) return emit_c_call("add", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    // Overflow protection: return 0 on overflow (consistent with generated code)
-    if ((b->i > 0 && a->i > LONG_MAX - b->i) ||
-        (b->i < 0 && a->i < LONG_MIN - b->i)) {
-        return mk_int(0);
+static Value* sf_em(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* e = car(args);
+    Value* parent = menv->menv.parent;
+    if (is_nil(parent)) {
+        parent = mk_menv(NIL, NIL);
+        if (!parent) return NIL;
+        note_mutation();
+        menv->menv.parent = parent;
     }
-    return mk_int(a->i + b->i);
+    return eval(e, parent);
 }
 
-Value* prim_sub(Value* args, Value* menv) {
-    (void)menv;
-    Value* a; Value* b;
-    if (!get_two_args(args, &a, &b)) return NIL;
-    if (is_code(a) || is_code(b)) return emit_c_call("sub", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    // Overflow protection: return 0 on overflow (consistent with generated code)
-    if ((b->i < 0 && a->i > LONG_MAX + b->i) ||
-        (b->i > 0 && a->i < LONG_MIN + b->i)) {
-        return mk_int(0);
+static Value* sf_set_meta(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* key = eval(car(args), menv);
+    if (!key || val_tag(key) != T_SYM) key = car(args);
+    Value* val = eval(car(cdr(args)), menv);
+    if (sym_eq_str(key, "add")) {
+        note_mutation();
+        menv->menv.env = env_extend(menv->menv.env, mk_sym("+"), val);
     }
-    return mk_int(a->i - b->i);
+    return NIL;
 }
 
-Value* prim_cons(Value* args, Value* menv) {
-    (void)menv;
-    Value* a; Value* b;
-    if (!get_two_args(args, &a, &b)) return NIL;
-    if (is_code(a) || is_code(b)) return emit_c_call("mk_pair", a, b);
-    return mk_cell(a, b);
+static Value* sf_scan(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* type_sym = eval(car(args), menv);
+    Value* val = eval(car(cdr(args)), menv);
+    if (!type_sym || val_tag(type_sym) != T_SYM || !type_sym->s) return NIL;
+    if (!val) return NIL;
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_textf(&cb, "scan_%s(", type_sym->s);
+    cb_block_value(&cb, val);
+    cb_text(&cb, "); // ASAP Mark");
+    return cb_finish(&cb);
 }
 
-Value* prim_run(Value* args, Value* menv) {
-    Value* a = car(args);
-    if (!a) return NIL;
-    return eval(a, menv);
+// get-meta - reflective view of the meta-environment
+// (get-meta 'env) returns the current bindings as an assoc list
+static Value* sf_get_meta(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* key = eval(car(args), menv);
+    if (!key || val_tag(key) != T_SYM) key = car(args);
+    if (sym_eq_str(key, "env")) {
+        return env_to_list(menv->menv.env);
+    }
+    return NIL;
 }
 
-// -- Additional Arithmetic Primitives --
-
-Value* prim_mul(Value* args, Value* menv) {
-    (void)menv;
-    Value* a; Value* b;
-    if (!get_two_args(args, &a, &b)) return NIL;
-    if (is_code(a) || is_code(b)) return emit_c_call("mul", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    // Overflow protection: return 0 on overflow (consistent with generated code)
-    if (a->i > 0 && b->i > 0 && a->i > LONG_MAX / b->i) return mk_int(0);
-    if (a->i > 0 && b->i < 0 && b->i < LONG_MIN / a->i) return mk_int(0);
-    if (a->i < 0 && b->i > 0 && a->i < LONG_MIN / b->i) return mk_int(0);
-    if (a->i < 0 && b->i < 0 && a->i < LONG_MAX / b->i) return mk_int(0);
-    return mk_int(a->i * b->i);
+// set! - mutate existing variable binding
+static Value* sf_set_bang(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* var_sym = car(args);
+    if (!var_sym || val_tag(var_sym) != T_SYM) {
+        return mk_error("set!: first argument must be a symbol");
+    }
+    Value* new_val = eval(car(cdr(args)), menv);
+    // Try local env first
+    if (env_set(menv->menv.env, var_sym, new_val)) {
+        return new_val;
+    }
+    // Try global env
+    if (global_set(var_sym, new_val)) {
+        return new_val;
+    }
+    printf("Error: set!: unbound variable %s\n", var_sym->s);
+    return mk_error("set!: unbound variable");
 }
 
-Value* prim_div(Value* args, Value* menv) {
-    (void)menv;
+// define - create global binding
+static Value* sf_define(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    Value* first = car(args);
+    // Case 1: (define (name args...) body) - function shorthand
+    if (first && val_tag(first) == T_CELL) {
+        Value* name = car(first);
+        if (!name || val_tag(name) != T_SYM) {
+            return mk_error("define: function name must be a symbol");
+        }
+        Value* params = cdr(first);
+        Value* body = resolve_lambda_body(args, params, car(cdr(args)));
+        Value* lam = mk_lambda(params, body, menv->menv.env);
+        global_define(name, lam);
+        return name;
+    }
+    // Case 2: (define name value)
+    if (!first || val_tag(first) != T_SYM) {
+        return mk_error("define: first argument must be a symbol or (name args...)");
+    }
+    if (is_nil(cdr(args))) {
+        return mk_error("define: requires a value");
+    }
+    Value* val = eval(car(cdr(args)), menv);
+    global_define(first, val);
+    return first;
+}
+
+// do - evaluate sequence, return last result
+static Value* sf_do(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr;
+    Value* rest = args;
+    while (!is_nil(rest) && !is_nil(cdr(rest))) {
+        eval(car(rest), menv);
+        rest = cdr(rest);
+    }
+    return tail_to(tail, car(rest), menv);
+}
+
+static Value* sf_call_cc(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_call_cc(args, menv);
+}
+
+static Value* sf_prompt(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_prompt(args, menv);
+}
+
+static Value* sf_control(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_control(args, menv);
+}
+
+static Value* sf_go(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_go(args, menv);
+}
+
+static Value* sf_select(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_select(args, menv);
+}
+
+static Value* sf_deftype(Value* expr, Value* args, Value* menv, TailCall* tail) {
+    (void)expr; (void)tail;
+    return eval_deftype(args, menv);
+}
+
+static const SpecialFormFn special_forms[SF_COUNT] = {
+    [SF_NONE]     = NULL,
+    [SF_QUOTE]    = sf_quote,
+    [SF_LIFT]     = sf_lift,
+    [SF_IF]       = sf_if,
+    [SF_LET]      = sf_let,
+    [SF_LETREC]   = sf_letrec,
+    [SF_AND]      = sf_and,
+    [SF_OR]       = sf_or,
+    [SF_LAMBDA]   = sf_lambda,
+    [SF_EM]       = sf_em,
+    [SF_SET_META] = sf_set_meta,
+    [SF_SCAN]     = sf_scan,
+    [SF_SET_BANG] = sf_set_bang,
+    [SF_DEFINE]   = sf_define,
+    [SF_DO]       = sf_do,
+    [SF_CALL_CC]  = sf_call_cc,
+    [SF_PROMPT]   = sf_prompt,
+    [SF_CONTROL]  = sf_control,
+    [SF_GO]       = sf_go,
+    [SF_SELECT]   = sf_select,
+    [SF_DEFTYPE]  = sf_deftype,
+    [SF_GET_META] = sf_get_meta,
+};
+
+static void register_special_forms(void) {
+    Value* forms[SF_COUNT] = {
+        [SF_QUOTE] = SYM_QUOTE, [SF_LIFT] = SYM_LIFT, [SF_IF] = SYM_IF,
+        [SF_LET] = SYM_LET, [SF_LETREC] = SYM_LETREC, [SF_AND] = SYM_AND,
+        [SF_OR] = SYM_OR, [SF_LAMBDA] = SYM_LAMBDA, [SF_EM] = SYM_EM,
+        [SF_SET_META] = SYM_SET_META, [SF_SCAN] = SYM_SCAN,
+        [SF_SET_BANG] = SYM_SET_BANG, [SF_DEFINE] = SYM_DEFINE,
+        [SF_DO] = SYM_DO, [SF_CALL_CC] = SYM_CALL_CC,
+        [SF_PROMPT] = SYM_PROMPT, [SF_CONTROL] = SYM_CONTROL,
+        [SF_GO] = SYM_GO, [SF_SELECT] = SYM_SELECT,
+        [SF_DEFTYPE] = SYM_DEFTYPE, [SF_GET_META] = SYM_GET_META,
+    };
+    for (int i = 1; i < SF_COUNT; i++) {
+        if (forms[i]) forms[i]->sym_form = i;
+    }
+}
+
+// -- Closure Compiler --
+// Each form is compiled once into a Node: the C function that runs it plus
+// its operands resolved ahead of time (child nodes, constants, binder
+// names, pre-resolved lambda bodies). Evaluation then chains indirect
+// calls instead of re-dispatching on the AST. Nodes consult the MEnv
+// hooks only when one has been overridden, and forms the compiler does not
+// model run through their special-form handler, so reflective semantics
+// are unchanged.
+
+typedef struct Node Node;
+typedef Value* (*NodeFn)(Node* n, Value* menv, TailCall* tail);
+
+struct Node {
+    NodeFn run;
+    Value* expr;        // Source form, handed to hooks and handlers
+    Value* val;         // Constant, variable, binder names or lambda params
+    Value* body;        // Resolved lambda body
+    Node** kids;        // NULL kid: the form was nil
+    int nkids;
+    Value* root;        // node_var: assoc env the cached cell was found in
+    Value* pair;        // node_var: its (sym . val) cell, NIL for global
+    int cached;
+    Node* next;         // Allocation chain, for node_reset
+};
+
+// Form -> Node
+static HashMap* node_cache = NULL;
+static Node* node_list = NULL;
+
+// While parallel processes run, the node cache (and the resolver behind
+// it) is shared: each thread looks up its own small direct-mapped cache
+// first and takes the lock only on a miss. Locking nests, since compiling
+// a node compiles its kids.
+#define NODE_LOCAL_SIZE 512
+
+typedef struct NodeSlot {
+    Value* expr;
+    Node* node;
+} NodeSlot;
+
+static pthread_mutex_t node_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int node_lock_depth = 0;
+static __thread NodeSlot node_local[NODE_LOCAL_SIZE];
+
+static void node_shared_enter(void) {
+    if (sched_parallel && node_lock_depth++ == 0) pthread_mutex_lock(&node_lock);
+}
+
+static void node_shared_leave(void) {
+    if (sched_parallel && --node_lock_depth == 0) pthread_mutex_unlock(&node_lock);
+}
+
+void eval_shared_enter(void) {
+    node_shared_enter();
+}
+
+void eval_shared_leave(void) {
+    node_shared_leave();
+}
+
+static void node_reset(void) {
+    while (node_list) {
+        Node* next = node_list->next;
+        free(node_list->kids);
+        free(node_list);
+        node_list = next;
+    }
+    // Arena-backed: dropping every entry is a bucket wipe
+    if (node_cache) hashmap_clear(node_cache);
+}
+
+static Value* eval_atom(Value* expr, Value* menv) {
+    if (val_tag(expr) == T_INT) return menv->menv.h_lit(expr, menv);
+    if (val_tag(expr) == T_CODE) return expr;
+    if (val_tag(expr) == T_SYM) return menv->menv.h_var(expr, menv);
+    if (val_tag(expr) == T_LREF) return eval_lref(expr, menv);
+    return NIL;
+}
+
+static Value* node_eval(Node* n, Value* menv) {
+    return n ? run_node(n, menv) : NIL;
+}
+
+static Value* tail_node(TailCall* tail, Node* n, Value* menv) {
+    if (!n) return NIL;
+    tail->expr = n->expr;
+    tail->node = n;
+    tail->menv = menv;
+    return NIL;
+}
+
+static Value* node_atom(Node* n, Value* menv, TailCall* tail) {
+    (void)tail;
+    return eval_atom(n->expr, menv);
+}
+
+// Free variable. Past the frames an environment is a chain of cells that
+// is never relinked (set! writes the cell), so the binding cell found in a
+// given chain is found once; frames, letrec placeholders and overridden
+// hooks go through h_var.
+static Value* node_var(Node* n, Value* menv, TailCall* tail) {
+    (void)tail;
+    if (menv->menv.h_var != h_var_default) return menv->menv.h_var(n->val, menv);
+
+    Value* e = menv->menv.env;
+    while (val_tag(e) == T_FRAME) {
+        int slot = frame_slot(e, n->val);
+        if (slot >= 0) return h_var_default(n->val, menv);
+        e = e->frame.next;
+    }
+    if (sched_parallel && (!n->cached || n->root != e)) {
+        // Other threads read this node too: look up, leave the cache be
+        Value* pair = NIL;
+        for (Value* r = e; !is_nil(r); r = r->cell.cdr) {
+            if (val_tag(r) != T_CELL) return h_var_default(n->val, menv);
+            Value* p = r->cell.car;
+            if (p && val_tag(p) == T_CELL && p->cell.car == n->val) {
+                pair = p;
+                break;
+            }
+        }
+        Value* v = pair != NIL ? pair->cell.cdr : global_lookup(n->val);
+        if (v && v != SYM_UNINIT) return v;
+        return h_var_default(n->val, menv);
+    }
+    if (!n->cached || n->root != e) {
+        Value* pair = NIL;
+        for (Value* r = e; !is_nil(r); r = r->cell.cdr) {
+            if (val_tag(r) != T_CELL) return h_var_default(n->val, menv);
+            Value* p = r->cell.car;
+            if (p && val_tag(p) == T_CELL && p->cell.car == n->val) {
+                pair = p;
+                break;
+            }
+        }
+        n->root = e;
+        n->pair = pair;
+        n->cached = 1;
+    }
+    if (n->pair != NIL) {
+        Value* v = n->pair->cell.cdr;
+        if (v && v != SYM_UNINIT) return v;
+    } else {
+        Value* v = global_lookup(n->val);
+        if (v) return v;
+    }
+    return h_var_default(n->val, menv);
+}
+
+static Value* node_quote(Node* n, Value* menv, TailCall* tail) {
+    (void)menv; (void)tail;
+    return n->val;
+}
+
+// Anything not compiled natively: the evaluator's own dispatch
+static Value* node_form(Node* n, Value* menv, TailCall* tail) {
+    Value* op = car(n->expr);
+    if (op && val_tag(op) == T_SYM && op->sym_form) {
+        return special_forms[op->sym_form](n->expr, cdr(n->expr), menv, tail);
+    }
+    if (menv->menv.h_app == h_app_default) return app_step(n->expr, menv, tail);
+    return menv->menv.h_app(n->expr, menv);
+}
+
+static Value* node_if(Node* n, Value* menv, TailCall* tail) {
+    if (menv->menv.h_if != h_if_default) return menv->menv.h_if(n->expr, menv);
+    Value* c = node_eval(n->kids[0], menv);
+    long k;
+    if (code_int_value(c, &k)) return tail_node(tail, k ? n->kids[1] : n->kids[2], menv);
+    if (is_code(c)) {
+        Value* args = cdr(n->expr);
+        return if_code(c, car(cdr(args)), car(cdr(cdr(args))), menv);
+    }
+    return tail_node(tail, is_nil(c) ? n->kids[2] : n->kids[1], menv);
+}
+
+static Value* node_app(Node* n, Value* menv, TailCall* tail) {
+    if (menv->menv.h_app != h_app_default) return menv->menv.h_app(n->expr, menv);
+
+    Value* fn = node_eval(n->kids[0], menv);
+    if (!fn) return NIL;
+    int argc = n->nkids - 1;
+
+    if (val_tag(fn) == T_PRIM && fn->prim2 && argc == 2) {
+        Value* a = node_eval(n->kids[1], menv);
+        Value* b = node_eval(n->kids[2], menv);
+        if (!a || !b) return NIL;
+        return fn->prim2(a, b);
+    }
+
+    Value* args = NIL;
+    Value* args_tail = NULL;
+    for (int i = 1; i <= argc; i++) {
+        Value* cell = mk_cell(node_eval(n->kids[i], menv), NIL);
+        if (!cell) return NIL;
+        if (args_tail) args_tail->cell.cdr = cell;
+        else args = cell;
+        args_tail = cell;
+    }
+
+    if (val_tag(fn) == T_PRIM) return fn->prim(args, menv);
+
+    if (val_tag(fn) == T_CONT) {
+        return invoke_continuation(fn, is_nil(args) ? NIL : car(args));
+    }
+
+    if (val_tag(fn) == T_LAMBDA) {
+        Value* new_env = bind_params(fn->lam.params, args, fn->lam.env);
+        if (!new_env) return NIL;
+        if (profile_active) profile_call(fn->lam.body);
+
+        if (menv_has_default_handlers(menv)) {
+            return tail_with_env(tail, fn->lam.body, menv, new_env);
+        }
+
+        Value* body_menv = mk_menv(menv->menv.parent, new_env);
+        if (!body_menv) return NIL;
+        body_menv->menv.h_app = menv->menv.h_app;
+        body_menv->menv.h_let = menv->menv.h_let;
+        body_menv->menv.h_if = menv->menv.h_if;
+
+        return tail_to(tail, fn->lam.body, body_menv);
+    }
+
+    char* fn_str = val_to_str(fn);
+    printf("Error: Not a function: %s\n", fn_str ? fn_str : "(null)");
+    free(fn_str);
+    return NIL;
+}
+
+// kids: one per well-formed binder, then the body; val: binder names
+static Value* node_let(Node* n, Value* menv, TailCall* tail) {
+    if (menv->menv.h_let != h_let_default) return menv->menv.h_let(n->expr, menv);
+
+    int count = n->nkids - 1;
+    Node* body = n->kids[count];
+    Value* new_env = mk_frame(n->val, count, menv->menv.env);
+    int any_code = 0;
+    for (int i = 0; i < count; i++) {
+        Value* val = node_eval(n->kids[i], menv);
+        if (!val) val = NIL;
+        if (val_tag(val) == T_CODE) any_code = 1;
+        if (new_env) new_env->frame.slots[i] = val;
+    }
+
+    if (!new_env || any_code) {
+        // Staged or out of memory: hand the values to the general path
+        BindingInfo* bind_list = NULL;
+        BindingInfo* bind_tail = NULL;
+        int oom = !new_env;
+        Value* names = n->val;
+        for (int i = 0; i < count && !oom; i++, names = cdr(names)) {
+            BindingInfo* info = malloc(sizeof(BindingInfo));
+            if (!info) {
+                oom = 1;
+                break;
+            }
+            info->sym = car(names);
+            info->val = new_env->frame.slots[i];
+            info->next = NULL;
+            if (bind_tail) bind_tail->next = info;
+            else bind_list = info;
+            bind_tail = info;
+        }
+        Value* result = let_finish(n->expr, menv, bind_list, n->val, count, any_code, oom, tail);
+        if (tail->expr) tail->node = body;
+        return result;
+    }
+
+    if (!body) return NIL;
+    if (menv_has_default_handlers(menv)) {
+        tail_with_env(tail, body->expr, menv, new_env);
+        tail->node = body;
+        return NIL;
+    }
+
+    Value* body_menv = mk_menv(menv->menv.parent, new_env);
+    if (!body_menv) return NIL;
+    body_menv->menv.h_app = menv->menv.h_app;
+    body_menv->menv.h_let = menv->menv.h_let;
+    return tail_node(tail, body, body_menv);
+}
+
+// kids: one per binder, then the body; val: binder names
+static Value* node_letrec(Node* n, Value* menv, TailCall* tail) {
+    int count = n->nkids - 1;
+    Value* new_env = mk_frame(n->val, count, menv->menv.env);
+    if (!new_env) return NIL;
+    for (int i = 0; i < count; i++) {
+        new_env->frame.slots[i] = SYM_UNINIT;
+    }
+
+    Value* rec_menv = mk_menv(menv->menv.parent, new_env);
+    if (!rec_menv) return NIL;
+    rec_menv->menv.h_app = menv->menv.h_app;
+    rec_menv->menv.h_let = menv->menv.h_let;
+    rec_menv->menv.h_if = menv->menv.h_if;
+
+    Value* names = n->val;
+    for (int i = 0; i < count; i++, names = cdr(names)) {
+        Value* val = node_eval(n->kids[i], rec_menv);
+        new_env->frame.slots[i] = val ? val : NIL;
+        if (profile_active && val && val_tag(val) == T_LAMBDA) profile_name(val->lam.body, car(names)->s);
+    }
+
+    return tail_node(tail, n->kids[count], rec_menv);
+}
+
+// Code-level and/or: fold the remaining operands into a C && / || chain
+static Value* node_logic_code(Node* n, int from, Value* result, const char* op, Value* menv) {
+    if (from >= n->nkids) return result;
+    CodeBuilder cb;
+    cb_init(&cb);
+    for (int i = from; i < n->nkids; i++) cb_text(&cb, "(");
+    cb_code(&cb, result);
+    for (int i = from; i < n->nkids; i++) {
+        cb_textf(&cb, " %s ", op);
+        cb_block_value(&cb, node_eval(n->kids[i], menv));
+        cb_text(&cb, ")");
+    }
+    return cb_finish(&cb);
+}
+
+static Value* node_and(Node* n, Value* menv, TailCall* tail) {
+    Value* result = SYM_T;
+    for (int i = 0; i < n->nkids; i++) {
+        if (i == n->nkids - 1) return tail_node(tail, n->kids[i], menv);
+        result = node_eval(n->kids[i], menv);
+        if (is_code(result)) return node_logic_code(n, i + 1, result, "&&", menv);
+        if (is_nil(result)) return NIL;
+    }
+    return result;
+}
+
+static Value* node_or(Node* n, Value* menv, TailCall* tail) {
+    for (int i = 0; i < n->nkids; i++) {
+        if (i == n->nkids - 1) return tail_node(tail, n->kids[i], menv);
+        Value* result = node_eval(n->kids[i], menv);
+        if (is_code(result)) return node_logic_code(n, i + 1, result, "||", menv);
+        if (!is_nil(result)) return result;
+    }
+    return NIL;
+}
+
+static Value* node_do(Node* n, Value* menv, TailCall* tail) {
+    if (n->nkids == 0) return NIL;
+    for (int i = 0; i < n->nkids - 1; i++) {
+        node_eval(n->kids[i], menv);
+    }
+    return tail_node(tail, n->kids[n->nkids - 1], menv);
+}
+
+static Value* node_lambda(Node* n, Value* menv, TailCall* tail) {
+    (void)tail;
+    return mk_lambda(n->val, n->body, menv->menv.env);
+}
+
+// Escape-only call/cc (oneshot.h): val: the lambda's (k), body: its
+// resolved body, run in a frame binding k to a continuation that returns
+static Value* node_call_cc_return(Node* n, Value* menv, TailCall* tail) {
+    Value* k = mk_cont(NULL, menv, CONT_TAG_RETURN);
+    Value* new_env = k ? bind_params(n->val, mk_cell(k, NIL), menv->menv.env) : NULL;
+    if (!new_env) return NIL;
+
+    if (menv_has_default_handlers(menv)) {
+        return tail_with_env(tail, n->body, menv, new_env);
+    }
+
+    Value* body_menv = mk_menv(menv->menv.parent, new_env);
+    if (!body_menv) return NIL;
+    body_menv->menv.h_app = menv->menv.h_app;
+    body_menv->menv.h_let = menv->menv.h_let;
+    body_menv->menv.h_if = menv->menv.h_if;
+    return tail_to(tail, n->body, body_menv);
+}
+
+static Node* node_for(Value* expr);
+
+static Node* node_new(NodeFn run, Value* expr, int nkids) {
+    Node* n = calloc(1, sizeof(Node));
+    if (!n) return NULL;
+    if (nkids > 0) {
+        n->kids = calloc(nkids, sizeof(Node*));
+        if (!n->kids) {
+            free(n);
+            return NULL;
+        }
+    }
+    n->run = run;
+    n->expr = expr;
+    n->nkids = nkids;
+    n->next = node_list;
+    node_list = n;
+    return n;
+}
+
+// Node for a subform; sets *failed on allocation failure
+static Node* compile_kid(Value* e, int* failed) {
+    if (is_nil(e)) return NULL;
+    Node* n;
+    if (val_tag(e) == T_CELL) {
+        n = node_for(e);
+    } else if (val_tag(e) == T_SYM) {
+        n = node_new(node_var, e, 0);
+        if (n) n->val = e;
+    } else {
+        n = node_new(node_atom, e, 0);
+    }
+    if (!n) *failed = 1;
+    return n;
+}
+
+static int list_length(Value* v) {
+    int n = 0;
+    for (; v && val_tag(v) == T_CELL; v = v->cell.cdr) n++;
+    return is_nil(v) ? n : -1;
+}
+
+// Node whose kids are the elements of list, with `extra` slots after them
+static Node* compile_seq(NodeFn run, Value* e, Value* list, int extra) {
+    int len = list_length(list);
+    if (len < 0) return node_new(node_form, e, 0);
+    Node* n = node_new(run, e, len + extra);
+    if (!n) return NULL;
+    int failed = 0;
+    int i = 0;
+    for (Value* l = list; !is_nil(l); l = cdr(l)) {
+        n->kids[i++] = compile_kid(car(l), &failed);
+    }
+    return failed ? NULL : n;
+}
+
+static Node* compile_let_node(Value* e, int rec) {
+    Value* args = cdr(e);
+    int failed = 0;
+    int count = 0;
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    for (Value* b = car(args); !is_nil(b); b = cdr(b)) {
+        Value* sym = car(car(b));
+        // let skips malformed binders, letrec binds whatever is there
+        if (!rec && (!sym || val_tag(sym) != T_SYM || !sym->s)) continue;
+        Value* cell = mk_cell(sym, NIL);
+        if (!cell) return NULL;
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+        count++;
+    }
+
+    Node* n = node_new(rec ? node_letrec : node_let, e, count + 1);
+    if (!n) return NULL;
+    n->val = names;
+    int i = 0;
+    for (Value* b = car(args); !is_nil(b); b = cdr(b)) {
+        Value* sym = car(car(b));
+        if (!rec && (!sym || val_tag(sym) != T_SYM || !sym->s)) continue;
+        n->kids[i++] = compile_kid(car(cdr(car(b))), &failed);
+    }
+    n->kids[count] = compile_kid(car(cdr(args)), &failed);
+    return failed ? NULL : n;
+}
+
+static Node* compile_node(Value* e) {
+    Value* op = e->cell.car;
+    Value* args = e->cell.cdr;
+
+    if (!op || val_tag(op) != T_SYM || !op->sym_form) {
+        if (list_length(args) < 0) return node_new(node_form, e, 0);
+        Node* n = compile_seq(node_app, e, args, 1);
+        if (!n) return NULL;
+        // Shift the arguments up to make room for the operator
+        for (int i = n->nkids - 1; i > 0; i--) n->kids[i] = n->kids[i - 1];
+        int failed = 0;
+        n->kids[0] = compile_kid(op, &failed);
+        return failed ? NULL : n;
+    }
+
+    if (op == SYM_QUOTE) {
+        Node* n = node_new(node_quote, e, 0);
+        if (n) n->val = car(args);
+        return n;
+    }
+    if (list_length(args) < 0) return node_new(node_form, e, 0);
+
+    if (op == SYM_IF) {
+        Node* n = node_new(node_if, e, 3);
+        if (!n) return NULL;
+        int failed = 0;
+        n->kids[0] = compile_kid(car(args), &failed);
+        n->kids[1] = compile_kid(car(cdr(args)), &failed);
+        n->kids[2] = compile_kid(car(cdr(cdr(args))), &failed);
+        return failed ? NULL : n;
+    }
+    if (op == SYM_LET) return compile_let_node(e, 0);
+    if (op == SYM_LETREC) return compile_let_node(e, 1);
+    if (op == SYM_AND) return compile_seq(node_and, e, args, 0);
+    if (op == SYM_OR) return compile_seq(node_or, e, args, 0);
+    if (op == SYM_DO) return compile_seq(node_do, e, args, 0);
+    if (op == SYM_CALL_CC && !is_nil(args) && is_nil(cdr(args)) && cont_escape_only(car(args))) {
+        Value* lambda_args = cdr(car(args));
+        Node* n = node_new(node_call_cc_return, e, 0);
+        if (!n) return NULL;
+        n->val = car(lambda_args);
+        n->body = resolve_lambda_body(lambda_args, car(lambda_args), car(cdr(lambda_args)));
+        return n;
+    }
+    if (op == SYM_LAMBDA && !is_nil(args)) {
+        Node* n = node_new(node_lambda, e, 0);
+        if (!n) return NULL;
+        n->val = car(args);
+        n->body = resolve_lambda_body(args, car(args), car(cdr(args)));
+        return n;
+    }
+    return node_new(node_form, e, 0);
+}
+
+static Node* node_lookup(Value* expr) {
+    if (!node_cache) {
+        node_cache = hashmap_new_arena(64);
+        if (!node_cache) return NULL;
+    }
+    Node* n = hashmap_get(node_cache, expr);
+    if (n) return n;
+    n = compile_node(expr);
+    if (n) hashmap_put(node_cache, expr, n);
+    return n;
+}
+
+static Node* node_for(Value* expr) {
+    if (!sched_parallel) return node_lookup(expr);
+    NodeSlot* slot = &node_local[((uintptr_t)expr >> 4) & (NODE_LOCAL_SIZE - 1)];
+    if (slot->expr == expr) return slot->node;
+    node_shared_enter();
+    Node* n = node_lookup(expr);
+    node_shared_leave();
+    if (n) {
+        slot->expr = expr;
+        slot->node = n;
+    }
+    return n;
+}
+
+// -- Evaluator --
+
+static Value* run_loop(Node* n, Value* menv) {
+    Value* act = NULL;  // Activation record owned by this loop
+    Node fallback = { .run = node_form };
+    for (;;) {
+        TailCall tail = { NULL, NULL, NULL, NULL };
+        if (profile_active && n->run != node_app && val_tag(n->expr) == T_CELL) {
+            profile_stack.form = n->expr;
+        }
+        Value* result = n->run(n, menv, &tail);
+        if (!tail.expr && !tail.node) return result;
+
+        menv = tail.menv;
+        if (tail.env) {
+            // The caller's scope is dead in tail position: reuse our record
+            if (menv == act) {
+                act->menv.env = tail.env;
+            } else {
+                act = mk_menv(menv->menv.parent, tail.env);
+                if (!act) return NIL;
+            }
+            menv = act;
+        }
+        if (!menv) return NIL;
+
+        if (tail.node) {
+            n = tail.node;
+            continue;
+        }
+        Value* expr = tail.expr;
+        if (val_tag(expr) != T_CELL) return eval_atom(expr, menv);
+        n = node_for(expr);
+        if (!n) {
+            // Out of memory for nodes: dispatch on the form directly
+            fallback.expr = expr;
+            n = &fallback;
+        }
+    }
+}
+
+// Profiling: the frames a run enters are gone when it returns, or when a
+// continuation jumps past it and an outer run returns
+static Value* run_node(Node* n, Value* menv) {
+    if (!profile_active) return run_loop(n, menv);
+    ProfileMark mark = profile_mark();
+    Value* result = run_loop(n, menv);
+    profile_release(mark);
+    return result;
+}
+
+Value* eval(Value* expr, Value* menv) {
+    if (is_nil(expr)) return NIL;
+    if (!menv) return NIL;  // NULL check for menv
+    if (val_tag(expr) != T_CELL) return eval_atom(expr, menv);
+
+    Node* n = node_for(expr);
+    if (!n) {
+        Node fallback = { .run = node_form, .expr = expr };
+        return run_node(&fallback, menv);
+    }
+    return run_node(n, menv);
+}
+
+// -- Primitives --
+
+// Helper: safely get two int args, return 0 on error
+static int get_two_args(Value* args, Value** a, Value** b) {
+    if (!args || is_nil(args)) return 0;
+    *a = car(args);
+    if (!*a) return 0;
+    Value* rest = cdr(args);
+    if (!rest || is_nil(rest)) return 0;
+    *b = car(rest);
+    if (!*b) return 0;
+    return 1;
+}
+
+Value* prim_add2(Value* a, Value* b) {
+    if (is_code(a) || is_code(b)) return emit_c_call("add", a, b);
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    // Overflow protection: return 0 on overflow (consistent with generated code)
+    if ((val_int(b) > 0 && val_int(a) > LONG_MAX - val_int(b)) ||
+        (val_int(b) < 0 && val_int(a) < LONG_MIN - val_int(b))) {
+        return mk_int(0);
+    }
+    return mk_int(val_int(a) + val_int(b));
+}
+
+Value* prim_add(Value* args, Value* menv) {
+    (void)menv;
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_add2(a, b);
+}
+
+Value* prim_sub2(Value* a, Value* b) {
+    if (is_code(a) || is_code(b)) return emit_c_call("sub", a, b);
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    // Overflow protection: return 0 on overflow (consistent with generated code)
+    if ((val_int(b) < 0 && val_int(a) > LONG_MAX + val_int(b)) ||
+        (val_int(b) > 0 && val_int(a) < LONG_MIN + val_int(b))) {
+        return mk_int(0);
+    }
+    return mk_int(val_int(a) - val_int(b));
+}
+
+Value* prim_sub(Value* args, Value* menv) {
+    (void)menv;
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_sub2(a, b);
+}
+
+Value* prim_cons2(Value* a, Value* b) {
+    if (is_code(a) || is_code(b)) return emit_c_call("mk_pair", a, b);
+    return mk_cell(a, b);
+}
+
+Value* prim_cons(Value* args, Value* menv) {
+    (void)menv;
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_cons2(a, b);
+}
+
+Value* prim_run(Value* args, Value* menv) {
+    Value* a = car(args);
+    if (!a) return NIL;
+    return eval(a, menv);
+}
+
+// -- Additional Arithmetic Primitives --
+
+Value* prim_mul2(Value* a, Value* b) {
+    if (is_code(a) || is_code(b)) return emit_c_call("mul", a, b);
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    // Overflow protection: return 0 on overflow (consistent with generated code)
+    if (val_int(a) > 0 && val_int(b) > 0 && val_int(a) > LONG_MAX / val_int(b)) return mk_int(0);
+    if (val_int(a) > 0 && val_int(b) < 0 && val_int(b) < LONG_MIN / val_int(a)) return mk_int(0);
+    if (val_int(a) < 0 && val_int(b) > 0 && val_int(a) < LONG_MIN / val_int(b)) return mk_int(0);
+    if (val_int(a) < 0 && val_int(b) < 0 && val_int(a) < LONG_MAX / val_int(b)) return mk_int(0);
+    return mk_int(val_int(a) * val_int(b));
+}
+
+Value* prim_mul(Value* args, Value* menv) {
+    (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_mul2(a, b);
+}
+
+Value* prim_div2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("div_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    if (b->i == 0 || (a->i == LONG_MIN && b->i == -1)) return mk_int(0);
-    return mk_int(a->i / b->i);
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    if (val_int(b) == 0 || (val_int(a) == LONG_MIN && val_int(b) == -1)) return mk_int(0);
+    return mk_int(val_int(a) / val_int(b));
 }
 
-Value* prim_mod(Value* args, Value* menv) {
+Value* prim_div(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
-    if (is_code(a) || is_code(b)) return emit_c_call("mod_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    if (b->i == 0 || (a->i == LONG_MIN && b->i == -1)) return mk_int(0);
-    return mk_int(a->i % b->i);
+    return prim_div2(a, b);
 }
 
-// -- Comparison Primitives --
+Value* prim_mod2(Value* a, Value* b) {
+    if (is_code(a) || is_code(b)) return emit_c_call("mod_op", a, b);
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    if (val_int(b) == 0 || (val_int(a) == LONG_MIN && val_int(b) == -1)) return mk_int(0);
+    return mk_int(val_int(a) % val_int(b));
+}
 
-Value* prim_eq(Value* args, Value* menv) {
+Value* prim_mod(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_mod2(a, b);
+}
+
+// -- Comparison Primitives --
+
+Value* prim_eq2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("eq_op", a, b);
     // Handle different types
-    if (a->tag == T_INT && b->tag == T_INT) {
-        return a->i == b->i ? SYM_T : NIL;
+    if (val_tag(a) == T_INT && val_tag(b) == T_INT) {
+        return val_int(a) == val_int(b) ? SYM_T : NIL;
     }
-    if (a->tag == T_SYM && b->tag == T_SYM) {
+    if (val_tag(a) == T_SYM && val_tag(b) == T_SYM) {
         return sym_eq(a, b) ? SYM_T : NIL;
     }
-    if (a->tag == T_NIL && b->tag == T_NIL) return SYM_T;
+    if (val_tag(a) == T_NIL && val_tag(b) == T_NIL) return SYM_T;
     return NIL;
 }
 
-Value* prim_lt(Value* args, Value* menv) {
+Value* prim_eq(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_eq2(a, b);
+}
+
+Value* prim_lt2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("lt_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    return a->i < b->i ? SYM_T : NIL;
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    return val_int(a) < val_int(b) ? SYM_T : NIL;
 }
 
-Value* prim_gt(Value* args, Value* menv) {
+Value* prim_lt(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_lt2(a, b);
+}
+
+Value* prim_gt2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("gt_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    return a->i > b->i ? SYM_T : NIL;
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    return val_int(a) > val_int(b) ? SYM_T : NIL;
 }
 
-Value* prim_le(Value* args, Value* menv) {
+Value* prim_gt(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_gt2(a, b);
+}
+
+Value* prim_le2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("le_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    return a->i <= b->i ? SYM_T : NIL;
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    return val_int(a) <= val_int(b) ? SYM_T : NIL;
 }
 
-Value* prim_ge(Value* args, Value* menv) {
+Value* prim_le(Value* args, Value* menv) {
     (void)menv;
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_le2(a, b);
+}
+
+Value* prim_ge2(Value* a, Value* b) {
     if (is_code(a) || is_code(b)) return emit_c_call("ge_op", a, b);
-    if (a->tag != T_INT || b->tag != T_INT) return NIL;
-    return a->i >= b->i ? SYM_T : NIL;
+    if (val_tag(a) != T_INT || val_tag(b) != T_INT) return NIL;
+    return val_int(a) >= val_int(b) ? SYM_T : NIL;
+}
+
+Value* prim_ge(Value* args, Value* menv) {
+    (void)menv;
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b)) return NIL;
+    return prim_ge2(a, b);
 }
 
 // -- Logical Primitives --
@@ -939,19 +2104,24 @@ static Value* get_one_arg(Value* args) {
     return car(args);
 }
 
+// pre code post, sharing code
+static Value* wrap_code(const char* pre, Value* code, const char* post) {
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, pre);
+    cb_code(&cb, code);
+    cb_text(&cb, post);
+    return cb_finish(&cb);
+}
+
 Value* prim_car(Value* args, Value* menv) {
     (void)menv;
     Value* a = get_one_arg(args);
     if (!a) return NIL;
     if (is_code(a)) {
-        DString* ds = ds_new();
-        ds_printf(ds, "(%s)->a", a->s);
-        char* code_str = ds_take(ds);
-        Value* result = mk_code(code_str);
-        free(code_str);
-        return result;
+        return wrap_code("(", a, ")->a");
     }
-    if (a->tag != T_CELL) return NIL;
+    if (val_tag(a) != T_CELL) return NIL;
     return car(a);
 }
 
@@ -960,14 +2130,9 @@ Value* prim_cdr(Value* args, Value* menv) {
     Value* a = get_one_arg(args);
     if (!a) return NIL;
     if (is_code(a)) {
-        DString* ds = ds_new();
-        ds_printf(ds, "(%s)->b", a->s);
-        char* code_str = ds_take(ds);
-        Value* result = mk_code(code_str);
-        free(code_str);
-        return result;
+        return wrap_code("(", a, ")->b");
     }
-    if (a->tag != T_CELL) return NIL;
+    if (val_tag(a) != T_CELL) return NIL;
     return cdr(a);
 }
 
@@ -985,13 +2150,8 @@ Value* prim_null(Value* args, Value* menv) {
     Value* a = get_one_arg(args);
     if (!a) return SYM_T;  // null? of nothing is true
     if (is_code(a)) {
-        DString* ds = ds_new();
         // is_nil returns int, but we need Obj* for runtime consistency
-        ds_printf(ds, "mk_int(is_nil(%s))", a->s);
-        char* code_str = ds_take(ds);
-        Value* result = mk_code(code_str);
-        free(code_str);
-        return result;
+        return wrap_code("mk_int(is_nil(", a, "))");
     }
     return is_nil(a) ? SYM_T : NIL;
 }
@@ -1024,6 +2184,7 @@ Value* prim_set_box(Value* args, Value* menv) {
     if (!is_box(a)) {
         return mk_error("set-box!: first argument must be a box");
     }
+    note_mutation();
     box_set(a, b);
     return b;
 }
@@ -1038,35 +2199,30 @@ Value* prim_is_box(Value* args, Value* menv) {
 // I/O Operations
 // =============================================================================
 
+// Output is ordered after the processes spawned before it
 Value* prim_display(Value* args, Value* menv) {
     (void)menv;
+    scheduler_sync();
     Value* a = get_one_arg(args);
-    if (a) {
-        char* str = val_to_str(a);
-        if (str) {
-            printf("%s", str);
-            free(str);
-        }
-    }
+    if (a) val_print(stdout, a);
     return NIL;
 }
 
 Value* prim_newline(Value* args, Value* menv) {
     (void)menv;
     (void)args;
+    scheduler_sync();
     printf("\n");
     return NIL;
 }
 
 Value* prim_print(Value* args, Value* menv) {
     (void)menv;
+    scheduler_sync();
     Value* a = get_one_arg(args);
     if (a) {
-        char* str = val_to_str(a);
-        if (str) {
-            printf("%s\n", str);
-            free(str);
-        }
+        val_print(stdout, a);
+        printf("\n");
     }
     return NIL;
 }
@@ -1124,17 +2280,20 @@ Value* prim_make_chan(Value* args, Value* menv) {
     (void)menv;
     int capacity = 0;
     Value* a = get_one_arg(args);
-    if (a && a->tag == T_INT) {
-        capacity = (int)a->i;
+    if (a && val_tag(a) == T_INT) {
+        capacity = (int)val_int(a);
     }
     return mk_chan(capacity);
 }
 
-// Note: Full channel implementation requires threading support
-// These are placeholder implementations for the interpreter
+// Blocking ops park the calling process until the other side hands off
+// (see the scheduler below)
+static Value* chan_send_blocking(Value* ch, Value* val, Value* menv);
+static Value* chan_recv_blocking(Value* ch, Value* menv);
+static void chan_close_waiters(Channel* chan);
 
 Value* prim_chan_send(Value* args, Value* menv) {
-    (void)menv;
+    note_mutation();
     Value* a; Value* b;
     if (!get_two_args(args, &a, &b)) {
         return mk_error("chan-send!: requires channel and value");
@@ -1142,20 +2301,16 @@ Value* prim_chan_send(Value* args, Value* menv) {
     if (!is_chan(a)) {
         return mk_error("chan-send!: first argument must be a channel");
     }
-    // In a real implementation, this would block/schedule
-    printf("chan-send!: channels require threading support\n");
-    return b;
+    return chan_send_blocking(a, b, menv);
 }
 
 Value* prim_chan_recv(Value* args, Value* menv) {
-    (void)menv;
+    note_mutation();
     Value* a = get_one_arg(args);
     if (!a || !is_chan(a)) {
         return mk_error("chan-recv!: requires a channel");
     }
-    // In a real implementation, this would block/schedule
-    printf("chan-recv!: channels require threading support\n");
-    return NIL;
+    return chan_recv_blocking(a, menv);
 }
 
 Value* prim_chan_close(Value* args, Value* menv) {
@@ -1165,7 +2320,9 @@ Value* prim_chan_close(Value* args, Value* menv) {
         return mk_error("chan-close!: requires a channel");
     }
     if (a->chan.ch) {
+        note_mutation();
         a->chan.ch->closed = 1;
+        chan_close_waiters(a->chan.ch);
     }
     return NIL;
 }
@@ -1176,129 +2333,159 @@ Value* prim_chan_close(Value* args, Value* menv) {
 
 #include <setjmp.h>
 
-// Continuation tag counter for call/cc
+// Continuation tag counter for call/cc; tags stay unique across threads
 static int cont_tag_counter = 0;
 
-// Prompt stack for delimited continuations
-static int prompt_stack[MAX_PROMPT_DEPTH];
-static int prompt_stack_top = 0;
-
 static int next_cont_tag(void) {
-    return ++cont_tag_counter;
+    return __atomic_add_fetch(&cont_tag_counter, 1, __ATOMIC_RELAXED);
 }
 
-static void push_prompt_tag(int tag) {
-    if (prompt_stack_top < MAX_PROMPT_DEPTH) {
-        prompt_stack[prompt_stack_top++] = tag;
-    }
-}
+// Prompt escape structure for control operator
+typedef struct {
+    jmp_buf env;
+    Value* result;
+    int tag;
+    int active;
+    Value* captured_k;  // The captured continuation
+} PromptContext;
 
-static void pop_prompt_tag(void) {
-    if (prompt_stack_top > 0) {
-        prompt_stack_top--;
+// Prompt stack for delimited continuations, grown as prompts nest.
+// Escapes never cross threads: the stacks below are per thread, like the
+// C stacks they jump on.
+#define PROMPT_STACK_INIT 16
+
+static __thread PromptContext** prompt_contexts = NULL;
+static __thread int prompt_context_top = 0;
+static __thread int prompt_context_cap = 0;
+
+static int push_prompt(PromptContext* ctx) {
+    if (prompt_context_top == prompt_context_cap) {
+        int cap = prompt_context_cap ? prompt_context_cap * 2 : PROMPT_STACK_INIT;
+        PromptContext** grown = realloc(prompt_contexts, (size_t)cap * sizeof(PromptContext*));
+        if (!grown) return 0;
+        prompt_contexts = grown;
+        prompt_context_cap = cap;
     }
+    prompt_contexts[prompt_context_top++] = ctx;
+    return 1;
 }
 
 static int get_current_prompt_tag(void) {
-    if (prompt_stack_top == 0) return -1;
-    return prompt_stack[prompt_stack_top - 1];
+    if (prompt_context_top == 0) return -1;
+    return prompt_contexts[prompt_context_top - 1]->tag;
 }
 
 // Continuation value that can be invoked
-typedef struct {
+typedef struct ContContext {
     jmp_buf env;
     Value* result;
     int tag;
     int active;
+    int prompt_top;               // Prompts open when it was taken
+    struct ContContext* prev;     // Enclosing escape
 } ContContext;
 
-// Global for current continuation context
-static ContContext* active_cont_ctx = NULL;
-
-// eval_call_cc implements (call/cc proc)
-// proc is called with a continuation k, which when invoked returns to this point
-Value* eval_call_cc(Value* args, Value* menv) {
-    if (is_nil(args)) {
-        return mk_error("call/cc: requires a procedure");
-    }
-
-    Value* proc = eval(car(args), menv);
-    if (!proc) {
-        return mk_error("call/cc: procedure evaluated to nil");
-    }
+// Innermost escape on this thread; the enclosing ones chain from it
+static __thread ContContext* active_cont_ctx = NULL;
 
+// Run fn(k, data) with k bound to a fresh escape continuation. Invoking k
+// while fn is still running returns its argument from here.
+Value* call_with_escape(EscapeFn fn, void* data, Value* menv) {
     int tag = next_cont_tag();
     ContContext ctx;
     ctx.tag = tag;
     ctx.active = 1;
     ctx.result = NIL;
+    ctx.prompt_top = prompt_context_top;
 
     // Save previous context
-    ContContext* prev_ctx = active_cont_ctx;
+    ctx.prev = active_cont_ctx;
     active_cont_ctx = &ctx;
+    ProfileMark profile = profile_where();
 
     // setjmp returns 0 on initial call, non-zero when longjmp is called
     int jumped = setjmp(ctx.env);
     if (jumped) {
-        // We got here via longjmp from continuation invocation
-        active_cont_ctx = prev_ctx;
+        // We got here via longjmp from continuation invocation, past any
+        // prompt opened since
+        active_cont_ctx = ctx.prev;
+        prompt_context_top = ctx.prompt_top;
+        profile_release(profile);
         return ctx.result;
     }
 
     // Create continuation value that will longjmp back here
     Value* cont = mk_cont(NULL, menv, tag);
+    Value* result = fn(cont, data);
 
-    // Apply the procedure to the continuation
-    Value* arg_list = mk_cell(cont, NIL);
-    Value* result;
+    ctx.active = 0;
+    active_cont_ctx = ctx.prev;
+    return result;
+}
 
-    if (proc->tag == T_PRIM) {
-        result = proc->prim(arg_list, menv);
-    } else if (proc->tag == T_LAMBDA) {
-        Value* params = proc->lam.params;
-        Value* body = proc->lam.body;
-        Value* closure_env = proc->lam.env;
+typedef struct {
+    Value* proc;
+    Value* menv;
+} CallCCApply;
+
+Value* apply_proc(Value* proc, Value* args, Value* menv) {
+    if (!proc || !menv) return NULL;
+    if (val_tag(proc) == T_PRIM) {
+        return proc->prim(args, menv);
+    }
+    if (val_tag(proc) == T_LAMBDA) {
+        Value* new_env = bind_params(proc->lam.params, args, proc->lam.env);
 
-        Value* new_env = closure_env;
-        if (!is_nil(params)) {
-            new_env = env_extend(new_env, car(params), cont);
-        }
+        Value* body_menv = new_env ? mk_menv(menv->menv.parent, new_env) : NULL;
+        if (!body_menv) return NIL;
+        body_menv->menv.h_app = menv->menv.h_app;
+        body_menv->menv.h_let = menv->menv.h_let;
+        body_menv->menv.h_if = menv->menv.h_if;
+        return eval(proc->lam.body, body_menv);
+    }
+    return NULL;
+}
 
-        Value* body_menv = mk_menv(menv->menv.parent, new_env);
-        if (body_menv) {
-            body_menv->menv.h_app = menv->menv.h_app;
-            body_menv->menv.h_let = menv->menv.h_let;
-            body_menv->menv.h_if = menv->menv.h_if;
-            result = eval(body, body_menv);
-        } else {
-            result = NIL;
-        }
-    } else {
-        result = mk_error("call/cc: not a procedure");
+// Apply the call/cc procedure to its continuation
+static Value* call_cc_apply(Value* cont, void* data) {
+    CallCCApply* app = data;
+    Tag tag = val_tag(app->proc);
+    if (tag != T_PRIM && tag != T_LAMBDA) return mk_error("call/cc: not a procedure");
+    return apply_proc(app->proc, mk_cell(cont, NIL), app->menv);
+}
+
+// eval_call_cc implements (call/cc proc)
+// proc is called with a continuation k, which when invoked returns to this point
+Value* eval_call_cc(Value* args, Value* menv) {
+    if (is_nil(args)) {
+        return mk_error("call/cc: requires a procedure");
     }
 
-    ctx.active = 0;
-    active_cont_ctx = prev_ctx;
-    return result;
+    Value* proc = eval(car(args), menv);
+    if (!proc) {
+        return mk_error("call/cc: procedure evaluated to nil");
+    }
+
+    CallCCApply app = { proc, menv };
+    return call_with_escape(call_cc_apply, &app, menv);
 }
 
 // Invoke a continuation with a value
 Value* invoke_continuation(Value* cont, Value* val) {
-    if (!cont || cont->tag != T_CONT) {
+    if (!cont || val_tag(cont) != T_CONT) {
         return mk_error("not a continuation");
     }
 
     int tag = cont->cont.tag;
+    // Escape-only: every call is in tail position, so this is the return
+    if (tag == CONT_TAG_RETURN) return val;
 
-    // Find the matching continuation context
+    // Find the matching continuation context: an outer k may be called
+    // from inside a nested call/cc
     ContContext* ctx = active_cont_ctx;
-    while (ctx && ctx->tag != tag) {
-        // In a more complex implementation, we'd search a stack
-        // For now, just check the current active context
-        break;
-    }
+    while (ctx && ctx->tag != tag) ctx = ctx->prev;
 
-    if (ctx && ctx->active && ctx->tag == tag) {
+    if (ctx && ctx->active) {
         ctx->result = val;
         longjmp(ctx->env, 1);
     }
@@ -1310,26 +2497,33 @@ Value* invoke_continuation(Value* cont, Value* val) {
 // Delimited Continuations (prompt/control) - A3
 // =============================================================================
 
-// Prompt escape structure for control operator
+// Escape and prompt state of the code running on a thread. A process that
+// can suspend has its own, swapped in and out around every switch to it,
+// so an escape never jumps to another stack. The prompt stack moves with
+// it rather than being copied: a save is always followed by a load.
 typedef struct {
-    jmp_buf env;
-    Value* result;
-    int tag;
-    int active;
-    Value* captured_k;  // The captured continuation
-} PromptContext;
-
-static PromptContext* prompt_contexts[MAX_PROMPT_DEPTH];
-static int prompt_context_top = 0;
+    ContContext* escape;
+    PromptContext** prompts;
+    int prompt_top;
+    int prompt_cap;
+} ControlState;
+
+static void control_save(ControlState* c) {
+    c->escape = active_cont_ctx;
+    c->prompts = prompt_contexts;
+    c->prompt_top = prompt_context_top;
+    c->prompt_cap = prompt_context_cap;
+}
 
-// eval_prompt implements (prompt body)
-// Establishes a delimiter for control operator
-Value* eval_prompt(Value* args, Value* menv) {
-    if (is_nil(args)) {
-        return NIL;
-    }
+static void control_load(const ControlState* c) {
+    active_cont_ctx = c->escape;
+    prompt_contexts = c->prompts;
+    prompt_context_top = c->prompt_top;
+    prompt_context_cap = c->prompt_cap;
+}
 
-    Value* body = car(args);
+// Run fn(data) under a fresh prompt; a control inside it returns here.
+Value* call_with_prompt(PromptFn fn, void* data) {
     int tag = next_cont_tag();
 
     PromptContext ctx;
@@ -1339,28 +2533,50 @@ Value* eval_prompt(Value* args, Value* menv) {
     ctx.captured_k = NIL;
 
     // Push context
-    if (prompt_context_top < MAX_PROMPT_DEPTH) {
-        prompt_contexts[prompt_context_top++] = &ctx;
-    }
-    push_prompt_tag(tag);
+    if (!push_prompt(&ctx)) return mk_error("prompt: out of memory");
+    int top = prompt_context_top - 1;
+    ContContext* escape = active_cont_ctx;
+    ProfileMark profile = profile_where();
 
     int jumped = setjmp(ctx.env);
     if (jumped) {
-        // Got here via control - ctx.result contains the result
-        pop_prompt_tag();
-        prompt_context_top--;
+        // Got here via control - ctx.result contains the result, and any
+        // call/cc taken since is gone
+        prompt_context_top = top;
+        active_cont_ctx = escape;
+        profile_release(profile);
         return ctx.result;
     }
 
-    Value* result = eval(body, menv);
+    Value* result = fn(data);
 
-    pop_prompt_tag();
-    prompt_context_top--;
+    prompt_context_top = top;
     ctx.active = 0;
 
     return result;
 }
 
+typedef struct {
+    Value* body;
+    Value* menv;
+} PromptEval;
+
+static Value* prompt_eval_body(void* data) {
+    PromptEval* p = data;
+    return eval(p->body, p->menv);
+}
+
+// eval_prompt implements (prompt body)
+// Establishes a delimiter for control operator
+Value* eval_prompt(Value* args, Value* menv) {
+    if (is_nil(args)) {
+        return NIL;
+    }
+
+    PromptEval p = { car(args), menv };
+    return call_with_prompt(prompt_eval_body, &p);
+}
+
 // eval_control implements (control k body)
 // Captures the continuation up to the enclosing prompt and binds it to k
 Value* eval_control(Value* args, Value* menv) {
@@ -1369,7 +2585,7 @@ Value* eval_control(Value* args, Value* menv) {
     }
 
     Value* k_sym = car(args);
-    if (!k_sym || k_sym->tag != T_SYM) {
+    if (!k_sym || val_tag(k_sym) != T_SYM) {
         return mk_error("control: first argument must be a symbol");
     }
 
@@ -1421,39 +2637,748 @@ Value* eval_control(Value* args, Value* menv) {
 // =============================================================================
 // Cooperative Scheduler (A4)
 // =============================================================================
-
-#define MAX_PROCESSES 256
+// Processes that only compute (go_parallel_safe) run M:N: they go on
+// per-worker Chase-Lev deques and up to scheduler_workers() threads take
+// them, stealing from each other when their own deque is empty. They start
+// once the spawning code next writes shared state, prints or finishes its
+// top-level form (scheduler_sync), so what they read is what they saw when
+// spawned. Every other process goes on the serial queue and runs as
+// before: one at a time, on the spawning thread, in spawn order. Each of
+// those gets a C stack of its own, so a channel op that has to wait
+// suspends it in place; it costs nothing until a handoff wakes it.
+
+#define SCHED_MAX_WORKERS 64
+#define SCHED_DEQUE_INIT 64       // Slots in a fresh deque ring; doubles
+#define SCHED_CHECK_BUDGET 4096   // Forms go_parallel_safe looks at
+#define SCHED_STACK_SIZE (8 << 20) // Reserved per serial process, like a main stack
+
+// Work-stealing deque: the owner pushes and takes at the bottom, thieves
+// steal at the top. The ring only grows; the ones it outgrew are freed
+// between rounds, when no thief can still be reading them.
+typedef struct DequeRing {
+    long mask;
+    struct DequeRing* retired;
+    Value* slots[];
+} DequeRing;
+
+typedef struct WorkDeque {
+    long top;
+    long bottom;
+    DequeRing* ring;
+} WorkDeque;
+
+typedef struct SchedWorker {
+    WorkDeque deque;
+    struct Arena* arena;          // What it allocates this round (NULL: malloc)
+    pthread_t thread;
+    unsigned int seed;            // Victim selection
+} SchedWorker;
 
 typedef struct {
-    Value* processes[MAX_PROCESSES];  // Run queue
-    int head;
-    int tail;
-    int count;
-    Value* current;   // Currently running process
-    int running;      // Is scheduler running?
+    Value** serial;               // Serial run queue (ring, grows)
+    int serial_head;
+    int serial_count;
+    int serial_cap;
+    int running;                  // Serial queue being drained
+    SchedWorker workers[SCHED_MAX_WORKERS];  // [0]: the main thread
+    int nworkers;                 // 0 until configured
+    int started;                  // Worker threads created
+    int round;                    // Bumped to start a round
+    int round_workers;            // Threads taking part in it
+    int busy;                     // Threads not done with it
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
 } Scheduler;
 
-static Scheduler global_scheduler = {.head = 0, .tail = 0, .count = 0, .current = NULL, .running = 0};
+static Scheduler global_scheduler = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .done = PTHREAD_COND_INITIALIZER,
+};
+
+static __thread Value* sched_current = NULL;    // Process running here
+static __thread SchedWorker* sched_self = NULL;
+
+void scheduler_set_workers(int n) {
+    if (n < 1) n = 1;
+    if (n > SCHED_MAX_WORKERS) n = SCHED_MAX_WORKERS;
+    global_scheduler.nworkers = n;
+}
+
+// PURPLE_GO_WORKERS, else one per online CPU
+int scheduler_workers(void) {
+    if (!global_scheduler.nworkers) {
+        const char* env = getenv("PURPLE_GO_WORKERS");
+        long n = env && *env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+        scheduler_set_workers(n > SCHED_MAX_WORKERS ? SCHED_MAX_WORKERS : (int)n);
+    }
+    return global_scheduler.nworkers;
+}
+
+// -- Deques --
+
+// Owner only; 0 on OOM
+static int deque_push(WorkDeque* d, Value* proc) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    DequeRing* r = __atomic_load_n(&d->ring, __ATOMIC_RELAXED);
+    if (!r || b - t > r->mask) {
+        long size = r ? (r->mask + 1) * 2 : SCHED_DEQUE_INIT;
+        DequeRing* grown = malloc(sizeof(DequeRing) + (size_t)size * sizeof(Value*));
+        if (!grown) return 0;
+        grown->mask = size - 1;
+        grown->retired = r;
+        for (long i = t; i < b; i++) {
+            grown->slots[i & grown->mask] = __atomic_load_n(&r->slots[i & r->mask], __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&d->ring, grown, __ATOMIC_RELEASE);
+        r = grown;
+    }
+    __atomic_store_n(&r->slots[b & r->mask], proc, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+// Owner only: newest first
+static Value* deque_take(WorkDeque* d) {
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    DequeRing* r = __atomic_load_n(&d->ring, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b, __ATOMIC_SEQ_CST);
+    long t = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+    if (t > b) {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    Value* proc = __atomic_load_n(&r->slots[b & r->mask], __ATOMIC_RELAXED);
+    if (t == b) {
+        // The last one: thieves may be after it too
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            proc = NULL;
+        }
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return proc;
+}
+
+// Any thread: oldest first; NULL when empty or another thread won it
+static Value* deque_steal(WorkDeque* d) {
+    long t = __atomic_load_n(&d->top, __ATOMIC_SEQ_CST);
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_SEQ_CST);
+    if (t >= b) return NULL;
+    DequeRing* r = __atomic_load_n(&d->ring, __ATOMIC_ACQUIRE);
+    Value* proc = __atomic_load_n(&r->slots[t & r->mask], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;
+    }
+    return proc;
+}
+
+static void deque_trim(WorkDeque* d) {
+    if (!d->ring) return;
+    DequeRing* r = d->ring->retired;
+    d->ring->retired = NULL;
+    while (r) {
+        DequeRing* next = r->retired;
+        free(r);
+        r = next;
+    }
+}
+
+// -- Serial Queue --
+
+static void serial_enqueue(Value* proc) {
+    Scheduler* s = &global_scheduler;
+    if (s->serial_count == s->serial_cap) {
+        int cap = s->serial_cap ? s->serial_cap * 2 : 64;
+        Value** q = malloc((size_t)cap * sizeof(Value*));
+        if (!q) return;
+        for (int i = 0; i < s->serial_count; i++) {
+            q[i] = s->serial[(s->serial_head + i) % s->serial_cap];
+        }
+        free(s->serial);
+        s->serial = q;
+        s->serial_cap = cap;
+        s->serial_head = 0;
+    }
+    s->serial[(s->serial_head + s->serial_count) % s->serial_cap] = proc;
+    s->serial_count++;
+}
+
+static Value* serial_dequeue(void) {
+    Scheduler* s = &global_scheduler;
+    if (s->serial_count == 0) return NULL;
+    Value* proc = s->serial[s->serial_head];
+    s->serial_head = (s->serial_head + 1) % s->serial_cap;
+    s->serial_count--;
+    return proc;
+}
+
+// -- Process Stacks --
+// Reserved, not committed: a process only touches the pages it uses, so a
+// stack grows a page at a time as it goes deeper. The lowest page is a
+// guard, so an overflow faults instead of corrupting the neighbouring
+// stack. A finished process hands its stack to a pool and the next one
+// spawned takes it, mapping nothing; only the pages past its hot top go
+// back to the kernel. Each live stack is two mappings (the guard and the
+// rest), so vm.max_map_count / 2 of them can be parked at once; past that
+// a process runs on the stack of whoever ran it and cannot park. All of
+// this is main-thread only.
+//
+// On x86-64 and AArch64 a switch is go_switch: the callee-saved registers
+// go on the stack being left and the stack pointer is swapped, with no
+// signal mask to save or restore, so it is a few dozen instructions.
+// Elsewhere, and under AddressSanitizer (which has to see the switches),
+// it is swapcontext.
+
+#if defined(__SANITIZE_ADDRESS__)
+#define GO_SWITCH_ASM 0
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define GO_SWITCH_ASM 0
+#endif
+#endif
+#if !defined(GO_SWITCH_ASM) && defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+#define GO_SWITCH_ASM 1
+#endif
+#ifndef GO_SWITCH_ASM
+#define GO_SWITCH_ASM 0
+#endif
+
+#define SCHED_STACK_POOL 1024      // Finished stacks kept for reuse
+#define SCHED_STACK_HOT (64 << 10) // Top of a pooled stack left committed
+#define SCHED_STACK_CANARY ((uintptr_t)0x5eedc0de5eedc0deULL)
+
+typedef struct GoStack {
+#if GO_SWITCH_ASM
+    void* sp;                     // Where the process is
+    void* caller_sp;              // Whoever resumed it last
+#else
+    ucontext_t context;
+    ucontext_t caller;
+#endif
+    void* base;
+    size_t size;
+    Value* proc;
+    struct ChanWaiter* waiter;    // What it is parked on, if anything
+    ControlState control;
+    struct GoStack* prev;         // Live stacks; next also links the pool
+    struct GoStack* next;
+} GoStack;
+
+static GoStack* go_stacks = NULL;
+static GoStack* go_stack_pool = NULL;
+static int go_stack_pooled = 0;
+
+static int go_live(void) {
+    return go_stacks != NULL;
+}
+
+static void process_body(Value* proc);
+
+#if GO_SWITCH_ASM
+// Save the current stack pointer in *save and continue on load
+void purple_go_switch(void** save, void* load);
+
+#if defined(__x86_64__)
+__asm__(
+    ".text\n"
+    ".globl purple_go_switch\n"
+    ".hidden purple_go_switch\n"
+    ".type purple_go_switch, @function\n"
+    "purple_go_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size purple_go_switch, .-purple_go_switch\n"
+);
+#define GO_FRAME_WORDS 9          // Control words, six registers, return, go_entry's own
+#elif defined(__aarch64__)
+__asm__(
+    ".text\n"
+    ".globl purple_go_switch\n"
+    ".hidden purple_go_switch\n"
+    ".type purple_go_switch, %function\n"
+    "purple_go_switch:\n"
+    "    sub sp, sp, #160\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #160\n"
+    "    ret\n"
+    ".size purple_go_switch, .-purple_go_switch\n"
+);
+#define GO_FRAME_WORDS 20         // x19-x30, d8-d15
+#endif
+
+static void go_entry(void) {
+    Value* proc = sched_current;
+    process_body(proc);
+    proc->proc.state = PROC_DONE;
+    GoStack* st = proc->proc.stack;
+    void* unused;
+    purple_go_switch(&unused, st->caller_sp);
+    abort(); // Never resumed once done
+}
+
+// A frame go_switch returns from into go_entry, as if called
+static int go_context_init(GoStack* st) {
+    uintptr_t top = ((uintptr_t)st->base + st->size) & ~(uintptr_t)15;
+    void** frame;
+    frame = (void**)top - GO_FRAME_WORDS;
+    memset(frame, 0, GO_FRAME_WORDS * sizeof(void*));
+#if defined(__x86_64__)
+    uint32_t controls[2] = { 0x1F80, 0x037F }; // Default MXCSR and x87 control word
+    memcpy(frame, controls, sizeof(controls));
+    frame[7] = (void*)go_entry;   // Entered with the stack as a call leaves it
+#else
+    frame[11] = (void*)go_entry;  // x30
+#endif
+    st->sp = frame;
+    return 1;
+}
+
+static void go_switch_in(GoStack* st) {
+    purple_go_switch(&st->caller_sp, st->sp);
+}
+
+static void go_switch_out(GoStack* st) {
+    purple_go_switch(&st->sp, st->caller_sp);
+}
+#else
+static void go_entry(void) {
+    Value* proc = sched_current;
+    process_body(proc);
+    proc->proc.state = PROC_DONE;
+    // Returns to uc_link: the caller context of the last resume
+}
+
+static int go_context_init(GoStack* st) {
+    if (getcontext(&st->context) != 0) return 0;
+    st->context.uc_stack.ss_sp = st->base;
+    st->context.uc_stack.ss_size = st->size;
+    st->context.uc_link = &st->caller;
+    makecontext(&st->context, go_entry, 0);
+    return 1;
+}
+
+static void go_switch_in(GoStack* st) {
+    swapcontext(&st->caller, &st->context);
+}
+
+static void go_switch_out(GoStack* st) {
+    swapcontext(&st->context, &st->caller);
+}
+#endif
+
+// A pooled stack, or a freshly mapped one
+static GoStack* go_stack_take(void) {
+    GoStack* st = go_stack_pool;
+    if (st) {
+        go_stack_pool = st->next;
+        go_stack_pooled--;
+        st->next = NULL;
+        return st;
+    }
+    st = calloc(1, sizeof(GoStack));
+    if (!st) return NULL;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    st->size = SCHED_STACK_SIZE;
+    st->base = mmap(NULL, st->size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (st->base == MAP_FAILED) {
+        free(st);
+        return NULL;
+    }
+    if (mprotect(st->base, page, PROT_NONE) != 0) {
+        munmap(st->base, st->size);
+        free(st);
+        return NULL;
+    }
+    return st;
+}
+
+static void go_stack_drop(GoStack* st) {
+    munmap(st->base, st->size);
+    free(st->control.prompts);
+    free(st);
+}
+
+static GoStack* go_stack_new(Value* proc) {
+    GoStack* st = go_stack_take();
+    if (!st) return NULL;
+    if (!go_context_init(st)) {
+        go_stack_drop(st);
+        return NULL;
+    }
+    st->proc = proc;
+    st->prev = NULL;
+    st->next = go_stacks;
+    if (go_stacks) go_stacks->prev = st;
+    go_stacks = st;
+    proc->proc.stack = st;
+    return st;
+}
+
+static void go_stack_free(GoStack* st) {
+    if (st->prev) st->prev->next = st->next;
+    else go_stacks = st->next;
+    if (st->next) st->next->prev = st->prev;
+    st->proc->proc.stack = NULL;
+    if (go_stack_pooled >= SCHED_STACK_POOL) {
+        go_stack_drop(st);
+        return;
+    }
+    // A deep run leaves its pages behind: give back all but the hot top. The
+    // canary below the hot top is still there if nothing ran that deep.
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (st->size > SCHED_STACK_HOT + page) {
+        uintptr_t* canary = (uintptr_t*)((char*)st->base + st->size - SCHED_STACK_HOT) - 1;
+        if (*canary != SCHED_STACK_CANARY) {
+            madvise((char*)st->base + page, st->size - SCHED_STACK_HOT - page, MADV_DONTNEED);
+            *canary = SCHED_STACK_CANARY;
+        }
+    }
+    st->proc = NULL;
+    st->waiter = NULL;
+    st->control.escape = NULL;
+    st->control.prompt_top = 0;   // The prompt array is kept
+    st->prev = NULL;
+    st->next = go_stack_pool;
+    go_stack_pool = st;
+    go_stack_pooled++;
+}
+
+// Switch to a process until it parks or finishes
+static void go_resume(Value* proc) {
+    GoStack* st = proc->proc.stack;
+    ControlState outer_control;
+    control_save(&outer_control);
+    control_load(&st->control);
+    Value* outer = sched_current;
+    sched_current = proc;
+    proc->proc.state = PROC_RUNNING;
+    // It writes into state older than the current top-level form
+    mutation_count++;
+
+    // It parks with its frames pushed: they leave with it
+    ProfileMark mark = profile_mark();
+    go_switch_in(st);
+    profile_release(mark);
+
+    sched_current = outer;
+    control_save(&st->control);
+    control_load(&outer_control);
+    if (proc->proc.state == PROC_DONE) go_stack_free(st);
+}
+
+// -- Parallel Safety --
+// A process may run beside others when nothing it can reach writes, does
+// I/O, stages code or jumps: every form and every closure it may call
+// (found through its environment) is checked, and so is data it captures.
+// Calls through a variable the check cannot see the value of are refused,
+// as are forms analyze_ownership classes as shared.
+
+// Primitives a parallel process may call
+static int go_pure_prim(Value* prim) {
+    static const PrimFn pure[] = {
+        prim_add, prim_sub, prim_mul, prim_div, prim_mod,
+        prim_eq, prim_lt, prim_gt, prim_le, prim_ge, prim_not,
+        prim_cons, prim_car, prim_cdr, prim_fst, prim_snd, prim_null,
+        prim_box, prim_unbox, prim_is_box, prim_is_cont, prim_is_error,
+        prim_is_chan, prim_is_process, prim_make_chan,
+        prim_make_type_instance, prim_type_get_field, prim_type_is, prim_type_ref,
+        prim_vector, prim_make_vector, prim_is_vector, prim_vector_length, prim_vector_ref,
+        prim_list_to_vector, prim_vector_to_list, prim_vector_add, prim_vector_dot,
+    };
+    for (size_t i = 0; i < sizeof(pure) / sizeof(pure[0]); i++) {
+        if (prim->prim == pure[i]) return 1;
+    }
+    return 0;
+}
+
+typedef struct GoCheck {
+    Value** seen;                 // Closures checked already
+    int nseen;
+    int seen_cap;
+    Value** locals;               // Binders in scope, innermost last
+    char* callable;               // ...bound to a lambda form
+    int nlocals;
+    int locals_cap;
+    int base;                     // Locals below belong to an outer closure
+    int budget;
+} GoCheck;
+
+static int go_check_expr(GoCheck* c, Value* e, Value* env);
+
+static int go_bind(GoCheck* c, Value* sym, int callable) {
+    if (c->nlocals == c->locals_cap) {
+        int cap = c->locals_cap ? c->locals_cap * 2 : 32;
+        Value** locals = realloc(c->locals, (size_t)cap * sizeof(Value*));
+        if (!locals) return 0;
+        c->locals = locals;
+        char* flags = realloc(c->callable, (size_t)cap);
+        if (!flags) return 0;
+        c->callable = flags;
+        c->locals_cap = cap;
+    }
+    c->locals[c->nlocals] = sym;
+    c->callable[c->nlocals] = (char)callable;
+    c->nlocals++;
+    return 1;
+}
+
+static int go_local(GoCheck* c, Value* sym) {
+    for (int i = c->nlocals - 1; i >= c->base; i--) {
+        if (c->locals[i] == sym) return i;
+    }
+    return -1;
+}
+
+static Value* go_lookup(Value* sym, Value* env) {
+    Value* v = env_lookup(env, sym);
+    return v ? v : global_lookup(sym);
+}
+
+static int is_lambda_form(Value* e) {
+    return e && val_tag(e) == T_CELL && e->cell.car == SYM_LAMBDA;
+}
+
+static int go_check_closure(GoCheck* c, Value* lam) {
+    for (int i = 0; i < c->nseen; i++) {
+        if (c->seen[i] == lam) return 1;
+    }
+    if (c->nseen == c->seen_cap) {
+        int cap = c->seen_cap ? c->seen_cap * 2 : 16;
+        Value** seen = realloc(c->seen, (size_t)cap * sizeof(Value*));
+        if (!seen) return 0;
+        c->seen = seen;
+        c->seen_cap = cap;
+    }
+    c->seen[c->nseen++] = lam;
+
+    // Its free variables are looked up in its own environment
+    int base = c->base, n = c->nlocals;
+    c->base = n;
+    int ok = 1;
+    for (Value* p = lam->lam.params; ok && p && val_tag(p) == T_CELL; p = p->cell.cdr) {
+        ok = go_bind(c, p->cell.car, 0);
+    }
+    ok = ok && go_check_expr(c, lam->lam.body, lam->lam.env);
+    c->base = base;
+    c->nlocals = n;
+    return ok;
+}
+
+// Captured data
+static int go_check_value(GoCheck* c, Value* v) {
+    while (v && !is_fixnum(v)) {
+        if (--c->budget < 0) return 0;
+        switch (v->tag) {
+            case T_PRIM: return go_pure_prim(v);
+            case T_LAMBDA: return go_check_closure(c, v);
+            case T_CELL:
+                if (!go_check_value(c, v->cell.car)) return 0;
+                v = v->cell.cdr;
+                break;
+            case T_BOX:
+                v = v->box_value;
+                break;
+            case T_CONT: case T_CODE: case T_MENV: case T_FRAME:
+                return 0;
+            default:
+                return 1;
+        }
+    }
+    return 1;
+}
+
+static int go_check_list(GoCheck* c, Value* list, Value* env) {
+    while (list && val_tag(list) == T_CELL) {
+        if (!go_check_expr(c, list->cell.car, env)) return 0;
+        list = list->cell.cdr;
+    }
+    return is_nil(list) || go_check_expr(c, list, env);
+}
+
+static int go_check_callee(GoCheck* c, Value* op, Value* env) {
+    if (!op || is_fixnum(op)) return 0;
+    if (op->tag == T_SYM || op->tag == T_LREF) {
+        Value* sym = op->tag == T_LREF ? op->lref.sym : op;
+        int i = go_local(c, sym);
+        if (i >= 0) return c->callable[i];
+        Value* fn = go_lookup(sym, env);
+        if (!fn || fn == SYM_UNINIT) return 0;
+        if (val_tag(fn) == T_PRIM) return go_pure_prim(fn);
+        if (val_tag(fn) == T_LAMBDA) return go_check_closure(c, fn);
+        return 0;
+    }
+    return is_lambda_form(op) && go_check_expr(c, op, env);
+}
+
+static int go_check_binders(GoCheck* c, Value* args, Value* env, int rec) {
+    int n = c->nlocals;
+    int ok = 1;
+    if (rec) {
+        for (Value* b = car(args); ok && val_tag(b) == T_CELL; b = b->cell.cdr) {
+            ok = go_bind(c, car(car(b)), is_lambda_form(car(cdr(car(b)))));
+        }
+    }
+    for (Value* b = car(args); ok && val_tag(b) == T_CELL; b = b->cell.cdr) {
+        ok = go_check_expr(c, car(cdr(car(b))), env);
+    }
+    if (!rec) {
+        for (Value* b = car(args); ok && val_tag(b) == T_CELL; b = b->cell.cdr) {
+            ok = go_bind(c, car(car(b)), is_lambda_form(car(cdr(car(b)))));
+        }
+    }
+    ok = ok && go_check_list(c, cdr(args), env);
+    c->nlocals = n;
+    return ok;
+}
+
+static int go_check_expr(GoCheck* c, Value* e, Value* env) {
+    if (--c->budget < 0) return 0;
+    if (!e || is_fixnum(e)) return 1;
+    if (e->tag == T_SYM || e->tag == T_LREF) {
+        Value* sym = e->tag == T_LREF ? e->lref.sym : e;
+        if (go_local(c, sym) >= 0) return 1;
+        Value* v = go_lookup(sym, env);
+        return v && v != SYM_UNINIT && go_check_value(c, v);
+    }
+    if (e->tag == T_CODE) return 0;
+    if (e->tag != T_CELL) return 1;
+
+    if (analyze_ownership(e) == OWN_SHARED) return 0;
+    Value* op = e->cell.car;
+    Value* args = e->cell.cdr;
+    if (op && !is_fixnum(op) && op->tag == T_SYM && op->sym_form) {
+        switch (op->sym_form) {
+            case SF_QUOTE:
+                return 1;
+            case SF_IF: case SF_AND: case SF_OR: case SF_DO:
+            case SF_GO: case SF_PROMPT: case SF_CALL_CC:
+                return go_check_list(c, args, env);
+            case SF_LET:
+                return go_check_binders(c, args, env, 0);
+            case SF_LETREC:
+                return go_check_binders(c, args, env, 1);
+            case SF_LAMBDA: {
+                int n = c->nlocals;
+                int ok = 1;
+                for (Value* p = car(args); ok && val_tag(p) == T_CELL; p = p->cell.cdr) {
+                    ok = go_bind(c, p->cell.car, 0);
+                }
+                ok = ok && go_check_list(c, cdr(args), env);
+                c->nlocals = n;
+                return ok;
+            }
+            default:
+                // Writes, staging, reflection, select
+                return 0;
+        }
+    }
+    return go_check_callee(c, op, env) && go_check_list(c, args, env);
+}
+
+static int go_parallel_safe(Value* thunk, Value* menv) {
+    if (!thunk || val_tag(thunk) != T_LAMBDA || !menv_has_default_handlers(menv)) return 0;
+    GoCheck c = { .budget = SCHED_CHECK_BUDGET };
+    int ok = go_check_expr(&c, thunk->lam.body, thunk->lam.env);
+    free(c.seen);
+    free(c.locals);
+    free(c.callable);
+    return ok;
+}
+
+// -- Processes --
+
+// Evaluate a process's thunk body under the menv it was spawned in
+static void process_body(Value* proc) {
+    Value* thunk = proc->proc.thunk;
+    Value* menv = proc->proc.menv;
+    if (thunk && val_tag(thunk) == T_LAMBDA) {
+        // Create a new menv for this process
+        Value* proc_menv = mk_menv(menv->menv.parent, thunk->lam.env);
+        if (proc_menv) {
+            proc_menv->menv.h_app = menv->menv.h_app;
+            proc_menv->menv.h_let = menv->menv.h_let;
+            proc_menv->menv.h_if = menv->menv.h_if;
 
-// Add process to run queue
-static void scheduler_enqueue(Value* proc) {
-    if (global_scheduler.count >= MAX_PROCESSES) {
-        return;
+            // Evaluate the thunk body (no args). A parallel process never
+            // suspends, so it can run in this thread's VM
+            ProfileMark mark = profile_mark();
+            if (profile_active) profile_push(thunk->lam.body);
+            proc->proc.result = sched_parallel ? vm_eval(thunk->lam.body, proc_menv)
+                                               : eval(thunk->lam.body, proc_menv);
+            profile_release(mark);
+        }
     }
-    global_scheduler.processes[global_scheduler.tail] = proc;
-    global_scheduler.tail = (global_scheduler.tail + 1) % MAX_PROCESSES;
-    global_scheduler.count++;
 }
 
-// Remove process from run queue
-static Value* scheduler_dequeue(void) {
-    if (global_scheduler.count == 0) {
-        return NULL;
+// Run a process until it finishes or, on a stack of its own, parks
+static void run_process(Value* proc) {
+    if (!proc || proc->proc.state != PROC_READY) {
+        return;
     }
-    Value* proc = global_scheduler.processes[global_scheduler.head];
-    global_scheduler.head = (global_scheduler.head + 1) % MAX_PROCESSES;
-    global_scheduler.count--;
-    return proc;
+    if (!sched_parallel && (proc->proc.stack || go_stack_new(proc))) {
+        go_resume(proc);
+        return;
+    }
+
+    // Parallel processes never block; without a stack it cannot suspend
+    proc->proc.state = PROC_RUNNING;
+    Value* outer = sched_current;
+    sched_current = proc;
+    process_body(proc);
+    proc->proc.state = PROC_DONE;
+    sched_current = outer;
+}
+
+// Queue a parallel process on a worker's deque; 0 on OOM
+static int go_enqueue(SchedWorker* w, Value* proc) {
+    __atomic_fetch_add(&go_pending, 1, __ATOMIC_SEQ_CST);
+    if (deque_push(&w->deque, proc)) return 1;
+    __atomic_fetch_sub(&go_pending, 1, __ATOMIC_SEQ_CST);
+    return 0;
 }
 
 // Spawn a new process (green thread)
@@ -1464,58 +3389,170 @@ Value* scheduler_spawn(Value* thunk, Value* menv) {
     proc->proc.state = PROC_READY;
     proc->proc.menv = menv;
 
-    scheduler_enqueue(proc);
+    if (sched_parallel) {
+        // From a parallel process, which was checked with everything it spawns
+        note_mutation();
+        if (!go_enqueue(sched_self, proc)) run_process(proc);
+        return proc;
+    }
+    if (scheduler_workers() > 1 && go_parallel_safe(thunk, menv) &&
+        go_enqueue(&global_scheduler.workers[0], proc)) {
+        mutation_count++;
+        return proc;
+    }
+
+    note_mutation();
+    serial_enqueue(proc);
     return proc;
 }
 
-// Run a single process step
-static void run_process(Value* proc, Value* menv) {
-    if (!proc || proc->proc.state != PROC_READY) {
-        return;
-    }
+// -- Independent Forms --
+// Top-level forms that pass the parallel-safety check read the global
+// environment and write nothing, so a run of them gives the same values
+// in any order: each becomes a parallel process, and they finish together.
 
-    proc->proc.state = PROC_RUNNING;
-    global_scheduler.current = proc;
+int eval_parallel_safe(Value* form, Value* menv) {
+    if (sched_parallel || scheduler_workers() < 2) return 0;
+    Value* thunk = mk_lambda(NIL, form, menv->menv.env);
+    return thunk && go_parallel_safe(thunk, menv);
+}
 
-    Value* thunk = proc->proc.thunk;
-    if (thunk && thunk->tag == T_LAMBDA) {
-        // Create a new menv for this process
-        Value* proc_menv = mk_menv(menv->menv.parent, thunk->lam.env);
-        if (proc_menv) {
-            proc_menv->menv.h_app = menv->menv.h_app;
-            proc_menv->menv.h_let = menv->menv.h_let;
-            proc_menv->menv.h_if = menv->menv.h_if;
+void eval_parallel(Value** forms, int n, Value* menv, Value** results) {
+    for (int i = 0; i < n; i++) {
+        Value* proc = mk_process(mk_lambda(NIL, forms[i], menv->menv.env));
+        results[i] = proc;
+        if (!proc) continue;
+        proc->proc.state = PROC_READY;
+        proc->proc.menv = menv;
+        // Synced below, before anything can write: no mutation to note
+        if (!go_enqueue(&global_scheduler.workers[0], proc)) run_process(proc);
+    }
+    scheduler_sync();
+    for (int i = 0; i < n; i++) {
+        results[i] = results[i] ? results[i]->proc.result : NIL;
+    }
+}
 
-            // Evaluate the thunk body (no args)
-            proc->proc.result = eval(thunk->lam.body, proc_menv);
+// -- Rounds --
+
+// Own deque first, then steal, until every parallel process spawned so far
+// (including those spawned meanwhile) has finished
+static void go_work(SchedWorker* self, int nworkers) {
+    SchedWorker* workers = global_scheduler.workers;
+    while (__atomic_load_n(&go_pending, __ATOMIC_SEQ_CST) > 0) {
+        Value* proc = deque_take(&self->deque);
+        for (int i = 0; !proc && i < nworkers; i++) {
+            self->seed = self->seed * 1103515245u + 12345u;
+            SchedWorker* victim = &workers[(self->seed >> 16) % (unsigned)nworkers];
+            if (victim != self) proc = deque_steal(&victim->deque);
         }
+        if (!proc) {
+            sched_yield();
+            continue;
+        }
+        run_process(proc);
+        __atomic_fetch_sub(&go_pending, 1, __ATOMIC_SEQ_CST);
     }
+}
 
-    proc->proc.state = PROC_DONE;
-    global_scheduler.current = NULL;
+static void* go_worker_main(void* arg) {
+    SchedWorker* self = arg;
+    Scheduler* s = &global_scheduler;
+    int seen = 0;
+    sched_self = self;
+    sched_parallel = 1;
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (s->round == seen) pthread_cond_wait(&s->wake, &s->lock);
+        seen = s->round;
+        int n = s->round_workers;
+        pthread_mutex_unlock(&s->lock);
+
+        if (self - s->workers < n) {
+            // Nodes may have been freed since the last round
+            memset(node_local, 0, sizeof(node_local));
+            compiler_arena_attach(self->arena);
+            go_work(self, n);
+            // Its chunks point into forms the main thread may release
+            vm_reset();
+            compiler_arena_attach(NULL);
+        }
+
+        pthread_mutex_lock(&s->lock);
+        if (--s->busy == 0) pthread_cond_signal(&s->done);
+        pthread_mutex_unlock(&s->lock);
+    }
+    return NULL;
 }
 
-// Run scheduler until all processes complete
+// Run pending parallel processes to completion, the main thread joining in
+void scheduler_sync(void) {
+    Scheduler* s = &global_scheduler;
+    if (sched_parallel || __atomic_load_n(&go_pending, __ATOMIC_SEQ_CST) == 0) return;
+    int n = scheduler_workers();
+
+    pthread_mutex_lock(&s->lock);
+    while (s->started < n - 1) {
+        SchedWorker* w = &s->workers[s->started + 1];
+        w->seed = (unsigned int)(s->started + 1) * 2654435761u;
+        if (pthread_create(&w->thread, NULL, go_worker_main, w) != 0) break;
+        pthread_detach(w->thread);
+        s->started++;
+    }
+    s->round_workers = s->started + 1 < n ? s->started + 1 : n;
+    for (int i = 1; i < s->round_workers; i++) s->workers[i].arena = compiler_arena_fork();
+    compiler_arena_share(1);
+    s->busy = s->started;
+    s->round++;
+    pthread_cond_broadcast(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+
+    sched_self = &s->workers[0];
+    sched_parallel = 1;
+    go_work(sched_self, s->round_workers);
+    sched_parallel = 0;
+    sched_self = NULL;
+    memset(node_local, 0, sizeof(node_local));
+
+    pthread_mutex_lock(&s->lock);
+    while (s->busy > 0) pthread_cond_wait(&s->done, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+
+    compiler_arena_share(0);
+    for (int i = 0; i < s->round_workers; i++) {
+        compiler_arena_adopt(s->workers[i].arena);
+        s->workers[i].arena = NULL;
+        deque_trim(&s->workers[i].deque);
+    }
+}
+
+// Run scheduler until every process has finished or is parked
 void scheduler_run(Value* menv) {
+    (void)menv;
     if (global_scheduler.running) {
         return;
     }
     global_scheduler.running = 1;
 
-    while (global_scheduler.count > 0) {
-        Value* proc = scheduler_dequeue();
+    while (global_scheduler.serial_count > 0) {
+        Value* proc = serial_dequeue();
         if (proc) {
-            run_process(proc, menv);
+            run_process(proc);
         }
     }
 
     global_scheduler.running = 0;
+    scheduler_sync();
 }
 
-// Park current process (for blocking channel operations)
+// Park a process (for blocking channel operations). The running one, on
+// its own stack, suspends here until scheduler_unpark queues it again.
 void scheduler_park(Value* proc) {
-    if (proc) {
-        proc->proc.state = PROC_PARKED;
+    if (!proc) return;
+    proc->proc.state = PROC_PARKED;
+    GoStack* st = proc->proc.stack;
+    if (proc == sched_current && st) {
+        go_switch_out(st);
     }
 }
 
@@ -1524,7 +3561,7 @@ void scheduler_unpark(Value* proc, Value* val) {
     if (proc && proc->proc.state == PROC_PARKED) {
         proc->proc.state = PROC_READY;
         proc->proc.park_value = val;
-        scheduler_enqueue(proc);
+        serial_enqueue(proc);
     }
 }
 
@@ -1544,7 +3581,7 @@ Value* eval_go(Value* args, Value* menv) {
     Value* proc = scheduler_spawn(thunk, menv);
 
     // Start the scheduler if not already running
-    if (!global_scheduler.running && global_scheduler.count > 0) {
+    if (!sched_parallel && !global_scheduler.running && global_scheduler.serial_count > 0) {
         scheduler_run(menv);
     }
 
@@ -1555,227 +3592,426 @@ Value* eval_go(Value* args, Value* menv) {
 // Channel Operations with Continuation Parking (A4)
 // =============================================================================
 
-// Channel send with proper blocking
-static Value* chan_send_blocking(Value* ch, Value* val, Value* menv) {
-    if (!ch || ch->tag != T_CHAN || !ch->chan.ch) {
-        return mk_error("chan-send!: invalid channel");
-    }
+// A blocked channel op, on the stack of whoever is blocked. Handoffs go
+// straight into it: a sender's value, or the one a receiver gets. Batch
+// ops keep one waiter for the whole batch, woken once.
+typedef struct SelectGroup SelectGroup;
+
+typedef struct ChanWaiter {
+    Value* value;
+    Value* items;                 // Batch send: values left; batch recv: got, reversed
+    int want;                     // Batch recv: room left (0: single value)
+    Value* proc;                  // Suspended process; NULL if polling
+    WaitQueue* queue;
+    struct ChanWaiter* prev;
+    struct ChanWaiter* next;
+    SelectGroup* group;           // Select this case belongs to, if any
+    int done;                     // WAIT_*
+} ChanWaiter;
+
+// A blocked select waits on every case at once; the first handoff to
+// any of them takes the others off their channels
+struct SelectGroup {
+    ChanWaiter* cases;
+    int count;
+    int fired;                    // Case index, -1 while blocked
+};
+
+#define WAIT_BLOCKED 0
+#define WAIT_HANDED  1
+#define WAIT_CLOSED  2
+
+static void waiter_push(WaitQueue* q, ChanWaiter* w) {
+    w->queue = q;
+    w->next = NULL;
+    w->prev = q->tail;
+    if (q->tail) q->tail->next = w;
+    else q->head = w;
+    q->tail = w;
+}
 
-    Channel* chan = ch->chan.ch;
+static void waiter_unlink(ChanWaiter* w) {
+    WaitQueue* q = w->queue;
+    if (!q) return;
+    if (w->prev) w->prev->next = w->next;
+    else q->head = w->next;
+    if (w->next) w->next->prev = w->prev;
+    else q->tail = w->prev;
+    w->queue = NULL;
+}
 
-    if (chan->closed) {
-        return mk_error("chan-send!: channel closed");
-    }
+static ChanWaiter* waiter_pop(WaitQueue* q) {
+    ChanWaiter* w = q->head;
+    if (w) waiter_unlink(w);
+    return w;
+}
 
-    // Check if there's a waiting receiver
-    if (!is_nil(chan->recv_waiters) && chan->recv_waiters->tag == T_CELL) {
-        Value* waiter = car(chan->recv_waiters);
-        chan->recv_waiters = cdr(chan->recv_waiters);
+static void waiter_wake(ChanWaiter* w, int how) {
+    w->done = how;
+    SelectGroup* g = w->group;
+    if (g) {
+        g->fired = (int)(w - g->cases);
+        for (int i = 0; i < g->count; i++) {
+            g->cases[i].done = how;
+            waiter_unlink(&g->cases[i]);
+        }
+    }
+    if (w->proc) scheduler_unpark(w->proc, w->value);
+}
 
-        // Unpark the receiver with the value
-        if (waiter && waiter->tag == T_PROCESS) {
-            scheduler_unpark(waiter, val);
+// Wait for a handoff to one of ws (a select's cases, or just one), all
+// queued already. A process on its own stack suspends; anything else (the
+// top level, a process without a stack) runs ready processes until one
+// hands off. WAIT_BLOCKED means nothing ever can. Either way the waiters
+// are off their channels afterwards.
+static int chan_wait(ChanWaiter* ws, int count) {
+    Value* self = sched_current;
+    if (!sched_parallel && self && self->proc.stack) {
+        GoStack* st = self->proc.stack;
+        for (int i = 0; i < count; i++) ws[i].proc = self;
+        st->waiter = ws;
+        scheduler_park(self);
+        st->waiter = NULL;
+    } else {
+        Scheduler* s = &global_scheduler;
+        int running = s->running;
+        s->running = 1;
+        while (!sched_parallel && ws->done == WAIT_BLOCKED) {
+            Value* proc = serial_dequeue();
+            if (!proc) break;
+            run_process(proc);
         }
-        return val;
+        s->running = running;
+    }
+    // A batch receiver that got some but not all it wanted is still queued
+    for (int i = 0; i < count; i++) waiter_unlink(&ws[i]);
+    return ws->done;
+}
+
+// Next value from a parked sender, waking it once it has nothing left to
+// send; NULL if none is parked
+static Value* chan_take_sender(Channel* chan) {
+    ChanWaiter* w = chan->senders.head;
+    if (!w) return NULL;
+    Value* val;
+    if (w->items) {
+        val = car(w->items);
+        w->items = cdr(w->items);
+        if (!is_nil(w->items)) return val;
+    } else {
+        val = w->value;
+    }
+    waiter_unlink(w);
+    waiter_wake(w, WAIT_HANDED);
+    return val;
+}
+
+// Hand val to a parked receiver; 0 if none is parked. A batch receiver
+// stays queued, collecting, until it is full or runs again.
+static int chan_give_receiver(Channel* chan, Value* val) {
+    ChanWaiter* w = chan->receivers.head;
+    if (!w) return 0;
+    if (w->want > 0) {
+        w->items = mk_cell(val, w->items);
+        if (--w->want == 0) waiter_unlink(w);
+        if (w->done == WAIT_BLOCKED) waiter_wake(w, WAIT_HANDED);
+        return 1;
     }
+    waiter_unlink(w);
+    w->value = val;
+    waiter_wake(w, WAIT_HANDED);
+    return 1;
+}
 
-    // Buffered channel: try to add to buffer
-    if (chan->capacity > 0 && chan->count < chan->capacity) {
+// Send without blocking: to a parked receiver, else into the buffer
+static int chan_try_send(Channel* chan, Value* val) {
+    if (chan_give_receiver(chan, val)) return 1;
+    if (chan->count < chan->capacity) {
         chan->buffer[chan->tail] = val;
         chan->tail = (chan->tail + 1) % chan->capacity;
         chan->count++;
+        return 1;
+    }
+    return 0;
+}
+
+// Receive without blocking: from the buffer (a parked sender refills the
+// slot), else from a parked sender; NULL if nothing is ready
+static Value* chan_try_recv(Channel* chan) {
+    if (chan->count > 0) {
+        Value* val = chan->buffer[chan->head];
+        chan->head = (chan->head + 1) % chan->capacity;
+        chan->count--;
+        Value* next = chan_take_sender(chan);
+        if (next) {
+            chan->buffer[chan->tail] = next;
+            chan->tail = (chan->tail + 1) % chan->capacity;
+            chan->count++;
+        }
         return val;
     }
+    return chan_take_sender(chan);
+}
+
+static int chan_ready(Channel* chan, int sending) {
+    if (sending) return chan->receivers.head || chan->count < chan->capacity;
+    return chan->count > 0 || chan->senders.head;
+}
 
-    // Unbuffered or buffer full: need to wait
-    // Add current process to send waiters
-    Value* current = global_scheduler.current;
-    if (current) {
-        // Create (process . value) pair
-        Value* pair = mk_cell(current, val);
-        chan->send_waiters = mk_cell(pair, chan->send_waiters);
-        scheduler_park(current);
-        // In a real cooperative scheduler, we'd yield here
+// Channel send with proper blocking
+static Value* chan_send_blocking(Value* ch, Value* val, Value* menv) {
+    (void)menv;
+    if (!ch || val_tag(ch) != T_CHAN || !ch->chan.ch) {
+        return mk_error("chan-send!: invalid channel");
     }
 
+    Channel* chan = ch->chan.ch;
+
+    if (chan->closed) {
+        return mk_error("chan-send!: channel closed");
+    }
+    if (chan_try_send(chan, val)) return val;
+
+    // Unbuffered or buffer full: wait for a receiver
+    ChanWaiter w = { .value = val };
+    waiter_push(&chan->senders, &w);
+    int how = chan_wait(&w, 1);
+    if (how == WAIT_CLOSED) return mk_error("chan-send!: channel closed");
+    if (how == WAIT_BLOCKED) return mk_error("chan-send!: deadlock, nothing can receive");
     return val;
 }
 
 // Channel receive with proper blocking
 static Value* chan_recv_blocking(Value* ch, Value* menv) {
-    if (!ch || ch->tag != T_CHAN || !ch->chan.ch) {
+    (void)menv;
+    if (!ch || val_tag(ch) != T_CHAN || !ch->chan.ch) {
         return mk_error("chan-recv!: invalid channel");
     }
 
     Channel* chan = ch->chan.ch;
 
-    // Check buffer first
-    if (chan->count > 0) {
-        Value* val = chan->buffer[chan->head];
-        chan->head = (chan->head + 1) % chan->capacity;
-        chan->count--;
-
-        // Check if there's a waiting sender
-        if (!is_nil(chan->send_waiters) && chan->send_waiters->tag == T_CELL) {
-            Value* waiter_pair = car(chan->send_waiters);
-            chan->send_waiters = cdr(chan->send_waiters);
+    Value* val = chan_try_recv(chan);
+    if (val) return val;
 
-            if (waiter_pair && waiter_pair->tag == T_CELL) {
-                Value* waiter = car(waiter_pair);
-                Value* waiter_val = cdr(waiter_pair);
-
-                // Add sender's value to buffer
-                chan->buffer[chan->tail] = waiter_val;
-                chan->tail = (chan->tail + 1) % chan->capacity;
-                chan->count++;
+    // Channel closed and empty
+    if (chan->closed) {
+        return NIL;
+    }
 
-                // Unpark the sender
-                if (waiter && waiter->tag == T_PROCESS) {
-                    scheduler_unpark(waiter, waiter_val);
-                }
-            }
-        }
+    ChanWaiter self = { .value = NIL };
+    waiter_push(&chan->receivers, &self);
+    int how = chan_wait(&self, 1);
+    if (how == WAIT_BLOCKED) return mk_error("chan-recv!: deadlock, nothing can send");
+    return self.value;
+}
 
-        return val;
+// Send every item of a list, blocking (once) for whatever does not fit;
+// the number sent, short if the channel closes
+static Value* chan_send_many(Value* ch, Value* items) {
+    Channel* chan = ch->chan.ch;
+    long sent = 0;
+    while (!is_nil(items) && !chan->closed && chan_try_send(chan, car(items))) {
+        items = cdr(items);
+        sent++;
     }
+    if (is_nil(items) || chan->closed) return mk_int(sent);
+
+    // Receivers take the rest straight from the waiter
+    int total = list_length(items);
+    ChanWaiter w = { .value = NIL, .items = items };
+    waiter_push(&chan->senders, &w);
+    int how = chan_wait(&w, 1);
+    if (how == WAIT_BLOCKED) return mk_error("chan-send-many!: deadlock, nothing can receive");
+    return mk_int(sent + total - (how == WAIT_CLOSED ? list_length(w.items) : 0));
+}
 
-    // Check if there's a waiting sender (unbuffered case)
-    if (!is_nil(chan->send_waiters) && chan->send_waiters->tag == T_CELL) {
-        Value* waiter_pair = car(chan->send_waiters);
-        chan->send_waiters = cdr(chan->send_waiters);
+// Receive up to n values, blocking only while there are none; a list in
+// arrival order, nil once closed and drained
+static Value* chan_recv_many(Value* ch, int n) {
+    Channel* chan = ch->chan.ch;
+    Value* got = NIL;
+    int count = 0;
+    Value* val;
+    while (count < n && (val = chan_try_recv(chan))) {
+        got = mk_cell(val, got);
+        count++;
+    }
+    if (count == 0 && !chan->closed) {
+        // Senders keep filling the waiter until it runs again
+        ChanWaiter w = { .value = NIL, .items = NIL, .want = n };
+        waiter_push(&chan->receivers, &w);
+        if (chan_wait(&w, 1) == WAIT_BLOCKED) return mk_error("chan-recv-many!: deadlock, nothing can send");
+        got = w.items;
+    }
 
-        if (waiter_pair && waiter_pair->tag == T_CELL) {
-            Value* waiter = car(waiter_pair);
-            Value* val = cdr(waiter_pair);
+    Value* list = NIL;
+    for (; !is_nil(got); got = cdr(got)) list = mk_cell(car(got), list);
+    return list;
+}
 
-            // Unpark the sender
-            if (waiter && waiter->tag == T_PROCESS) {
-                scheduler_unpark(waiter, val);
-            }
+// Wake everything parked on a closed channel: receivers get nil, senders
+// an error
+static void chan_close_waiters(Channel* chan) {
+    ChanWaiter* w;
+    while ((w = waiter_pop(&chan->receivers))) {
+        w->value = NIL;
+        waiter_wake(w, WAIT_CLOSED);
+    }
+    while ((w = waiter_pop(&chan->senders))) waiter_wake(w, WAIT_CLOSED);
+}
 
-            return val;
+// Drop every suspended process: what it was running is going away
+static void go_stacks_release(void) {
+    while (go_stacks) {
+        GoStack* st = go_stacks;
+        ChanWaiter* w = st->waiter;
+        if (w && w->group) {
+            for (int i = 0; i < w->group->count; i++) waiter_unlink(&w->group->cases[i]);
+        } else if (w) {
+            waiter_unlink(w);
         }
+        go_stack_free(st);
     }
+}
 
-    // Channel closed and empty
-    if (chan->closed) {
-        return NIL;
+Value* prim_chan_send_many(Value* args, Value* menv) {
+    (void)menv;
+    note_mutation();
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b) || !is_chan(a) || !a->chan.ch || list_length(b) < 0) {
+        return mk_error("chan-send-many!: requires a channel and a list");
     }
+    if (a->chan.ch->closed) {
+        return mk_error("chan-send-many!: channel closed");
+    }
+    return chan_send_many(a, b);
+}
 
-    // Need to wait: add current process to recv waiters
-    Value* current = global_scheduler.current;
-    if (current) {
-        chan->recv_waiters = mk_cell(current, chan->recv_waiters);
-        scheduler_park(current);
-        // In a real cooperative scheduler, we'd yield here and return park_value
-        return current->proc.park_value;
+Value* prim_chan_recv_many(Value* args, Value* menv) {
+    (void)menv;
+    note_mutation();
+    Value* a; Value* b;
+    if (!get_two_args(args, &a, &b) || !is_chan(a) || !a->chan.ch ||
+        !b || val_tag(b) != T_INT || val_int(b) <= 0 || val_int(b) > INT_MAX) {
+        return mk_error("chan-recv-many!: requires a channel and a positive count");
     }
+    return chan_recv_many(a, (int)val_int(b));
+}
 
-    return NIL;
+// -- Select --
+
+#define SELECT_MAX_CASES 64
+
+typedef struct {
+    Channel* chan;
+    Value* val;                   // Value to send (send cases)
+    Value* body;
+    int sending;
+} SelectCase;
+
+static __thread unsigned int select_seed = 2463534242u;
+
+// Where a select starts looking, so no case is always first
+static int select_start(int n) {
+    unsigned int x = select_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    select_seed = x;
+    return (int)(x % (unsigned int)n);
+}
+
+// Body after the => of a clause; NULL if there is none
+static Value* select_body(Value* clause) {
+    for (Value* rest = cdr(clause); !is_nil(rest); rest = cdr(rest)) {
+        Value* item = car(rest);
+        if (item && val_tag(item) == T_SYM && sym_eq_str(item, "=>")) return car(cdr(rest));
+    }
+    return NULL;
 }
 
 // eval_select implements (select clauses...)
-// Each clause is ((recv ch) => body) or ((send ch val) => body) or (default => body)
+// Each clause is ((recv ch) => body) or ((send ch val) => body) or (default => body).
+// Channels and send values are evaluated once, in order. Of the cases
+// ready, the one taken comes from a random starting point onwards; with
+// none ready and no default, the select parks on all of them at once and
+// runs the first one handed off to.
 Value* eval_select(Value* args, Value* menv) {
     if (is_nil(args)) {
         return NIL;
     }
 
+    SelectCase cases[SELECT_MAX_CASES];
+    int n = 0;
     Value* default_body = NULL;
 
-    // First pass: check for ready channels
-    Value* clauses = args;
-    while (!is_nil(clauses)) {
+    for (Value* clauses = args; !is_nil(clauses); clauses = cdr(clauses)) {
         Value* clause = car(clauses);
-        if (!clause || clause->tag != T_CELL) {
-            clauses = cdr(clauses);
-            continue;
-        }
+        if (!clause || val_tag(clause) != T_CELL) continue;
 
         Value* op = car(clause);
 
         // Check for default clause
-        if (op && op->tag == T_SYM && sym_eq_str(op, "default")) {
+        if (op && val_tag(op) == T_SYM && sym_eq_str(op, "default")) {
             default_body = car(cdr(clause));
-            clauses = cdr(clauses);
             continue;
         }
 
         // Check for (recv ch) or (send ch val)
-        if (op && op->tag == T_CELL) {
-            Value* op_type = car(op);
-
-            if (op_type && op_type->tag == T_SYM) {
-                if (sym_eq_str(op_type, "recv")) {
-                    // (recv ch)
-                    Value* ch_expr = car(cdr(op));
-                    Value* ch = eval(ch_expr, menv);
-
-                    if (ch && ch->tag == T_CHAN && ch->chan.ch) {
-                        Channel* chan = ch->chan.ch;
-
-                        // Check if channel has data or waiting sender
-                        if (chan->count > 0 || !is_nil(chan->send_waiters)) {
-                            // Find body after =>
-                            Value* rest = cdr(clause);
-                            while (!is_nil(rest)) {
-                                Value* item = car(rest);
-                                if (item && item->tag == T_SYM && sym_eq_str(item, "=>")) {
-                                    Value* body = car(cdr(rest));
-                                    // Do the receive
-                                    Value* val = chan_recv_blocking(ch, menv);
-                                    (void)val;  // Could bind to variable
-                                    return eval(body, menv);
-                                }
-                                rest = cdr(rest);
-                            }
-                        }
-                    }
-                } else if (sym_eq_str(op_type, "send")) {
-                    // (send ch val)
-                    Value* ch_expr = car(cdr(op));
-                    Value* val_expr = car(cdr(cdr(op)));
-                    Value* ch = eval(ch_expr, menv);
-
-                    if (ch && ch->tag == T_CHAN && ch->chan.ch) {
-                        Channel* chan = ch->chan.ch;
-
-                        // Check if channel can accept or has waiting receiver
-                        int can_send = !is_nil(chan->recv_waiters);
-                        if (chan->capacity > 0) {
-                            can_send = can_send || (chan->count < chan->capacity);
-                        }
-
-                        if (can_send) {
-                            // Find body after =>
-                            Value* rest = cdr(clause);
-                            while (!is_nil(rest)) {
-                                Value* item = car(rest);
-                                if (item && item->tag == T_SYM && sym_eq_str(item, "=>")) {
-                                    Value* body = car(cdr(rest));
-                                    Value* val = eval(val_expr, menv);
-                                    chan_send_blocking(ch, val, menv);
-                                    return eval(body, menv);
-                                }
-                                rest = cdr(rest);
-                            }
-                        }
-                    }
-                }
-            }
+        if (!op || val_tag(op) != T_CELL) continue;
+        Value* op_type = car(op);
+        if (!op_type || val_tag(op_type) != T_SYM) continue;
+        int sending = sym_eq_str(op_type, "send");
+        if (!sending && !sym_eq_str(op_type, "recv")) continue;
+        Value* body = select_body(clause);
+        if (!body) continue;
+
+        Value* ch = eval(car(cdr(op)), menv);
+        if (!ch || val_tag(ch) != T_CHAN || !ch->chan.ch) continue;
+        if (n == SELECT_MAX_CASES) {
+            return mk_error("select: too many cases");
         }
+        SelectCase* c = &cases[n++];
+        c->chan = ch->chan.ch;
+        c->val = sending ? eval(car(cdr(cdr(op))), menv) : NULL;
+        c->body = body;
+        c->sending = sending;
+    }
 
-        clauses = cdr(clauses);
+    if (n > 0) note_mutation();
+    int start = n > 0 ? select_start(n) : 0;
+    for (int i = 0; i < n; i++) {
+        SelectCase* c = &cases[(start + i) % n];
+        if (c->sending && c->chan->closed) {
+            return mk_error("select: send on closed channel");
+        }
+        if (c->sending ? chan_try_send(c->chan, c->val)
+                       : (chan_ready(c->chan, 0) || c->chan->closed)) {
+            if (!c->sending) chan_try_recv(c->chan);
+            return eval(c->body, menv);
+        }
     }
 
     // No ready channel - use default if available
-    if (default_body) {
-        return eval(default_body, menv);
+    if (default_body || n == 0) {
+        return default_body ? eval(default_body, menv) : NIL;
     }
 
-    // No default and nothing ready - would need to block
-    // For now, just return nil
-    return NIL;
+    // Park on every case; the first handoff takes the others off
+    ChanWaiter waiters[SELECT_MAX_CASES];
+    SelectGroup group = { waiters, n, -1 };
+    for (int i = 0; i < n; i++) {
+        waiters[i] = (ChanWaiter){ .value = cases[i].sending ? cases[i].val : NIL, .group = &group };
+        waiter_push(cases[i].sending ? &cases[i].chan->senders : &cases[i].chan->receivers, &waiters[i]);
+    }
+    int how = chan_wait(waiters, n);
+    if (how == WAIT_BLOCKED) {
+        return mk_error("select: deadlock, no case can proceed");
+    }
+    if (how == WAIT_CLOSED && cases[group.fired].sending) {
+        return mk_error("select: send on closed channel");
+    }
+    return eval(cases[group.fired].body, menv);
 }
 
 // =============================================================================
@@ -1788,6 +4024,7 @@ Value* eval_select(Value* args, Value* menv) {
 
 typedef struct {
     char* name;
+    Value* tag;                    // Interned #:name, the head of every instance
     char* field_names[MAX_USER_FIELDS];
     char* field_types[MAX_USER_FIELDS];
     int field_count;
@@ -1804,8 +4041,17 @@ static int user_register_type(const char* name) {
     char* name_copy = strdup(name);
     if (!name_copy) return -1;  // OOM
 
+    char tag_buf[128];
+    snprintf(tag_buf, sizeof(tag_buf), "#:%s", name);
+    Value* tag = mk_sym(tag_buf);
+    if (!tag) {
+        free(name_copy);
+        return -1;
+    }
+
     int idx = user_type_count++;
     user_type_registry[idx].name = name_copy;
+    user_type_registry[idx].tag = tag;
     user_type_registry[idx].field_count = 0;
     return idx;
 }
@@ -1845,192 +4091,201 @@ static UserTypeDef* user_find_type(const char* name) {
     return NULL;
 }
 
-// User type instance structure stored in cell
-// We'll represent user types as (type-name . ((field1 . val1) (field2 . val2) ...))
-
-// Check if value is a user type instance
-static int is_user_type(Value* v, const char* type_name) {
-    if (!v || v->tag != T_CELL) return 0;
-    Value* tag = car(v);
-    if (!tag || tag->tag != T_SYM) return 0;
+// The type a primitive names: a registry index (what the generated
+// constructors and accessors pass) or a type name (the public forms)
+static UserTypeDef* user_type_arg(Value* v) {
+    if (!v) return NULL;
+    if (val_tag(v) == T_INT) {
+        long idx = val_int(v);
+        return idx >= 0 && idx < user_type_count ? &user_type_registry[idx] : NULL;
+    }
+    if (val_tag(v) == T_SYM) return user_find_type(v->s);
+    return NULL;
+}
 
-    // Check for #:type-name format
-    char expected[128];
-    snprintf(expected, sizeof(expected), "#:%s", type_name);
-    return strcmp(tag->s, expected) == 0;
+static int user_field_slot(UserTypeDef* td, const char* field_name) {
+    for (int i = 0; i < td->field_count; i++) {
+        if (strcmp(td->field_names[i], field_name) == 0) return i;
+    }
+    return -1;
 }
 
-// Get field from user type instance
-static Value* user_type_get_field(Value* v, const char* field_name) {
-    if (!v || v->tag != T_CELL) return NIL;
+// User type instances are (#:type-name v0 v1 ...): field i is the car of
+// the i-th cdr, so access goes by the slot the accessor was built with.
+// Compiled, an instance drops its tag and becomes a pair chain whose
+// fields sit at constant paths (record_to_c_expr, record_field_path)
+
+// Check if value is an instance of td
+static int is_user_type(Value* v, UserTypeDef* td) {
+    return v && val_tag(v) == T_CELL && car(v) == td->tag;
+}
 
+// The cell holding field `slot`, or NULL if v is not an instance of td
+static Value* user_type_slot(Value* v, UserTypeDef* td, int slot) {
+    if (!is_user_type(v, td) || slot < 0 || slot >= td->field_count) return NULL;
     Value* fields = cdr(v);
-    while (!is_nil(fields) && fields->tag == T_CELL) {
-        Value* pair = car(fields);
-        if (pair && pair->tag == T_CELL) {
-            Value* name = car(pair);
-            if (name && name->tag == T_SYM && strcmp(name->s, field_name) == 0) {
-                return cdr(pair);
-            }
-        }
-        fields = cdr(fields);
+    for (int i = 0; i < slot && val_tag(fields) == T_CELL; i++) fields = cdr(fields);
+    return val_tag(fields) == T_CELL ? fields : NULL;
+}
+
+// Field `slot` of a lifted record: a constant path into its pair chain
+static Value* user_type_code_ref(Value* obj, UserTypeDef* td, int slot) {
+    CodeBuilder cb;
+    cb_init(&cb);
+    record_field_path(&cb, obj, slot, td->field_count);
+    return cb_finish(&cb);
+}
+
+// Store into a lifted record: the old field value is released and the
+// record and the result each hold a reference to the new one
+static Value* user_type_code_set(Value* obj, UserTypeDef* td, int slot, Value* val) {
+    Value* sv = code_of(val);
+    if (!sv) return mk_error("type-set!: cannot lift the field value");
+    Value* path = user_type_code_ref(mk_code("_rec"), td, slot);
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "({ Obj* _rec = ");
+    cb_code(&cb, obj);
+    cb_text(&cb, "; Obj* _fv = ");
+    cb_code(&cb, sv);
+    cb_text(&cb, "; dec_ref(");
+    cb_code(&cb, path);
+    cb_text(&cb, "); ");
+    cb_code(&cb, path);
+    cb_text(&cb, " = _fv; inc_ref(_fv); _fv; })");
+    return cb_finish(&cb);
+}
+
+static Value* user_type_get(Value* obj, UserTypeDef* td, int slot) {
+    if (is_code(obj)) return user_type_code_ref(obj, td, slot);
+    Value* cell = user_type_slot(obj, td, slot);
+    return cell ? car(cell) : NIL;
+}
+
+static Value* user_type_set(Value* obj, UserTypeDef* td, int slot, Value* val) {
+    if (is_code(obj)) return user_type_code_set(obj, td, slot, val);
+    Value* cell = user_type_slot(obj, td, slot);
+    if (cell) {
+        note_mutation();
+        cell->cell.car = val;
     }
-    return NIL;
+    return val;
 }
 
-// Set field in user type instance
-static void user_type_set_field(Value* v, const char* field_name, Value* val) {
-    if (!v || v->tag != T_CELL) return;
+static Value* mk_user_lambda(Value* params, Value* body, Value* menv) {
+    return mk_lambda(params, body, menv->menv.env);
+}
 
-    Value* fields = cdr(v);
-    while (!is_nil(fields) && fields->tag == T_CELL) {
-        Value* pair = car(fields);
-        if (pair && pair->tag == T_CELL) {
-            Value* name = car(pair);
-            if (name && name->tag == T_SYM && strcmp(name->s, field_name) == 0) {
-                pair->cell.cdr = val;
-                return;
-            }
-        }
-        fields = cdr(fields);
+// (op obj type slot rest...) with the type passed as its registry index
+static Value* user_type_call(const char* op, int type_idx, int slot, Value* rest) {
+    Value* tail = slot < 0 ? rest : mk_cell(mk_int(slot), rest);
+    return mk_cell(mk_sym(op), mk_cell(mk_sym("obj"), mk_cell(mk_int(type_idx), tail)));
+}
+
+// Create the constructor, accessors, setters and predicate of a type.
+// Each one carries the type's registry index and its field's slot, so
+// nothing is looked up by name when they run; applied to lifted values
+// they emit the specialized pair-chain constructor and constant paths
+static void create_type_primitives(int type_idx, Value* menv) {
+    UserTypeDef* td = &user_type_registry[type_idx];
+    char buf[160];
+
+    // mk-TypeName: (lambda (f0 f1 ...) (make-type-instance idx f0 f1 ...))
+    Value* params = NIL;
+    for (int i = td->field_count - 1; i >= 0; i--) params = mk_cell(mk_sym(td->field_names[i]), params);
+    snprintf(buf, sizeof(buf), "mk-%s", td->name);
+    global_define(mk_sym(buf), mk_user_lambda(params,
+        mk_cell(mk_sym("make-type-instance"), mk_cell(mk_int(type_idx), params)), menv));
+
+    for (int i = 0; i < td->field_count; i++) {
+        // TypeName-field: (lambda (obj) (type-ref obj idx slot))
+        snprintf(buf, sizeof(buf), "%s-%s", td->name, td->field_names[i]);
+        global_define(mk_sym(buf), mk_user_lambda(mk_cell(mk_sym("obj"), NIL),
+            user_type_call("type-ref", type_idx, i, NIL), menv));
+
+        // set-TypeName-field!: (lambda (obj val) (type-set! obj idx slot val))
+        snprintf(buf, sizeof(buf), "set-%s-%s!", td->name, td->field_names[i]);
+        global_define(mk_sym(buf), mk_user_lambda(mk_cell(mk_sym("obj"), mk_cell(mk_sym("val"), NIL)),
+            user_type_call("type-set!", type_idx, i, mk_cell(mk_sym("val"), NIL)), menv));
     }
+
+    // TypeName?: (lambda (obj) (type-is? obj idx))
+    snprintf(buf, sizeof(buf), "%s?", td->name);
+    global_define(mk_sym(buf), mk_user_lambda(mk_cell(mk_sym("obj"), NIL),
+        user_type_call("type-is?", type_idx, -1, NIL), menv));
 }
 
-// Primitive for constructor: (mk-TypeName field1 field2 ...)
-typedef struct {
-    char type_name[64];
-    char* field_names[MAX_USER_FIELDS];
-    int field_count;
-} ConstructorData;
-
-static ConstructorData constructors[MAX_USER_TYPES];
-static int constructor_count = 0;
-
-// Create primitives for a type
-static void create_type_primitives(const char* type_name, int field_count, char** field_names, Value* menv) {
-    char buf[128];
-
-    // Store constructor data
-    if (constructor_count >= MAX_USER_TYPES) return;
-    int cidx = constructor_count++;
-    strncpy(constructors[cidx].type_name, type_name, 63);
-    constructors[cidx].type_name[63] = '\0';
-    constructors[cidx].field_count = field_count;
-    for (int i = 0; i < field_count; i++) {
-        constructors[cidx].field_names[i] = strdup(field_names[i]);
-    }
-
-    // Create constructor: mk-TypeName
-    snprintf(buf, sizeof(buf), "mk-%s", type_name);
-
-    // We need to create a closure that captures the type info
-    // Since C doesn't have closures, we'll create a lambda
-    // The constructor will be: (lambda args (make-instance type-name args))
-
-    // For simplicity, we'll define constructors that work for up to 4 fields
-    // and use the global constructors array to look up field info
-
-    // Register as primitive with unique ID
-    // This is a simplified implementation - in production you'd use proper closure support
-    Value* constructor_lam = mk_lambda(
-        mk_sym("args"),  // Rest args
-        mk_cell(mk_sym("make-type-instance"),
-            mk_cell(mk_sym(type_name),
-                mk_cell(mk_sym("args"), NIL))),
-        menv->menv.env
-    );
-    global_define(mk_sym(buf), constructor_lam);
-
-    // Create accessors: TypeName-fieldName
-    for (int i = 0; i < field_count; i++) {
-        snprintf(buf, sizeof(buf), "%s-%s", type_name, field_names[i]);
-
-        // Create accessor lambda
-        Value* accessor_lam = mk_lambda(
-            mk_cell(mk_sym("obj"), NIL),
-            mk_cell(mk_sym("type-get-field"),
-                mk_cell(mk_sym("obj"),
-                    mk_cell(mk_sym(field_names[i]), NIL))),
-            menv->menv.env
-        );
-        global_define(mk_sym(buf), accessor_lam);
-
-        // Create setter: set-TypeName-fieldName!
-        snprintf(buf, sizeof(buf), "set-%s-%s!", type_name, field_names[i]);
-        Value* setter_lam = mk_lambda(
-            mk_cell(mk_sym("obj"), mk_cell(mk_sym("val"), NIL)),
-            mk_cell(mk_sym("type-set-field!"),
-                mk_cell(mk_sym("obj"),
-                    mk_cell(mk_sym(field_names[i]),
-                        mk_cell(mk_sym("val"), NIL)))),
-            menv->menv.env
-        );
-        global_define(mk_sym(buf), setter_lam);
-    }
-
-    // Create predicate: TypeName?
-    snprintf(buf, sizeof(buf), "%s?", type_name);
-    Value* pred_lam = mk_lambda(
-        mk_cell(mk_sym("obj"), NIL),
-        mk_cell(mk_sym("type-is?"),
-            mk_cell(mk_sym("obj"),
-                mk_cell(mk_sym(type_name), NIL))),
-        menv->menv.env
-    );
-    global_define(mk_sym(buf), pred_lam);
-}
-
-// Primitive to create a type instance
+// Primitive to create a type instance: (make-type-instance type f0 f1 ...)
 Value* prim_make_type_instance(Value* args, Value* menv) {
     (void)menv;
 
     if (is_nil(args)) return mk_error("make-type-instance: requires type name");
 
-    Value* type_name_val = car(args);
-    if (!type_name_val || type_name_val->tag != T_SYM) {
-        return mk_error("make-type-instance: type name must be a symbol");
-    }
-
-    const char* type_name = type_name_val->s;
-    UserTypeDef* td = user_find_type(type_name);
+    UserTypeDef* td = user_type_arg(car(args));
     if (!td) {
         return mk_error("make-type-instance: unknown type");
     }
 
-    // Build field list from args
-    Value* field_vals = car(cdr(args));  // args list
+    // Missing fields are nil, extra values are dropped
+    Value* vals[MAX_USER_FIELDS];
+    int any_code = 0;
+    Value* arg = cdr(args);
+    for (int i = 0; i < td->field_count; i++) {
+        vals[i] = val_tag(arg) == T_CELL ? car(arg) : NIL;
+        if (is_code(vals[i])) any_code = 1;
+        if (val_tag(arg) == T_CELL) arg = cdr(arg);
+    }
+
     Value* fields = NIL;
+    for (int i = td->field_count - 1; i >= 0; i--) fields = mk_cell(vals[i], fields);
 
-    // Build fields in reverse order, then reverse
-    int i = 0;
-    Value* arg = field_vals;
-    while (i < td->field_count && !is_nil(arg)) {
-        Value* val = (arg->tag == T_CELL) ? car(arg) : arg;
-        Value* pair = mk_cell(mk_sym(td->field_names[i]), val);
-        fields = mk_cell(pair, fields);
-        i++;
-        if (arg->tag == T_CELL) {
-            arg = cdr(arg);
-        } else {
-            break;
-        }
+    // A record with a lifted field is built at run time; one whose fields
+    // are all known stays a compile-time value, so its accessors fold
+    if (any_code) {
+        char* code_str = record_to_c_expr(fields);
+        if (!code_str) return mk_error("make-type-instance: cannot lift a field value");
+        Value* result = mk_code(code_str);
+        free(code_str);
+        return result;
     }
+    return mk_cell(td->tag, fields);
+}
 
-    // Reverse fields to get correct order
-    Value* rev_fields = NIL;
-    while (!is_nil(fields)) {
-        rev_fields = mk_cell(car(fields), rev_fields);
-        fields = cdr(fields);
+// Primitive to read a field by slot: (type-ref obj type slot)
+Value* prim_type_ref(Value* args, Value* menv) {
+    (void)menv;
+    Value* obj = car(args);
+    UserTypeDef* td = user_type_arg(car(cdr(args)));
+    Value* slot = car(cdr(cdr(args)));
+    if (!td || !slot || val_tag(slot) != T_INT || val_int(slot) < 0 || val_int(slot) >= td->field_count) {
+        return mk_error("type-ref: requires object, type and field slot");
     }
+    return user_type_get(obj, td, (int)val_int(slot));
+}
 
-    // Create type tag
-    char tag_buf[128];
-    snprintf(tag_buf, sizeof(tag_buf), "#:%s", type_name);
+// Primitive to write a field by slot: (type-set! obj type slot val)
+Value* prim_type_set(Value* args, Value* menv) {
+    (void)menv;
+    Value* obj = car(args);
+    UserTypeDef* td = user_type_arg(car(cdr(args)));
+    Value* slot = car(cdr(cdr(args)));
+    if (!td || !slot || val_tag(slot) != T_INT || val_int(slot) < 0 || val_int(slot) >= td->field_count ||
+        is_nil(cdr(cdr(cdr(args))))) {
+        return mk_error("type-set!: requires object, type, field slot and value");
+    }
+    return user_type_set(obj, td, (int)val_int(slot), car(cdr(cdr(cdr(args)))));
+}
 
-    return mk_cell(mk_sym(tag_buf), rev_fields);
+// The type of an instance, from its tag
+static UserTypeDef* user_type_of(Value* v) {
+    if (!v || val_tag(v) != T_CELL) return NULL;
+    for (int i = 0; i < user_type_count; i++) {
+        if (car(v) == user_type_registry[i].tag) return &user_type_registry[i];
+    }
+    return NULL;
 }
 
-// Primitive to get field from type instance
+// Primitive to get field from type instance by name
 Value* prim_type_get_field(Value* args, Value* menv) {
     (void)menv;
 
@@ -2039,14 +4294,16 @@ Value* prim_type_get_field(Value* args, Value* menv) {
         return mk_error("type-get-field: requires object and field name");
     }
 
-    if (!b || b->tag != T_SYM) {
+    if (!b || val_tag(b) != T_SYM) {
         return mk_error("type-get-field: field name must be a symbol");
     }
 
-    return user_type_get_field(a, b->s);
+    UserTypeDef* td = user_type_of(a);
+    int slot = td ? user_field_slot(td, b->s) : -1;
+    return slot < 0 ? NIL : user_type_get(a, td, slot);
 }
 
-// Primitive to set field in type instance
+// Primitive to set field in type instance by name
 Value* prim_type_set_field(Value* args, Value* menv) {
     (void)menv;
 
@@ -2058,11 +4315,13 @@ Value* prim_type_set_field(Value* args, Value* menv) {
     Value* field = car(cdr(args));
     Value* val = car(cdr(cdr(args)));
 
-    if (!field || field->tag != T_SYM) {
+    if (!field || val_tag(field) != T_SYM) {
         return mk_error("type-set-field!: field name must be a symbol");
     }
 
-    user_type_set_field(obj, field->s, val);
+    UserTypeDef* td = user_type_of(obj);
+    int slot = td ? user_field_slot(td, field->s) : -1;
+    if (slot >= 0) user_type_set(obj, td, slot, val);
     return val;
 }
 
@@ -2075,21 +4334,22 @@ Value* prim_type_is(Value* args, Value* menv) {
         return NIL;
     }
 
-    if (!b || b->tag != T_SYM) {
-        return NIL;
-    }
+    // Compiled records carry no tag to test
+    if (is_code(a)) return mk_error("type-is?: cannot test a lifted record");
 
-    return is_user_type(a, b->s) ? SYM_T : NIL;
+    UserTypeDef* td = user_type_arg(b);
+    return td && is_user_type(a, td) ? SYM_T : NIL;
 }
 
 // eval_deftype implements (deftype TypeName (field1 Type1) (field2 Type2 :weak) ...)
 Value* eval_deftype(Value* args, Value* menv) {
+    note_mutation();
     if (is_nil(args)) {
         return mk_error("deftype: requires type name");
     }
 
     Value* type_name_val = car(args);
-    if (!type_name_val || type_name_val->tag != T_SYM) {
+    if (!type_name_val || val_tag(type_name_val) != T_SYM) {
         return mk_error("deftype: type name must be a symbol");
     }
 
@@ -2107,14 +4367,11 @@ Value* eval_deftype(Value* args, Value* menv) {
     }
 
     // Parse field definitions
-    char* field_names[MAX_USER_FIELDS];
-    int field_count = 0;
-
     Value* field_defs = cdr(args);
-    while (!is_nil(field_defs) && field_defs->tag == T_CELL) {
+    while (!is_nil(field_defs) && val_tag(field_defs) == T_CELL) {
         Value* field_def = car(field_defs);
 
-        if (!field_def || field_def->tag != T_CELL) {
+        if (!field_def || val_tag(field_def) != T_CELL) {
             field_defs = cdr(field_defs);
             continue;
         }
@@ -2122,51 +4379,30 @@ Value* eval_deftype(Value* args, Value* menv) {
         Value* field_name = car(field_def);
         Value* field_type = car(cdr(field_def));
 
-        if (!field_name || field_name->tag != T_SYM) {
+        if (!field_name || val_tag(field_name) != T_SYM) {
             field_defs = cdr(field_defs);
             continue;
         }
 
         const char* fname = field_name->s;
-        const char* ftype = (field_type && field_type->tag == T_SYM) ? field_type->s : "any";
+        const char* ftype = (field_type && val_tag(field_type) == T_SYM) ? field_type->s : "any";
 
         // Check for :weak annotation
         int is_weak = 0;
         Value* annotation = car(cdr(cdr(field_def)));
-        if (annotation && annotation->tag == T_SYM && strcmp(annotation->s, ":weak") == 0) {
+        if (annotation && val_tag(annotation) == T_SYM && strcmp(annotation->s, ":weak") == 0) {
             is_weak = 1;
         }
 
         if (user_add_type_field(type_idx, fname, ftype, is_weak) < 0) {
-            // Clean up already allocated field names and return error
-            for (int i = 0; i < field_count; i++) {
-                free(field_names[i]);
-            }
-            return mk_error("deftype: field registration failed (OOM)");
-        }
-
-        if (field_count < MAX_USER_FIELDS) {
-            char* fname_copy = strdup(fname);
-            if (!fname_copy) {
-                // Clean up already allocated field names and return error
-                for (int i = 0; i < field_count; i++) {
-                    free(field_names[i]);
-                }
-                return mk_error("deftype: field name allocation failed (OOM)");
-            }
-            field_names[field_count++] = fname_copy;
+            return mk_error("deftype: field registration failed (too many fields or OOM)");
         }
 
         field_defs = cdr(field_defs);
     }
 
     // Create primitives for the type
-    create_type_primitives(type_name, field_count, field_names, menv);
-
-    // Clean up
-    for (int i = 0; i < field_count; i++) {
-        free(field_names[i]);
-    }
+    create_type_primitives(type_idx, menv);
 
     return type_name_val;
 }
@@ -2181,4 +4417,91 @@ void register_deftype_primitives(Value* env) {
     global_define(mk_sym("type-get-field"), mk_prim(prim_type_get_field));
     global_define(mk_sym("type-set-field!"), mk_prim(prim_type_set_field));
     global_define(mk_sym("type-is?"), mk_prim(prim_type_is));
+    global_define(mk_sym("type-ref"), mk_prim(prim_type_ref));
+    global_define(mk_sym("type-set!"), mk_prim(prim_type_set));
+}
+
+// =============================================================================
+// Global Snapshot (compile server)
+// =============================================================================
+
+typedef struct GlobalBinding {
+    Value* sym;
+    Value* pair;
+    Value* val;
+} GlobalBinding;
+
+struct GlobalSnapshot {
+    GlobalBinding* bindings;
+    size_t count;
+    int user_type_count;
+    int cont_tag_counter;
+};
+
+static void snapshot_binding(void* key, void* value, void* ctx) {
+    GlobalSnapshot* snap = ctx;
+    GlobalBinding* b = &snap->bindings[snap->count++];
+    b->sym = key;
+    b->pair = value;
+    b->val = cdr(value);
+}
+
+GlobalSnapshot* global_env_snapshot(void) {
+    GlobalSnapshot* snap = malloc(sizeof(GlobalSnapshot));
+    if (!snap) return NULL;
+    size_t n = global_env ? hashmap_size(global_env) : 0;
+    snap->bindings = malloc((n ? n : 1) * sizeof(GlobalBinding));
+    if (!snap->bindings) {
+        free(snap);
+        return NULL;
+    }
+    snap->count = 0;
+    if (global_env) hashmap_foreach(global_env, snapshot_binding, snap);
+    snap->user_type_count = user_type_count;
+    snap->cont_tag_counter = cont_tag_counter;
+    return snap;
+}
+
+void global_env_restore(GlobalSnapshot* snap) {
+    if (!snap) return;
+
+    // Bindings made since the snapshot go; older ones get their values back
+    if (global_env) hashmap_clear(global_env);
+    else global_env = hashmap_new_arena(64);
+    for (size_t i = 0; i < snap->count; i++) {
+        GlobalBinding* b = &snap->bindings[i];
+        b->pair->cell.cdr = b->val;
+        hashmap_put(global_env, b->sym, b->pair);
+    }
+
+    // Types registered since the snapshot
+    while (user_type_count > snap->user_type_count) {
+        UserTypeDef* td = &user_type_registry[--user_type_count];
+        for (int i = 0; i < td->field_count; i++) {
+            free(td->field_names[i]);
+            free(td->field_types[i]);
+        }
+        free(td->name);
+        td->name = NULL;
+        td->tag = NULL;
+        td->field_count = 0;
+    }
+
+    // Continuation tags start where they did, so output is reproducible
+    cont_tag_counter = snap->cont_tag_counter;
+
+    // Processes a request spawned but never ran, or left suspended
+    go_stacks_release();
+    global_scheduler.serial_head = global_scheduler.serial_count = 0;
+    sched_current = NULL;
+    global_scheduler.running = 0;
+    WorkDeque* d = &global_scheduler.workers[0].deque;
+    d->top = d->bottom;
+    go_pending = 0;
+}
+
+void global_snapshot_free(GlobalSnapshot* snap) {
+    if (!snap) return;
+    free(snap->bindings);
+    free(snap);
 }
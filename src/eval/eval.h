@@ -22,11 +22,16 @@ Value* mk_menv(Value* parent, Value* env);
 // Environment operations
 Value* env_lookup(Value* env, Value* sym);
 Value* env_extend(Value* env, Value* sym, Value* val);
+Value* env_to_list(Value* env);
+int frame_slot(Value* frame, Value* sym);
 
 // -- Evaluation --
 
 Value* eval(Value* expr, Value* menv);
 Value* eval_list(Value* list, Value* menv);
+Value* eval_lref(Value* ref, Value* menv);
+// Call a primitive or closure on evaluated args (NULL if proc is neither)
+Value* apply_proc(Value* proc, Value* args, Value* menv);
 
 // -- Default Handlers --
 
@@ -52,6 +57,19 @@ Value* prim_gt(Value* args, Value* menv);
 Value* prim_le(Value* args, Value* menv);
 Value* prim_ge(Value* args, Value* menv);
 
+// Binary fast paths (evaluated operands, no argument list)
+Value* prim_add2(Value* a, Value* b);
+Value* prim_sub2(Value* a, Value* b);
+Value* prim_mul2(Value* a, Value* b);
+Value* prim_div2(Value* a, Value* b);
+Value* prim_mod2(Value* a, Value* b);
+Value* prim_eq2(Value* a, Value* b);
+Value* prim_lt2(Value* a, Value* b);
+Value* prim_gt2(Value* a, Value* b);
+Value* prim_le2(Value* a, Value* b);
+Value* prim_ge2(Value* a, Value* b);
+Value* prim_cons2(Value* a, Value* b);
+
 // Logical
 Value* prim_not(Value* args, Value* menv);
 
@@ -91,6 +109,8 @@ extern Value* SYM_PROMPT;
 extern Value* SYM_CONTROL;
 extern Value* SYM_GO;
 extern Value* SYM_SELECT;
+extern Value* SYM_DEFTYPE;
+extern Value* SYM_UNINIT;       // letrec placeholder
 
 void init_syms(void);
 
@@ -98,8 +118,31 @@ void init_syms(void);
 
 void global_define(Value* sym, Value* val);
 Value* global_lookup(Value* sym);
+int global_set(Value* sym, Value* val);
 int env_set(Value* env, Value* sym, Value* val);
 
+// -- Form Lifetime --
+// Count of writes into bindings, boxes, channels, types or the MEnv: state
+// that may predate the running form. A form whose evaluation changes it
+// must keep its compiler arena scope (compiler_arena_pop(1)).
+unsigned long eval_mutation_count(void);
+
+// Drop caches keyed by AST and environment pointers (node graph, VM
+// chunks); call after releasing an arena scope they may point into
+void eval_drop_caches(void);
+
+// Held around reads and writes of the AST caches every thread shares
+// (compiled nodes, resolved bodies) while parallel processes run
+void eval_shared_enter(void);
+void eval_shared_leave(void);
+
+// Global bindings (and deftype registrations) at a point in time, so a
+// long-running compile server can return to its warm state per request
+typedef struct GlobalSnapshot GlobalSnapshot;
+GlobalSnapshot* global_env_snapshot(void);
+void global_env_restore(GlobalSnapshot* snap);
+void global_snapshot_free(GlobalSnapshot* snap);
+
 // -- New Primitives --
 
 // Box operations
@@ -119,6 +162,8 @@ Value* prim_make_chan(Value* args, Value* menv);
 Value* prim_chan_send(Value* args, Value* menv);
 Value* prim_chan_recv(Value* args, Value* menv);
 Value* prim_chan_close(Value* args, Value* menv);
+Value* prim_chan_send_many(Value* args, Value* menv);   // (chan-send-many! ch list): count sent
+Value* prim_chan_recv_many(Value* args, Value* menv);   // (chan-recv-many! ch n): up to n, in order
 Value* prim_is_chan(Value* args, Value* menv);
 Value* prim_is_process(Value* args, Value* menv);
 
@@ -133,15 +178,33 @@ Value* eval_prompt(Value* args, Value* menv);
 Value* eval_control(Value* args, Value* menv);
 Value* invoke_continuation(Value* cont, Value* val);
 
+// Escape and prompt frames for other executors (the bytecode VM)
+typedef Value* (*EscapeFn)(Value* k, void* data);
+typedef Value* (*PromptFn)(void* data);
+Value* call_with_escape(EscapeFn fn, void* data, Value* menv);
+Value* call_with_prompt(PromptFn fn, void* data);
+
 // -- CSP Operations (A4) --
 
 Value* eval_go(Value* args, Value* menv);
 Value* eval_select(Value* args, Value* menv);
 Value* scheduler_spawn(Value* thunk, Value* menv);
 void scheduler_run(Value* menv);
+// Processes that only compute run on worker threads, from per-worker
+// work-stealing deques. They start at the spawner's next write, print or
+// sync; sync runs them all to completion (no-op on a worker thread).
+void scheduler_sync(void);
+void scheduler_set_workers(int n);   // Clamped to 1..64; 1 runs every process serially
+int scheduler_workers(void);         // Default: PURPLE_GO_WORKERS, else online CPUs
 void scheduler_park(Value* proc);
 void scheduler_unpark(Value* proc, Value* val);
 
+// Whether form may be evaluated beside other such forms, on the go
+// workers: it writes nothing, does no I/O and stages no code
+int eval_parallel_safe(Value* form, Value* menv);
+// Evaluate n such forms concurrently; their values in order in results
+void eval_parallel(Value** forms, int n, Value* menv, Value** results);
+
 // -- User-Defined Types (A5) --
 
 Value* eval_deftype(Value* args, Value* menv);
@@ -149,6 +212,8 @@ Value* prim_make_type_instance(Value* args, Value* menv);
 Value* prim_type_get_field(Value* args, Value* menv);
 Value* prim_type_set_field(Value* args, Value* menv);
 Value* prim_type_is(Value* args, Value* menv);
+Value* prim_type_ref(Value* args, Value* menv);
+Value* prim_type_set(Value* args, Value* menv);
 void register_deftype_primitives(Value* env);
 
 #endif // PURPLE_EVAL_H
@@ -0,0 +1,227 @@
+#include "profile.h"
+#include "resolve.h"
+#include "../parser/parser.h"
+#include "../util/dstring.h"
+#include "../util/hashmap.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PROFILE_SAMPLES 16384   // Samples held between two collections
+
+typedef struct Sample {
+    Value* root;
+    Value* form;
+    int depth;              // Frames entered; only PROFILE_MAX_DEPTH kept
+    Value* frames[PROFILE_MAX_DEPTH];
+} Sample;
+
+int profile_active = 0;
+__thread ProfileStack profile_stack;
+
+// Taken by whoever writes or reads the samples. A signal that finds it
+// held drops its sample rather than wait on the thread it interrupted
+static int sampling = 0;
+static Sample* samples = NULL;
+static int nsamples = 0;
+static unsigned long dropped = 0;
+
+// Lambda body -> its name (malloc'd)
+static HashMap* names = NULL;
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Folded stacks so far, one per sample
+static char** lines = NULL;
+static size_t nlines = 0;
+static size_t lines_cap = 0;
+
+static void on_sigprof(int sig) {
+    (void)sig;
+    int saved = errno;
+    profile_sample();
+    errno = saved;
+}
+
+void profile_start(int hz) {
+    profile_stop();
+    samples = calloc(PROFILE_SAMPLES, sizeof(Sample));
+    names = hashmap_new();
+    if (!samples || !names) {
+        profile_stop();
+        return;
+    }
+    profile_active = 1;
+    if (hz <= 0) return;
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_sigprof;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGPROF, &sa, NULL);
+    long usec = hz < 1000000 ? 1000000 / hz : 1;
+    struct itimerval it = { { usec / 1000000, usec % 1000000 }, { usec / 1000000, usec % 1000000 } };
+    setitimer(ITIMER_PROF, &it, NULL);
+}
+
+int profile_hz(void) {
+    const char* env = getenv("PURPLE_PROFILE_HZ");
+    long hz = env && *env ? strtol(env, NULL, 10) : 0;
+    return hz > 0 && hz <= 1000000 ? (int)hz : 997;
+}
+
+static void free_name(void* key, void* value, void* ctx) {
+    (void)key; (void)ctx;
+    free(value);
+}
+
+void profile_stop(void) {
+    // A signal already pending finds the handler gone and is ignored
+    struct itimerval off;
+    memset(&off, 0, sizeof(off));
+    setitimer(ITIMER_PROF, &off, NULL);
+    signal(SIGPROF, SIG_IGN);
+    profile_active = 0;
+
+    while (__atomic_exchange_n(&sampling, 1, __ATOMIC_ACQUIRE)) sched_yield();
+    free(samples);
+    samples = NULL;
+    nsamples = 0;
+    dropped = 0;
+    __atomic_store_n(&sampling, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&names_lock);
+    if (names) {
+        hashmap_foreach(names, free_name, NULL);
+        hashmap_free(names);
+    }
+    names = NULL;
+    pthread_mutex_unlock(&names_lock);
+
+    for (size_t i = 0; i < nlines; i++) free(lines[i]);
+    free(lines);
+    lines = NULL;
+    nlines = lines_cap = 0;
+    memset(&profile_stack, 0, sizeof(profile_stack));
+}
+
+// Async-signal-safe: copies, no allocation, no locks waited on
+void profile_sample(void) {
+    if (!profile_active) return;
+    if (__atomic_exchange_n(&sampling, 1, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    if (!samples || nsamples == PROFILE_SAMPLES) {
+        __atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+    } else {
+        const ProfileStack* s = &profile_stack;
+        Sample* out = &samples[nsamples++];
+        int depth = s->top;
+        int kept = depth < PROFILE_MAX_DEPTH ? depth : PROFILE_MAX_DEPTH;
+        out->root = s->root;
+        out->form = s->form;
+        out->depth = depth;
+        for (int i = 0; i < kept; i++) out->frames[i] = s->frames[i];
+    }
+    __atomic_store_n(&sampling, 0, __ATOMIC_RELEASE);
+}
+
+void profile_set_root(Value* form) {
+    profile_stack.root = form;
+    profile_stack.form = NULL;
+}
+
+void profile_name(Value* body, const char* name) {
+    if (!body || !name) return;
+    pthread_mutex_lock(&names_lock);
+    if (names) {
+        char* copy = strdup(name);
+        if (copy) free(hashmap_remove(names, body));
+        if (copy) hashmap_put(names, body, copy);
+    }
+    pthread_mutex_unlock(&names_lock);
+}
+
+// "@line:col" of form in its source, if the parser recorded it
+static void append_pos(DString* ds, Value* form) {
+    SourcePos pos;
+    if (source_pos(resolve_source_form(form), &pos)) {
+        ds_printf(ds, "@%d:%d", pos.line, pos.col);
+    }
+}
+
+static void append_frame(DString* ds, Value* body) {
+    const char* name = names ? hashmap_get(names, body) : NULL;
+    if (name) {
+        ds_append(ds, name);
+        return;
+    }
+    ds_append(ds, "lambda");
+    append_pos(ds, body);
+}
+
+static char* fold_sample(const Sample* s) {
+    DString* ds = ds_new();
+    if (!ds) return NULL;
+    if (s->root) {
+        ds_append(ds, "toplevel");
+        append_pos(ds, s->root);
+    } else {
+        ds_append(ds, "go");
+    }
+    int kept = s->depth < PROFILE_MAX_DEPTH ? s->depth : PROFILE_MAX_DEPTH;
+    for (int i = 0; i < kept; i++) {
+        ds_append_char(ds, ';');
+        append_frame(ds, s->frames[i]);
+    }
+    if (s->depth > kept) ds_append(ds, ";...");
+    Value* head = s->form && val_tag(s->form) == T_CELL ? s->form->cell.car : NULL;
+    if (head && val_tag(head) == T_SYM) {
+        ds_append_char(ds, ';');
+        ds_append(ds, head->s);
+        append_pos(ds, s->form);
+    }
+    return ds_take(ds);
+}
+
+void profile_collect(void) {
+    while (__atomic_exchange_n(&sampling, 1, __ATOMIC_ACQUIRE)) sched_yield();
+    pthread_mutex_lock(&names_lock);
+    for (int i = 0; i < nsamples; i++) {
+        if (nlines == lines_cap) {
+            size_t cap = lines_cap ? lines_cap * 2 : 256;
+            char** grown = realloc(lines, cap * sizeof(char*));
+            if (!grown) break;
+            lines = grown;
+            lines_cap = cap;
+        }
+        char* line = fold_sample(&samples[i]);
+        if (line) lines[nlines++] = line;
+    }
+    nsamples = 0;
+    pthread_mutex_unlock(&names_lock);
+    __atomic_store_n(&sampling, 0, __ATOMIC_RELEASE);
+}
+
+static int compare_lines(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+int profile_write(FILE* out) {
+    profile_collect();
+    if (nlines) qsort(lines, nlines, sizeof(char*), compare_lines);
+    for (size_t i = 0; i < nlines;) {
+        size_t j = i + 1;
+        while (j < nlines && strcmp(lines[i], lines[j]) == 0) j++;
+        fprintf(out, "%s %zu\n", lines[i], j - i);
+        i = j;
+    }
+    unsigned long lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    if (lost) fprintf(stderr, "Profile: %lu samples dropped\n", lost);
+    return fflush(out) == 0 && !ferror(out);
+}
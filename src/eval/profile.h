@@ -0,0 +1,114 @@
+/*
+ * Sampling Profiler
+ *
+ * While profiling, each thread keeps a shadow stack of the Purple code it
+ * is running: the body of every lambda entered (the VM and the tree-walker
+ * both push them), the innermost special form in the tree-walker, and the
+ * top-level form. A SIGPROF timer copies the interrupted thread's stack
+ * into a preallocated buffer; after each top-level form the samples are
+ * named (define'd names, else source positions) and kept as folded stacks,
+ * one "frame;frame;... count" line each, as flamegraph.pl reads them.
+ *
+ * Off, every hook is one test of profile_active.
+ */
+
+#ifndef PURPLE_PROFILE_H
+#define PURPLE_PROFILE_H
+
+#include <stdio.h>
+#include "../types.h"
+
+#define PROFILE_MAX_DEPTH 64    // Frames kept per sample, outermost first
+
+typedef struct ProfileStack {
+    Value* frames[PROFILE_MAX_DEPTH];   // Lambda bodies entered
+    int top;                // Frames entered, may be past PROFILE_MAX_DEPTH
+    int base;               // top when the innermost evaluator loop began
+    Value* form;            // Innermost special form running, or NULL
+    Value* root;            // Top-level form, NULL on worker threads
+} ProfileStack;
+
+// What an evaluator loop restores on the way out, however it exits
+typedef struct ProfileMark {
+    int top;
+    int base;
+    Value* form;
+} ProfileMark;
+
+extern int profile_active;
+extern __thread ProfileStack profile_stack;
+
+// Sample hz times a second of CPU time; 0 takes samples only from
+// profile_sample(). Drops anything collected by an earlier run
+void profile_start(int hz);
+
+// PURPLE_PROFILE_HZ, else 997 (off the beat of anything periodic)
+int profile_hz(void);
+
+// Stop sampling and drop everything collected
+void profile_stop(void);
+
+// Take one sample of this thread now (what the timer signal does)
+void profile_sample(void);
+
+// The top-level form this thread is about to evaluate
+void profile_set_root(Value* form);
+
+// Name the lambda whose body is `body` (define, letrec)
+void profile_name(Value* body, const char* name);
+
+// Turn the samples taken so far into folded stacks. Call while the forms
+// they point at are alive, i.e. before a top-level form's arena is released
+void profile_collect(void);
+
+// Write the folded stacks, sorted; 0 on a write error
+int profile_write(FILE* out);
+
+// -- Evaluator Hooks --
+
+// Where a continuation lands: a jump there drops what was entered since
+static inline ProfileMark profile_where(void) {
+    ProfileMark m = { profile_stack.top, profile_stack.base, profile_stack.form };
+    return m;
+}
+
+// Entering an evaluator loop
+static inline ProfileMark profile_mark(void) {
+    ProfileMark m = profile_where();
+    profile_stack.base = profile_stack.top;
+    return m;
+}
+
+static inline void profile_release(ProfileMark m) {
+    profile_stack.top = m.top;
+    profile_stack.base = m.base;
+    profile_stack.form = m.form;
+}
+
+// A non-tail call
+static inline void profile_push(Value* body) {
+    ProfileStack* s = &profile_stack;
+    if (s->top < PROFILE_MAX_DEPTH) s->frames[s->top] = body;
+    s->form = NULL;
+    // The frame is in place before a signal can see it counted
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    s->top++;
+}
+
+// A call from a loop that may already have entered a lambda: a tail call
+// replaces that frame
+static inline void profile_call(Value* body) {
+    ProfileStack* s = &profile_stack;
+    if (s->top <= s->base) {
+        profile_push(body);
+        return;
+    }
+    if (s->top <= PROFILE_MAX_DEPTH) s->frames[s->top - 1] = body;
+    s->form = NULL;
+}
+
+static inline void profile_return(void) {
+    if (profile_stack.top > profile_stack.base) profile_stack.top--;
+}
+
+#endif // PURPLE_PROFILE_H
@@ -0,0 +1,240 @@
+/*
+ * Lexical Addressing Pre-pass
+ *
+ * Each binding construct the evaluator runs (lambda application, let,
+ * letrec) pushes exactly one T_FRAME, so a reference bound N binders out
+ * lives at frame depth N. The pass mirrors that scope structure statically.
+ */
+
+#include "resolve.h"
+#include "eval.h"
+#include "../util/hashmap.h"
+
+typedef struct Scope {
+    Value* names;           // Symbols in slot order
+    struct Scope* up;
+} Scope;
+
+// Lambda argument cell -> resolved body
+static HashMap* resolved_bodies = NULL;
+// Rebuilt let/letrec form -> original form
+static HashMap* source_forms = NULL;
+
+void resolve_reset(void) {
+    if (resolved_bodies) hashmap_free(resolved_bodies);
+    if (source_forms) hashmap_free(source_forms);
+    resolved_bodies = NULL;
+    source_forms = NULL;
+}
+
+int resolve_param_count(Value* params) {
+    int n = 0;
+    while (params && val_tag(params) == T_CELL) {
+        n++;
+        params = params->cell.cdr;
+    }
+    return n;
+}
+
+// Last matching slot wins, mirroring env_extend shadowing order.
+static int scope_slot(Value* names, Value* sym) {
+    int found = -1;
+    int i = 0;
+    while (names && val_tag(names) == T_CELL) {
+        if (names->cell.car == sym) found = i;
+        names = names->cell.cdr;
+        i++;
+    }
+    return found;
+}
+
+static Value* resolve_expr(Value* e, Scope* sc);
+
+static Value* resolve_list(Value* list, Scope* sc) {
+    if (!list || val_tag(list) != T_CELL) return list;
+    Value* head = resolve_expr(list->cell.car, sc);
+    Value* tail = resolve_list(list->cell.cdr, sc);
+    if (head == list->cell.car && tail == list->cell.cdr) return list;
+    return mk_cell(head, tail);
+}
+
+// Entries made inside a per-form arena scope leave with it
+static void forget_body(void* key) {
+    if (resolved_bodies) hashmap_remove(resolved_bodies, key);
+}
+
+static void forget_source(void* form) {
+    if (source_forms) hashmap_remove(source_forms, form);
+}
+
+static void remember_body(Value* key, Value* body) {
+    if (!resolved_bodies) resolved_bodies = hashmap_new();
+    hashmap_put(resolved_bodies, key, body);
+    if (compiler_arena_depth() > 1) compiler_arena_register_release(key, forget_body);
+}
+
+static void remember_source(Value* form, Value* original) {
+    if (form == original) return;
+    if (!source_forms) source_forms = hashmap_new();
+    hashmap_put(source_forms, form, original);
+    if (compiler_arena_depth() > 1) compiler_arena_register_release(form, forget_source);
+}
+
+// (lambda params body . rest) or (define (name . params) body . rest)
+static Value* resolve_closure_args(Value* args, Value* params, Scope* sc) {
+    Value* body_cell = cdr(args);
+    if (!body_cell || val_tag(body_cell) != T_CELL) return args;
+    Scope inner = { params, sc };
+    Value* body = resolve_expr(body_cell->cell.car, &inner);
+    Value* new_args = (body == body_cell->cell.car)
+        ? args
+        : mk_cell(args->cell.car, mk_cell(body, body_cell->cell.cdr));
+    remember_body(new_args, body);
+    remember_source(body, body_cell->cell.car);
+    return new_args;
+}
+
+static Value* resolve_let(Value* e, Scope* sc) {
+    Value* args = cdr(e);
+    Value* bindings = car(args);
+
+    // Collect well-formed binders, exactly as h_let_default does
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    for (Value* b = bindings; b && val_tag(b) == T_CELL; b = b->cell.cdr) {
+        Value* sym = car(car(b));
+        if (!sym || val_tag(sym) != T_SYM || !sym->s) continue;
+        Value* cell = mk_cell(sym, NIL);
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+    }
+
+    // Values see the outer scope
+    Value* new_bindings = NIL;
+    Value* bind_tail = NULL;
+    for (Value* b = bindings; b && val_tag(b) == T_CELL; b = b->cell.cdr) {
+        Value* bind = b->cell.car;
+        Value* val = car(cdr(bind));
+        Value* rval = val ? resolve_expr(val, sc) : val;
+        Value* nb = (rval == val) ? bind : mk_cell(car(bind), mk_cell(rval, cdr(cdr(bind))));
+        Value* cell = mk_cell(nb, NIL);
+        if (bind_tail) bind_tail->cell.cdr = cell;
+        else new_bindings = cell;
+        bind_tail = cell;
+    }
+
+    Scope inner = { names, sc };
+    Value* body = resolve_expr(car(cdr(args)), &inner);
+
+    Value* out = mk_cell(car(e), mk_cell(new_bindings, mk_cell(body, cdr(cdr(args)))));
+    remember_source(out, e);
+    return out;
+}
+
+static Value* resolve_letrec(Value* e, Scope* sc) {
+    Value* args = cdr(e);
+    Value* bindings = car(args);
+
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    for (Value* b = bindings; b && val_tag(b) == T_CELL; b = b->cell.cdr) {
+        Value* cell = mk_cell(car(b->cell.car), NIL);
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+    }
+
+    // Values and body both see the recursive frame
+    Scope inner = { names, sc };
+    Value* new_bindings = NIL;
+    Value* bind_tail = NULL;
+    for (Value* b = bindings; b && val_tag(b) == T_CELL; b = b->cell.cdr) {
+        Value* bind = b->cell.car;
+        Value* val = car(cdr(bind));
+        Value* rval = val ? resolve_expr(val, &inner) : val;
+        Value* nb = (rval == val) ? bind : mk_cell(car(bind), mk_cell(rval, cdr(cdr(bind))));
+        Value* cell = mk_cell(nb, NIL);
+        if (bind_tail) bind_tail->cell.cdr = cell;
+        else new_bindings = cell;
+        bind_tail = cell;
+    }
+
+    Value* body = resolve_expr(car(cdr(args)), &inner);
+
+    Value* out = mk_cell(car(e), mk_cell(new_bindings, mk_cell(body, cdr(cdr(args)))));
+    remember_source(out, e);
+    return out;
+}
+
+static Value* resolve_expr(Value* e, Scope* sc) {
+    if (!e) return e;
+
+    if (val_tag(e) == T_SYM) {
+        int depth = 0;
+        for (Scope* s = sc; s; s = s->up, depth++) {
+            int slot = scope_slot(s->names, e);
+            if (slot >= 0) return mk_lref(e, depth, slot);
+        }
+        return e;  // Free: looked up by name
+    }
+
+    if (val_tag(e) != T_CELL) return e;
+
+    Value* op = e->cell.car;
+    Value* args = e->cell.cdr;
+
+    if (op && val_tag(op) == T_SYM && op->sym_form) {
+        // Opaque forms: unmodelled binders or reflective access
+        if (op == SYM_QUOTE || op == SYM_EM || op == SYM_CONTROL ||
+            op == SYM_SELECT || op == SYM_DEFTYPE ||
+            op == SYM_SET_META || op == SYM_GET_META) {
+            return e;
+        }
+        if (op == SYM_LAMBDA) {
+            if (!args || val_tag(args) != T_CELL) return e;
+            Value* new_args = resolve_closure_args(args, car(args), sc);
+            return new_args == args ? e : mk_cell(op, new_args);
+        }
+        if (op == SYM_DEFINE) {
+            Value* first = car(args);
+            if (first && val_tag(first) == T_CELL) {
+                Value* new_args = resolve_closure_args(args, cdr(first), sc);
+                return new_args == args ? e : mk_cell(op, new_args);
+            }
+            Value* rest = resolve_list(cdr(args), sc);
+            return rest == cdr(args) ? e : mk_cell(op, mk_cell(first, rest));
+        }
+        if (op == SYM_SET_BANG) {
+            Value* rest = resolve_list(cdr(args), sc);
+            return rest == cdr(args) ? e : mk_cell(op, mk_cell(car(args), rest));
+        }
+        if (op == SYM_LET) return resolve_let(e, sc);
+        if (op == SYM_LETREC) return resolve_letrec(e, sc);
+
+        // if, do, and, or, lift, scan, call/cc, prompt, go: all subforms
+        Value* rest = resolve_list(args, sc);
+        return rest == args ? e : mk_cell(op, rest);
+    }
+
+    return resolve_list(e, sc);
+}
+
+Value* resolve_lambda_body(Value* key, Value* params, Value* body) {
+    if (resolved_bodies) {
+        Value* cached = hashmap_get(resolved_bodies, key);
+        if (cached) return cached;
+    }
+    Scope top = { params, NULL };
+    Value* resolved = resolve_expr(body, &top);
+    if (!resolved) return body;
+    remember_body(key, resolved);
+    remember_source(resolved, body);
+    return resolved;
+}
+
+Value* resolve_source_form(Value* form) {
+    if (!source_forms) return form;
+    Value* original = hashmap_get(source_forms, form);
+    return original ? original : form;
+}
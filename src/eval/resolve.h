@@ -0,0 +1,33 @@
+/*
+ * Lexical Addressing Pre-pass
+ *
+ * Rewrites closure bodies so that references to lambda parameters and
+ * let/letrec bindings become T_LREF (depth, slot) coordinates into the
+ * flat T_FRAME activation records built by the evaluator. Free variables
+ * stay symbols and are looked up by name at run time.
+ *
+ * Forms whose binding structure the pass does not model (quote, EM,
+ * control, select, deftype, set-meta!, get-meta) are left untouched.
+ */
+
+#ifndef PURPLE_RESOLVE_H
+#define PURPLE_RESOLVE_H
+
+#include "../types.h"
+
+// Resolve the body of (lambda params body). `key` is the lambda's
+// argument cell and identifies the source form for caching.
+Value* resolve_lambda_body(Value* key, Value* params, Value* body);
+
+// Original source of a let/letrec form or closure body rebuilt by the
+// resolver, or the form itself. Code-generation analyses run on the
+// original symbols; the profiler finds source positions through it.
+Value* resolve_source_form(Value* form);
+
+// Number of binder slots described by a parameter list
+int resolve_param_count(Value* params);
+
+// Drop cached resolutions (call when the compiler arena is reset)
+void resolve_reset(void);
+
+#endif // PURPLE_RESOLVE_H
@@ -0,0 +1,374 @@
+#include "vector.h"
+#include "eval.h"
+#include "../codegen/codegen.h"
+#include "../codegen/fold.h"
+#include <limits.h>
+#include <stdarg.h>
+#include <string.h>
+
+// Loops staged inside the function of an outer one number their names one
+// deeper, so an inner element never hides the outer element it may read
+static __thread int stage_depth = 0;
+
+// -- Helpers --
+
+static Value* arg_at(Value* args, int i) {
+    while (i-- > 0) args = cdr(args);
+    return car(args);
+}
+
+static Value* errorf(const char* fmt, const char* prim) {
+    char msg[128];
+    snprintf(msg, sizeof(msg), fmt, prim);
+    return mk_error(msg);
+}
+
+// Wrapping arithmetic: what the vector loops do in every lane
+static long wrap_add(long a, long b) {
+    return (long)((unsigned long)a + (unsigned long)b);
+}
+
+static long wrap_mul(long a, long b) {
+    return (long)((unsigned long)a * (unsigned long)b);
+}
+
+static int list_length(Value* l, long* out) {
+    long n = 0;
+    for (; l && val_tag(l) == T_CELL; l = l->cell.cdr) {
+        if (val_tag(l->cell.car) != T_INT) return 0;
+        n++;
+    }
+    if (!is_nil(l)) return 0;
+    *out = n;
+    return 1;
+}
+
+static int any_code(Value* args) {
+    for (; args && val_tag(args) == T_CELL; args = args->cell.cdr) {
+        if (is_code(args->cell.car)) return 1;
+    }
+    return 0;
+}
+
+// -- Staging --
+
+// Code whose value is a fresh vector nobody else holds: as an operand it
+// is a temporary, freed once read
+static int fresh_vector_code(Value* code) {
+    static const char* const fresh[] = {
+        "vec_of(", "vec_make(", "vec_from_list(", "vec_add(",
+        "({ /* vector-map */", "({ /* vector-filter */", "({ /* vector-add */", NULL
+    };
+    if (!code || val_tag(code) != T_CODE) return 0;
+    for (int i = 0; fresh[i]; i++) {
+        if (code_starts_with(code, fresh[i])) return 1;
+    }
+    return 0;
+}
+
+// v as a C long: unboxed when it has int structure, else read through
+// obj_long. NULL for a value that is no int
+static Value* long_code(Value* v) {
+    Value* lng = code_unboxed(v);
+    if (lng || !is_code(v)) return lng;
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "obj_long(");
+    cb_code(&cb, v);
+    cb_text(&cb, ")");
+    return cb_finish(&cb);
+}
+
+// fn(ops...): operand i is passed as a long when bit i of longs is set,
+// else as an Obj*; fresh vector operands are bound first and freed after
+static Value* stage_call(const char* prim, const char* fn, Value** ops, int n, unsigned longs) {
+    Value* code[4];
+    int temps = 0;
+    for (int i = 0; i < n; i++) {
+        code[i] = (longs & (1u << i)) ? long_code(ops[i]) : code_of(ops[i]);
+        if (!code[i]) return errorf("%s: operand cannot be compiled", prim);
+        if (!(longs & (1u << i)) && fresh_vector_code(code[i])) temps = 1;
+    }
+
+    CodeBuilder cb;
+    cb_init(&cb);
+    if (temps) {
+        cb_textf(&cb, "({ /* %s */", prim);
+        for (int i = 0; i < n; i++) {
+            if ((longs & (1u << i)) || !fresh_vector_code(code[i])) continue;
+            cb_textf(&cb, " Obj* _t%d = ", i);
+            cb_code(&cb, code[i]);
+            cb_text(&cb, ";");
+        }
+        cb_text(&cb, " Obj* _r = ");
+    }
+    cb_textf(&cb, "%s(", fn);
+    for (int i = 0; i < n; i++) {
+        if (i) cb_text(&cb, ", ");
+        if (temps && !(longs & (1u << i)) && fresh_vector_code(code[i])) cb_textf(&cb, "_t%d", i);
+        else cb_code(&cb, code[i]);
+    }
+    cb_text(&cb, ")");
+    if (temps) {
+        cb_text(&cb, ";");
+        for (int i = 0; i < n; i++) {
+            if (!(longs & (1u << i)) && fresh_vector_code(code[i])) cb_textf(&cb, " free_tree(_t%d);", i);
+        }
+        cb_text(&cb, " _r; })");
+    }
+    return cb_finish(&cb);
+}
+
+typedef enum { LOOP_MAP, LOOP_FOLD, LOOP_FILTER } LoopKind;
+
+// The bulk loop over lifted v (init: fold's accumulator). f is applied
+// now to the names of one iteration's element (and accumulator), plain C
+// longs; what its result unboxes to is the loop body
+static Value* stage_loop(LoopKind kind, const char* prim, Value* f, Value* init, Value* v, Value* menv) {
+    Value* vcode = code_of(v);
+    Value* init_code = kind == LOOP_FOLD ? long_code(init) : NULL;
+    if (!vcode || (kind == LOOP_FOLD && !init_code)) return errorf("%s: operand cannot be compiled", prim);
+
+    int d = ++stage_depth;
+    char x[32], a[32];
+    snprintf(x, sizeof(x), "_x%d", d);
+    snprintf(a, sizeof(a), "_a%d", d);
+    Value* args = kind == LOOP_FOLD ? LIST2(lift_long(mk_code(a)), lift_long(mk_code(x)))
+                                    : LIST1(lift_long(mk_code(x)));
+    Value* out = apply_proc(f, args, menv);
+    stage_depth--;
+    Value* body = out ? long_code(out) : NULL;
+    if (!body) return errorf("%s: staged function must compute an integer", prim);
+
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_textf(&cb, "({ /* %s */ Obj* _v%d = ", prim, d);
+    cb_code(&cb, vcode);
+    cb_textf(&cb, "; long _n%d = vec_len(_v%d);", d, d);
+    if (kind == LOOP_FOLD) {
+        cb_textf(&cb, " long _a%d = ", d);
+        cb_code(&cb, init_code);
+        cb_textf(&cb, "; if (_n%d) {", d);
+    } else {
+        cb_textf(&cb, " Obj* _r%d = mk_vec(_n%d); if (_r%d && _n%d) {", d, d, d, d);
+        cb_textf(&cb, " long* __restrict _d%d = _r%d->elems;", d, d);
+    }
+    cb_textf(&cb, " const long* __restrict _s%d = _v%d->elems;", d, d);
+    if (kind == LOOP_FILTER) cb_textf(&cb, " long _m%d = 0;", d);
+    cb_textf(&cb, " for (long _k%d = 0; _k%d < _n%d; _k%d++) { long _x%d = _s%d[_k%d];", d, d, d, d, d, d, d);
+    switch (kind) {
+        case LOOP_MAP:
+            cb_textf(&cb, " _d%d[_k%d] = ", d, d);
+            cb_code(&cb, body);
+            cb_text(&cb, ";");
+            break;
+        case LOOP_FOLD:
+            cb_textf(&cb, " _a%d = ", d);
+            cb_code(&cb, body);
+            cb_text(&cb, ";");
+            break;
+        case LOOP_FILTER:
+            cb_text(&cb, " if (");
+            cb_code(&cb, body);
+            cb_textf(&cb, ") _d%d[_m%d++] = _x%d;", d, d, d);
+            break;
+    }
+    cb_text(&cb, " }");
+    if (kind == LOOP_FILTER) cb_textf(&cb, " _r%d->len = _m%d;", d, d);
+    cb_text(&cb, " }");
+    if (fresh_vector_code(vcode)) cb_textf(&cb, " free_tree(_v%d);", d);
+    // A fold is a long expression: boxed only where a value is needed
+    if (kind == LOOP_FOLD) {
+        cb_textf(&cb, " _a%d; })", d);
+        return lift_long(cb_finish(&cb));
+    }
+    cb_textf(&cb, " _r%d; })", d);
+    return cb_finish(&cb);
+}
+
+// -- Constructors --
+
+Value* prim_vector(Value* args, Value* menv) {
+    (void)menv;
+    long n = 0;
+    for (Value* a = args; a && val_tag(a) == T_CELL; a = a->cell.cdr) n++;
+
+    if (any_code(args)) {
+        if (n == 0) return mk_code("vec_of(0, NULL)");
+        CodeBuilder cb;
+        cb_init(&cb);
+        cb_textf(&cb, "vec_of(%ld, (long[]){", n);
+        long i = 0;
+        for (Value* a = args; a && val_tag(a) == T_CELL; a = a->cell.cdr, i++) {
+            Value* lng = long_code(a->cell.car);
+            if (!lng) return mk_error("vector: elements must be integers");
+            if (i) cb_text(&cb, ", ");
+            cb_code(&cb, lng);
+        }
+        cb_text(&cb, "})");
+        return cb_finish(&cb);
+    }
+
+    Value* v = mk_vector(n);
+    if (!v) return mk_error("vector: out of memory");
+    long i = 0;
+    for (Value* a = args; a && val_tag(a) == T_CELL; a = a->cell.cdr, i++) {
+        if (val_tag(a->cell.car) != T_INT) return mk_error("vector: elements must be integers");
+        v->vec.elems[i] = val_int(a->cell.car);
+    }
+    return v;
+}
+
+Value* prim_make_vector(Value* args, Value* menv) {
+    (void)menv;
+    Value* n = car(args);
+    Value* fill = cdr(args) && !is_nil(cdr(args)) ? arg_at(args, 1) : mk_int(0);
+    if (is_code(n) || is_code(fill)) {
+        Value* ops[2] = { n, fill };
+        return stage_call("make-vector", "vec_make", ops, 2, 3);
+    }
+    if (!n || val_tag(n) != T_INT || val_int(n) < 0) return mk_error("make-vector: length must be a non-negative integer");
+    if (!fill || val_tag(fill) != T_INT) return mk_error("make-vector: fill must be an integer");
+    Value* v = mk_vector(val_int(n));
+    if (!v) return mk_error("make-vector: out of memory");
+    for (long i = 0; i < v->vec.len; i++) v->vec.elems[i] = val_int(fill);
+    return v;
+}
+
+Value* prim_list_to_vector(Value* args, Value* menv) {
+    (void)menv;
+    Value* l = car(args);
+    if (is_code(l)) return stage_call("list->vector", "vec_from_list", &l, 1, 0);
+    long n;
+    if (!list_length(l, &n)) return mk_error("list->vector: expected a list of integers");
+    Value* v = mk_vector(n);
+    if (!v) return mk_error("list->vector: out of memory");
+    for (long i = 0; i < n; i++, l = l->cell.cdr) v->vec.elems[i] = val_int(l->cell.car);
+    return v;
+}
+
+// -- Accessors --
+
+Value* prim_is_vector(Value* args, Value* menv) {
+    (void)menv;
+    Value* a = car(args);
+    if (is_code(a)) return stage_call("vector?", "vec_p", &a, 1, 0);
+    return is_vector(a) ? SYM_T : NIL;
+}
+
+Value* prim_vector_length(Value* args, Value* menv) {
+    (void)menv;
+    Value* v = car(args);
+    if (is_code(v)) return stage_call("vector-length", "vec_length", &v, 1, 0);
+    if (!is_vector(v)) return mk_error("vector-length: expected a vector");
+    return mk_int(v->vec.len);
+}
+
+Value* prim_vector_ref(Value* args, Value* menv) {
+    (void)menv;
+    Value* v = car(args);
+    Value* k = arg_at(args, 1);
+    if (is_code(v) || is_code(k)) {
+        Value* ops[2] = { v, k };
+        return stage_call("vector-ref", "vec_ref", ops, 2, 2);
+    }
+    if (!is_vector(v)) return mk_error("vector-ref: expected a vector");
+    if (!k || val_tag(k) != T_INT || val_int(k) < 0 || val_int(k) >= v->vec.len) {
+        return mk_error("vector-ref: index out of range");
+    }
+    return mk_int(v->vec.elems[val_int(k)]);
+}
+
+Value* prim_vector_to_list(Value* args, Value* menv) {
+    (void)menv;
+    Value* v = car(args);
+    if (is_code(v)) return stage_call("vector->list", "vec_to_list", &v, 1, 0);
+    if (!is_vector(v)) return mk_error("vector->list: expected a vector");
+    Value* l = NIL;
+    for (long i = v->vec.len - 1; i >= 0; i--) l = mk_cell(mk_int(v->vec.elems[i]), l);
+    return l;
+}
+
+// -- Bulk Operations --
+
+Value* prim_vector_add(Value* args, Value* menv) {
+    (void)menv;
+    Value* a = car(args);
+    Value* b = arg_at(args, 1);
+    if (is_code(a) || is_code(b)) {
+        Value* ops[2] = { a, b };
+        return stage_call("vector-add", "vec_add", ops, 2, 0);
+    }
+    if (!is_vector(a) || !is_vector(b)) return mk_error("vector-add: expected two vectors");
+    if (a->vec.len != b->vec.len) return mk_error("vector-add: vectors differ in length");
+    Value* r = mk_vector(a->vec.len);
+    if (!r) return mk_error("vector-add: out of memory");
+    for (long i = 0; i < a->vec.len; i++) r->vec.elems[i] = wrap_add(a->vec.elems[i], b->vec.elems[i]);
+    return r;
+}
+
+Value* prim_vector_dot(Value* args, Value* menv) {
+    (void)menv;
+    Value* a = car(args);
+    Value* b = arg_at(args, 1);
+    if (is_code(a) || is_code(b)) {
+        Value* ops[2] = { a, b };
+        return stage_call("vector-dot", "vec_dot", ops, 2, 0);
+    }
+    if (!is_vector(a) || !is_vector(b)) return mk_error("vector-dot: expected two vectors");
+    if (a->vec.len != b->vec.len) return mk_error("vector-dot: vectors differ in length");
+    long sum = 0;
+    for (long i = 0; i < a->vec.len; i++) sum = wrap_add(sum, wrap_mul(a->vec.elems[i], b->vec.elems[i]));
+    return mk_int(sum);
+}
+
+// An interpreted loop whose function returns code goes on staged: the
+// vector is lifted as a constant and the loop compiled around f
+Value* prim_vector_map(Value* args, Value* menv) {
+    Value* f = car(args);
+    Value* v = arg_at(args, 1);
+    if (is_code(v)) return stage_loop(LOOP_MAP, "vector-map", f, NULL, v, menv);
+    if (!is_vector(v)) return mk_error("vector-map: expected a function and a vector");
+    Value* r = mk_vector(v->vec.len);
+    if (!r) return mk_error("vector-map: out of memory");
+    for (long i = 0; i < v->vec.len; i++) {
+        Value* x = apply_proc(f, LIST1(mk_int(v->vec.elems[i])), menv);
+        if (is_code(x)) return stage_loop(LOOP_MAP, "vector-map", f, NULL, v, menv);
+        if (!x || val_tag(x) != T_INT) return is_error(x) ? x : mk_error("vector-map: function must return an integer");
+        r->vec.elems[i] = val_int(x);
+    }
+    return r;
+}
+
+Value* prim_vector_fold(Value* args, Value* menv) {
+    Value* f = car(args);
+    Value* init = arg_at(args, 1);
+    Value* v = arg_at(args, 2);
+    if (is_code(v) || is_code(init)) return stage_loop(LOOP_FOLD, "vector-fold", f, init, v, menv);
+    if (!is_vector(v)) return mk_error("vector-fold: expected a function, an initial value and a vector");
+    Value* acc = init;
+    for (long i = 0; i < v->vec.len; i++) {
+        acc = apply_proc(f, LIST2(acc, mk_int(v->vec.elems[i])), menv);
+        if (is_code(acc)) return stage_loop(LOOP_FOLD, "vector-fold", f, init, v, menv);
+        if (is_error(acc)) return acc;
+    }
+    return acc;
+}
+
+Value* prim_vector_filter(Value* args, Value* menv) {
+    Value* f = car(args);
+    Value* v = arg_at(args, 1);
+    if (is_code(v)) return stage_loop(LOOP_FILTER, "vector-filter", f, NULL, v, menv);
+    if (!is_vector(v)) return mk_error("vector-filter: expected a function and a vector");
+    Value* r = mk_vector(v->vec.len);
+    if (!r) return mk_error("vector-filter: out of memory");
+    long kept = 0;
+    for (long i = 0; i < v->vec.len; i++) {
+        Value* keep = apply_proc(f, LIST1(mk_int(v->vec.elems[i])), menv);
+        if (is_code(keep)) return stage_loop(LOOP_FILTER, "vector-filter", f, NULL, v, menv);
+        if (is_error(keep)) return keep;
+        if (!is_nil(keep)) r->vec.elems[kept++] = v->vec.elems[i];
+    }
+    r->vec.len = kept;
+    return r;
+}
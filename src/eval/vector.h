@@ -0,0 +1,39 @@
+/*
+ * Vectors
+ *
+ * A T_VECTOR holds its elements as unboxed longs in one block, so the
+ * bulk primitives run as straight loops over it. Vectors are immutable
+ * once built: every bulk operation returns a fresh vector that shares
+ * nothing with its operands, which the shape analysis reads as a TREE
+ * with a single owner (freed by free_tree when its let ends).
+ *
+ * Staged (any operand lifted), the constructors and vector-add/-dot call
+ * the generated vector runtime. vector-map, -fold and -filter apply their
+ * function at staging time to the element (and accumulator) of one
+ * iteration, and inline what it unboxes to into a loop over the elements:
+ * (vector-map (lambda (x) (* x x)) v) compiles to one C loop with no call
+ * and no allocation per element. Staged, their functions compute ints.
+ *
+ * vector-add and vector-dot wrap on overflow (two's complement), the
+ * other arithmetic gives 0 as + and * do elsewhere.
+ */
+
+#ifndef PURPLE_VECTOR_H
+#define PURPLE_VECTOR_H
+
+#include "../types.h"
+
+Value* prim_vector(Value* args, Value* menv);            // (vector 1 2 3)
+Value* prim_make_vector(Value* args, Value* menv);       // (make-vector n [fill])
+Value* prim_is_vector(Value* args, Value* menv);
+Value* prim_vector_length(Value* args, Value* menv);
+Value* prim_vector_ref(Value* args, Value* menv);        // (vector-ref v k)
+Value* prim_list_to_vector(Value* args, Value* menv);
+Value* prim_vector_to_list(Value* args, Value* menv);
+Value* prim_vector_map(Value* args, Value* menv);        // (vector-map f v)
+Value* prim_vector_fold(Value* args, Value* menv);       // (vector-fold f init v): (f acc x)
+Value* prim_vector_filter(Value* args, Value* menv);     // (vector-filter pred v)
+Value* prim_vector_add(Value* args, Value* menv);        // Elementwise, equal lengths
+Value* prim_vector_dot(Value* args, Value* menv);        // Sum of products, equal lengths
+
+#endif // PURPLE_VECTOR_H
@@ -0,0 +1,995 @@
+/*
+ * Bytecode VM
+ *
+ * A chunk is a flat array of 16-bit units, each opcode followed by its
+ * operands, plus a constant table (literals, symbols, LREF nodes, lambda
+ * parts) and nested chunks (prompt bodies). The VM keeps one value stack
+ * and one array of call frames for the whole process; nested runs (call/cc
+ * and prompt bodies) share them and restore the heights on the way out,
+ * including when a continuation longjmps past them.
+ *
+ * Every chunk compiles: forms the VM does not model, and malformed ones,
+ * become OP_EVAL so the tree-walker produces the same result or error.
+ */
+
+#include "vm.h"
+#include "eval.h"
+#include "resolve.h"
+#include "profile.h"
+#include "../analysis/oneshot.h"
+#include "../util/dstring.h"
+#include "../util/hashmap.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef enum {
+    OP_CONST,       // k        push consts[k]
+    OP_NIL,         //          push NIL
+    OP_LREF,        // k        push the lexical address consts[k]
+    OP_NAME,        // k        push the value of symbol consts[k]
+    OP_SET_NAME,    // k        set! consts[k] to the top value
+    OP_DEFINE,      // k        define consts[k] to the popped value, push it
+    OP_CLOSURE,     // kp kb    push (lambda consts[kp] consts[kb])
+    OP_POP,
+    OP_JUMP,        // t
+    OP_JUMP_NIL,    // t        pop, jump if nil
+    OP_AND_JUMP,    // t        nil on top: make it NIL and jump, else pop
+    OP_OR_JUMP,     // t        non-nil on top: jump, else pop
+    OP_CALL,        // n        call the value under n arguments
+    OP_TAIL_CALL,   // n        same, replacing the current frame
+    OP_RETURN,
+    OP_LET,         // k n      pop n values into a frame named consts[k]
+    OP_LETREC,      // k n      enter a frame of n letrec placeholders
+    OP_SET_SLOT,    // i        pop into slot i of the innermost frame
+    OP_POP_ENV,     //          leave the innermost frame
+    OP_CALL_CC,     //          apply the popped value to an escape continuation
+    OP_PROMPT,      // s        run subs[s] under a prompt
+    OP_EVAL,        // k        tree-walk consts[k] in the current env
+    OP_COUNT
+} OpCode;
+
+static const struct {
+    const char* name;
+    int operands;
+} op_info[OP_COUNT] = {
+    [OP_CONST]     = { "CONST", 1 },
+    [OP_NIL]       = { "NIL", 0 },
+    [OP_LREF]      = { "LREF", 1 },
+    [OP_NAME]      = { "NAME", 1 },
+    [OP_SET_NAME]  = { "SET_NAME", 1 },
+    [OP_DEFINE]    = { "DEFINE", 1 },
+    [OP_CLOSURE]   = { "CLOSURE", 2 },
+    [OP_POP]       = { "POP", 0 },
+    [OP_JUMP]      = { "JUMP", 1 },
+    [OP_JUMP_NIL]  = { "JUMP_NIL", 1 },
+    [OP_AND_JUMP]  = { "AND_JUMP", 1 },
+    [OP_OR_JUMP]   = { "OR_JUMP", 1 },
+    [OP_CALL]      = { "CALL", 1 },
+    [OP_TAIL_CALL] = { "TAIL_CALL", 1 },
+    [OP_RETURN]    = { "RETURN", 0 },
+    [OP_LET]       = { "LET", 2 },
+    [OP_LETREC]    = { "LETREC", 2 },
+    [OP_SET_SLOT]  = { "SET_SLOT", 1 },
+    [OP_POP_ENV]   = { "POP_ENV", 0 },
+    [OP_CALL_CC]   = { "CALL_CC", 0 },
+    [OP_PROMPT]    = { "PROMPT", 1 },
+    [OP_EVAL]      = { "EVAL", 1 },
+};
+
+typedef struct Chunk {
+    uint16_t* code;
+    int len;
+    int cap;
+    Value** consts;
+    int nconsts;
+    int consts_cap;
+    struct Chunk** subs;
+    int nsubs;
+    int subs_cap;
+    int overflow;           // An operand did not fit, or allocation failed
+} Chunk;
+
+typedef struct CallFrame {
+    Chunk* chunk;
+    int ip;
+    Value* env;
+    int base;               // Stack height on entry
+} CallFrame;
+
+// Deep non-tail recursion is bounded by memory rather than the C stack;
+// this cap turns runaway recursion into an error instead.
+#define VM_MAX_FRAMES (1 << 20)
+
+// One machine per thread: go workers run parallel processes in their own
+static __thread struct {
+    Value** stack;
+    int sp;
+    int cap;
+    CallFrame* frames;
+    int fp;
+    int fcap;
+    Value* menv;            // Scratch MEnv handed to primitives and lookups
+    Value* parent;          // Meta-level of the running program
+    Value* root;            // Environment the program started in
+    HashMap* root_pairs;    // Symbol -> its (sym . val) cell in root, or NIL
+    HashMap* chunks;        // Lambda body (or top-level form) -> Chunk
+} vm;
+
+// -- Chunks --
+
+static Chunk* chunk_new(void) {
+    Chunk* c = calloc(1, sizeof(Chunk));
+    return c;
+}
+
+static void chunk_free(Chunk* c) {
+    if (!c) return;
+    for (int i = 0; i < c->nsubs; i++) chunk_free(c->subs[i]);
+    free(c->subs);
+    free(c->consts);
+    free(c->code);
+    free(c);
+}
+
+static void chunk_clear(Chunk* c) {
+    for (int i = 0; i < c->nsubs; i++) chunk_free(c->subs[i]);
+    c->nsubs = 0;
+    c->nconsts = 0;
+    c->len = 0;
+    c->overflow = 0;
+}
+
+static void emit(Chunk* c, int unit) {
+    if (unit < 0 || unit > UINT16_MAX) {
+        c->overflow = 1;
+        unit = 0;
+    }
+    if (c->len == c->cap) {
+        int cap = c->cap ? c->cap * 2 : 32;
+        uint16_t* code = realloc(c->code, cap * sizeof(uint16_t));
+        if (!code) {
+            c->overflow = 1;
+            return;
+        }
+        c->code = code;
+        c->cap = cap;
+    }
+    c->code[c->len++] = (uint16_t)unit;
+}
+
+static int add_const(Chunk* c, Value* v) {
+    if (c->nconsts == c->consts_cap) {
+        int cap = c->consts_cap ? c->consts_cap * 2 : 8;
+        Value** consts = realloc(c->consts, cap * sizeof(Value*));
+        if (!consts) {
+            c->overflow = 1;
+            return 0;
+        }
+        c->consts = consts;
+        c->consts_cap = cap;
+    }
+    c->consts[c->nconsts] = v;
+    return c->nconsts++;
+}
+
+static int add_sub(Chunk* c, Chunk* sub) {
+    if (c->nsubs == c->subs_cap) {
+        int cap = c->subs_cap ? c->subs_cap * 2 : 4;
+        Chunk** subs = realloc(c->subs, cap * sizeof(Chunk*));
+        if (!subs) {
+            chunk_free(sub);
+            c->overflow = 1;
+            return 0;
+        }
+        c->subs = subs;
+        c->subs_cap = cap;
+    }
+    c->subs[c->nsubs] = sub;
+    return c->nsubs++;
+}
+
+static void emit_op(Chunk* c, OpCode op, Value* v) {
+    emit(c, op);
+    emit(c, add_const(c, v));
+}
+
+// Emit a jump and return the operand position to patch
+static int emit_jump(Chunk* c, OpCode op) {
+    emit(c, op);
+    emit(c, 0);
+    return c->len - 1;
+}
+
+static void patch_jump(Chunk* c, int at) {
+    if (c->len > UINT16_MAX) {
+        c->overflow = 1;
+        return;
+    }
+    if (at >= 0 && at < c->len) c->code[at] = (uint16_t)c->len;
+}
+
+// -- Compiler --
+
+static void compile(Chunk* c, Value* e, int tail);
+static Chunk* compile_chunk(Value* e);
+
+static int is_proper_list(Value* v) {
+    while (v && val_tag(v) == T_CELL) v = v->cell.cdr;
+    return is_nil(v);
+}
+
+static void compile_fallback(Chunk* c, Value* e, int tail) {
+    emit_op(c, OP_EVAL, e);
+    if (tail) emit(c, OP_RETURN);
+}
+
+static void compile_if(Chunk* c, Value* args, int tail) {
+    compile(c, car(args), 0);
+    int to_else = emit_jump(c, OP_JUMP_NIL);
+    compile(c, car(cdr(args)), tail);
+    int to_end = tail ? -1 : emit_jump(c, OP_JUMP);
+    patch_jump(c, to_else);
+    compile(c, car(cdr(cdr(args))), tail);
+    if (!tail) patch_jump(c, to_end);
+}
+
+static void compile_do(Chunk* c, Value* args, int tail) {
+    Value* rest = args;
+    while (!is_nil(rest) && !is_nil(cdr(rest))) {
+        compile(c, car(rest), 0);
+        emit(c, OP_POP);
+        rest = cdr(rest);
+    }
+    compile(c, car(rest), tail);
+}
+
+// and / or: every operand but the last may short-circuit to the end
+static void compile_logic(Chunk* c, Value* args, OpCode jump, Value* empty, int tail) {
+    if (is_nil(args)) {
+        if (empty) emit_op(c, OP_CONST, empty);
+        else emit(c, OP_NIL);
+        if (tail) emit(c, OP_RETURN);
+        return;
+    }
+    int* patches = NULL;
+    int npatches = 0;
+    Value* rest = args;
+    while (!is_nil(cdr(rest))) {
+        compile(c, car(rest), 0);
+        int* grown = realloc(patches, (npatches + 1) * sizeof(int));
+        if (!grown) {
+            free(patches);
+            c->overflow = 1;
+            return;
+        }
+        patches = grown;
+        patches[npatches++] = emit_jump(c, jump);
+        rest = cdr(rest);
+    }
+    compile(c, car(rest), tail);
+    for (int i = 0; i < npatches; i++) patch_jump(c, patches[i]);
+    if (tail && npatches) emit(c, OP_RETURN);
+    free(patches);
+}
+
+static void compile_closure(Chunk* c, Value* args, Value* params) {
+    Value* body = resolve_lambda_body(args, params, car(cdr(args)));
+    emit(c, OP_CLOSURE);
+    emit(c, add_const(c, params));
+    emit(c, add_const(c, body));
+}
+
+// Mirrors let_step: malformed binders are skipped, values see the outer env
+static void compile_let(Chunk* c, Value* args, int tail) {
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    int count = 0;
+    for (Value* b = car(args); !is_nil(b); b = cdr(b)) {
+        Value* bind = car(b);
+        Value* sym = car(bind);
+        if (!sym || val_tag(sym) != T_SYM || !sym->s) continue;
+        compile(c, car(cdr(bind)), 0);
+        Value* cell = mk_cell(sym, NIL);
+        if (!cell) {
+            c->overflow = 1;
+            return;
+        }
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+        count++;
+    }
+    emit(c, OP_LET);
+    emit(c, add_const(c, names));
+    emit(c, count);
+    compile(c, car(cdr(args)), tail);
+    if (!tail) emit(c, OP_POP_ENV);
+}
+
+static void compile_letrec(Chunk* c, Value* args, int tail) {
+    Value* names = NIL;
+    Value* names_tail = NULL;
+    int count = 0;
+    for (Value* b = car(args); !is_nil(b); b = cdr(b)) {
+        Value* cell = mk_cell(car(car(b)), NIL);
+        if (!cell) {
+            c->overflow = 1;
+            return;
+        }
+        if (names_tail) names_tail->cell.cdr = cell;
+        else names = cell;
+        names_tail = cell;
+        count++;
+    }
+    emit(c, OP_LETREC);
+    emit(c, add_const(c, names));
+    emit(c, count);
+    int slot = 0;
+    for (Value* b = car(args); !is_nil(b); b = cdr(b)) {
+        compile(c, car(cdr(car(b))), 0);
+        emit(c, OP_SET_SLOT);
+        emit(c, slot++);
+    }
+    compile(c, car(cdr(args)), tail);
+    if (!tail) emit(c, OP_POP_ENV);
+}
+
+// (call/cc (lambda (k) body)) with k only called in tail position
+// (oneshot.h): body runs in a frame binding k, as a let would, and k
+// just returns its argument; no escape frame, no closure
+static void compile_call_cc_return(Chunk* c, Value* lambda_args, int tail) {
+    Value* params = car(lambda_args);
+    Value* body = resolve_lambda_body(lambda_args, params, car(cdr(lambda_args)));
+    Value* k = mk_cont(NULL, NULL, CONT_TAG_RETURN);
+    if (!k) {
+        c->overflow = 1;
+        return;
+    }
+    emit_op(c, OP_CONST, k);
+    emit(c, OP_LET);
+    emit(c, add_const(c, params));
+    emit(c, 1);
+    compile(c, body, tail);
+    if (!tail) emit(c, OP_POP_ENV);
+}
+
+static void compile_call(Chunk* c, Value* e, int tail) {
+    compile(c, e->cell.car, 0);
+    int n = 0;
+    for (Value* a = e->cell.cdr; !is_nil(a); a = cdr(a)) {
+        compile(c, car(a), 0);
+        n++;
+    }
+    emit(c, tail ? OP_TAIL_CALL : OP_CALL);
+    emit(c, n);
+}
+
+static void compile_form(Chunk* c, Value* e, int tail) {
+    Value* op = e->cell.car;
+    Value* args = e->cell.cdr;
+
+    if (!is_proper_list(args)) {
+        compile_fallback(c, e, tail);
+        return;
+    }
+    if (!op || val_tag(op) != T_SYM || !op->sym_form) {
+        compile_call(c, e, tail);
+        return;
+    }
+
+    if (op == SYM_QUOTE) {
+        emit_op(c, OP_CONST, car(args));
+    } else if (op == SYM_IF) {
+        compile_if(c, args, tail);
+        return;
+    } else if (op == SYM_DO) {
+        compile_do(c, args, tail);
+        return;
+    } else if (op == SYM_AND) {
+        compile_logic(c, args, OP_AND_JUMP, SYM_T, tail);
+        return;
+    } else if (op == SYM_OR) {
+        compile_logic(c, args, OP_OR_JUMP, NULL, tail);
+        return;
+    } else if (op == SYM_LET) {
+        compile_let(c, args, tail);
+        return;
+    } else if (op == SYM_LETREC) {
+        compile_letrec(c, args, tail);
+        return;
+    } else if (op == SYM_LAMBDA && !is_nil(args)) {
+        compile_closure(c, args, car(args));
+    } else if (op == SYM_DEFINE && car(args) && val_tag(car(args)) == T_CELL &&
+               car(car(args)) && val_tag(car(car(args))) == T_SYM) {
+        compile_closure(c, args, cdr(car(args)));
+        emit_op(c, OP_DEFINE, car(car(args)));
+    } else if (op == SYM_DEFINE && car(args) && val_tag(car(args)) == T_SYM &&
+               !is_nil(cdr(args))) {
+        compile(c, car(cdr(args)), 0);
+        emit_op(c, OP_DEFINE, car(args));
+    } else if (op == SYM_SET_BANG && car(args) && val_tag(car(args)) == T_SYM) {
+        compile(c, car(cdr(args)), 0);
+        emit_op(c, OP_SET_NAME, car(args));
+    } else if (op == SYM_CALL_CC && !is_nil(args) && is_nil(cdr(args)) && cont_escape_only(car(args))) {
+        compile_call_cc_return(c, cdr(car(args)), tail);
+        return;
+    } else if (op == SYM_CALL_CC && !is_nil(args)) {
+        compile(c, car(args), 0);
+        emit(c, OP_CALL_CC);
+    } else if (op == SYM_PROMPT) {
+        if (is_nil(args)) {
+            emit(c, OP_NIL);
+        } else {
+            Chunk* body = compile_chunk(car(args));
+            if (!body) {
+                compile_fallback(c, e, tail);
+                return;
+            }
+            emit(c, OP_PROMPT);
+            emit(c, add_sub(c, body));
+        }
+    } else {
+        // control, go, select, deftype, staging forms, malformed forms
+        compile_fallback(c, e, tail);
+        return;
+    }
+    if (tail) emit(c, OP_RETURN);
+}
+
+static void compile(Chunk* c, Value* e, int tail) {
+    if (c->overflow) return;
+    if (is_nil(e)) {
+        emit(c, OP_NIL);
+    } else if (val_tag(e) == T_INT || val_tag(e) == T_CODE) {
+        emit_op(c, OP_CONST, e);
+    } else if (val_tag(e) == T_SYM) {
+        emit_op(c, OP_NAME, e);
+    } else if (val_tag(e) == T_LREF) {
+        emit_op(c, OP_LREF, e);
+    } else if (val_tag(e) == T_CELL) {
+        compile_form(c, e, tail);
+        return;
+    } else {
+        emit(c, OP_NIL);
+    }
+    if (tail) emit(c, OP_RETURN);
+}
+
+// Compile e as a function body; too large a body is tree-walked instead
+static Chunk* compile_chunk(Value* e) {
+    Chunk* c = chunk_new();
+    if (!c) return NULL;
+    compile(c, e, 1);
+    if (c->overflow) {
+        chunk_clear(c);
+        compile_fallback(c, e, 1);
+        if (c->overflow) {
+            chunk_free(c);
+            return NULL;
+        }
+    }
+    return c;
+}
+
+static Chunk* chunk_for(Value* body) {
+    Value* key = body ? body : NIL;
+    if (!vm.chunks) vm.chunks = hashmap_new();
+    if (!vm.chunks) return NULL;
+    Chunk* c = hashmap_get(vm.chunks, key);
+    if (c) return c;
+    // The resolver's caches are shared by every thread
+    eval_shared_enter();
+    c = compile_chunk(body);
+    eval_shared_leave();
+    if (c) hashmap_put(vm.chunks, key, c);
+    return c;
+}
+
+static void free_chunk_entry(void* key, void* value, void* ctx) {
+    (void)key; (void)ctx;
+    chunk_free(value);
+}
+
+void vm_reset(void) {
+    if (vm.root_pairs) hashmap_free(vm.root_pairs);
+    vm.root_pairs = NULL;
+    vm.root = NULL;
+    if (vm.chunks) {
+        hashmap_foreach(vm.chunks, free_chunk_entry, NULL);
+        hashmap_free(vm.chunks);
+    }
+    vm.chunks = NULL;
+}
+
+// -- Machine --
+
+static int grow_stack(void) {
+    int cap = vm.cap ? vm.cap * 2 : 256;
+    Value** stack = realloc(vm.stack, cap * sizeof(Value*));
+    if (!stack) return 0;
+    vm.stack = stack;
+    vm.cap = cap;
+    return 1;
+}
+
+static int push_frame(Chunk* chunk, Value* env) {
+    if (vm.fp == vm.fcap) {
+        if (vm.fcap >= VM_MAX_FRAMES) return 0;
+        int cap = vm.fcap ? vm.fcap * 2 : 64;
+        CallFrame* frames = realloc(vm.frames, cap * sizeof(CallFrame));
+        if (!frames) return 0;
+        vm.frames = frames;
+        vm.fcap = cap;
+    }
+    CallFrame* f = &vm.frames[vm.fp++];
+    f->chunk = chunk;
+    f->ip = 0;
+    f->env = env;
+    f->base = vm.sp;
+    return 1;
+}
+
+// Frame for a closure call on the top n stack values; as bind_params,
+// surplus arguments are dropped and missing ones stay unbound.
+static Value* bind_args(Value* fn, int n) {
+    Value* params = fn->lam.params;
+    int np = resolve_param_count(params);
+    Value* frame = mk_frame(params, np, fn->lam.env);
+    if (!frame) return NULL;
+    int m = n < np ? n : np;
+    for (int i = 0; i < m; i++) {
+        frame->frame.slots[i] = vm.stack[vm.sp - n + i];
+    }
+    return frame;
+}
+
+// Apply a non-closure to the top n stack values
+static Value* apply_value(Value* fn, int n, Value* env) {
+    if (!fn) return NIL;
+
+    if (val_tag(fn) == T_PRIM) {
+        if (n == 2 && fn->prim2) {
+            Value* a = vm.stack[vm.sp - 2];
+            Value* b = vm.stack[vm.sp - 1];
+            if (!a || !b) return NIL;
+            return fn->prim2(a, b);
+        }
+        Value* args = NIL;
+        for (int i = vm.sp - 1; i >= vm.sp - n; i--) {
+            args = mk_cell(vm.stack[i], args);
+            if (!args) return NIL;
+        }
+        vm.menv->menv.env = env;
+        return fn->prim(args, vm.menv);
+    }
+
+    if (val_tag(fn) == T_CONT) {
+        return invoke_continuation(fn, n > 0 ? vm.stack[vm.sp - n] : NIL);
+    }
+
+    char* fn_str = val_to_str(fn);
+    printf("Error: Not a function: %s\n", fn_str ? fn_str : "(null)");
+    free(fn_str);
+    return NIL;
+}
+
+// Free variable lookup. The root environment is a fixed chain of cells
+// (set! mutates them in place), so a symbol's cell there is found once;
+// anything unusual goes through h_var_default.
+static Value* lookup_name(Value* sym, Value* env) {
+    Value* e = env;
+    while (val_tag(e) == T_FRAME) {
+        int slot = frame_slot(e, sym);
+        if (slot >= 0) {
+            Value* v = e->frame.slots[slot];
+            if (v != SYM_UNINIT) return v;
+            break;
+        }
+        e = e->frame.next;
+    }
+    if (e == vm.root && vm.root_pairs) {
+        Value* pair = hashmap_get(vm.root_pairs, sym);
+        if (!pair) {
+            pair = NIL;
+            for (Value* r = vm.root; !is_nil(r) && val_tag(r) == T_CELL; r = r->cell.cdr) {
+                Value* p = r->cell.car;
+                if (p && val_tag(p) == T_CELL && p->cell.car == sym) {
+                    pair = p;
+                    break;
+                }
+            }
+            hashmap_put(vm.root_pairs, sym, pair);
+        }
+        if (pair != NIL && pair->cell.cdr && pair->cell.cdr != SYM_UNINIT) return pair->cell.cdr;
+        if (pair == NIL) {
+            Value* v = global_lookup(sym);
+            if (v) return v;
+        }
+    }
+    vm.menv->menv.env = env;
+    return h_var_default(sym, vm.menv);
+}
+
+static Value* vm_run(int base_fp);
+
+#define SAVE_REGS() do { \
+        vm.frames[vm.fp - 1].ip = ip; \
+        vm.frames[vm.fp - 1].env = env; \
+    } while (0)
+
+#define LOAD_REGS() do { \
+        chunk = vm.frames[vm.fp - 1].chunk; \
+        code = chunk->code; \
+        consts = chunk->consts; \
+        ip = vm.frames[vm.fp - 1].ip; \
+        env = vm.frames[vm.fp - 1].env; \
+    } while (0)
+
+#define PUSH(v) do { \
+        Value* pushed_ = (v); \
+        if (vm.sp == vm.cap && !grow_stack()) goto oom; \
+        vm.stack[vm.sp++] = pushed_; \
+    } while (0)
+
+// Apply fn to one argument in a nested run
+static Value* vm_apply1(Value* fn, Value* arg) {
+    if (vm.sp == vm.cap && !grow_stack()) return NIL;
+    vm.stack[vm.sp++] = arg;
+    Value* frame = bind_args(fn, 1);
+    vm.sp--;
+    Chunk* body = frame ? chunk_for(fn->lam.body) : NULL;
+    if (!body || !push_frame(body, frame)) return NIL;
+    return vm_run(vm.fp - 1);
+}
+
+static Value* vm_call_cc_apply(Value* k, void* data) {
+    Value* proc = data;
+    if (val_tag(proc) == T_LAMBDA) return vm_apply1(proc, k);
+    if (val_tag(proc) == T_PRIM) return proc->prim(mk_cell(k, NIL), vm.menv);
+    return mk_error("call/cc: not a procedure");
+}
+
+typedef struct {
+    Chunk* body;
+    Value* env;
+} PromptRun;
+
+static Value* vm_prompt_body(void* data) {
+    PromptRun* p = data;
+    if (!push_frame(p->body, p->env)) return NIL;
+    return vm_run(vm.fp - 1);
+}
+
+// Run until the frame at base_fp returns
+static Value* vm_loop(int base_fp) {
+    Chunk* chunk;
+    uint16_t* code;
+    Value** consts;
+    int ip;
+    Value* env;
+    Value* result;
+    LOAD_REGS();
+
+    for (;;) {
+        switch ((OpCode)code[ip++]) {
+        case OP_CONST:
+            PUSH(consts[code[ip++]]);
+            break;
+
+        case OP_NIL:
+            PUSH(NIL);
+            break;
+
+        case OP_LREF: {
+            Value* ref = consts[code[ip++]];
+            Value* e = env;
+            int depth = ref->lref.depth;
+            while (depth > 0 && val_tag(e) == T_FRAME) {
+                e = e->frame.next;
+                depth--;
+            }
+            Value* v = NULL;
+            if (depth == 0 && val_tag(e) == T_FRAME && ref->lref.slot < e->frame.count) {
+                v = e->frame.slots[ref->lref.slot];
+            }
+            if (!v || v == SYM_UNINIT) {
+                // Unbound, placeholder or shadowed by a (sym . val) cell
+                vm.menv->menv.env = env;
+                v = eval_lref(ref, vm.menv);
+            }
+            PUSH(v);
+            break;
+        }
+
+        case OP_NAME:
+            PUSH(lookup_name(consts[code[ip++]], env));
+            break;
+
+        case OP_SET_NAME: {
+            Value* sym = consts[code[ip++]];
+            Value* val = vm.stack[vm.sp - 1];
+            if (!env_set(env, sym, val) && !global_set(sym, val)) {
+                printf("Error: set!: unbound variable %s\n", sym->s);
+                vm.stack[vm.sp - 1] = mk_error("set!: unbound variable");
+            }
+            break;
+        }
+
+        case OP_DEFINE: {
+            Value* sym = consts[code[ip++]];
+            global_define(sym, vm.stack[vm.sp - 1]);
+            vm.stack[vm.sp - 1] = sym;
+            break;
+        }
+
+        case OP_CLOSURE: {
+            Value* params = consts[code[ip++]];
+            Value* body = consts[code[ip++]];
+            PUSH(mk_lambda(params, body, env));
+            break;
+        }
+
+        case OP_POP:
+            vm.sp--;
+            break;
+
+        case OP_JUMP:
+            ip = code[ip];
+            break;
+
+        case OP_JUMP_NIL:
+            if (is_nil(vm.stack[--vm.sp])) ip = code[ip];
+            else ip++;
+            break;
+
+        case OP_AND_JUMP:
+            if (is_nil(vm.stack[vm.sp - 1])) {
+                vm.stack[vm.sp - 1] = NIL;
+                ip = code[ip];
+            } else {
+                vm.sp--;
+                ip++;
+            }
+            break;
+
+        case OP_OR_JUMP:
+            if (!is_nil(vm.stack[vm.sp - 1])) {
+                ip = code[ip];
+            } else {
+                vm.sp--;
+                ip++;
+            }
+            break;
+
+        case OP_CALL:
+        case OP_TAIL_CALL: {
+            int is_tail = code[ip - 1] == OP_TAIL_CALL;
+            int n = code[ip++];
+            Value* fn = vm.stack[vm.sp - n - 1];
+
+            if (fn && val_tag(fn) == T_LAMBDA) {
+                Value* frame = bind_args(fn, n);
+                Chunk* body = frame ? chunk_for(fn->lam.body) : NULL;
+                if (!body) goto oom;
+                vm.sp -= n + 1;
+                if (profile_active) {
+                    if (is_tail) profile_call(fn->lam.body);
+                    else profile_push(fn->lam.body);
+                }
+                if (is_tail) {
+                    CallFrame* f = &vm.frames[vm.fp - 1];
+                    vm.sp = f->base;
+                    f->chunk = body;
+                    f->ip = 0;
+                    f->env = frame;
+                } else {
+                    SAVE_REGS();
+                    if (!push_frame(body, frame)) {
+                        printf("Error: VM call stack overflow\n");
+                        goto unwind;
+                    }
+                }
+                LOAD_REGS();
+                break;
+            }
+
+            SAVE_REGS();
+            result = apply_value(fn, n, env);
+            vm.sp -= n + 1;
+            if (is_tail) goto do_return;
+            PUSH(result);
+            break;
+        }
+
+        case OP_RETURN:
+            result = vm.stack[--vm.sp];
+        do_return:
+            if (profile_active) profile_return();
+            vm.sp = vm.frames[--vm.fp].base;
+            if (vm.fp == base_fp) return result;
+            LOAD_REGS();
+            PUSH(result);
+            break;
+
+        case OP_LET: {
+            Value* names = consts[code[ip++]];
+            int n = code[ip++];
+            Value* frame = mk_frame(names, n, env);
+            if (!frame) goto oom;
+            for (int i = 0; i < n; i++) {
+                Value* v = vm.stack[vm.sp - n + i];
+                frame->frame.slots[i] = v ? v : NIL;
+            }
+            vm.sp -= n;
+            env = frame;
+            break;
+        }
+
+        case OP_LETREC: {
+            Value* names = consts[code[ip++]];
+            int n = code[ip++];
+            Value* frame = mk_frame(names, n, env);
+            if (!frame) goto oom;
+            for (int i = 0; i < n; i++) frame->frame.slots[i] = SYM_UNINIT;
+            env = frame;
+            break;
+        }
+
+        case OP_SET_SLOT: {
+            Value* v = vm.stack[--vm.sp];
+            int slot = code[ip++];
+            env->frame.slots[slot] = v ? v : NIL;
+            if (profile_active && v && val_tag(v) == T_LAMBDA) {
+                // A letrec binder: name the closure after it
+                Value* name = env->frame.names;
+                for (int i = 0; i < slot && val_tag(name) == T_CELL; i++) name = name->cell.cdr;
+                if (val_tag(name) == T_CELL) profile_name(v->lam.body, name->cell.car->s);
+            }
+            break;
+        }
+
+        case OP_POP_ENV:
+            env = env->frame.next;
+            break;
+
+        case OP_CALL_CC: {
+            Value* proc = vm.stack[--vm.sp];
+            SAVE_REGS();
+            if (!proc) {
+                result = mk_error("call/cc: procedure evaluated to nil");
+            } else {
+                int sp = vm.sp;
+                int fp = vm.fp;
+                vm.menv->menv.env = env;
+                result = call_with_escape(vm_call_cc_apply, proc, vm.menv);
+                vm.sp = sp;
+                vm.fp = fp;
+            }
+            LOAD_REGS();
+            PUSH(result);
+            break;
+        }
+
+        case OP_PROMPT: {
+            PromptRun p = { chunk->subs[code[ip++]], env };
+            SAVE_REGS();
+            int sp = vm.sp;
+            int fp = vm.fp;
+            result = call_with_prompt(vm_prompt_body, &p);
+            vm.sp = sp;
+            vm.fp = fp;
+            LOAD_REGS();
+            PUSH(result);
+            break;
+        }
+
+        case OP_EVAL: {
+            Value* form = consts[code[ip++]];
+            SAVE_REGS();
+            Value* menv = mk_menv(vm.parent, env);
+            result = menv ? eval(form, menv) : NIL;
+            PUSH(result);
+            break;
+        }
+
+        default:
+            printf("Error: VM: bad opcode %d\n", code[ip - 1]);
+            goto unwind;
+        }
+    }
+
+oom:
+    printf("Error: VM out of memory\n");
+unwind:
+    vm.sp = vm.frames[base_fp].base;
+    vm.fp = base_fp;
+    return NIL;
+}
+
+// Profiling: frames entered below base_fp are dropped however the run ends
+static Value* vm_run(int base_fp) {
+    if (!profile_active) return vm_loop(base_fp);
+    ProfileMark mark = profile_mark();
+    Value* result = vm_loop(base_fp);
+    profile_release(mark);
+    return result;
+}
+
+// -- Entry Points --
+
+// Forms whose meaning depends on the tree-walker's handlers, anywhere in
+// the program including quoted data a later run might evaluate
+static int uses_staging(Value* e) {
+    while (e && val_tag(e) == T_CELL) {
+        if (uses_staging(e->cell.car)) return 1;
+        e = e->cell.cdr;
+    }
+    if (!e) return 0;
+    if (val_tag(e) == T_CODE) return 1;
+    return e == SYM_LIFT || e == SYM_EM || e == SYM_SCAN ||
+           e == SYM_SET_META || e == SYM_GET_META;
+}
+
+int vm_accepts(Value* expr, Value* menv) {
+    if (!menv || val_tag(menv) != T_MENV) return 0;
+    if (menv->menv.h_app != h_app_default || menv->menv.h_let != h_let_default ||
+        menv->menv.h_if != h_if_default || menv->menv.h_lit != h_lit_default ||
+        menv->menv.h_var != h_var_default) {
+        return 0;
+    }
+    return !uses_staging(expr);
+}
+
+Value* vm_eval(Value* expr, Value* menv) {
+    if (!vm_accepts(expr, menv)) return eval(expr, menv);
+
+    Chunk* c = chunk_for(expr);
+    Value* scratch = mk_menv(menv->menv.parent, menv->menv.env);
+    if (!c || !scratch) return eval(expr, menv);
+
+    Value* saved_menv = vm.menv;
+    Value* saved_parent = vm.parent;
+    vm.menv = scratch;
+    vm.parent = menv->menv.parent;
+    if (vm.root != menv->menv.env || !vm.root_pairs) {
+        if (vm.root_pairs) hashmap_free(vm.root_pairs);
+        vm.root_pairs = hashmap_new();
+        vm.root = menv->menv.env;
+    }
+
+    Value* result = push_frame(c, menv->menv.env) ? vm_run(vm.fp - 1) : NIL;
+
+    vm.menv = saved_menv;
+    vm.parent = saved_parent;
+    return result;
+}
+
+static void disassemble_chunk(DString* ds, Chunk* c, int level) {
+    int ip = 0;
+    while (ip < c->len) {
+        int op = c->code[ip];
+        ds_printf(ds, "%*s%04d %s", level * 2, "", ip, op < OP_COUNT ? op_info[op].name : "?");
+        int operands = op < OP_COUNT ? op_info[op].operands : 0;
+        for (int i = 1; i <= operands && ip + i < c->len; i++) {
+            ds_printf(ds, " %d", c->code[ip + i]);
+        }
+        if (op == OP_CONST || op == OP_NAME || op == OP_LREF || op == OP_SET_NAME ||
+            op == OP_DEFINE || op == OP_EVAL) {
+            char* s = val_to_str(c->consts[c->code[ip + 1]]);
+            ds_printf(ds, "    ; %s", s ? s : "?");
+            free(s);
+        }
+        ds_append_char(ds, '\n');
+        if (op == OP_PROMPT) disassemble_chunk(ds, c->subs[c->code[ip + 1]], level + 1);
+        ip += 1 + operands;
+    }
+}
+
+char* vm_disassemble(Value* expr) {
+    Chunk* c = chunk_for(expr);
+    if (!c) return NULL;
+    DString* ds = ds_new();
+    if (!ds) return NULL;
+    disassemble_chunk(ds, c, 0);
+    return ds_take(ds);
+}
@@ -0,0 +1,33 @@
+/*
+ * Bytecode VM
+ *
+ * Compiles the parsed Value AST into a compact stack bytecode and runs it
+ * in a loop with heap-allocated call frames, so interpreted programs pay
+ * neither AST dispatch nor C recursion per call. Environments are the same
+ * T_FRAME chains the tree-walker builds, and closures are ordinary
+ * T_LAMBDA values: both executors call each other's closures freely.
+ *
+ * Programs that stage code (lift, EM, scan, set-meta!, get-meta) need the
+ * tree-walker's handler semantics and are run by eval() unchanged. Inside
+ * VM programs, control, go, select and deftype are delegated to eval() at
+ * the form level; call/cc and prompt run natively.
+ */
+
+#ifndef PURPLE_VM_H
+#define PURPLE_VM_H
+
+#include "../types.h"
+
+// Evaluate expr in the VM, or with eval() when it cannot run there
+Value* vm_eval(Value* expr, Value* menv);
+
+// Whether expr is run by the VM rather than eval()
+int vm_accepts(Value* expr, Value* menv);
+
+// Bytecode listing for expr (malloc'd), for debugging
+char* vm_disassemble(Value* expr);
+
+// Drop compiled chunks (call when the compiler arena is reset)
+void vm_reset(void);
+
+#endif // PURPLE_VM_H
@@ -15,9 +15,13 @@
 #include <ctype.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
 
 #include "types.h"
 #include "eval/eval.h"
+#include "eval/vm.h"
+#include "eval/profile.h"
+#include "eval/vector.h"
 #include "parser/parser.h"
 #include "codegen/codegen.h"
 #include "memory/scc.h"
@@ -28,6 +32,11 @@
 #include "analysis/shape.h"
 #include "analysis/escape.h"
 #include "analysis/dps.h"
+#include "analysis/usage.h"
+#include "analysis/report.h"
+#include "util/emit.h"
+#include "util/source.h"
+#include "util/server.h"
 
 // Escape a string for safe use in C single-line comments.
 // Returns malloc'd string that caller must free.
@@ -60,20 +69,107 @@ static char* escape_for_comment(const char* s) {
     return out;
 }
 
-// -- Main Entry Point --
+// Emit what main() does with one evaluated form: a compiled expression
+// declares `result`, anything else is recorded as a comment. Returns
+// whether `result` was declared. With RT_VECTOR in features a vector
+// result is printed as one.
+static int emit_form_result(Value* result, const char* source, const char* indent, unsigned features) {
+    int declared = 0;
+    if (result && val_tag(result) == T_CODE) {
+        // Compiled code - output as expression, straight from the code value
+        char* escaped = escape_for_comment(source);
+        emit("%s// Expression: %s\n", indent, escaped ? escaped : source);
+        free(escaped);
+        emit("%sObj* result = %s;\n", indent, code_text(result));
+        if (features & RT_VECTOR) {
+            emit("%sif (result && OBJ_IS_VEC(result)) { printf(\"Result: \"); vec_write(stdout, result); printf(\"\\n\"); }\n", indent);
+            emit("%selse if (result) printf(\"Result: %%ld\\n\", result->i);\n", indent);
+        } else {
+            emit("%sif (result) printf(\"Result: %%ld\\n\", result->i);\n", indent);
+        }
+        declared = 1;
+    } else if (result && val_tag(result) == T_INT) {
+        // Interpreted result - output as comment
+        emit("%s// Result: %ld\n", indent, val_int(result));
+    } else {
+        // Other result types
+        char* str = val_to_str(result);
+        if (!str) str = strdup("(error)");
+        char* escaped_str = escape_for_comment(str);
+        emit("%s// Result: %s\n", indent, escaped_str ? escaped_str : str);
+        free(escaped_str);
+        free(str);
+    }
+    return declared;
+}
 
-int main(int argc, char** argv) {
-    // Initialize compiler arena (Phase 12)
-    // All Value* allocations during compilation use this arena
-    compiler_arena_init();
+// Emit the runtime sections in `features` (see analyze_runtime_usage)
+static void gen_runtime(unsigned features) {
+    if (!(features & RT_CORE)) {
+        gen_runtime_banner();
+        return;
+    }
 
-    // Initialize symbol table
-    init_syms();
+    // Generate C runtime header
+    gen_runtime_header();
 
-    // Initialize type registry (Phase 8)
-    init_type_registry();
+    // Generate weak reference support (Phase 3)
+    if (features & RT_WEAK) gen_weak_ref_runtime();
+    else gen_weak_ref_stub();
 
-    // Initial environment with primitives
+    // Generate Perceus reuse runtime (Phase 4)
+    if (features & RT_PERCEUS) gen_perceus_runtime();
+
+    // Generate SCC runtime (Phase 6b - ISMM 2024)
+    if (features & RT_SCC) gen_scc_runtime();
+
+    // Generate deferred RC runtime (Phase 7)
+    if (features & RT_DEFERRED) gen_deferred_runtime();
+
+    // Generate arena allocator (Phase 8)
+    if (features & RT_ARENA) gen_arena_runtime();
+
+    // Generate DPS runtime (Phase 9)
+    if (features & RT_DPS) gen_dps_runtime();
+
+    // Generate exception handling runtime (Phase 10)
+    if (features & RT_EXCEPTION) gen_exception_runtime();
+
+    // Generate concurrency runtime (Phase 11)
+    if (features & RT_CONCURRENT) gen_concurrent_runtime();
+
+    // Generate ASAP scanner for List type
+    if (features & RT_SCANNER) gen_asap_scanner("List", 1);
+
+    gen_arith_runtime();
+
+    // Unboxed vectors and their bulk operations
+    if (features & RT_VECTOR) gen_vector_runtime();
+}
+
+// Source of the precompiled runtime library (libpurple_rt.a): every
+// section, against the declarations in purple_rt.h
+static void gen_runtime_library(void) {
+    emit("#define PURPLE_RT_SOURCE\n");
+    emit("#include \"purple_rt.h\"\n\n");
+    gen_core_runtime();
+    gen_weak_ref_runtime();
+    gen_perceus_runtime();
+    gen_scc_runtime();
+    gen_deferred_runtime();
+    gen_arena_runtime();
+    gen_dps_runtime();
+    gen_exception_runtime();
+    gen_concurrent_runtime();
+    gen_asap_scanner("List", 1);
+    gen_arith_runtime();
+    gen_vector_runtime();
+}
+
+// -- Compilation --
+
+// Global environment with every primitive bound
+static Value* make_root_env(void) {
     Value* env = NIL;
 
     // Constants
@@ -81,24 +177,24 @@ int main(int argc, char** argv) {
     env = env_extend(env, mk_sym("nil"), NIL);
 
     // Arithmetic
-    env = env_extend(env, mk_sym("+"), mk_prim(prim_add));
-    env = env_extend(env, mk_sym("-"), mk_prim(prim_sub));
-    env = env_extend(env, mk_sym("*"), mk_prim(prim_mul));
-    env = env_extend(env, mk_sym("/"), mk_prim(prim_div));
-    env = env_extend(env, mk_sym("%"), mk_prim(prim_mod));
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("-"), mk_prim2(prim_sub, prim_sub2));
+    env = env_extend(env, mk_sym("*"), mk_prim2(prim_mul, prim_mul2));
+    env = env_extend(env, mk_sym("/"), mk_prim2(prim_div, prim_div2));
+    env = env_extend(env, mk_sym("%"), mk_prim2(prim_mod, prim_mod2));
 
     // Comparison
-    env = env_extend(env, mk_sym("="), mk_prim(prim_eq));
-    env = env_extend(env, mk_sym("<"), mk_prim(prim_lt));
-    env = env_extend(env, mk_sym(">"), mk_prim(prim_gt));
-    env = env_extend(env, mk_sym("<="), mk_prim(prim_le));
-    env = env_extend(env, mk_sym(">="), mk_prim(prim_ge));
+    env = env_extend(env, mk_sym("="), mk_prim2(prim_eq, prim_eq2));
+    env = env_extend(env, mk_sym("<"), mk_prim2(prim_lt, prim_lt2));
+    env = env_extend(env, mk_sym(">"), mk_prim2(prim_gt, prim_gt2));
+    env = env_extend(env, mk_sym("<="), mk_prim2(prim_le, prim_le2));
+    env = env_extend(env, mk_sym(">="), mk_prim2(prim_ge, prim_ge2));
 
     // Logical
     env = env_extend(env, mk_sym("not"), mk_prim(prim_not));
 
     // List operations
-    env = env_extend(env, mk_sym("cons"), mk_prim(prim_cons));
+    env = env_extend(env, mk_sym("cons"), mk_prim2(prim_cons, prim_cons2));
     env = env_extend(env, mk_sym("car"), mk_prim(prim_car));
     env = env_extend(env, mk_sym("cdr"), mk_prim(prim_cdr));
     env = env_extend(env, mk_sym("fst"), mk_prim(prim_fst));
@@ -114,6 +210,20 @@ int main(int argc, char** argv) {
     env = env_extend(env, mk_sym("set-box!"), mk_prim(prim_set_box));
     env = env_extend(env, mk_sym("box?"), mk_prim(prim_is_box));
 
+    // Vectors (unboxed longs) and their bulk operations
+    env = env_extend(env, mk_sym("vector"), mk_prim(prim_vector));
+    env = env_extend(env, mk_sym("make-vector"), mk_prim(prim_make_vector));
+    env = env_extend(env, mk_sym("vector?"), mk_prim(prim_is_vector));
+    env = env_extend(env, mk_sym("vector-length"), mk_prim(prim_vector_length));
+    env = env_extend(env, mk_sym("vector-ref"), mk_prim(prim_vector_ref));
+    env = env_extend(env, mk_sym("list->vector"), mk_prim(prim_list_to_vector));
+    env = env_extend(env, mk_sym("vector->list"), mk_prim(prim_vector_to_list));
+    env = env_extend(env, mk_sym("vector-map"), mk_prim(prim_vector_map));
+    env = env_extend(env, mk_sym("vector-fold"), mk_prim(prim_vector_fold));
+    env = env_extend(env, mk_sym("vector-filter"), mk_prim(prim_vector_filter));
+    env = env_extend(env, mk_sym("vector-add"), mk_prim(prim_vector_add));
+    env = env_extend(env, mk_sym("vector-dot"), mk_prim(prim_vector_dot));
+
     // I/O operations
     env = env_extend(env, mk_sym("display"), mk_prim(prim_display));
     env = env_extend(env, mk_sym("newline"), mk_prim(prim_newline));
@@ -131,170 +241,460 @@ int main(int argc, char** argv) {
     env = env_extend(env, mk_sym("chan-send!"), mk_prim(prim_chan_send));
     env = env_extend(env, mk_sym("chan-recv!"), mk_prim(prim_chan_recv));
     env = env_extend(env, mk_sym("chan-close!"), mk_prim(prim_chan_close));
+    env = env_extend(env, mk_sym("chan-send-many!"), mk_prim(prim_chan_send_many));
+    env = env_extend(env, mk_sym("chan-recv-many!"), mk_prim(prim_chan_recv_many));
 
     // Register deftype primitives for user-defined types (A5)
     register_deftype_primitives(env);
 
-    // Initial Meta-Environment (Level 0)
-    Value* menv = mk_menv(NIL, env);
+    return env;
+}
 
-    // Generate C runtime header
-    gen_runtime_header();
+typedef struct CompileOptions {
+    unsigned forced_features;  // --full-runtime
+    int link_runtime;          // --link-runtime
+    int file_mode;             // --file: input holds every top-level form
+    int stats;                 // --stats: instrumented runtime (PURPLE_STATS)
+    int timing;                // --time: eval and emission times on stderr
+} CompileOptions;
+
+// Apply one compile flag; 0 if it is not one
+static int parse_compile_option(const char* opt, CompileOptions* opts) {
+    if (strcmp(opt, "--full-runtime") == 0) {
+        opts->forced_features = RT_ALL;
+    } else if (strcmp(opt, "--link-runtime") == 0) {
+        opts->link_runtime = 1;
+    } else if (strcmp(opt, "--stats") == 0) {
+        opts->stats = 1;
+    } else if (strcmp(opt, "--time") == 0) {
+        opts->timing = 1;
+    } else {
+        return 0;
+    }
+    return 1;
+}
 
-    // Generate weak reference support (Phase 3)
-    gen_weak_ref_runtime();
+// One line from f (newline dropped), malloc'd; NULL on OOM
+static char* read_line(FILE* f) {
+    size_t cap = 1024;
+    size_t len = 0;
+    char* buf = malloc(cap);
+    if (!buf) { fprintf(stderr, "OOM\n"); return NULL; }
+
+    int c;
+    while ((c = getc(f)) != EOF && c != '\n') {
+        if (len + 1 >= cap) {
+            if (cap > SIZE_MAX / 2) {
+                fprintf(stderr, "Input too large\n");
+                free(buf);
+                return NULL;
+            }
+            size_t new_cap = cap * 2;
+            char* new_buf = realloc(buf, new_cap);
+            if (!new_buf) { fprintf(stderr, "OOM\n"); free(buf); return NULL; }
+            buf = new_buf;
+            cap = new_cap;
+        }
+        buf[len++] = (char)c;
+    }
+    buf[len] = '\0';
+    return buf;
+}
 
-    // Generate Perceus reuse runtime (Phase 4)
-    gen_perceus_runtime();
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
 
-    // Generate SCC runtime (Phase 6b - ISMM 2024)
-    gen_scc_runtime();
+// Independent top-level forms evaluated together, at most
+#define COMPILE_BATCH 64
+
+// One top-level form's value: staged code gets a block of its own
+static void emit_top_form(Value* form, Value* result, unsigned features) {
+    if (result && val_tag(result) == T_CODE) {
+        char* source = val_to_str(form);
+        emit("  {\n");
+        emit_form_result(result, source, "    ", features);
+        emit("    if (result) dec_ref(result);\n");
+        emit("  }\n");
+        free(source);
+    } else {
+        emit_form_result(result, NULL, "  ", features);
+    }
+    emit_flush();
+}
 
-    // Generate deferred RC runtime (Phase 7)
-    gen_deferred_runtime();
+// Compile input_str into a C program on the current emit sink
+static void compile_program(const char* input_str, const CompileOptions* opts, Value* menv) {
+    // Parse up front: the feature-usage pass picks the runtime to emit
+    const char* default_test = "(let ((x (lift 10))) (+ x (lift 5)))";
+    int use_default = !(input_str && strlen(input_str) > 0);
+    Value* expr = NULL;
+    unsigned features = opts->forced_features;
+    if (opts->file_mode) {
+        // File mode: the runtime covers every form. This pass keeps nothing,
+        // each form's parse is released as soon as it has been analyzed
+        set_parse_input(input_str);
+        while (!parse_at_end()) {
+            int scoped = compiler_arena_push();
+            Value* form = parse();
+            if (form) features |= analyze_runtime_usage(form);
+            if (scoped) compiler_arena_pop(0);
+            if (!form) break;
+        }
+        use_default = 0;
+    } else {
+        if (report_enabled() || profile_active) source_positions_enable(1);
+        set_parse_input(use_default ? default_test : input_str);
+        expr = parse();
+        if (expr) features |= analyze_runtime_usage(expr);
+    }
 
-    // Generate arena allocator (Phase 8)
-    gen_arena_runtime();
+    // Counters in the runtime, dumped at exit; a linked program needs a
+    // library built with -DPURPLE_STATS too
+    if (opts->stats && (opts->link_runtime || (features & RT_CORE))) {
+        emit("#define PURPLE_STATS 1\n");
+    }
+    // --time: evaluation (interpreting and staging) apart from emission
+    double eval_ms = 0;
+    double start = now_ms();
+    if (opts->link_runtime) {
+        // The library carries every section; the epilogue may call any of them
+        emit("#include \"purple_rt.h\"\n\n");
+        features = RT_ALL;
+    } else {
+        gen_runtime(features);
+    }
 
-    // Generate DPS runtime (Phase 9)
-    gen_dps_runtime();
+    emit("int main() {\n");
+    // Evaluation prints to stdout directly (display, errors): keep it in
+    // stream order after everything emitted so far
+    emit_flush();
 
-    // Generate exception handling runtime (Phase 10)
-    gen_exception_runtime();
+    int emitted_result = 0;  // Track if we declared 'result' variable
+    if (opts->file_mode) {
+        // Forms share the global environment, so earlier defines are seen
+        // by later forms; each compiled form gets its own block. A form is
+        // parsed and run in its own arena scope, released once emitted
+        // unless it wrote into longer-lived state (define, set!, ...)
+        //
+        // Consecutive forms that only read (eval_parallel_safe) are
+        // evaluated side by side, a batch to a scope; the form that ends
+        // the run goes last, on its own
+        set_parse_input(input_str);
+        int parsed_all = 0;
+        while (!parse_at_end() && !parsed_all) {
+            int scoped = compiler_arena_push();
+            // Positions of these forms only: the last ones' parse is released
+            if (report_enabled() || profile_active) source_positions_enable(1);
+            Value* forms[COMPILE_BATCH];
+            Value* results[COMPILE_BATCH];
+            int nforms = 0;
+            int independent = 0;
+            while (nforms < COMPILE_BATCH && !parse_at_end()) {
+                Value* form = parse();
+                if (!form) {
+                    parsed_all = 1;
+                    break;
+                }
+                forms[nforms++] = form;
+                if (!eval_parallel_safe(form, menv)) break;
+                independent++;
+            }
+            if (nforms == 0) {
+                if (scoped) compiler_arena_pop(0);
+                break;
+            }
 
-    // Generate concurrency runtime (Phase 11)
-    gen_concurrent_runtime();
+            unsigned long writes = eval_mutation_count();
+            int i = 0;
+            if (independent > 1) {
+                double eval_start = now_ms();
+                eval_parallel(forms, independent, menv, results);
+                eval_ms += now_ms() - eval_start;
+                if (profile_active) profile_collect();
+                for (; i < independent; i++) emit_top_form(forms[i], results[i], features);
+            }
+            for (; i < nforms; i++) {
+                double eval_start = now_ms();
+                if (profile_active) profile_set_root(forms[i]);
+                results[i] = vm_eval(forms[i], menv);
+                scheduler_run(menv);
+                eval_ms += now_ms() - eval_start;
+                // Named while the form's positions and values are still here
+                if (profile_active) profile_collect();
+                emit_top_form(forms[i], results[i], features);
+            }
+            if (scoped) {
+                int keep = eval_mutation_count() != writes;
+                compiler_arena_pop(keep);
+                if (!keep) eval_drop_caches();
+            }
+        }
+    } else if (!use_default) {
+        if (expr) {
+            double eval_start = now_ms();
+            if (profile_active) profile_set_root(expr);
+            Value* result = vm_eval(expr, menv);
+            scheduler_run(menv);
+            eval_ms += now_ms() - eval_start;
+            if (profile_active) profile_collect();
+            emitted_result = emit_form_result(result, input_str, "  ", features);
+        }
+    } else {
+        // Default test expression
+        emit("  // Default test: %s\n", default_test);
+        if (expr) {
+            Value* result = eval(expr, menv);
+            char* str = val_to_str(result);
+            if (!str) str = strdup("(error)");
+            emit("  Obj* result = %s;\n", str);
+            emit("  if (result) printf(\"Result: %%ld\\n\", result->i);\n");
+            free(str);
+            emitted_result = 1;
+        }
+    }
 
-    // Generate ASAP scanner for List type
-    gen_asap_scanner("List", 1);
+    if (emitted_result) emit("  if (result) dec_ref(result);\n");
+    if (features & RT_CORE) emit("  flush_freelist();\n");
+    if (features & RT_DEFERRED) emit("  flush_all_deferred();\n");
+    if (features & RT_CONCURRENT) emit("  conc_flush_deferred();\n");
+    if (features & RT_WEAK) emit("  cleanup_all_weak_refs();\n");
+    if (features & RT_CORE) emit("  slab_release_all();\n");
+    emit("  return 0;\n");
+    emit("}\n");
+    emit_flush();
+    source_positions_enable(0);
+    if (opts->timing) {
+        fprintf(stderr, "Time: eval %.3f ms, emit %.3f ms\n", eval_ms, now_ms() - start - eval_ms);
+    }
+}
+
+// -- Compile Server --
+
+// Warm state shared by every request
+typedef struct ServerState {
+    Value* env;
+    const char* prologue;      // Startup output every program begins with
+    GlobalSnapshot* snapshot;
+} ServerState;
+
+// A request is one line of flags (as on the command line), then the
+// source: the file's contents with --file, else the expression. The
+// generated program is the response.
+static int serve_request(const char* request, size_t len, void* ctx) {
+    ServerState* st = ctx;
+    const char* nl = memchr(request, '\n', len);
+    size_t flags_len = nl ? (size_t)(nl - request) : len;
+    const char* body = nl ? nl + 1 : request + len;
+
+    char* flags = strndup(request, flags_len);
+    if (!flags) {
+        printf("Error: out of memory\n");
+        return 0;
+    }
+    CompileOptions opts = {0, 0, 0, 0, 0};
+    int stop = 0;
+    int ok = 1;
+    for (char* tok = strtok(flags, " \t\r"); tok; tok = strtok(NULL, " \t\r")) {
+        if (strcmp(tok, "--shutdown") == 0) {
+            stop = 1;
+        } else if (strcmp(tok, "--file") == 0) {
+            opts.file_mode = 1;
+        } else if (!parse_compile_option(tok, &opts)) {
+            printf("Error: unknown option %s\n", tok);
+            ok = 0;
+        }
+    }
+    free(flags);
+    if (stop || !ok) return stop;
+
+    // Everything the request allocates is released with its scope, and
+    // globals it defined are rolled back, so requests cannot see each other
+    int scoped = compiler_arena_push();
+    Value* menv = mk_menv(NIL, st->env);
+    emit_str(st->prologue);
+    compile_program(body, &opts, menv);
+    global_env_restore(st->snapshot);
+    if (scoped) compiler_arena_pop(0);
+    eval_drop_caches();
+    return 0;
+}
+
+// -- Main Entry Point --
+
+int main(int argc, char** argv) {
+    // Initialize compiler arena (Phase 12)
+    // All Value* allocations during compilation use this arena
+    compiler_arena_init();
+
+    // Initialize symbol table
+    init_syms();
 
-    printf("\n// Runtime arithmetic functions (with overflow protection)\n");
-    printf("Obj* add(Obj* a, Obj* b) {\n");
-    printf("    if (!a || !b) return mk_int(0);\n");
-    printf("    if ((b->i > 0 && a->i > LONG_MAX - b->i) || (b->i < 0 && a->i < LONG_MIN - b->i)) return mk_int(0);\n");
-    printf("    return mk_int(a->i + b->i);\n");
-    printf("}\n");
-    printf("Obj* sub(Obj* a, Obj* b) {\n");
-    printf("    if (!a || !b) return mk_int(0);\n");
-    printf("    if ((b->i < 0 && a->i > LONG_MAX + b->i) || (b->i > 0 && a->i < LONG_MIN + b->i)) return mk_int(0);\n");
-    printf("    return mk_int(a->i - b->i);\n");
-    printf("}\n");
-    printf("Obj* mul(Obj* a, Obj* b) {\n");
-    printf("    if (!a || !b) return mk_int(0);\n");
-    printf("    if (a->i > 0 && b->i > 0 && a->i > LONG_MAX / b->i) return mk_int(0);\n");
-    printf("    if (a->i > 0 && b->i < 0 && b->i < LONG_MIN / a->i) return mk_int(0);\n");
-    printf("    if (a->i < 0 && b->i > 0 && a->i < LONG_MIN / b->i) return mk_int(0);\n");
-    printf("    if (a->i < 0 && b->i < 0 && a->i < LONG_MAX / b->i) return mk_int(0);\n");
-    printf("    return mk_int(a->i * b->i);\n");
-    printf("}\n");
-    printf("Obj* div_op(Obj* a, Obj* b) { if (!a || !b || b->i == 0 || (a->i == LONG_MIN && b->i == -1)) return mk_int(0); return mk_int(a->i / b->i); }\n");
-    printf("Obj* mod_op(Obj* a, Obj* b) { if (!a || !b || b->i == 0 || (a->i == LONG_MIN && b->i == -1)) return mk_int(0); return mk_int(a->i %% b->i); }\n\n");
-
-    printf("// Runtime comparison functions\n");
-    printf("Obj* eq_op(Obj* a, Obj* b) { if (!a || !b) return mk_int(0); return mk_int(a->i == b->i); }\n");
-    printf("Obj* lt_op(Obj* a, Obj* b) { if (!a || !b) return mk_int(0); return mk_int(a->i < b->i); }\n");
-    printf("Obj* gt_op(Obj* a, Obj* b) { if (!a || !b) return mk_int(0); return mk_int(a->i > b->i); }\n");
-    printf("Obj* le_op(Obj* a, Obj* b) { if (!a || !b) return mk_int(0); return mk_int(a->i <= b->i); }\n");
-    printf("Obj* ge_op(Obj* a, Obj* b) { if (!a || !b) return mk_int(0); return mk_int(a->i >= b->i); }\n\n");
-
-    printf("// Runtime logical functions\n");
-    printf("Obj* not_op(Obj* a, Obj* unused) { (void)unused; if (!a) return mk_int(1); return mk_int(!a->i); }\n\n");
-
-    printf("// Runtime list functions\n");
-    printf("int is_nil(Obj* x) { return x == NULL; }\n\n");
-
-    printf("int main() {\n");
+    // Initialize type registry (Phase 8). Its back-edge report leads every
+    // generated program: keep the text so the compile server can repeat it
+    EmitSink* out = emit_set_sink(emit_to_memory());
+    init_type_registry();
+    char* prologue = emit_take(emit_set_sink(out));
+    if (!prologue) {
+        fprintf(stderr, "OOM\n");
+        return 1;
+    }
+
+    // Initial environment with primitives
+    Value* env = make_root_env();
+
+    // --full-runtime: emit every runtime section, used or not
+    // --link-runtime: emit main() only, against libpurple_rt.a
+    // --stats: count allocations, frees by strategy, reuse and pauses; JSON at exit
+    // --time: time spent evaluating and emitting, on stderr
+    // --report PATH: why each let binding is freed the way it is, as JSON
+    // --profile PATH: where evaluation spends its time, as folded stacks
+    // --emit-runtime / --emit-runtime-header: library source / purple_rt.h
+    // --file PATH: compile every top-level form in PATH into one main()
+    // --serve SOCKET: compile requests from --connect clients, kept warm
+    // --connect SOCKET: send this compilation to a server (--shutdown stops it)
+    int arg = 1;
+    CompileOptions opts = {0, 0, 0, 0, 0};
+    const char* file_path = NULL;
+    const char* serve_path = NULL;
+    const char* connect_path = NULL;
+    const char* report_path = NULL;
+    const char* profile_path = NULL;
+    int shutdown_server = 0;
+    while (argc > arg && strncmp(argv[arg], "--", 2) == 0) {
+        if (parse_compile_option(argv[arg], &opts)) {
+            // Compile flag
+        } else if (strcmp(argv[arg], "--file") == 0 && argc > arg + 1) {
+            file_path = argv[++arg];
+            opts.file_mode = 1;
+        } else if (strcmp(argv[arg], "--serve") == 0 && argc > arg + 1) {
+            serve_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--connect") == 0 && argc > arg + 1) {
+            connect_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--report") == 0 && argc > arg + 1) {
+            report_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--profile") == 0 && argc > arg + 1) {
+            profile_path = argv[++arg];
+        } else if (strcmp(argv[arg], "--shutdown") == 0) {
+            shutdown_server = 1;
+        } else if (strcmp(argv[arg], "--emit-runtime") == 0) {
+            emit_str(prologue);
+            gen_runtime_library();
+            emit_flush();
+            return 0;
+        } else if (strcmp(argv[arg], "--emit-runtime-header") == 0) {
+            emit_str(prologue);
+            gen_runtime_decls();
+            emit_flush();
+            return 0;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", argv[arg]);
+            return 1;
+        }
+        arg++;
+    }
+
+    // The server compiles in its own process; the report stays local
+    if (report_path && (serve_path || connect_path)) {
+        fprintf(stderr, "Error: --report cannot be used with --serve or --connect\n");
+        return 1;
+    }
+    if (profile_path && (serve_path || connect_path)) {
+        fprintf(stderr, "Error: --profile cannot be used with --serve or --connect\n");
+        return 1;
+    }
+
+    if (serve_path) {
+        ServerState st = {env, prologue, global_env_snapshot()};
+        if (!st.snapshot) {
+            fprintf(stderr, "OOM\n");
+            return 1;
+        }
+        int rc = server_run(serve_path, serve_request, &st);
+        if (rc != 0) fprintf(stderr, "Error: cannot serve on %s\n", serve_path);
+        global_snapshot_free(st.snapshot);
+        free(prologue);
+        compiler_arena_cleanup();
+        return rc != 0;
+    }
 
     // Process input expressions
     char* input_str = NULL;
     int input_allocated = 0;
 
-    if (argc > 1) {
+    Source* source = NULL;
+    if (shutdown_server) {
+        input_str = "";
+    } else if (file_path) {
+        // Mapped and parsed in place, no copy
+        source = source_load(file_path);
+        if (!source) {
+            fprintf(stderr, "Error: cannot read %s\n", file_path);
+            return 1;
+        }
+        input_str = (char*)source->text;
+    } else if (argc > arg) {
         // Read from command line argument
-        input_str = argv[1];
+        input_str = argv[arg];
     } else {
         // Read from stdin using dynamic buffer
-        size_t cap = 1024;
-        size_t len = 0;
-        char* buf = malloc(cap);
-        if (!buf) { fprintf(stderr, "OOM\n"); return 1; }
-        
-        int c;
-        while ((c = getchar()) != EOF && c != '\n') {
-            if (len + 1 >= cap) {
-                if (cap > SIZE_MAX / 2) {
-                    fprintf(stderr, "Input too large\n");
-                    free(buf);
-                    return 1;
-                }
-                size_t new_cap = cap * 2;
-                char* new_buf = realloc(buf, new_cap);
-                if (!new_buf) { fprintf(stderr, "OOM\n"); free(buf); return 1; }
-                buf = new_buf;
-                cap = new_cap;
-            }
-            buf[len++] = (char)c;
-        }
-        buf[len] = '\0';
-        input_str = buf;
+        input_str = read_line(stdin);
+        if (!input_str) return 1;
         input_allocated = 1;
     }
 
-    int emitted_result = 0;  // Track if we declared 'result' variable
-    if (input_str && strlen(input_str) > 0) {
-        set_parse_input(input_str);
-        Value* expr = parse();
-        if (expr) {
-            Value* result = eval(expr, menv);
-            char* str = val_to_str(result);
-            if (!str) str = strdup("(error)");
-            if (result && result->tag == T_CODE) {
-                // Compiled code - output as expression
-                char* escaped = escape_for_comment(input_str);
-                printf("  // Expression: %s\n", escaped ? escaped : input_str);
-                free(escaped);
-                printf("  Obj* result = %s;\n", str);
-                printf("  if (result) printf(\"Result: %%ld\\n\", result->i);\n");
-                emitted_result = 1;
-            } else if (result && result->tag == T_INT) {
-                // Interpreted result - output as comment
-                printf("  // Result: %ld\n", result->i);
-            } else {
-                // Other result types
-                char* escaped_str = escape_for_comment(str);
-                printf("  // Result: %s\n", escaped_str ? escaped_str : str);
-                free(escaped_str);
-            }
-            free(str);
+    int rc = 0;
+    if (connect_path) {
+        // Forward the flags and source; the server's output is ours
+        DString* req = ds_new();
+        if (shutdown_server) ds_append(req, " --shutdown");
+        if (opts.forced_features) ds_append(req, " --full-runtime");
+        if (opts.link_runtime) ds_append(req, " --link-runtime");
+        if (opts.stats) ds_append(req, " --stats");
+        if (opts.timing) ds_append(req, " --time");
+        if (opts.file_mode) ds_append(req, " --file");
+        ds_append(req, "\n");
+        ds_append(req, input_str);
+        if (server_request(connect_path, ds_cstr(req), ds_len(req), stdout) != 0) {
+            fprintf(stderr, "Error: cannot connect to %s\n", connect_path);
+            rc = 1;
         }
+        ds_free(req);
     } else {
-        // Default test expression
-        const char* test = "(let ((x (lift 10))) (+ x (lift 5)))";
-        printf("  // Default test: %s\n", test);
-        set_parse_input(test);
-        Value* expr = parse();
-        if (expr) {
-            Value* result = eval(expr, menv);
-            char* str = val_to_str(result);
-            if (!str) str = strdup("(error)");
-            printf("  Obj* result = %s;\n", str);
-            printf("  if (result) printf(\"Result: %%ld\\n\", result->i);\n");
-            free(str);
-            emitted_result = 1;
+        // Initial Meta-Environment (Level 0)
+        Value* menv = mk_menv(NIL, env);
+        emit_str(prologue);
+        if (report_path) report_enable(1);
+        if (profile_path) profile_start(profile_hz());
+        compile_program(input_str, &opts, menv);
+        if (profile_path) {
+            FILE* f = fopen(profile_path, "w");
+            if (!f || !profile_write(f)) {
+                fprintf(stderr, "Error: cannot write %s\n", profile_path);
+                rc = 1;
+            }
+            if (f) fclose(f);
+            profile_stop();
+        }
+        if (report_path) {
+            FILE* f = fopen(report_path, "w");
+            if (!f || !report_write(f, file_path ? file_path : "-")) {
+                fprintf(stderr, "Error: cannot write %s\n", report_path);
+                rc = 1;
+            }
+            if (f) fclose(f);
+            report_enable(0);
         }
     }
 
     if (input_allocated) free(input_str);
-
-    if (emitted_result) printf("  if (result) dec_ref(result);\n");
-    printf("  flush_freelist();\n");
-    printf("  flush_all_deferred();\n");
-    printf("  cleanup_all_weak_refs();\n");
-    printf("  return 0;\n");
-    printf("}\n");
+    source_free(source);
+    free(prologue);
 
     // Cleanup compiler arena - bulk free all Values and strings
     compiler_arena_cleanup();
 
-    return 0;
+    return rc;
 }
@@ -1,6 +1,153 @@
 #include "arena.h"
+#include "../util/emit.h"
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+
+// -- Block Pool --
+// Blocks come in power-of-two size classes and go back to one process-wide
+// pool when their arena is destroyed, so scopes that create and destroy
+// arenas at a high rate reuse blocks instead of calling malloc. Blocks past
+// the largest class are mapped directly (huge pages when the system has
+// them) and unmapped on release. The block header shares its allocation
+// with the memory it describes.
+
+#define ARENA_CLASS_MIN_SHIFT 9                     // 512 B
+#define ARENA_CLASS_MAX_SHIFT 20                    // 1 MB
+#define ARENA_CLASS_COUNT (ARENA_CLASS_MAX_SHIFT - ARENA_CLASS_MIN_SHIFT + 1)
+#define ARENA_POOL_CLASS_BYTES ((size_t)4 << 20)    // Kept per class
+#define ARENA_POOL_CLASS_MIN 4                      // Blocks kept per class at least
+#define ARENA_PAGE ((size_t)4096)
+#define ARENA_HUGE_PAGE ((size_t)2 << 20)
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static ArenaBlock* pool_free[ARENA_CLASS_COUNT];
+static size_t pool_count[ARENA_CLASS_COUNT];
+
+// Size class holding `size` bytes; ARENA_CLASS_COUNT or more if none does
+static int size_class(size_t size) {
+    int shift = ARENA_CLASS_MIN_SHIFT;
+    while (shift <= ARENA_CLASS_MAX_SHIFT && ((size_t)1 << shift) < size) shift++;
+    return shift - ARENA_CLASS_MIN_SHIFT;
+}
+
+static size_t class_keep(int cls) {
+    size_t keep = ARENA_POOL_CLASS_BYTES >> (cls + ARENA_CLASS_MIN_SHIFT);
+    return keep > ARENA_POOL_CLASS_MIN ? keep : ARENA_POOL_CLASS_MIN;
+}
+
+static ArenaBlock* block_map(size_t size) {
+    size_t len = sizeof(ArenaBlock) + size;
+    void* m = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (len >= ARENA_HUGE_PAGE) {
+        size_t huge = (len + ARENA_HUGE_PAGE - 1) & ~(ARENA_HUGE_PAGE - 1);
+        m = mmap(NULL, huge, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (m != MAP_FAILED) len = huge;
+    }
+#endif
+    if (m == MAP_FAILED) {
+        // No reserved huge pages: ordinary pages, transparent huge pages if allowed
+        len = (len + ARENA_PAGE - 1) & ~(ARENA_PAGE - 1);
+        m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+        if (len >= ARENA_HUGE_PAGE) madvise(m, len, MADV_HUGEPAGE);
+#endif
+    }
+    ArenaBlock* b = m;
+    b->memory = (char*)(b + 1);
+    b->size = len - sizeof(ArenaBlock);
+    b->mapped = len;
+    return b;
+}
+
+static ArenaBlock* block_acquire(size_t size) {
+    int cls = size_class(size);
+    if (cls >= ARENA_CLASS_COUNT) return block_map(size);
+
+    pthread_mutex_lock(&pool_lock);
+    ArenaBlock* b = pool_free[cls];
+    if (b) {
+        pool_free[cls] = b->next;
+        pool_count[cls]--;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    if (!b) {
+        size_t bs = (size_t)1 << (cls + ARENA_CLASS_MIN_SHIFT);
+        b = malloc(sizeof(ArenaBlock) + bs);
+        if (!b) return NULL;
+        b->memory = (char*)(b + 1);
+        b->size = bs;
+        b->mapped = 0;
+    }
+    b->used = 0;
+    b->next = NULL;
+    return b;
+}
+
+static void block_free(ArenaBlock* b) {
+    if (b->mapped) munmap(b, b->mapped);
+    else free(b);
+}
+
+// Return a chain of blocks to the pool; what the pool has no room for is freed
+static void blocks_release(ArenaBlock* b) {
+    ArenaBlock* spill = NULL;
+    pthread_mutex_lock(&pool_lock);
+    while (b) {
+        ArenaBlock* next = b->next;
+        int cls = b->mapped ? ARENA_CLASS_COUNT : size_class(b->size);
+        if (cls < ARENA_CLASS_COUNT && pool_count[cls] < class_keep(cls)) {
+            b->next = pool_free[cls];
+            pool_free[cls] = b;
+            pool_count[cls]++;
+        } else {
+            b->next = spill;
+            spill = b;
+        }
+        b = next;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    while (spill) {
+        ArenaBlock* next = spill->next;
+        block_free(spill);
+        spill = next;
+    }
+}
+
+void arena_pool_trim(void) {
+    ArenaBlock* all = NULL;
+    pthread_mutex_lock(&pool_lock);
+    for (int cls = 0; cls < ARENA_CLASS_COUNT; cls++) {
+        while (pool_free[cls]) {
+            ArenaBlock* b = pool_free[cls];
+            pool_free[cls] = b->next;
+            b->next = all;
+            all = b;
+        }
+        pool_count[cls] = 0;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    while (all) {
+        ArenaBlock* next = all->next;
+        block_free(all);
+        all = next;
+    }
+}
+
+size_t arena_pool_blocks(void) {
+    size_t n = 0;
+    pthread_mutex_lock(&pool_lock);
+    for (int cls = 0; cls < ARENA_CLASS_COUNT; cls++) n += pool_count[cls];
+    pthread_mutex_unlock(&pool_lock);
+    return n;
+}
 
 // -- Arena Management --
 
@@ -21,22 +168,24 @@ void* arena_alloc(Arena* a, size_t size) {
     // Align to 8 bytes
     size = (size + 7) & ~(size_t)7;
 
-    if (!a->current || a->current->used + size > a->current->size) {
-        // Need new block
-        size_t bs = a->block_size;
-        if (size > bs) bs = size;
+    // After a reset, move on to the next emptied block that fits before adding one
+    while (a->current && a->current->used + size > a->current->size &&
+           a->current->next && a->current->next->used == 0 &&
+           size <= a->current->next->size) {
+        a->current = a->current->next;
+    }
 
-        ArenaBlock* b = malloc(sizeof(ArenaBlock));
+    if (!a->current || a->current->used + size > a->current->size) {
+        // Need new block: after current, so emptied blocks further on stay reachable
+        ArenaBlock* b = block_acquire(size > a->block_size ? size : a->block_size);
         if (!b) return NULL;
-        b->memory = malloc(bs);
-        if (!b->memory) {
-            free(b);
-            return NULL;
+        if (a->current) {
+            b->next = a->current->next;
+            a->current->next = b;
+        } else {
+            b->next = a->blocks;
+            a->blocks = b;
         }
-        b->size = bs;
-        b->used = 0;
-        b->next = a->blocks;
-        a->blocks = b;
         a->current = b;
     }
 
@@ -49,14 +198,7 @@ void arena_destroy(Arena* a) {
     if (!a) return;
 
     arena_release_externals(a);
-
-    ArenaBlock* b = a->blocks;
-    while (b) {
-        ArenaBlock* next = b->next;
-        free(b->memory);
-        free(b);
-        b = next;
-    }
+    blocks_release(a->blocks);
     free(a);
 }
 
@@ -71,6 +213,26 @@ void arena_reset(Arena* a) {
     a->current = a->blocks;
 }
 
+void arena_merge(Arena* into, Arena* from) {
+    if (!into || !from || into == from) return;
+
+    // Blocks: into keeps bumping its own current block
+    if (from->blocks) {
+        ArenaBlock* tail = from->blocks;
+        while (tail->next) tail = tail->next;
+        tail->next = into->blocks;
+        into->blocks = from->blocks;
+        if (!into->current) into->current = from->current;
+    }
+    if (from->externals) {
+        ArenaExternal* tail = from->externals;
+        while (tail->next) tail = tail->next;
+        tail->next = into->externals;
+        into->externals = from->externals;
+    }
+    free(from);
+}
+
 void arena_register_external(Arena* a, void* ptr, ArenaReleaseFn release) {
     if (!a || !ptr || !release) return;
     ArenaExternal* ext = malloc(sizeof(ArenaExternal));
@@ -118,129 +280,229 @@ int should_use_arena(const char* var_name, ArenaScope* scopes) {
 // -- Code Generation --
 
 void gen_arena_runtime(void) {
-    printf("\n// Phase 8: Arena Allocator for Cyclic Structures\n");
-    printf("// Bulk allocation, O(1) deallocation\n\n");
-
-    printf("typedef struct ArenaBlock {\n");
-    printf("    char* memory;\n");
-    printf("    size_t size;\n");
-    printf("    size_t used;\n");
-    printf("    struct ArenaBlock* next;\n");
-    printf("} ArenaBlock;\n\n");
-
-    printf("typedef struct Arena {\n");
-    printf("    ArenaBlock* current;\n");
-    printf("    ArenaBlock* blocks;\n");
-    printf("    size_t block_size;\n");
-    printf("    struct ArenaExternal* externals;\n");
-    printf("} Arena;\n\n");
-
-    printf("typedef void (*ArenaReleaseFn)(void*);\n");
-    printf("typedef struct ArenaExternal {\n");
-    printf("    void* ptr;\n");
-    printf("    ArenaReleaseFn release;\n");
-    printf("    struct ArenaExternal* next;\n");
-    printf("} ArenaExternal;\n\n");
-
-    printf("Arena* arena_create(size_t block_size) {\n");
-    printf("    Arena* a = malloc(sizeof(Arena));\n");
-    printf("    if (!a) return NULL;\n");
-    printf("    a->block_size = block_size ? block_size : 4096;\n");
-    printf("    a->blocks = NULL;\n");
-    printf("    a->current = NULL;\n");
-    printf("    a->externals = NULL;\n");
-    printf("    return a;\n");
-    printf("}\n\n");
-
-    printf("void arena_register_external(Arena* a, void* ptr, ArenaReleaseFn release) {\n");
-    printf("    if (!a || !ptr || !release) return;\n");
-    printf("    ArenaExternal* ext = malloc(sizeof(ArenaExternal));\n");
-    printf("    if (!ext) return;\n");
-    printf("    ext->ptr = ptr;\n");
-    printf("    ext->release = release;\n");
-    printf("    ext->next = a->externals;\n");
-    printf("    a->externals = ext;\n");
-    printf("}\n\n");
-
-    printf("void arena_release_externals(Arena* a) {\n");
-    printf("    if (!a) return;\n");
-    printf("    ArenaExternal* ext = a->externals;\n");
-    printf("    while (ext) {\n");
-    printf("        ArenaExternal* next = ext->next;\n");
-    printf("        ext->release(ext->ptr);\n");
-    printf("        free(ext);\n");
-    printf("        ext = next;\n");
-    printf("    }\n");
-    printf("    a->externals = NULL;\n");
-    printf("}\n\n");
-
-    printf("void* arena_alloc(Arena* a, size_t size) {\n");
-    printf("    if (!a) return NULL;\n");
-    printf("    size = (size + 7) & ~(size_t)7;\n");
-    printf("    if (!a->current || a->current->used + size > a->current->size) {\n");
-    printf("        size_t bs = a->block_size;\n");
-    printf("        if (size > bs) bs = size;\n");
-    printf("        ArenaBlock* b = malloc(sizeof(ArenaBlock));\n");
-    printf("        if (!b) return NULL;\n");
-    printf("        b->memory = malloc(bs);\n");
-    printf("        if (!b->memory) { free(b); return NULL; }\n");
-    printf("        b->size = bs;\n");
-    printf("        b->used = 0;\n");
-    printf("        b->next = a->blocks;\n");
-    printf("        a->blocks = b;\n");
-    printf("        a->current = b;\n");
-    printf("    }\n");
-    printf("    void* ptr = a->current->memory + a->current->used;\n");
-    printf("    a->current->used += size;\n");
-    printf("    return ptr;\n");
-    printf("}\n\n");
-
-    printf("void arena_destroy(Arena* a) {\n");
-    printf("    if (!a) return;\n");
-    printf("    arena_release_externals(a);\n");
-    printf("    ArenaBlock* b = a->blocks;\n");
-    printf("    while (b) {\n");
-    printf("        ArenaBlock* next = b->next;\n");
-    printf("        free(b->memory);\n");
-    printf("        free(b);\n");
-    printf("        b = next;\n");
-    printf("    }\n");
-    printf("    free(a);\n");
-    printf("}\n\n");
+    emit("\n// Phase 8: Arena Allocator for Cyclic Structures\n");
+    emit("// Bulk allocation, O(1) deallocation, pooled blocks\n\n");
+
+    emit("#include <sys/mman.h>\n\n");
+
+    emit("typedef struct ArenaBlock {\n");
+    emit("    char* memory;\n");
+    emit("    size_t size;\n");
+    emit("    size_t used;\n");
+    emit("    size_t mapped;\n");
+    emit("    struct ArenaBlock* next;\n");
+    emit("} ArenaBlock;\n\n");
+
+    emit("typedef struct Arena {\n");
+    emit("    ArenaBlock* current;\n");
+    emit("    ArenaBlock* blocks;\n");
+    emit("    size_t block_size;\n");
+    emit("    struct ArenaExternal* externals;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    long objects;          // Live cells, freed together\n");
+    emit("#endif\n");
+    emit("} Arena;\n\n");
+
+    emit("typedef void (*ArenaReleaseFn)(void*);\n");
+    emit("typedef struct ArenaExternal {\n");
+    emit("    void* ptr;\n");
+    emit("    ArenaReleaseFn release;\n");
+    emit("    struct ArenaExternal* next;\n");
+    emit("} ArenaExternal;\n\n");
+
+    emit("// Block pool: power-of-two classes from 512 B to 1 MB, one pool per thread\n");
+    emit("// so recycling needs no lock; larger blocks are mapped (huge pages if any)\n");
+    emit("#define ARENA_CLASS_MIN_SHIFT 9\n");
+    emit("#define ARENA_CLASS_COUNT 12\n");
+    emit("#define ARENA_POOL_CLASS_BYTES ((size_t)4 << 20)\n");
+    emit("#define ARENA_HUGE_PAGE ((size_t)2 << 20)\n");
+    emit("__thread ArenaBlock* ARENA_POOL[ARENA_CLASS_COUNT];\n");
+    emit("__thread size_t ARENA_POOL_COUNT[ARENA_CLASS_COUNT];\n\n");
+
+    emit("static int arena_size_class(size_t size) {\n");
+    emit("    int cls = 0;\n");
+    emit("    while (cls < ARENA_CLASS_COUNT && ((size_t)1 << (cls + ARENA_CLASS_MIN_SHIFT)) < size) cls++;\n");
+    emit("    return cls;\n");
+    emit("}\n\n");
+
+    emit("static ArenaBlock* arena_block_map(size_t size) {\n");
+    emit("    size_t len = sizeof(ArenaBlock) + size;\n");
+    emit("    void* m = MAP_FAILED;\n");
+    emit("#ifdef MAP_HUGETLB\n");
+    emit("    if (len >= ARENA_HUGE_PAGE) {\n");
+    emit("        size_t huge = (len + ARENA_HUGE_PAGE - 1) & ~(ARENA_HUGE_PAGE - 1);\n");
+    emit("        m = mmap(NULL, huge, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);\n");
+    emit("        if (m != MAP_FAILED) len = huge;\n");
+    emit("    }\n");
+    emit("#endif\n");
+    emit("    if (m == MAP_FAILED) {\n");
+    emit("        len = (len + 4095) & ~(size_t)4095;\n");
+    emit("        m = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);\n");
+    emit("        if (m == MAP_FAILED) return NULL;\n");
+    emit("#ifdef MADV_HUGEPAGE\n");
+    emit("        if (len >= ARENA_HUGE_PAGE) madvise(m, len, MADV_HUGEPAGE);\n");
+    emit("#endif\n");
+    emit("    }\n");
+    emit("    ArenaBlock* b = m;\n");
+    emit("    b->memory = (char*)(b + 1);\n");
+    emit("    b->size = len - sizeof(ArenaBlock);\n");
+    emit("    b->mapped = len;\n");
+    emit("    return b;\n");
+    emit("}\n\n");
+
+    emit("static ArenaBlock* arena_block_acquire(size_t size) {\n");
+    emit("    int cls = arena_size_class(size);\n");
+    emit("    if (cls >= ARENA_CLASS_COUNT) return arena_block_map(size);\n");
+    emit("    ArenaBlock* b = ARENA_POOL[cls];\n");
+    emit("    if (b) {\n");
+    emit("        ARENA_POOL[cls] = b->next;\n");
+    emit("        ARENA_POOL_COUNT[cls]--;\n");
+    emit("    } else {\n");
+    emit("        size_t bs = (size_t)1 << (cls + ARENA_CLASS_MIN_SHIFT);\n");
+    emit("        b = malloc(sizeof(ArenaBlock) + bs);\n");
+    emit("        if (!b) return NULL;\n");
+    emit("        b->memory = (char*)(b + 1);\n");
+    emit("        b->size = bs;\n");
+    emit("        b->mapped = 0;\n");
+    emit("    }\n");
+    emit("    b->used = 0;\n");
+    emit("    b->next = NULL;\n");
+    emit("    return b;\n");
+    emit("}\n\n");
+
+    emit("static void arena_block_release(ArenaBlock* b) {\n");
+    emit("    if (b->mapped) { munmap(b, b->mapped); return; }\n");
+    emit("    int cls = arena_size_class(b->size);\n");
+    emit("    size_t keep = ARENA_POOL_CLASS_BYTES >> (cls + ARENA_CLASS_MIN_SHIFT);\n");
+    emit("    if (keep < 4) keep = 4;\n");
+    emit("    if (ARENA_POOL_COUNT[cls] >= keep) { free(b); return; }\n");
+    emit("    b->next = ARENA_POOL[cls];\n");
+    emit("    ARENA_POOL[cls] = b;\n");
+    emit("    ARENA_POOL_COUNT[cls]++;\n");
+    emit("}\n\n");
+
+    emit("Arena* arena_create(size_t block_size) {\n");
+    emit("    Arena* a = malloc(sizeof(Arena));\n");
+    emit("    if (!a) return NULL;\n");
+    emit("    a->block_size = block_size ? block_size : 4096;\n");
+    emit("    a->blocks = NULL;\n");
+    emit("    a->current = NULL;\n");
+    emit("    a->externals = NULL;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    a->objects = 0;\n");
+    emit("#endif\n");
+    emit("    return a;\n");
+    emit("}\n\n");
+
+    emit("void arena_register_external(Arena* a, void* ptr, ArenaReleaseFn release) {\n");
+    emit("    if (!a || !ptr || !release) return;\n");
+    emit("    ArenaExternal* ext = malloc(sizeof(ArenaExternal));\n");
+    emit("    if (!ext) return;\n");
+    emit("    ext->ptr = ptr;\n");
+    emit("    ext->release = release;\n");
+    emit("    ext->next = a->externals;\n");
+    emit("    a->externals = ext;\n");
+    emit("}\n\n");
+
+    emit("void arena_release_externals(Arena* a) {\n");
+    emit("    if (!a) return;\n");
+    emit("    ArenaExternal* ext = a->externals;\n");
+    emit("    while (ext) {\n");
+    emit("        ArenaExternal* next = ext->next;\n");
+    emit("        ext->release(ext->ptr);\n");
+    emit("        free(ext);\n");
+    emit("        ext = next;\n");
+    emit("    }\n");
+    emit("    a->externals = NULL;\n");
+    emit("}\n\n");
+
+    emit("void* arena_alloc(Arena* a, size_t size) {\n");
+    emit("    if (!a) return NULL;\n");
+    emit("    size = (size + 7) & ~(size_t)7;\n");
+    emit("    while (a->current && a->current->used + size > a->current->size &&\n");
+    emit("           a->current->next && a->current->next->used == 0 &&\n");
+    emit("           size <= a->current->next->size) {\n");
+    emit("        a->current = a->current->next;\n");
+    emit("    }\n");
+    emit("    if (!a->current || a->current->used + size > a->current->size) {\n");
+    emit("        ArenaBlock* b = arena_block_acquire(size > a->block_size ? size : a->block_size);\n");
+    emit("        if (!b) return NULL;\n");
+    emit("        if (a->current) { b->next = a->current->next; a->current->next = b; }\n");
+    emit("        else { b->next = a->blocks; a->blocks = b; }\n");
+    emit("        a->current = b;\n");
+    emit("    }\n");
+    emit("    void* ptr = a->current->memory + a->current->used;\n");
+    emit("    a->current->used += size;\n");
+    emit("    return ptr;\n");
+    emit("}\n\n");
+
+    emit("// Keeps the blocks; only the bump pointers rewind\n");
+    emit("void arena_reset(Arena* a) {\n");
+    emit("    if (!a) return;\n");
+    emit("    for (ArenaBlock* b = a->blocks; b; b = b->next) b->used = 0;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    STAT_ADD(free_arena, a->objects);\n");
+    emit("    a->objects = 0;\n");
+    emit("#endif\n");
+    emit("    a->current = a->blocks;\n");
+    emit("}\n\n");
+
+    emit("void arena_destroy(Arena* a) {\n");
+    emit("    if (!a) return;\n");
+    emit("    arena_release_externals(a);\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    STAT_ADD(free_arena, a->objects);\n");
+    emit("#endif\n");
+    emit("    ArenaBlock* b = a->blocks;\n");
+    emit("    while (b) {\n");
+    emit("        ArenaBlock* next = b->next;\n");
+    emit("        arena_block_release(b);\n");
+    emit("        b = next;\n");
+    emit("    }\n");
+    emit("    free(a);\n");
+    emit("}\n");
 
     // Arena-aware allocators
-    printf("// Arena-aware allocators\n");
-    printf("Obj* arena_mk_int(Arena* a, long val) {\n");
-    printf("    Obj* o = arena_alloc(a, sizeof(Obj));\n");
-    printf("    if (!o) return NULL;\n");
-    printf("    o->mark = 1; o->scc_id = -1; o->is_pair = 0; o->scan_tag = 0;\n");
-    printf("    o->i = val;\n");
-    printf("    return o;\n");
-    printf("}\n\n");
-
-    printf("Obj* arena_mk_pair(Arena* a, Obj* car, Obj* cdr) {\n");
-    printf("    Obj* o = arena_alloc(a, sizeof(Obj));\n");
-    printf("    if (!o) return NULL;\n");
-    printf("    o->mark = 1; o->scc_id = -1; o->is_pair = 1; o->scan_tag = 0;\n");
-    printf("    o->a = car; o->b = cdr;\n");
-    printf("    return o;\n");
-    printf("}\n\n");
+    emit("// Arena-aware allocators\n");
+    emit("Obj* arena_mk_int(Arena* a, long val) {\n");
+    emit("    Obj* o = arena_alloc(a, sizeof(Obj));\n");
+    emit("    if (!o) return NULL;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    STAT_INC(alloc_arena);\n");
+    emit("    a->objects++;\n");
+    emit("#endif\n");
+    emit("    OBJ_INIT(o, 0);\n");
+    emit("    o->i = val;\n");
+    emit("    return o;\n");
+    emit("}\n\n");
+
+    emit("Obj* arena_mk_pair(Arena* a, Obj* car, Obj* cdr) {\n");
+    emit("    Obj* o = arena_alloc(a, sizeof(Obj));\n");
+    emit("    if (!o) return NULL;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    STAT_INC(alloc_arena);\n");
+    emit("    a->objects++;\n");
+    emit("#endif\n");
+    emit("    OBJ_INIT(o, 1);\n");
+    emit("    o->a = car; o->b = cdr;\n");
+    emit("    return o;\n");
+    emit("}\n\n");
 }
 
 void gen_arena_scope_begin(int scope_id) {
-    printf("    // ARENA SCOPE %d begin - cyclic allocations\n", scope_id);
-    printf("    Arena* _arena_%d = arena_create(0);\n", scope_id);
+    emit("    // ARENA SCOPE %d begin - cyclic allocations\n", scope_id);
+    emit("    Arena* _arena_%d = arena_create(0);\n", scope_id);
 }
 
 void gen_arena_scope_end(int scope_id) {
-    printf("    arena_destroy(_arena_%d);  // O(1) bulk free\n", scope_id);
-    printf("    // ARENA SCOPE %d end\n", scope_id);
+    emit("    arena_destroy(_arena_%d);  // O(1) bulk free\n", scope_id);
+    emit("    // ARENA SCOPE %d end\n", scope_id);
 }
 
 void gen_arena_alloc(int scope_id, const char* var_name, const char* type) {
     if (strcmp(type, "int") == 0) {
-        printf("    Obj* %s = arena_mk_int(_arena_%d, 0);\n", var_name, scope_id);
+        emit("    Obj* %s = arena_mk_int(_arena_%d, 0);\n", var_name, scope_id);
     } else {
-        printf("    Obj* %s = arena_mk_pair(_arena_%d, NULL, NULL);\n", var_name, scope_id);
+        emit("    Obj* %s = arena_mk_pair(_arena_%d, NULL, NULL);\n", var_name, scope_id);
     }
 }
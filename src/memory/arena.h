@@ -8,11 +8,12 @@
 // Bulk allocation and O(1) deallocation
 // Constraint: per-scope cleanup only; no stop-the-world.
 
-// Arena block for allocation
+// Arena block for allocation; the header sits in front of its memory
 typedef struct ArenaBlock {
     char* memory;
     size_t size;
     size_t used;
+    size_t mapped;               // Mapping length if mmap'd, else 0
     struct ArenaBlock* next;
 } ArenaBlock;
 
@@ -48,10 +49,15 @@ typedef struct ArenaScope {
 Arena* arena_create(size_t block_size);
 void* arena_alloc(Arena* arena, size_t size);
 void arena_destroy(Arena* arena);
-void arena_reset(Arena* arena);
+void arena_reset(Arena* arena);  // Keeps the blocks, rewinds the bump pointers
+void arena_merge(Arena* into, Arena* from);  // Moves blocks and externals, frees from
 void arena_register_external(Arena* arena, void* ptr, ArenaReleaseFn release);
 void arena_release_externals(Arena* arena);
 
+// Block pool: destroyed arenas return their blocks here by size class
+void arena_pool_trim(void);      // Free every pooled block
+size_t arena_pool_blocks(void);  // Blocks currently pooled
+
 // Scope detection
 ArenaScope* find_arena_scopes(Value* expr);
 int should_use_arena(const char* var_name, ArenaScope* scopes);
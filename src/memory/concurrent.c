@@ -2,6 +2,7 @@
 // Sources: SOTER (PLDI 2011), Concurrent Deferred RC (PLDI 2021), CIRC (PLDI 2024)
 
 #include "concurrent.h"
+#include "../util/emit.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,9 +12,9 @@ OwnershipClass analyze_ownership(Value* expr) {
     if (!expr) return OWN_LOCAL;
 
     // Check for channel operations
-    if (expr->tag == T_CELL) {
+    if (val_tag(expr) == T_CELL) {
         Value* head = expr->cell.car;
-        if (head && head->tag == T_SYM) {
+        if (head && val_tag(head) == T_SYM) {
             if (strcmp(head->s, "send") == 0) {
                 return OWN_TRANSFERRED;
             }
@@ -28,10 +29,10 @@ OwnershipClass analyze_ownership(Value* expr) {
 
 // Detect thread spawn points
 int is_spawn_point(Value* expr) {
-    if (!expr || expr->tag != T_CELL) return 0;
+    if (!expr || val_tag(expr) != T_CELL) return 0;
 
     Value* head = expr->cell.car;
-    if (head && head->tag == T_SYM) {
+    if (head && val_tag(head) == T_SYM) {
         return strcmp(head->s, "spawn") == 0 ||
                strcmp(head->s, "thread") == 0 ||
                strcmp(head->s, "parallel") == 0;
@@ -40,229 +41,620 @@ int is_spawn_point(Value* expr) {
     return 0;
 }
 
+// -- Single Producer / Single Consumer --
+
+typedef struct {
+    Value* chan;
+    int sends;
+    int recvs;
+    int ok;
+} SpscScan;
+
+static int head_is(Value* e, const char* a, const char* b) {
+    Value* head = e->cell.car;
+    return head && val_tag(head) == T_SYM &&
+           (strcmp(head->s, a) == 0 || strcmp(head->s, b) == 0);
+}
+
+static int starts_thread(Value* e) {
+    return is_spawn_point(e) || head_is(e, "go", "go");
+}
+
+static int contains_spawn(Value* e) {
+    if (!e || val_tag(e) != T_CELL) return 0;
+    if (starts_thread(e)) return 1;
+    for (; e && val_tag(e) == T_CELL; e = e->cell.cdr) {
+        if (contains_spawn(e->cell.car)) return 1;
+    }
+    return 0;
+}
+
+// multi: this code may run on several threads at once. lambda: a lambda
+// lies between here and the innermost spawn (or the scope), so it may be
+// called from anywhere the closure reaches; inside a spawn that starts no
+// other thread, that is still its own thread.
+static void spsc_scan(SpscScan* s, Value* e, int multi, int lambda, int nested) {
+    if (!s->ok || !e) return;
+    if (val_tag(e) == T_SYM) {
+        // Passed on, stored or rebound: other ends cannot be counted
+        if (e == s->chan) s->ok = 0;
+        return;
+    }
+    if (val_tag(e) != T_CELL) return;
+    if (head_is(e, "quote", "quote")) return;
+
+    Value* args = e->cell.cdr;
+    if (starts_thread(e)) {
+        multi |= lambda;
+        nested = contains_spawn(args);
+        lambda = 0;
+    } else if (head_is(e, "lambda", "define")) {
+        lambda = 1;
+    } else if ((head_is(e, "send", "chan-send!") || head_is(e, "recv", "chan-recv!")) &&
+               args && val_tag(args) == T_CELL && args->cell.car == s->chan) {
+        if (multi || (lambda && nested)) {
+            s->ok = 0;
+            return;
+        }
+        if (head_is(e, "send", "chan-send!")) s->sends++;
+        else s->recvs++;
+        e = args->cell.cdr;
+    }
+    for (; e && val_tag(e) == T_CELL; e = e->cell.cdr) {
+        spsc_scan(s, e->cell.car, multi, lambda, nested);
+    }
+}
+
+int channel_is_spsc(Value* chan, Value* body) {
+    if (!chan || val_tag(chan) != T_SYM) return 0;
+    SpscScan s = { chan, 0, 0, 1 };
+    spsc_scan(&s, body, 0, 0, 0);
+    return s.ok && s.sends <= 1 && s.recvs <= 1;
+}
+
 // Generate concurrency runtime
 void gen_concurrent_runtime(void) {
-    printf("\n// Phase 11: Concurrency Support Runtime\n");
-    printf("// Ownership transfer + atomic RC for zero-pause concurrent memory\n\n");
+    emit("\n// Phase 11: Concurrency Support Runtime\n");
+    emit("// Ownership transfer + biased RC for zero-pause concurrent memory\n\n");
 
-    printf("#include <stdatomic.h>\n");
-    printf("#include <pthread.h>\n\n");
+    emit("#include <stdatomic.h>\n");
+    emit("#include <pthread.h>\n");
+    emit("#include <sched.h>\n\n");
 
     // Thread-local storage
-    printf("// Thread-local region for private allocations\n");
-    printf("__thread int THREAD_ID = 0;\n");
-    printf("__thread void* THREAD_REGION = NULL;\n");
-    printf("__thread size_t THREAD_REGION_SIZE = 0;\n");
-    printf("__thread size_t THREAD_REGION_USED = 0;\n\n");
-
-    // Atomic reference count object
-    printf("// Concurrent object with atomic reference count\n");
-    printf("typedef struct ConcObj {\n");
-    printf("    _Atomic int rc;           // Atomic reference count\n");
-    printf("    int owner_thread;         // -1 if shared\n");
-    printf("    int is_immutable;         // 1 if frozen (no sync needed)\n");
-    printf("    int is_pair;\n");
-    printf("    union {\n");
-    printf("        long i;\n");
-    printf("        struct { struct ConcObj *a, *b; };\n");
-    printf("    };\n");
-    printf("} ConcObj;\n\n");
-
-    // Atomic increment
-    printf("// Atomic increment (for shared objects)\n");
-    printf("void conc_inc_ref(ConcObj* obj) {\n");
-    printf("    if (!obj) return;\n");
-    printf("    atomic_fetch_add(&obj->rc, 1);\n");
-    printf("}\n\n");
-
-    // Atomic decrement with potential free
-    printf("// Atomic decrement (may trigger deferred cleanup)\n");
-    printf("void conc_dec_ref(ConcObj* obj) {\n");
-    printf("    if (!obj) return;\n");
-    printf("    int old = atomic_fetch_sub(&obj->rc, 1);\n");
-    printf("    if (old == 1) {\n");
-    printf("        // Last reference - defer cleanup\n");
-    printf("        // In real impl, add to thread-local deferred list\n");
-    printf("        if (obj->is_pair) {\n");
-    printf("            conc_dec_ref(obj->a);\n");
-    printf("            conc_dec_ref(obj->b);\n");
-    printf("        }\n");
-    printf("        free(obj);\n");
-    printf("    }\n");
-    printf("}\n\n");
+    emit("// Thread-local region for private allocations\n");
+    emit("__thread int THREAD_ID = 0;\n");
+    emit("__thread void* THREAD_REGION = NULL;\n");
+    emit("__thread size_t THREAD_REGION_SIZE = 0;\n");
+    emit("__thread size_t THREAD_REGION_USED = 0;\n\n");
+
+    // Biased reference count object
+    emit("// Concurrent object with a biased reference count (Choi et al., PACT 2018):\n");
+    emit("// the thread that allocates an object owns its count and bumps a plain\n");
+    emit("// int; every other thread goes through shared_rc atomically. The two are\n");
+    emit("// merged when the owner's count runs out, when the owner sends the object\n");
+    emit("// on a channel, or when another thread's decrements overdraw the shared\n");
+    emit("// half (which queues the object for its owner). Frozen objects skip RC.\n");
+    emit("typedef struct ConcObj {\n");
+    emit("    int biased_rc;            // Owner's references (owner only)\n");
+    emit("    _Atomic uint64_t shared_rc; // Other threads' references, packed\n");
+    emit("    _Atomic int owner_thread; // Thread the count is biased to, -1 if none\n");
+    emit("    int is_immutable;         // 1 if frozen (no RC, no sync)\n");
+    emit("    int is_pair;\n");
+    emit("    struct ConcObj* merge_next; // Owner's merge queue\n");
+    emit("    union {\n");
+    emit("        long i;\n");
+    emit("        struct { struct ConcObj *a, *b; };\n");
+    emit("    };\n");
+    emit("} ConcObj;\n\n");
+
+    emit("// shared_rc: the count in the low 32 bits, offset by CONC_RC_ZERO so that\n");
+    emit("// it may dip below zero (a thread dropping references the owner counted)\n");
+    emit("// without borrowing from the flags above it\n");
+    emit("#define CONC_RC_ZERO 0x80000000ULL\n");
+    emit("#define CONC_RC_MERGED (1ULL << 32)  // Unbiased: shared_rc is the whole count\n");
+    emit("#define CONC_RC_QUEUED (1ULL << 33)  // Waiting in its owner's merge queue\n");
+    emit("#define CONC_RC_COUNT(v) ((long)((v) & 0xFFFFFFFFULL) - (long)CONC_RC_ZERO)\n");
+    emit("#define CONC_MAX_THREADS 1024       // Objects of higher thread ids start unbiased\n\n");
+
+    emit("// Objects whose shared count went negative, for their owner to merge\n");
+    emit("typedef struct ConcMergeQueue {\n");
+    emit("    _Atomic(ConcObj*) head;\n");
+    emit("    _Atomic int exited;       // Owner is gone: whoever queues merges\n");
+    emit("    char pad[48];\n");
+    emit("} ConcMergeQueue;\n\n");
+    emit("static ConcMergeQueue CONC_MERGE[CONC_MAX_THREADS];\n\n");
+
+    emit("// Deferred frees: the thread that drops the last reference queues the\n");
+    emit("// object on its own list instead of tearing the structure down inline.\n");
+    emit("// conc_safe_point frees a bounded batch (children are queued in turn, so\n");
+    emit("// no recursion), and spawned threads drain their list before exiting.\n");
+    emit("#define CONC_FREE_BATCH 64\n");
+    emit("__thread ConcObj** CONC_FREE_QUEUE = NULL;\n");
+    emit("__thread int CONC_FREE_LEN = 0;\n");
+    emit("__thread int CONC_FREE_CAP = 0;\n\n");
+
+    emit("void conc_dec_ref(ConcObj* obj);\n\n");
+
+    emit("// The last reference is gone: free at this thread's next safe point\n");
+    emit("static void conc_queue_free(ConcObj* obj) {\n");
+    emit("    if (CONC_FREE_LEN == CONC_FREE_CAP) {\n");
+    emit("        int cap = CONC_FREE_CAP ? CONC_FREE_CAP * 2 : 256;\n");
+    emit("        ConcObj** queue = CONC_FREE_CAP > INT_MAX / 2 ? NULL\n");
+    emit("                        : realloc(CONC_FREE_QUEUE, (size_t)cap * sizeof(ConcObj*));\n");
+    emit("        if (!queue) {\n");
+    emit("            // OOM fallback: free inline\n");
+    emit("            if (obj->is_pair) {\n");
+    emit("                conc_dec_ref(obj->a);\n");
+    emit("                conc_dec_ref(obj->b);\n");
+    emit("            }\n");
+    emit("            free(obj);\n");
+    emit("            return;\n");
+    emit("        }\n");
+    emit("        CONC_FREE_QUEUE = queue;\n");
+    emit("        CONC_FREE_CAP = cap;\n");
+    emit("    }\n");
+    emit("    CONC_FREE_QUEUE[CONC_FREE_LEN++] = obj;\n");
+    emit("}\n\n");
+
+    emit("static int conc_owned(ConcObj* obj) {\n");
+    emit("    return atomic_load_explicit(&obj->owner_thread, memory_order_relaxed) == THREAD_ID;\n");
+    emit("}\n\n");
+
+    emit("// Fold the owner's count into shared_rc and drop the bias. An object in\n");
+    emit("// its owner's merge queue stays biased until the queue is processed (the\n");
+    emit("// entry must not outlive it); `queued` says this is that processing.\n");
+    emit("// 0 if it stayed biased\n");
+    emit("static int conc_merge(ConcObj* obj, int queued) {\n");
+    emit("    uint64_t old = atomic_load_explicit(&obj->shared_rc, memory_order_relaxed);\n");
+    emit("    uint64_t merged;\n");
+    emit("    do {\n");
+    emit("        if (!queued && (old & CONC_RC_QUEUED)) return 0;\n");
+    emit("        merged = ((old | CONC_RC_MERGED) & ~CONC_RC_QUEUED & ~0xFFFFFFFFULL)\n");
+    emit("               | ((old + (uint64_t)(long)obj->biased_rc) & 0xFFFFFFFFULL);\n");
+    emit("    } while (!atomic_compare_exchange_weak_explicit(&obj->shared_rc, &old, merged,\n");
+    emit("                                                    memory_order_acq_rel, memory_order_relaxed));\n");
+    emit("    long total = CONC_RC_COUNT(old) + obj->biased_rc;\n");
+    emit("    obj->biased_rc = 0;\n");
+    emit("    atomic_store_explicit(&obj->owner_thread, -1, memory_order_relaxed);\n");
+    emit("    if (total == 0) conc_queue_free(obj);\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("// Merge everything queued for `owner` (its own safe points, or any\n");
+    emit("// thread once the owner has exited and its biased counts are final)\n");
+    emit("static void conc_merge_queued(int owner) {\n");
+    emit("    ConcObj* obj = atomic_exchange(&CONC_MERGE[owner].head, NULL);\n");
+    emit("    while (obj) {\n");
+    emit("        ConcObj* next = obj->merge_next;\n");
+    emit("        conc_merge(obj, 1);\n");
+    emit("        obj = next;\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Another thread overdrew the shared half: hand the object to its owner\n");
+    emit("static void conc_queue_merge(ConcObj* obj, int owner) {\n");
+    emit("    ConcMergeQueue* q = &CONC_MERGE[owner];\n");
+    emit("    ConcObj* head = atomic_load(&q->head);\n");
+    emit("    do {\n");
+    emit("        obj->merge_next = head;\n");
+    emit("    } while (!atomic_compare_exchange_weak(&q->head, &head, obj));\n");
+    emit("    // Pairs with conc_flush_deferred: either the owner's last drain sees\n");
+    emit("    // the entry or we see it gone\n");
+    emit("    if (atomic_load(&q->exited)) conc_merge_queued(owner);\n");
+    emit("}\n\n");
+
+    emit("// The owner pays a plain increment, everyone else an atomic one\n");
+    emit("void conc_inc_ref(ConcObj* obj) {\n");
+    emit("    if (!obj || obj->is_immutable) return;\n");
+    emit("    if (conc_owned(obj)) {\n");
+    emit("        obj->biased_rc++;\n");
+    emit("        return;\n");
+    emit("    }\n");
+    emit("    atomic_fetch_add_explicit(&obj->shared_rc, 1, memory_order_relaxed);\n");
+    emit("}\n\n");
+
+    emit("// Decrement; the last reference defers cleanup to a safe point\n");
+    emit("void conc_dec_ref(ConcObj* obj) {\n");
+    emit("    if (!obj || obj->is_immutable) return;\n");
+    emit("    if (conc_owned(obj)) {\n");
+    emit("        if (--obj->biased_rc == 0) conc_merge(obj, 0);\n");
+    emit("        return;\n");
+    emit("    }\n");
+    emit("    // One CAS both counts and claims the queue entry, so the owner cannot\n");
+    emit("    // merge (and free) between the two\n");
+    emit("    uint64_t old = atomic_load_explicit(&obj->shared_rc, memory_order_relaxed);\n");
+    emit("    uint64_t next;\n");
+    emit("    do {\n");
+    emit("        next = old - 1;\n");
+    emit("        // Below zero: the owner holds what is left, and must merge to see it go\n");
+    emit("        if (!(old & CONC_RC_MERGED) && CONC_RC_COUNT(old) <= 0) next |= CONC_RC_QUEUED;\n");
+    emit("    } while (!atomic_compare_exchange_weak_explicit(&obj->shared_rc, &old, next,\n");
+    emit("                                                    memory_order_acq_rel, memory_order_relaxed));\n");
+    emit("    if (old & CONC_RC_MERGED) {\n");
+    emit("        if (CONC_RC_COUNT(old) == 1) conc_queue_free(obj);\n");
+    emit("    } else if ((next & CONC_RC_QUEUED) && !(old & CONC_RC_QUEUED)) {\n");
+    emit("        conc_queue_merge(obj, atomic_load_explicit(&obj->owner_thread, memory_order_relaxed));\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Free up to max_count objects queued by this thread\n");
+    emit("int conc_process_deferred(int max_count) {\n");
+    emit("    int freed = 0;\n");
+    emit("    while (CONC_FREE_LEN > 0 && freed < max_count) {\n");
+    emit("        ConcObj* obj = CONC_FREE_QUEUE[--CONC_FREE_LEN];\n");
+    emit("        if (obj->is_pair) {\n");
+    emit("            conc_dec_ref(obj->a);\n");
+    emit("            conc_dec_ref(obj->b);\n");
+    emit("        }\n");
+    emit("        free(obj);\n");
+    emit("        freed++;\n");
+    emit("    }\n");
+    emit("    return freed;\n");
+    emit("}\n\n");
+
+    emit("// Safe point: merges asked of this thread, then a bounded share of its\n");
+    emit("// deferred frees\n");
+    emit("void conc_safe_point(void) {\n");
+    emit("    if (THREAD_ID < CONC_MAX_THREADS &&\n");
+    emit("        atomic_load_explicit(&CONC_MERGE[THREAD_ID].head, memory_order_relaxed)) {\n");
+    emit("        conc_merge_queued(THREAD_ID);\n");
+    emit("    }\n");
+    emit("    if (CONC_FREE_LEN > 0) conc_process_deferred(CONC_FREE_BATCH);\n");
+    emit("}\n\n");
+
+    emit("// Free everything this thread has queued (thread exit, program end).\n");
+    emit("// Merges queued for this thread from now on are done by whoever queues\n");
+    emit("void conc_flush_deferred(void) {\n");
+    emit("    if (THREAD_ID < CONC_MAX_THREADS) {\n");
+    emit("        atomic_store(&CONC_MERGE[THREAD_ID].exited, 1);\n");
+    emit("        conc_merge_queued(THREAD_ID);\n");
+    emit("    }\n");
+    emit("    while (CONC_FREE_LEN > 0) conc_process_deferred(CONC_FREE_BATCH);\n");
+    emit("    free(CONC_FREE_QUEUE);\n");
+    emit("    CONC_FREE_QUEUE = NULL;\n");
+    emit("    CONC_FREE_CAP = 0;\n");
+    emit("}\n");
 
     // Concurrent allocator
-    printf("// Allocate concurrent object\n");
-    printf("ConcObj* conc_mk_int(long val) {\n");
-    printf("    ConcObj* obj = malloc(sizeof(ConcObj));\n");
-    printf("    if (!obj) return NULL;\n");
-    printf("    atomic_init(&obj->rc, 1);\n");
-    printf("    obj->owner_thread = THREAD_ID;\n");
-    printf("    obj->is_immutable = 0;\n");
-    printf("    obj->is_pair = 0;\n");
-    printf("    obj->i = val;\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
-
-    printf("ConcObj* conc_mk_pair(ConcObj* a, ConcObj* b) {\n");
-    printf("    ConcObj* obj = malloc(sizeof(ConcObj));\n");
-    printf("    if (!obj) return NULL;\n");
-    printf("    atomic_init(&obj->rc, 1);\n");
-    printf("    obj->owner_thread = THREAD_ID;\n");
-    printf("    obj->is_immutable = 0;\n");
-    printf("    obj->is_pair = 1;\n");
-    printf("    obj->a = a;\n");
-    printf("    obj->b = b;\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
-
-    // Channel for ownership transfer
-    printf("// Channel for ownership transfer between threads\n");
-    printf("typedef struct MsgChannel {\n");
-    printf("    void** buffer;\n");
-    printf("    int capacity;\n");
-    printf("    _Atomic int head;\n");
-    printf("    _Atomic int tail;\n");
-    printf("    _Atomic int closed;\n");
-    printf("    pthread_mutex_t mutex;\n");
-    printf("    pthread_cond_t not_empty;\n");
-    printf("    pthread_cond_t not_full;\n");
-    printf("} MsgChannel;\n\n");
-
-    // Create channel
-    printf("// Create message channel\n");
-    printf("MsgChannel* channel_create(int capacity) {\n");
-    printf("    if (capacity <= 0) return NULL;  // Require positive capacity\n");
-    printf("    MsgChannel* ch = malloc(sizeof(MsgChannel));\n");
-    printf("    if (!ch) return NULL;\n");
-    printf("    ch->buffer = malloc(capacity * sizeof(void*));\n");
-    printf("    if (!ch->buffer) { free(ch); return NULL; }\n");
-    printf("    ch->capacity = capacity;\n");
-    printf("    atomic_init(&ch->head, 0);\n");
-    printf("    atomic_init(&ch->tail, 0);\n");
-    printf("    atomic_init(&ch->closed, 0);\n");
-    printf("    pthread_mutex_init(&ch->mutex, NULL);\n");
-    printf("    pthread_cond_init(&ch->not_empty, NULL);\n");
-    printf("    pthread_cond_init(&ch->not_full, NULL);\n");
-    printf("    return ch;\n");
-    printf("}\n\n");
-
-    // Send with ownership transfer
-    printf("// Send message (transfers ownership, increments RC for safe sender cleanup)\n");
-    printf("int channel_send(MsgChannel* ch, ConcObj* obj) {\n");
-    printf("    if (!ch || !obj) return -1;\n");
-    printf("    if (atomic_load(&ch->closed)) return -1;\n");
-    printf("    pthread_mutex_lock(&ch->mutex);\n");
-    printf("    int tail = atomic_load(&ch->tail);\n");
-    printf("    int head = atomic_load(&ch->head);\n");
-    printf("    while ((tail + 1) %% ch->capacity == head) {\n");
-    printf("        pthread_cond_wait(&ch->not_full, &ch->mutex);\n");
-    printf("        if (atomic_load(&ch->closed)) {\n");
-    printf("            pthread_mutex_unlock(&ch->mutex);\n");
-    printf("            return -1;\n");
-    printf("        }\n");
-    printf("        tail = atomic_load(&ch->tail);\n");
-    printf("        head = atomic_load(&ch->head);\n");
-    printf("    }\n");
-    printf("    // Increment RC so sender can safely dec_ref after send\n");
-    printf("    atomic_fetch_add(&obj->rc, 1);\n");
-    printf("    obj->owner_thread = -1;  // Mark as in-transit\n");
-    printf("    ch->buffer[tail] = obj;\n");
-    printf("    atomic_store(&ch->tail, (tail + 1) %% ch->capacity);\n");
-    printf("    pthread_cond_signal(&ch->not_empty);\n");
-    printf("    pthread_mutex_unlock(&ch->mutex);\n");
-    printf("    return 0;\n");
-    printf("}\n\n");
-
-    // Receive with ownership transfer
-    printf("// Receive message (receives ownership)\n");
-    printf("ConcObj* channel_recv(MsgChannel* ch) {\n");
-    printf("    if (!ch) return NULL;\n");
-    printf("    pthread_mutex_lock(&ch->mutex);\n");
-    printf("    int head = atomic_load(&ch->head);\n");
-    printf("    int tail = atomic_load(&ch->tail);\n");
-    printf("    while (head == tail) {\n");
-    printf("        if (atomic_load(&ch->closed)) {\n");
-    printf("            pthread_mutex_unlock(&ch->mutex);\n");
-    printf("            return NULL;\n");
-    printf("        }\n");
-    printf("        pthread_cond_wait(&ch->not_empty, &ch->mutex);\n");
-    printf("        head = atomic_load(&ch->head);\n");
-    printf("        tail = atomic_load(&ch->tail);\n");
-    printf("    }\n");
-    printf("    ConcObj* obj = ch->buffer[head];\n");
-    printf("    // Take ownership: receiver becomes owner\n");
-    printf("    obj->owner_thread = THREAD_ID;\n");
-    printf("    atomic_store(&ch->head, (head + 1) %% ch->capacity);\n");
-    printf("    pthread_cond_signal(&ch->not_full);\n");
-    printf("    pthread_mutex_unlock(&ch->mutex);\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
-
-    // Close channel
-    printf("// Close channel\n");
-    printf("void channel_close(MsgChannel* ch) {\n");
-    printf("    if (!ch) return;\n");
-    printf("    atomic_store(&ch->closed, 1);\n");
-    printf("    pthread_cond_broadcast(&ch->not_empty);\n");
-    printf("    pthread_cond_broadcast(&ch->not_full);\n");
-    printf("}\n\n");
-
-    // Destroy channel
-    printf("// Destroy channel\n");
-    printf("void channel_destroy(MsgChannel* ch) {\n");
-    printf("    if (!ch) return;\n");
-    printf("    pthread_mutex_destroy(&ch->mutex);\n");
-    printf("    pthread_cond_destroy(&ch->not_empty);\n");
-    printf("    pthread_cond_destroy(&ch->not_full);\n");
-    printf("    free(ch->buffer);\n");
-    printf("    free(ch);\n");
-    printf("}\n\n");
+    emit("// Allocate concurrent object, biased to this thread\n");
+    emit("static ConcObj* conc_alloc(int is_pair) {\n");
+    emit("    ConcObj* obj = malloc(sizeof(ConcObj));\n");
+    emit("    if (!obj) return NULL;\n");
+    emit("    if (THREAD_ID < CONC_MAX_THREADS) {\n");
+    emit("        obj->biased_rc = 1;\n");
+    emit("        atomic_init(&obj->shared_rc, CONC_RC_ZERO);\n");
+    emit("        atomic_init(&obj->owner_thread, THREAD_ID);\n");
+    emit("    } else {\n");
+    emit("        obj->biased_rc = 0;\n");
+    emit("        atomic_init(&obj->shared_rc, CONC_RC_MERGED | (CONC_RC_ZERO + 1));\n");
+    emit("        atomic_init(&obj->owner_thread, -1);\n");
+    emit("    }\n");
+    emit("    obj->is_immutable = 0;\n");
+    emit("    obj->is_pair = is_pair;\n");
+    emit("    obj->merge_next = NULL;\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
+
+    emit("ConcObj* conc_mk_int(long val) {\n");
+    emit("    ConcObj* obj = conc_alloc(0);\n");
+    emit("    if (!obj) return NULL;\n");
+    emit("    obj->i = val;\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
+
+    emit("ConcObj* conc_mk_pair(ConcObj* a, ConcObj* b) {\n");
+    emit("    ConcObj* obj = conc_alloc(1);\n");
+    emit("    if (!obj) return NULL;\n");
+    emit("    obj->a = a;\n");
+    emit("    obj->b = b;\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
+
+    // Channel for ownership transfer (lock-free ring)
+    emit("// Channel for ownership transfer between threads: a bounded lock-free\n");
+    emit("// MPMC queue (Vyukov). Every slot carries a sequence number saying whose\n");
+    emit("// turn it is, so producers and consumers each claim a position with one\n");
+    emit("// CAS and never share a lock. Channels with one producer and one consumer\n");
+    emit("// (channel_create_spsc) skip the CAS and the sequence numbers. Blocked\n");
+    emit("// sides spin briefly, then sleep; the mutex is only touched when someone\n");
+    emit("// sleeps.\n");
+    emit("#define CHAN_SPIN 64\n\n");
+
+    emit("typedef struct ChanSlot {\n");
+    emit("    _Atomic size_t seq;\n");
+    emit("    void* data;\n");
+    emit("} ChanSlot;\n\n");
+
+    emit("typedef struct MsgChannel {\n");
+    emit("    ChanSlot* slots;\n");
+    emit("    size_t mask;                  // Capacity - 1 (a power of two)\n");
+    emit("    int capacity;\n");
+    emit("    int spsc;                     // One producer, one consumer\n");
+    emit("    char pad0[64];\n");
+    emit("    _Atomic size_t tail;          // Next position to fill\n");
+    emit("    size_t cached_head;           // SPSC producer's view of head\n");
+    emit("    char pad1[64];\n");
+    emit("    _Atomic size_t head;          // Next position to take\n");
+    emit("    size_t cached_tail;           // SPSC consumer's view of tail\n");
+    emit("    char pad2[64];\n");
+    emit("    _Atomic int closed;\n");
+    emit("    _Atomic int send_sleepers;\n");
+    emit("    _Atomic int recv_sleepers;\n");
+    emit("    pthread_mutex_t mutex;\n");
+    emit("    pthread_cond_t not_empty;\n");
+    emit("    pthread_cond_t not_full;\n");
+    emit("} MsgChannel;\n\n");
+
+    emit("static MsgChannel* chan_new(int capacity, int spsc) {\n");
+    emit("    if (capacity <= 0) return NULL;  // Require positive capacity\n");
+    emit("    if (capacity > (1 << 30)) return NULL;\n");
+    emit("    size_t cap = 1;\n");
+    emit("    while (cap < (size_t)capacity) cap <<= 1;\n");
+    emit("    MsgChannel* ch = malloc(sizeof(MsgChannel));\n");
+    emit("    if (!ch) return NULL;\n");
+    emit("    ch->slots = malloc(cap * sizeof(ChanSlot));\n");
+    emit("    if (!ch->slots) { free(ch); return NULL; }\n");
+    emit("    for (size_t i = 0; i < cap; i++) {\n");
+    emit("        atomic_init(&ch->slots[i].seq, i);\n");
+    emit("        ch->slots[i].data = NULL;\n");
+    emit("    }\n");
+    emit("    ch->mask = cap - 1;\n");
+    emit("    ch->capacity = (int)cap;\n");
+    emit("    ch->spsc = spsc;\n");
+    emit("    atomic_init(&ch->tail, 0);\n");
+    emit("    atomic_init(&ch->head, 0);\n");
+    emit("    ch->cached_head = 0;\n");
+    emit("    ch->cached_tail = 0;\n");
+    emit("    atomic_init(&ch->closed, 0);\n");
+    emit("    atomic_init(&ch->send_sleepers, 0);\n");
+    emit("    atomic_init(&ch->recv_sleepers, 0);\n");
+    emit("    pthread_mutex_init(&ch->mutex, NULL);\n");
+    emit("    pthread_cond_init(&ch->not_empty, NULL);\n");
+    emit("    pthread_cond_init(&ch->not_full, NULL);\n");
+    emit("    return ch;\n");
+    emit("}\n\n");
+
+    emit("// Create message channel (capacity rounds up to a power of two)\n");
+    emit("MsgChannel* channel_create(int capacity) {\n");
+    emit("    return chan_new(capacity, 0);\n");
+    emit("}\n\n");
+
+    emit("// Create a channel only one thread sends on and only one receives from\n");
+    emit("MsgChannel* channel_create_spsc(int capacity) {\n");
+    emit("    return chan_new(capacity, 1);\n");
+    emit("}\n\n");
+
+    emit("// Enqueue without blocking; 0 if full\n");
+    emit("static int chan_try_push(MsgChannel* ch, void* data) {\n");
+    emit("    if (ch->spsc) {\n");
+    emit("        size_t pos = atomic_load_explicit(&ch->tail, memory_order_relaxed);\n");
+    emit("        if (pos - ch->cached_head > ch->mask) {\n");
+    emit("            ch->cached_head = atomic_load_explicit(&ch->head, memory_order_acquire);\n");
+    emit("            if (pos - ch->cached_head > ch->mask) return 0;\n");
+    emit("        }\n");
+    emit("        ch->slots[pos & ch->mask].data = data;\n");
+    emit("        atomic_store_explicit(&ch->tail, pos + 1, memory_order_release);\n");
+    emit("        return 1;\n");
+    emit("    }\n");
+    emit("    size_t pos = atomic_load_explicit(&ch->tail, memory_order_relaxed);\n");
+    emit("    for (;;) {\n");
+    emit("        ChanSlot* slot = &ch->slots[pos & ch->mask];\n");
+    emit("        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);\n");
+    emit("        intptr_t dif = (intptr_t)seq - (intptr_t)pos;\n");
+    emit("        if (dif == 0) {\n");
+    emit("            if (atomic_compare_exchange_weak_explicit(&ch->tail, &pos, pos + 1,\n");
+    emit("                                                      memory_order_relaxed, memory_order_relaxed)) {\n");
+    emit("                slot->data = data;\n");
+    emit("                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);\n");
+    emit("                return 1;\n");
+    emit("            }\n");
+    emit("        } else if (dif < 0) {\n");
+    emit("            return 0;\n");
+    emit("        } else {\n");
+    emit("            pos = atomic_load_explicit(&ch->tail, memory_order_relaxed);\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Dequeue without blocking; NULL if empty\n");
+    emit("static void* chan_try_pop(MsgChannel* ch) {\n");
+    emit("    if (ch->spsc) {\n");
+    emit("        size_t pos = atomic_load_explicit(&ch->head, memory_order_relaxed);\n");
+    emit("        if (pos == ch->cached_tail) {\n");
+    emit("            ch->cached_tail = atomic_load_explicit(&ch->tail, memory_order_acquire);\n");
+    emit("            if (pos == ch->cached_tail) return NULL;\n");
+    emit("        }\n");
+    emit("        void* data = ch->slots[pos & ch->mask].data;\n");
+    emit("        atomic_store_explicit(&ch->head, pos + 1, memory_order_release);\n");
+    emit("        return data;\n");
+    emit("    }\n");
+    emit("    size_t pos = atomic_load_explicit(&ch->head, memory_order_relaxed);\n");
+    emit("    for (;;) {\n");
+    emit("        ChanSlot* slot = &ch->slots[pos & ch->mask];\n");
+    emit("        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);\n");
+    emit("        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);\n");
+    emit("        if (dif == 0) {\n");
+    emit("            if (atomic_compare_exchange_weak_explicit(&ch->head, &pos, pos + 1,\n");
+    emit("                                                      memory_order_relaxed, memory_order_relaxed)) {\n");
+    emit("                void* data = slot->data;\n");
+    emit("                atomic_store_explicit(&slot->seq, pos + ch->mask + 1, memory_order_release);\n");
+    emit("                return data;\n");
+    emit("            }\n");
+    emit("        } else if (dif < 0) {\n");
+    emit("            return NULL;\n");
+    emit("        } else {\n");
+    emit("            pos = atomic_load_explicit(&ch->head, memory_order_relaxed);\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("static int chan_can(MsgChannel* ch, int sending) {\n");
+    emit("    size_t tail = atomic_load(&ch->tail);\n");
+    emit("    size_t head = atomic_load(&ch->head);\n");
+    emit("    return sending ? tail - head <= ch->mask : tail != head;\n");
+    emit("}\n\n");
+
+    emit("// Wait until the channel may have room (sending) or data; 0 once closed\n");
+    emit("// (for a receiver: closed and drained)\n");
+    emit("static int chan_block(MsgChannel* ch, int sending) {\n");
+    emit("    for (int spin = 0; spin < CHAN_SPIN; spin++) {\n");
+    emit("        if (chan_can(ch, sending)) return 1;\n");
+    emit("        if (atomic_load(&ch->closed)) return !sending && chan_can(ch, 0);\n");
+    emit("        sched_yield();\n");
+    emit("    }\n");
+    emit("    _Atomic int* sleepers = sending ? &ch->send_sleepers : &ch->recv_sleepers;\n");
+    emit("    pthread_cond_t* cond = sending ? &ch->not_full : &ch->not_empty;\n");
+    emit("    pthread_mutex_lock(&ch->mutex);\n");
+    emit("    atomic_fetch_add(sleepers, 1);\n");
+    emit("    // Pairs with the fence in chan_wake: either the waker sees us asleep\n");
+    emit("    // or we see what it published\n");
+    emit("    atomic_thread_fence(memory_order_seq_cst);\n");
+    emit("    while (!chan_can(ch, sending) && !atomic_load(&ch->closed)) {\n");
+    emit("        pthread_cond_wait(cond, &ch->mutex);\n");
+    emit("    }\n");
+    emit("    atomic_fetch_sub(sleepers, 1);\n");
+    emit("    int ok = chan_can(ch, sending) && (!sending || !atomic_load(&ch->closed));\n");
+    emit("    pthread_mutex_unlock(&ch->mutex);\n");
+    emit("    return ok;\n");
+    emit("}\n\n");
+
+    emit("static void chan_wake(MsgChannel* ch, int senders) {\n");
+    emit("    atomic_thread_fence(memory_order_seq_cst);\n");
+    emit("    _Atomic int* sleepers = senders ? &ch->send_sleepers : &ch->recv_sleepers;\n");
+    emit("    if (atomic_load_explicit(sleepers, memory_order_relaxed) == 0) return;\n");
+    emit("    pthread_mutex_lock(&ch->mutex);\n");
+    emit("    pthread_cond_signal(senders ? &ch->not_full : &ch->not_empty);\n");
+    emit("    pthread_mutex_unlock(&ch->mutex);\n");
+    emit("}\n\n");
+
+    emit("// Send message (transfers ownership, increments RC for safe sender cleanup)\n");
+    emit("int channel_send(MsgChannel* ch, ConcObj* obj) {\n");
+    emit("    if (!ch || !obj) return -1;\n");
+    emit("    if (atomic_load(&ch->closed)) return -1;\n");
+    emit("    // Count the channel's reference so sender can safely dec_ref after send\n");
+    emit("    conc_inc_ref(obj);\n");
+    emit("    // Hand-off: the receiver's references will be shared ones, so the\n");
+    emit("    // sender gives up its bias now rather than have them queue merges\n");
+    emit("    if (!obj->is_immutable && conc_owned(obj)) conc_merge(obj, 0);\n");
+    emit("    while (!chan_try_push(ch, obj)) {\n");
+    emit("        if (!chan_block(ch, 1)) {\n");
+    emit("            conc_dec_ref(obj);\n");
+    emit("            return -1;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    chan_wake(ch, 0);\n");
+    emit("    return 0;\n");
+    emit("}\n\n");
+
+    emit("// Receive message (receives ownership); NULL once closed and drained.\n");
+    emit("// The object arrives unbiased and stays so: its count is atomic from here\n");
+    emit("ConcObj* channel_recv(MsgChannel* ch) {\n");
+    emit("    if (!ch) return NULL;\n");
+    emit("    ConcObj* obj;\n");
+    emit("    while (!(obj = chan_try_pop(ch))) {\n");
+    emit("        if (!chan_block(ch, 0)) return NULL;\n");
+    emit("    }\n");
+    emit("    chan_wake(ch, 1);\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
+
+    emit("// Close channel: blocked senders fail, receivers drain what is left\n");
+    emit("void channel_close(MsgChannel* ch) {\n");
+    emit("    if (!ch) return;\n");
+    emit("    atomic_store(&ch->closed, 1);\n");
+    emit("    pthread_mutex_lock(&ch->mutex);\n");
+    emit("    pthread_cond_broadcast(&ch->not_empty);\n");
+    emit("    pthread_cond_broadcast(&ch->not_full);\n");
+    emit("    pthread_mutex_unlock(&ch->mutex);\n");
+    emit("}\n\n");
+
+    emit("// Destroy channel\n");
+    emit("void channel_destroy(MsgChannel* ch) {\n");
+    emit("    if (!ch) return;\n");
+    emit("    pthread_mutex_destroy(&ch->mutex);\n");
+    emit("    pthread_cond_destroy(&ch->not_empty);\n");
+    emit("    pthread_cond_destroy(&ch->not_full);\n");
+    emit("    free(ch->slots);\n");
+    emit("    free(ch);\n");
+    emit("}\n");
 
     // Thread spawn helper
-    printf("// Thread spawn with ownership semantics\n");
-    printf("typedef struct SpawnArgs {\n");
-    printf("    void* (*fn)(void*);\n");
-    printf("    void* arg;\n");
-    printf("    int thread_id;\n");
-    printf("} SpawnArgs;\n\n");
-
-    printf("static int next_thread_id = 1;\n\n");
-
-    printf("void* thread_wrapper(void* args) {\n");
-    printf("    SpawnArgs* sa = (SpawnArgs*)args;\n");
-    printf("    THREAD_ID = sa->thread_id;\n");
-    printf("    void* result = sa->fn(sa->arg);\n");
-    printf("    free(sa);\n");
-    printf("    return result;\n");
-    printf("}\n\n");
-
-    printf("pthread_t spawn_thread(void* (*fn)(void*), void* arg) {\n");
-    printf("    SpawnArgs* sa = malloc(sizeof(SpawnArgs));\n");
-    printf("    if (!sa) return (pthread_t)0;\n");
-    printf("    sa->fn = fn;\n");
-    printf("    sa->arg = arg;\n");
-    printf("    sa->thread_id = next_thread_id++;\n");
-    printf("    pthread_t tid;\n");
-    printf("    if (pthread_create(&tid, NULL, thread_wrapper, sa) != 0) {\n");
-    printf("        free(sa);\n");
-    printf("        return (pthread_t)0;\n");
-    printf("    }\n");
-    printf("    return tid;\n");
-    printf("}\n\n");
+    emit("// Thread spawn with ownership semantics\n");
+    emit("typedef struct SpawnArgs {\n");
+    emit("    void* (*fn)(void*);\n");
+    emit("    void* arg;\n");
+    emit("    int thread_id;\n");
+    emit("} SpawnArgs;\n\n");
+
+    emit("static _Atomic int next_thread_id = 1;\n\n");
+
+    emit("void* thread_wrapper(void* args) {\n");
+    emit("    SpawnArgs* sa = (SpawnArgs*)args;\n");
+    emit("    THREAD_ID = sa->thread_id;\n");
+    emit("    void* result = sa->fn(sa->arg);\n");
+    emit("    conc_flush_deferred();\n");
+    emit("    free(sa);\n");
+    emit("    return result;\n");
+    emit("}\n\n");
+
+    emit("pthread_t spawn_thread(void* (*fn)(void*), void* arg) {\n");
+    emit("    SpawnArgs* sa = malloc(sizeof(SpawnArgs));\n");
+    emit("    if (!sa) return (pthread_t)0;\n");
+    emit("    sa->fn = fn;\n");
+    emit("    sa->arg = arg;\n");
+    emit("    sa->thread_id = atomic_fetch_add(&next_thread_id, 1);\n");
+    emit("    pthread_t tid;\n");
+    emit("    if (pthread_create(&tid, NULL, thread_wrapper, sa) != 0) {\n");
+    emit("        free(sa);\n");
+    emit("        return (pthread_t)0;\n");
+    emit("    }\n");
+    emit("    return tid;\n");
+    emit("}\n\n");
 
     // Freeze for immutable sharing
-    printf("// Freeze object for immutable sharing (no sync needed)\n");
-    printf("void conc_freeze(ConcObj* obj) {\n");
-    printf("    if (!obj) return;\n");
-    printf("    if (obj->is_immutable) return;\n");
-    printf("    obj->is_immutable = 1;\n");
-    printf("    obj->owner_thread = -1;  // Shared\n");
-    printf("    if (obj->is_pair) {\n");
-    printf("        conc_freeze(obj->a);\n");
-    printf("        conc_freeze(obj->b);\n");
-    printf("    }\n");
-    printf("}\n\n");
+    emit("// Freeze object for immutable sharing: once published read-only it is\n");
+    emit("// never counted again (no RC, no sync) and is released as a whole with\n");
+    emit("// conc_release_frozen when its readers are done\n");
+    emit("void conc_freeze(ConcObj* obj) {\n");
+    emit("    if (!obj) return;\n");
+    emit("    if (obj->is_immutable) return;\n");
+    emit("    obj->is_immutable = 1;\n");
+    emit("    atomic_store_explicit(&obj->owner_thread, -1, memory_order_relaxed);  // Shared\n");
+    emit("    if (obj->is_pair) {\n");
+    emit("        conc_freeze(obj->a);\n");
+    emit("        conc_freeze(obj->b);\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Free a frozen graph; shared nodes are freed once (marked, then swept)\n");
+    emit("void conc_release_frozen(ConcObj* obj) {\n");
+    emit("    if (!obj || obj->is_immutable != 1) return;\n");
+    emit("    size_t len = 0, cap = 64;\n");
+    emit("    ConcObj** seen = malloc(cap * sizeof(ConcObj*));\n");
+    emit("    if (!seen) return;\n");
+    emit("    obj->is_immutable = 2;\n");
+    emit("    seen[len++] = obj;\n");
+    emit("    for (size_t i = 0; i < len; i++) {\n");
+    emit("        ConcObj* o = seen[i];\n");
+    emit("        if (!o->is_pair) continue;\n");
+    emit("        ConcObj* kids[2] = { o->a, o->b };\n");
+    emit("        for (int k = 0; k < 2; k++) {\n");
+    emit("            ConcObj* c = kids[k];\n");
+    emit("            if (!c || c->is_immutable != 1) continue;\n");
+    emit("            if (len == cap) {\n");
+    emit("                ConcObj** grown = realloc(seen, cap * 2 * sizeof(ConcObj*));\n");
+    emit("                if (!grown) continue;  // OOM: leak the rest rather than crash\n");
+    emit("                seen = grown;\n");
+    emit("                cap *= 2;\n");
+    emit("            }\n");
+    emit("            c->is_immutable = 2;\n");
+    emit("            seen[len++] = c;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    for (size_t i = 0; i < len; i++) free(seen[i]);\n");
+    emit("    free(seen);\n");
+    emit("}\n\n");
 }
 
 // Generate atomic RC operations
@@ -56,6 +56,11 @@ OwnershipClass analyze_ownership(Value* expr);
 // Detect thread spawn points
 int is_spawn_point(Value* expr);
 
+// Whether everything body does with the channel bound to chan is one
+// send site and one receive site, each run by a single thread; such a
+// channel can be made with the runtime's channel_create_spsc
+int channel_is_spsc(Value* chan, Value* body);
+
 // Generate concurrency runtime
 void gen_concurrent_runtime(void);
 
@@ -81,7 +81,9 @@ ConstraintObj* constraint_alloc(ConstraintContext* ctx, void* data,
     obj->owner = owner;
     obj->constraint_count = 0;
     obj->freed = false;
+#ifndef CONSTRAINT_RELEASE
     obj->source_count = 0;
+#endif
 
     /* Add to context if provided */
     if (ctx) {
@@ -111,15 +113,19 @@ ConstraintRef* constraint_add(ConstraintObj* obj, const char* source) {
     if (!ref) return NULL;
 
     ref->target = obj;
-    ref->source = source;
     ref->released = false;
 
     obj->constraint_count++;
 
+#ifndef CONSTRAINT_RELEASE
     /* Track source for debugging */
+    ref->source = source;
     if (obj->source_count < MAX_CONSTRAINT_SOURCES) {
         obj->constraint_sources[obj->source_count++] = source;
     }
+#else
+    (void)source;
+#endif
 
     return ref;
 }
@@ -137,6 +143,7 @@ ConstraintError constraint_release(ConstraintRef* ref) {
     ref->target->constraint_count--;
     ref->released = true;
 
+#ifndef CONSTRAINT_RELEASE
     /* Remove from sources list */
     for (int i = 0; i < ref->target->source_count; i++) {
         if (ref->target->constraint_sources[i] == ref->source) {
@@ -148,6 +155,7 @@ ConstraintError constraint_release(ConstraintRef* ref) {
             break;
         }
     }
+#endif
 
     return CONSTRAINT_OK;
 }
@@ -173,6 +181,7 @@ ConstraintError constraint_free(ConstraintContext* ctx, ConstraintObj* obj) {
         if (ctx) {
             add_violation(ctx, msg);
 
+#ifndef CONSTRAINT_RELEASE
             if (ctx->assert_on_error) {
                 fprintf(stderr, "%s\n", msg);
                 fprintf(stderr, "  Constraint sources:\n");
@@ -181,6 +190,7 @@ ConstraintError constraint_free(ConstraintContext* ctx, ConstraintObj* obj) {
                 }
                 abort();
             }
+#endif
         }
 
         return CONSTRAINT_ERR_VIOLATION;
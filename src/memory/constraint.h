@@ -11,6 +11,11 @@
  *
  * This is primarily a DEBUG/DEVELOPMENT tool - catches errors at free time
  * rather than at dereference time.
+ *
+ * Release profile (-DCONSTRAINT_RELEASE, `make release`): objects and refs
+ * keep only the counter. Violations are still detected, counted and
+ * reported by constraint_free, but sources are not tracked and
+ * assert_on_error never aborts.
  */
 
 #ifndef CONSTRAINT_H
@@ -34,14 +39,18 @@ struct ConstraintObj {
     const char* owner;
     int32_t constraint_count;
     bool freed;
+#ifndef CONSTRAINT_RELEASE
     const char* constraint_sources[MAX_CONSTRAINT_SOURCES];
     int source_count;
+#endif
 };
 
 /* ConstraintRef - non-owning reference that constrains object lifetime */
 struct ConstraintRef {
     ConstraintObj* target;
+#ifndef CONSTRAINT_RELEASE
     const char* source;
+#endif
     bool released;
 };
 
@@ -1,35 +1,105 @@
 #include "deferred.h"
+#include "../util/emit.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define DEFERRED_INITIAL_CAP 64
+
+static size_t deferred_hash(void* p) {
+    uintptr_t x = (uintptr_t)p;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    return (size_t)((x >> 16) ^ x);
+}
+
+// Index slot holding obj, or the empty slot where it belongs
+static int deferred_slot(DeferredContext* ctx, void* obj) {
+    int mask = ctx->capacity * 2 - 1;
+    int i = (int)(deferred_hash(obj) & (size_t)mask);
+    while (ctx->index[i].obj && ctx->index[i].obj != obj) i = (i + 1) & mask;
+    return i;
+}
+
+// Empty slot i, moving later entries of the probe run back into the gap
+static void deferred_unindex(DeferredContext* ctx, int i) {
+    int mask = ctx->capacity * 2 - 1;
+    int j = i;
+    for (;;) {
+        ctx->index[i].obj = NULL;
+        for (;;) {
+            j = (j + 1) & mask;
+            if (!ctx->index[j].obj) return;
+            int home = (int)(deferred_hash(ctx->index[j].obj) & (size_t)mask);
+            // Keep j where it is if its home lies cyclically in (i, j]
+            if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;
+            break;
+        }
+        ctx->index[i] = ctx->index[j];
+        i = j;
+    }
+}
+
+// Double the ring (oldest entry moves to position 0) and rebuild the index
+static int deferred_grow(DeferredContext* ctx) {
+    if (ctx->capacity > INT_MAX / 4) return 0;
+    int cap = ctx->capacity * 2;
+    DeferredDec* ring = malloc((size_t)cap * sizeof(DeferredDec));
+    DeferredSlot* index = calloc((size_t)cap * 2, sizeof(DeferredSlot));
+    if (!ring || !index) {
+        free(ring);
+        free(index);
+        return 0;
+    }
+    for (int k = 0; k < ctx->pending_count; k++) {
+        ring[k] = ctx->ring[(ctx->head + k) & (ctx->capacity - 1)];
+    }
+    free(ctx->ring);
+    free(ctx->index);
+    ctx->ring = ring;
+    ctx->index = index;
+    ctx->capacity = cap;
+    ctx->head = 0;
+    for (int k = 0; k < ctx->pending_count; k++) {
+        int i = deferred_slot(ctx, ring[k].obj);
+        index[i].obj = ring[k].obj;
+        index[i].pos = k;
+    }
+    return 1;
+}
 
 // -- Context Management --
 
 DeferredContext* mk_deferred_context(int batch_size) {
     DeferredContext* ctx = malloc(sizeof(DeferredContext));
     if (!ctx) return NULL;
-    ctx->obj_lookup = hashmap_new();
-    if (!ctx->obj_lookup) {
+    ctx->ring = malloc(DEFERRED_INITIAL_CAP * sizeof(DeferredDec));
+    ctx->index = calloc(DEFERRED_INITIAL_CAP * 2, sizeof(DeferredSlot));
+    if (!ctx->ring || !ctx->index) {
+        free(ctx->ring);
+        free(ctx->index);
         free(ctx);
         return NULL;
     }
-    ctx->pending = NULL;
+    ctx->capacity = DEFERRED_INITIAL_CAP;
+    ctx->head = 0;
     ctx->pending_count = 0;
     ctx->batch_size = batch_size > 0 ? batch_size : 32;
+    ctx->trigger = ctx->batch_size;
+    ctx->pause_budget_ns = 0;
+    ctx->cost_ns = 0;
     ctx->total_deferred = 0;
     ctx->dropped_decrements = 0;
+    ctx->over_budget = 0;
+    ctx->backlog_forced = 0;
     return ctx;
 }
 
 void free_deferred_context(DeferredContext* ctx) {
     if (!ctx) return;
-    DeferredDec* d = ctx->pending;
-    while (d) {
-        DeferredDec* next = d->next;
-        free(d);
-        d = next;
-    }
-    if (ctx->obj_lookup) {
-        hashmap_free(ctx->obj_lookup);
-    }
+    free(ctx->ring);
+    free(ctx->index);
     free(ctx);
 }
 
@@ -38,189 +108,409 @@ void free_deferred_context(DeferredContext* ctx) {
 void defer_decrement(DeferredContext* ctx, void* obj) {
     if (!ctx || !obj) return;
 
-    // O(1) lookup using hash map
-    DeferredDec* d = (DeferredDec*)hashmap_get(ctx->obj_lookup, obj);
-    if (d) {
-        d->count++;
+    // O(1) lookup through the index
+    int i = deferred_slot(ctx, obj);
+    if (ctx->index[i].obj) {
+        ctx->ring[ctx->index[i].pos].count++;
         return;
     }
 
-    // Add new entry
-    d = malloc(sizeof(DeferredDec));
-    if (!d) {
-        ctx->dropped_decrements++;
-        return;  // Allocation failed
+    // Add new entry at the tail; the index stays at most half full
+    if (ctx->pending_count == ctx->capacity) {
+        if (!deferred_grow(ctx)) {
+            ctx->dropped_decrements++;
+            return;  // Allocation failed
+        }
+        i = deferred_slot(ctx, obj);
     }
-    d->obj = obj;
-    d->count = 1;
-    d->next = ctx->pending;
-    ctx->pending = d;
+    int pos = (ctx->head + ctx->pending_count) & (ctx->capacity - 1);
+    ctx->ring[pos].obj = obj;
+    ctx->ring[pos].count = 1;
+    ctx->index[i].obj = obj;
+    ctx->index[i].pos = pos;
     ctx->pending_count++;
     ctx->total_deferred++;
-
-    // Add to hash map for O(1) lookup
-    hashmap_put(ctx->obj_lookup, obj, d);
 }
 
 void process_deferred(DeferredContext* ctx, int max_count) {
-    if (!ctx || !ctx->pending) return;
+    if (!ctx) return;
 
     int processed = 0;
-    DeferredDec** prev = &ctx->pending;
-
-    while (*prev && processed < max_count) {
-        DeferredDec* d = *prev;
-
-        // Process one decrement for this object
-        d->count--;
+    int mask = ctx->capacity - 1;
+    while (ctx->pending_count > 0 && processed < max_count) {
+        // Process one decrement for the oldest entry
+        DeferredDec d = ctx->ring[ctx->head];
+        int i = deferred_slot(ctx, d.obj);
+        ctx->head = (ctx->head + 1) & mask;
+        ctx->pending_count--;
+        d.count--;
         processed++;
 
-        if (d->count <= 0) {
-            // Remove from hash map
-            hashmap_remove(ctx->obj_lookup, d->obj);
-            // Remove from list
-            *prev = d->next;
-            ctx->pending_count--;
-            // Note: Actual freeing of d->obj handled by caller
+        if (d.count <= 0) {
+            // Note: Actual freeing of d.obj handled by caller
             // This is just bookkeeping
-            free(d);
+            deferred_unindex(ctx, i);
         } else {
-            prev = &d->next;
+            // Still pending: back to the tail, after the others
+            int pos = (ctx->head + ctx->pending_count) & mask;
+            ctx->ring[pos] = d;
+            ctx->index[i].pos = pos;
+            ctx->pending_count++;
         }
     }
 }
 
 void flush_deferred(DeferredContext* ctx) {
-    while (ctx && ctx->pending) {
+    while (ctx && ctx->pending_count > 0) {
         process_deferred(ctx, ctx->batch_size);
     }
 }
 
 int should_process_deferred(DeferredContext* ctx) {
     if (!ctx) return 0;
-    return ctx->pending_count >= ctx->batch_size;
+    return ctx->pending_count >= ctx->trigger;
+}
+
+void deferred_set_pause_budget(DeferredContext* ctx, long ns) {
+    if (!ctx) return;
+    ctx->pause_budget_ns = ns > 0 ? ns : 0;
+    ctx->cost_ns = 0;
+    if (!ctx->pause_budget_ns) ctx->batch_size = ctx->trigger;
+}
+
+void deferred_adapt(DeferredContext* ctx, int processed, long pause_ns) {
+    if (!ctx || !ctx->pause_budget_ns || processed <= 0) return;
+
+    double cost = (double)pause_ns / processed;
+    ctx->cost_ns = ctx->cost_ns > 0 ? 0.75 * ctx->cost_ns + 0.25 * cost : cost;
+    // Decrements that fit in the budget at the current cost
+    double fit = ctx->cost_ns > 0 ? ctx->pause_budget_ns / ctx->cost_ns : DEFERRED_BATCH_MAX;
+
+    double batch = ctx->batch_size;
+    if (ctx->pending_count > DEFERRED_BACKLOG_LIMIT) {
+        // The backlog must stay bounded, even at the cost of longer pauses:
+        // the next batch takes it back down to the limit
+        double excess = ctx->pending_count - DEFERRED_BACKLOG_LIMIT;
+        if (batch < excess) batch = excess;
+        ctx->backlog_forced++;
+    } else if (pause_ns > ctx->pause_budget_ns) {
+        ctx->over_budget++;
+        batch = batch / 2 < fit ? batch / 2 : fit;
+    } else if (ctx->pending_count > ctx->batch_size) {
+        // Backlog building up: grow as far as the budget allows
+        batch = batch * 2 < fit ? batch * 2 : fit;
+    }
+    if (batch < DEFERRED_BATCH_MIN) batch = DEFERRED_BATCH_MIN;
+    if (batch > DEFERRED_BATCH_MAX) batch = DEFERRED_BATCH_MAX;
+    ctx->batch_size = (int)batch;
+}
+
+int deferred_pending_for(DeferredContext* ctx, void* obj) {
+    if (!ctx || !obj) return 0;
+    int i = deferred_slot(ctx, obj);
+    return ctx->index[i].obj ? ctx->ring[ctx->index[i].pos].count : 0;
 }
 
 // -- Code Generation --
 
 void gen_deferred_runtime(void) {
-    printf("\n// Phase 7: Deferred RC Fallback Runtime\n");
-    printf("// For mutable cycles that never freeze\n");
-    printf("// Bounded O(k) processing at safe points\n\n");
-
-    printf("typedef struct DeferredDec {\n");
-    printf("    Obj* obj;\n");
-    printf("    int count;\n");
-    printf("    struct DeferredDec* next;      // For linked list\n");
-    printf("    struct DeferredDec* hash_next; // For hash bucket chain\n");
-    printf("} DeferredDec;\n\n");
-
-    printf("#define DEFERRED_HASH_SIZE 256\n");
-    printf("DeferredDec* DEFERRED_HASH[DEFERRED_HASH_SIZE];\n");
-    printf("DeferredDec* DEFERRED_HEAD = NULL;\n");
-    printf("int DEFERRED_COUNT = 0;\n");
-    printf("#define DEFERRED_BATCH_SIZE 32\n\n");
-
-    printf("static size_t deferred_hash_ptr(void* p) {\n");
-    printf("    size_t x = (size_t)p;\n");
-    printf("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
-    printf("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
-    printf("    return (x >> 16) ^ x;\n");
-    printf("}\n\n");
-
-    printf("void defer_dec(Obj* obj) {\n");
-    printf("    if (!obj) return;\n");
-    printf("    size_t idx = deferred_hash_ptr(obj) %% DEFERRED_HASH_SIZE;\n");
-    printf("    DeferredDec* d = DEFERRED_HASH[idx];\n");
-    printf("    while (d) {\n");
-    printf("        if (d->obj == obj) { d->count++; return; }\n");
-    printf("        d = d->hash_next;\n");
-    printf("    }\n");
-    printf("    d = malloc(sizeof(DeferredDec));\n");
-    printf("    if (!d) {\n");
-    printf("        // OOM fallback: apply decrement immediately\n");
-    printf("        obj->mark--;\n");
-    printf("        if (obj->mark <= 0) {\n");
-    printf("            if (obj->is_pair) {\n");
-    printf("                if (obj->a) defer_dec(obj->a);\n");
-    printf("                if (obj->b) defer_dec(obj->b);\n");
-    printf("            }\n");
-    printf("            invalidate_weak_refs_for(obj);\n");
-    printf("            free(obj);\n");
-    printf("        }\n");
-    printf("        return;\n");
-    printf("    }\n");
-    printf("    d->obj = obj;\n");
-    printf("    d->count = 1;\n");
-    printf("    d->next = DEFERRED_HEAD;\n");
-    printf("    d->hash_next = DEFERRED_HASH[idx];\n");
-    printf("    DEFERRED_HEAD = d;\n");
-    printf("    DEFERRED_HASH[idx] = d;\n");
-    printf("    DEFERRED_COUNT++;\n");
-    printf("}\n\n");
-
-    printf("static void deferred_remove_from_hash(DeferredDec* d) {\n");
-    printf("    size_t idx = deferred_hash_ptr(d->obj) %% DEFERRED_HASH_SIZE;\n");
-    printf("    DeferredDec** hp = &DEFERRED_HASH[idx];\n");
-    printf("    while (*hp) {\n");
-    printf("        if (*hp == d) { *hp = d->hash_next; return; }\n");
-    printf("        hp = &(*hp)->hash_next;\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("void process_deferred_batch(int max_count) {\n");
-    printf("    int processed = 0;\n");
-    printf("    DeferredDec** prev = &DEFERRED_HEAD;\n");
-    printf("    while (*prev && processed < max_count) {\n");
-    printf("        DeferredDec* d = *prev;\n");
-    printf("        d->count--;\n");
-    printf("        processed++;\n");
-    printf("        if (d->count <= 0) {\n");
-    printf("            *prev = d->next;\n");
-    printf("            deferred_remove_from_hash(d);\n");
-    printf("            DEFERRED_COUNT--;\n");
-    printf("            // Apply actual decrement\n");
-    printf("            d->obj->mark--;\n");
-    printf("            if (d->obj->mark <= 0) {\n");
-    printf("                // Object is dead, defer children\n");
-    printf("                if (d->obj->is_pair) {\n");
-    printf("                    if (d->obj->a) defer_dec(d->obj->a);\n");
-    printf("                    if (d->obj->b) defer_dec(d->obj->b);\n");
-    printf("                }\n");
-    printf("                invalidate_weak_refs_for(d->obj);\n");
-    printf("                free(d->obj);\n");
-    printf("            }\n");
-    printf("            free(d);\n");
-    printf("        } else {\n");
-    printf("            prev = &d->next;\n");
-    printf("        }\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("// Safe point: process deferred if threshold reached\n");
-    printf("void safe_point() {\n");
-    printf("    if (DEFERRED_COUNT >= DEFERRED_BATCH_SIZE) {\n");
-    printf("        process_deferred_batch(DEFERRED_BATCH_SIZE);\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("// Flush all deferred at program end\n");
-    printf("void flush_all_deferred() {\n");
-    printf("    while (DEFERRED_HEAD) {\n");
-    printf("        process_deferred_batch(DEFERRED_BATCH_SIZE);\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("// Deferred release for cyclic structures\n");
-    printf("void deferred_release(Obj* obj) {\n");
-    printf("    if (!obj) return;\n");
-    printf("    // For cyclic structures, use deferred decrement\n");
-    printf("    defer_dec(obj);\n");
-    printf("    // Process if threshold reached\n");
-    printf("    safe_point();\n");
-    printf("}\n\n");
+    emit("\n// Phase 7: Deferred RC Fallback Runtime\n");
+    emit("// For mutable cycles that never freeze\n");
+    emit("// Bounded O(k) processing at safe points\n\n");
+
+    emit("#include <time.h>\n\n");
+
+    emit("typedef struct DeferredDec {\n");
+    emit("    Obj* obj;\n");
+    emit("    int count;\n");
+    emit("} DeferredDec;\n\n");
+
+    emit("typedef struct DeferredSlot {\n");
+    emit("    Obj* obj;      // NULL: empty\n");
+    emit("    int pos;       // Ring position of its entry\n");
+    emit("} DeferredSlot;\n\n");
+
+    emit("// Pending decrements: a growable ring (oldest at DEFERRED_HEAD) indexed\n");
+    emit("// by open addressing on the object address, at most half full. Neither\n");
+    emit("// defer_dec nor process_deferred_batch allocates once the ring is big\n");
+    emit("// enough for the program's backlog.\n");
+    emit("#define DEFERRED_INITIAL_CAP 256\n");
+    emit("static DeferredDec* DEFERRED_RING = NULL;\n");
+    emit("static DeferredSlot* DEFERRED_INDEX = NULL;\n");
+    emit("static int DEFERRED_CAP = 0;       // Ring size (power of two); index has twice as many slots\n");
+    emit("static int DEFERRED_HEAD = 0;\n");
+    emit("int DEFERRED_COUNT = 0;\n");
+    emit("#define DEFERRED_BATCH_SIZE 32\n\n");
+
+    emit("// Adaptive batching: with a pause budget (-DDEFERRED_PAUSE_NS=50000 or\n");
+    emit("// deferred_set_pause_budget), each safe point sizes its batch from the\n");
+    emit("// measured cost per decrement. Batches grow while the backlog builds and\n");
+    emit("// shrink when a pause misses the budget; past DEFERRED_BACKLOG_LIMIT\n");
+    emit("// pending entries they grow regardless, so the backlog stays bounded.\n");
+    emit("#ifndef DEFERRED_PAUSE_NS\n");
+    emit("#define DEFERRED_PAUSE_NS 0\n");
+    emit("#endif\n");
+    emit("#ifndef DEFERRED_BACKLOG_LIMIT\n");
+    emit("#define DEFERRED_BACKLOG_LIMIT %d\n", DEFERRED_BACKLOG_LIMIT);
+    emit("#endif\n");
+    emit("#define DEFERRED_BATCH_MIN %d\n", DEFERRED_BATCH_MIN);
+    emit("#define DEFERRED_BATCH_MAX %d\n\n", DEFERRED_BATCH_MAX);
+
+    emit("// What the controller decided (deferred_report prints it)\n");
+    emit("typedef struct DeferredStats {\n");
+    emit("    long budget_ns;        // 0: fixed DEFERRED_BATCH_SIZE\n");
+    emit("    int batch;             // Current batch size\n");
+    emit("    int batch_low;         // Smallest and largest batch chosen\n");
+    emit("    int batch_high;\n");
+    emit("    long safe_points;      // Batches run at safe points\n");
+    emit("    long over_budget;      // Pauses longer than the budget\n");
+    emit("    long backlog_forced;   // Batches grown past the budget by the backlog\n");
+    emit("    long max_pause_ns;\n");
+    emit("    int peak_backlog;\n");
+    emit("    double cost_ns;        // Smoothed cost of one decrement\n");
+    emit("} DeferredStats;\n\n");
+
+    emit("static DeferredStats DEFERRED_STATS = {\n");
+    emit("    DEFERRED_PAUSE_NS, DEFERRED_BATCH_SIZE, DEFERRED_BATCH_SIZE, DEFERRED_BATCH_SIZE, 0, 0, 0, 0, 0, 0\n");
+    emit("};\n\n");
+
+    emit("static size_t deferred_hash_ptr(void* p) {\n");
+    emit("    size_t x = (size_t)p;\n");
+    emit("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
+    emit("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
+    emit("    return (x >> 16) ^ x;\n");
+    emit("}\n\n");
+
+    emit("// Index slot holding obj, or the empty slot where it belongs\n");
+    emit("static int deferred_slot(Obj* obj) {\n");
+    emit("    int mask = DEFERRED_CAP * 2 - 1;\n");
+    emit("    int i = (int)(deferred_hash_ptr(obj) & (size_t)mask);\n");
+    emit("    while (DEFERRED_INDEX[i].obj && DEFERRED_INDEX[i].obj != obj) i = (i + 1) & mask;\n");
+    emit("    return i;\n");
+    emit("}\n\n");
+
+    emit("// Empty slot i, moving later entries of the probe run back into the gap\n");
+    emit("static void deferred_unindex(int i) {\n");
+    emit("    int mask = DEFERRED_CAP * 2 - 1;\n");
+    emit("    int j = i;\n");
+    emit("    for (;;) {\n");
+    emit("        DEFERRED_INDEX[i].obj = NULL;\n");
+    emit("        for (;;) {\n");
+    emit("            j = (j + 1) & mask;\n");
+    emit("            if (!DEFERRED_INDEX[j].obj) return;\n");
+    emit("            int home = (int)(deferred_hash_ptr(DEFERRED_INDEX[j].obj) & (size_t)mask);\n");
+    emit("            // Keep j where it is if its home lies cyclically in (i, j]\n");
+    emit("            if (i <= j ? (i < home && home <= j) : (i < home || home <= j)) continue;\n");
+    emit("            break;\n");
+    emit("        }\n");
+    emit("        DEFERRED_INDEX[i] = DEFERRED_INDEX[j];\n");
+    emit("        i = j;\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Double the ring (oldest entry moves to position 0) and rebuild the index\n");
+    emit("static int deferred_grow(void) {\n");
+    emit("    if (DEFERRED_CAP > INT_MAX / 4) return 0;\n");
+    emit("    int cap = DEFERRED_CAP ? DEFERRED_CAP * 2 : DEFERRED_INITIAL_CAP;\n");
+    emit("    DeferredDec* ring = malloc((size_t)cap * sizeof(DeferredDec));\n");
+    emit("    DeferredSlot* index = calloc((size_t)cap * 2, sizeof(DeferredSlot));\n");
+    emit("    if (!ring || !index) {\n");
+    emit("        free(ring);\n");
+    emit("        free(index);\n");
+    emit("        return 0;\n");
+    emit("    }\n");
+    emit("    for (int k = 0; k < DEFERRED_COUNT; k++) {\n");
+    emit("        ring[k] = DEFERRED_RING[(DEFERRED_HEAD + k) & (DEFERRED_CAP - 1)];\n");
+    emit("    }\n");
+    emit("    free(DEFERRED_RING);\n");
+    emit("    free(DEFERRED_INDEX);\n");
+    emit("    DEFERRED_RING = ring;\n");
+    emit("    DEFERRED_INDEX = index;\n");
+    emit("    DEFERRED_CAP = cap;\n");
+    emit("    DEFERRED_HEAD = 0;\n");
+    emit("    for (int k = 0; k < DEFERRED_COUNT; k++) {\n");
+    emit("        int i = deferred_slot(ring[k].obj);\n");
+    emit("        index[i].obj = ring[k].obj;\n");
+    emit("        index[i].pos = k;\n");
+    emit("    }\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("void defer_dec(Obj* obj);\n\n");
+
+    emit("// Drop one reference now; children of a dead object are deferred\n");
+    emit("static void deferred_apply(Obj* obj) {\n");
+    emit("    OBJ_SET_RC(obj, OBJ_RC(obj) - 1);\n");
+    emit("    if (OBJ_RC(obj) <= 0) {\n");
+    emit("        if (OBJ_IS_PAIR(obj)) {\n");
+    emit("            if (obj->a) defer_dec(obj->a);\n");
+    emit("            if (obj->b) defer_dec(obj->b);\n");
+    emit("        }\n");
+    emit("        OBJ_FREE_PAYLOAD(obj);\n");
+    emit("        invalidate_weak_refs_for(obj);\n");
+    emit("        STAT_INC(free_deferred);\n");
+    emit("        slab_free(obj, sizeof(Obj));\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("void defer_dec(Obj* obj) {\n");
+    emit("    if (!obj) return;\n");
+    emit("    int i = 0;\n");
+    emit("    if (DEFERRED_CAP) {\n");
+    emit("        i = deferred_slot(obj);\n");
+    emit("        if (DEFERRED_INDEX[i].obj) {\n");
+    emit("            DEFERRED_RING[DEFERRED_INDEX[i].pos].count++;\n");
+    emit("            return;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    if (DEFERRED_COUNT == DEFERRED_CAP) {\n");
+    emit("        if (!deferred_grow()) {\n");
+    emit("            // OOM fallback: apply decrement immediately\n");
+    emit("            deferred_apply(obj);\n");
+    emit("            return;\n");
+    emit("        }\n");
+    emit("        i = deferred_slot(obj);\n");
+    emit("    }\n");
+    emit("    int pos = (DEFERRED_HEAD + DEFERRED_COUNT) & (DEFERRED_CAP - 1);\n");
+    emit("    DEFERRED_RING[pos].obj = obj;\n");
+    emit("    DEFERRED_RING[pos].count = 1;\n");
+    emit("    DEFERRED_INDEX[i].obj = obj;\n");
+    emit("    DEFERRED_INDEX[i].pos = pos;\n");
+    emit("    DEFERRED_COUNT++;\n");
+    emit("    STAT_MAX(deferred_peak, DEFERRED_COUNT);\n");
+    emit("}\n\n");
+
+    emit("// Apply up to max_count decrements, oldest entries first. An entry with\n");
+    emit("// decrements left goes back to the tail; one whose object died is done\n");
+    emit("int process_deferred_batch(int max_count) {\n");
+    emit("    int processed = 0;\n");
+    emit("    while (DEFERRED_COUNT > 0 && processed < max_count) {\n");
+    emit("        DeferredDec d = DEFERRED_RING[DEFERRED_HEAD];\n");
+    emit("        int i = deferred_slot(d.obj);\n");
+    emit("        DEFERRED_HEAD = (DEFERRED_HEAD + 1) & (DEFERRED_CAP - 1);\n");
+    emit("        DEFERRED_COUNT--;\n");
+    emit("        d.count--;\n");
+    emit("        processed++;\n");
+    emit("        // Decrements left and the object outlives this one: back to the tail\n");
+    emit("        if (d.count > 0 && OBJ_RC(d.obj) > 1) {\n");
+    emit("            int pos = (DEFERRED_HEAD + DEFERRED_COUNT) & (DEFERRED_CAP - 1);\n");
+    emit("            DEFERRED_RING[pos] = d;\n");
+    emit("            DEFERRED_INDEX[i].pos = pos;\n");
+    emit("            DEFERRED_COUNT++;\n");
+    emit("            OBJ_SET_RC(d.obj, OBJ_RC(d.obj) - 1);\n");
+    emit("            continue;\n");
+    emit("        }\n");
+    emit("        // Unindexed first: freeing the object may defer its children\n");
+    emit("        deferred_unindex(i);\n");
+    emit("        deferred_apply(d.obj);\n");
+    emit("    }\n");
+    emit("    return processed;\n");
+    emit("}\n\n");
+
+    emit("static long deferred_now_ns(void) {\n");
+    emit("    struct timespec t;\n");
+    emit("    clock_gettime(CLOCK_MONOTONIC, &t);\n");
+    emit("    return (long)t.tv_sec * 1000000000L + t.tv_nsec;\n");
+    emit("}\n\n");
+
+    emit("// Resize the batch after one of `processed` decrements that took pause_ns\n");
+    emit("static void deferred_adapt(int processed, long pause_ns) {\n");
+    emit("    DeferredStats* s = &DEFERRED_STATS;\n");
+    emit("    if (processed <= 0) return;\n\n");
+
+    emit("    double cost = (double)pause_ns / processed;\n");
+    emit("    s->cost_ns = s->cost_ns > 0 ? 0.75 * s->cost_ns + 0.25 * cost : cost;\n");
+    emit("    // Decrements that fit in the budget at the current cost\n");
+    emit("    double fit = s->cost_ns > 0 ? s->budget_ns / s->cost_ns : DEFERRED_BATCH_MAX;\n\n");
+
+    emit("    double batch = s->batch;\n");
+    emit("    if (DEFERRED_COUNT > DEFERRED_BACKLOG_LIMIT) {\n");
+    emit("        // The backlog must stay bounded, even at the cost of longer pauses:\n");
+    emit("        // the next batch takes it back down to the limit\n");
+    emit("        double excess = DEFERRED_COUNT - DEFERRED_BACKLOG_LIMIT;\n");
+    emit("        if (batch < excess) batch = excess;\n");
+    emit("        s->backlog_forced++;\n");
+    emit("    } else if (pause_ns > s->budget_ns) {\n");
+    emit("        s->over_budget++;\n");
+    emit("        batch = batch / 2 < fit ? batch / 2 : fit;\n");
+    emit("    } else if (DEFERRED_COUNT > s->batch) {\n");
+    emit("        // Backlog building up: grow as far as the budget allows\n");
+    emit("        batch = batch * 2 < fit ? batch * 2 : fit;\n");
+    emit("    }\n");
+    emit("    if (batch < DEFERRED_BATCH_MIN) batch = DEFERRED_BATCH_MIN;\n");
+    emit("    if (batch > DEFERRED_BATCH_MAX) batch = DEFERRED_BATCH_MAX;\n");
+    emit("    s->batch = (int)batch;\n");
+    emit("    if (s->batch < s->batch_low) s->batch_low = s->batch;\n");
+    emit("    if (s->batch > s->batch_high) s->batch_high = s->batch;\n");
+    emit("}\n\n");
+
+    emit("// Pause budget per safe point in nanoseconds; 0 goes back to fixed batches\n");
+    emit("void deferred_set_pause_budget(long ns) {\n");
+    emit("    DEFERRED_STATS.budget_ns = ns > 0 ? ns : 0;\n");
+    emit("    DEFERRED_STATS.cost_ns = 0;\n");
+    emit("    if (!DEFERRED_STATS.budget_ns) DEFERRED_STATS.batch = DEFERRED_BATCH_SIZE;\n");
+    emit("}\n\n");
+
+    emit("void deferred_report(FILE* out) {\n");
+    emit("    DeferredStats* s = &DEFERRED_STATS;\n");
+    emit("    fprintf(out, \"deferred: budget %%ld ns, batch %%d (%%d..%%d), %%ld safe points, \"\n");
+    emit("            \"max pause %%ld ns, %%ld over budget, %%ld grown by backlog, peak backlog %%d\\n\",\n");
+    emit("            s->budget_ns, s->batch, s->batch_low, s->batch_high, s->safe_points,\n");
+    emit("            s->max_pause_ns, s->over_budget, s->backlog_forced, s->peak_backlog);\n");
+    emit("}\n\n");
+
+    emit("// One batch: DEFERRED_BATCH_SIZE, or what the pause budget allows\n");
+    emit("static void safe_point_batch(void) {\n");
+    emit("    if (!DEFERRED_STATS.budget_ns) {\n");
+    emit("        process_deferred_batch(DEFERRED_BATCH_SIZE);\n");
+    emit("        return;\n");
+    emit("    }\n");
+    emit("    DeferredStats* s = &DEFERRED_STATS;\n");
+    emit("    if (DEFERRED_COUNT > s->peak_backlog) s->peak_backlog = DEFERRED_COUNT;\n");
+    emit("    long start = deferred_now_ns();\n");
+    emit("    int processed = process_deferred_batch(s->batch);\n");
+    emit("    long pause = deferred_now_ns() - start;\n");
+    emit("    s->safe_points++;\n");
+    emit("    if (pause > s->max_pause_ns) s->max_pause_ns = pause;\n");
+    emit("    deferred_adapt(processed, pause);\n");
+    emit("}\n\n");
+
+    emit("// Safe point: process deferred if threshold reached\n");
+    emit("void safe_point() {\n");
+    emit("    if (DEFERRED_COUNT < DEFERRED_BATCH_SIZE) return;\n");
+    emit("#ifdef PURPLE_STATS\n");
+    emit("    long stats_start = deferred_now_ns();\n");
+    emit("    safe_point_batch();\n");
+    emit("    stats_pause(deferred_now_ns() - stats_start);\n");
+    emit("#else\n");
+    emit("    safe_point_batch();\n");
+    emit("#endif\n");
+    emit("}\n\n");
+
+    emit("// Flush all deferred at program end\n");
+    emit("void flush_all_deferred() {\n");
+    emit("    while (DEFERRED_COUNT > 0) {\n");
+    emit("        process_deferred_batch(DEFERRED_BATCH_SIZE);\n");
+    emit("    }\n");
+    emit("    free(DEFERRED_RING);\n");
+    emit("    free(DEFERRED_INDEX);\n");
+    emit("    DEFERRED_RING = NULL;\n");
+    emit("    DEFERRED_INDEX = NULL;\n");
+    emit("    DEFERRED_CAP = 0;\n");
+    emit("    DEFERRED_HEAD = 0;\n");
+    emit("    if (DEFERRED_STATS.budget_ns && getenv(\"PURPLE_DEFERRED_REPORT\")) deferred_report(stderr);\n");
+    emit("}\n");
+
+    emit("// Deferred release for cyclic structures\n");
+    emit("void deferred_release(Obj* obj) {\n");
+    emit("    if (!obj) return;\n");
+    emit("    // For cyclic structures, use deferred decrement\n");
+    emit("    defer_dec(obj);\n");
+    emit("    // Process if threshold reached\n");
+    emit("    safe_point();\n");
+    emit("}\n\n");
 }
 
 void gen_safe_point(const char* location) {
-    printf("    safe_point(); // %s\n", location ? location : "safe point");
+    emit("    safe_point(); // %s\n", location ? location : "safe point");
 }
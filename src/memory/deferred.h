@@ -2,27 +2,46 @@
 #define PURPLE_DEFERRED_H
 
 #include "../types.h"
-#include "../util/hashmap.h"
 
 // -- Phase 7: Deferred RC Fallback --
 // For mutable cyclic structures that never freeze
 // Bounded O(k) processing at safe points; no stop-the-world.
 
+// Adaptive batching (pause budget set): batches stay within these bounds,
+// and a backlog past DEFERRED_BACKLOG_LIMIT grows them regardless of it
+#define DEFERRED_BATCH_MIN 8
+#define DEFERRED_BATCH_MAX (1 << 20)
+#define DEFERRED_BACKLOG_LIMIT 65536
+
 // Deferred decrement entry
 typedef struct DeferredDec {
     void* obj;
     int count;  // Number of pending decrements
-    struct DeferredDec* next;
 } DeferredDec;
 
-// Deferred processing context
+// Index slot: obj -> ring position
+typedef struct DeferredSlot {
+    void* obj;  // NULL: empty
+    int pos;
+} DeferredSlot;
+
+// Deferred processing context. Pending entries live in one growable ring
+// (oldest at head) found through an open-addressing index, so deferring
+// and processing allocate only when the ring has to grow.
 typedef struct DeferredContext {
-    DeferredDec* pending;
-    HashMap* obj_lookup;  // O(1) lookup: obj -> DeferredDec*
+    DeferredDec* ring;
+    int capacity;         // Ring size (power of two)
+    int head;             // Position of the oldest entry
+    DeferredSlot* index;  // 2 * capacity slots, linear probing
     int pending_count;
     int batch_size;       // Max decrements per safe point
+    int trigger;          // Backlog that makes a safe point do work
+    long pause_budget_ns; // 0: fixed batch_size
+    double cost_ns;       // Smoothed cost of one decrement
     int total_deferred;   // Statistics
     int dropped_decrements; // Count of decrements lost to OOM
+    int over_budget;      // Batches that paused longer than the budget
+    int backlog_forced;   // Batches grown past the budget by the backlog
 } DeferredContext;
 
 // Context management
@@ -37,6 +56,14 @@ void flush_deferred(DeferredContext* ctx);
 // Safe point insertion
 int should_process_deferred(DeferredContext* ctx);
 
+// Adaptive batching: follow a pause budget (0 turns it off), and resize
+// the batch after one of `processed` decrements that took pause_ns
+void deferred_set_pause_budget(DeferredContext* ctx, long ns);
+void deferred_adapt(DeferredContext* ctx, int processed, long pause_ns);
+
+// Pending decrements for obj (0 if none)
+int deferred_pending_for(DeferredContext* ctx, void* obj);
+
 // Code generation
 void gen_deferred_runtime(void);
 void gen_safe_point(const char* location);
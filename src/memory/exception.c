@@ -3,6 +3,7 @@
 // LLVM-style landing pads with ASAP cleanup
 
 #include "exception.h"
+#include "../util/emit.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -89,173 +90,173 @@ LandingPad* create_landing_pad(ExceptionContext* ctx) {
 
 // Generate exception runtime
 void gen_exception_runtime(void) {
-    printf("\n// Phase 10: Exception Handling Runtime\n");
-    printf("// LLVM-style landing pads with ASAP cleanup\n\n");
+    emit("\n// Phase 10: Exception Handling Runtime\n");
+    emit("// LLVM-style landing pads with ASAP cleanup\n\n");
 
     // Exception state
-    printf("#include <setjmp.h>\n\n");
-
-    printf("// Exception types\n");
-    printf("typedef enum {\n");
-    printf("    EXC_NONE = 0,\n");
-    printf("    EXC_RUNTIME_ERROR,\n");
-    printf("    EXC_OUT_OF_MEMORY,\n");
-    printf("    EXC_USER_DEFINED\n");
-    printf("} ExceptionType;\n\n");
-
-    printf("// Exception value\n");
-    printf("typedef struct Exception {\n");
-    printf("    ExceptionType type;\n");
-    printf("    const char* message;\n");
-    printf("    void* data;\n");
-    printf("} Exception;\n\n");
+    emit("#include <setjmp.h>\n\n");
+
+    emit("// Exception types\n");
+    emit("typedef enum {\n");
+    emit("    EXC_NONE = 0,\n");
+    emit("    EXC_RUNTIME_ERROR,\n");
+    emit("    EXC_OUT_OF_MEMORY,\n");
+    emit("    EXC_USER_DEFINED\n");
+    emit("} ExceptionType;\n\n");
+
+    emit("// Exception value\n");
+    emit("typedef struct Exception {\n");
+    emit("    ExceptionType type;\n");
+    emit("    const char* message;\n");
+    emit("    void* data;\n");
+    emit("} Exception;\n\n");
 
     // Exception context stack
-    printf("// Exception context for nested try/catch\n");
-    printf("typedef struct ExcFrame {\n");
-    printf("    jmp_buf env;\n");
-    printf("    Exception exc;\n");
-    printf("    struct ExcFrame* prev;\n");
-    printf("    void** cleanup_vars;     // Variables to clean up\n");
-    printf("    int cleanup_count;\n");
-    printf("    int cleanup_capacity;\n");
-    printf("} ExcFrame;\n\n");
-
-    printf("ExcFrame* EXC_STACK = NULL;\n\n");
+    emit("// Exception context for nested try/catch\n");
+    emit("typedef struct ExcFrame {\n");
+    emit("    jmp_buf env;\n");
+    emit("    Exception exc;\n");
+    emit("    struct ExcFrame* prev;\n");
+    emit("    void** cleanup_vars;     // Variables to clean up\n");
+    emit("    int cleanup_count;\n");
+    emit("    int cleanup_capacity;\n");
+    emit("} ExcFrame;\n\n");
+
+    emit("ExcFrame* EXC_STACK = NULL;\n\n");
 
     // Push exception frame
-    printf("// Enter try block\n");
-    printf("ExcFrame* exc_push() {\n");
-    printf("    ExcFrame* frame = malloc(sizeof(ExcFrame));\n");
-    printf("    if (!frame) return NULL;\n");
-    printf("    frame->exc.type = EXC_NONE;\n");
-    printf("    frame->exc.message = NULL;\n");
-    printf("    frame->exc.data = NULL;\n");
-    printf("    frame->prev = EXC_STACK;\n");
-    printf("    frame->cleanup_vars = malloc(16 * sizeof(void*));\n");
-    printf("    if (!frame->cleanup_vars) { free(frame); return NULL; }\n");
-    printf("    frame->cleanup_count = 0;\n");
-    printf("    frame->cleanup_capacity = 16;\n");
-    printf("    EXC_STACK = frame;\n");
-    printf("    return frame;\n");
-    printf("}\n\n");
+    emit("// Enter try block\n");
+    emit("ExcFrame* exc_push() {\n");
+    emit("    ExcFrame* frame = malloc(sizeof(ExcFrame));\n");
+    emit("    if (!frame) return NULL;\n");
+    emit("    frame->exc.type = EXC_NONE;\n");
+    emit("    frame->exc.message = NULL;\n");
+    emit("    frame->exc.data = NULL;\n");
+    emit("    frame->prev = EXC_STACK;\n");
+    emit("    frame->cleanup_vars = malloc(16 * sizeof(void*));\n");
+    emit("    if (!frame->cleanup_vars) { free(frame); return NULL; }\n");
+    emit("    frame->cleanup_count = 0;\n");
+    emit("    frame->cleanup_capacity = 16;\n");
+    emit("    EXC_STACK = frame;\n");
+    emit("    return frame;\n");
+    emit("}\n\n");
 
     // Pop exception frame
-    printf("// Exit try block normally\n");
-    printf("void exc_pop() {\n");
-    printf("    if (!EXC_STACK) return;\n");
-    printf("    ExcFrame* frame = EXC_STACK;\n");
-    printf("    EXC_STACK = frame->prev;\n");
-    printf("    free(frame->cleanup_vars);\n");
-    printf("    free(frame);\n");
-    printf("}\n\n");
+    emit("// Exit try block normally\n");
+    emit("void exc_pop() {\n");
+    emit("    if (!EXC_STACK) return;\n");
+    emit("    ExcFrame* frame = EXC_STACK;\n");
+    emit("    EXC_STACK = frame->prev;\n");
+    emit("    free(frame->cleanup_vars);\n");
+    emit("    free(frame);\n");
+    emit("}\n\n");
 
     // Register cleanup
-    printf("// Register variable for cleanup on exception\n");
-    printf("void exc_register_cleanup(void* ptr) {\n");
-    printf("    if (!EXC_STACK || !ptr) return;\n");
-    printf("    ExcFrame* frame = EXC_STACK;\n");
-    printf("    if (frame->cleanup_count >= frame->cleanup_capacity) {\n");
-    printf("        if (frame->cleanup_capacity > INT_MAX / 2) return;  // Overflow protection\n");
-    printf("        int new_cap = frame->cleanup_capacity * 2;\n");
-    printf("        void** tmp = realloc(frame->cleanup_vars,\n");
-    printf("            new_cap * sizeof(void*));\n");
-    printf("        if (!tmp) return;  // Cannot register, but don't crash\n");
-    printf("        frame->cleanup_vars = tmp;\n");
-    printf("        frame->cleanup_capacity = new_cap;\n");
-    printf("    }\n");
-    printf("    frame->cleanup_vars[frame->cleanup_count++] = ptr;\n");
-    printf("}\n\n");
+    emit("// Register variable for cleanup on exception\n");
+    emit("void exc_register_cleanup(void* ptr) {\n");
+    emit("    if (!EXC_STACK || !ptr) return;\n");
+    emit("    ExcFrame* frame = EXC_STACK;\n");
+    emit("    if (frame->cleanup_count >= frame->cleanup_capacity) {\n");
+    emit("        if (frame->cleanup_capacity > INT_MAX / 2) return;  // Overflow protection\n");
+    emit("        int new_cap = frame->cleanup_capacity * 2;\n");
+    emit("        void** tmp = realloc(frame->cleanup_vars,\n");
+    emit("            new_cap * sizeof(void*));\n");
+    emit("        if (!tmp) return;  // Cannot register, but don't crash\n");
+    emit("        frame->cleanup_vars = tmp;\n");
+    emit("        frame->cleanup_capacity = new_cap;\n");
+    emit("    }\n");
+    emit("    frame->cleanup_vars[frame->cleanup_count++] = ptr;\n");
+    emit("}\n\n");
 
     // Unregister cleanup (after normal free)
-    printf("// Unregister variable (after normal free)\n");
-    printf("void exc_unregister_cleanup(void* ptr) {\n");
-    printf("    if (!EXC_STACK || !ptr) return;\n");
-    printf("    ExcFrame* frame = EXC_STACK;\n");
-    printf("    for (int i = 0; i < frame->cleanup_count; i++) {\n");
-    printf("        if (frame->cleanup_vars[i] == ptr) {\n");
-    printf("            frame->cleanup_vars[i] = frame->cleanup_vars[--frame->cleanup_count];\n");
-    printf("            return;\n");
-    printf("        }\n");
-    printf("    }\n");
-    printf("}\n\n");
+    emit("// Unregister variable (after normal free)\n");
+    emit("void exc_unregister_cleanup(void* ptr) {\n");
+    emit("    if (!EXC_STACK || !ptr) return;\n");
+    emit("    ExcFrame* frame = EXC_STACK;\n");
+    emit("    for (int i = 0; i < frame->cleanup_count; i++) {\n");
+    emit("        if (frame->cleanup_vars[i] == ptr) {\n");
+    emit("            frame->cleanup_vars[i] = frame->cleanup_vars[--frame->cleanup_count];\n");
+    emit("            return;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n\n");
 
     // Run cleanups (landing pad)
-    printf("// Landing pad: clean up all registered variables\n");
-    printf("void exc_run_cleanups() {\n");
-    printf("    if (!EXC_STACK) return;\n");
-    printf("    ExcFrame* frame = EXC_STACK;\n");
-    printf("    // Clean up in reverse order (LIFO)\n");
-    printf("    for (int i = frame->cleanup_count - 1; i >= 0; i--) {\n");
-    printf("        Obj* obj = (Obj*)frame->cleanup_vars[i];\n");
-    printf("        if (obj) dec_ref(obj);\n");
-    printf("    }\n");
-    printf("    frame->cleanup_count = 0;\n");
-    printf("}\n\n");
+    emit("// Landing pad: clean up all registered variables\n");
+    emit("void exc_run_cleanups() {\n");
+    emit("    if (!EXC_STACK) return;\n");
+    emit("    ExcFrame* frame = EXC_STACK;\n");
+    emit("    // Clean up in reverse order (LIFO)\n");
+    emit("    for (int i = frame->cleanup_count - 1; i >= 0; i--) {\n");
+    emit("        Obj* obj = (Obj*)frame->cleanup_vars[i];\n");
+    emit("        if (obj) dec_ref(obj);\n");
+    emit("    }\n");
+    emit("    frame->cleanup_count = 0;\n");
+    emit("}\n\n");
 
     // Throw exception
-    printf("// Throw an exception\n");
-    printf("void exc_throw(ExceptionType type, const char* message) {\n");
-    printf("    if (!EXC_STACK) {\n");
-    printf("        fprintf(stderr, \"Uncaught exception: %%s\\n\", message);\n");
-    printf("        exit(1);\n");
-    printf("    }\n");
-    printf("    EXC_STACK->exc.type = type;\n");
-    printf("    EXC_STACK->exc.message = message;\n");
-    printf("    exc_run_cleanups();\n");
-    printf("    longjmp(EXC_STACK->env, 1);\n");
-    printf("}\n\n");
+    emit("// Throw an exception\n");
+    emit("void exc_throw(ExceptionType type, const char* message) {\n");
+    emit("    if (!EXC_STACK) {\n");
+    emit("        fprintf(stderr, \"Uncaught exception: %%s\\n\", message);\n");
+    emit("        exit(1);\n");
+    emit("    }\n");
+    emit("    EXC_STACK->exc.type = type;\n");
+    emit("    EXC_STACK->exc.message = message;\n");
+    emit("    exc_run_cleanups();\n");
+    emit("    longjmp(EXC_STACK->env, 1);\n");
+    emit("}\n\n");
 
     // Try/catch macros
-    printf("// Try/catch macros\n");
-    printf("#define TRY \\\n");
-    printf("    do { \\\n");
-    printf("        ExcFrame* _exc_frame = exc_push(); \\\n");
-    printf("        if (setjmp(_exc_frame->env) == 0) {\n\n");
-
-    printf("#define CATCH(exc_var) \\\n");
-    printf("            exc_pop(); \\\n");
-    printf("        } else { \\\n");
-    printf("            Exception exc_var = EXC_STACK->exc; \\\n");
-    printf("            exc_pop();\n\n");
-
-    printf("#define END_TRY \\\n");
-    printf("        } \\\n");
-    printf("    } while(0)\n\n");
+    emit("// Try/catch macros\n");
+    emit("#define TRY \\\n");
+    emit("    do { \\\n");
+    emit("        ExcFrame* _exc_frame = exc_push(); \\\n");
+    emit("        if (setjmp(_exc_frame->env) == 0) {\n\n");
+
+    emit("#define CATCH(exc_var) \\\n");
+    emit("            exc_pop(); \\\n");
+    emit("        } else { \\\n");
+    emit("            Exception exc_var = EXC_STACK->exc; \\\n");
+    emit("            exc_pop();\n\n");
+
+    emit("#define END_TRY \\\n");
+    emit("        } \\\n");
+    emit("    } while(0)\n\n");
 
     // Allocate with auto-registration
-    printf("// Allocate with automatic exception cleanup registration\n");
-    printf("Obj* mk_int_exc(long val) {\n");
-    printf("    Obj* obj = mk_int(val);\n");
-    printf("    exc_register_cleanup(obj);\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
-
-    printf("Obj* mk_pair_exc(Obj* a, Obj* b) {\n");
-    printf("    Obj* obj = mk_pair(a, b);\n");
-    printf("    exc_register_cleanup(obj);\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
+    emit("// Allocate with automatic exception cleanup registration\n");
+    emit("Obj* mk_int_exc(long val) {\n");
+    emit("    Obj* obj = mk_int(val);\n");
+    emit("    exc_register_cleanup(obj);\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
+
+    emit("Obj* mk_pair_exc(Obj* a, Obj* b) {\n");
+    emit("    Obj* obj = mk_pair(a, b);\n");
+    emit("    exc_register_cleanup(obj);\n");
+    emit("    return obj;\n");
+    emit("}\n\n");
 
     // Safe free with unregistration
-    printf("// Free with automatic unregistration\n");
-    printf("void free_exc(Obj* obj) {\n");
-    printf("    exc_unregister_cleanup(obj);\n");
-    printf("    dec_ref(obj);\n");
-    printf("}\n\n");
+    emit("// Free with automatic unregistration\n");
+    emit("void free_exc(Obj* obj) {\n");
+    emit("    exc_unregister_cleanup(obj);\n");
+    emit("    dec_ref(obj);\n");
+    emit("}\n\n");
 }
 
 // Generate cleanup code for landing pad
 void gen_landing_pad_code(LandingPad* pad) {
     if (!pad) return;
 
-    printf("landing_pad_%d:\n", pad->id);
+    emit("landing_pad_%d:\n", pad->id);
 
     CleanupAction* action = pad->cleanups;
     while (action) {
-        printf("    %s(%s);\n", action->cleanup_fn, action->var_name);
+        emit("    %s(%s);\n", action->cleanup_fn, action->var_name);
         action = action->next;
     }
 
-    printf("    // Resume unwinding or return to handler\n");
+    emit("    // Resume unwinding or return to handler\n");
 }
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <limits.h>
+#include <string.h>
 
 /* Platform-specific random */
 #ifdef _WIN32
@@ -37,8 +38,8 @@ static void* grow_array(void* arr, int* capacity, size_t elem_size) {
     return new_arr;
 }
 
-/* Generate cryptographically random 64-bit generation */
-Generation genref_random_generation(void) {
+/* Read 64 random bits from the OS; 0 on failure */
+static Generation os_random64(void) {
     Generation gen = 0;
 
 #ifdef _WIN32
@@ -70,6 +71,72 @@ Generation genref_random_generation(void) {
         gen ^= (gen >> 33);
     }
 
+    return gen;
+}
+
+/*
+ * Generations come from a per-thread xoshiro256** generator, seeded once
+ * per thread from the OS (through splitmix64, so every state word is
+ * mixed): no syscall per allocation. Hardened mode reads the OS for every
+ * generation instead, so one leaked value says nothing about the next.
+ */
+#ifdef GENREF_HARDENED
+static bool genref_hardened = true;
+#else
+static bool genref_hardened = false;
+#endif
+
+#ifdef _WIN32
+#define GENREF_TLS __declspec(thread)
+#else
+#define GENREF_TLS __thread
+#endif
+
+static GENREF_TLS uint64_t prng_state[4];
+static GENREF_TLS bool prng_seeded = false;
+
+static uint64_t rotl64(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static void prng_seed(void) {
+    uint64_t x = os_random64();
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        prng_state[i] = z ^ (z >> 31);
+    }
+    prng_seeded = true;
+}
+
+static uint64_t prng_next(void) {
+    uint64_t* s = prng_state;
+    uint64_t result = rotl64(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl64(s[3], 45);
+    return result;
+}
+
+void genref_set_hardened(bool on) {
+    genref_hardened = on;
+}
+
+/* Generate random 64-bit generation */
+Generation genref_random_generation(void) {
+    Generation gen;
+    if (genref_hardened) {
+        gen = os_random64();
+    } else {
+        if (!prng_seeded) prng_seed();
+        gen = prng_next();
+    }
+
     /* Ensure non-zero (0 means invalid) */
     if (gen == 0) gen = 1;
 
@@ -196,6 +263,102 @@ bool genref_is_valid(GenRef* ref) {
            ref->target->generation != 0;
 }
 
+/* -- Inline Layout -- */
+
+#define GENREF_CHUNK_BYTES (64 * 1024)
+
+static GenHeader* header_of(void* obj) {
+    return (GenHeader*)obj - 1;
+}
+
+GenSlab* genref_slab_new(size_t object_size) {
+    if (object_size < sizeof(void*)) object_size = sizeof(void*);  /* Room for the free link */
+    if (object_size > GENREF_CHUNK_BYTES) return NULL;
+    GenSlab* slab = calloc(1, sizeof(GenSlab));
+    if (!slab) return NULL;
+    slab->slot_size = (sizeof(GenHeader) + object_size + 15) & ~(size_t)15;
+    slab->chunk_slots = GENREF_CHUNK_BYTES / slab->slot_size;
+    if (slab->chunk_slots < 16) slab->chunk_slots = 16;
+    return slab;
+}
+
+void genref_slab_destroy(GenSlab* slab) {
+    if (!slab) return;
+    for (int i = 0; i < slab->chunk_count; i++) free(slab->chunks[i]);
+    free(slab->chunks);
+    free(slab);
+}
+
+void* genref_slab_alloc(GenSlab* slab) {
+    if (!slab) return NULL;
+    GenHeader* h;
+    if (slab->free_list) {
+        void* obj = slab->free_list;
+        slab->free_list = *(void**)obj;
+        h = header_of(obj);
+    } else {
+        if (slab->bump == slab->bump_end) {
+            if (slab->chunk_count >= slab->chunk_capacity) {
+                char** chunks = grow_array(slab->chunks, &slab->chunk_capacity, sizeof(char*));
+                if (!chunks) return NULL;
+                slab->chunks = chunks;
+            }
+            char* chunk = malloc(slab->chunk_slots * slab->slot_size);
+            if (!chunk) return NULL;
+            slab->chunks[slab->chunk_count++] = chunk;
+            slab->bump = chunk;
+            slab->bump_end = chunk + slab->chunk_slots * slab->slot_size;
+        }
+        h = (GenHeader*)slab->bump;
+        slab->bump += slab->slot_size;
+    }
+    memset(h + 1, 0, slab->slot_size - sizeof(GenHeader));
+    h->generation = genref_random_generation();
+    h->reserved = 0;
+    slab->live++;
+    return h + 1;
+}
+
+/* Invalidate every GenPtr to obj and recycle its slot */
+void genref_slab_free(GenSlab* slab, void* obj) {
+    if (!slab || !obj) return;
+    GenHeader* h = header_of(obj);
+    if (h->generation == 0) return;  /* Already free */
+    h->generation = 0;
+    *(void**)obj = slab->free_list;
+    slab->free_list = obj;
+    slab->live--;
+}
+
+GenPtr genref_ptr(void* obj) {
+    GenPtr ref = { obj, obj ? header_of(obj)->generation : 0 };
+    return ref;
+}
+
+/* Dereference safely - returns NULL and sets error on UAF */
+void* genref_ptr_deref(GenPtr ref, GenRefError* err) {
+    if (!ref.ptr) {
+        if (err) *err = GENREF_ERR_NULL;
+        return NULL;
+    }
+    Generation current = header_of(ref.ptr)->generation;
+    if (current != ref.remembered_gen || current == 0) {
+        if (err) *err = GENREF_ERR_UAF;
+        fprintf(stderr, "use-after-free detected: %s (obj: %lu, ref: %lu)\n",
+                current == 0 ? "object was freed" : "slot was reused",
+                (unsigned long)current, (unsigned long)ref.remembered_gen);
+        return NULL;
+    }
+    if (err) *err = GENREF_OK;
+    return ref.ptr;
+}
+
+bool genref_ptr_is_valid(GenPtr ref) {
+    if (!ref.ptr) return false;
+    Generation current = header_of(ref.ptr)->generation;
+    return current == ref.remembered_gen && current != 0;
+}
+
 /* Create closure with captured references */
 GenClosure* genref_closure_new(GenRef** captures, int count, void* (*fn)(void*), void* context) {
     GenClosure* closure = calloc(1, sizeof(GenClosure));
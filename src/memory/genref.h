@@ -16,6 +16,7 @@
 #ifndef GENREF_H
 #define GENREF_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -58,6 +59,35 @@ struct GenRefContext {
     int object_capacity;
 };
 
+/*
+ * Inline layout: the generation sits in a header right before the object,
+ * so a check and the data it guards share a cache line and no GenObj is
+ * allocated. Objects come from a GenSlab of one size; freed slots go back
+ * on its free list but its chunks stay mapped until the slab is destroyed,
+ * so a stale GenPtr can always read the header it checks.
+ */
+typedef struct GenHeader {
+    Generation generation;          /* 0 while the slot is free */
+    uint64_t reserved;              /* Keeps objects 16-byte aligned */
+} GenHeader;
+
+typedef struct GenPtr {
+    void* ptr;                      /* Object (just past its header) */
+    Generation remembered_gen;
+} GenPtr;
+
+typedef struct GenSlab {
+    size_t slot_size;               /* Header + object, 16-byte multiple */
+    size_t chunk_slots;
+    char** chunks;
+    int chunk_count;
+    int chunk_capacity;
+    char* bump;                     /* Never-used part of the last chunk */
+    char* bump_end;
+    void* free_list;                /* Freed objects, linked through their first word */
+    int64_t live;
+} GenSlab;
+
 /* Statistics */
 typedef struct {
     int64_t total_allocations;
@@ -96,7 +126,18 @@ void* genref_closure_call(GenClosure* closure, GenRefError* err);
 GenRefError genref_closure_validate(GenClosure* closure);
 void genref_closure_free(GenClosure* closure);
 
-/* Random generation */
+/* Inline layout */
+GenSlab* genref_slab_new(size_t object_size);
+void genref_slab_destroy(GenSlab* slab);     /* Every GenPtr into it dies */
+void* genref_slab_alloc(GenSlab* slab);      /* Zeroed, with a fresh generation */
+void genref_slab_free(GenSlab* slab, void* obj);
+GenPtr genref_ptr(void* obj);
+void* genref_ptr_deref(GenPtr ref, GenRefError* err);
+bool genref_ptr_is_valid(GenPtr ref);
+
+/* Random generation: a per-thread PRNG seeded from the OS, or with
+ * hardened mode (default with -DGENREF_HARDENED) the OS for every value */
 Generation genref_random_generation(void);
+void genref_set_hardened(bool on);
 
 #endif /* GENREF_H */
@@ -4,47 +4,54 @@
  */
 
 #include "region.h"
+#include "arena.h"
 #include <stdlib.h>
 #include <stdatomic.h>
-#include <limits.h>
+
+/* Arena block size for region objects and refs */
+#define REGION_ARENA_BLOCK 16384
 
 /* Global region ID counter */
 static atomic_uint_fast64_t next_region_id = 1;
 
-/* Helper: grow array */
-static void* grow_array(void* arr, int* capacity, size_t elem_size) {
-    int new_cap;
-    if (*capacity == 0) {
-        new_cap = 4;
-    } else {
-        /* Check for integer overflow before doubling */
-        if (*capacity > INT_MAX / 2) {
-            return NULL;  /* Cannot grow - would overflow */
-        }
-        new_cap = *capacity * 2;
-    }
-    void* new_arr = realloc(arr, new_cap * elem_size);
-    if (new_arr) {
-        *capacity = new_cap;
+/* Region epochs: every enter and exit takes a new one, from all contexts */
+static atomic_uint_fast64_t next_epoch = 1;
+
+/* Whether obj belongs to a region that is still open */
+static bool obj_live(RegionObj* obj) {
+    return obj && obj->region && obj->epoch == obj->region->epoch && !obj->region->closed;
+}
+
+/* Run destructors of r's objects (newest first) */
+static void region_finalize(Region* r) {
+    for (RegionObj* obj = r->finalizers; obj; obj = obj->next_finalizer) {
+        if (obj->data) obj->destructor(obj->data);
     }
-    return new_arr;
+    r->finalizers = NULL;
 }
 
-/* Create a new region */
-static Region* region_new(Region* parent) {
-    Region* r = calloc(1, sizeof(Region));
-    if (!r) return NULL;
+/* Get a region for parent: a recycled one if any, otherwise a new one */
+static Region* region_new(RegionContext* ctx, Region* parent) {
+    Region* r = ctx->free_regions;
+    if (r) {
+        ctx->free_regions = r->next_free;
+        r->next_free = NULL;
+    } else {
+        r = calloc(1, sizeof(Region));
+        if (!r) return NULL;
+        r->next_all = ctx->all_regions;
+        ctx->all_regions = r;
+    }
 
     r->id = atomic_fetch_add(&next_region_id, 1);
+    r->epoch = atomic_fetch_add(&next_epoch, 1);
     r->depth = parent ? parent->depth + 1 : 0;
     r->parent = parent;
-    r->children = NULL;
     r->child_count = 0;
-    r->child_capacity = 0;
-    r->objects = NULL;
     r->object_count = 0;
-    r->object_capacity = 0;
     r->closed = false;
+    r->enter_tick = ctx->clock++;
+    r->exit_tick = UINT64_MAX;
 
     return r;
 }
@@ -52,27 +59,7 @@ static Region* region_new(Region* parent) {
 /* Free a region (internal) */
 static void region_destroy(Region* r) {
     if (!r) return;
-
-    /* Free all objects */
-    for (int i = 0; i < r->object_count; i++) {
-        RegionObj* obj = r->objects[i];
-        if (obj) {
-            if (obj->destructor && obj->data) {
-                obj->destructor(obj->data);
-            }
-            /* Free refs array */
-            free(obj->refs);
-            free(obj);
-        }
-    }
-    free(r->objects);
-
-    /* Free children recursively */
-    for (int i = 0; i < r->child_count; i++) {
-        region_destroy(r->children[i]);
-    }
-    free(r->children);
-
+    region_finalize(r);
     free(r);
 }
 
@@ -81,8 +68,10 @@ RegionContext* region_context_new(void) {
     RegionContext* ctx = calloc(1, sizeof(RegionContext));
     if (!ctx) return NULL;
 
-    ctx->root = region_new(NULL);
+    ctx->arena = arena_create(REGION_ARENA_BLOCK);
+    ctx->root = ctx->arena ? region_new(ctx, NULL) : NULL;
     if (!ctx->root) {
+        arena_destroy(ctx->arena);
         free(ctx);
         return NULL;
     }
@@ -94,7 +83,13 @@ RegionContext* region_context_new(void) {
 /* Free context and all regions */
 void region_context_free(RegionContext* ctx) {
     if (!ctx) return;
-    region_destroy(ctx->root);
+    Region* r = ctx->all_regions;
+    while (r) {
+        Region* next = r->next_all;
+        region_destroy(r);
+        r = next;
+    }
+    arena_destroy(ctx->arena);
     free(ctx);
 }
 
@@ -102,116 +97,84 @@ void region_context_free(RegionContext* ctx) {
 Region* region_enter(RegionContext* ctx) {
     if (!ctx || !ctx->current) return NULL;
 
-    Region* child = region_new(ctx->current);
+    Region* child = region_new(ctx, ctx->current);
     if (!child) return NULL;
 
-    /* Add to parent's children */
-    if (ctx->current->child_count >= ctx->current->child_capacity) {
-        Region** new_children = grow_array(
-            ctx->current->children,
-            &ctx->current->child_capacity,
-            sizeof(Region*)
-        );
-        if (!new_children) {
-            free(child);
-            return NULL;
-        }
-        ctx->current->children = new_children;
-    }
-    ctx->current->children[ctx->current->child_count++] = child;
-
+    ctx->current->child_count++;
     ctx->current = child;
     return child;
 }
 
-/* Exit current region */
+/* Exit current region: O(1) in its objects, except those with destructors */
 RegionError region_exit(RegionContext* ctx) {
     if (!ctx || !ctx->current) return REGION_ERR_NULL;
     if (ctx->current == ctx->root) return REGION_ERR_CANNOT_EXIT_ROOT;
     if (ctx->current->closed) return REGION_ERR_CLOSED;
 
-    /* Mark as closed and invalidate all objects */
-    ctx->current->closed = true;
-    for (int i = 0; i < ctx->current->object_count; i++) {
-        RegionObj* obj = ctx->current->objects[i];
-        if (obj) {
-            obj->region = NULL;  /* Mark as invalid */
-        }
-    }
-
-    /* Return to parent */
-    ctx->current = ctx->current->parent;
+    Region* r = ctx->current;
+    r->closed = true;
+    r->epoch = atomic_fetch_add(&next_epoch, 1);
+    r->exit_tick = ctx->clock++;
+    region_finalize(r);
+
+    /* Return to parent; r waits for reuse */
+    ctx->current = r->parent;
+    ctx->current->child_count--;
+    r->next_free = ctx->free_regions;
+    ctx->free_regions = r;
     return REGION_OK;
 }
 
 /* Allocate object in current region */
 RegionObj* region_alloc(RegionContext* ctx, void* data, void (*destructor)(void*)) {
     if (!ctx || !ctx->current) return NULL;
-    if (ctx->current->closed) return NULL;
+    Region* r = ctx->current;
+    if (r->closed) return NULL;
 
-    RegionObj* obj = calloc(1, sizeof(RegionObj));
+    RegionObj* obj = arena_alloc(ctx->arena, sizeof(RegionObj));
     if (!obj) return NULL;
 
-    obj->region = ctx->current;
+    obj->region = r;
+    obj->epoch = r->epoch;
     obj->data = data;
     obj->destructor = destructor;
+    obj->next_finalizer = NULL;
     obj->refs = NULL;
     obj->ref_count = 0;
-    obj->ref_capacity = 0;
-
-    /* Add to region's objects */
-    if (ctx->current->object_count >= ctx->current->object_capacity) {
-        RegionObj** new_objects = grow_array(
-            ctx->current->objects,
-            &ctx->current->object_capacity,
-            sizeof(RegionObj*)
-        );
-        if (!new_objects) {
-            free(obj);
-            return NULL;
-        }
-        ctx->current->objects = new_objects;
+
+    if (destructor) {
+        obj->next_finalizer = r->finalizers;
+        r->finalizers = obj;
     }
-    ctx->current->objects[ctx->current->object_count++] = obj;
+    r->object_count++;
 
     return obj;
 }
 
 /* Create reference from source to target */
 RegionError region_create_ref(RegionContext* ctx, RegionObj* source, RegionObj* target, RegionRef** out_ref) {
-    (void)ctx;  /* Unused but kept for API consistency */
-
-    if (!source || !target || !out_ref) return REGION_ERR_NULL;
-    if (!source->region) return REGION_ERR_CLOSED;
-    if (!target->region) return REGION_ERR_CLOSED;
+    if (!ctx || !source || !target || !out_ref) return REGION_ERR_NULL;
+    if (!obj_live(source)) return REGION_ERR_CLOSED;
+    if (!obj_live(target)) return REGION_ERR_CLOSED;
 
     /* Key check: source cannot point to more deeply scoped target */
-    /* Allowed: inner → outer (source.depth >= target.depth) */
-    /* Forbidden: outer → inner (source.depth < target.depth) */
-    if (source->region->depth < target->region->depth) {
+    /* Allowed: inner → outer (target's region encloses source's) */
+    /* Forbidden: outer → inner, and across sibling regions */
+    if (!region_is_ancestor(target->region, source->region)) {
         return REGION_ERR_SCOPE_VIOLATION;
     }
 
-    RegionRef* ref = calloc(1, sizeof(RegionRef));
+    /* Like objects, refs stay readable after their regions exit */
+    RegionRef* ref = arena_alloc(ctx->arena, sizeof(RegionRef));
     if (!ref) return REGION_ERR_ALLOC_FAILED;
 
     ref->target = target;
     ref->source_region = source->region;
-
-    /* Add to source's refs */
-    if (source->ref_count >= source->ref_capacity) {
-        RegionRef** new_refs = grow_array(
-            source->refs,
-            &source->ref_capacity,
-            sizeof(RegionRef*)
-        );
-        if (!new_refs) {
-            free(ref);
-            return REGION_ERR_ALLOC_FAILED;
-        }
-        source->refs = new_refs;
-    }
-    source->refs[source->ref_count++] = ref;
+    ref->target_region = target->region;
+    ref->target_epoch = target->epoch;
+    ref->next = source->refs;
+    source->refs = ref;
+    source->ref_count++;
 
     *out_ref = ref;
     return REGION_OK;
@@ -223,7 +186,7 @@ void* region_ref_deref(RegionRef* ref, RegionError* err) {
         if (err) *err = REGION_ERR_NULL;
         return NULL;
     }
-    if (!ref->target->region) {
+    if (!region_ref_is_valid(ref)) {
         if (err) *err = REGION_ERR_CLOSED;
         return NULL;
     }
@@ -232,26 +195,24 @@ void* region_ref_deref(RegionRef* ref, RegionError* err) {
     return ref->target->data;
 }
 
-/* Check if reference is valid */
+/* Check if reference is valid: the target's region has not exited since */
 bool region_ref_is_valid(RegionRef* ref) {
-    return ref && ref->target && ref->target->region && !ref->target->region->closed;
+    return ref && ref->target && ref->target_region &&
+           ref->target_region->epoch == ref->target_epoch;
 }
 
 /* Check if source can reference target */
 bool region_can_reference(RegionObj* source, RegionObj* target) {
-    if (!source || !target) return false;
-    if (!source->region || !target->region) return false;
-    return source->region->depth >= target->region->depth;
+    if (!obj_live(source) || !obj_live(target)) return false;
+    return region_is_ancestor(target->region, source->region);
 }
 
-/* Check if ancestor is ancestor of descendant */
+/* Check if ancestor is ancestor of (or the same as) descendant: O(1) by
+   interval containment */
 bool region_is_ancestor(Region* ancestor, Region* descendant) {
-    Region* current = descendant;
-    while (current) {
-        if (current == ancestor) return true;
-        current = current->parent;
-    }
-    return false;
+    if (!ancestor || !descendant) return false;
+    return ancestor->enter_tick <= descendant->enter_tick &&
+           descendant->exit_tick <= ancestor->exit_tick;
 }
 
 /* Get region depth */
@@ -31,40 +31,58 @@ typedef struct RegionObj RegionObj;
 typedef struct RegionRef RegionRef;
 typedef struct RegionContext RegionContext;
 
-/* Region - an isolated memory region with scope hierarchy */
+/* Region - an isolated memory region with scope hierarchy.
+ * Objects and refs are bump-allocated from the context's arena, which
+ * outlives every region: a handle to an exited region's object stays
+ * readable, so it can be rejected. Exiting gives the region a fresh
+ * epoch, which invalidates every object at once, and the region struct
+ * is recycled by a later region_enter under yet another epoch; epochs
+ * never repeat, so no handle from an earlier use matches.
+ * Regions nest like a stack, so [enter_tick, exit_tick] intervals nest
+ * too: an ancestor's interval contains its descendants'. */
 struct Region {
     RegionID id;
     RegionDepth depth;
     Region* parent;
-    Region** children;
-    int child_count;
-    int child_capacity;
-    RegionObj** objects;
+    uint64_t epoch;            /* Unique per use; objects remember theirs */
+    uint64_t enter_tick;       /* Interval label: context clock at enter */
+    uint64_t exit_tick;        /* ... and at exit (UINT64_MAX while open) */
+    RegionObj* finalizers;     /* Objects with a destructor, newest first */
+    int child_count;           /* Open children */
     int object_count;
-    int object_capacity;
     bool closed;
+    Region* next_free;         /* Context free list, while closed */
+    Region* next_all;          /* Every region the context owns */
 };
 
 /* RegionObj - an object allocated within a region */
 struct RegionObj {
     Region* region;
+    uint64_t epoch;            /* region->epoch when allocated */
     void* data;
     void (*destructor)(void*);
-    RegionRef** refs;
+    RegionObj* next_finalizer;
+    RegionRef* refs;           /* Outgoing refs, newest first */
     int ref_count;
-    int ref_capacity;
 };
 
 /* RegionRef - a reference that carries region information */
 struct RegionRef {
     RegionObj* target;
     Region* source_region;
+    Region* target_region;
+    uint64_t target_epoch;     /* Valid while target_region->epoch matches */
+    RegionRef* next;
 };
 
 /* RegionContext - manages the region hierarchy */
 struct RegionContext {
     Region* root;
     Region* current;
+    Region* free_regions;      /* Closed regions, ready for reuse */
+    Region* all_regions;
+    struct Arena* arena;       /* Objects and refs, freed with the context */
+    uint64_t clock;            /* Ticks on every enter and exit */
 };
 
 /* Error codes */
@@ -1,7 +1,13 @@
 #include "scc.h"
+#include "../analysis/shape.h"
+#include "../parser/parser.h"
+#include "../util/emit.h"
 #include <stdio.h>
 #include <limits.h>
 
+// Arena block size for Tarjan nodes
+#define SCC_NODE_BLOCK 16384
+
 // -- SCC Registry Management --
 
 SCCRegistry* mk_scc_registry(void) {
@@ -10,8 +16,13 @@ SCCRegistry* mk_scc_registry(void) {
     reg->sccs = NULL;
     reg->next_id = 1;
     reg->node_map = NULL;
-    reg->node_lookup = hashmap_new();
-    if (!reg->node_lookup) {
+    reg->node_arena = arena_create(SCC_NODE_BLOCK);
+    reg->node_lookup = swissmap_new();
+    reg->scc_lookup = swissmap_new();
+    if (!reg->node_arena || !reg->node_lookup || !reg->scc_lookup) {
+        arena_destroy(reg->node_arena);
+        if (reg->node_lookup) swissmap_free(reg->node_lookup);
+        if (reg->scc_lookup) swissmap_free(reg->scc_lookup);
         free(reg);
         return NULL;
     }
@@ -28,23 +39,22 @@ void free_scc_registry(SCCRegistry* reg) {
     while (scc) {
         SCC* next = scc->next;
         if (scc->members) free(scc->members);
+        free(scc->deps);
         free(scc);
         scc = next;
     }
 
-    // Free hash map
+    // Free hash maps
     if (reg->node_lookup) {
-        hashmap_free(reg->node_lookup);
+        swissmap_free(reg->node_lookup);
     }
-
-    // Free node map (linked list for cleanup)
-    SCCNode* node = reg->node_map;
-    while (node) {
-        SCCNode* next = node->next;
-        free(node);
-        node = next;
+    if (reg->scc_lookup) {
+        swissmap_free(reg->scc_lookup);
     }
 
+    // Nodes live in the arena
+    arena_destroy(reg->node_arena);
+
     free(reg);
 }
 
@@ -64,6 +74,9 @@ SCC* create_scc(SCCRegistry* reg) {
     scc->capacity = 16;
     scc->ref_count = 1;
     scc->frozen = 0;
+    scc->deps = NULL;
+    scc->dep_count = 0;
+    swissmap_put(reg->scc_lookup, (void*)(intptr_t)scc->id, scc);
     // Link into registry list for cleanup (using 'next')
     scc->next = reg->sccs;
     reg->sccs = scc;
@@ -87,20 +100,33 @@ void add_to_scc(SCC* scc, Obj* obj) {
 }
 
 SCC* find_scc(SCCRegistry* reg, int scc_id) {
-    if (!reg) return NULL;
-    SCC* scc = reg->sccs;
-    while (scc) {
-        if (scc->id == scc_id) return scc;
-        scc = scc->next;
-    }
-    return NULL;
+    if (!reg || scc_id <= 0) return NULL;
+    return (SCC*)swissmap_get(reg->scc_lookup, (void*)(intptr_t)scc_id);
+}
+
+// Frozen SCC an object joined in an earlier compute_sccs, or NULL
+static SCC* frozen_scc_of(SCCRegistry* reg, Obj* obj) {
+    if (!obj || obj->scc_id < 0) return NULL;
+    SCC* scc = find_scc(reg, obj->scc_id);
+    return scc && scc->frozen ? scc : NULL;
+}
+
+// Reference the frozen SCC behind the edge to obj, if any
+static void add_frozen_dep(SCCRegistry* reg, SCC* scc, Obj* obj) {
+    SCC* dep = frozen_scc_of(reg, obj);
+    if (!dep || dep == scc) return;
+    SCC** deps = realloc(scc->deps, (size_t)(scc->dep_count + 1) * sizeof(SCC*));
+    if (!deps) return;
+    scc->deps = deps;
+    scc->deps[scc->dep_count++] = dep;
+    dep->ref_count++;
 }
 
 // -- Tarjan's Algorithm Helpers --
 
 // O(1) lookup using hash map
 static SCCNode* get_node(SCCRegistry* reg, Obj* obj) {
-    return (SCCNode*)hashmap_get(reg->node_lookup, obj);
+    return (SCCNode*)swissmap_get(reg->node_lookup, obj);
 }
 
 static SCCNode* get_or_create_node(SCCRegistry* reg, Obj* obj) {
@@ -108,7 +134,7 @@ static SCCNode* get_or_create_node(SCCRegistry* reg, Obj* obj) {
     SCCNode* existing = get_node(reg, obj);
     if (existing) return existing;
 
-    SCCNode* n = malloc(sizeof(SCCNode));
+    SCCNode* n = arena_alloc(reg->node_arena, sizeof(SCCNode));
     if (!n) return NULL;
     n->id = -1;
     n->lowlink = -1;
@@ -119,7 +145,7 @@ static SCCNode* get_or_create_node(SCCRegistry* reg, Obj* obj) {
     reg->node_map = n;
 
     // Add to hash map for O(1) lookup
-    hashmap_put(reg->node_lookup, obj, n);
+    swissmap_put(reg->node_lookup, obj, n);
 
     return n;
 }
@@ -145,25 +171,14 @@ static int min(int a, int b) {
 static void reset_tarjan_state(SCCRegistry* reg) {
     if (!reg) return;
 
-    // Clear node map entries
-    SCCNode* node = reg->node_map;
-    while (node) {
-        SCCNode* next = node->next;
-        free(node);
-        node = next;
-    }
+    // Drop this run's nodes at once
+    arena_reset(reg->node_arena);
     reg->node_map = NULL;
     reg->stack = NULL;
     reg->index = 0;
 
-    if (reg->node_lookup) {
-        hashmap_free(reg->node_lookup);
-        reg->node_lookup = NULL;
-    }
-    HashMap* new_map = hashmap_new();
-    if (new_map) {
-        reg->node_lookup = new_map;
-    }
+    // Keep the table: the next run probably looks at as many objects
+    swissmap_clear(reg->node_lookup);
 }
 
 // -- Tarjan's SCC Algorithm (Iterative with explicit stack) --
@@ -231,7 +246,7 @@ void tarjan_dfs(SCCRegistry* reg, Obj* v, SCC** result) {
 
             // Process child 'a' first
             frame->state = TARJAN_AFTER_A;
-            if (curr->is_pair && curr->a) {
+            if (curr->is_pair && curr->a && !frozen_scc_of(reg, curr->a)) {
                 SCCNode* w_node = get_node(reg, curr->a);
                 if (!w_node || w_node->id < 0) {
                     // Child not yet visited - push frame to process it
@@ -259,7 +274,7 @@ void tarjan_dfs(SCCRegistry* reg, Obj* v, SCC** result) {
 
             // Process child 'b'
             frame->state = TARJAN_AFTER_B;
-            if (curr->is_pair && curr->b) {
+            if (curr->is_pair && curr->b && !frozen_scc_of(reg, curr->b)) {
                 SCCNode* w_node = get_node(reg, curr->b);
                 if (!w_node || w_node->id < 0) {
                     // Child not yet visited - push frame to process it
@@ -305,6 +320,14 @@ void tarjan_dfs(SCCRegistry* reg, Obj* v, SCC** result) {
                     }
                 } while (w && w != node);
 
+                // Edges out of the component into the frozen base
+                for (int i = 0; i < scc->member_count; i++) {
+                    Obj* m = scc->members[i];
+                    if (!m->is_pair) continue;
+                    add_frozen_dep(reg, scc, m->a);
+                    add_frozen_dep(reg, scc, m->b);
+                }
+
                 scc->result_next = *result;
                 *result = scc;
             }
@@ -321,6 +344,12 @@ void tarjan_dfs(SCCRegistry* reg, Obj* v, SCC** result) {
 }
 
 SCC* compute_sccs(SCCRegistry* reg, Obj* root) {
+    SCC* frozen = frozen_scc_of(reg, root);
+    if (frozen) {
+        // It may be inside an earlier result list: leave that list whole
+        frozen->ref_count++;
+        return frozen;
+    }
     reset_tarjan_state(reg);
     SCC* result = NULL;
     tarjan_dfs(reg, root, &result);
@@ -345,6 +374,13 @@ void release_scc(SCC* scc) {
         free(scc->members);
         scc->members = NULL;
         scc->member_count = 0;
+        // Drop the references held on the frozen base
+        for (int i = 0; i < scc->dep_count; i++) {
+            release_scc(scc->deps[i]);
+        }
+        free(scc->deps);
+        scc->deps = NULL;
+        scc->dep_count = 0;
         // Note: SCC struct itself stays in registry until registry freed
     }
 }
@@ -355,14 +391,14 @@ void release_scc(SCC* scc) {
 static int has_no_mutations(const char* var, Value* expr) {
     if (!expr || is_nil(expr)) return 1;
 
-    if (expr->tag == T_CELL) {
+    if (val_tag(expr) == T_CELL) {
         Value* op = car(expr);
         Value* args = cdr(expr);
 
         // Check for set! on this variable
-        if (op && op->tag == T_SYM && strcmp(op->s, "set!") == 0) {
+        if (op && val_tag(op) == T_SYM && strcmp(op->s, "set!") == 0) {
             Value* target = car(args);
-            if (target && target->tag == T_SYM && strcmp(target->s, var) == 0) {
+            if (target && val_tag(target) == T_SYM && strcmp(target->s, var) == 0) {
                 return 0;  // Found mutation
             }
         }
@@ -384,297 +420,989 @@ int is_frozen_after_construction(const char* var, Value* body) {
     return has_no_mutations(var, body);
 }
 
+static int is_let_form(Value* expr) {
+    Value* op = car(expr);
+    return op && val_tag(op) == T_SYM &&
+           (strcmp(op->s, "let") == 0 || strcmp(op->s, "letrec") == 0);
+}
+
+static FreezePoint* let_freeze_points(Value* let_form, FreezePoint* points) {
+    Value* bindings = car(cdr(let_form));
+    Value* body = car(cdr(cdr(let_form)));
+    ShapeContext* shapes = NULL;
+
+    for (; bindings && val_tag(bindings) == T_CELL; bindings = cdr(bindings)) {
+        Value* bind = car(bindings);
+        if (!bind || val_tag(bind) != T_CELL) continue;
+        Value* sym = car(bind);
+        if (!sym || val_tag(sym) != T_SYM || !is_frozen_after_construction(sym->s, body)) continue;
+
+        if (!shapes) {
+            shapes = mk_shape_context();
+            if (!shapes) break;
+            analyze_shapes_expr(let_form, shapes);
+        }
+        FreezePoint* fp = malloc(sizeof(FreezePoint));
+        char* name = strdup(sym->s);
+        if (!fp || !name) {
+            free(fp);
+            free(name);
+            break;
+        }
+        SourcePos pos;
+        ShapeInfo* info = find_shape(shapes, sym->s);
+        fp->line_number = source_pos(bind, &pos) ? pos.line : 0;
+        fp->var_name = name;
+        fp->expr = car(cdr(bind));
+        fp->is_cyclic = info && info->shape == SHAPE_CYCLIC;
+        fp->next = points;
+        points = fp;
+    }
+    if (shapes) free_shape_context(shapes);
+    return points;
+}
+
+static FreezePoint* collect_freeze_points(Value* expr, FreezePoint* points) {
+    if (!expr || val_tag(expr) != T_CELL) return points;
+    if (is_let_form(expr)) points = let_freeze_points(expr, points);
+    for (; expr && val_tag(expr) == T_CELL; expr = cdr(expr)) {
+        points = collect_freeze_points(car(expr), points);
+    }
+    return points;
+}
+
+// Every let/letrec binding in expr that the body never set!s: its graph
+// is final once built, so from there on it can be frozen
 FreezePoint* detect_freeze_points(Value* expr) {
-    (void)expr;  // Not yet used - placeholder for future implementation
-    // TODO: Implement more sophisticated freeze point detection
-    // For now, we detect explicit (freeze x) forms
-    return NULL;
+    return collect_freeze_points(expr, NULL);
+}
+
+void free_freeze_points(FreezePoint* points) {
+    while (points) {
+        FreezePoint* next = points->next;
+        free(points->var_name);
+        free(points);
+        points = next;
+    }
 }
 
 // -- Code Generation --
 
+// Parallel freeze for large graphs, emitted between Tarjan and freeze_cyclic
+static void gen_scc_parallel(void) {
+    emit("// Parallel freezing (standard layout)\n");
+    emit("// Large graphs are frozen by worker threads in phases. Discovery numbers\n");
+    emit("// every new object through its scc_id field (-2 - n while the freeze\n");
+    emit("// runs), in-degree trimming peels off the acyclic part as singleton SCCs,\n");
+    emit("// the rest splits into weakly connected pieces, and each piece runs its\n");
+    emit("// own array Tarjan. The SCCs, their deps and reference counts are those\n");
+    emit("// of the sequential freeze; only the order of the result list after its\n");
+    emit("// head (the root's SCC) differs. Build with -DPURPLE_SCC_SEQUENTIAL to\n");
+    emit("// leave it out.\n");
+    emit("#if !defined(PURPLE_COMPACT_OBJ) && !defined(PURPLE_SCC_SEQUENTIAL)\n");
+    emit("#define SCC_PARALLEL 1\n");
+    emit("#include <pthread.h>\n");
+    emit("#include <unistd.h>\n\n");
+
+    emit("#ifndef SCC_PARALLEL_MIN\n");
+    emit("#define SCC_PARALLEL_MIN 65536   // Graphs smaller than this freeze sequentially\n");
+    emit("#endif\n");
+    emit("#define SCC_MAX_WORKERS 64\n");
+    emit("#define SCC_CLAIMED INT_MIN      // Found by discovery, not numbered yet\n\n");
+
+    emit("static int SCC_WORKERS = 0;      // 0: read PURPLE_SCC_WORKERS / CPU count\n\n");
+
+    emit("// Worker threads for large freezes; 1 freezes sequentially\n");
+    emit("void scc_set_workers(int n) {\n");
+    emit("    SCC_WORKERS = n < 1 ? 1 : n > SCC_MAX_WORKERS ? SCC_MAX_WORKERS : n;\n");
+    emit("}\n\n");
+
+    emit("static int scc_workers(void) {\n");
+    emit("    if (SCC_WORKERS == 0) {\n");
+    emit("        const char* env = getenv(\"PURPLE_SCC_WORKERS\");\n");
+    emit("        long n = env ? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);\n");
+    emit("        scc_set_workers(n > SCC_MAX_WORKERS ? SCC_MAX_WORKERS : (int)n);\n");
+    emit("    }\n");
+    emit("    return SCC_WORKERS;\n");
+    emit("}\n\n");
+
+    emit("typedef struct SCCWorker {\n");
+    emit("    int id;\n");
+    emit("    int count;                   // Number of workers\n");
+    emit("    Obj** found;                 // Objects this worker claimed\n");
+    emit("    size_t found_len, found_cap;\n");
+    emit("    size_t base;                 // Node number of found[0]\n");
+    emit("    int* stack;                  // DFS stack (discovery: Obj* in `objs`)\n");
+    emit("    size_t stack_len, stack_cap;\n");
+    emit("    Obj** objs;\n");
+    emit("    size_t objs_len, objs_cap;\n");
+    emit("    TarjanWorkFrame* work;\n");
+    emit("    size_t work_len, work_cap;\n");
+    emit("    SCC** sccs;                  // Components this worker built\n");
+    emit("    size_t scc_len, scc_cap;\n");
+    emit("    int index;\n");
+    emit("    int oom;\n");
+    emit("} SCCWorker;\n\n");
+
+    emit("static Obj** PAR_NODES = NULL;\n");
+    emit("static int* PAR_INDEG = NULL;    // Remaining in-edges; 0 once trimmed\n");
+    emit("static int* PAR_PARENT = NULL;   // Union-find over the untrimmed nodes\n");
+    emit("static int* PAR_INDEX = NULL;\n");
+    emit("static int* PAR_LOW = NULL;\n");
+    emit("static size_t PAR_COUNT = 0;\n");
+    emit("static SCC* PAR_ROOT_SCC = NULL;\n\n");
+
+    emit("static int par_grow(void** buf, size_t* cap, size_t elem) {\n");
+    emit("    size_t n = *cap ? *cap * 2 : 256;\n");
+    emit("    if (n > SIZE_MAX / elem) return 0;\n");
+    emit("    void* p = realloc(*buf, n * elem);\n");
+    emit("    if (!p) return 0;\n");
+    emit("    *buf = p;\n");
+    emit("    *cap = n;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("// Node number of a new object in this freeze, or -1\n");
+    emit("static int par_node(Obj* o) {\n");
+    emit("    int id = o->scc_id;\n");
+    emit("    return id <= -2 && id != SCC_CLAIMED ? -2 - id : -1;\n");
+    emit("}\n\n");
+
+    emit("static void par_range(SCCWorker* w, size_t* lo, size_t* hi) {\n");
+    emit("    *lo = PAR_COUNT * (size_t)w->id / (size_t)w->count;\n");
+    emit("    *hi = PAR_COUNT * (size_t)(w->id + 1) / (size_t)w->count;\n");
+    emit("}\n\n");
+
+    emit("// Run fn on every worker, worker 0 on the calling thread\n");
+    emit("static void par_run(SCCWorker* w, void* (*fn)(void*)) {\n");
+    emit("    pthread_t threads[SCC_MAX_WORKERS];\n");
+    emit("    int started[SCC_MAX_WORKERS];\n");
+    emit("    for (int i = 1; i < w[0].count; i++) {\n");
+    emit("        started[i] = pthread_create(&threads[i], NULL, fn, &w[i]) == 0;\n");
+    emit("    }\n");
+    emit("    fn(&w[0]);\n");
+    emit("    for (int i = 1; i < w[0].count; i++) {\n");
+    emit("        if (started[i]) pthread_join(threads[i], NULL);\n");
+    emit("        else fn(&w[i]);\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Claim obj for w if no one has; the slot in `found` is reserved first so\n");
+    emit("// a claimed object is always on record\n");
+    emit("static int par_claim(SCCWorker* w, Obj* obj) {\n");
+    emit("    if (w->found_len == w->found_cap &&\n");
+    emit("        !par_grow((void**)&w->found, &w->found_cap, sizeof(Obj*))) { w->oom = 1; return 0; }\n");
+    emit("    int expected = -1;\n");
+    emit("    if (!__atomic_compare_exchange_n(&obj->scc_id, &expected, SCC_CLAIMED, 0,\n");
+    emit("                                     __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return 0;\n");
+    emit("    w->found[w->found_len++] = obj;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("static void* par_discover(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    while (w->objs_len > 0 && !w->oom) {\n");
+    emit("        Obj* o = w->objs[--w->objs_len];\n");
+    emit("        if (!OBJ_IS_PAIR(o)) continue;\n");
+    emit("        Obj* kids[2] = { o->a, o->b };\n");
+    emit("        for (int k = 0; k < 2; k++) {\n");
+    emit("            if (!kids[k] || !par_claim(w, kids[k])) continue;\n");
+    emit("            if (w->objs_len == w->objs_cap &&\n");
+    emit("                !par_grow((void**)&w->objs, &w->objs_cap, sizeof(Obj*))) { w->oom = 1; break; }\n");
+    emit("            w->objs[w->objs_len++] = kids[k];\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static void* par_number(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    for (size_t i = 0; i < w->found_len; i++) {\n");
+    emit("        size_t n = w->base + i;\n");
+    emit("        PAR_NODES[n] = w->found[i];\n");
+    emit("        w->found[i]->scc_id = -2 - (int)n;\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static void* par_count_edges(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    size_t lo, hi;\n");
+    emit("    par_range(w, &lo, &hi);\n");
+    emit("    for (size_t n = lo; n < hi; n++) {\n");
+    emit("        Obj* o = PAR_NODES[n];\n");
+    emit("        if (!OBJ_IS_PAIR(o)) continue;\n");
+    emit("        int m = o->a ? par_node(o->a) : -1;\n");
+    emit("        if (m >= 0) __atomic_fetch_add(&PAR_INDEG[m], 1, __ATOMIC_RELAXED);\n");
+    emit("        m = o->b ? par_node(o->b) : -1;\n");
+    emit("        if (m >= 0) __atomic_fetch_add(&PAR_INDEG[m], 1, __ATOMIC_RELAXED);\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("// New SCC from nodes[0..count) (node numbers), kept by w\n");
+    emit("static SCC* par_make_scc(SCCWorker* w, const int* nodes, size_t count) {\n");
+    emit("    size_t dep_count = 0;\n");
+    emit("    for (size_t i = 0; i < count; i++) {\n");
+    emit("        Obj* m = PAR_NODES[nodes[i]];\n");
+    emit("        if (!OBJ_IS_PAIR(m)) continue;\n");
+    emit("        if (m->a && frozen_scc_of(m->a)) dep_count++;\n");
+    emit("        if (m->b && frozen_scc_of(m->b)) dep_count++;\n");
+    emit("    }\n");
+    emit("    if (w->scc_len == w->scc_cap &&\n");
+    emit("        !par_grow((void**)&w->sccs, &w->scc_cap, sizeof(SCC*))) { w->oom = 1; return NULL; }\n");
+    emit("    SCC* scc = malloc(sizeof(SCC));\n");
+    emit("    if (!scc) { w->oom = 1; return NULL; }\n");
+    emit("    scc->members = count == 1 ? &scc->solo : malloc(count * sizeof(Obj*));\n");
+    emit("    scc->deps = dep_count ? malloc(dep_count * sizeof(SCC*)) : NULL;\n");
+    emit("    if (!scc->members || (dep_count && !scc->deps)) {\n");
+    emit("        if (scc->members != &scc->solo) free(scc->members);\n");
+    emit("        free(scc->deps);\n");
+    emit("        free(scc);\n");
+    emit("        w->oom = 1;\n");
+    emit("        return NULL;\n");
+    emit("    }\n");
+    emit("    scc->id = -1;\n");
+    emit("    scc->member_count = (int)count;\n");
+    emit("    scc->capacity = (int)count;\n");
+    emit("    scc->ref_count = 1;\n");
+    emit("    scc->next = NULL;\n");
+    emit("    scc->result_next = NULL;\n");
+    emit("    scc->epoch = SCC_EPOCH;\n");
+    emit("    scc->dep_count = 0;\n");
+    emit("    for (size_t i = 0; i < count; i++) {\n");
+    emit("        Obj* m = PAR_NODES[nodes[i]];\n");
+    emit("        scc->members[i] = m;\n");
+    emit("        if (nodes[i] == 0) PAR_ROOT_SCC = scc;\n");
+    emit("        if (!OBJ_IS_PAIR(m)) continue;\n");
+    emit("        SCC* d = m->a ? frozen_scc_of(m->a) : NULL;\n");
+    emit("        if (d) scc->deps[scc->dep_count++] = d;\n");
+    emit("        d = m->b ? frozen_scc_of(m->b) : NULL;\n");
+    emit("        if (d) scc->deps[scc->dep_count++] = d;\n");
+    emit("    }\n");
+    emit("    w->sccs[w->scc_len++] = scc;\n");
+    emit("    return scc;\n");
+    emit("}\n\n");
+
+    emit("static void* par_find_sources(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    size_t lo, hi;\n");
+    emit("    par_range(w, &lo, &hi);\n");
+    emit("    w->stack_len = 0;\n");
+    emit("    for (size_t n = lo; n < hi; n++) {\n");
+    emit("        PAR_PARENT[n] = (int)n;\n");
+    emit("        PAR_INDEX[n] = -1;\n");
+    emit("        if (PAR_INDEG[n] != 0) continue;\n");
+    emit("        if (w->stack_len == w->stack_cap &&\n");
+    emit("            !par_grow((void**)&w->stack, &w->stack_cap, sizeof(int))) { w->oom = 1; return NULL; }\n");
+    emit("        w->stack[w->stack_len++] = (int)n;\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("// Peel off nodes no remaining edge points to: each is its own SCC\n");
+    emit("static void* par_trim(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    while (w->stack_len > 0 && !w->oom) {\n");
+    emit("        int n = w->stack[--w->stack_len];\n");
+    emit("        if (!par_make_scc(w, &n, 1)) return NULL;\n");
+    emit("        Obj* o = PAR_NODES[n];\n");
+    emit("        if (!OBJ_IS_PAIR(o)) continue;\n");
+    emit("        Obj* kids[2] = { o->a, o->b };\n");
+    emit("        for (int k = 0; k < 2; k++) {\n");
+    emit("            int m = kids[k] ? par_node(kids[k]) : -1;\n");
+    emit("            if (m < 0 || __atomic_sub_fetch(&PAR_INDEG[m], 1, __ATOMIC_RELAXED) != 0) continue;\n");
+    emit("            if (w->stack_len == w->stack_cap &&\n");
+    emit("                !par_grow((void**)&w->stack, &w->stack_cap, sizeof(int))) { w->oom = 1; return NULL; }\n");
+    emit("            w->stack[w->stack_len++] = m;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static int uf_find(int x) {\n");
+    emit("    for (;;) {\n");
+    emit("        int p = __atomic_load_n(&PAR_PARENT[x], __ATOMIC_RELAXED);\n");
+    emit("        if (p == x) return x;\n");
+    emit("        int gp = __atomic_load_n(&PAR_PARENT[p], __ATOMIC_RELAXED);\n");
+    emit("        if (gp != p) __atomic_compare_exchange_n(&PAR_PARENT[x], &p, gp, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);\n");
+    emit("        x = gp;\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Roots only ever link to smaller roots, so no cycle can form\n");
+    emit("static void uf_union(int a, int b) {\n");
+    emit("    for (;;) {\n");
+    emit("        a = uf_find(a);\n");
+    emit("        b = uf_find(b);\n");
+    emit("        if (a == b) return;\n");
+    emit("        if (a < b) { int t = a; a = b; b = t; }\n");
+    emit("        int expected = a;\n");
+    emit("        if (__atomic_compare_exchange_n(&PAR_PARENT[a], &expected, b, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) return;\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("static void* par_connect(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    size_t lo, hi;\n");
+    emit("    par_range(w, &lo, &hi);\n");
+    emit("    for (size_t n = lo; n < hi; n++) {\n");
+    emit("        Obj* o = PAR_NODES[n];\n");
+    emit("        if (PAR_INDEG[n] == 0 || !OBJ_IS_PAIR(o)) continue;\n");
+    emit("        int m = o->a ? par_node(o->a) : -1;\n");
+    emit("        if (m >= 0) uf_union((int)n, m);\n");
+    emit("        m = o->b ? par_node(o->b) : -1;\n");
+    emit("        if (m >= 0) uf_union((int)n, m);\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static void* par_flatten(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    size_t lo, hi;\n");
+    emit("    par_range(w, &lo, &hi);\n");
+    emit("    for (size_t n = lo; n < hi; n++) {\n");
+    emit("        if (PAR_INDEG[n] != 0) __atomic_store_n(&PAR_PARENT[n], uf_find((int)n), __ATOMIC_RELAXED);\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("// Follow the edge v -> child within a piece: as tarjan_edge\n");
+    emit("static int par_edge(SCCWorker* w, int v, Obj* child) {\n");
+    emit("    int c = par_node(child);\n");
+    emit("    if (c < 0 || PAR_INDEG[c] == 0) return -1;\n");
+    emit("    if (PAR_INDEX[c] < 0) {\n");
+    emit("        if (w->work_len == w->work_cap &&\n");
+    emit("            !par_grow((void**)&w->work, &w->work_cap, sizeof(TarjanWorkFrame))) { w->oom = 1; return -2; }\n");
+    emit("        TarjanWorkFrame* f = &w->work[w->work_len++];\n");
+    emit("        f->node = c;\n");
+    emit("        f->child = -1;\n");
+    emit("        f->state = TARJAN_INIT;\n");
+    emit("        return c;\n");
+    emit("    }\n");
+    emit("    // On this worker's stack exactly when it has no SCC yet (lowlink >= 0)\n");
+    emit("    if (PAR_LOW[c] >= 0 && PAR_LOW[v] > PAR_INDEX[c]) PAR_LOW[v] = PAR_INDEX[c];\n");
+    emit("    return -1;\n");
+    emit("}\n\n");
+
+    emit("static void par_strongconnect(SCCWorker* w, int root) {\n");
+    emit("    w->work_len = 0;\n");
+    emit("    if (par_edge(w, root, PAR_NODES[root]) < 0) return;\n");
+    emit("    while (w->work_len > 0 && !w->oom) {\n");
+    emit("        size_t top = w->work_len - 1;\n");
+    emit("        int v = w->work[top].node;\n");
+    emit("        Obj* obj = PAR_NODES[v];\n");
+    emit("        int child = w->work[top].child;\n");
+    emit("        // A child that closed its own SCC has lowlink -1 and passes nothing up\n");
+    emit("        if (child >= 0 && PAR_LOW[child] >= 0 && PAR_LOW[v] > PAR_LOW[child]) PAR_LOW[v] = PAR_LOW[child];\n");
+    emit("        w->work[top].child = -1;\n\n");
+
+    emit("        switch (w->work[top].state) {\n");
+    emit("        case TARJAN_INIT:\n");
+    emit("            PAR_INDEX[v] = PAR_LOW[v] = w->index++;\n");
+    emit("            if (w->stack_len == w->stack_cap &&\n");
+    emit("                !par_grow((void**)&w->stack, &w->stack_cap, sizeof(int))) { w->oom = 1; return; }\n");
+    emit("            w->stack[w->stack_len++] = v;\n");
+    emit("            w->work[top].state = TARJAN_AFTER_A;\n");
+    emit("            if (OBJ_IS_PAIR(obj) && obj->a) {\n");
+    emit("                child = par_edge(w, v, obj->a);\n");
+    emit("                if (child == -2) return;\n");
+    emit("                w->work[top].child = child;\n");
+    emit("            }\n");
+    emit("            break;\n\n");
+
+    emit("        case TARJAN_AFTER_A:\n");
+    emit("            w->work[top].state = TARJAN_AFTER_B;\n");
+    emit("            if (OBJ_IS_PAIR(obj) && obj->b) {\n");
+    emit("                child = par_edge(w, v, obj->b);\n");
+    emit("                if (child == -2) return;\n");
+    emit("                w->work[top].child = child;\n");
+    emit("            }\n");
+    emit("            break;\n\n");
+
+    emit("        case TARJAN_AFTER_B:\n");
+    emit("            if (PAR_LOW[v] == PAR_INDEX[v]) {\n");
+    emit("                size_t start = w->stack_len;\n");
+    emit("                while (start > 0 && w->stack[--start] != v) {}\n");
+    emit("                if (!par_make_scc(w, &w->stack[start], w->stack_len - start)) return;\n");
+    emit("                // Done: -1 marks off-stack for later edges into it\n");
+    emit("                for (size_t i = start; i < w->stack_len; i++) PAR_LOW[w->stack[i]] = -1;\n");
+    emit("                w->stack_len = start;\n");
+    emit("            }\n");
+    emit("            w->work_len--;\n");
+    emit("            break;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("// Tarjan over the pieces this worker owns (piece root %% workers)\n");
+    emit("static void* par_tarjan(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    w->stack_len = 0;\n");
+    emit("    w->index = 0;\n");
+    emit("    for (size_t n = 0; n < PAR_COUNT && !w->oom; n++) {\n");
+    emit("        if (PAR_INDEG[n] == 0 || (size_t)PAR_PARENT[n] %% (size_t)w->count != (size_t)w->id) continue;\n");
+    emit("        if (PAR_INDEX[n] >= 0) continue;\n");
+    emit("        par_strongconnect(w, (int)n);\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static void* par_publish(void* arg) {\n");
+    emit("    SCCWorker* w = arg;\n");
+    emit("    for (size_t i = 0; i < w->scc_len; i++) {\n");
+    emit("        SCC* scc = w->sccs[i];\n");
+    emit("        for (int j = 0; j < scc->member_count; j++) scc->members[j]->scc_id = scc->id;\n");
+    emit("    }\n");
+    emit("    return NULL;\n");
+    emit("}\n\n");
+
+    emit("static void par_cleanup(SCCWorker* w, int workers) {\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        free(w[i].found);\n");
+    emit("        free(w[i].stack);\n");
+    emit("        free(w[i].objs);\n");
+    emit("        free(w[i].work);\n");
+    emit("        free(w[i].sccs);\n");
+    emit("    }\n");
+    emit("    free(w);\n");
+    emit("    free(PAR_NODES);\n");
+    emit("    free(PAR_INDEG);\n");
+    emit("    free(PAR_PARENT);\n");
+    emit("    free(PAR_INDEX);\n");
+    emit("    free(PAR_LOW);\n");
+    emit("    PAR_NODES = NULL;\n");
+    emit("    PAR_INDEG = PAR_PARENT = PAR_INDEX = PAR_LOW = NULL;\n");
+    emit("    PAR_COUNT = 0;\n");
+    emit("    PAR_ROOT_SCC = NULL;\n");
+    emit("}\n\n");
+
+    emit("// Undo a freeze that could not finish: objects are unclaimed, nothing\n");
+    emit("// built is kept\n");
+    emit("static void par_abort(SCCWorker* w, int workers) {\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        for (size_t j = 0; j < w[i].found_len; j++) w[i].found[j]->scc_id = -1;\n");
+    emit("        for (size_t j = 0; j < w[i].scc_len; j++) {\n");
+    emit("            SCC* scc = w[i].sccs[j];\n");
+    emit("            if (scc->id >= 0) {\n");
+    emit("                scc_unregister(scc);\n");
+    emit("                for (int k = 0; k < scc->dep_count; k++) scc->deps[k]->ref_count--;\n");
+    emit("            }\n");
+    emit("            if (scc->members != &scc->solo) free(scc->members);\n");
+    emit("            free(scc->deps);\n");
+    emit("            free(scc);\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    par_cleanup(w, workers);\n");
+    emit("}\n\n");
+
+    emit("// Freeze root's graph in parallel; *done is 0 when the graph is small or\n");
+    emit("// memory ran out, and the caller should freeze sequentially\n");
+    emit("static SCC* freeze_parallel(Obj* root, int workers, int* done) {\n");
+    emit("    *done = 0;\n");
+    emit("    SCCWorker* w = calloc((size_t)workers, sizeof(SCCWorker));\n");
+    emit("    if (!w) return NULL;\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        w[i].id = i;\n");
+    emit("        w[i].count = workers;\n");
+    emit("    }\n\n");
+
+    emit("    // Breadth-first from the root until the graph is known to be large;\n");
+    emit("    // the unexpanded frontier is dealt out to the workers\n");
+    emit("    if (!par_claim(&w[0], root)) { par_abort(w, workers); return NULL; }\n");
+    emit("    size_t head = 0;\n");
+    emit("    while (head < w[0].found_len && w[0].found_len < SCC_PARALLEL_MIN && !w[0].oom) {\n");
+    emit("        Obj* o = w[0].found[head++];\n");
+    emit("        if (!OBJ_IS_PAIR(o)) continue;\n");
+    emit("        if (o->a) par_claim(&w[0], o->a);\n");
+    emit("        if (o->b) par_claim(&w[0], o->b);\n");
+    emit("    }\n");
+    emit("    if (head == w[0].found_len || w[0].oom) {\n");
+    emit("        par_abort(w, workers);\n");
+    emit("        return NULL;\n");
+    emit("    }\n");
+    emit("    for (size_t i = head; i < w[0].found_len; i++) {\n");
+    emit("        SCCWorker* t = &w[i %% (size_t)workers];\n");
+    emit("        if (t->objs_len == t->objs_cap &&\n");
+    emit("            !par_grow((void**)&t->objs, &t->objs_cap, sizeof(Obj*))) { par_abort(w, workers); return NULL; }\n");
+    emit("        t->objs[t->objs_len++] = w[0].found[i];\n");
+    emit("    }\n");
+    emit("    par_run(w, par_discover);\n\n");
+
+    emit("    size_t total = 0;\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        if (w[i].oom) { par_abort(w, workers); return NULL; }\n");
+    emit("        w[i].base = total;\n");
+    emit("        total += w[i].found_len;\n");
+    emit("    }\n");
+    emit("    if (total > (size_t)INT_MAX - 2) { par_abort(w, workers); return NULL; }\n");
+    emit("    PAR_COUNT = total;\n");
+    emit("    PAR_NODES = malloc(total * sizeof(Obj*));\n");
+    emit("    PAR_INDEG = calloc(total, sizeof(int));\n");
+    emit("    PAR_PARENT = malloc(total * sizeof(int));\n");
+    emit("    PAR_INDEX = malloc(total * sizeof(int));\n");
+    emit("    PAR_LOW = malloc(total * sizeof(int));\n");
+    emit("    if (!PAR_NODES || !PAR_INDEG || !PAR_PARENT || !PAR_INDEX || !PAR_LOW) {\n");
+    emit("        par_abort(w, workers);\n");
+    emit("        return NULL;\n");
+    emit("    }\n\n");
+
+    emit("    par_run(w, par_number);\n");
+    emit("    par_run(w, par_count_edges);\n");
+    emit("    par_run(w, par_find_sources);\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        if (w[i].oom) { par_abort(w, workers); return NULL; }\n");
+    emit("    }\n");
+    emit("    par_run(w, par_trim);\n");
+    emit("    par_run(w, par_connect);\n");
+    emit("    par_run(w, par_flatten);\n");
+    emit("    par_run(w, par_tarjan);\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        if (w[i].oom) { par_abort(w, workers); return NULL; }\n");
+    emit("    }\n\n");
+
+    emit("    // Ids and references are handed out on one thread; the root's SCC\n");
+    emit("    // goes last so it heads the result list\n");
+    emit("    SCC* result = NULL;\n");
+    emit("    for (int i = 0; i < workers; i++) {\n");
+    emit("        for (size_t j = 0; j < w[i].scc_len; j++) {\n");
+    emit("            SCC* scc = w[i].sccs[j];\n");
+    emit("            if (!scc_register(scc)) { par_abort(w, workers); return NULL; }\n");
+    emit("            for (int k = 0; k < scc->dep_count; k++) scc->deps[k]->ref_count++;\n");
+    emit("            if (scc == PAR_ROOT_SCC) continue;\n");
+    emit("            scc->result_next = result;\n");
+    emit("            result = scc;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    PAR_ROOT_SCC->result_next = result;\n");
+    emit("    result = PAR_ROOT_SCC;\n");
+    emit("    par_run(w, par_publish);\n\n");
+
+    emit("    par_cleanup(w, workers);\n");
+    emit("    *done = 1;\n");
+    emit("    return result;\n");
+    emit("}\n");
+    emit("#endif\n\n");
+}
+
 void gen_scc_runtime(void) {
-    printf("\n// Phase 6b: SCC-based RC Runtime (ISMM 2024)\n");
-    printf("// Reference Counting Deeply Immutable Data Structures with Cycles\n\n");
-
-    printf("typedef struct SCC {\n");
-    printf("    int id;\n");
-    printf("    Obj** members;\n");
-    printf("    int member_count;\n");
-    printf("    int capacity;\n");
-    printf("    int ref_count;\n");
-    printf("    struct SCC* next;\n");
-    printf("    struct SCC* result_next;\n");
-    printf("} SCC;\n\n");
-
-    printf("static int SCC_NEXT_ID = 0;\n\n");
-
-    printf("// Tarjan's algorithm for SCC computation\n");
-    printf("typedef struct TarjanNode {\n");
-    printf("    Obj* obj;\n");
-    printf("    int index;\n");
-    printf("    int lowlink;\n");
-    printf("    int on_stack;\n");
-    printf("    struct TarjanNode* next;      // For linked list cleanup\n");
-    printf("    struct TarjanNode* hash_next; // For hash bucket chain\n");
-    printf("} TarjanNode;\n\n");
-
-    printf("typedef struct TarjanStack {\n");
-    printf("    Obj* obj;\n");
-    printf("    struct TarjanStack* next;\n");
-    printf("} TarjanStack;\n\n");
-
-    printf("#define TARJAN_HASH_SIZE 1024\n");
-    printf("TarjanNode* TARJAN_HASH[TARJAN_HASH_SIZE];\n");
-    printf("TarjanNode* TARJAN_NODES = NULL;\n");
-    printf("TarjanStack* TARJAN_STACK = NULL;\n");
-    printf("int TARJAN_INDEX = 0;\n\n");
-    printf("int TARJAN_OOM = 0;\n\n");
-
-    printf("static size_t tarjan_hash_ptr(void* p) {\n");
-    printf("    size_t x = (size_t)p;\n");
-    printf("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
-    printf("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
-    printf("    return (x >> 16) ^ x;\n");
-    printf("}\n\n");
-
-    printf("TarjanNode* get_tarjan_node(Obj* obj) {\n");
-    printf("    size_t idx = tarjan_hash_ptr(obj) %% TARJAN_HASH_SIZE;\n");
-    printf("    TarjanNode* n = TARJAN_HASH[idx];\n");
-    printf("    while (n) {\n");
-    printf("        if (n->obj == obj) return n;\n");
-    printf("        n = n->hash_next;\n");
-    printf("    }\n");
-    printf("    // Create new node\n");
-    printf("    n = malloc(sizeof(TarjanNode));\n");
-    printf("    if (!n) { TARJAN_OOM = 1; return NULL; }\n");
-    printf("    n->obj = obj;\n");
-    printf("    n->index = -1;\n");
-    printf("    n->lowlink = -1;\n");
-    printf("    n->on_stack = 0;\n");
-    printf("    n->next = TARJAN_NODES;\n");
-    printf("    n->hash_next = TARJAN_HASH[idx];\n");
-    printf("    TARJAN_NODES = n;\n");
-    printf("    TARJAN_HASH[idx] = n;\n");
-    printf("    return n;\n");
-    printf("}\n\n");
-
-    printf("void tarjan_stack_push(Obj* obj) {\n");
-    printf("    TarjanStack* s = malloc(sizeof(TarjanStack));\n");
-    printf("    if (!s) { TARJAN_OOM = 1; return; }\n");
-    printf("    s->obj = obj;\n");
-    printf("    s->next = TARJAN_STACK;\n");
-    printf("    TARJAN_STACK = s;\n");
-    printf("}\n\n");
-
-    printf("Obj* tarjan_stack_pop(void) {\n");
-    printf("    if (!TARJAN_STACK) return NULL;\n");
-    printf("    TarjanStack* s = TARJAN_STACK;\n");
-    printf("    Obj* obj = s->obj;\n");
-    printf("    TARJAN_STACK = s->next;\n");
-    printf("    free(s);\n");
-    printf("    return obj;\n");
-    printf("}\n\n");
-
-    printf("void reset_tarjan_state(void) {\n");
-    printf("    TarjanNode* n = TARJAN_NODES;\n");
-    printf("    while (n) {\n");
-    printf("        TarjanNode* next = n->next;\n");
-    printf("        free(n);\n");
-    printf("        n = next;\n");
-    printf("    }\n");
-    printf("    TARJAN_NODES = NULL;\n");
-    printf("    // Clear hash table\n");
-    printf("    for (int i = 0; i < TARJAN_HASH_SIZE; i++) TARJAN_HASH[i] = NULL;\n");
-    printf("    while (TARJAN_STACK) {\n");
-    printf("        TarjanStack* s = TARJAN_STACK;\n");
-    printf("        TARJAN_STACK = s->next;\n");
-    printf("        free(s);\n");
-    printf("    }\n");
-    printf("    TARJAN_INDEX = 0;\n");
-    printf("    TARJAN_OOM = 0;\n");
-    printf("}\n\n");
-
-    // Generate iterative tarjan_strongconnect implementation
-    printf("typedef enum { TARJAN_INIT, TARJAN_AFTER_A, TARJAN_AFTER_B, TARJAN_DONE } TarjanState;\n\n");
-    
-    printf("typedef struct TarjanWorkFrame {\n");
-    printf("    Obj* v;\n");
-    printf("    TarjanNode* node;\n");
-    printf("    TarjanState state;\n");
-    printf("    int pushed_a;\n");
-    printf("    int pushed_b;\n");
-    printf("    struct TarjanWorkFrame* next;\n");
-    printf("} TarjanWorkFrame;\n\n");
-
-    printf("static int push_work_frame(TarjanWorkFrame** stack, Obj* v, TarjanState state) {\n");
-    printf("    TarjanWorkFrame* f = malloc(sizeof(TarjanWorkFrame));\n");
-    printf("    if (!f) { TARJAN_OOM = 1; return 0; }\n");
-    printf("    f->v = v;\n");
-    printf("    f->node = NULL;\n");
-    printf("    f->state = state;\n");
-    printf("    f->pushed_a = 0;\n");
-    printf("    f->pushed_b = 0;\n");
-    printf("    f->next = *stack;\n");
-    printf("    *stack = f;\n");
-    printf("    return 1;\n");
-    printf("}\n\n");
-
-    printf("static TarjanWorkFrame* pop_work_frame(TarjanWorkFrame** stack) {\n");
-    printf("    if (!*stack) return NULL;\n");
-    printf("    TarjanWorkFrame* f = *stack;\n");
-    printf("    *stack = f->next;\n");
-    printf("    return f;\n");
-    printf("}\n\n");
-
-    printf("void tarjan_strongconnect(Obj* root_obj, SCC** result) {\n");
-    printf("    if (!root_obj) return;\n");
-    printf("    TarjanWorkFrame* work_stack = NULL;\n");
-    printf("    if (!push_work_frame(&work_stack, root_obj, TARJAN_INIT)) return;\n\n");
-
-    printf("    while (work_stack) {\n");
-    printf("        TarjanWorkFrame* frame = work_stack;\n");
-    printf("        Obj* v = frame->v;\n\n");
-    printf("        if (TARJAN_OOM) {\n");
-    printf("            while (work_stack) { free(pop_work_frame(&work_stack)); }\n");
-    printf("            return;\n");
-    printf("        }\n\n");
-
-    printf("        switch (frame->state) {\n");
-    printf("        case TARJAN_INIT: {\n");
-    printf("            TarjanNode* node = get_tarjan_node(v);\n");
-    printf("            if (!node) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("            if (node->index >= 0) {\n");
-    printf("                free(pop_work_frame(&work_stack));\n");
-    printf("                break;\n");
-    printf("            }\n");
-    printf("            node->index = TARJAN_INDEX;\n");
-    printf("            node->lowlink = TARJAN_INDEX;\n");
-    printf("            TARJAN_INDEX++;\n");
-    printf("            tarjan_stack_push(v);\n");
-    printf("            if (TARJAN_OOM) { while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("            node->on_stack = 1;\n");
-    printf("            frame->node = node;\n");
-    printf("            frame->state = TARJAN_AFTER_A;\n\n");
-
-    printf("            if (v->is_pair && v->a) {\n");
-    printf("                TarjanNode* w = get_tarjan_node(v->a);\n");
-    printf("                if (!w) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                if (w->index < 0) {\n");
-    printf("                    frame->pushed_a = 1;\n");
-    printf("                    if (!push_work_frame(&work_stack, v->a, TARJAN_INIT)) { while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                } else if (w->on_stack) {\n");
-    printf("                    if (node->lowlink > w->index) node->lowlink = w->index;\n");
-    printf("                }\n");
-    printf("            }\n");
-    printf("            break;\n");
-    printf("        }\n\n");
-
-    printf("        case TARJAN_AFTER_A: {\n");
-    printf("            TarjanNode* node = frame->node;\n");
-    printf("            if (frame->pushed_a && v->is_pair && v->a) {\n");
-    printf("                TarjanNode* w = get_tarjan_node(v->a);\n");
-    printf("                if (!w) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                if (node->lowlink > w->lowlink) node->lowlink = w->lowlink;\n");
-    printf("            }\n");
-    printf("            frame->state = TARJAN_AFTER_B;\n\n");
-
-    printf("            if (v->is_pair && v->b) {\n");
-    printf("                TarjanNode* w = get_tarjan_node(v->b);\n");
-    printf("                if (!w) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                if (w->index < 0) {\n");
-    printf("                    frame->pushed_b = 1;\n");
-    printf("                    if (!push_work_frame(&work_stack, v->b, TARJAN_INIT)) { while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                } else if (w->on_stack) {\n");
-    printf("                    if (node->lowlink > w->index) node->lowlink = w->index;\n");
-    printf("                }\n");
-    printf("            }\n");
-    printf("            break;\n");
-    printf("        }\n\n");
-
-    printf("        case TARJAN_AFTER_B: {\n");
-    printf("            TarjanNode* node = frame->node;\n");
-    printf("            if (frame->pushed_b && v->is_pair && v->b) {\n");
-    printf("                TarjanNode* w = get_tarjan_node(v->b);\n");
-    printf("                if (!w) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                if (node->lowlink > w->lowlink) node->lowlink = w->lowlink;\n");
-    printf("            }\n\n");
-
-    printf("            if (node->lowlink == node->index) {\n");
-    printf("                SCC* scc = malloc(sizeof(SCC));\n");
-    printf("                if (!scc) { TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                scc->id = SCC_NEXT_ID++;\n");
-    printf("                scc->members = malloc(16 * sizeof(Obj*));\n");
-    printf("                if (!scc->members) { free(scc); TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                scc->member_count = 0;\n");
-    printf("                scc->capacity = 16;\n");
-    printf("                scc->ref_count = 1;\n");
-    printf("                scc->next = NULL;\n");
-    printf("                scc->result_next = *result;\n");
-    printf("                *result = scc;\n\n");
-
-    printf("                Obj* w;\n");
-    printf("                do {\n");
-    printf("                    w = tarjan_stack_pop();\n");
-    printf("                    if (!w) break;\n");
-    printf("                    TarjanNode* w_node = get_tarjan_node(w);\n");
-    printf("                    if (!w_node) break;\n");
-    printf("                    w_node->on_stack = 0;\n");
-    printf("                    w->scc_id = scc->id;\n");
-    printf("                    if (scc->member_count >= scc->capacity) {\n");
-    printf("                        if (scc->capacity > INT_MAX / 2) { free(scc->members); free(scc); TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                        scc->capacity *= 2;\n");
-    printf("                        Obj** new_members = realloc(scc->members, scc->capacity * sizeof(Obj*));\n");
-    printf("                        if (!new_members) { free(scc->members); free(scc); TARJAN_OOM = 1; while (work_stack) { free(pop_work_frame(&work_stack)); } return; }\n");
-    printf("                        scc->members = new_members;\n");
-    printf("                    }\n");
-    printf("                    scc->members[scc->member_count++] = w;\n");
-    printf("                } while (w != v);\n");
-    printf("            }\n");
-    printf("            free(pop_work_frame(&work_stack));\n");
-    printf("            break;\n");
-    printf("        }\n\n");
-    
-    printf("        case TARJAN_DONE:\n");
-    printf("            free(pop_work_frame(&work_stack));\n");
-    printf("            break;\n");
-    printf("        }\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("SCC* freeze_cyclic(Obj* root) {\n");
-    printf("    // Reset Tarjan state\n");
-    printf("    reset_tarjan_state();\n");
-    printf("    \n");
-    printf("    SCC* sccs = NULL;\n");
-    printf("    tarjan_strongconnect(root, &sccs);\n");
-    printf("    // Always clean up Tarjan state to prevent memory leak\n");
-    printf("    reset_tarjan_state();\n");
-    printf("    return sccs;\n");
-    printf("}\n\n");
-
-    printf("void release_scc(SCC* scc) {\n");
-    printf("    if (!scc) return;\n");
-    printf("    scc->ref_count--;\n");
-    printf("    if (scc->ref_count == 0) {\n");
-    printf("        for (int i = 0; i < scc->member_count; i++) {\n");
-    printf("            invalidate_weak_refs_for(scc->members[i]);\n");
-    printf("            free(scc->members[i]);\n");
-    printf("        }\n");
-    printf("        free(scc->members);\n");
-    printf("        free(scc);\n");
-    printf("    }\n");
-    printf("}\n\n");
-
-    printf("void inc_scc_ref(SCC* scc) {\n");
-    printf("    if (scc) scc->ref_count++;\n");
-    printf("}\n\n");
+    emit("\n// Phase 6b: SCC-based RC Runtime (ISMM 2024)\n");
+    emit("// Reference Counting Deeply Immutable Data Structures with Cycles\n\n");
+
+    emit("typedef struct SCC {\n");
+    emit("    int id;\n");
+    emit("    Obj** members;\n");
+    emit("    int member_count;\n");
+    emit("    int capacity;\n");
+    emit("    int ref_count;\n");
+    emit("    struct SCC* next;\n");
+    emit("    struct SCC* result_next;\n");
+    emit("    Obj* solo;     // Member storage for single-object SCCs\n");
+    emit("    int epoch;     // freeze_cyclic call that built it\n");
+    emit("    struct SCC** deps;  // Older frozen SCCs its members point into, one per edge\n");
+    emit("    int dep_count;\n");
+    emit("} SCC;\n\n");
+
+    emit("// Live SCCs by id: ids of released SCCs are reused, so the table stays\n");
+    emit("// as large as the most SCCs alive at once\n");
+    emit("static SCC** SCC_TABLE = NULL;\n");
+    emit("static int SCC_TABLE_CAP = 0;\n");
+    emit("static int* SCC_FREE_IDS = NULL;\n");
+    emit("static int SCC_FREE_COUNT = 0;\n");
+    emit("static int SCC_FREE_CAP = 0;\n");
+    emit("static int SCC_NEXT_ID = 0;\n");
+    emit("static int SCC_EPOCH = 0;\n\n");
+
+    emit("// Give scc an id; 0 on OOM\n");
+    emit("static int scc_register(SCC* scc) {\n");
+    emit("    int id;\n");
+    emit("    if (SCC_FREE_COUNT > 0) {\n");
+    emit("        id = SCC_FREE_IDS[--SCC_FREE_COUNT];\n");
+    emit("    } else {\n");
+    emit("        if (SCC_NEXT_ID == INT_MAX) return 0;\n");
+    emit("        if (SCC_NEXT_ID == SCC_TABLE_CAP) {\n");
+    emit("            if (SCC_TABLE_CAP > INT_MAX / 2) return 0;\n");
+    emit("            int cap = SCC_TABLE_CAP ? SCC_TABLE_CAP * 2 : 256;\n");
+    emit("            SCC** table = realloc(SCC_TABLE, (size_t)cap * sizeof(SCC*));\n");
+    emit("            if (!table) return 0;\n");
+    emit("            SCC_TABLE = table;\n");
+    emit("            SCC_TABLE_CAP = cap;\n");
+    emit("        }\n");
+    emit("        id = SCC_NEXT_ID++;\n");
+    emit("    }\n");
+    emit("    SCC_TABLE[id] = scc;\n");
+    emit("    scc->id = id;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("static void scc_unregister(SCC* scc) {\n");
+    emit("    SCC_TABLE[scc->id] = NULL;\n");
+    emit("    if (SCC_FREE_COUNT == SCC_FREE_CAP) {\n");
+    emit("        int cap = SCC_FREE_CAP ? SCC_FREE_CAP * 2 : 256;\n");
+    emit("        int* ids = SCC_FREE_CAP > INT_MAX / 2 ? NULL : realloc(SCC_FREE_IDS, (size_t)cap * sizeof(int));\n");
+    emit("        if (!ids) return;  // The id is simply not reused\n");
+    emit("        SCC_FREE_IDS = ids;\n");
+    emit("        SCC_FREE_CAP = cap;\n");
+    emit("    }\n");
+    emit("    SCC_FREE_IDS[SCC_FREE_COUNT++] = scc->id;\n");
+    emit("}\n\n");
+
+    emit("// SCC of an object frozen by an earlier freeze_cyclic, or NULL. Such\n");
+    emit("// components are opaque: a new freeze stops at them and references them\n");
+    emit("// as a whole instead of walking the frozen base again\n");
+    emit("static SCC* frozen_scc_of(Obj* obj) {\n");
+    emit("    int id = OBJ_SCC_ID(obj);\n");
+    emit("    if (id < 0 || id >= SCC_NEXT_ID) return NULL;\n");
+    emit("    SCC* scc = SCC_TABLE[id];\n");
+    emit("    return scc && scc->epoch != SCC_EPOCH ? scc : NULL;\n");
+    emit("}\n\n");
+
+    emit("// Tarjan's algorithm for SCC computation\n");
+    emit("// Per-object state lives in one growable array, found through an\n");
+    emit("// open-addressing index on the object address. The DFS work stack and\n");
+    emit("// the Tarjan stack are arrays of node numbers; all four buffers are\n");
+    emit("// reused across freeze_cyclic calls, so a freeze costs O(nodes + edges)\n");
+    emit("// with no allocation per node.\n");
+    emit("typedef struct TarjanNode {\n");
+    emit("    Obj* obj;\n");
+    emit("    int index;\n");
+    emit("    int lowlink;\n");
+    emit("    int on_stack;\n");
+    emit("} TarjanNode;\n\n");
+
+    emit("typedef struct TarjanSlot {\n");
+    emit("    Obj* obj;      // NULL: empty\n");
+    emit("    int node;\n");
+    emit("} TarjanSlot;\n\n");
+
+    emit("typedef enum { TARJAN_INIT, TARJAN_AFTER_A, TARJAN_AFTER_B } TarjanState;\n\n");
+
+    emit("typedef struct TarjanWorkFrame {\n");
+    emit("    int node;\n");
+    emit("    int child;     // Node just pushed for the current edge, or -1\n");
+    emit("    TarjanState state;\n");
+    emit("} TarjanWorkFrame;\n\n");
+
+    emit("static TarjanNode* TARJAN_NODES = NULL;\n");
+    emit("static size_t TARJAN_NODE_COUNT = 0;\n");
+    emit("static size_t TARJAN_NODE_CAP = 0;\n");
+    emit("static TarjanSlot* TARJAN_SLOTS = NULL;\n");
+    emit("static size_t TARJAN_SLOT_CAP = 0;   // Power of two, at most half full\n");
+    emit("static int* TARJAN_STACK = NULL;\n");
+    emit("static size_t TARJAN_STACK_LEN = 0;\n");
+    emit("static size_t TARJAN_STACK_CAP = 0;\n");
+    emit("static TarjanWorkFrame* TARJAN_WORK = NULL;\n");
+    emit("static size_t TARJAN_WORK_LEN = 0;\n");
+    emit("static size_t TARJAN_WORK_CAP = 0;\n");
+    emit("static int TARJAN_INDEX = 0;\n");
+    emit("static int TARJAN_OOM = 0;\n\n");
+
+    emit("// Buffers above this many slots are returned after a freeze\n");
+    emit("#define TARJAN_KEEP_SLOTS 4096\n\n");
+
+    emit("static size_t tarjan_hash_ptr(void* p) {\n");
+    emit("    size_t x = (size_t)p;\n");
+    emit("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
+    emit("    x = ((x >> 16) ^ x) * 0x45d9f3b;\n");
+    emit("    return (x >> 16) ^ x;\n");
+    emit("}\n\n");
+
+    emit("// Double a buffer of elem-sized entries\n");
+    emit("static int tarjan_grow(void** buf, size_t* cap, size_t elem) {\n");
+    emit("    size_t n = *cap ? *cap * 2 : 256;\n");
+    emit("    if (n > SIZE_MAX / elem) { TARJAN_OOM = 1; return 0; }\n");
+    emit("    void* p = realloc(*buf, n * elem);\n");
+    emit("    if (!p) { TARJAN_OOM = 1; return 0; }\n");
+    emit("    *buf = p;\n");
+    emit("    *cap = n;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("static void tarjan_slot_insert(TarjanSlot* slots, size_t cap, Obj* obj, int node) {\n");
+    emit("    size_t i = tarjan_hash_ptr(obj) & (cap - 1);\n");
+    emit("    while (slots[i].obj) i = (i + 1) & (cap - 1);\n");
+    emit("    slots[i].obj = obj;\n");
+    emit("    slots[i].node = node;\n");
+    emit("}\n\n");
+
+    emit("static int tarjan_rehash(void) {\n");
+    emit("    size_t cap = TARJAN_SLOT_CAP ? TARJAN_SLOT_CAP * 2 : 64;\n");
+    emit("    if (cap > SIZE_MAX / sizeof(TarjanSlot)) { TARJAN_OOM = 1; return 0; }\n");
+    emit("    TarjanSlot* slots = calloc(cap, sizeof(TarjanSlot));\n");
+    emit("    if (!slots) { TARJAN_OOM = 1; return 0; }\n");
+    emit("    for (size_t i = 0; i < TARJAN_NODE_COUNT; i++) {\n");
+    emit("        tarjan_slot_insert(slots, cap, TARJAN_NODES[i].obj, (int)i);\n");
+    emit("    }\n");
+    emit("    free(TARJAN_SLOTS);\n");
+    emit("    TARJAN_SLOTS = slots;\n");
+    emit("    TARJAN_SLOT_CAP = cap;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("// Node number for obj, created unvisited on first sight; -1 on OOM\n");
+    emit("int get_tarjan_node(Obj* obj) {\n");
+    emit("    if (TARJAN_SLOT_CAP) {\n");
+    emit("        size_t i = tarjan_hash_ptr(obj) & (TARJAN_SLOT_CAP - 1);\n");
+    emit("        while (TARJAN_SLOTS[i].obj) {\n");
+    emit("            if (TARJAN_SLOTS[i].obj == obj) return TARJAN_SLOTS[i].node;\n");
+    emit("            i = (i + 1) & (TARJAN_SLOT_CAP - 1);\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    if (TARJAN_NODE_COUNT >= INT_MAX) { TARJAN_OOM = 1; return -1; }\n");
+    emit("    if ((TARJAN_NODE_COUNT + 1) * 2 > TARJAN_SLOT_CAP && !tarjan_rehash()) return -1;\n");
+    emit("    if (TARJAN_NODE_COUNT == TARJAN_NODE_CAP &&\n");
+    emit("        !tarjan_grow((void**)&TARJAN_NODES, &TARJAN_NODE_CAP, sizeof(TarjanNode))) return -1;\n");
+    emit("    int n = (int)TARJAN_NODE_COUNT++;\n");
+    emit("    TARJAN_NODES[n].obj = obj;\n");
+    emit("    TARJAN_NODES[n].index = -1;\n");
+    emit("    TARJAN_NODES[n].lowlink = -1;\n");
+    emit("    TARJAN_NODES[n].on_stack = 0;\n");
+    emit("    tarjan_slot_insert(TARJAN_SLOTS, TARJAN_SLOT_CAP, obj, n);\n");
+    emit("    return n;\n");
+    emit("}\n\n");
+
+    emit("static int tarjan_stack_push(int node) {\n");
+    emit("    if (TARJAN_STACK_LEN == TARJAN_STACK_CAP &&\n");
+    emit("        !tarjan_grow((void**)&TARJAN_STACK, &TARJAN_STACK_CAP, sizeof(int))) return 0;\n");
+    emit("    TARJAN_STACK[TARJAN_STACK_LEN++] = node;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("static int tarjan_work_push(int node) {\n");
+    emit("    if (TARJAN_WORK_LEN == TARJAN_WORK_CAP &&\n");
+    emit("        !tarjan_grow((void**)&TARJAN_WORK, &TARJAN_WORK_CAP, sizeof(TarjanWorkFrame))) return 0;\n");
+    emit("    TarjanWorkFrame* f = &TARJAN_WORK[TARJAN_WORK_LEN++];\n");
+    emit("    f->node = node;\n");
+    emit("    f->child = -1;\n");
+    emit("    f->state = TARJAN_INIT;\n");
+    emit("    return 1;\n");
+    emit("}\n\n");
+
+    emit("void reset_tarjan_state(void) {\n");
+    emit("    if (TARJAN_SLOT_CAP > TARJAN_KEEP_SLOTS) {\n");
+    emit("        // A large freeze: give the memory back\n");
+    emit("        free(TARJAN_SLOTS);\n");
+    emit("        free(TARJAN_NODES);\n");
+    emit("        free(TARJAN_STACK);\n");
+    emit("        free(TARJAN_WORK);\n");
+    emit("        TARJAN_SLOTS = NULL;\n");
+    emit("        TARJAN_NODES = NULL;\n");
+    emit("        TARJAN_STACK = NULL;\n");
+    emit("        TARJAN_WORK = NULL;\n");
+    emit("        TARJAN_SLOT_CAP = TARJAN_NODE_CAP = TARJAN_STACK_CAP = TARJAN_WORK_CAP = 0;\n");
+    emit("    } else if (TARJAN_NODE_COUNT) {\n");
+    emit("        for (size_t i = 0; i < TARJAN_SLOT_CAP; i++) TARJAN_SLOTS[i].obj = NULL;\n");
+    emit("    }\n");
+    emit("    TARJAN_NODE_COUNT = 0;\n");
+    emit("    TARJAN_STACK_LEN = 0;\n");
+    emit("    TARJAN_WORK_LEN = 0;\n");
+    emit("    TARJAN_INDEX = 0;\n");
+    emit("    TARJAN_OOM = 0;\n");
+    emit("}\n\n");
+
+    emit("// Follow the edge v -> obj: returns the child's node if it must be\n");
+    emit("// visited first, -1 if not (visited, or frozen earlier), -2 on OOM\n");
+    emit("static int tarjan_edge(int v, Obj* obj) {\n");
+    emit("    if (frozen_scc_of(obj)) return -1;\n");
+    emit("    int w = get_tarjan_node(obj);\n");
+    emit("    if (w < 0) return -2;\n");
+    emit("    if (TARJAN_NODES[w].index < 0) return tarjan_work_push(w) ? w : -2;\n");
+    emit("    if (TARJAN_NODES[w].on_stack && TARJAN_NODES[v].lowlink > TARJAN_NODES[w].index) {\n");
+    emit("        TARJAN_NODES[v].lowlink = TARJAN_NODES[w].index;\n");
+    emit("    }\n");
+    emit("    return -1;\n");
+    emit("}\n\n");
+
+    emit("// Pop v's component off the Tarjan stack into a new SCC\n");
+    emit("static SCC* tarjan_emit_scc(int v) {\n");
+    emit("    size_t start = TARJAN_STACK_LEN;\n");
+    emit("    while (start > 0 && TARJAN_STACK[--start] != v) {}\n");
+    emit("    size_t count = TARJAN_STACK_LEN - start;\n");
+    emit("    if (count > INT_MAX) { TARJAN_OOM = 1; return NULL; }\n\n");
+
+    emit("    // Edges into components frozen by earlier calls\n");
+    emit("    size_t dep_count = 0;\n");
+    emit("    for (size_t i = start; i < TARJAN_STACK_LEN; i++) {\n");
+    emit("        Obj* m = TARJAN_NODES[TARJAN_STACK[i]].obj;\n");
+    emit("        if (!OBJ_IS_PAIR(m)) continue;\n");
+    emit("        if (m->a && frozen_scc_of(m->a)) dep_count++;\n");
+    emit("        if (m->b && frozen_scc_of(m->b)) dep_count++;\n");
+    emit("    }\n\n");
+
+    emit("    SCC* scc = malloc(sizeof(SCC));\n");
+    emit("    if (!scc) { TARJAN_OOM = 1; return NULL; }\n");
+    emit("    // Singletons (every acyclic node) keep their member inline\n");
+    emit("    scc->members = count == 1 ? &scc->solo : malloc(count * sizeof(Obj*));\n");
+    emit("    scc->deps = dep_count ? malloc(dep_count * sizeof(SCC*)) : NULL;\n");
+    emit("    if (!scc->members || (dep_count && !scc->deps) || !scc_register(scc)) {\n");
+    emit("        if (scc->members != &scc->solo) free(scc->members);\n");
+    emit("        free(scc->deps);\n");
+    emit("        free(scc);\n");
+    emit("        TARJAN_OOM = 1;\n");
+    emit("        return NULL;\n");
+    emit("    }\n");
+    emit("    scc->member_count = (int)count;\n");
+    emit("    scc->capacity = (int)count;\n");
+    emit("    scc->ref_count = 1;\n");
+    emit("    scc->next = NULL;\n");
+    emit("    scc->result_next = NULL;\n");
+    emit("    scc->epoch = SCC_EPOCH;\n");
+    emit("    scc->dep_count = 0;\n\n");
+
+    emit("    for (size_t i = 0; i < count; i++) {\n");
+    emit("        TarjanNode* w = &TARJAN_NODES[TARJAN_STACK[TARJAN_STACK_LEN - 1 - i]];\n");
+    emit("        w->on_stack = 0;\n");
+    emit("        scc->members[i] = w->obj;\n");
+    emit("        // Each edge into the frozen base holds one reference on its SCC\n");
+    emit("        if (OBJ_IS_PAIR(w->obj)) {\n");
+    emit("            SCC* d = w->obj->a ? frozen_scc_of(w->obj->a) : NULL;\n");
+    emit("            if (d) { d->ref_count++; scc->deps[scc->dep_count++] = d; }\n");
+    emit("            d = w->obj->b ? frozen_scc_of(w->obj->b) : NULL;\n");
+    emit("            if (d) { d->ref_count++; scc->deps[scc->dep_count++] = d; }\n");
+    emit("        }\n");
+    emit("        OBJ_SET_SCC_ID(w->obj, scc->id);\n");
+    emit("    }\n");
+    emit("    TARJAN_STACK_LEN = start;\n");
+    emit("    return scc;\n");
+    emit("}\n\n");
+
+    emit("void tarjan_strongconnect(Obj* root_obj, SCC** result) {\n");
+    emit("    if (!root_obj) return;\n");
+    emit("    int root = get_tarjan_node(root_obj);\n");
+    emit("    if (root < 0 || TARJAN_NODES[root].index >= 0) return;\n");
+    emit("    size_t base = TARJAN_WORK_LEN;\n");
+    emit("    if (!tarjan_work_push(root)) return;\n\n");
+
+    emit("    while (TARJAN_WORK_LEN > base) {\n");
+    emit("        // Frames are addressed by position: pushes may move the array\n");
+    emit("        size_t top = TARJAN_WORK_LEN - 1;\n");
+    emit("        int v = TARJAN_WORK[top].node;\n");
+    emit("        Obj* obj = TARJAN_NODES[v].obj;\n");
+    emit("        int child = TARJAN_WORK[top].child;\n");
+    emit("        if (child >= 0 && TARJAN_NODES[v].lowlink > TARJAN_NODES[child].lowlink) {\n");
+    emit("            TARJAN_NODES[v].lowlink = TARJAN_NODES[child].lowlink;\n");
+    emit("        }\n");
+    emit("        TARJAN_WORK[top].child = -1;\n\n");
+
+    emit("        switch (TARJAN_WORK[top].state) {\n");
+    emit("        case TARJAN_INIT:\n");
+    emit("            if (TARJAN_NODES[v].index >= 0) {\n");
+    emit("                TARJAN_WORK_LEN--;\n");
+    emit("                break;\n");
+    emit("            }\n");
+    emit("            TARJAN_NODES[v].index = TARJAN_INDEX;\n");
+    emit("            TARJAN_NODES[v].lowlink = TARJAN_INDEX;\n");
+    emit("            TARJAN_INDEX++;\n");
+    emit("            if (!tarjan_stack_push(v)) goto oom;\n");
+    emit("            TARJAN_NODES[v].on_stack = 1;\n");
+    emit("            TARJAN_WORK[top].state = TARJAN_AFTER_A;\n");
+    emit("            if (OBJ_IS_PAIR(obj) && obj->a) {\n");
+    emit("                child = tarjan_edge(v, obj->a);\n");
+    emit("                if (child == -2) goto oom;\n");
+    emit("                TARJAN_WORK[top].child = child;\n");
+    emit("            }\n");
+    emit("            break;\n\n");
+
+    emit("        case TARJAN_AFTER_A:\n");
+    emit("            TARJAN_WORK[top].state = TARJAN_AFTER_B;\n");
+    emit("            if (OBJ_IS_PAIR(obj) && obj->b) {\n");
+    emit("                child = tarjan_edge(v, obj->b);\n");
+    emit("                if (child == -2) goto oom;\n");
+    emit("                TARJAN_WORK[top].child = child;\n");
+    emit("            }\n");
+    emit("            break;\n\n");
+
+    emit("        case TARJAN_AFTER_B:\n");
+    emit("            if (TARJAN_NODES[v].lowlink == TARJAN_NODES[v].index) {\n");
+    emit("                SCC* scc = tarjan_emit_scc(v);\n");
+    emit("                if (!scc) goto oom;\n");
+    emit("                scc->result_next = *result;\n");
+    emit("                *result = scc;\n");
+    emit("            }\n");
+    emit("            TARJAN_WORK_LEN--;\n");
+    emit("            break;\n");
+    emit("        }\n");
+    emit("    }\n");
+    emit("    return;\n\n");
+
+    emit("oom:\n");
+    emit("    TARJAN_OOM = 1;\n");
+    emit("    TARJAN_WORK_LEN = base;\n");
+    emit("}\n\n");
+
+    gen_scc_parallel();
+
+    emit("SCC* freeze_cyclic(Obj* root) {\n");
+    emit("    // Reset Tarjan state\n");
+    emit("    reset_tarjan_state();\n");
+    emit("    SCC_EPOCH++;\n\n");
+
+    emit("    // Already frozen: one more reference to its component. Its\n");
+    emit("    // result_next still belongs to the list of the freeze that built it\n");
+    emit("    SCC* frozen = root ? frozen_scc_of(root) : NULL;\n");
+    emit("    if (frozen) {\n");
+    emit("        frozen->ref_count++;\n");
+    emit("        return frozen;\n");
+    emit("    }\n\n");
+
+    emit("#ifdef SCC_PARALLEL\n");
+    emit("    int workers = root ? scc_workers() : 1;\n");
+    emit("    if (workers > 1) {\n");
+    emit("        int done = 0;\n");
+    emit("        SCC* result = freeze_parallel(root, workers, &done);\n");
+    emit("        if (done) return result;\n");
+    emit("    }\n");
+    emit("#endif\n\n");
+
+    emit("    SCC* sccs = NULL;\n");
+    emit("    tarjan_strongconnect(root, &sccs);\n");
+    emit("    // Always clean up Tarjan state to prevent memory leak\n");
+    emit("    reset_tarjan_state();\n");
+    emit("    return sccs;\n");
+    emit("}\n\n");
+
+    emit("void release_scc(SCC* scc) {\n");
+    emit("    if (!scc) return;\n");
+    emit("    scc->ref_count--;\n");
+    emit("    if (scc->ref_count != 0) return;\n\n");
+
+    emit("    // A freed component drops the references it held on the frozen base;\n");
+    emit("    // components freed in turn are queued through `next`, so long chains\n");
+    emit("    // of stages need no recursion\n");
+    emit("    scc->next = NULL;\n");
+    emit("    while (scc) {\n");
+    emit("        SCC* pending = scc->next;\n");
+    emit("        for (int i = 0; i < scc->dep_count; i++) {\n");
+    emit("            SCC* d = scc->deps[i];\n");
+    emit("            if (--d->ref_count == 0) {\n");
+    emit("                d->next = pending;\n");
+    emit("                pending = d;\n");
+    emit("            }\n");
+    emit("        }\n");
+    emit("        for (int i = 0; i < scc->member_count; i++) {\n");
+    emit("            OBJ_FREE_PAYLOAD(scc->members[i]);\n");
+    emit("            invalidate_weak_refs_for(scc->members[i]);\n");
+    emit("            OBJ_SET_SCC_ID(scc->members[i], -1);\n");
+    emit("            slab_free(scc->members[i], sizeof(Obj));\n");
+    emit("        }\n");
+    emit("        STAT_ADD(free_scc, scc->member_count);\n");
+    emit("        scc_unregister(scc);\n");
+    emit("        if (scc->members != &scc->solo) free(scc->members);\n");
+    emit("        free(scc->deps);\n");
+    emit("        free(scc);\n");
+    emit("        scc = pending;\n");
+    emit("    }\n");
+    emit("}\n\n");
+
+    emit("void inc_scc_ref(SCC* scc) {\n");
+    emit("    if (scc) scc->ref_count++;\n");
+    emit("}\n\n");
 }
 
 void gen_freeze_call(const char* var) {
-    printf("    SCC* %s_scc = freeze_cyclic(%s);\n", var, var);
+    emit("    SCC* %s_scc = freeze_cyclic(%s);\n", var, var);
 }
 
 void gen_release_scc_call(const char* var) {
-    printf("    release_scc(%s_scc);\n", var);
+    emit("    release_scc(%s_scc);\n", var);
 }
@@ -2,7 +2,8 @@
 #define PURPLE_SCC_H
 
 #include "../types.h"
-#include "../util/hashmap.h"
+#include "../util/swissmap.h"
+#include "arena.h"
 
 // -- Phase 6b: SCC-based RC (ISMM 2024) --
 // Reference Counting Deeply Immutable Data Structures with Cycles
@@ -40,14 +41,18 @@ typedef struct SCC {
     int frozen;         // 1 if frozen (immutable)
     struct SCC* next;        // For registry list (cleanup)
     struct SCC* result_next; // For result list from compute_sccs
+    struct SCC** deps;  // Frozen SCCs its members point into (one per edge)
+    int dep_count;
 } SCC;
 
 // SCC Registry
 typedef struct SCCRegistry {
     SCC* sccs;
     int next_id;
-    SCCNode* node_map;    // Linked list of all nodes (for cleanup)
-    HashMap* node_lookup; // O(1) lookup: Obj* -> SCCNode*
+    SCCNode* node_map;    // Linked list of this run's nodes
+    Arena* node_arena;    // Node storage, reset by each compute_sccs
+    SwissMap* node_lookup; // O(1) lookup: Obj* -> SCCNode*
+    SwissMap* scc_lookup;  // O(1) lookup: SCC id -> SCC*
     SCCNode* stack;
     int index;
 } SCCRegistry;
@@ -66,6 +71,11 @@ SCCRegistry* mk_scc_registry(void);
 void free_scc_registry(SCCRegistry* reg);
 
 // Tarjan's SCC algorithm
+// SCCs marked frozen by earlier calls are opaque: the traversal stops at
+// them, and each edge into one takes a reference on it (released with
+// the SCC holding the edge). A frozen root returns its own SCC, with one
+// more reference; its result_next is left as the freeze that built it
+// set it, so walk result lists only from what that freeze returned.
 SCC* compute_sccs(SCCRegistry* reg, Obj* root);
 void tarjan_dfs(SCCRegistry* reg, Obj* v, SCC** result);
 
@@ -79,8 +89,10 @@ Obj* freeze_cyclic(Obj* root);
 void release_scc(SCC* scc);
 void inc_scc_ref(SCC* scc);
 
-// Freeze point detection
+// Freeze point detection: line_number is 0 unless source positions
+// were recorded (parser.h), is_cyclic comes from shape analysis
 FreezePoint* detect_freeze_points(Value* expr);
+void free_freeze_points(FreezePoint* points);
 int is_frozen_after_construction(const char* var, Value* body);
 
 // Code generation
@@ -64,6 +64,8 @@ SymScope* sym_scope_new(SymScope* parent) {
     scope->owned_count = 0;
     scope->owned_capacity = 0;
     scope->parent = parent;
+    scope->release_pos = 0;
+    scope->next_release = NULL;
 
     return scope;
 }
@@ -163,6 +165,8 @@ static void sym_check_free(SymObj* obj) {
 
 /* ============== Context Operations ============== */
 
+static void sym_queue_scope(SymContext* ctx, SymScope* scope);
+
 SymContext* sym_context_new(void) {
     SymContext* ctx = malloc(sizeof(SymContext));
     if (!ctx) return NULL;
@@ -184,6 +188,14 @@ SymContext* sym_context_new(void) {
     ctx->stack_size = 1;
     ctx->stack_capacity = INITIAL_CAPACITY;
 
+    ctx->step_size = 0;
+    ctx->release_head = NULL;
+    ctx->release_tail = NULL;
+    ctx->orphans = NULL;
+    ctx->orphan_count = 0;
+    ctx->orphan_scanned = 0;
+    ctx->orphan_capacity = 0;
+
     ctx->objects_created = 0;
     ctx->objects_freed = 0;
     ctx->cycles_collected = 0;
@@ -194,13 +206,16 @@ SymContext* sym_context_new(void) {
 void sym_context_free(SymContext* ctx) {
     if (!ctx) return;
 
-    /* Release all scopes from innermost to outermost */
-    while (ctx->stack_size > 0) {
+    /* Release all scopes from innermost to outermost, after any queued */
+    ctx->step_size = 0;
+    while (ctx->stack_size > 1) {
         sym_exit_scope(ctx);
     }
+    sym_queue_scope(ctx, ctx->global_scope);
+    sym_flush(ctx);
 
-    sym_scope_free(ctx->global_scope);
     free(ctx->scope_stack);
+    free(ctx->orphans);
     free(ctx);
 }
 
@@ -236,23 +251,19 @@ SymScope* sym_enter_scope(SymContext* ctx) {
     return scope;
 }
 
+/* Orphan with one external ref left: the scope's, over a cycle */
+static int sym_is_cycle_root(SymObj* obj) {
+    return obj && !obj->freed && obj->internal_rc > 0 && obj->external_rc == 1;
+}
+
 void sym_exit_scope(SymContext* ctx) {
     if (!ctx || ctx->stack_size <= 1) return;  /* Don't exit global scope */
 
     SymScope* scope = ctx->scope_stack[--ctx->stack_size];
 
-    /* Count potential cycles before release */
-    int cycles = 0;
-    for (int i = 0; i < scope->owned_count; i++) {
-        SymObj* obj = scope->owned[i];
-        if (obj && !obj->freed && obj->internal_rc > 0 && obj->external_rc == 1) {
-            cycles++;
-        }
-    }
-    ctx->cycles_collected += cycles;
-
-    sym_scope_release(scope);
-    sym_scope_free(scope);
+    /* Incremental: release later, a step at a time */
+    sym_queue_scope(ctx, scope);
+    if (ctx->step_size == 0) sym_flush(ctx);
 }
 
 SymObj* sym_alloc(SymContext* ctx, void* data, void (*destructor)(void*)) {
@@ -265,6 +276,11 @@ SymObj* sym_alloc(SymContext* ctx, void* data, void (*destructor)(void*)) {
     sym_scope_own(scope, obj);
     ctx->objects_created++;
 
+    /* Pay off queued releases as we allocate */
+    if (ctx->step_size > 0 && ctx->release_head) {
+        sym_step(ctx, ctx->step_size);
+    }
+
     return obj;
 }
 
@@ -273,6 +289,133 @@ void sym_link(SymContext* ctx, SymObj* from, SymObj* to) {
     sym_inc_internal(from, to);
 }
 
+/* ============== Incremental Release ============== */
+
+/*
+ * A queued scope is released in three phases, each a step at a time:
+ *   1. drop the scope's ref to each owned object, queueing the orphans
+ *   2. drop each orphan's internal refs, queueing what that orphans
+ *   3. free the orphans
+ * Nothing is freed until the scope's whole orphan set is known, so no
+ * step reads an object freed by an earlier one, even inside cycles.
+ */
+
+void sym_set_incremental(SymContext* ctx, int step_size) {
+    if (!ctx) return;
+    if (step_size <= 0) {
+        /* Back to immediate release: nothing may stay queued */
+        sym_flush(ctx);
+        step_size = 0;
+    }
+    ctx->step_size = step_size;
+}
+
+static void sym_queue_scope(SymContext* ctx, SymScope* scope) {
+    scope->release_pos = 0;
+    scope->next_release = NULL;
+    if (ctx->release_tail) ctx->release_tail->next_release = scope;
+    else ctx->release_head = scope;
+    ctx->release_tail = scope;
+}
+
+/* Queue obj to be freed; marking it freed keeps it from being queued twice */
+static int sym_queue_orphan(SymContext* ctx, SymObj* obj) {
+    if (ctx->orphan_count >= ctx->orphan_capacity) {
+        int new_cap;
+        if (ctx->orphan_capacity == 0) {
+            new_cap = INITIAL_CAPACITY;
+        } else if (ctx->orphan_capacity > INT_MAX / 2) {
+            return 0;  /* Overflow protection */
+        } else {
+            new_cap = ctx->orphan_capacity * 2;
+        }
+        SymObj** grown = realloc(ctx->orphans, new_cap * sizeof(SymObj*));
+        if (!grown) return 0;
+        ctx->orphans = grown;
+        ctx->orphan_capacity = new_cap;
+    }
+    obj->freed = 1;
+    ctx->orphans[ctx->orphan_count++] = obj;
+    return 1;
+}
+
+/* Queue obj if it has no external refs left */
+static void sym_maybe_orphan(SymContext* ctx, SymObj* obj) {
+    if (obj->external_rc <= 0 && !sym_queue_orphan(ctx, obj)) {
+        sym_check_free(obj);  /* Out of memory for the queue: free now */
+    }
+}
+
+int sym_step(SymContext* ctx, int max_objects) {
+    if (!ctx || max_objects <= 0) return 0;
+
+    int visited = 0;
+    while (visited < max_objects) {
+        SymScope* scope = ctx->release_head;
+        if (!scope) break;
+
+        /* Phase 1: the scope's refs */
+        if (scope->release_pos < scope->owned_count) {
+            SymObj* obj = scope->owned[scope->release_pos++];
+            if (obj && !obj->freed) {
+                if (sym_is_cycle_root(obj)) ctx->cycles_collected++;
+                obj->external_rc--;
+                sym_maybe_orphan(ctx, obj);
+            }
+            visited++;
+            continue;
+        }
+
+        /* Phase 2: the orphans' refs */
+        if (ctx->orphan_scanned < ctx->orphan_count) {
+            SymObj* obj = ctx->orphans[ctx->orphan_scanned++];
+            for (int i = 0; i < obj->ref_count; i++) {
+                SymObj* target = obj->refs[i];
+                if (!target || target->freed) continue;
+                target->internal_rc--;
+                sym_maybe_orphan(ctx, target);
+            }
+            visited++;
+            continue;
+        }
+
+        /* Phase 3: free */
+        if (ctx->orphan_count > 0) {
+            SymObj* obj = ctx->orphans[--ctx->orphan_count];
+            if (obj->destructor && obj->data) {
+                obj->destructor(obj->data);
+            }
+            free(obj->refs);
+            free(obj);
+            ctx->objects_freed++;
+            visited++;
+            continue;
+        }
+
+        /* Scope done */
+        ctx->orphan_scanned = 0;
+        ctx->release_head = scope->next_release;
+        if (!ctx->release_head) ctx->release_tail = NULL;
+        if (scope == ctx->global_scope) ctx->global_scope = NULL;
+        sym_scope_free(scope);
+    }
+    return visited;
+}
+
+void sym_flush(SymContext* ctx) {
+    if (!ctx) return;
+    sym_step(ctx, INT_MAX);
+}
+
+int sym_pending_work(SymContext* ctx) {
+    if (!ctx) return 0;
+    int pending = ctx->orphan_count;
+    for (SymScope* s = ctx->release_head; s; s = s->next_release) {
+        pending += s->owned_count - s->release_pos;
+    }
+    return pending;
+}
+
 /* ============== Utility ============== */
 
 int sym_is_orphaned(SymObj* obj) {
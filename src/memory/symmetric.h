@@ -43,6 +43,8 @@ struct SymScope {
     int owned_count;
     int owned_capacity;
     SymScope* parent;       /* Parent scope (for nesting) */
+    int release_pos;        /* Incremental release: next owned entry */
+    SymScope* next_release; /* Incremental release queue */
 };
 
 /* Symmetric RC context */
@@ -51,6 +53,14 @@ typedef struct {
     SymScope** scope_stack;
     int stack_size;
     int stack_capacity;
+    /* Incremental release (step_size 0: release at scope exit) */
+    int step_size;          /* Max objects visited per step */
+    SymScope* release_head; /* Exited scopes not yet released, oldest first */
+    SymScope* release_tail;
+    SymObj** orphans;       /* Orphans of the scope being released */
+    int orphan_count;
+    int orphan_scanned;     /* Orphans whose refs were dropped */
+    int orphan_capacity;
     /* Statistics */
     int objects_created;
     int objects_freed;
@@ -82,6 +92,14 @@ void sym_exit_scope(SymContext* ctx);
 SymObj* sym_alloc(SymContext* ctx, void* data, void (*destructor)(void*));
 void sym_link(SymContext* ctx, SymObj* from, SymObj* to);
 
+/* Incremental release: with step_size k > 0, sym_exit_scope only queues
+ * the scope, and orphans are freed at most k objects per step. Steps run
+ * from sym_alloc, or explicitly at safe points. */
+void sym_set_incremental(SymContext* ctx, int step_size);
+int sym_step(SymContext* ctx, int max_objects);  /* Returns objects visited */
+void sym_flush(SymContext* ctx);
+int sym_pending_work(SymContext* ctx);
+
 /* Utility */
 int sym_is_orphaned(SymObj* obj);
 int sym_total_rc(SymObj* obj);
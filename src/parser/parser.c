@@ -1,57 +1,154 @@
 #define _POSIX_C_SOURCE 200809L
 #include "parser.h"
 #include "../eval/eval.h"
+#include "../util/hashmap.h"
 #include <ctype.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 
 extern Value* NIL;
 extern Value* SYM_QUOTE;
 
-// -- Parser State --
+// -- Source Positions --
 
-static const char* parse_ptr = NULL;
+// Value* -> line << 16 | col, NULL while positions are off
+static HashMap* positions = NULL;
 
-void set_parse_input(const char* input) {
-    parse_ptr = input;
+#define POS_COL_MAX 0xffff
+
+void source_positions_enable(int on) {
+    if (positions) hashmap_free(positions);
+    positions = on ? hashmap_new_arena(1024) : NULL;
 }
 
-// -- Parsing --
+int source_pos(Value* form, SourcePos* out) {
+    if (!positions || !form) return 0;
+    uintptr_t packed = (uintptr_t)hashmap_get(positions, form);
+    if (!packed) return 0;
+    out->line = (int)(packed >> 16);
+    out->col = (int)(packed & POS_COL_MAX);
+    return 1;
+}
 
-void skip_ws(void) {
-    while (parse_ptr && isspace((unsigned char)*parse_ptr)) parse_ptr++;
-}
-
-// Iterative Parser Context Frame
-typedef struct ParseFrame {
-    Value* list;           // Accumulator for list elements (built in reverse)
-    int closing_char;      // ')' or 0 (for quotes)
-    int max_items;         // -1 (unlimited) or N (for quotes)
-    int items_read;        // Number of items read so far
-    struct ParseFrame* next;
-} ParseFrame;
-
-static void push_frame(ParseFrame** stack, Value* initial_list, int closing, int max) {
-    ParseFrame* f = malloc(sizeof(ParseFrame));
-    if (!f) {
-        fprintf(stderr, "Parser OOM\n");
-        exit(1);
+static void record_pos(Value* form, SourcePos pos) {
+    int col = pos.col < POS_COL_MAX ? pos.col : POS_COL_MAX;
+    hashmap_put(positions, form, (void*)(((uintptr_t)pos.line << 16) | (uintptr_t)col));
+}
+
+// Bring line/col up to pos
+static void count_lines(Parser* p) {
+    for (; p->counted < p->pos; p->counted++) {
+        if (p->buf[p->counted] == '\n') {
+            p->line++;
+            p->col = 1;
+        } else {
+            p->col++;
+        }
     }
+}
+
+// -- Parser Context --
+
+void parser_init(Parser* p) {
+    memset(p, 0, sizeof(Parser));
+    p->line = 1;
+    p->col = 1;
+}
+
+void parser_destroy(Parser* p) {
+    if (!p) return;
+    if (!p->borrowed) free(p->buf);
+    free(p->frames);
+    parser_init(p);
+}
+
+Parser* parser_new(void) {
+    Parser* p = malloc(sizeof(Parser));
+    if (p) parser_init(p);
+    return p;
+}
+
+void parser_free(Parser* p) {
+    if (!p) return;
+    parser_destroy(p);
+    free(p);
+}
+
+// Parse a NUL-terminated string in place: no copy, already at EOF
+static void parser_borrow(Parser* p, const char* input) {
+    parser_destroy(p);
+    p->buf = (char*)input;
+    p->len = input ? strlen(input) : 0;
+    p->borrowed = 1;
+    p->eof = 1;
+}
+
+int parser_feed(Parser* p, const char* data, size_t len) {
+    if (p->borrowed) {
+        // Take ownership of the unread part before appending
+        if (positions) count_lines(p);
+        const char* rest = p->buf ? p->buf + p->pos : "";
+        size_t rest_len = p->len - p->pos;
+        p->buf = NULL;
+        p->borrowed = 0;
+        p->cap = 0;
+        p->len = 0;
+        p->pos = 0;
+        p->counted = 0;
+        if (!parser_feed(p, rest, rest_len)) return 0;
+    }
+
+    // Drop consumed bytes; an atom still being read starts at pos
+    if (p->pos > 0) {
+        if (positions) count_lines(p);
+        memmove(p->buf, p->buf + p->pos, p->len - p->pos);
+        p->len -= p->pos;
+        p->counted = p->counted > p->pos ? p->counted - p->pos : 0;
+        p->pos = 0;
+    }
+    if (p->len + len + 1 > p->cap) {
+        size_t cap = p->cap ? p->cap : 4096;
+        while (cap < p->len + len + 1) {
+            if (cap > SIZE_MAX / 2) return 0;
+            cap *= 2;
+        }
+        char* buf = realloc(p->buf, cap);
+        if (!buf) return 0;
+        p->buf = buf;
+        p->cap = cap;
+    }
+    if (len) memcpy(p->buf + p->len, data, len);
+    p->len += len;
+    p->buf[p->len] = '\0';
+    return 1;
+}
+
+void parser_finish(Parser* p) {
+    p->eof = 1;
+}
+
+static int push_frame(Parser* p, Value* initial_list, int closing, int max) {
+    if (p->depth == p->frame_cap) {
+        int cap = p->frame_cap ? p->frame_cap * 2 : 16;
+        ParseFrame* frames = realloc(p->frames, (size_t)cap * sizeof(ParseFrame));
+        if (!frames) return 0;
+        p->frames = frames;
+        p->frame_cap = cap;
+    }
+    ParseFrame* f = &p->frames[p->depth++];
     f->list = initial_list;
     f->closing_char = closing;
     f->max_items = max;
     f->items_read = 0;
-    f->next = *stack;
-    *stack = f;
-}
-
-static ParseFrame* pop_frame(ParseFrame** stack) {
-    if (!*stack) return NULL;
-    ParseFrame* f = *stack;
-    *stack = f->next;
-    return f;
+    if (positions) {
+        count_lines(p);
+        f->pos.line = p->line;
+        f->pos.col = p->col;
+    }
+    return 1;
 }
 
 static Value* reverse_list(Value* list) {
@@ -65,186 +162,194 @@ static Value* reverse_list(Value* list) {
     return new_head;
 }
 
-Value* parse(void) {
-    ParseFrame* stack = NULL;
+// Close the innermost frame into its list
+static Value* pop_frame(Parser* p) {
+    ParseFrame* f = &p->frames[--p->depth];
+    Value* list = reverse_list(f->list);
+    if (positions && !is_nil(list)) record_pos(list, f->pos);
+    return list;
+}
+
+static ParseStatus parse_fail(Parser* p) {
+    p->depth = 0;
+    p->in_comment = 0;
+    return PARSE_ERROR;
+}
+
+// -- Parsing --
+
+ParseStatus parser_next(Parser* p, Value** out) {
     Value* current_result = NULL;
     int result_ready = 0;
 
-    // Main Loop
     while (1) {
-        skip_ws();
-        if (!parse_ptr || *parse_ptr == '\0') break;
-
-        // Check if current frame is done (for max_items frames like Quote)
-        if (stack && stack->max_items != -1 && stack->items_read >= stack->max_items) {
-            // Frame finished
-            current_result = reverse_list(stack->list);
-            ParseFrame* f = pop_frame(&stack);
-            free(f);
-            result_ready = 1;
-        } 
-        // Check for closing parenthesis (only if frame expects it)
-        else if (stack && stack->closing_char && *parse_ptr == stack->closing_char) {
-            parse_ptr++; // Consume ')'
-            current_result = reverse_list(stack->list);
-            ParseFrame* f = pop_frame(&stack);
-            free(f);
-            result_ready = 1;
+        if (result_ready) {
+            result_ready = 0;
+            if (p->depth == 0) {
+                *out = current_result;
+                return PARSE_FORM;
+            }
+            ParseFrame* top = &p->frames[p->depth - 1];
+            Value* new_cell = mk_cell(current_result, top->list);
+            if (!new_cell) {
+                fprintf(stderr, "Parser OOM\n");
+                return parse_fail(p);
+            }
+            top->list = new_cell;
+            top->items_read++;
+            // Frames with an item budget (quote) close as soon as it is met
+            if (top->max_items != -1 && top->items_read >= top->max_items) {
+                current_result = pop_frame(p);
+                result_ready = 1;
+            }
+            continue;
         }
-        else {
-            // Need to read next item
-            if (*parse_ptr == '(') {
-                parse_ptr++;
-                push_frame(&stack, NIL, ')', -1);
-                continue;
+
+        if (p->pos >= p->len) {
+            if (!p->eof) return PARSE_NEED_MORE;
+            // Unclosed parentheses or a dangling quote at end of input
+            if (p->depth > 0) return parse_fail(p);
+            return PARSE_EOF;
+        }
+
+        char c = p->buf[p->pos];
+
+        // Whitespace and `;` line comments
+        if (p->in_comment) {
+            if (c == '\n') p->in_comment = 0;
+            p->pos++;
+            continue;
+        }
+        if (isspace((unsigned char)c)) {
+            p->pos++;
+            continue;
+        }
+        if (c == ';') {
+            p->in_comment = 1;
+            p->pos++;
+            continue;
+        }
+
+        if (c == '(') {
+            if (!push_frame(p, NIL, ')', -1)) {
+                fprintf(stderr, "Parser OOM\n");
+                return parse_fail(p);
             }
-            else if (*parse_ptr == '\'') {
-                parse_ptr++;
-                // Quote expands to (quote <next>)
-                // We create a list (quote) and expect 1 more item
-                Value* q = mk_cell(SYM_QUOTE ? SYM_QUOTE : mk_sym("quote"), NIL);
-                if (!q) {
-                    fprintf(stderr, "Parser OOM\n");
-                    while (stack) {
-                        ParseFrame* f = pop_frame(&stack);
-                        free(f);
-                    }
-                    return NULL;
-                }
-                push_frame(&stack, q, 0, 1);
-                continue;
+            p->pos++;
+            continue;
+        }
+
+        if (c == '\'') {
+            // Quote expands to (quote <next>): a frame expecting 1 more item
+            Value* q = mk_cell(SYM_QUOTE ? SYM_QUOTE : mk_sym("quote"), NIL);
+            if (!q || !push_frame(p, q, 0, 1)) {
+                fprintf(stderr, "Parser OOM\n");
+                return parse_fail(p);
             }
-            else if (*parse_ptr == ')') {
-                // Unexpected closing parenthesis (if stack empty or mismatch)
-                if (!stack) {
-                    parse_ptr++;
-                    return NIL; // Or error? Original parser returned NIL
-                }
-                // If mismatch, we let the closing check above handle it or consume loop
-                // But wait, the check above only fires if closing_char matches.
-                // If we are in a quote frame (closing=0) and see ')', we should close the quote frame?
-                // No, quote expects exactly 1 item. ) is not an item.
-                // This implies malformed input: ' )
-                // Original parser behavior on ')': return NIL.
-                // We should probably just break or return NIL if we see unexpected )
-                // But let's assume valid input for now or minimal error handling.
-                 if (stack && stack->closing_char != ')') {
-                    // We are in a quote or limited frame, but hit ')'.
-                    // This means the quote ended early?
-                    // e.g. (list ' )
-                    // The ' expects an atom or list. ) ends the outer list.
-                    // This is invalid.
-                    // Let's just consume it and let the outer frame handle it.
-                    // But we can't consume it here if it belongs to outer.
-
-                    // Actually, if we see ')' and we are expecting an item (Quote), it's an error.
-                    // But to be robust, maybe we just close the quote frame as is?
-                    current_result = reverse_list(stack->list);
-                    ParseFrame* f = pop_frame(&stack);
-                    free(f);
-                    result_ready = 1;
-                    // Don't consume ')' yet, let next loop iteration handle it for parent
-                 } else {
-                     // Should be handled by closing check above
-                     // If we are here, stack->closing_char != ')' or something.
-                     parse_ptr++;
-                     // Free remaining stack frames before returning
-                     while (stack) {
-                         ParseFrame* f = pop_frame(&stack);
-                         free(f);
-                     }
-                     return NIL;
-                 }
+            p->pos++;
+            continue;
+        }
+
+        if (c == ')') {
+            if (p->depth == 0) {
+                // Unexpected closing parenthesis: reads as nil
+                p->pos++;
+                *out = NIL;
+                return PARSE_FORM;
             }
-            else {
-                // Atom (int or sym)
-                if (isdigit((unsigned char)*parse_ptr) || (*parse_ptr == '-' && isdigit((unsigned char)parse_ptr[1]))) {
-                    errno = 0;
-                    char* endptr;
-                    long i = strtol(parse_ptr, &endptr, 10);
-                    if (errno == ERANGE || (errno != 0 && i == 0)) {
-                        fprintf(stderr, "Parse error: integer overflow\n");
-                        // Consume the invalid token and return NIL
-                        parse_ptr = endptr;
-                        current_result = NIL;
-                    } else {
-                        parse_ptr = endptr;
-                        current_result = mk_int(i);
-                        if (!current_result) {
-                            fprintf(stderr, "Parser OOM\n");
-                            while (stack) {
-                                ParseFrame* f = pop_frame(&stack);
-                                free(f);
-                            }
-                            return NULL;
-                        }
-                    }
-                } else {
-                    const char* start = parse_ptr;
-                    while (*parse_ptr && !isspace((unsigned char)*parse_ptr) && *parse_ptr != ')' && *parse_ptr != '(') {
-                        parse_ptr++;
-                    }
-                    char* s = strndup(start, parse_ptr - start);
-                    if (!s) {
-                        fprintf(stderr, "Parser OOM\n");
-                        while (stack) {
-                            ParseFrame* f = pop_frame(&stack);
-                            free(f);
-                        }
-                        return NULL;
-                    }
-                    current_result = mk_sym(s);
-                    free(s);
-                    if (!current_result) {
-                        fprintf(stderr, "Parser OOM\n");
-                        while (stack) {
-                            ParseFrame* f = pop_frame(&stack);
-                            free(f);
-                        }
-                        return NULL;
-                    }
-                }
+            if (p->frames[p->depth - 1].closing_char != ')') {
+                // ' directly before ')': close the quote as is and leave
+                // the ')' to the enclosing list
+                current_result = pop_frame(p);
                 result_ready = 1;
+                continue;
             }
+            p->pos++;
+            current_result = pop_frame(p);
+            result_ready = 1;
+            continue;
         }
 
-        // If we produced a result, append to stack or return
-        if (result_ready) {
-            result_ready = 0;
-            if (!stack) {
-                return current_result;
+        // Atom (int or sym): wait until its delimiter has arrived
+        size_t end = p->pos;
+        while (end < p->len && !isspace((unsigned char)p->buf[end]) &&
+               p->buf[end] != ')' && p->buf[end] != '(') {
+            end++;
+        }
+        if (end == p->len && !p->eof) return PARSE_NEED_MORE;
+
+        const char* start = p->buf + p->pos;
+        if (isdigit((unsigned char)c) || (c == '-' && end > p->pos + 1 && isdigit((unsigned char)start[1]))) {
+            errno = 0;
+            char* endptr;
+            long i = strtol(start, &endptr, 10);
+            p->pos = (size_t)(endptr - p->buf);
+            if (errno == ERANGE || (errno != 0 && i == 0)) {
+                fprintf(stderr, "Parse error: integer overflow\n");
+                current_result = NIL;
             } else {
-                Value* new_cell = mk_cell(current_result, stack->list);
-                if (!new_cell) {
+                current_result = mk_int(i);
+                if (!current_result) {
                     fprintf(stderr, "Parser OOM\n");
-                    while (stack) {
-                        ParseFrame* f = pop_frame(&stack);
-                        free(f);
-                    }
-                    return NULL;
+                    return parse_fail(p);
                 }
-                stack->list = new_cell;
-                stack->items_read++;
-                current_result = NULL;
+            }
+        } else {
+            current_result = mk_sym_len(start, end - p->pos);
+            p->pos = end;
+            if (!current_result) {
+                fprintf(stderr, "Parser OOM\n");
+                return parse_fail(p);
             }
         }
+        result_ready = 1;
     }
+}
 
-    // Free remaining stack frames on early exit (e.g., unclosed parentheses)
-    while (stack) {
-        ParseFrame* f = pop_frame(&stack);
-        free(f);
+int parser_at_end(Parser* p) {
+    while (p->pos < p->len) {
+        char c = p->buf[p->pos];
+        if (p->in_comment) {
+            if (c == '\n') p->in_comment = 0;
+        } else if (c == ';') {
+            p->in_comment = 1;
+        } else if (!isspace((unsigned char)c)) {
+            return 0;
+        }
+        p->pos++;
     }
+    return p->depth == 0;
+}
+
+// -- Global Parser (whole-string input) --
 
-    return NULL;
+static Parser global_parser;
+
+void set_parse_input(const char* input) {
+    parser_borrow(&global_parser, input);
+}
+
+void skip_ws(void) {
+    parser_at_end(&global_parser);
+}
+
+Value* parse(void) {
+    Value* v = NULL;
+    if (parser_next(&global_parser, &v) != PARSE_FORM) return NULL;
+    return v;
+}
+
+int parse_at_end(void) {
+    return parser_at_end(&global_parser);
 }
 
 // Deprecated recursion entry point (kept for header compat if needed, but parse() covers it)
 Value* parse_list(void) {
-    if (!parse_ptr) return NIL;
-    if (*parse_ptr == '(') {
-        parse_ptr++;
+    Parser* p = &global_parser;
+    if (!p->buf) return NIL;
+    if (p->pos < p->len && p->buf[p->pos] == '(') {
+        p->pos++;
         return parse(); // parse now handles the loop
     }
     return NIL;
-}
\ No newline at end of file
+}
@@ -1,16 +1,91 @@
 #ifndef PURPLE_PARSER_H
 #define PURPLE_PARSER_H
 
+#include <stddef.h>
 #include "../types.h"
 
 // -- Reader/Parser --
 
+// Line and column (both from 1, columns in bytes) of a parsed list
+typedef struct SourcePos {
+    int line;
+    int col;
+} SourcePos;
+
+// Open list (or quote) being read
+typedef struct ParseFrame {
+    Value* list;           // Accumulator for list elements (built in reverse)
+    int closing_char;      // ')' or 0 (for quotes)
+    int max_items;         // -1 (unlimited) or N (for quotes)
+    int items_read;        // Number of items read so far
+    SourcePos pos;         // Its '(' or quote (source positions only)
+} ParseFrame;
+
+// Reentrant parser context. Input arrives in chunks (parser_feed) and each
+// top-level form is returned as soon as it is complete; the open-list
+// stack is one growable array, reused across forms.
+typedef struct Parser {
+    char* buf;             // Unread input (NUL-terminated)
+    size_t len;
+    size_t cap;
+    size_t pos;            // Next byte to read
+    int borrowed;          // buf is caller memory (set_parse_input)
+    int eof;               // No more input will be fed
+    int in_comment;        // Inside a `;` comment that spans chunks
+    ParseFrame* frames;
+    int depth;
+    int frame_cap;
+    size_t counted;        // Bytes before this are counted into line/col
+    int line;              // Position of buf[counted] (source positions only)
+    int col;
+} Parser;
+
+typedef enum {
+    PARSE_NEED_MORE,       // Form incomplete: feed more input
+    PARSE_FORM,            // *out holds the next top-level form
+    PARSE_EOF,             // Input finished cleanly
+    PARSE_ERROR            // Malformed or truncated input; state is reset
+} ParseStatus;
+
+// Create/destroy
+void parser_init(Parser* p);
+void parser_destroy(Parser* p);
+Parser* parser_new(void);
+void parser_free(Parser* p);
+
+// Input: append a chunk (0 on OOM), or mark the end of input
+int parser_feed(Parser* p, const char* data, size_t len);
+void parser_finish(Parser* p);
+
+// Next top-level form
+ParseStatus parser_next(Parser* p, Value** out);
+
+// Whether only whitespace and comments remain (and no list is open)
+int parser_at_end(Parser* p);
+
+// -- Source Positions --
+// While enabled, every non-empty list any parser reads is recorded with
+// the position of its '(' (or quote), for reports that point back into
+// the source. Off by default: parsing then counts no lines at all.
+// Enable it before the input is fed, on the thread that parses.
+
+// Start recording into an empty table (on) or stop and drop it (off)
+void source_positions_enable(int on);
+
+// Where form was read; 0 if it was not recorded
+int source_pos(Value* form, SourcePos* out);
+
+// -- Global Parser (whole-string input) --
+
 // Set input string
 void set_parse_input(const char* input);
 
 // Parse a single expression
 Value* parse(void);
 
+// Whether only whitespace and comments remain in the input
+int parse_at_end(void);
+
 // Parse helpers
 void skip_ws(void);
 Value* parse_list(void);
@@ -1,101 +1,186 @@
 #define _POSIX_C_SOURCE 200809L
 #include "types.h"
 #include "util/dstring.h"
+#include "memory/arena.h"
 #include <string.h>
+#include <stdarg.h>
+#include <pthread.h>
 
 // -- Compiler Arena (Phase 12) --
-// Global arena for all compiler-phase allocations
+// Compiler-phase allocations go to the innermost of a stack of Arenas. The
+// base arena lives until compiler_arena_cleanup; scopes pushed on top of
+// it hold one form each and are released (or merged down) when it is done.
+// The current arena is per thread: worker threads that evaluate alongside
+// the main one allocate into arenas of their own (compiler_arena_attach).
+
+#define COMPILER_ARENA_BLOCK 65536  // 64KB blocks for the base arena
+#define COMPILER_SCOPE_BLOCK 512    // First block of a form scope; doubles
+#define COMPILER_ARENA_MAX_DEPTH 64
+
+// Interned symbol (see Symbol Interning below)
+typedef struct SymEntry {
+    Value* sym;
+    unsigned long hash;
+    struct SymEntry* next;
+    struct SymEntry* scope_next;  // Chain of the arena scope that owns sym
+} SymEntry;
+
+typedef struct CompilerScope {
+    Arena* arena;
+    SymEntry* syms;   // Symbols interned while this scope was innermost
+} CompilerScope;
+
+static CompilerScope compiler_scopes[COMPILER_ARENA_MAX_DEPTH];
+static int compiler_depth = 0;
+static __thread Arena* compiler_arena_current = NULL;
+
+static void sym_table_drop(SymEntry* chain);
 
-typedef struct ArenaBlock {
-    char* memory;
-    size_t size;
-    size_t used;
-    struct ArenaBlock* next;
-} ArenaBlock;
-
-typedef struct StringNode {
-    char* s;
-    struct StringNode* next;
-} StringNode;
-
-static ArenaBlock* compiler_arena_blocks = NULL;
-static ArenaBlock* compiler_arena_current = NULL;
-static StringNode* compiler_strings = NULL;
-static size_t compiler_arena_block_size = 65536;  // 64KB blocks
-static int compiler_arena_string_oom = 0;
-
-static void* compiler_arena_alloc(size_t size);
+static void* compiler_arena_alloc(size_t size) {
+    Arena* a = compiler_arena_current;
+    ArenaBlock* before = a->current;
+    void* p = arena_alloc(a, size);
+    // Form scopes start small (most forms are) and grow toward base size
+    if (a->current != before && a->block_size < COMPILER_ARENA_BLOCK) a->block_size *= 2;
+    return p;
+}
 
 void compiler_arena_init(void) {
-    compiler_arena_blocks = NULL;
-    compiler_arena_current = NULL;
-    compiler_strings = NULL;
-    compiler_arena_string_oom = 0;
-    // Allocate initial block so compiler allocations use the arena
-    (void)compiler_arena_alloc(0);
+    compiler_arena_cleanup();
+    compiler_arena_push();
 }
 
-static void* compiler_arena_alloc(size_t size) {
-    // Align to 8 bytes
-    size = (size + 7) & ~(size_t)7;
-
-    if (!compiler_arena_current || compiler_arena_current->used + size > compiler_arena_current->size) {
-        // Need new block
-        size_t bs = compiler_arena_block_size;
-        if (size > bs) bs = size;
-
-        ArenaBlock* b = malloc(sizeof(ArenaBlock));
-        if (!b) return NULL;
-        b->memory = malloc(bs);
-        if (!b->memory) {
-            free(b);
-            return NULL;
+int compiler_arena_push(void) {
+    if (compiler_depth == COMPILER_ARENA_MAX_DEPTH) return 0;
+    Arena* a = arena_create(compiler_depth ? COMPILER_SCOPE_BLOCK : COMPILER_ARENA_BLOCK);
+    if (!a) return 0;
+    compiler_scopes[compiler_depth].arena = a;
+    compiler_scopes[compiler_depth].syms = NULL;
+    compiler_depth++;
+    compiler_arena_current = a;
+    return 1;
+}
+
+void compiler_arena_pop(int keep) {
+    if (compiler_depth == 0) return;
+    CompilerScope* scope = &compiler_scopes[--compiler_depth];
+    CompilerScope* parent = compiler_depth > 0 ? &compiler_scopes[compiler_depth - 1] : NULL;
+
+    if (keep && parent) {
+        // Everything the form allocated now lives as long as the parent
+        arena_merge(parent->arena, scope->arena);
+        if (scope->syms) {
+            SymEntry** tail = &scope->syms;
+            while (*tail) tail = &(*tail)->scope_next;
+            *tail = parent->syms;
+            parent->syms = scope->syms;
         }
-        b->size = bs;
-        b->used = 0;
-        b->next = compiler_arena_blocks;
-        compiler_arena_blocks = b;
-        compiler_arena_current = b;
+    } else {
+        // Interned symbols from this scope go first: they point into it
+        sym_table_drop(scope->syms);
+        arena_destroy(scope->arena);
     }
+    scope->arena = NULL;
+    scope->syms = NULL;
+    compiler_arena_current = parent ? parent->arena : NULL;
+}
 
-    void* ptr = compiler_arena_current->memory + compiler_arena_current->used;
-    compiler_arena_current->used += size;
-    return ptr;
+int compiler_arena_depth(void) {
+    return compiler_depth;
 }
 
 void compiler_arena_register_string(char* s) {
-    if (!s || compiler_arena_string_oom) return;
-    StringNode* node = compiler_arena_alloc(sizeof(StringNode));
-    if (!node) {
-        compiler_arena_string_oom = 1;
-        fprintf(stderr, "Warning: OOM tracking compiler string; potential leak\n");
-        return;
-    }
-    node->s = s;
-    node->next = compiler_strings;
-    compiler_strings = node;
+    compiler_arena_register_release(s, free);
+}
+
+void compiler_arena_register_release(void* ptr, void (*release)(void*)) {
+    if (!ptr || !compiler_arena_current) return;
+    arena_register_external(compiler_arena_current, ptr, release);
 }
 
 void compiler_arena_cleanup(void) {
-    // Free all strings
-    StringNode* sn = compiler_strings;
-    while (sn) {
-        StringNode* next = sn->next;
-        free(sn->s);
-        sn = next;
+    while (compiler_depth > 0) compiler_arena_pop(0);
+}
+
+// -- Worker Threads --
+// A worker thread gets its own arena and gives it back when it is done; the
+// main thread merges it into the innermost scope, so what the worker
+// allocated lives exactly as long as what the main thread allocated there.
+// Symbols a worker interns join that scope's chain for the same reason.
+
+static int sym_table_shared = 0;  // Other threads may intern: take the lock
+static pthread_mutex_t sym_table_lock = PTHREAD_MUTEX_INITIALIZER;
+
+Arena* compiler_arena_fork(void) {
+    if (!compiler_arena_current) return NULL;
+    return arena_create(COMPILER_SCOPE_BLOCK);
+}
+
+void compiler_arena_attach(Arena* a) {
+    compiler_arena_current = a;
+}
+
+void compiler_arena_adopt(Arena* a) {
+    if (!a) return;
+    if (compiler_arena_current) arena_merge(compiler_arena_current, a);
+    else arena_destroy(a);
+}
+
+void compiler_arena_share(int on) {
+    __atomic_store_n(&sym_table_shared, on, __ATOMIC_SEQ_CST);
+}
+
+// -- Symbol Interning --
+// Every T_SYM is canonical: one Value per spelling, so sym_eq is a
+// pointer compare. Entries are malloc'd so the table outlives the arena;
+// symbols allocated in an arena scope are dropped when it is released.
+
+static SymEntry** sym_table = NULL;
+static size_t sym_table_buckets = 0;
+static size_t sym_table_count = 0;
+
+static unsigned long sym_hash(const char* s, size_t len) {
+    // FNV-1a
+    unsigned long h = 2166136261UL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619UL;
     }
-    compiler_strings = NULL;
-
-    // Free all arena blocks
-    ArenaBlock* b = compiler_arena_blocks;
-    while (b) {
-        ArenaBlock* next = b->next;
-        free(b->memory);
-        free(b);
-        b = next;
+    return h;
+}
+
+static int sym_table_grow(void) {
+    size_t nb = sym_table_buckets ? sym_table_buckets * 2 : 256;
+    SymEntry** nt = calloc(nb, sizeof(SymEntry*));
+    if (!nt) return 0;
+    for (size_t i = 0; i < sym_table_buckets; i++) {
+        SymEntry* e = sym_table[i];
+        while (e) {
+            SymEntry* next = e->next;
+            size_t idx = e->hash & (nb - 1);
+            e->next = nt[idx];
+            nt[idx] = e;
+            e = next;
+        }
+    }
+    free(sym_table);
+    sym_table = nt;
+    sym_table_buckets = nb;
+    return 1;
+}
+
+static void sym_table_drop(SymEntry* chain) {
+    while (chain) {
+        SymEntry* next = chain->scope_next;
+        SymEntry** pp = &sym_table[chain->hash & (sym_table_buckets - 1)];
+        while (*pp && *pp != chain) pp = &(*pp)->next;
+        if (*pp) {
+            *pp = chain->next;
+            sym_table_count--;
+        }
+        free(chain);
+        chain = next;
     }
-    compiler_arena_blocks = NULL;
-    compiler_arena_current = NULL;
 }
 
 // -- Value Constructors --
@@ -109,32 +194,80 @@ Value* alloc_val(Tag tag) {
     }
     if (!v) return NULL;
     v->tag = tag;
+    v->sym_form = 0;
     return v;
 }
 
 Value* mk_int(long i) {
+    if (i >= FIXNUM_MIN && i <= FIXNUM_MAX) return mk_fixnum(i);
     Value* v = alloc_val(T_INT);
     if (!v) return NULL;
     v->i = i;
     return v;
 }
 
-Value* mk_sym(const char* s) {
-    if (!s) s = "";
+static Value* sym_intern(const char* s, size_t len, unsigned long h) {
+
+    if (sym_table_buckets) {
+        for (SymEntry* e = sym_table[h & (sym_table_buckets - 1)]; e; e = e->next) {
+            if (e->hash == h && strncmp(e->sym->s, s, len) == 0 && e->sym->s[len] == '\0') {
+                return e->sym;
+            }
+        }
+    }
+
+    if (sym_table_count >= sym_table_buckets * 3 / 4 && !sym_table_grow()) {
+        return NULL;
+    }
+
+    SymEntry* e = malloc(sizeof(SymEntry));
+    if (!e) return NULL;
     Value* v = alloc_val(T_SYM);
-    if (!v) return NULL;
-    v->s = strdup(s);
+    if (!v) {
+        free(e);
+        return NULL;
+    }
+    v->s = strndup(s, len);
     if (!v->s) {
         // Don't free v if using arena (arena will bulk free)
         if (!compiler_arena_current) free(v);
+        free(e);
         return NULL;
     }
     if (compiler_arena_current) {
         compiler_arena_register_string(v->s);
     }
+
+    e->sym = v;
+    e->hash = h;
+    e->scope_next = NULL;
+    if (compiler_arena_current) {
+        CompilerScope* scope = &compiler_scopes[compiler_depth - 1];
+        e->scope_next = scope->syms;
+        scope->syms = e;
+    }
+    size_t idx = h & (sym_table_buckets - 1);
+    e->next = sym_table[idx];
+    sym_table[idx] = e;
+    sym_table_count++;
+    return v;
+}
+
+Value* mk_sym_len(const char* s, size_t len) {
+    if (!s) { s = ""; len = 0; }
+    unsigned long h = sym_hash(s, len);
+    if (!__atomic_load_n(&sym_table_shared, __ATOMIC_SEQ_CST)) return sym_intern(s, len, h);
+    pthread_mutex_lock(&sym_table_lock);
+    Value* v = sym_intern(s, len, h);
+    pthread_mutex_unlock(&sym_table_lock);
     return v;
 }
 
+Value* mk_sym(const char* s) {
+    if (!s) s = "";
+    return mk_sym_len(s, strlen(s));
+}
+
 Value* mk_cell(Value* car, Value* cdr) {
     Value* v = alloc_val(T_CELL);
     if (!v) return NULL;
@@ -147,25 +280,182 @@ Value* mk_prim(PrimFn fn) {
     Value* v = alloc_val(T_PRIM);
     if (!v) return NULL;
     v->prim = fn;
+    v->prim2 = NULL;
     return v;
 }
 
-Value* mk_code(const char* s) {
-    if (!s) s = "";
+Value* mk_prim2(PrimFn fn, Prim2Fn fast) {
+    Value* v = mk_prim(fn);
+    if (!v) return NULL;
+    v->prim2 = fast;
+    return v;
+}
+
+Value* mk_code_len(const char* s, size_t len) {
+    if (!s) { s = ""; len = 0; }
     Value* v = alloc_val(T_CODE);
     if (!v) return NULL;
-    v->s = strdup(s);
+    v->ir = NULL;
+    v->parts = NULL;
+    v->len = len;
+    v->s = malloc(len + 1);
     if (!v->s) {
         // Don't free v if using arena (arena will bulk free)
         if (!compiler_arena_current) free(v);
         return NULL;
     }
+    memcpy(v->s, s, len);
+    v->s[len] = '\0';
     if (compiler_arena_current) {
         compiler_arena_register_string(v->s);
     }
     return v;
 }
 
+Value* mk_code(const char* s) {
+    return mk_code_len(s, s ? strlen(s) : 0);
+}
+
+// -- Staged Code --
+
+void cb_init(CodeBuilder* cb) {
+    cb->head = cb->tail = NULL;
+    cb->len = 0;
+    cb->oom = 0;
+}
+
+void cb_code(CodeBuilder* cb, Value* code) {
+    if (cb->oom) return;
+    if (!code || val_tag(code) != T_CODE) {
+        cb->oom = 1;
+        return;
+    }
+    if (code->len == 0) return;
+    Value* cell = mk_cell(code, NULL);
+    if (!cell) {
+        cb->oom = 1;
+        return;
+    }
+    if (cb->tail) cb->tail->cell.cdr = cell;
+    else cb->head = cell;
+    cb->tail = cell;
+    cb->len += code->len;
+}
+
+void cb_text(CodeBuilder* cb, const char* s) {
+    if (cb->oom || !s || !*s) return;
+    cb_code(cb, mk_code(s));
+}
+
+void cb_textf(CodeBuilder* cb, const char* fmt, ...) {
+    if (cb->oom) return;
+    va_list args, copy;
+    va_start(args, fmt);
+    va_copy(copy, args);
+    char buf[256];
+    int n = vsnprintf(buf, sizeof(buf), fmt, copy);
+    va_end(copy);
+    if (n < 0) {
+        cb->oom = 1;
+    } else if ((size_t)n < sizeof(buf)) {
+        cb_code(cb, mk_code_len(buf, (size_t)n));
+    } else {
+        char* big = malloc((size_t)n + 1);
+        if (big) {
+            vsnprintf(big, (size_t)n + 1, fmt, args);
+            cb_code(cb, mk_code_len(big, (size_t)n));
+            free(big);
+        } else {
+            cb->oom = 1;
+        }
+    }
+    va_end(args);
+}
+
+Value* cb_finish(CodeBuilder* cb) {
+    if (cb->oom) return NULL;
+    if (!cb->head) return mk_code("");
+    // A single part is that code itself
+    if (is_nil(cdr(cb->head))) return car(cb->head);
+    Value* v = alloc_val(T_CODE);
+    if (!v) return NULL;
+    v->s = NULL;
+    v->ir = NULL;
+    v->parts = cb->head;
+    v->len = cb->len;
+    return v;
+}
+
+// Walk the rope with an explicit stack: nesting follows the staged
+// program, which can be far deeper than the C stack allows. Stops once
+// `limit` bytes are written
+static void rope_write(DString* ds, Value* code, size_t limit) {
+    if (code->s) {
+        ds_append_len(ds, code->s, code->len < limit ? code->len : limit);
+        return;
+    }
+    size_t cap = 64, depth = 0;
+    Value** stack = malloc(cap * sizeof(Value*));
+    if (!stack) return;
+    stack[depth++] = code->parts;
+    while (depth && limit) {
+        Value* rest = stack[depth - 1];
+        if (is_nil(rest)) {
+            depth--;
+            continue;
+        }
+        stack[depth - 1] = cdr(rest);
+        Value* part = car(rest);
+        if (part->s) {
+            size_t n = part->len < limit ? part->len : limit;
+            ds_append_len(ds, part->s, n);
+            limit -= n;
+            continue;
+        }
+        if (depth == cap) {
+            Value** grown = realloc(stack, cap * 2 * sizeof(Value*));
+            if (!grown) break;
+            stack = grown;
+            cap *= 2;
+        }
+        stack[depth++] = part->parts;
+    }
+    free(stack);
+}
+
+void code_write(DString* ds, Value* code) {
+    if (!code || val_tag(code) != T_CODE) return;
+    if (!code->s && !ds_ensure_capacity(ds, ds_len(ds) + code->len + 1)) return;
+    rope_write(ds, code, code->len);
+}
+
+const char* code_text(Value* code) {
+    if (!code || val_tag(code) != T_CODE) return NULL;
+    if (code->s) return code->s;
+    DString* ds = ds_with_capacity(code->len + 1);
+    if (!ds) return NULL;
+    code_write(ds, code);
+    code->s = ds_take(ds);
+    if (code->s && compiler_arena_current) compiler_arena_register_string(code->s);
+    return code->s;
+}
+
+size_t code_len(Value* code) {
+    return code && val_tag(code) == T_CODE ? code->len : 0;
+}
+
+int code_starts_with(Value* code, const char* prefix) {
+    size_t n = strlen(prefix);
+    if (!code || val_tag(code) != T_CODE || code->len < n) return 0;
+    if (code->s) return strncmp(code->s, prefix, n) == 0;
+    DString* ds = ds_with_capacity(n + 1);
+    if (!ds) return 0;
+    rope_write(ds, code, n);
+    int match = strcmp(ds_cstr(ds), prefix) == 0;
+    ds_free(ds);
+    return match;
+}
+
 Value* mk_lambda(Value* params, Value* body, Value* env) {
     Value* v = alloc_val(T_LAMBDA);
     if (!v) return NULL;
@@ -222,8 +512,8 @@ Value* mk_chan(int capacity) {
     ch->tail = 0;
     ch->count = 0;
     ch->closed = 0;
-    ch->send_waiters = NULL;
-    ch->recv_waiters = NULL;
+    ch->senders.head = ch->senders.tail = NULL;
+    ch->receivers.head = ch->receivers.tail = NULL;
 
     // Allocate buffer for buffered channels
     if (capacity > 0) {
@@ -253,41 +543,88 @@ Value* mk_process(Value* thunk) {
     v->proc.menv = NULL;
     v->proc.result = NULL;
     v->proc.park_value = NULL;
+    v->proc.stack = NULL;
     v->proc.state = PROC_READY;
     return v;
 }
 
+Value* mk_frame(Value* names, int count, Value* next) {
+    Value* v = alloc_val(T_FRAME);
+    if (!v) return NULL;
+    size_t bytes = sizeof(Value*) * (count > 0 ? count : 1);
+    Value** slots = compiler_arena_current ? compiler_arena_alloc(bytes) : malloc(bytes);
+    if (!slots) {
+        if (!compiler_arena_current) free(v);
+        return NULL;
+    }
+    memset(slots, 0, bytes);
+    v->frame.names = names;
+    v->frame.slots = slots;
+    v->frame.count = count;
+    v->frame.next = next;
+    return v;
+}
+
+Value* mk_lref(Value* sym, int depth, int slot) {
+    Value* v = alloc_val(T_LREF);
+    if (!v) return NULL;
+    v->lref.sym = sym;
+    v->lref.depth = depth;
+    v->lref.slot = slot;
+    return v;
+}
+
+Value* mk_vector(long len) {
+    if (len < 0) return NULL;
+    Value* v = alloc_val(T_VECTOR);
+    if (!v) return NULL;
+    size_t bytes = sizeof(long) * (size_t)(len > 0 ? len : 1);
+    long* elems = compiler_arena_current ? compiler_arena_alloc(bytes) : malloc(bytes);
+    if (!elems) {
+        if (!compiler_arena_current) free(v);
+        return NULL;
+    }
+    memset(elems, 0, bytes);
+    v->vec.elems = elems;
+    v->vec.len = len;
+    return v;
+}
+
 // -- Type Predicates --
 
 int is_box(Value* v) {
-    return v != NULL && v->tag == T_BOX;
+    return v != NULL && val_tag(v) == T_BOX;
 }
 
 int is_cont(Value* v) {
-    return v != NULL && v->tag == T_CONT;
+    return v != NULL && val_tag(v) == T_CONT;
 }
 
 int is_chan(Value* v) {
-    return v != NULL && v->tag == T_CHAN;
+    return v != NULL && val_tag(v) == T_CHAN;
 }
 
 int is_process(Value* v) {
-    return v != NULL && v->tag == T_PROCESS;
+    return v != NULL && val_tag(v) == T_PROCESS;
 }
 
 int is_error(Value* v) {
-    return v != NULL && v->tag == T_ERROR;
+    return v != NULL && val_tag(v) == T_ERROR;
+}
+
+int is_vector(Value* v) {
+    return v != NULL && val_tag(v) == T_VECTOR;
 }
 
 // -- Box Operations --
 
 Value* box_get(Value* box) {
-    if (!box || box->tag != T_BOX) return NULL;
+    if (!box || val_tag(box) != T_BOX) return NULL;
     return box->box_value;
 }
 
 void box_set(Value* box, Value* val) {
-    if (box && box->tag == T_BOX) {
+    if (box && val_tag(box) == T_BOX) {
         box->box_value = val;
     }
 }
@@ -295,113 +632,135 @@ void box_set(Value* box, Value* val) {
 // -- Value Helpers --
 
 int is_nil(Value* v) {
-    return v == NULL || v->tag == T_NIL;
+    return v == NULL || val_tag(v) == T_NIL;
 }
 
 int is_code(Value* v) {
-    return v && v->tag == T_CODE;
+    return v && val_tag(v) == T_CODE;
 }
 
 Value* car(Value* v) {
-    return (v && v->tag == T_CELL) ? v->cell.car : NULL;
+    return (v && val_tag(v) == T_CELL) ? v->cell.car : NULL;
 }
 
 Value* cdr(Value* v) {
-    return (v && v->tag == T_CELL) ? v->cell.cdr : NULL;
+    return (v && val_tag(v) == T_CELL) ? v->cell.cdr : NULL;
 }
 
 int sym_eq(Value* s1, Value* s2) {
     if (!s1 || !s2) return 0;
-    if (s1->tag != T_SYM || s2->tag != T_SYM) return 0;
-    if (!s1->s || !s2->s) return 0;
-    return strcmp(s1->s, s2->s) == 0;
+    // Symbols are interned, so identity is equality
+    return s1 == s2 && val_tag(s1) == T_SYM;
 }
 
 int sym_eq_str(Value* s1, const char* s2) {
-    if (!s1 || s1->tag != T_SYM) return 0;
+    if (!s1 || val_tag(s1) != T_SYM) return 0;
     if (!s1->s || !s2) return 0;
     return strcmp(s1->s, s2) == 0;
 }
 
-char* list_to_str(Value* v) {
-    DString* ds = ds_new();
-    if (!ds) return NULL;
+void list_write(DString* ds, Value* v) {
     ds_append_char(ds, '(');
     while (v && !is_nil(v)) {
-        char* s = val_to_str(car(v));
-        if (s) {
-            ds_append(ds, s);
-            free(s);
-        }
+        val_write(ds, car(v));
         v = cdr(v);
         if (v && !is_nil(v)) ds_append_char(ds, ' ');
     }
     ds_append_char(ds, ')');
-    return ds_take(ds);
 }
 
-char* val_to_str(Value* v) {
-    if (!v) return strdup("NULL");
-    DString* ds;
-    switch (v->tag) {
+void val_write(DString* ds, Value* v) {
+    if (!v) {
+        ds_append(ds, "NULL");
+        return;
+    }
+    switch (val_tag(v)) {
         case T_INT:
-            ds = ds_new();
-            if (!ds) return NULL;
-            ds_append_int(ds, v->i);
-            return ds_take(ds);
+            ds_append_int(ds, val_int(v));
+            return;
         case T_SYM:
-            return v->s ? strdup(v->s) : NULL;
+            if (v->s) ds_append(ds, v->s);
+            return;
         case T_CODE:
-            return v->s ? strdup(v->s) : NULL;
+            code_write(ds, v);
+            return;
         case T_CELL:
-            return list_to_str(v);
+            list_write(ds, v);
+            return;
         case T_NIL:
-            return strdup("()");
+            ds_append(ds, "()");
+            return;
         case T_PRIM:
-            return strdup("#<prim>");
+            ds_append(ds, "#<prim>");
+            return;
         case T_LAMBDA:
-            return strdup("#<lambda>");
+            ds_append(ds, "#<lambda>");
+            return;
         case T_MENV:
-            return strdup("#<menv>");
+            ds_append(ds, "#<menv>");
+            return;
         case T_ERROR:
-            ds = ds_new();
-            if (!ds) return NULL;
             ds_append(ds, "#<error: ");
             if (v->s) ds_append(ds, v->s);
             ds_append(ds, ">");
-            return ds_take(ds);
+            return;
         case T_BOX:
-            ds = ds_new();
-            if (!ds) return NULL;
             ds_append(ds, "#<box ");
-            if (v->box_value) {
-                char* inner = val_to_str(v->box_value);
-                if (inner) {
-                    ds_append(ds, inner);
-                    free(inner);
-                }
-            } else {
-                ds_append(ds, "nil");
-            }
+            if (v->box_value) val_write(ds, v->box_value);
+            else ds_append(ds, "nil");
             ds_append(ds, ">");
-            return ds_take(ds);
+            return;
         case T_CONT:
-            return strdup("#<continuation>");
+            ds_append(ds, "#<continuation>");
+            return;
         case T_CHAN:
-            ds = ds_new();
-            if (!ds) return NULL;
             ds_printf(ds, "#<channel cap=%d>", v->chan.capacity);
-            return ds_take(ds);
+            return;
         case T_PROCESS: {
             const char* state_names[] = {"ready", "running", "parked", "done"};
             const char* state = (v->proc.state >= 0 && v->proc.state <= 3)
                                 ? state_names[v->proc.state] : "unknown";
-            ds = ds_new();
-            if (!ds) return NULL;
             ds_printf(ds, "#<process %s>", state);
-            return ds_take(ds);
+            return;
         }
+        case T_FRAME:
+            ds_append(ds, "#<frame>");
+            return;
+        case T_LREF:
+            val_write(ds, v->lref.sym);
+            return;
+        case T_VECTOR:
+            ds_append(ds, "#(");
+            for (long i = 0; i < v->vec.len; i++) {
+                if (i) ds_append_char(ds, ' ');
+                ds_append_int(ds, v->vec.elems[i]);
+            }
+            ds_append_char(ds, ')');
+            return;
         default:
-            return strdup("?");
+            ds_append(ds, "?");
+            return;
     }
 }
+
+char* list_to_str(Value* v) {
+    DString* ds = ds_new();
+    if (!ds) return NULL;
+    list_write(ds, v);
+    return ds_take(ds);
+}
+
+char* val_to_str(Value* v) {
+    DString* ds = ds_new();
+    if (!ds) return NULL;
+    val_write(ds, v);
+    return ds_take(ds);
+}
+
+void val_print(FILE* out, Value* v) {
+    DString* ds = ds_new();
+    if (!ds) return;
+    val_write(ds, v);
+    fwrite(ds->data, 1, ds->len, out);
+    ds_free(ds);
+}
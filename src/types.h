@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 
 // -- Core Value Types --
 
@@ -13,13 +14,17 @@ typedef enum {
     T_BOX,      // Mutable reference cell
     T_CONT,     // First-class continuation
     T_CHAN,     // CSP channel
-    T_PROCESS   // Green thread / process
+    T_PROCESS,  // Green thread / process
+    T_FRAME,    // Flat activation frame (lexically addressed env)
+    T_LREF,     // Resolved variable reference (frame depth, slot)
+    T_VECTOR    // Contiguous unboxed longs
 } Tag;
 
 struct Value;
 
 // Function pointer types
 typedef struct Value* (*PrimFn)(struct Value* args, struct Value* menv);
+typedef struct Value* (*Prim2Fn)(struct Value* a, struct Value* b);
 typedef struct Value* (*HandlerFn)(struct Value* exp, struct Value* menv);
 
 // Forward declarations for new types
@@ -33,6 +38,13 @@ typedef struct Value* (*ContFn)(struct Value* val);
 #define PROC_PARKED  2
 #define PROC_DONE    3
 
+// FIFO of processes parked on a channel; the waiters live on their stacks
+struct ChanWaiter;
+typedef struct WaitQueue {
+    struct ChanWaiter* head;
+    struct ChanWaiter* tail;
+} WaitQueue;
+
 // Channel structure for CSP (cooperative, continuation-based)
 typedef struct Channel {
     struct Value** buffer;      // Circular buffer for buffered channels
@@ -41,8 +53,8 @@ typedef struct Channel {
     int tail;
     int count;
     int closed;
-    struct Value* send_waiters; // List of (process . value) waiting to send
-    struct Value* recv_waiters; // List of processes waiting to receive
+    WaitQueue senders;          // Parked senders, each holding its value
+    WaitQueue receivers;        // Parked receivers
 } Channel;
 
 // Continuation escape structure (for setjmp/longjmp)
@@ -54,17 +66,27 @@ typedef struct ContEscape {
     int active;
 } ContEscape;
 
-// Prompt stack for delimited continuations
-#define MAX_PROMPT_DEPTH 64
+// Tag of an escape-only continuation (analysis/oneshot.h): it is only
+// called in tail position, so invoking it just returns its argument
+#define CONT_TAG_RETURN 0
 
 // Core Value structure
 typedef struct Value {
     Tag tag;
+    int sym_form;                        // T_SYM: special-form slot, 0 if none
     union {
         long i;                          // T_INT
-        char* s;                         // T_SYM, T_CODE, T_ERROR
+        struct {
+            char* s;                     // T_SYM, T_ERROR; T_CODE: its text, once flattened
+            struct Value* ir;            // T_CODE: known int structure (fold.h), or NULL
+            struct Value* parts;         // T_CODE: rope of T_CODE parts, or NULL for text
+            size_t len;                  // T_CODE: length of the text
+        };
         struct { struct Value* car; struct Value* cdr; } cell;  // T_CELL
-        PrimFn prim;                     // T_PRIM
+        struct {                         // T_PRIM
+            PrimFn prim;
+            Prim2Fn prim2;               // Binary fast path, or NULL
+        };
         struct {                         // T_MENV
             struct Value* env;
             struct Value* parent;
@@ -95,24 +117,61 @@ typedef struct Value {
             struct Value* menv;          // Saved meta-environment
             struct Value* result;        // Final result when done
             struct Value* park_value;    // Value for park/unpark
+            struct GoStack* stack;       // Own C stack while it can suspend
             int state;
         } proc;
+        struct {                         // T_FRAME - activation frame
+            struct Value* names;         // Binder symbols in slot order
+            struct Value** slots;        // NULL slot = unbound
+            int count;
+            struct Value* next;          // Enclosing environment
+        } frame;
+        struct {                         // T_LREF - lexical address
+            struct Value* sym;           // Original symbol (for fallback)
+            int depth;                   // Frames to skip
+            int slot;
+        } lref;
+        struct {                         // T_VECTOR - unboxed elements
+            long* elems;
+            long len;
+        } vec;
     };
 } Value;
 
+// -- Immediate Integers --
+// Integers that fit in 63 bits are encoded in the pointer itself (low bit
+// set) and allocate nothing. Never dereference a Value* that may hold an
+// int: read its tag and payload through val_tag/val_int.
+
+#define FIXNUM_MIN (INTPTR_MIN >> 1)
+#define FIXNUM_MAX (INTPTR_MAX >> 1)
+
+// Macros rather than inline functions: the default build is unoptimised
+// and these sit on every hot path. Arguments must be side-effect free.
+#define is_fixnum(v) (((uintptr_t)(v) & 1) != 0)
+#define mk_fixnum(n) ((Value*)(((uintptr_t)(long)(n) << 1) | 1))
+#define val_tag(v)   (is_fixnum(v) ? T_INT : (v)->tag)
+#define val_int(v)   (is_fixnum(v) ? (long)((intptr_t)(v) >> 1) : (v)->i)
+
 // -- Value Constructors --
 Value* alloc_val(Tag tag);
 Value* mk_int(long i);
-Value* mk_sym(const char* s);
+Value* mk_sym(const char* s);              // Interned: same spelling, same Value*
+Value* mk_sym_len(const char* s, size_t len);
 Value* mk_cell(Value* car, Value* cdr);
 Value* mk_prim(PrimFn fn);
+Value* mk_prim2(PrimFn fn, Prim2Fn fast);  // Fixed two-argument primitive
 Value* mk_code(const char* s);
+Value* mk_code_len(const char* s, size_t len);
 Value* mk_lambda(Value* params, Value* body, Value* env);
 Value* mk_error(const char* msg);
 Value* mk_box(Value* initial);
 Value* mk_cont(ContFn fn, Value* menv, int tag);
 Value* mk_chan(int capacity);
 Value* mk_process(Value* thunk);
+Value* mk_frame(Value* names, int count, Value* next);
+Value* mk_lref(Value* sym, int depth, int slot);
+Value* mk_vector(long len);                // Elements zeroed
 
 // -- Type Predicates --
 int is_box(Value* v);
@@ -120,6 +179,7 @@ int is_cont(Value* v);
 int is_chan(Value* v);
 int is_process(Value* v);
 int is_error(Value* v);
+int is_vector(Value* v);
 
 // -- Box Operations --
 Value* box_get(Value* box);
@@ -130,8 +190,40 @@ int is_nil(Value* v);
 int is_code(Value* v);
 Value* car(Value* v);
 Value* cdr(Value* v);
+// Printing: val_write and list_write append to one buffer, so a value
+// of any size is printed without a string per element; val_to_str and
+// list_to_str return it as a fresh string, val_print writes it to out
+struct DString;
+void val_write(struct DString* ds, Value* v);
+void list_write(struct DString* ds, Value* v);
 char* val_to_str(Value* v);
 char* list_to_str(Value* v);
+void val_print(FILE* out, Value* v);
+
+// -- Staged Code --
+// A T_CODE value is a rope: text, or a list of T_CODE parts that read
+// in order. Code built from code shares its parts instead of copying
+// their text, so assembling nested lifted expressions costs time linear
+// in the output; the text is produced when it is read.
+typedef struct CodeBuilder {
+    Value* head;
+    Value* tail;
+    size_t len;
+    int oom;
+} CodeBuilder;
+
+void cb_init(CodeBuilder* cb);
+void cb_text(CodeBuilder* cb, const char* s);        // Copies s
+void cb_textf(CodeBuilder* cb, const char* fmt, ...);
+void cb_code(CodeBuilder* cb, Value* code);          // Shares code (T_CODE)
+Value* cb_finish(CodeBuilder* cb);                   // NULL on OOM
+
+// The text of code, flattened on first use and kept by that value
+const char* code_text(Value* code);
+size_t code_len(Value* code);
+// Append the text of code to ds without keeping a flat copy
+void code_write(struct DString* ds, Value* code);
+int code_starts_with(Value* code, const char* prefix);
 
 // Symbol comparison
 int sym_eq(Value* s1, Value* s2);
@@ -143,6 +235,24 @@ void compiler_arena_init(void);
 void compiler_arena_cleanup(void);
 void compiler_arena_register_string(char* s);
 
+// Per-form scopes: allocations (and symbols first interned) after a push go
+// to a fresh arena; pop releases it, or with keep merges it into the parent
+int compiler_arena_push(void);     // 0 when no scope could be opened
+void compiler_arena_pop(int keep);
+int compiler_arena_depth(void);
+// Run release(ptr) when the current scope goes (e.g. drop a cache entry)
+void compiler_arena_register_release(void* ptr, void (*release)(void*));
+
+// Other threads: fork an arena on the main thread (NULL when allocations go
+// to malloc), attach it on the worker, adopt it back into the innermost
+// scope once the worker is done. share(1) while workers run, so that
+// symbol interning is locked.
+struct Arena;
+struct Arena* compiler_arena_fork(void);
+void compiler_arena_attach(struct Arena* a);
+void compiler_arena_adopt(struct Arena* a);
+void compiler_arena_share(int on);
+
 // -- List Construction --
 #define LIST1(a) mk_cell(a, NIL)
 #define LIST2(a,b) mk_cell(a, mk_cell(b, NIL))
@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 200809L
+#include "emit.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#define EMIT_FLUSH_BYTES (64 * 1024)
+#define EMIT_INITIAL_CAP (EMIT_FLUSH_BYTES + 4096)
+
+static EmitSink* current_sink = NULL;
+static EmitSink* stdout_sink = NULL;
+
+static EmitSink* sink_new(FILE* f, int owns_file) {
+    EmitSink* sink = malloc(sizeof(EmitSink));
+    if (!sink) return NULL;
+    sink->buf = ds_with_capacity(f ? EMIT_INITIAL_CAP : 4096);
+    if (!sink->buf) {
+        free(sink);
+        return NULL;
+    }
+    sink->file = f;
+    sink->owns_file = owns_file;
+    return sink;
+}
+
+EmitSink* emit_to_file(FILE* f) {
+    if (!f) return NULL;
+    return sink_new(f, 0);
+}
+
+EmitSink* emit_open(const char* path) {
+    if (!path) return NULL;
+    FILE* f = fopen(path, "w");
+    if (!f) return NULL;
+    EmitSink* sink = sink_new(f, 1);
+    if (!sink) fclose(f);
+    return sink;
+}
+
+EmitSink* emit_to_memory(void) {
+    return sink_new(NULL, 0);
+}
+
+static void sink_flush(EmitSink* sink) {
+    if (!sink->file || sink->buf->len == 0) return;
+    fwrite(sink->buf->data, 1, sink->buf->len, sink->file);
+    ds_clear(sink->buf);
+}
+
+void emit_close(EmitSink* sink) {
+    if (!sink) return;
+    sink_flush(sink);
+    if (sink->owns_file) fclose(sink->file);
+    else if (sink->file) fflush(sink->file);
+    if (current_sink == sink) current_sink = NULL;
+    if (stdout_sink == sink) stdout_sink = NULL;
+    ds_free(sink->buf);
+    free(sink);
+}
+
+char* emit_take(EmitSink* sink) {
+    if (!sink) return NULL;
+    if (current_sink == sink) current_sink = NULL;
+    char* text = ds_take(sink->buf);
+    free(sink);
+    return text;
+}
+
+EmitSink* emit_sink(void) {
+    if (current_sink) return current_sink;
+    if (!stdout_sink) stdout_sink = emit_to_file(stdout);
+    return stdout_sink;
+}
+
+EmitSink* emit_set_sink(EmitSink* sink) {
+    EmitSink* prev = current_sink;
+    current_sink = sink;
+    return prev;
+}
+
+static void sink_written(EmitSink* sink) {
+    if (sink->file && sink->buf->len >= EMIT_FLUSH_BYTES) sink_flush(sink);
+}
+
+void emit(const char* fmt, ...) {
+    EmitSink* sink = emit_sink();
+    if (!sink || !fmt) return;
+
+    // Most emitted lines are literal text: skip the formatter for them
+    if (!strchr(fmt, '%')) {
+        ds_append(sink->buf, fmt);
+        sink_written(sink);
+        return;
+    }
+
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (needed > 0 && ds_ensure_capacity(sink->buf, sink->buf->len + (size_t)needed + 1)) {
+        vsnprintf(sink->buf->data + sink->buf->len, (size_t)needed + 1, fmt, args);
+        sink->buf->len += (size_t)needed;
+    }
+    va_end(args);
+    sink_written(sink);
+}
+
+void emit_str(const char* s) {
+    EmitSink* sink = emit_sink();
+    if (!sink || !s) return;
+    ds_append(sink->buf, s);
+    sink_written(sink);
+}
+
+void emit_flush(void) {
+    EmitSink* sink = emit_sink();
+    if (!sink) return;
+    sink_flush(sink);
+    if (sink->file) fflush(sink->file);
+}
@@ -0,0 +1,33 @@
+#ifndef PURPLE_EMIT_H
+#define PURPLE_EMIT_H
+
+#include <stdio.h>
+#include "dstring.h"
+
+// Output sink for generated C code
+// Emitters write into a DString; file sinks hand it to the FILE in large
+// chunks, memory sinks keep everything for in-process compilation.
+
+typedef struct EmitSink {
+    DString* buf;
+    FILE* file;       // NULL for a memory sink
+    int owns_file;    // Opened by emit_open, closed by emit_close
+} EmitSink;
+
+// Create/destroy
+EmitSink* emit_to_file(FILE* f);          // Buffered writer over an open FILE
+EmitSink* emit_open(const char* path);    // Creates/truncates path; NULL on failure
+EmitSink* emit_to_memory(void);
+void emit_close(EmitSink* sink);          // Flushes, closes owned files, frees
+char* emit_take(EmitSink* sink);          // Memory sink: take the text, free sink
+
+// Current sink (defaults to a buffered stdout sink)
+EmitSink* emit_sink(void);
+EmitSink* emit_set_sink(EmitSink* sink);  // Returns the previous sink
+
+// Emission into the current sink
+void emit(const char* fmt, ...);          // printf-style
+void emit_str(const char* s);             // Verbatim
+void emit_flush(void);                    // Push buffered text to the file
+
+#endif // PURPLE_EMIT_H
@@ -1,9 +1,11 @@
 #include "hashmap.h"
+#include "../memory/arena.h"
 #include <stdlib.h>
 #include <string.h>
 
 #define INITIAL_BUCKETS 64
 #define MAX_LOAD_FACTOR 0.75f
+#define ARENA_ENTRY_BLOCK 16384
 
 // Hash function for pointers (uses FNV-1a style mixing)
 static size_t hash_ptr(void* ptr) {
@@ -37,13 +39,47 @@ HashMap* hashmap_with_capacity(size_t capacity) {
     map->entry_count = 0;
     map->load_factor = MAX_LOAD_FACTOR;
     map->had_alloc_failure = 0;
+    map->arena = NULL;
+    map->spare = NULL;
     return map;
 }
 
+// Create with entries in an owned arena
+HashMap* hashmap_new_arena(size_t capacity) {
+    HashMap* map = hashmap_with_capacity(capacity);
+    if (!map) return NULL;
+    map->arena = arena_create(ARENA_ENTRY_BLOCK);
+    if (!map->arena) {
+        hashmap_free(map);
+        return NULL;
+    }
+    return map;
+}
+
+static HashEntry* entry_alloc(HashMap* map) {
+    if (!map->arena) return malloc(sizeof(HashEntry));
+    HashEntry* entry = map->spare;
+    if (entry) {
+        map->spare = entry->next;
+        return entry;
+    }
+    return arena_alloc(map->arena, sizeof(HashEntry));
+}
+
+static void entry_release(HashMap* map, HashEntry* entry) {
+    if (!map->arena) {
+        free(entry);
+        return;
+    }
+    entry->next = map->spare;
+    map->spare = entry;
+}
+
 // Free hash map
 void hashmap_free(HashMap* map) {
     if (!map) return;
     hashmap_free_entries(map);
+    arena_destroy(map->arena);
     free(map->buckets);
     free(map);
 }
@@ -52,6 +88,15 @@ void hashmap_free(HashMap* map) {
 void hashmap_free_entries(HashMap* map) {
     if (!map) return;
 
+    // Arena entries go all at once, leaving the buckets to zero
+    if (map->arena) {
+        memset(map->buckets, 0, map->bucket_count * sizeof(HashEntry*));
+        arena_reset(map->arena);
+        map->spare = NULL;
+        map->entry_count = 0;
+        return;
+    }
+
     for (size_t i = 0; i < map->bucket_count; i++) {
         HashEntry* entry = map->buckets[i];
         while (entry) {
@@ -131,7 +176,7 @@ void hashmap_put(HashMap* map, void* key, void* value) {
     }
 
     // Create new entry
-    entry = malloc(sizeof(HashEntry));
+    entry = entry_alloc(map);
     if (!entry) {
         map->had_alloc_failure = 1;
         return;
@@ -156,7 +201,7 @@ void* hashmap_remove(HashMap* map, void* key) {
         if (entry->key == key) {
             void* value = entry->value;
             *prev = entry->next;
-            free(entry);
+            entry_release(map, entry);
             map->entry_count--;
             return value;
         }
@@ -19,11 +19,16 @@ typedef struct HashMap {
     size_t entry_count;
     float load_factor;
     int had_alloc_failure;
+    struct Arena* arena;     // Entry storage (NULL: malloc per entry)
+    HashEntry* spare;        // Removed arena entries, reused by put
 } HashMap;
 
 // Create/destroy
 HashMap* hashmap_new(void);
 HashMap* hashmap_with_capacity(size_t capacity);
+// Entries bump-allocated from an arena the map owns: hashmap_clear and
+// hashmap_free_entries reset the arena instead of freeing each entry
+HashMap* hashmap_new_arena(size_t capacity);
 void hashmap_free(HashMap* map);
 void hashmap_free_entries(HashMap* map);  // Free entries but not values
 
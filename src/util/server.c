@@ -0,0 +1,149 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+static int make_addr(const char* path, struct sockaddr_un* addr) {
+    if (!path || strlen(path) >= sizeof(addr->sun_path)) return 0;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 1;
+}
+
+// Read until the peer shuts down its write side
+static char* read_all(int fd, size_t* out_len) {
+    size_t cap = 4096;
+    size_t len = 0;
+    char* buf = malloc(cap);
+    if (!buf) return NULL;
+    for (;;) {
+        if (len + 1 == cap) {
+            char* grown = cap > (size_t)-1 / 2 ? NULL : realloc(buf, cap * 2);
+            if (!grown) { free(buf); return NULL; }
+            buf = grown;
+            cap *= 2;
+        }
+        ssize_t n = read(fd, buf + len, cap - len - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) { free(buf); return NULL; }
+        if (n == 0) break;
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+    *out_len = len;
+    return buf;
+}
+
+static int write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Copy the spooled response to the client and empty the spool
+static void send_spool(int sfd, int cfd) {
+    char buf[65536];
+    ssize_t n;
+    lseek(sfd, 0, SEEK_SET);
+    while ((n = read(sfd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (!write_all(cfd, buf, (size_t)n)) break;
+    }
+    if (ftruncate(sfd, 0) != 0) return;
+    lseek(sfd, 0, SEEK_SET);
+}
+
+int server_run(const char* path, ServeFn fn, void* ctx) {
+    struct sockaddr_un addr;
+    if (!make_addr(path, &addr)) return -1;
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0) return -1;
+    unlink(path);
+    if (bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(lfd, 64) < 0) {
+        close(lfd);
+        return -1;
+    }
+
+    // A client that hangs up early must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    // Responses are spooled to a scratch file and sent in one go: the
+    // handler flushes often (per form), and small socket writes are slow
+    FILE* spool = tmpfile();
+    if (!spool) {
+        close(lfd);
+        unlink(path);
+        return -1;
+    }
+    int sfd = fileno(spool);
+
+    int stop = 0;
+    while (!stop) {
+        int cfd = accept(lfd, NULL, NULL);
+        if (cfd < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        size_t len = 0;
+        char* request = read_all(cfd, &len);
+        if (request) {
+            fflush(stdout);
+            int saved = dup(STDOUT_FILENO);
+            if (saved >= 0 && dup2(sfd, STDOUT_FILENO) >= 0) {
+                stop = fn(request, len, ctx);
+                fflush(stdout);
+                dup2(saved, STDOUT_FILENO);
+                send_spool(sfd, cfd);
+            }
+            if (saved >= 0) close(saved);
+            free(request);
+        }
+        close(cfd);
+    }
+
+    fclose(spool);
+    close(lfd);
+    unlink(path);
+    return stop ? 0 : -1;
+}
+
+int server_request(const char* path, const char* request, size_t len, FILE* out) {
+    struct sockaddr_un addr;
+    if (!make_addr(path, &addr)) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        !write_all(fd, request, len) || shutdown(fd, SHUT_WR) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            close(fd);
+            return -1;
+        }
+        fwrite(buf, 1, (size_t)n, out);
+    }
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#ifndef PURPLE_SERVER_H
+#define PURPLE_SERVER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Unix-socket transport for the compile server
+// A request is everything a client writes before shutting down its write
+// side; whatever the handler prints to stdout while it runs (generated C,
+// interpreter output) is the response.
+
+// Handle one request (NUL-terminated); return nonzero to stop serving
+typedef int (*ServeFn)(const char* request, size_t len, void* ctx);
+
+// Listen on path (replacing a stale socket) and serve requests one at a
+// time until fn asks to stop; 0 on clean shutdown, -1 on socket errors
+int server_run(const char* path, ServeFn fn, void* ctx);
+
+// Send one request to the server at path and copy the response to out
+int server_request(const char* path, const char* request, size_t len, FILE* out);
+
+#endif // PURPLE_SERVER_H
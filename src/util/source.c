@@ -0,0 +1,82 @@
+#define _DEFAULT_SOURCE
+#include "source.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Reserve the file size plus one zero page, then map the file over the
+// front of the reservation. Bytes past EOF in the last file page are zero
+// too, so text[len] is always readable and NUL.
+static int source_map(Source* src, int fd, size_t len) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t file_pages = (len + page - 1) / page * page;
+    size_t map_len = file_pages + page;
+
+    char* base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return 0;
+    if (len > 0 && mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, map_len);
+        return 0;
+    }
+    src->text = base;
+    src->len = len;
+    src->map_len = map_len;
+    return 1;
+}
+
+static int source_read(Source* src, FILE* f) {
+    size_t cap = 4096;
+    size_t len = 0;
+    char* buf = malloc(cap);
+    while (buf) {
+        len += fread(buf + len, 1, cap - len - 1, f);
+        if (len + 1 < cap) break;
+        char* new_buf = cap > (size_t)-1 / 2 ? NULL : realloc(buf, cap * 2);
+        if (!new_buf) { free(buf); return 0; }
+        buf = new_buf;
+        cap *= 2;
+    }
+    if (!buf) return 0;
+    buf[len] = '\0';
+    src->text = buf;
+    src->len = len;
+    src->map_len = 0;
+    return 1;
+}
+
+Source* source_load(const char* path) {
+    if (!path) return NULL;
+    Source* src = malloc(sizeof(Source));
+    if (!src) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(src);
+        return NULL;
+    }
+    struct stat st;
+    int ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && source_map(src, fd, (size_t)st.st_size);
+    if (!ok) {
+        FILE* f = fdopen(fd, "rb");
+        ok = f && source_read(src, f);
+        if (f) fclose(f);
+        else close(fd);
+    } else {
+        close(fd);
+    }
+    if (!ok) {
+        free(src);
+        return NULL;
+    }
+    return src;
+}
+
+void source_free(Source* src) {
+    if (!src) return;
+    if (src->map_len) munmap((void*)src->text, src->map_len);
+    else free((void*)src->text);
+    free(src);
+}
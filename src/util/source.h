@@ -0,0 +1,21 @@
+#ifndef PURPLE_SOURCE_H
+#define PURPLE_SOURCE_H
+
+#include <stddef.h>
+
+// Program source loaded for parsing
+// Regular files are mapped read-only and parsed in place; the mapping is
+// followed by a zero page, so the text is NUL-terminated without a copy.
+// Pipes and other unmappable inputs fall back to a heap buffer.
+
+typedef struct Source {
+    const char* text;   // NUL-terminated
+    size_t len;
+    size_t map_len;     // Bytes reserved by mmap, 0 for a heap buffer
+} Source;
+
+// Load path; NULL on failure
+Source* source_load(const char* path);
+void source_free(Source* src);
+
+#endif // PURPLE_SOURCE_H
@@ -0,0 +1,259 @@
+#include "swissmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define CTRL_EMPTY 0x80
+
+// Hash function for pointers (same mixing as HashMap, on 64 bits)
+static uint64_t hash_ptr(void* ptr) {
+    uint64_t x = (uint64_t)(uintptr_t)ptr;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Low bits pick the slot, the top 7 go in the control byte
+static size_t h1(uint64_t h, size_t mask) { return (size_t)h & mask; }
+static uint8_t h2(uint64_t h) { return (uint8_t)(h >> 57); }
+
+// -- Group Probing --
+// A match mask has MASK_STRIDE bits per control byte, lowest byte first
+
+#if defined(__SSE2__)
+#define MASK_STRIDE 1
+static uint64_t group_match(const uint8_t* g, uint8_t tag) {
+    __m128i v = _mm_loadu_si128((const __m128i*)g);
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)tag)));
+}
+static uint64_t group_empty(const uint8_t* g) {
+    return (uint64_t)(unsigned)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)g));
+}
+#elif defined(__ARM_NEON)
+#define MASK_STRIDE 4
+// Narrow each 0x00/0xFF byte to a nibble of one 64-bit word
+static uint64_t neon_mask(uint8x16_t eq) {
+    uint8x8_t n = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(n), 0) & 0x1111111111111111ull;
+}
+static uint64_t group_match(const uint8_t* g, uint8_t tag) {
+    return neon_mask(vceqq_u8(vld1q_u8(g), vdupq_n_u8(tag)));
+}
+static uint64_t group_empty(const uint8_t* g) {
+    return neon_mask(vceqq_u8(vld1q_u8(g), vdupq_n_u8(CTRL_EMPTY)));
+}
+#else
+#define MASK_STRIDE 1
+static uint64_t group_match(const uint8_t* g, uint8_t tag) {
+    uint64_t m = 0;
+    for (int i = 0; i < SWISSMAP_GROUP; i++) m |= (uint64_t)(g[i] == tag) << i;
+    return m;
+}
+static uint64_t group_empty(const uint8_t* g) {
+    return group_match(g, CTRL_EMPTY);
+}
+#endif
+
+// Offset of the lowest byte in a match mask
+static size_t mask_first(uint64_t m) {
+    return (size_t)__builtin_ctzll(m) / MASK_STRIDE;
+}
+
+static void set_ctrl(SwissMap* map, size_t i, uint8_t c) {
+    map->ctrl[i] = c;
+    // Mirror the first group past the end, so any group load is in bounds
+    if (i < SWISSMAP_GROUP) map->ctrl[map->capacity + i] = c;
+}
+
+// Slot holding key, or -1
+static long find_slot(SwissMap* map, void* key, uint64_t h) {
+    size_t mask = map->capacity - 1;
+    uint8_t tag = h2(h);
+    size_t pos = h1(h, mask);
+    for (;;) {
+        const uint8_t* g = map->ctrl + pos;
+        for (uint64_t m = group_match(g, tag); m; m &= m - 1) {
+            size_t i = (pos + mask_first(m)) & mask;
+            if (map->slots[i].key == key) return (long)i;
+        }
+        if (group_empty(g)) return -1;
+        pos = (pos + SWISSMAP_GROUP) & mask;
+    }
+}
+
+// First empty slot on key's probe sequence
+static size_t find_empty(SwissMap* map, uint64_t h) {
+    size_t mask = map->capacity - 1;
+    size_t pos = h1(h, mask);
+    for (;;) {
+        uint64_t m = group_empty(map->ctrl + pos);
+        if (m) return (pos + mask_first(m)) & mask;
+        pos = (pos + SWISSMAP_GROUP) & mask;
+    }
+}
+
+// Allocate empty tables of capacity slots
+static int alloc_tables(SwissMap* map, size_t capacity) {
+    uint8_t* ctrl = malloc(capacity + SWISSMAP_GROUP);
+    SwissSlot* slots = malloc(capacity * sizeof(SwissSlot));
+    if (!ctrl || !slots) {
+        free(ctrl);
+        free(slots);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, capacity + SWISSMAP_GROUP);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity = capacity;
+    return 1;
+}
+
+// Capacity that holds n entries under the 7/8 load limit
+static size_t capacity_for(size_t n) {
+    size_t cap = SWISSMAP_GROUP;
+    while (cap - cap / 8 < n) {
+        if (cap > SIZE_MAX / 4) return 0;
+        cap *= 2;
+    }
+    return cap;
+}
+
+// Rehash into capacity slots; keeps the old tables on failure
+static int rehash(SwissMap* map, size_t capacity) {
+    uint8_t* old_ctrl = map->ctrl;
+    SwissSlot* old_slots = map->slots;
+    size_t old_cap = map->capacity;
+
+    if (!alloc_tables(map, capacity)) {
+        map->had_alloc_failure = 1;
+        return 0;
+    }
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old_ctrl[i] == CTRL_EMPTY) continue;
+        uint64_t h = hash_ptr(old_slots[i].key);
+        size_t j = find_empty(map, h);
+        set_ctrl(map, j, h2(h));
+        map->slots[j] = old_slots[i];
+    }
+    free(old_ctrl);
+    free(old_slots);
+    return 1;
+}
+
+// Create with default capacity
+SwissMap* swissmap_new(void) {
+    return swissmap_with_capacity(64);
+}
+
+// Create with room for capacity entries
+SwissMap* swissmap_with_capacity(size_t capacity) {
+    SwissMap* map = calloc(1, sizeof(SwissMap));
+    if (!map) return NULL;
+    size_t cap = capacity_for(capacity);
+    if (!cap || !alloc_tables(map, cap)) {
+        free(map);
+        return NULL;
+    }
+    return map;
+}
+
+void swissmap_free(SwissMap* map) {
+    if (!map) return;
+    free(map->ctrl);
+    free(map->slots);
+    free(map);
+}
+
+void* swissmap_get(SwissMap* map, void* key) {
+    if (!map) return NULL;
+    long i = find_slot(map, key, hash_ptr(key));
+    return i < 0 ? NULL : map->slots[i].value;
+}
+
+int swissmap_contains(SwissMap* map, void* key) {
+    return map && find_slot(map, key, hash_ptr(key)) >= 0;
+}
+
+void swissmap_put(SwissMap* map, void* key, void* value) {
+    if (!map) return;
+    uint64_t h = hash_ptr(key);
+    long i = find_slot(map, key, h);
+    if (i >= 0) {
+        map->slots[i].value = value;
+        return;
+    }
+
+    if (map->size + 1 > map->capacity - map->capacity / 8) {
+        size_t cap = map->capacity > SIZE_MAX / 4 ? 0 : map->capacity * 2;
+        if (!cap || !rehash(map, cap)) {
+            map->had_alloc_failure = 1;
+            return;
+        }
+    }
+    size_t j = find_empty(map, h);
+    set_ctrl(map, j, h2(h));
+    map->slots[j].key = key;
+    map->slots[j].value = value;
+    map->size++;
+}
+
+void* swissmap_remove(SwissMap* map, void* key) {
+    if (!map) return NULL;
+    long found = find_slot(map, key, hash_ptr(key));
+    if (found < 0) return NULL;
+
+    size_t mask = map->capacity - 1;
+    size_t i = (size_t)found;
+    void* value = map->slots[i].value;
+
+    // Backward-shift: pull later entries of the run into the hole when
+    // their home is at or before it, so lookups never need tombstones
+    for (size_t j = (i + 1) & mask; map->ctrl[j] != CTRL_EMPTY; j = (j + 1) & mask) {
+        size_t home = h1(hash_ptr(map->slots[j].key), mask);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            set_ctrl(map, i, map->ctrl[j]);
+            map->slots[i] = map->slots[j];
+            i = j;
+        }
+    }
+    set_ctrl(map, i, CTRL_EMPTY);
+    map->size--;
+    return value;
+}
+
+int swissmap_reserve(SwissMap* map, size_t n) {
+    if (!map) return 0;
+    size_t cap = capacity_for(n);
+    if (!cap) {
+        map->had_alloc_failure = 1;
+        return 0;
+    }
+    if (cap <= map->capacity) return 1;
+    return rehash(map, cap);
+}
+
+void swissmap_foreach(SwissMap* map, SwissMapIterFn fn, void* ctx) {
+    if (!map || !fn) return;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->ctrl[i] != CTRL_EMPTY) fn(map->slots[i].key, map->slots[i].value, ctx);
+    }
+}
+
+size_t swissmap_size(SwissMap* map) {
+    return map ? map->size : 0;
+}
+
+void swissmap_clear(SwissMap* map) {
+    if (!map) return;
+    memset(map->ctrl, CTRL_EMPTY, map->capacity + SWISSMAP_GROUP);
+    map->size = 0;
+}
+
+int swissmap_had_alloc_failure(SwissMap* map) {
+    return map ? map->had_alloc_failure : 0;
+}
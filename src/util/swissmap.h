@@ -0,0 +1,51 @@
+#ifndef PURPLE_SWISSMAP_H
+#define PURPLE_SWISSMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Open-addressing pointer-keyed hash map (Swiss-table style)
+// Same operations as HashMap, without an allocation per entry: slots live
+// in one array, and a parallel array of control bytes (empty, or 7 bits of
+// the hash) is probed 16 at a time with SSE2/NEON. Linear probing with
+// backward-shift deletion, so removal leaves no tombstones.
+
+#define SWISSMAP_GROUP 16
+
+typedef struct SwissSlot {
+    void* key;
+    void* value;
+} SwissSlot;
+
+typedef struct SwissMap {
+    uint8_t* ctrl;         // capacity + SWISSMAP_GROUP bytes (tail mirrors the head)
+    SwissSlot* slots;
+    size_t capacity;       // Power of two, at least SWISSMAP_GROUP
+    size_t size;
+    int had_alloc_failure;
+} SwissMap;
+
+// Create/destroy
+SwissMap* swissmap_new(void);
+SwissMap* swissmap_with_capacity(size_t capacity);
+void swissmap_free(SwissMap* map);
+
+// Operations (pointer keys)
+void* swissmap_get(SwissMap* map, void* key);
+void swissmap_put(SwissMap* map, void* key, void* value);
+void* swissmap_remove(SwissMap* map, void* key);
+int swissmap_contains(SwissMap* map, void* key);
+
+// Make room for n entries in total without further growth (0 on OOM)
+int swissmap_reserve(SwissMap* map, size_t n);
+
+// Iteration
+typedef void (*SwissMapIterFn)(void* key, void* value, void* ctx);
+void swissmap_foreach(SwissMap* map, SwissMapIterFn fn, void* ctx);
+
+// Utility
+size_t swissmap_size(SwissMap* map);
+void swissmap_clear(SwissMap* map);  // Keeps the capacity
+int swissmap_had_alloc_failure(SwissMap* map);
+
+#endif // PURPLE_SWISSMAP_H
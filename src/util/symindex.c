@@ -0,0 +1,100 @@
+#include "symindex.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SYMINDEX_MIN_CAPACITY 16
+
+// FNV-1a, then a final mix so the low bits (the slot) depend on every byte
+static uint64_t hash_name(const char* s) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * 0x100000001b3ull;
+    return h ^ (h >> 32);
+}
+
+static int same_name(const SymIndexSlot* slot, const char* name, uint64_t h) {
+    return slot->hash == h && strcmp(slot->name, name) == 0;
+}
+
+// Slot of name, or of the empty slot where it would go
+static size_t probe(const SymIndex* index, const char* name, uint64_t h) {
+    size_t mask = index->capacity - 1;
+    size_t i = (size_t)h & mask;
+    while (index->slots[i].name && !same_name(&index->slots[i], name, h)) i = (i + 1) & mask;
+    return i;
+}
+
+void symindex_init(SymIndex* index) {
+    index->slots = NULL;
+    index->capacity = 0;
+    index->size = 0;
+}
+
+void symindex_destroy(SymIndex* index) {
+    free(index->slots);
+    symindex_init(index);
+}
+
+static int grow(SymIndex* index) {
+    size_t cap = index->capacity ? index->capacity * 2 : SYMINDEX_MIN_CAPACITY;
+    SymIndexSlot* slots = calloc(cap, sizeof(SymIndexSlot));
+    if (!slots) return 0;
+    SymIndexSlot* old = index->slots;
+    size_t old_cap = index->capacity;
+    index->slots = slots;
+    index->capacity = cap;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (!old[i].name) continue;
+        size_t j = (size_t)old[i].hash & (cap - 1);
+        while (slots[j].name) j = (j + 1) & (cap - 1);
+        slots[j] = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+void* symindex_get(SymIndex* index, const char* name) {
+    if (!index || !name || index->size == 0) return NULL;
+    SymIndexSlot* slot = &index->slots[probe(index, name, hash_name(name))];
+    return slot->name ? slot->value : NULL;
+}
+
+int symindex_put(SymIndex* index, const char* name, void* value) {
+    if (!index || !name) return 0;
+    uint64_t h = hash_name(name);
+    SymIndexSlot* slot = index->capacity ? &index->slots[probe(index, name, h)] : NULL;
+    if (!slot || !slot->name) {
+        // New name: load stays at most 3/4
+        if ((index->size + 1) * 4 > index->capacity * 3) {
+            if (!grow(index)) return 0;
+            slot = &index->slots[probe(index, name, h)];
+        }
+        slot->hash = h;
+        index->size++;
+    }
+    slot->name = name;
+    slot->value = value;
+    return 1;
+}
+
+void symindex_remove(SymIndex* index, const char* name) {
+    if (!index || !name || index->size == 0) return;
+    size_t mask = index->capacity - 1;
+    size_t i = probe(index, name, hash_name(name));
+    if (!index->slots[i].name) return;
+
+    // Backward-shift: pull later members of the run into the hole
+    size_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (!index->slots[j].name) break;
+        size_t home = (size_t)index->slots[j].hash & mask;
+        // Move j into i unless its home lies cyclically in (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            index->slots[i] = index->slots[j];
+            i = j;
+        }
+    }
+    index->slots[i].name = NULL;
+    index->slots[i].value = NULL;
+    index->size--;
+}
@@ -0,0 +1,39 @@
+#ifndef PURPLE_SYMINDEX_H
+#define PURPLE_SYMINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Name-keyed index for the analysis contexts
+// Maps a variable name to its innermost binding. Open addressing with
+// linear probing and backward-shift deletion; each slot keeps the full
+// hash, so a probe only runs strcmp on names whose hashes match. Keys
+// are compared by contents, not by symbol pointer, and are not copied:
+// a name must live as long as its entry, which holds for the contexts,
+// since each binding owns the name it is indexed under.
+
+typedef struct SymIndexSlot {
+    const char* name;      // NULL: empty
+    uint64_t hash;
+    void* value;
+} SymIndexSlot;
+
+typedef struct SymIndex {
+    SymIndexSlot* slots;
+    size_t capacity;       // Power of two, or 0 before the first put
+    size_t size;
+} SymIndex;
+
+void symindex_init(SymIndex* index);
+void symindex_destroy(SymIndex* index);
+
+// Binding for name, or NULL
+void* symindex_get(SymIndex* index, const char* name);
+
+// Bind name (replacing any binding); 0 on OOM, leaving the index unchanged
+int symindex_put(SymIndex* index, const char* name, void* value);
+
+// Drop the binding for name, if any
+void symindex_remove(SymIndex* index, const char* name);
+
+#endif // PURPLE_SYMINDEX_H
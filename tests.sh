@@ -25,6 +25,117 @@ run_test() {
     fi
 }
 
+# Runtime section tests: ask for every section, used by the program or not
+run_runtime_test() {
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --full-runtime"
+    run_test "$@"
+    PURPLE="$saved"
+}
+
+# Same, for main()-only output linked against libpurple_rt.a
+run_linked_test() {
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --link-runtime"
+    "$@"
+    PURPLE="$saved"
+}
+
+# Instrumented runtime: counters behind PURPLE_STATS (--stats)
+run_stats_test() {
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --stats"
+    "$@"
+    PURPLE="$saved"
+}
+
+# Eval and emission times on stderr (--time)
+run_timed_test() {
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --time"
+    "$@"
+    PURPLE="$saved"
+}
+
+# Decision report: compiled with --report, the JSON is what is checked
+run_report_test() {
+    local report
+    report=$(mktemp)
+    echo -n "Test: $1 ... "
+    echo "$2" | $PURPLE --report "$report" > /dev/null 2>&1
+    if grep -Fq "$3" "$report"; then
+        echo "PASS"
+    else
+        echo "FAIL"
+        echo "Expected to find:"
+        echo "$3"
+        echo "Actual report:"
+        cat "$report"
+        FAIL=1
+    fi
+    rm -f "$report"
+}
+
+# Profile: compiled with --profile, the folded stacks are what is checked
+run_profile_test() {
+    local profile
+    profile=$(mktemp)
+    echo -n "Test: $1 ... "
+    echo "$2" | $PURPLE --profile "$profile" > /dev/null 2>&1
+    if grep -q "$3" "$profile"; then
+        echo "PASS"
+    else
+        echo "FAIL"
+        echo "Expected a stack matching:"
+        echo "$3"
+        echo "Actual profile:"
+        cat "$profile"
+        FAIL=1
+    fi
+    rm -f "$profile"
+}
+
+# Whole-file mode: input is written to a file and compiled with --file
+run_file_test() {
+    local src
+    src=$(mktemp)
+    printf '%s\n' "$2" > "$src"
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --file $src"
+    run_test "$1" "" "$3"
+    PURPLE="$saved"
+    rm -f "$src"
+}
+
+# Same, compiled by the server on $SERVE_SOCK (see tests 122-124)
+run_served_test() {
+    local saved="$PURPLE"
+    PURPLE="$PURPLE --connect $SERVE_SOCK"
+    "$@"
+    PURPLE="$saved"
+}
+
+# Passes when the output does NOT contain the given text
+run_absent_test() {
+    name="$1"
+    input="$2"
+    unexpected="$3"
+
+    echo -n "Test: $name ... "
+    output=$(echo "$input" | $PURPLE 2>&1)
+
+    if echo "$output" | grep -Fq "$unexpected"; then
+        echo "FAIL"
+        echo "Input:"
+        echo "$input"
+        echo "Expected NOT to find:"
+        echo "$unexpected"
+        FAIL=1
+    else
+        echo "PASS"
+    fi
+}
+
 echo "Running Purple C Scratch Tests..."
 
 # 1. Interpretation
@@ -40,17 +151,18 @@ run_test "Lifting" \
 # 3. Collapsing (Mixed Static/Dynamic)
 run_test "Collapsing" \
     "(+ 10 (lift 20))" \
-    "add(mk_int(10), mk_int(20));"
+    "Obj* result = mk_int(30);"
 
 # 4. Let Binding & CLEAN Strategy
 # With Phase 2 Shape Analysis, we now use shape-based free:
-# (let ((x (lift 10))) (+ x x))
+# (let ((x (+ (car (cons (lift 10) (lift 1))) 1))) (+ x x))
 # Generates:
-# Obj* x = mk_int(10);
-# Obj* res = add(x, x);
-# free_tree(x); // ASAP Clean (shape: TREE)
+# Obj* x = add((mk_pair(mk_int(10), mk_int(1)))->a, mk_int(1));
+# Obj* _res = mk_int((x ? add_l(x->i, x->i) : 0));
+# dec_ref(x); // ASAP Clean (shape: DAG)
+# (A folded constant would go in a stack destination instead, test 138)
 run_test "ASAP CLEAN" \
-    "(let ((x (lift 10))) (+ x x))" \
+    "(let ((x (+ (car (cons (lift 10) (lift 1))) 1))) (+ x x))" \
     "// ASAP Clean (shape:"
 
 # 5. ASAP SCAN Strategy
@@ -68,7 +180,7 @@ run_test "ASAP-ScanNonSymbol" \
 
 # 6. Recursive Structure (List Scanner Generation)
 # The compiler prints the generated scanner at startup
-run_test "Scanner Generation" \
+run_runtime_test "Scanner Generation" \
     "(lift 0)" \
     "void scan_List(Obj* x) {"
 
@@ -82,19 +194,19 @@ run_test "Phase5-DynamicFreeList" \
     "(lift 0)" \
     "typedef struct FreeNode"
 
-# 8. Phase 3: Stack Allocation Pool
-# Check that stack allocation infrastructure is generated
-run_test "Phase3-StackPool" \
+# 8. Phase 3: Stack Allocation
+# Check that per-frame stack destinations are generated
+run_test "Phase3-StackDest" \
     "(lift 0)" \
-    "STACK_POOL_SIZE"
+    "#define STACK_DEST(name)"
 
 # 9. ASAP Scanner (for traversal/debugging, NOT garbage collection)
 # ASAP uses compile-time deallocation, not runtime GC
-run_test "ASAP-Scanner" \
+run_runtime_test "ASAP-Scanner" \
     "(lift 0)" \
     "// Note: ASAP uses compile-time free injection, not runtime GC"
 
-run_test "ASAP-ClearMarks" \
+run_runtime_test "ASAP-ClearMarks" \
     "(lift 0)" \
     "void clear_marks_List(Obj* x)"
 
@@ -106,12 +218,12 @@ run_test "Phase7-MultiLet-Interp" \
 # 11. Phase 7: Multi-binding let (compilation)
 run_test "Phase7-MultiLet-Compile" \
     "(let ((x (lift 10)) (y (lift 20))) (+ x y))" \
-    "Obj* x = mk_int(10)"
+    "Obj* x = write_int(&_d_x, 10)"
 
-# 12. Phase 3: Escape analysis - values passed to functions are marked as escaping
-# When x is used in (+ x x), it escapes via argument, so no stack-candidate annotation
+# 12. Phase 3: Escape analysis - values stored by a callee are marked as escaping
+# When x is stored by (cons x x), it stays on the heap (arithmetic only reads it)
 run_test "Phase3-EscapeArg" \
-    "(let ((x (lift 10))) (+ x x))" \
+    "(let ((x (lift 10))) (car (cons x x)))" \
     "Obj* x = mk_int(10);"
 
 # 13. Phase 4: Capture tracking - lambda captures should not be freed
@@ -139,27 +251,27 @@ run_test "Phase2-DecRef" \
     "void dec_ref(Obj* x)"
 
 # 17. Phase 3: Weak reference support
-run_test "Phase3-WeakRef" \
+run_runtime_test "Phase3-WeakRef" \
     "(lift 0)" \
     "typedef struct WeakRef"
 
 # 18. Phase 3: Weak reference deref function
-run_test "Phase3-DerefWeak" \
+run_runtime_test "Phase3-DerefWeak" \
     "(lift 0)" \
     "void* deref_weak(WeakRef* w)"
 
 # 19. Phase 4: Perceus reuse runtime
-run_test "Phase4-PerceusReuse" \
+run_runtime_test "Phase4-PerceusReuse" \
     "(lift 0)" \
     "Phase 4: Perceus Reuse Analysis Runtime"
 
 # 20. Phase 4: Try reuse function
-run_test "Phase4-TryReuse" \
+run_runtime_test "Phase4-TryReuse" \
     "(lift 0)" \
     "Obj* try_reuse(Obj* old, size_t size)"
 
 # 21. Phase 4: Reuse as int function
-run_test "Phase4-ReuseAsInt" \
+run_runtime_test "Phase4-ReuseAsInt" \
     "(lift 0)" \
     "Obj* reuse_as_int(Obj* old, long value)"
 
@@ -168,22 +280,22 @@ run_test "Phase4-ReuseAsInt" \
 # =============================================================================
 
 # 22. Phase 6b: SCC structure generation
-run_test "Phase6b-SCCStruct" \
+run_runtime_test "Phase6b-SCCStruct" \
     "(lift 0)" \
     "typedef struct SCC"
 
 # 23. Phase 6b: Tarjan's SCC algorithm
-run_test "Phase6b-Tarjan" \
+run_runtime_test "Phase6b-Tarjan" \
     "(lift 0)" \
     "void tarjan_strongconnect"
 
 # 24. Phase 6b: Freeze function
-run_test "Phase6b-FreezeCyclic" \
+run_runtime_test "Phase6b-FreezeCyclic" \
     "(lift 0)" \
     "SCC* freeze_cyclic(Obj* root)"
 
 # 25. Phase 6b: SCC release function
-run_test "Phase6b-ReleaseSCC" \
+run_runtime_test "Phase6b-ReleaseSCC" \
     "(lift 0)" \
     "void release_scc(SCC* scc)"
 
@@ -192,22 +304,22 @@ run_test "Phase6b-ReleaseSCC" \
 # =============================================================================
 
 # 26. Phase 7: Deferred decrement structure
-run_test "Phase7-DeferredDec" \
+run_runtime_test "Phase7-DeferredDec" \
     "(lift 0)" \
     "typedef struct DeferredDec"
 
 # 27. Phase 7: Safe point function
-run_test "Phase7-SafePoint" \
+run_runtime_test "Phase7-SafePoint" \
     "(lift 0)" \
     "void safe_point()"
 
 # 28. Phase 7: Flush all deferred
-run_test "Phase7-FlushDeferred" \
+run_runtime_test "Phase7-FlushDeferred" \
     "(lift 0)" \
     "void flush_all_deferred()"
 
 # 29. Phase 7: Deferred batch processing
-run_test "Phase7-ProcessBatch" \
+run_runtime_test "Phase7-ProcessBatch" \
     "(lift 0)" \
     "process_deferred_batch"
 
@@ -230,32 +342,32 @@ run_test "TypeTag-IsPair" \
 # =============================================================================
 
 # 32. Phase 8: Arena struct
-run_test "Phase8-ArenaStruct" \
+run_runtime_test "Phase8-ArenaStruct" \
     "(lift 0)" \
     "typedef struct Arena"
 
 # 33. Phase 8: Arena create function
-run_test "Phase8-ArenaCreate" \
+run_runtime_test "Phase8-ArenaCreate" \
     "(lift 0)" \
     "Arena* arena_create"
 
 # 34. Phase 8: Arena alloc function
-run_test "Phase8-ArenaAlloc" \
+run_runtime_test "Phase8-ArenaAlloc" \
     "(lift 0)" \
     "void* arena_alloc"
 
 # 35. Phase 8: Arena destroy function
-run_test "Phase8-ArenaDestroy" \
+run_runtime_test "Phase8-ArenaDestroy" \
     "(lift 0)" \
     "void arena_destroy"
 
 # 36. Phase 8: Arena-aware int allocator
-run_test "Phase8-ArenaMkInt" \
+run_runtime_test "Phase8-ArenaMkInt" \
     "(lift 0)" \
     "Obj* arena_mk_int"
 
 # 37. Phase 8: Arena-aware pair allocator
-run_test "Phase8-ArenaMkPair" \
+run_runtime_test "Phase8-ArenaMkPair" \
     "(lift 0)" \
     "Obj* arena_mk_pair"
 
@@ -264,37 +376,37 @@ run_test "Phase8-ArenaMkPair" \
 # =============================================================================
 
 # 38. Phase 9: DPS Dest struct
-run_test "Phase9-DestStruct" \
+run_runtime_test "Phase9-DestStruct" \
     "(lift 0)" \
     "typedef struct Dest"
 
 # 39. Phase 9: Stack destination macro
-run_test "Phase9-StackDest" \
+run_runtime_test "Phase9-StackDest" \
     "(lift 0)" \
     "#define STACK_DEST"
 
 # 40. Phase 9: DPS write_int function
-run_test "Phase9-WriteInt" \
+run_runtime_test "Phase9-WriteInt" \
     "(lift 0)" \
     "Obj* write_int(Dest* dest, long value)"
 
 # 41. Phase 9: DPS write_pair function
-run_test "Phase9-WritePair" \
+run_runtime_test "Phase9-WritePair" \
     "(lift 0)" \
     "Obj* write_pair(Dest* dest, Obj* a, Obj* b)"
 
 # 42. Phase 9: DPS add function
-run_test "Phase9-AddDPS" \
+run_runtime_test "Phase9-AddDPS" \
     "(lift 0)" \
     "Obj* add_dps(Dest* dest"
 
 # 43. Phase 9: DPS map function
-run_test "Phase9-MapDPS" \
+run_runtime_test "Phase9-MapDPS" \
     "(lift 0)" \
     "void map_dps"
 
 # 44. Phase 9: DPS fold function
-run_test "Phase9-FoldDPS" \
+run_runtime_test "Phase9-FoldDPS" \
     "(lift 0)" \
     "Obj* fold_dps"
 
@@ -303,52 +415,52 @@ run_test "Phase9-FoldDPS" \
 # =============================================================================
 
 # 45. Phase 10: Exception type enum
-run_test "Phase10-ExceptionType" \
+run_runtime_test "Phase10-ExceptionType" \
     "(lift 0)" \
     "typedef enum"
 
 # 46. Phase 10: Exception struct
-run_test "Phase10-ExceptionStruct" \
+run_runtime_test "Phase10-ExceptionStruct" \
     "(lift 0)" \
     "typedef struct Exception"
 
 # 47. Phase 10: Exception frame struct
-run_test "Phase10-ExcFrame" \
+run_runtime_test "Phase10-ExcFrame" \
     "(lift 0)" \
     "typedef struct ExcFrame"
 
 # 48. Phase 10: Exception push function
-run_test "Phase10-ExcPush" \
+run_runtime_test "Phase10-ExcPush" \
     "(lift 0)" \
     "ExcFrame* exc_push()"
 
 # 49. Phase 10: Exception pop function
-run_test "Phase10-ExcPop" \
+run_runtime_test "Phase10-ExcPop" \
     "(lift 0)" \
     "void exc_pop()"
 
 # 50. Phase 10: Register cleanup function
-run_test "Phase10-RegisterCleanup" \
+run_runtime_test "Phase10-RegisterCleanup" \
     "(lift 0)" \
     "void exc_register_cleanup"
 
 # 51. Phase 10: Run cleanups (landing pad)
-run_test "Phase10-RunCleanups" \
+run_runtime_test "Phase10-RunCleanups" \
     "(lift 0)" \
     "void exc_run_cleanups()"
 
 # 52. Phase 10: Throw function
-run_test "Phase10-ExcThrow" \
+run_runtime_test "Phase10-ExcThrow" \
     "(lift 0)" \
     "void exc_throw"
 
 # 53. Phase 10: TRY macro
-run_test "Phase10-TryMacro" \
+run_runtime_test "Phase10-TryMacro" \
     "(lift 0)" \
     "#define TRY"
 
 # 54. Phase 10: CATCH macro
-run_test "Phase10-CatchMacro" \
+run_runtime_test "Phase10-CatchMacro" \
     "(lift 0)" \
     "#define CATCH"
 
@@ -357,52 +469,52 @@ run_test "Phase10-CatchMacro" \
 # =============================================================================
 
 # 55. Phase 11: Thread-local storage
-run_test "Phase11-ThreadLocal" \
+run_runtime_test "Phase11-ThreadLocal" \
     "(lift 0)" \
     "__thread int THREAD_ID"
 
 # 56. Phase 11: Concurrent object struct
-run_test "Phase11-ConcObj" \
+run_runtime_test "Phase11-ConcObj" \
     "(lift 0)" \
     "typedef struct ConcObj"
 
 # 57. Phase 11: Atomic increment
-run_test "Phase11-ConcIncRef" \
+run_runtime_test "Phase11-ConcIncRef" \
     "(lift 0)" \
     "void conc_inc_ref"
 
 # 58. Phase 11: Atomic decrement
-run_test "Phase11-ConcDecRef" \
+run_runtime_test "Phase11-ConcDecRef" \
     "(lift 0)" \
     "void conc_dec_ref"
 
 # 59. Phase 11: Message channel struct
-run_test "Phase11-MsgChannel" \
+run_runtime_test "Phase11-MsgChannel" \
     "(lift 0)" \
     "typedef struct MsgChannel"
 
 # 60. Phase 11: Channel create
-run_test "Phase11-ChannelCreate" \
+run_runtime_test "Phase11-ChannelCreate" \
     "(lift 0)" \
     "MsgChannel* channel_create"
 
 # 61. Phase 11: Channel send (ownership transfer)
-run_test "Phase11-ChannelSend" \
+run_runtime_test "Phase11-ChannelSend" \
     "(lift 0)" \
     "int channel_send"
 
 # 62. Phase 11: Channel receive (ownership transfer)
-run_test "Phase11-ChannelRecv" \
+run_runtime_test "Phase11-ChannelRecv" \
     "(lift 0)" \
     "ConcObj* channel_recv"
 
 # 63. Phase 11: Spawn thread helper
-run_test "Phase11-SpawnThread" \
+run_runtime_test "Phase11-SpawnThread" \
     "(lift 0)" \
     "pthread_t spawn_thread"
 
 # 64. Phase 11: Freeze for immutable sharing
-run_test "Phase11-ConcFreeze" \
+run_runtime_test "Phase11-ConcFreeze" \
     "(lift 0)" \
     "void conc_freeze"
 
@@ -505,23 +617,23 @@ run_test "Prim-OrShort" \
     "(or t nil)" \
     "Result: t"
 
-# 84. Overflow protection in generated add function
+# 84. Overflow protection in generated add helper
 run_test "Prim-AddOverflowProtect" \
     "(lift 0)" \
-    "if ((b->i > 0 && a->i > LONG_MAX - b->i)"
+    "if ((b > 0 && a > LONG_MAX - b)"
 
-# 85. Overflow protection in generated sub function
+# 85. Overflow protection in generated sub helper
 run_test "Prim-SubOverflowProtect" \
     "(lift 0)" \
-    "if ((b->i < 0 && a->i > LONG_MAX + b->i)"
+    "if ((b < 0 && a > LONG_MAX + b)"
 
-# 86. Overflow protection in generated mul function
+# 86. Overflow protection in generated mul helper
 run_test "Prim-MulOverflowProtect" \
     "(lift 0)" \
-    "if (a->i > 0 && b->i > 0 && a->i > LONG_MAX / b->i)"
+    "if (a > 0 && b > 0 && a > LONG_MAX / b)"
 
 # 87. Channel create rejects zero capacity (prevents division by zero)
-run_test "Phase11-ChannelZeroCap" \
+run_runtime_test "Phase11-ChannelZeroCap" \
     "(lift 0)" \
     "if (capacity <= 0) return NULL"
 
@@ -570,6 +682,335 @@ run_test "Parser-QuoteAlloc" \
     "(car '(1 2 3))" \
     "Result: 1"
 
+# 96. Lexical addressing: nested closures reach outer frames
+run_test "Lexical-NestedClosure" \
+    "(let ((f ((lambda (a) (lambda (b) (- a b))) 10))) (f 3))" \
+    "Result: 7"
+
+# 97. Lexical addressing: let values see the outer binding, body the inner
+run_test "Lexical-LetShadow" \
+    "((lambda (x) (let ((x 5) (y x)) (+ x y))) 1)" \
+    "Result: 6"
+
+# 98. Lexical addressing: set! writes through to the frame slot
+run_test "Lexical-SetFrame" \
+    "((lambda (x) (do (set! x 9) x)) 1)" \
+    "Result: 9"
+
+# 99. Lexical addressing: let, letrec and lambda frames stack correctly
+run_test "Lexical-MixedFrames" \
+    "((lambda (n) (let ((a 1)) (letrec ((g (lambda (m) (+ (+ m a) n)))) (g 100)))) 10)" \
+    "Result: 111"
+
+# 100. get-meta exposes frames as an assoc list
+run_test "Lexical-GetMetaEnv" \
+    "((lambda (x) (car (car (get-meta 'env)))) 7)" \
+    "Result: x"
+
+# 101. Global table: redefinition updates the existing binding
+run_test "Global-Redefine" \
+    "(do (define y 2) (define y 3) y)" \
+    "Result: 3"
+
+# 102. Global table: set! on a global updates in place
+run_test "Global-SetBang" \
+    "(do (define x 1) (set! x 5) x)" \
+    "Result: 5"
+
+# 103. Proper tail calls: deep tail recursion runs in constant C stack
+run_test "TailCall-DeepLoop" \
+    "(letrec ((loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1)))))) (loop 200000 0))" \
+    "Result: 200000"
+
+# 104. Proper tail calls through do and and/or tail operands
+run_test "TailCall-DoAnd" \
+    "(letrec ((f (lambda (n) (do 0 (and t (if (= n 0) 7 (f (- n 1)))))))) (f 200000))" \
+    "Result: 7"
+
+# 105. Activation records: set-meta! inside a call stays local to it
+run_test "Activation-SetMetaScoped" \
+    "(do ((lambda (x) (set-meta! 'add (lambda (a b) 99))) 1) (+ 1 1))" \
+    "Result: 2"
+
+# 106. Small-int cache boundary and binary primitive fast path
+run_test "SmallInt-Boundary" \
+    "(- (+ 1000 24) 2048)" \
+    "Result: -1024"
+
+# 107. Bytecode VM: deep non-tail recursion runs in heap frames
+run_test "VM-DeepRecursion" \
+    "(letrec ((f (lambda (n) (if (= n 0) 0 (+ 1 (f (- n 1))))))) (f 100000))" \
+    "Result: 100000"
+
+# 108. Bytecode VM: call/cc escapes out of nested VM calls
+run_test "VM-CallCCEscape" \
+    "(letrec ((f (lambda (n) (if (= n 0) (call/cc (lambda (k) (+ 1 (k 7)))) (+ 1 (f (- n 1))))))) (f 50))" \
+    "Result: 57"
+
+# 109. Bytecode VM: control inside a prompt opened by VM code
+run_test "VM-PromptControl" \
+    "((lambda (x) (prompt (+ x (control k 7)))) 5)" \
+    "Result: 7"
+
+# 110. Closure-compiled evaluator: staged program keeps tail calls
+run_test "Eval-StagedTailLoop" \
+    "(do (lift 0) (letrec ((loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1)))))) (loop 100000 0)))" \
+    "Result: 100000"
+
+# 111. Closure-compiled evaluator: local binding shadows a primitive
+run_test "Eval-ShadowPrim" \
+    "(do (lift 0) (let ((f (lambda (x) (* x 2)))) (let ((+ f)) (+ 21))))" \
+    "Result: 42"
+
+# 112. Generated runtime allocates Obj cells from size-class slabs
+run_test "Runtime-SlabAlloc" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "Obj* x = slab_alloc(sizeof(Obj));"
+
+# 113. Generated runtime offers the compact Obj header behind a flag
+run_test "Runtime-CompactObj" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "#ifdef PURPLE_COMPACT_OBJ"
+
+# 114. Feature-usage pass: unused runtime sections are left out
+run_absent_test "Runtime-OnlyUsed" \
+    "(lift 0)" \
+    "typedef struct Arena"
+
+# 115. Feature-usage pass: letrec can reach deferred_release
+run_test "Runtime-DeferredForLetrec" \
+    "(letrec ((f (lambda (x) x))) (f (lift 1)))" \
+    "void deferred_release(Obj* obj)"
+
+# 116. Feature-usage pass: interpreted programs emit no runtime
+run_absent_test "Runtime-NoneWhenInterpreted" \
+    "(+ 1 2)" \
+    "typedef struct Obj"
+
+# 117. Precompiled runtime: linked output includes purple_rt.h
+run_linked_test run_test "Runtime-LinkIncludesHeader" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "#include \"purple_rt.h\""
+
+# 118. Precompiled runtime: linked output carries no runtime definitions
+run_linked_test run_absent_test "Runtime-LinkOmitsRuntime" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "typedef struct Obj"
+
+# 119. Precompiled runtime: the header declares the core API
+PURPLE_SAVED="$PURPLE"
+PURPLE="$PURPLE --emit-runtime-header"
+run_test "Runtime-HeaderDecls" "" "Obj* mk_pair(Obj* a, Obj* b);"
+PURPLE="$PURPLE_SAVED"
+
+# 120. Whole-file mode: later forms see earlier defines
+run_file_test "File-SharedDefine" \
+    "(define sq (lambda (x) (* x x)))
+(+ (lift (sq 3)) (lift 1))" \
+    "Obj* result = mk_int(10);"
+
+# 121. Whole-file mode: every compiled form lands in the same main()
+run_file_test "File-AllForms" \
+    "; two staged forms
+(lift 1)
+(lift 2)" \
+    "// Expression: (lift 2)"
+
+# Compile server: one warm process serves the next three tests
+SERVE_SOCK=$(mktemp -u)
+$PURPLE --serve "$SERVE_SOCK" &
+SERVE_PID=$!
+for _ in $(seq 50); do [ -S "$SERVE_SOCK" ] && break; sleep 0.1; done
+
+# 122. Compile server: a response is exactly the direct compiler's output
+echo -n "Test: Server-MatchesDirect ... "
+direct=$(echo "(let ((x (lift 10))) (+ x (lift 5)))" | $PURPLE 2>&1)
+served=$(echo "(let ((x (lift 10))) (+ x (lift 5)))" | $PURPLE --connect "$SERVE_SOCK" 2>&1)
+if [ -n "$direct" ] && [ "$direct" == "$served" ]; then
+    echo "PASS"
+else
+    echo "FAIL"
+    diff <(echo "$direct") <(echo "$served")
+    FAIL=1
+fi
+
+# 123. Compile server: a define does not outlive its request
+run_served_test run_test "Server-DefineScoped" "(define k 7)" "// Result: k"
+run_served_test run_test "Server-NoLeak" "k" "Error: Unbound k"
+
+# 124. Compile server: whole-file requests
+run_served_test run_file_test "Server-File" \
+    "(define sq (lambda (x) (* x x)))
+(+ (lift (sq 3)) (lift 1))" \
+    "Obj* result = mk_int(10);"
+
+$PURPLE --connect "$SERVE_SOCK" --shutdown
+wait $SERVE_PID
+
+# 125. Phase 6b: Tarjan indexes nodes by open addressing, no per-node malloc
+run_runtime_test "Phase6b-TarjanOpenAddressing" \
+    "(lift 0)" \
+    "static TarjanSlot* TARJAN_SLOTS"
+
+# 126. Phase 6b: freezing stops at components frozen by earlier calls
+run_runtime_test "Phase6b-IncrementalFreeze" \
+    "(lift 0)" \
+    "static SCC* frozen_scc_of(Obj* obj)"
+
+# 127. Phase 6b: large graphs freeze on worker threads
+run_runtime_test "Phase6b-ParallelFreeze" \
+    "(lift 0)" \
+    "void scc_set_workers(int n)"
+
+# 128. Phase 7: deferred decrements queue in a ring, indexed by open addressing
+run_runtime_test "Phase7-DeferredRing" \
+    "(lift 0)" \
+    "static DeferredDec* DEFERRED_RING"
+
+# 129. Phase 7: safe points size their batch from a pause budget
+run_runtime_test "Phase7-AdaptiveBatch" \
+    "(lift 0)" \
+    "void deferred_set_pause_budget(long ns)"
+
+# 130. Phase 11: last conc_dec_ref queues the object on a thread-local list
+run_runtime_test "Phase11-ConcDeferredFree" \
+    "(lift 0)" \
+    "void conc_safe_point(void)"
+
+# 131. Phase A4: a blocked sender parks until the receiver takes its value
+run_test "A4-ChannelHandoff" \
+    "(let ((c (make-chan))) (let ((p (go (chan-send! c (* 6 7))))) (chan-recv! c)))" \
+    "Result: 42"
+
+# 132. Phase 11: lock-free channels, with a single-producer fast path
+run_runtime_test "Phase11-LockFreeChannel" \
+    "(lift 0)" \
+    "MsgChannel* channel_create_spsc(int capacity)"
+
+# 133. Phase A4: batch channel ops move a list per call
+run_test "A4-ChannelBatch" \
+    "(let ((c (make-chan 4))) (let ((n (chan-send-many! c '(1 2 3)))) (chan-recv-many! c 8)))" \
+    "Result: (1 2 3)"
+
+# 134. FBIP: a let body rebuilding its own fresh cell writes into it
+run_test "FBIP-InPlaceReuse" \
+    "(let ((x (cons (lift 1) (lift 2)))) (cons (+ (car x) 1) (cdr x)))" \
+    "Obj* _fa = mk_int(((x)->a ? add_l((x)->a->i, 1) : 0)); dec_ref((x)->a); (x)->a = _fa; x;"
+
+# 135. Phase 9: a let-bound cell that dies with the block is written into a stack destination
+run_test "Phase9-StackDestination" \
+    "(let ((x (cons (lift 1) (lift 2)))) (+ (car x) (cdr x)))" \
+    "Obj* x = write_pair(&_d_x, mk_int(1), mk_int(2));"
+
+# 136. Phase 9: an inlined call returning a fresh cell writes into the caller's destination
+run_test "Phase9-CallerOwnedDest" \
+    "(let ((f (lambda (a) (cons a (lift 1))))) (let ((p (f (lift 2)))) (+ (car p) (cdr p))))" \
+    "// DPS: p (caller-owned)"
+
+# 137. Phase 9: a cell stored into another one stays on the heap
+run_absent_test "Phase9-StoredCellOnHeap" \
+    "(let ((x (cons (lift 1) (lift 2)))) (let ((y (cons x (lift 1)))) (car (car y))))" \
+    "STACK_DEST(_d_x)"
+
+# 138. Phase 3: a non-escaping lifted integer is a local of its block
+run_test "Phase3-StackInt" \
+    "(let ((n (lift 5))) (let ((m (lift 7))) (+ n m)))" \
+    "Obj* m = write_int(&_d_m, 7);"
+
+# 139. Phase 3: RC never sees stack cells, so frees carry no range check
+run_absent_test "Phase3-NoStackCheck" \
+    "(lift 0)" \
+    "is_stack_obj"
+
+# 140. deftype: accessors and setters go by field slot in the interpreter
+run_test "Deftype-SlotAccess" \
+    "(do (deftype Point (x int) (y int)) (let ((p (mk-Point 1 2))) (do (set-Point-x! p 5) (+ (Point-x p) (Point-y p)))))" \
+    "Result: 7"
+
+# 141. deftype: a lifted record is a pair chain read at constant paths
+run_test "Deftype-ConstantPath" \
+    "(do (deftype P3 (a int) (b int) (c int)) (let ((p (mk-P3 (lift 1) 2 3))) (+ (P3-b p) (P3-c p))))" \
+    "add_l((p)->b->a->i, (p)->b->b->i)"
+
+# 142. Partial evaluation: a lifted chain over known values folds away
+run_test "Fold-LiftedConstants" \
+    "(let ((x (lift 10))) (if (< (* x 0) 1) (+ (lift 2) 3) (lift 0)))" \
+    "Obj* _res = mk_int(5);"
+
+# 143. Partial evaluation: an int chain is one unboxed expression, boxed once
+run_test "Fold-UnboxedChain" \
+    "(let ((p (cons (lift 3) (lift 4)))) (* (+ (car p) 1) (cdr p)))" \
+    "mk_int(((p)->b ? mul_l(((p)->a ? add_l((p)->a->i, 1) : 0), (p)->b->i) : 0))"
+
+# 144. Code ropes: nested code shares its parts and reads back in order
+run_test "Rope-NestedCode" \
+    "(let ((x (car (cons (lift 10) (lift 1))))) (if x (cons x (if x x (lift 0))) x))" \
+    "Obj* _res = ({ Obj* _cond = x; Obj* _r = (_cond && _cond->i) ? (mk_pair(x, ({ Obj* _cond = x; Obj* _r = (_cond && _cond->i) ? (x) : (mk_int(0)); _r; }))) : (x); _r; });"
+
+# 145. Escape-only call/cc: early exit from a loop is a plain return
+run_test "CallCC-EscapeOnly" \
+    "(letrec ((f (lambda (n acc) (if (= n 0) acc (f (- n 1) (+ acc (call/cc (lambda (k) (letrec ((loop (lambda (i) (if (= i n) (k i) (loop (+ i 1)))))) (loop 0)))))))))) (f 100 0))" \
+    "Result: 5050"
+
+# 146. call/cc: an outer continuation escapes from inside a nested one
+run_test "CallCC-OuterEscape" \
+    "(call/cc (lambda (k) (+ 1 (call/cc (lambda (j) (+ 1 (k 42)))))))" \
+    "Result: 42"
+
+# 147. Serial processes: 20000 pipeline stages parked at once, on pooled stacks
+run_test "Go-ManyParked" \
+    "(let ((head (make-chan))) (letrec ((stage (lambda (in) (let ((out (make-chan))) (do (go (chan-send! out (+ 1 (chan-recv! in)))) out)))) (build (lambda (n in) (if (= n 0) in (build (- n 1) (stage in)))))) (let ((tail (build 20000 head))) (do (chan-send! head 0) (chan-recv! tail)))))" \
+    "Result: 20000"
+
+# 148. --stats: the program turns on the runtime's counters and JSON dump
+run_stats_test run_test "Stats-Instrumented" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "#define PURPLE_STATS 1"
+
+# 149. --report: each binding's analyses and free strategy, at its source position
+run_report_test "Report-Decisions" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    '{"name": "x", "line": 1, "col": 7, "shape": "TREE", "escape": "arg", "rc": "none", "alloc": "destination", "dps": "stack", "freeze_point": false, "free": null, "reason": "lives in its destination"}'
+
+# 150. --time: evaluation and emission timed apart, output unchanged
+run_timed_test run_test "Time-Phases" \
+    "(let ((x (lift 10))) (+ x (lift 5)))" \
+    "Time: eval "
+
+# 151. --profile: timer samples as folded stacks of Purple frames
+run_profile_test "Profile-Folded" \
+    "(letrec ((f (lambda (n) (if (< n 2) n (+ (f (- n 1)) (f (- n 2))))))) (f 27))" \
+    "^toplevel@1:1;f;f.* [0-9][0-9]*$"
+
+# 152. Whole-file mode: independent forms evaluated side by side give the
+# same program as one at a time
+echo -n "Test: File-ParallelMatchesSerial ... "
+PAR_SRC=$(mktemp)
+printf '%s\n' "(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))" \
+    "(fib 18)" "(fib 10)" "(car (cons (fib 12) 0))" "(define z 2)" "(fib 3)" "(+ z (fib 5))" "(fib 4)" > "$PAR_SRC"
+serial=$(PURPLE_GO_WORKERS=1 $PURPLE --file "$PAR_SRC" 2>&1)
+parallel=$(PURPLE_GO_WORKERS=4 $PURPLE --file "$PAR_SRC" 2>&1)
+if [ -n "$serial" ] && [ "$serial" == "$parallel" ] && echo "$serial" | grep -Fq "// Result: 2584"; then
+    echo "PASS"
+else
+    echo "FAIL"
+    diff <(echo "$serial") <(echo "$parallel")
+    FAIL=1
+fi
+rm -f "$PAR_SRC"
+
+# 153. Phase 11: concurrent objects count their owner's references apart
+run_runtime_test "Phase11-BiasedRC" \
+    "(lift 0)" \
+    "static int conc_merge(ConcObj* obj, int queued)"
+
+# 154. Vectors: bulk operations, staged into one loop over unboxed longs
+run_test "Vector-Dot" "(vector-dot (vector 1 2 3) (vector 4 5 6))" "Result: 32"
+run_test "Vector-StagedFold" \
+    "(vector-fold (lambda (a x) (+ a (* x x))) 0 (vector-map (lambda (x) (+ x 1)) (lift (vector 1 2 3))))" \
+    "_a1 = add_l(_a1, mul_l(_x1, _x1));"
+run_runtime_test "Vector-SIMDAdd" "(lift 0)" "_mm256_add_epi64"
+
 if [ $FAIL -eq 0 ]; then
     echo "All tests passed!"
     exit 0
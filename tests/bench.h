@@ -0,0 +1,91 @@
+// Microbenchmark harness
+// A benchmark runs `ops` operations of one kind per repetition. It is run
+// BENCH_WARMUP times untimed, then BENCH_REPS times timed (environment,
+// default 3 and 21), with its setup and teardown outside the clock. Each
+// line gives the median and p99 time per operation over the repetitions,
+// the throughput at the median and the process's peak RSS so far.
+// Arguments pick benchmarks by substring of their names.
+#ifndef PURPLE_BENCH_H
+#define PURPLE_BENCH_H
+
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+typedef struct BenchCase {
+    const char* name;
+    long ops;                 // Operations per repetition
+    void (*setup)(void);      // Before each repetition (or NULL)
+    void (*run)(long ops);
+    void (*teardown)(void);   // After each repetition (or NULL)
+} BenchCase;
+
+// Keeps a result alive without a volatile store per operation
+static volatile long bench_sink;
+
+static double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static int bench_env(const char* name, int fallback, int min) {
+    const char* s = getenv(name);
+    int n = s ? atoi(s) : min - 1;
+    return n >= min ? n : fallback;
+}
+
+static int bench_cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int bench_selected(const char* name, int argc, char** argv) {
+    if (argc < 2) return 1;
+    for (int i = 1; i < argc; i++) {
+        if (strstr(name, argv[i])) return 1;
+    }
+    return 0;
+}
+
+static void bench_one(const BenchCase* b, int warmup, int reps) {
+    double* times = malloc((size_t)reps * sizeof(double));
+    if (!times) return;
+    for (int i = 0; i < warmup + reps; i++) {
+        if (b->setup) b->setup();
+        double start = bench_now_ns();
+        b->run(b->ops);
+        double elapsed = bench_now_ns() - start;
+        if (b->teardown) b->teardown();
+        if (i >= warmup) times[i - warmup] = elapsed / (double)b->ops;
+    }
+    qsort(times, (size_t)reps, sizeof(double), bench_cmp_double);
+    double median = reps % 2 ? times[reps / 2] : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+    int p99 = (reps * 99 + 99) / 100 - 1;  // Nearest rank
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    printf("%-28s %10ld %12.1f %12.1f %12.2f %10ld\n", b->name, b->ops,
+           median, times[p99], median > 0 ? 1e3 / median : 0.0, ru.ru_maxrss);
+    fflush(stdout);
+    free(times);
+}
+
+// Run the selected cases; 0 if none matched
+static int bench_main(const BenchCase* cases, size_t count, int argc, char** argv) {
+    int warmup = bench_env("BENCH_WARMUP", 3, 0);
+    int reps = bench_env("BENCH_REPS", 21, 1);
+    printf("%-28s %10s %12s %12s %12s %10s\n", "benchmark", "ops/rep",
+           "median ns/op", "p99 ns/op", "Mops/s", "peak KB");
+    int ran = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!bench_selected(cases[i].name, argc, argv)) continue;
+        bench_one(&cases[i], warmup, reps);
+        ran++;
+    }
+    return ran;
+}
+
+#endif // PURPLE_BENCH_H
@@ -0,0 +1,215 @@
+// Microbenchmarks for the memory strategies (make bench)
+#include "bench.h"
+#include "../src/memory/scc.h"
+#include "../src/memory/deferred.h"
+#include "../src/memory/arena.h"
+#include "../src/memory/genref.h"
+#include "../src/memory/region.h"
+#include "../src/memory/symmetric.h"
+#include "../src/util/hashmap.h"
+
+static unsigned long rng_state = 88172645463325252UL;
+
+static unsigned long rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// -- SCC: Tarjan over a random graph --
+
+#define SCC_NODES (1 << 16)
+
+static Obj* scc_graph = NULL;
+static SCCRegistry* scc_reg = NULL;
+
+// Pairs whose fields point anywhere: one giant SCC plus stragglers
+static void scc_setup(void) {
+    if (!scc_graph) {
+        scc_graph = calloc(SCC_NODES, sizeof(Obj));
+        if (!scc_graph) abort();
+        for (int i = 0; i < SCC_NODES; i++) {
+            scc_graph[i].mark = 1;
+            scc_graph[i].scc_id = -1;
+            scc_graph[i].is_pair = 1;
+            scc_graph[i].a = &scc_graph[rng() % SCC_NODES];
+            scc_graph[i].b = &scc_graph[rng() % SCC_NODES];
+        }
+    }
+    scc_reg = mk_scc_registry();
+}
+
+static void scc_run(long ops) {
+    (void)ops;
+    bench_sink = (long)compute_sccs(scc_reg, &scc_graph[0]);
+}
+
+static void scc_teardown(void) {
+    free_scc_registry(scc_reg);
+    for (int i = 0; i < SCC_NODES; i++) scc_graph[i].scc_id = -1;
+}
+
+// -- Deferred RC: defer, then drain in batches --
+
+#define DEFER_OBJS 4096
+
+static DeferredContext* deferred = NULL;
+static long defer_objs[DEFER_OBJS];
+
+static void deferred_setup(void) {
+    deferred = mk_deferred_context(256);
+}
+
+static void deferred_run(long ops) {
+    for (long i = 0; i < ops; i++) defer_decrement(deferred, &defer_objs[i % DEFER_OBJS]);
+    while (deferred->pending_count > 0) process_deferred(deferred, 256);
+}
+
+static void deferred_teardown(void) {
+    free_deferred_context(deferred);
+}
+
+// -- Arena against malloc: allocate, then release everything --
+
+#define ALLOC_SIZE 32
+
+static Arena* arena = NULL;
+static void** allocs = NULL;
+
+static void arena_setup(void) {
+    if (!arena) arena = arena_create(0);
+}
+
+static void arena_run(long ops) {
+    for (long i = 0; i < ops; i++) bench_sink = (long)arena_alloc(arena, ALLOC_SIZE);
+    arena_reset(arena);
+}
+
+static void malloc_setup(void) {
+    if (!allocs) allocs = malloc(1000000 * sizeof(void*));
+    if (!allocs) abort();
+}
+
+static void malloc_run(long ops) {
+    for (long i = 0; i < ops; i++) allocs[i] = malloc(ALLOC_SIZE);
+    for (long i = 0; i < ops; i++) free(allocs[i]);
+}
+
+// -- HashMap: pointer keys --
+
+#define MAP_KEYS (1 << 16)
+
+static HashMap* map = NULL;
+static long map_keys[MAP_KEYS];
+
+static void map_put_setup(void) {
+    map = hashmap_new();
+}
+
+static void map_put_run(long ops) {
+    for (long i = 0; i < ops; i++) hashmap_put(map, &map_keys[i % MAP_KEYS], &map_keys[i % MAP_KEYS]);
+}
+
+static void map_teardown(void) {
+    hashmap_free(map);
+}
+
+static void map_get_setup(void) {
+    map = hashmap_new();
+    for (long i = 0; i < MAP_KEYS; i++) hashmap_put(map, &map_keys[i], &map_keys[i]);
+}
+
+static void map_get_run(long ops) {
+    long hits = 0;
+    for (long i = 0; i < ops; i++) hits += hashmap_get(map, &map_keys[(i * 40503) % MAP_KEYS]) != NULL;
+    bench_sink = hits;
+}
+
+// -- Generational references: checked dereference --
+
+#define GENREF_REFS 1024
+
+static GenRefContext* genctx = NULL;
+static GenRef* genrefs[GENREF_REFS];
+
+static void genref_setup(void) {
+    if (genctx) return;
+    genctx = genref_context_new();
+    for (int i = 0; i < GENREF_REFS; i++) {
+        GenObj* obj = genref_alloc(genctx, &map_keys[i], NULL);
+        genrefs[i] = genref_create_ref(obj, "bench");
+    }
+}
+
+static void genref_run(long ops) {
+    long sum = 0;
+    GenRefError err;
+    for (long i = 0; i < ops; i++) sum += (long)genref_deref(genrefs[i % GENREF_REFS], &err);
+    bench_sink = sum;
+}
+
+// -- Regions: enter, allocate, exit --
+
+#define REGION_OBJS 64
+
+static RegionContext* regions = NULL;
+
+static void region_setup(void) {
+    if (!regions) regions = region_context_new();
+}
+
+// Objects outlive their regions until the context goes: a fresh one a rep
+static void region_teardown(void) {
+    region_context_free(regions);
+    regions = NULL;
+}
+
+static void region_run(long ops) {
+    for (long done = 0; done < ops; done += REGION_OBJS) {
+        region_enter(regions);
+        for (int i = 0; i < REGION_OBJS; i++) bench_sink = (long)region_alloc(regions, NULL, NULL);
+        region_exit(regions);
+    }
+}
+
+// -- Symmetric RC: release a scope's objects --
+
+#define SYM_OBJS 100000
+
+static SymScope* sym_scope = NULL;
+
+static void sym_setup(void) {
+    sym_scope = sym_scope_new(NULL);
+    for (int i = 0; i < SYM_OBJS; i++) sym_scope_own(sym_scope, sym_obj_new(NULL, NULL));
+}
+
+static void sym_run(long ops) {
+    (void)ops;
+    sym_scope_release(sym_scope);
+}
+
+static void sym_teardown(void) {
+    sym_scope_free(sym_scope);
+}
+
+static const BenchCase cases[] = {
+    { "scc_compute_random_graph", SCC_NODES, scc_setup, scc_run, scc_teardown },
+    { "deferred_defer_process", 1000000, deferred_setup, deferred_run, deferred_teardown },
+    { "arena_alloc_32", 1000000, arena_setup, arena_run, NULL },
+    { "malloc_free_32", 1000000, malloc_setup, malloc_run, NULL },
+    { "hashmap_put", 1000000, map_put_setup, map_put_run, map_teardown },
+    { "hashmap_get", 1000000, map_get_setup, map_get_run, map_teardown },
+    { "genref_deref", 10000000, genref_setup, genref_run, NULL },
+    { "region_alloc_exit", 1000000, region_setup, region_run, region_teardown },
+    { "sym_scope_release", SYM_OBJS, sym_setup, sym_run, sym_teardown },
+};
+
+int main(int argc, char** argv) {
+    size_t count = sizeof(cases) / sizeof(cases[0]);
+    if (!bench_main(cases, count, argc, argv)) {
+        fprintf(stderr, "No benchmark matches\n");
+        return 1;
+    }
+    return 0;
+}
@@ -204,6 +204,30 @@ void test_arena_external_cleanup(void) {
     PASS();
 }
 
+// Test merging one arena into another
+void test_arena_merge(void) {
+    TEST(arena_merge);
+
+    Arena* into = arena_create(256);
+    Arena* from = arena_create(256);
+    if (!into || !from) { FAIL("arena_create returned NULL"); return; }
+
+    external_cleanup_count = 0;
+    long* kept = arena_alloc(from, sizeof(long));
+    *kept = 42;
+    arena_register_external(from, malloc(16), test_cleanup_fn);
+    arena_alloc(into, 8);
+
+    // from's memory and externals now belong to into
+    arena_merge(into, from);
+    if (*kept != 42) { FAIL("merged memory changed"); arena_destroy(into); return; }
+    if (external_cleanup_count != 0) { FAIL("merge ran cleanups"); arena_destroy(into); return; }
+    arena_destroy(into);
+    if (external_cleanup_count != 1) { FAIL("merged external not released with into"); return; }
+
+    PASS();
+}
+
 // Test release_externals separately
 void test_arena_release_externals(void) {
     TEST(arena_release_externals);
@@ -325,6 +349,94 @@ void test_arena_stress(void) {
     PASS();
 }
 
+// Test that destroyed arenas hand their blocks to the next arena
+void test_arena_block_pool(void) {
+    TEST(arena_block_pool);
+
+    arena_pool_trim();
+    if (arena_pool_blocks() != 0) { FAIL("pool not empty after trim"); return; }
+
+    Arena* a = arena_create(4096);
+    if (!a) { FAIL("arena_create returned NULL"); return; }
+    char* first = arena_alloc(a, 64);
+    if (!first) { FAIL("alloc failed"); arena_destroy(a); return; }
+    arena_destroy(a);
+    if (arena_pool_blocks() != 1) { FAIL("block not pooled"); return; }
+
+    // Same size class: the pooled block comes back
+    Arena* b = arena_create(3000);
+    if (!b) { FAIL("arena_create returned NULL"); return; }
+    char* again = arena_alloc(b, 64);
+    if (again != first) { FAIL("pooled block not reused"); arena_destroy(b); return; }
+    if (b->current->size != 4096) { FAIL("block not rounded to its class"); arena_destroy(b); return; }
+    if (arena_pool_blocks() != 0) { FAIL("pool count not decremented"); arena_destroy(b); return; }
+    arena_destroy(b);
+
+    // The pool is bounded per class
+    Arena* many[4000];
+    for (int i = 0; i < 4000; i++) {
+        many[i] = arena_create(4096);
+        if (!many[i] || !arena_alloc(many[i], 8)) { FAIL("alloc failed"); return; }
+    }
+    for (int i = 0; i < 4000; i++) arena_destroy(many[i]);
+    if (arena_pool_blocks() >= 4000) { FAIL("pool unbounded"); return; }
+
+    arena_pool_trim();
+    if (arena_pool_blocks() != 0) { FAIL("trim left blocks"); return; }
+
+    PASS();
+}
+
+// Test that blocks past the largest class are mapped and not pooled
+void test_arena_mapped_block(void) {
+    TEST(arena_mapped_block);
+
+    arena_pool_trim();
+    Arena* a = arena_create(0);
+    if (!a) { FAIL("arena_create returned NULL"); return; }
+    size_t big = (size_t)3 << 20;
+    char* p = arena_alloc(a, big);
+    if (!p) { FAIL("large alloc failed"); arena_destroy(a); return; }
+    if (!a->current->mapped || a->current->size < big) { FAIL("block not mapped"); arena_destroy(a); return; }
+    memset(p, 1, big);
+
+    // Reset keeps the mapping; small allocations then use it
+    ArenaBlock* mapped = a->current;
+    arena_reset(a);
+    arena_alloc(a, 16);
+    if (a->blocks != mapped || a->current != mapped) { FAIL("reset dropped the block"); arena_destroy(a); return; }
+
+    arena_destroy(a);
+    if (arena_pool_blocks() != 0) { FAIL("mapped block pooled"); return; }
+
+    PASS();
+}
+
+// Test that blocks emptied by a reset are all reused before new ones
+void test_arena_reset_reuses_blocks(void) {
+    TEST(arena_reset_reuses_blocks);
+
+    Arena* a = arena_create(1024);
+    if (!a) { FAIL("arena_create returned NULL"); return; }
+    for (int i = 0; i < 64; i++) arena_alloc(a, 512);
+    int before = 0;
+    for (ArenaBlock* b = a->blocks; b; b = b->next) before++;
+
+    for (int round = 0; round < 3; round++) {
+        arena_reset(a);
+        // One oversized request in the middle must not strand the rest
+        for (int i = 0; i < 32; i++) arena_alloc(a, 512);
+        arena_alloc(a, 4096);
+        for (int i = 0; i < 32; i++) arena_alloc(a, 512);
+    }
+    int after = 0;
+    for (ArenaBlock* b = a->blocks; b; b = b->next) after++;
+    if (after > before + 3) { FAIL("reset blocks not reused"); arena_destroy(a); return; }
+
+    arena_destroy(a);
+    PASS();
+}
+
 int main(void) {
     printf("Running Arena Unit Tests...\n\n");
 
@@ -336,10 +448,14 @@ int main(void) {
     test_arena_reset();
     test_arena_external_cleanup();
     test_arena_release_externals();
+    test_arena_merge();
     test_arena_null_inputs();
     test_should_use_arena();
     test_find_arena_scopes();
     test_arena_stress();
+    test_arena_block_pool();
+    test_arena_mapped_block();
+    test_arena_reset_reuses_blocks();
 
     printf("\n========================================\n");
     printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
@@ -0,0 +1,102 @@
+// Unit tests for staged code ropes - CodeBuilder and flattening
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/util/dstring.h"
+#include "../src/codegen/codegen.h"
+#include "../src/eval/eval.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static void test_builder(void) {
+    TEST(builder);
+
+    Value* x = mk_code("x");
+    CodeBuilder cb;
+    cb_init(&cb);
+    cb_text(&cb, "mk_");
+    cb_textf(&cb, "pair(%s, ", "a");
+    cb_code(&cb, x);
+    cb_text(&cb, "");
+    cb_text(&cb, ")");
+    Value* code = cb_finish(&cb);
+    if (!code || code->s || code_len(code) != strlen("mk_pair(a, x)")) { FAIL("rope not built"); return; }
+    if (!code_starts_with(code, "mk_pair(") || code_starts_with(code, "mk_pair(b")) { FAIL("prefix across parts"); return; }
+
+    // Flattened once, then the same text
+    const char* text = code_text(code);
+    if (!text || strcmp(text, "mk_pair(a, x)") != 0) { FAIL("wrong text"); return; }
+    if (code_text(code) != text) { FAIL("text not kept"); return; }
+
+    // A single part is that code; nothing is empty text
+    cb_init(&cb);
+    cb_code(&cb, x);
+    if (cb_finish(&cb) != x) { FAIL("single part copied"); return; }
+    cb_init(&cb);
+    Value* empty = cb_finish(&cb);
+    if (!empty || code_len(empty) != 0 || strcmp(code_text(empty), "") != 0) { FAIL("empty builder"); return; }
+
+    PASS();
+}
+
+static void test_sharing(void) {
+    TEST(sharing);
+
+    // Operands are shared: flattening the outer call leaves the inner as is
+    Value* inner = emit_c_call("mk_pair", mk_code("a"), mk_code("b"));
+    Value* outer = emit_c_call("mk_pair", inner, inner);
+    DString* ds = ds_from("r = ");
+    code_write(ds, outer);
+    int ok = strcmp(ds_cstr(ds), "r = mk_pair(mk_pair(a, b), mk_pair(a, b))") == 0;
+    ds_free(ds);
+    if (!ok) { FAIL("code_write"); return; }
+    if (!inner->parts || inner->s) { FAIL("operand flattened"); return; }
+    char* s = val_to_str(outer);
+    ok = s && strcmp(s, "mk_pair(mk_pair(a, b), mk_pair(a, b))") == 0;
+    free(s);
+    if (!ok) { FAIL("val_to_str"); return; }
+
+    PASS();
+}
+
+static void test_deep_nesting(void) {
+    TEST(deep_nesting);
+
+    // Far deeper than a recursive walk of the rope could go
+    enum { DEPTH = 200000 };
+    Value* code = mk_code("x");
+    for (int i = 0; i < DEPTH; i++) code = emit_c_call("mk_pair", code, NIL);
+    size_t expected = 1 + (size_t)DEPTH * strlen("mk_pair(, NULL)");
+    if (code_len(code) != expected) { FAIL("wrong length"); return; }
+    const char* text = code_text(code);
+    if (!text || strlen(text) != expected) { FAIL("wrong text length"); return; }
+    size_t mid = (size_t)DEPTH * strlen("mk_pair(");
+    if (strncmp(text, "mk_pair(mk_pair(", 16) != 0 || strncmp(text + mid, "x, NULL), NULL)", 15) != 0) {
+        FAIL("wrong text");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Code Rope Unit Tests...\n");
+    init_syms();
+
+    test_builder();
+    test_sharing();
+    test_deep_nesting();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,218 @@
+// Unit tests for the concurrent runtime's biased reference counts
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/memory/concurrent.h"
+#include "../src/util/emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static const char* scenario = NULL;
+
+// The runtime with every allocation counted, then `scenario` as main
+static void gen_program(void) {
+    emit("#include <stdio.h>\n");
+    emit("#include <stdlib.h>\n");
+    emit("#include <limits.h>\n");
+    emit("#include <stdint.h>\n");
+    emit("#include <stdatomic.h>\n");
+    emit("static _Atomic long live = 0;\n");
+    emit("static void* counted_malloc(size_t n) { void* p = malloc(n); if (p) live++; return p; }\n");
+    emit("static void* counted_realloc(void* p, size_t n) { void* q = realloc(p, n); if (q && !p) live++; return q; }\n");
+    emit("static void counted_free(void* p) { if (p) live--; free(p); }\n");
+    emit("#define malloc counted_malloc\n");
+    emit("#define realloc counted_realloc\n");
+    emit("#define free counted_free\n");
+    gen_concurrent_runtime();
+    emit("#define CHECK(c) do { if (!(c)) { printf(\"line %%d: %%s\\n\", __LINE__, #c); return 1; } } while (0)\n");
+    emit("static int shared_untouched(ConcObj* o) { return atomic_load(&o->shared_rc) == CONC_RC_ZERO; }\n");
+    emit(scenario);
+}
+
+// Build and run `body` (CHECKs, then `return 0`); its output, or NULL
+static char* run_scenario(const char* body) {
+    scenario = body;
+    EmitSink* sink = emit_to_memory();
+    if (!sink) return NULL;
+    EmitSink* prev = emit_set_sink(sink);
+    gen_program();
+    emit_set_sink(prev);
+    char* prog = emit_take(sink);
+    if (!prog) return NULL;
+
+    char src[] = "/tmp/purple_conc_XXXXXX";
+    int fd = mkstemp(src);
+    if (fd < 0) { free(prog); return NULL; }
+    FILE* f = fdopen(fd, "w");
+    fputs(prog, f);
+    fclose(f);
+    free(prog);
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "gcc -O1 -w -pthread -x c -o %s.bin %s && %s.bin > %s.out; echo \"exit $?\" >> %s.out",
+             src, src, src, src, src);
+    char* out = NULL;
+    if (system(cmd) == 0) {
+        snprintf(cmd, sizeof(cmd), "%s.out", src);
+        FILE* in = fopen(cmd, "r");
+        if (in) {
+            out = calloc(1, 4096);
+            if (out) fread(out, 1, 4095, in);
+            fclose(in);
+        }
+    }
+    snprintf(cmd, sizeof(cmd), "%s.out", src);
+    remove(cmd);
+    snprintf(cmd, sizeof(cmd), "%s.bin", src);
+    remove(cmd);
+    remove(src);
+    return out;
+}
+
+static int passes(const char* body) {
+    char* out = run_scenario(body);
+    int ok = out && strcmp(out, "exit 0\n") == 0;
+    if (!ok) printf("[%s] ", out ? out : "(did not build)");
+    free(out);
+    return ok;
+}
+
+static void test_owner_stays_plain(void) {
+    TEST(owner_stays_plain);
+
+    // The owning thread never touches the shared count
+    if (!passes("int main(void) {\n"
+                "    ConcObj* l = conc_mk_pair(conc_mk_int(1), conc_mk_pair(conc_mk_int(2), NULL));\n"
+                "    for (int i = 0; i < 3; i++) conc_inc_ref(l);\n"
+                "    CHECK(l->biased_rc == 4 && shared_untouched(l));\n"
+                "    for (int i = 0; i < 3; i++) conc_dec_ref(l);\n"
+                "    CHECK(l->biased_rc == 1 && shared_untouched(l) && live == 4);\n"
+                "    conc_dec_ref(l);\n"
+                "    conc_flush_deferred();\n"
+                "    CHECK(live == 0);\n"
+                "    return 0;\n"
+                "}\n")) {
+        FAIL("owner paid atomics or leaked");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_handoff_merges(void) {
+    TEST(handoff_merges);
+
+    // A list sent to a consumer that frees it: the send unbiases the head,
+    // the cells below it are merged through the producer's queue
+    if (!passes("static void* consume(void* arg) {\n"
+                "    MsgChannel* ch = arg;\n"
+                "    ConcObj* l;\n"
+                "    while ((l = channel_recv(ch))) conc_dec_ref(l);\n"
+                "    return NULL;\n"
+                "}\n"
+                "int main(void) {\n"
+                "    MsgChannel* ch = channel_create(4);\n"
+                "    pthread_t t = spawn_thread(consume, ch);\n"
+                "    for (int n = 0; n < 50; n++) {\n"
+                "        ConcObj* l = NULL;\n"
+                "        for (int i = 0; i < 20; i++) l = conc_mk_pair(conc_mk_int(i), l);\n"
+                "        CHECK(channel_send(ch, l) == 0);\n"
+                "        CHECK(atomic_load(&l->owner_thread) == -1);\n"
+                "        conc_dec_ref(l);\n"
+                "        conc_safe_point();\n"
+                "    }\n"
+                "    channel_close(ch);\n"
+                "    pthread_join(t, NULL);\n"
+                "    channel_destroy(ch);\n"
+                "    conc_flush_deferred();\n"
+                "    CHECK(live == 0);\n"
+                "    return 0;\n"
+                "}\n")) {
+        FAIL("handed-off lists leaked");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_overdrawn_shared(void) {
+    TEST(overdrawn_shared);
+
+    // Another thread drops a reference the owner counted: the owner merges
+    // at its next safe point, or the dropper does once the owner has exited
+    if (!passes("static ConcObj* borrowed;\n"
+                "static void* drop(void* arg) { (void)arg; conc_dec_ref(borrowed); return NULL; }\n"
+                "static void* make(void* arg) {\n"
+                "    (void)arg;\n"
+                "    borrowed = conc_mk_int(7);\n"
+                "    return NULL;\n"
+                "}\n"
+                "int main(void) {\n"
+                "    ConcObj* x = conc_mk_int(1);\n"
+                "    conc_inc_ref(x);\n"
+                "    borrowed = x;\n"
+                "    pthread_t t = spawn_thread(drop, NULL);\n"
+                "    pthread_join(t, NULL);\n"
+                "    CHECK(atomic_load(&x->shared_rc) & CONC_RC_QUEUED);\n"
+                "    conc_dec_ref(x);\n"
+                "    CHECK(x->biased_rc == 1 && live == 1);\n"
+                "    conc_safe_point();\n"
+                "    CHECK(live == 1);  // The free queue\n"
+                "    t = spawn_thread(make, NULL);\n"
+                "    pthread_join(t, NULL);\n"
+                "    conc_dec_ref(borrowed);\n"
+                "    CHECK(CONC_FREE_LEN == 1);\n"
+                "    conc_flush_deferred();\n"
+                "    CHECK(live == 0);\n"
+                "    return 0;\n"
+                "}\n")) {
+        FAIL("overdrawn object leaked");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_frozen_skip_rc(void) {
+    TEST(frozen_skip_rc);
+
+    // Frozen graphs (a shared cell included) are never counted again
+    if (!passes("int main(void) {\n"
+                "    ConcObj* shared = conc_mk_int(3);\n"
+                "    ConcObj* g = conc_mk_pair(shared, conc_mk_pair(shared, NULL));\n"
+                "    conc_freeze(g);\n"
+                "    for (int i = 0; i < 5; i++) { conc_inc_ref(g->b); conc_dec_ref(g); }\n"
+                "    CHECK(g->biased_rc == 1 && shared_untouched(g) && shared_untouched(g->b));\n"
+                "    conc_safe_point();\n"
+                "    CHECK(live == 3);\n"
+                "    conc_release_frozen(g);\n"
+                "    CHECK(live == 0);\n"
+                "    return 0;\n"
+                "}\n")) {
+        FAIL("frozen graph counted");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Concurrent Runtime Unit Tests...\n");
+
+    test_owner_stays_plain();
+    test_handoff_merges();
+    test_overdrawn_shared();
+    test_frozen_skip_rc();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
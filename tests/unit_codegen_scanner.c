@@ -3,8 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <unistd.h>
 #include "../src/codegen/codegen.h"
+#include "../src/util/emit.h"
 
 static int tests_passed = 0;
 static int tests_failed = 0;
@@ -14,36 +14,14 @@ static int tests_failed = 0;
 #define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
 
 static char* capture_output(void (*fn)(void)) {
-    FILE* tmp = tmpfile();
-    if (!tmp) return NULL;
-
-    int saved = dup(fileno(stdout));
-    if (saved < 0) { fclose(tmp); return NULL; }
-
-    fflush(stdout);
-    if (dup2(fileno(tmp), fileno(stdout)) < 0) {
-        close(saved);
-        fclose(tmp);
-        return NULL;
-    }
+    EmitSink* sink = emit_to_memory();
+    if (!sink) return NULL;
 
+    EmitSink* prev = emit_set_sink(sink);
     fn();
-    fflush(stdout);
-
-    dup2(saved, fileno(stdout));
-    close(saved);
-
-    fseek(tmp, 0, SEEK_END);
-    long len = ftell(tmp);
-    if (len < 0) { fclose(tmp); return NULL; }
-    rewind(tmp);
-
-    char* buf = malloc((size_t)len + 1);
-    if (!buf) { fclose(tmp); return NULL; }
-    size_t read_len = fread(buf, 1, (size_t)len, tmp);
-    buf[read_len] = '\0';
-    fclose(tmp);
-    return buf;
+    emit_set_sink(prev);
+
+    return emit_take(sink);
 }
 
 static void gen_node_scanner(void) {
@@ -0,0 +1,147 @@
+// Unit tests for the instrumented runtime (-DPURPLE_STATS)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/codegen/codegen.h"
+#include "../src/memory/scc.h"
+#include "../src/memory/deferred.h"
+#include "../src/memory/arena.h"
+#include "../src/util/emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static char* capture_output(void (*fn)(void)) {
+    EmitSink* sink = emit_to_memory();
+    if (!sink) return NULL;
+
+    EmitSink* prev = emit_set_sink(sink);
+    fn();
+    emit_set_sink(prev);
+
+    return emit_take(sink);
+}
+
+// Every strategy fires a known number of times
+static void gen_program(void) {
+    gen_runtime_header();
+    gen_weak_ref_stub();
+    gen_perceus_runtime();
+    gen_scc_runtime();
+    gen_deferred_runtime();
+    gen_arena_runtime();
+    emit("int main(void) {\n");
+    emit("    Obj* l = NULL;\n");
+    emit("    for (int i = 0; i < 10; i++) l = mk_pair(mk_int(i), l);\n");
+    emit("    free_tree(l);\n");
+    emit("    dec_ref(mk_pair(mk_int(1), mk_int(2)));\n");
+    emit("    Obj* old = mk_int(3);\n");
+    emit("    Obj* again = reuse_as_int(old, 4);\n");
+    emit("    inc_ref(again);\n");
+    emit("    Obj* fresh = reuse_as_int(again, 5);\n");
+    emit("    free_unique(fresh);\n");
+    emit("    free_unique(again);\n");
+    emit("    for (int i = 0; i < 100; i++) defer_dec(mk_int(i));\n");
+    emit("    safe_point();\n");
+    emit("    flush_all_deferred();\n");
+    emit("    Arena* a = arena_create(0);\n");
+    emit("    for (int i = 0; i < 7; i++) arena_mk_pair(a, arena_mk_int(a, i), NULL);\n");
+    emit("    arena_destroy(a);\n");
+    emit("    Obj* x = mk_pair(NULL, NULL);\n");
+    emit("    Obj* y = mk_pair(x, NULL);\n");
+    emit("    x->b = y;\n");
+    emit("    release_scc(freeze_cyclic(x));\n");
+    emit("    return 0;\n");
+    emit("}\n");
+}
+
+// Build the program with `defines`, run it, and return what it wrote to
+// PURPLE_STATS_FILE (an empty string if nothing)
+static char* run_program(const char* defines) {
+    char* prog = capture_output(gen_program);
+    if (!prog) return NULL;
+    char src[] = "/tmp/purple_stats_XXXXXX";
+    int fd = mkstemp(src);
+    if (fd < 0) { free(prog); return NULL; }
+    FILE* f = fdopen(fd, "w");
+    fputs(prog, f);
+    fclose(f);
+    free(prog);
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+             "gcc -O1 -w %s -x c -o %s.bin %s && rm -f %s.json && PURPLE_STATS_FILE=%s.json %s.bin",
+             defines, src, src, src, src, src);
+    int status = system(cmd);
+    snprintf(cmd, sizeof(cmd), "%s.json", src);
+    char* json = NULL;
+    FILE* in = status == 0 ? fopen(cmd, "r") : NULL;
+    if (in) {
+        json = calloc(1, 4096);
+        if (json) fread(json, 1, 4095, in);
+        fclose(in);
+    } else if (status == 0) {
+        json = calloc(1, 1);
+    }
+    remove(cmd);
+    snprintf(cmd, sizeof(cmd), "%s.bin", src);
+    remove(cmd);
+    remove(src);
+    return json;
+}
+
+static void test_counts_by_strategy(void) {
+    TEST(counts_by_strategy);
+
+    char* json = run_program("-DPURPLE_STATS");
+    if (!json) { FAIL("program failed"); return; }
+    static const char* expected[] = {
+        "\"int\": 113, \"pair\": 13, \"stack\": 0, \"arena\": 14",
+        "\"tree\": 20", "\"rc\": 3", "\"unique\": 2", "\"scc\": 2", "\"deferred\": 100", "\"arena\": 14}",
+        "\"reuse\": {\"hits\": 1, \"misses\": 1}",
+        "\"peak_backlog\": 100, \"safe_points\": 1",
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        if (!strstr(json, expected[i])) {
+            printf("[%s not in %s] ", expected[i], json);
+            free(json);
+            FAIL("wrong counts");
+            return;
+        }
+    }
+    // Sites are lines: both constructors in the list loop, ten times each
+    int ok = strstr(json, "\"sites\": [{\"file\": ") && strstr(json, "\"count\": 20}");
+    free(json);
+    if (!ok) { FAIL("allocation sites missing"); return; }
+
+    PASS();
+}
+
+static void test_off_by_default(void) {
+    TEST(off_by_default);
+
+    char* json = run_program("");
+    int ok = json && json[0] == '\0';
+    free(json);
+    if (!ok) { FAIL("uninstrumented build wrote stats"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Stats Codegen Unit Tests...\n");
+
+    test_counts_by_strategy();
+    test_off_by_default();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
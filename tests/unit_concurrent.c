@@ -0,0 +1,62 @@
+// Unit tests for the concurrency analyses
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+#include "../src/memory/concurrent.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static int spsc(const char* body) {
+    set_parse_input(body);
+    return channel_is_spsc(mk_sym("c"), parse());
+}
+
+static void test_spsc_pipeline(void) {
+    TEST(spsc_pipeline);
+
+    // One producer thread, the scope receives
+    if (!spsc("(do (go (send c 1)) (recv c))")) { FAIL("producer thread refused"); return; }
+    // A loop inside the only thread is still one producer
+    if (!spsc("(go (letrec ((loop (lambda (n) (if (= n 0) 0 (do (chan-send! c n) (loop (- n 1))))))) (loop 10)))")) {
+        FAIL("loop in the producer thread refused");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_spsc_refused(void) {
+    TEST(spsc_refused);
+
+    if (spsc("(do (go (send c 1)) (go (send c 2)) (recv c))")) { FAIL("two producers"); return; }
+    // A spawn inside a lambda may run many times
+    if (spsc("(let ((f (lambda (x) (go (send c x))))) (do (f 1) (f 2) (recv c)))")) { FAIL("spawn in a lambda"); return; }
+    // The closure can still be handed to another thread
+    if (spsc("(go (let ((f (lambda (x) (send c x)))) (do (go (f 1)) (f 2))))")) { FAIL("closure escaped"); return; }
+    if (spsc("(do (go (send c 1)) (g c))")) { FAIL("channel passed on"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Concurrency Unit Tests...\n");
+    init_syms();
+
+    test_spsc_pipeline();
+    test_spsc_refused();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
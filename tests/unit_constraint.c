@@ -0,0 +1,76 @@
+// Unit tests for constraint.c - Constraint References
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/memory/constraint.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+void test_free_with_constraints(void) {
+    TEST(free_with_constraints);
+
+    ConstraintContext* ctx = constraint_context_new(false);
+    ConstraintObj* obj = constraint_alloc(ctx, NULL, NULL, "graph");
+    ConstraintRef* a = constraint_add(obj, "observer");
+    ConstraintRef* b = constraint_add(obj, "callback");
+    if (!a || !b || obj->constraint_count != 2) { FAIL("constraints not counted"); constraint_context_free(ctx); return; }
+
+    // Active constraints: the free is refused and recorded
+    if (constraint_free(ctx, obj) != CONSTRAINT_ERR_VIOLATION) { FAIL("free not refused"); constraint_context_free(ctx); return; }
+    if (constraint_get_violation_count(ctx) != 1 || !strstr(constraint_get_violation(ctx, 0), "graph")) {
+        FAIL("violation not recorded");
+        constraint_context_free(ctx);
+        return;
+    }
+
+    constraint_release(a);
+    if (constraint_release(a) != CONSTRAINT_ERR_DOUBLE_RELEASE) { FAIL("double release"); constraint_context_free(ctx); return; }
+    constraint_release(b);
+    if (constraint_free(ctx, obj) != CONSTRAINT_OK) { FAIL("free refused"); constraint_context_free(ctx); return; }
+    ConstraintError err = CONSTRAINT_OK;
+    if (constraint_deref(a, &err) != NULL || err != CONSTRAINT_ERR_RELEASED) { FAIL("deref after release"); constraint_context_free(ctx); return; }
+
+    constraint_ref_free(a);
+    constraint_ref_free(b);
+    free(obj);
+    constraint_context_free(ctx);
+    PASS();
+}
+
+void test_sources_tracked(void) {
+    TEST(sources_tracked);
+
+#ifndef CONSTRAINT_RELEASE
+    // Debug builds keep the sources of live constraints for the report
+    ConstraintObj* obj = constraint_alloc(NULL, NULL, NULL, "node");
+    ConstraintRef* a = constraint_add(obj, "a");
+    ConstraintRef* b = constraint_add(obj, "b");
+    constraint_release(a);
+    if (obj->source_count != 1 || strcmp(obj->constraint_sources[0], "b") != 0) { FAIL("wrong sources"); return; }
+    constraint_release(b);
+    constraint_ref_free(a);
+    constraint_ref_free(b);
+    free(obj);
+#endif
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Constraint Reference Unit Tests...\n");
+
+    test_free_with_constraints();
+    test_sources_tracked();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -19,9 +19,8 @@ void test_deferred_create_destroy(void) {
     DeferredContext* ctx = mk_deferred_context(32);
     if (!ctx) { FAIL("mk_deferred_context returned NULL"); return; }
     if (ctx->batch_size != 32) { FAIL("batch_size not set"); free_deferred_context(ctx); return; }
-    if (ctx->pending != NULL) { FAIL("pending should be NULL"); free_deferred_context(ctx); return; }
     if (ctx->pending_count != 0) { FAIL("pending_count should be 0"); free_deferred_context(ctx); return; }
-    if (!ctx->obj_lookup) { FAIL("obj_lookup should be created"); free_deferred_context(ctx); return; }
+    if (!ctx->ring || !ctx->index) { FAIL("ring and index should be created"); free_deferred_context(ctx); return; }
     if (ctx->dropped_decrements != 0) { FAIL("dropped_decrements should start at 0"); free_deferred_context(ctx); return; }
 
     free_deferred_context(ctx);
@@ -50,8 +49,7 @@ void test_defer_single(void) {
     defer_decrement(ctx, &obj);
 
     if (ctx->pending_count != 1) { FAIL("pending_count should be 1"); free_deferred_context(ctx); return; }
-    if (ctx->pending == NULL) { FAIL("pending should not be NULL"); free_deferred_context(ctx); return; }
-    if (ctx->pending->count != 1) { FAIL("count should be 1"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &obj) != 1) { FAIL("count should be 1"); free_deferred_context(ctx); return; }
     if (ctx->total_deferred != 1) { FAIL("total_deferred should be 1"); free_deferred_context(ctx); return; }
 
     free_deferred_context(ctx);
@@ -72,7 +70,7 @@ void test_defer_coalesce(void) {
 
     // Should coalesce into one entry with count 3
     if (ctx->pending_count != 1) { FAIL("pending_count should be 1"); free_deferred_context(ctx); return; }
-    if (ctx->pending->count != 3) { FAIL("count should be 3"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &obj) != 3) { FAIL("count should be 3"); free_deferred_context(ctx); return; }
 
     free_deferred_context(ctx);
     PASS();
@@ -111,12 +109,12 @@ void test_process_deferred(void) {
     // Process 1
     process_deferred(ctx, 1);
     if (ctx->pending_count != 1) { FAIL("should still have 1 pending"); free_deferred_context(ctx); return; }
-    if (ctx->pending->count != 1) { FAIL("count should be 1"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &obj) != 1) { FAIL("count should be 1"); free_deferred_context(ctx); return; }
 
     // Process 1 more - should remove
     process_deferred(ctx, 1);
     if (ctx->pending_count != 0) { FAIL("should have 0 pending"); free_deferred_context(ctx); return; }
-    if (ctx->pending != NULL) { FAIL("pending should be NULL"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &obj) != 0) { FAIL("entry should be gone"); free_deferred_context(ctx); return; }
 
     free_deferred_context(ctx);
     PASS();
@@ -169,7 +167,7 @@ void test_flush_deferred(void) {
     flush_deferred(ctx);
 
     if (ctx->pending_count != 0) { FAIL("should have 0 pending after flush"); free_deferred_context(ctx); return; }
-    if (ctx->pending != NULL) { FAIL("pending should be NULL after flush"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &objs[0]) != 0) { FAIL("entries should be gone after flush"); free_deferred_context(ctx); return; }
 
     free_deferred_context(ctx);
     PASS();
@@ -315,6 +313,87 @@ void test_deferred_stats(void) {
     PASS();
 }
 
+// Test ring growth, wrap-around and index deletion under churn
+void test_deferred_ring_churn(void) {
+    TEST(deferred_ring_churn);
+
+    DeferredContext* ctx = mk_deferred_context(16);
+    if (!ctx) { FAIL("mk_deferred_context returned NULL"); return; }
+
+    // Past the initial capacity: the ring grows while entries are queued
+    static int objs[1000];
+    for (int i = 0; i < 1000; i++) {
+        defer_decrement(ctx, &objs[i]);
+        if (i % 3 == 0) defer_decrement(ctx, &objs[i]);
+    }
+    if (ctx->pending_count != 1000) { FAIL("should have 1000 pending"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &objs[999]) != 2) { FAIL("last entry count should be 2"); free_deferred_context(ctx); return; }
+
+    // Oldest first; entries with decrements left go back to the tail
+    process_deferred(ctx, 500);
+    if (ctx->pending_count != 500 + 167) { FAIL("wrong pending after partial batch"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &objs[1]) != 0) { FAIL("objs[1] should be done"); free_deferred_context(ctx); return; }
+    if (deferred_pending_for(ctx, &objs[0]) != 1) { FAIL("objs[0] should have 1 left"); free_deferred_context(ctx); return; }
+
+    // New deferrals wrap around the ring and are still found
+    for (int i = 0; i < 300; i++) defer_decrement(ctx, &objs[i]);
+    for (int i = 0; i < 1000; i++) {
+        int expected = (i < 500 ? (i % 3 == 0) : 1 + (i % 3 == 0)) + (i < 300);
+        if (deferred_pending_for(ctx, &objs[i]) != expected) { FAIL("count lost across wrap"); free_deferred_context(ctx); return; }
+    }
+
+    flush_deferred(ctx);
+    if (ctx->pending_count != 0) { FAIL("should be empty after flush"); free_deferred_context(ctx); return; }
+    for (int i = 0; i < 1000; i++) {
+        if (deferred_pending_for(ctx, &objs[i]) != 0) { FAIL("index not empty after flush"); free_deferred_context(ctx); return; }
+    }
+
+    free_deferred_context(ctx);
+    PASS();
+}
+
+// Test adaptive batch sizing against a pause budget
+void test_deferred_adaptive_batch(void) {
+    TEST(deferred_adaptive_batch);
+
+    DeferredContext* ctx = mk_deferred_context(32);
+    if (!ctx) { FAIL("mk_deferred_context returned NULL"); return; }
+
+    // Without a budget the batch never moves
+    deferred_adapt(ctx, 32, 1000000);
+    if (ctx->batch_size != 32) { FAIL("fixed batch should not adapt"); free_deferred_context(ctx); return; }
+
+    deferred_set_pause_budget(ctx, 50000);
+
+    // Within budget and no backlog: unchanged
+    deferred_adapt(ctx, 32, 3200);
+    if (ctx->batch_size != 32) { FAIL("idle batch should stay"); free_deferred_context(ctx); return; }
+
+    // Backlog builds: doubles, but only up to what fits the budget (100 ns each)
+    static char objs[DEFERRED_BACKLOG_LIMIT + 1000];
+    for (int i = 0; i < 5000; i++) defer_decrement(ctx, &objs[i]);
+    deferred_adapt(ctx, 32, 3200);
+    if (ctx->batch_size != 64) { FAIL("batch should double under backlog"); free_deferred_context(ctx); return; }
+    for (int i = 0; i < 10; i++) deferred_adapt(ctx, ctx->batch_size, ctx->batch_size * 100L);
+    if (ctx->batch_size != 500) { FAIL("batch should stop at the budget"); free_deferred_context(ctx); return; }
+
+    // A pause over budget shrinks it
+    deferred_adapt(ctx, 500, 200000);
+    if (ctx->batch_size > 250 || ctx->over_budget != 1) { FAIL("missed budget should shrink"); free_deferred_context(ctx); return; }
+
+    // Past the backlog limit the budget gives way
+    for (int i = 5000; i < DEFERRED_BACKLOG_LIMIT + 1000; i++) defer_decrement(ctx, &objs[i]);
+    deferred_adapt(ctx, ctx->batch_size, 1000000);
+    if (ctx->batch_size < 1000 || ctx->backlog_forced != 1) { FAIL("backlog should force a larger batch"); free_deferred_context(ctx); return; }
+
+    // Turning the budget off restores the configured batch
+    deferred_set_pause_budget(ctx, 0);
+    if (ctx->batch_size != 32) { FAIL("batch should reset"); free_deferred_context(ctx); return; }
+
+    free_deferred_context(ctx);
+    PASS();
+}
+
 int main(void) {
     printf("Running Deferred RC Unit Tests...\n\n");
 
@@ -330,6 +409,8 @@ int main(void) {
     test_deferred_hash_collision();
     test_deferred_mixed_ops();
     test_deferred_stats();
+    test_deferred_ring_churn();
+    test_deferred_adaptive_batch();
 
     printf("\n========================================\n");
     printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
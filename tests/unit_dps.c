@@ -0,0 +1,99 @@
+// Unit tests for dps.c - destinations for let-bound cells
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/analysis/dps.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* parse_src(const char* src) {
+    set_parse_input(src);
+    return parse();
+}
+
+static int rewrites_to(const char* code, const char* expected) {
+    char* out = dps_write_code(code, "_d");
+    int ok = expected ? out && strcmp(out, expected) == 0 : out == NULL;
+    if (!ok) printf("[%s -> %s] ", code, out ? out : "NULL");
+    free(out);
+    return ok;
+}
+
+static void test_write_code(void) {
+    TEST(write_code);
+
+    if (!rewrites_to("mk_pair(mk_int(1), x)", "write_pair(&_d, mk_int(1), x)")) { FAIL("simple pair"); return; }
+    if (!rewrites_to("mk_pair(add(a, b), mk_pair(c, d))", "write_pair(&_d, add(a, b), mk_pair(c, d))")) {
+        FAIL("nested pair"); return;
+    }
+    // Only one whole call qualifies
+    if (!rewrites_to("(mk_pair(a, b))->a", NULL)) { FAIL("projection"); return; }
+    if (!rewrites_to("mk_pair(a, b)->a", NULL)) { FAIL("trailing code"); return; }
+    if (!rewrites_to("mk_int(1)", "write_int(&_d, 1)")) { FAIL("integer"); return; }
+    if (!rewrites_to("add(a, b)", NULL)) { FAIL("not a constructor"); return; }
+    if (!rewrites_to("mk_pair(a, b", NULL)) { FAIL("unbalanced"); return; }
+    // Parentheses in literals do not count
+    if (!rewrites_to("mk_pair(f(\")\"), b)", "write_pair(&_d, f(\")\"), b)")) { FAIL("string literal"); return; }
+
+    PASS();
+}
+
+static DPSClass classify(const char* val, const char* body, Shape shape) {
+    return classify_dps_binding(parse_src(val), "mk_pair(a, b)", parse_src(body), "x", shape);
+}
+
+static void test_classify(void) {
+    TEST(classify);
+
+    if (classify("(cons a b)", "(+ (car x) (cdr x))", SHAPE_TREE) != DPS_STACK) { FAIL("own cons"); return; }
+    if (classify("(f a)", "(null? x)", SHAPE_DAG) != DPS_CALLER_OWNED) { FAIL("inlined call"); return; }
+    if (classify_dps_binding(parse_src("(lift 3)"), "mk_int(3)", parse_src("(+ x (* x 2))"), "x",
+                             SHAPE_TREE) != DPS_STACK) {
+        FAIL("lifted integer"); return;
+    }
+
+    static const char* escaping[] = {
+        "x",                          // returned
+        "(cons x 1)",                 // stored
+        "(f x)",                      // passed on
+        "(lambda () (car x))",        // captured
+        "(set! x 1)",
+        "(car x y)",
+    };
+    for (size_t i = 0; i < sizeof(escaping) / sizeof(escaping[0]); i++) {
+        if (classify("(cons a b)", escaping[i], SHAPE_TREE) != DPS_NONE) {
+            printf("[%s] ", escaping[i]); FAIL("escaping cell placed"); return;
+        }
+    }
+    if (classify("(cons a b)", "(car x)", SHAPE_CYCLIC) != DPS_NONE) { FAIL("cyclic cell placed"); return; }
+    if (classify("(quote (1 2))", "(car x)", SHAPE_TREE) != DPS_NONE) { FAIL("quoted data placed"); return; }
+    if (classify_dps_binding(parse_src("(cons a b)"), "add(a, b)", parse_src("(car x)"), "x", SHAPE_TREE) != DPS_NONE) {
+        FAIL("non-pair code placed"); return;
+    }
+    // Quoted mentions are not reads
+    if (classify("(cons a b)", "(f (quote x) (car x))", SHAPE_TREE) != DPS_STACK) { FAIL("quoted name"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running DPS Unit Tests...\n");
+    init_syms();
+
+    test_write_code();
+    test_classify();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
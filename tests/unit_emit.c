@@ -0,0 +1,100 @@
+// Unit tests for the code emission sink
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/util/emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static void test_memory_sink(void) {
+    TEST(memory_sink);
+
+    EmitSink* sink = emit_to_memory();
+    if (!sink) { FAIL("create"); return; }
+    EmitSink* prev = emit_set_sink(sink);
+    emit("int x = %d;\n", 42);
+    emit("100%%\n");
+    emit_str("raw %d\n");
+    emit_set_sink(prev);
+
+    char* text = emit_take(sink);
+    if (!text || strcmp(text, "int x = 42;\n100%\nraw %d\n") != 0) {
+        FAIL("unexpected text");
+        free(text);
+        return;
+    }
+    free(text);
+
+    PASS();
+}
+
+static void test_file_sink(void) {
+    TEST(file_sink);
+
+    const char* path = "/tmp/purple_unit_emit.c";
+    EmitSink* sink = emit_open(path);
+    if (!sink) { FAIL("open"); return; }
+    EmitSink* prev = emit_set_sink(sink);
+    // Enough to cross the flush threshold several times
+    for (int i = 0; i < 20000; i++) emit("line %d\n", i);
+    emit_set_sink(prev);
+    emit_close(sink);
+
+    FILE* f = fopen(path, "r");
+    if (!f) { FAIL("reopen"); return; }
+    char line[64];
+    int count = 0;
+    int ordered = 1;
+    while (fgets(line, sizeof(line), f)) {
+        if (atoi(line + 5) != count) ordered = 0;
+        count++;
+    }
+    fclose(f);
+    remove(path);
+    if (count != 20000 || !ordered) { FAIL("file contents"); return; }
+
+    PASS();
+}
+
+static void test_nested_sinks(void) {
+    TEST(nested_sinks);
+
+    EmitSink* outer = emit_to_memory();
+    EmitSink* inner = emit_to_memory();
+    if (!outer || !inner) { FAIL("create"); return; }
+    EmitSink* prev = emit_set_sink(outer);
+    emit("a");
+    emit_set_sink(inner);
+    emit("b");
+    emit_set_sink(outer);
+    emit("c");
+    emit_set_sink(prev);
+
+    char* o = emit_take(outer);
+    char* i = emit_take(inner);
+    int ok = o && i && strcmp(o, "ac") == 0 && strcmp(i, "b") == 0;
+    free(o);
+    free(i);
+    if (!ok) { FAIL("sinks mixed"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Emit Sink Unit Tests...\n");
+    test_memory_sink();
+    test_file_sink();
+    test_nested_sinks();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -408,6 +408,38 @@ void test_analyze_escape_null(void) {
     PASS();
 }
 
+// Test that the index finds the newest binding of each name
+void test_var_index(void) {
+    TEST(var_index);
+
+    AnalysisContext* ctx = mk_analysis_ctx();
+    if (!ctx) { FAIL("mk_analysis_ctx returned NULL"); return; }
+
+    add_var(ctx, "x");
+    VarUsage* outer = find_var(ctx, "x");
+    add_var(ctx, "x");
+    VarUsage* inner = find_var(ctx, "x");
+    if (!inner || inner == outer) { FAIL("inner x not newest"); free_analysis_ctx(ctx); return; }
+    record_use(ctx, "x");
+    if (outer->use_count != 0 || inner->use_count != 1) { FAIL("use counted on outer x"); free_analysis_ctx(ctx); return; }
+
+    // Many bindings: every one stays findable
+    char name[16];
+    for (int i = 0; i < 5000; i++) {
+        snprintf(name, sizeof(name), "v%d", i);
+        add_var(ctx, name);
+    }
+    for (int i = 0; i < 5000; i++) {
+        snprintf(name, sizeof(name), "v%d", i);
+        VarUsage* v = find_var(ctx, name);
+        if (!v || strcmp(v->name, name) != 0) { FAIL("binding lost"); free_analysis_ctx(ctx); return; }
+    }
+    if (find_var(ctx, "x") != inner) { FAIL("x lost after growth"); free_analysis_ctx(ctx); return; }
+
+    free_analysis_ctx(ctx);
+    PASS();
+}
+
 int main(void) {
     printf("Running Escape Analysis Unit Tests...\n\n");
 
@@ -431,6 +463,7 @@ int main(void) {
     test_find_free_vars_lambda();
     test_find_free_vars_quote();
     test_analyze_escape_null();
+    test_var_index();
 
     printf("\n========================================\n");
     printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
@@ -0,0 +1,74 @@
+// Unit tests for immediate (tagged) integers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static void test_small_ints_are_immediate(void) {
+    TEST(small_ints_are_immediate);
+
+    Value* v = mk_int(42);
+    if (!is_fixnum(v)) { FAIL("42 should be a fixnum"); return; }
+    if (val_tag(v) != T_INT) { FAIL("fixnum tag should be T_INT"); return; }
+    if (val_int(v) != 42) { FAIL("fixnum payload"); return; }
+    if (mk_int(-7) != mk_int(-7)) { FAIL("equal fixnums should be identical"); return; }
+    if (val_int(mk_int(-7)) != -7) { FAIL("negative payload"); return; }
+
+    PASS();
+}
+
+static void test_range_boundaries(void) {
+    TEST(range_boundaries);
+
+    Value* hi = mk_int(FIXNUM_MAX);
+    Value* lo = mk_int(FIXNUM_MIN);
+    if (!is_fixnum(hi) || val_int(hi) != FIXNUM_MAX) { FAIL("FIXNUM_MAX round trip"); return; }
+    if (!is_fixnum(lo) || val_int(lo) != FIXNUM_MIN) { FAIL("FIXNUM_MIN round trip"); return; }
+
+    // Outside the immediate range values are boxed but behave the same
+    Value* big = mk_int((long)FIXNUM_MAX + 1);
+    if (is_fixnum(big)) { FAIL("FIXNUM_MAX+1 should be boxed"); return; }
+    if (val_tag(big) != T_INT || val_int(big) != (long)FIXNUM_MAX + 1) { FAIL("boxed int payload"); return; }
+
+    PASS();
+}
+
+static void test_helpers_accept_fixnums(void) {
+    TEST(helpers_accept_fixnums);
+
+    Value* v = mk_int(5);
+    if (is_nil(v) || is_code(v) || car(v) || cdr(v)) { FAIL("predicates misread fixnum"); return; }
+    if (sym_eq(v, v) || sym_eq_str(v, "5")) { FAIL("fixnum is not a symbol"); return; }
+
+    char* s = val_to_str(v);
+    if (!s || strcmp(s, "5") != 0) { FAIL("val_to_str of fixnum"); free(s); return; }
+    free(s);
+
+    Value* list = mk_cell(mk_int(1), mk_cell(mk_int(-2), NULL));
+    s = val_to_str(list);
+    if (!s || strcmp(s, "(1 -2)") != 0) { FAIL("val_to_str of fixnum list"); free(s); return; }
+    free(s);
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Fixnum Unit Tests...\n");
+    test_small_ints_are_immediate();
+    test_range_boundaries();
+    test_helpers_accept_fixnums();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Unit tests for fold.c - partial evaluation of lifted arithmetic
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../src/codegen/fold.h"
+#include "../src/codegen/codegen.h"
+#include "../src/eval/eval.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static int emits(Value* code, const char* expected) {
+    if (!code || val_tag(code) != T_CODE) return 0;
+    if (strcmp(code_text(code), expected) != 0) {
+        printf("[got %s] ", code_text(code));
+        return 0;
+    }
+    return 1;
+}
+
+static int folds_to(Value* code, long expected) {
+    long k;
+    return code_int_value(code, &k) && k == expected;
+}
+
+static void test_constants(void) {
+    TEST(constants);
+
+    Value* ten = lift_int(10);
+    if (!emits(ten, "mk_int(10)") || !folds_to(ten, 10)) { FAIL("lifted constant"); return; }
+    if (!folds_to(emit_c_call("add", mk_int(5), ten), 15)) { FAIL("static + lifted"); return; }
+    if (!emits(emit_c_call("mul", ten, lift_int(3)), "mk_int(30)")) { FAIL("lifted * lifted"); return; }
+    if (!folds_to(emit_c_call("lt_op", ten, mk_int(3)), 0)) { FAIL("comparison"); return; }
+    if (!folds_to(prim_not(mk_cell(lift_int(0), NIL), NIL), 1)) { FAIL("not"); return; }
+
+    // The runtime's edge cases, at compile time
+    if (!folds_to(emit_c_call("add", lift_int(LONG_MAX), mk_int(1)), 0)) { FAIL("overflow"); return; }
+    if (!folds_to(emit_c_call("div_op", ten, lift_int(0)), 0)) { FAIL("division by zero"); return; }
+    if (!folds_to(emit_c_call("mod_op", lift_int(LONG_MIN), mk_int(-1)), 0)) { FAIL("LONG_MIN % -1"); return; }
+
+    PASS();
+}
+
+static void test_unboxed_chain(void) {
+    TEST(unboxed_chain);
+
+    // One mk_int at the top; nil leaves are checked where they are read
+    Value* x = mk_code("x");
+    Value* inner = emit_c_call("add", x, mk_int(1));
+    if (!emits(inner, "mk_int((x ? add_l(x->i, 1) : 0))")) { FAIL("leaf + constant"); return; }
+    Value* outer = emit_c_call("mul", inner, mk_code("(p)->b"));
+    if (!emits(outer, "mk_int(((p)->b ? mul_l((x ? add_l(x->i, 1) : 0), (p)->b->i) : 0))")) {
+        FAIL("nested chain");
+        return;
+    }
+    if (!emits(emit_c_call("eq_op", x, x), "mk_int((x ? (x->i == x->i) : 0))")) { FAIL("one guard per leaf"); return; }
+    if (!emits(emit_c_call("sub", lift_int(LONG_MIN), x), "mk_int((x ? sub_l(LONG_MIN, x->i) : 0))")) {
+        FAIL("LONG_MIN literal");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_boxed_fallback(void) {
+    TEST(boxed_fallback);
+
+    // Calls may allocate or have effects: no unboxing across them
+    if (!emits(emit_c_call("add", mk_code("f(x)"), mk_int(1)), "add(f(x), mk_int(1))")) { FAIL("call operand"); return; }
+    if (!emits(emit_c_call("add", mk_code("(mk_pair(a, b))->a"), lift_int(1)), "add((mk_pair(a, b))->a, mk_int(1))")) {
+        FAIL("path over a call");
+        return;
+    }
+    if (!emits(emit_c_call("sub", mk_code("a-b"), mk_int(1)), "sub(a-b, mk_int(1))")) { FAIL("not a path"); return; }
+    if (!emits(emit_c_call("mk_pair", mk_code("x"), mk_int(1)), "mk_pair(x, mk_int(1))")) { FAIL("not an int primitive"); return; }
+    if (!emits(emit_c_call("not_op", mk_code("x"), NIL), "not_op(x, NULL)")) { FAIL("not of a leaf"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Fold Unit Tests...\n");
+    init_syms();
+
+    test_constants();
+    test_unboxed_chain();
+    test_boxed_fallback();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
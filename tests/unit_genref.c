@@ -0,0 +1,123 @@
+// Unit tests for generational references
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "../src/memory/genref.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define GEN_SAMPLES 4096
+
+static int cmp_gen(const void* a, const void* b) {
+    Generation x = *(const Generation*)a, y = *(const Generation*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Whether n generations are non-zero and pairwise distinct
+static int all_distinct(Generation* gens, int n) {
+    qsort(gens, (size_t)n, sizeof(Generation), cmp_gen);
+    for (int i = 0; i < n; i++) {
+        if (gens[i] == 0 || (i > 0 && gens[i] == gens[i - 1])) return 0;
+    }
+    return 1;
+}
+
+static void test_generations_distinct(void) {
+    TEST(generations_distinct);
+
+    static Generation gens[GEN_SAMPLES];
+    for (int i = 0; i < GEN_SAMPLES; i++) gens[i] = genref_random_generation();
+    if (!all_distinct(gens, GEN_SAMPLES)) { FAIL("repeated or zero generation"); return; }
+
+    // The OS path still works, and switching back resumes the generator
+    genref_set_hardened(true);
+    for (int i = 0; i < 16; i++) gens[i] = genref_random_generation();
+    genref_set_hardened(false);
+    for (int i = 16; i < 32; i++) gens[i] = genref_random_generation();
+    if (!all_distinct(gens, 32)) { FAIL("hardened mode"); return; }
+
+    PASS();
+}
+
+static void* fill_gens(void* arg) {
+    Generation* gens = arg;
+    for (int i = 0; i < GEN_SAMPLES / 2; i++) gens[i] = genref_random_generation();
+    return NULL;
+}
+
+static void test_threads_seeded_apart(void) {
+    TEST(threads_seeded_apart);
+
+    // Each thread seeds its own generator: their streams must not overlap
+    static Generation gens[GEN_SAMPLES];
+    pthread_t a, b;
+    pthread_create(&a, NULL, fill_gens, gens);
+    pthread_create(&b, NULL, fill_gens, gens + GEN_SAMPLES / 2);
+    pthread_join(a, NULL);
+    pthread_join(b, NULL);
+    if (!all_distinct(gens, GEN_SAMPLES)) { FAIL("threads share a stream"); return; }
+
+    // Still catches use after free
+    GenRefContext* ctx = genref_context_new();
+    int payload = 7;
+    GenObj* obj = genref_alloc(ctx, &payload, NULL);
+    GenRef* ref = genref_create_ref(obj, "test");
+    if (!genref_is_valid(ref)) { FAIL("fresh ref invalid"); return; }
+    genref_free(obj);
+    if (genref_is_valid(ref)) { FAIL("ref valid after free"); return; }
+    genref_ref_free(ref);
+    genref_context_free(ctx);
+
+    PASS();
+}
+
+static void test_inline_layout(void) {
+    TEST(inline_layout);
+
+    GenSlab* slab = genref_slab_new(24);
+    if (!slab) { FAIL("no slab"); return; }
+    long* obj = genref_slab_alloc(slab);
+    if (!obj || ((uintptr_t)obj & 15) != 0) { FAIL("misaligned object"); return; }
+    obj[0] = 42;
+    GenPtr ref = genref_ptr(obj);
+    GenRefError err;
+    if (genref_ptr_deref(ref, &err) != obj || err != GENREF_OK) { FAIL("fresh ref invalid"); return; }
+
+    // The freed slot is the next one handed out: the old ref must see that
+    genref_slab_free(slab, obj);
+    if (genref_ptr_is_valid(ref)) { FAIL("valid after free"); return; }
+    long* again = genref_slab_alloc(slab);
+    if (again != obj) { FAIL("slot not reused"); return; }
+    if (again[0] != 0) { FAIL("reused slot not cleared"); return; }
+    if (genref_ptr_is_valid(ref)) { FAIL("valid after reuse"); return; }
+    if (!genref_ptr_is_valid(genref_ptr(again))) { FAIL("new ref invalid"); return; }
+
+    // Churn stays in the first chunk
+    for (int i = 0; i < 10000; i++) genref_slab_free(slab, genref_slab_alloc(slab));
+    if (slab->chunk_count != 1 || slab->live != 1) { FAIL("slots leaked"); return; }
+    genref_slab_destroy(slab);
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Generational Reference Unit Tests...\n");
+
+    test_generations_distinct();
+    test_threads_seeded_apart();
+    test_inline_layout();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
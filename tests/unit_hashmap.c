@@ -4,6 +4,7 @@
 #include <string.h>
 #include <assert.h>
 #include "../src/util/hashmap.h"
+#include "../src/memory/arena.h"
 
 static int tests_passed = 0;
 static int tests_failed = 0;
@@ -295,6 +296,37 @@ void test_hashmap_clear(void) {
     PASS();
 }
 
+// Test arena-backed entries
+void test_hashmap_arena(void) {
+    TEST(hashmap_arena);
+
+    HashMap* map = hashmap_new_arena(16);
+    if (!map || !map->arena) { FAIL("hashmap_new_arena returned no arena"); hashmap_free(map); return; }
+
+    for (int round = 0; round < 3; round++) {
+        for (uintptr_t i = 1; i <= 2000; i++) hashmap_put(map, (void*)i, (void*)(i * 3));
+        if (hashmap_size(map) != 2000) { FAIL("wrong size"); hashmap_free(map); return; }
+        if (hashmap_get(map, (void*)77) != (void*)231) { FAIL("wrong value"); hashmap_free(map); return; }
+
+        // Removed entries are reused by the next put
+        HashEntry* spare_before = map->spare;
+        hashmap_remove(map, (void*)5);
+        if (!map->spare || map->spare == spare_before) { FAIL("removed entry not kept"); hashmap_free(map); return; }
+        hashmap_put(map, (void*)5000, (void*)1);
+        if (map->spare != spare_before || hashmap_get(map, (void*)5000) != (void*)1) { FAIL("spare not reused"); hashmap_free(map); return; }
+
+        // Clear drops everything at once and the arena is reused
+        hashmap_clear(map);
+        if (hashmap_size(map) != 0 || hashmap_get(map, (void*)77)) { FAIL("clear left entries"); hashmap_free(map); return; }
+    }
+    int blocks = 0;
+    for (ArenaBlock* b = map->arena->blocks; b; b = b->next) blocks++;
+    if (blocks > 3) { FAIL("arena grew across clears"); hashmap_free(map); return; }
+
+    hashmap_free(map);
+    PASS();
+}
+
 int main(void) {
     printf("Running HashMap Unit Tests...\n\n");
 
@@ -308,6 +340,7 @@ int main(void) {
     test_hashmap_null_inputs();
     test_hashmap_many_entries();
     test_hashmap_clear();
+    test_hashmap_arena();
 
     printf("\n========================================\n");
     printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
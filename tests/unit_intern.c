@@ -0,0 +1,119 @@
+// Unit tests for symbol interning
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static void test_same_spelling_same_value(void) {
+    TEST(same_spelling_same_value);
+
+    Value* a = mk_sym("lambda");
+    Value* b = mk_sym("lambda");
+    if (a != b) { FAIL("expected identical pointers"); return; }
+    if (!sym_eq(a, b)) { FAIL("sym_eq on identical symbols"); return; }
+    if (sym_eq(a, mk_sym("lambdas"))) { FAIL("distinct spellings compared equal"); return; }
+
+    PASS();
+}
+
+static void test_len_variant(void) {
+    TEST(len_variant);
+
+    const char* src = "foobar baz";
+    Value* a = mk_sym_len(src, 6);
+    Value* b = mk_sym("foobar");
+    Value* c = mk_sym_len(src, 3);
+    if (a != b) { FAIL("mk_sym_len did not return interned symbol"); return; }
+    if (c == a || strcmp(c->s, "foo") != 0) { FAIL("prefix should be its own symbol"); return; }
+
+    PASS();
+}
+
+static void test_arena_cycle(void) {
+    TEST(arena_cycle);
+
+    Value* outside = mk_sym("persistent");
+
+    compiler_arena_init();
+    Value* inside = mk_sym("transient");
+    if (mk_sym("persistent") != outside) { FAIL("malloc'd symbol not reused in arena"); compiler_arena_cleanup(); return; }
+    if (mk_sym("transient") != inside) { FAIL("arena symbol not interned"); compiler_arena_cleanup(); return; }
+    compiler_arena_cleanup();
+
+    // After cleanup the arena symbol must be re-created, not dangling
+    compiler_arena_init();
+    Value* again = mk_sym("transient");
+    if (!again || strcmp(again->s, "transient") != 0) { FAIL("re-interned symbol broken"); compiler_arena_cleanup(); return; }
+    if (mk_sym("persistent") != outside) { FAIL("malloc'd symbol lost across cleanup"); compiler_arena_cleanup(); return; }
+    compiler_arena_cleanup();
+
+    PASS();
+}
+
+static void test_form_scopes(void) {
+    TEST(form_scopes);
+
+    compiler_arena_init();
+    Value* base = mk_sym("base_sym");
+
+    // Released scope: its symbols leave the table with it
+    if (!compiler_arena_push()) { FAIL("push"); compiler_arena_cleanup(); return; }
+    Value* released = mk_sym("form_sym");
+    if (mk_sym("base_sym") != base) { FAIL("outer symbol not visible in scope"); compiler_arena_cleanup(); return; }
+    if (mk_sym("form_sym") != released) { FAIL("scope symbol not interned"); compiler_arena_cleanup(); return; }
+    compiler_arena_pop(0);
+    Value* again = mk_sym("form_sym");
+    if (!again || strcmp(again->s, "form_sym") != 0) { FAIL("symbol from released scope broken"); compiler_arena_cleanup(); return; }
+
+    // Kept scope: symbols and values live on in the parent
+    if (!compiler_arena_push()) { FAIL("push"); compiler_arena_cleanup(); return; }
+    Value* kept = mk_sym("kept_sym");
+    Value* cell = mk_cell(kept, NULL);
+    compiler_arena_pop(1);
+    if (mk_sym("kept_sym") != kept || car(cell) != kept) { FAIL("kept scope lost its symbol"); compiler_arena_cleanup(); return; }
+    if (compiler_arena_depth() != 1) { FAIL("depth after pops"); compiler_arena_cleanup(); return; }
+    compiler_arena_cleanup();
+    if (compiler_arena_depth() != 0) { FAIL("cleanup left scopes open"); return; }
+
+    PASS();
+}
+
+static void test_many_symbols(void) {
+    TEST(many_symbols);
+
+    char buf[32];
+    Value* first[1000];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "s%d", i);
+        first[i] = mk_sym(buf);
+    }
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "s%d", i);
+        if (mk_sym(buf) != first[i]) { FAIL("lookup failed after table growth"); return; }
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Symbol Interning Unit Tests...\n");
+    test_same_spelling_same_value();
+    test_len_variant();
+    test_arena_cycle();
+    test_form_scopes();
+    test_many_symbols();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
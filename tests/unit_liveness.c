@@ -0,0 +1,207 @@
+// Unit tests for liveness.c - CFG liveness and NLL free points
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/analysis/liveness.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static CFG* build_src(const char* src) {
+    set_parse_input(src);
+    CFG* cfg = cfg_build(parse());
+    if (cfg && !compute_liveness(cfg)) {
+        free_cfg(cfg);
+        return NULL;
+    }
+    return cfg;
+}
+
+static const char* node_str(CFGNode* n, char* buf, size_t size) {
+    char* s = n->expr ? val_to_str(n->expr) : NULL;
+    snprintf(buf, size, "%s", s ? s : "");
+    free(s);
+    return buf;
+}
+
+static int count_points(FreePoint* fp) {
+    int n = 0;
+    for (; fp; fp = fp->next) n++;
+    return n;
+}
+
+// The single unconditional free point of var is at the node printing as `at`
+static int frees_at(CFG* cfg, const char* var, const char* at) {
+    FreePoint* fp = find_free_points(cfg, var);
+    char buf[256];
+    int ok = count_points(fp) == 1 && !fp->is_conditional &&
+             strcmp(node_str(cfg->nodes[fp->node_id], buf, sizeof(buf)), at) == 0;
+    if (!ok && fp) printf("[%s freed at %s] ", var, node_str(cfg->nodes[fp->node_id], buf, sizeof(buf)));
+    free_free_points(fp);
+    return ok;
+}
+
+// Reference: the whole-CFG fixpoint the worklist replaces
+static int matches_round_robin(CFG* cfg) {
+    int words = cfg->words;
+    uint64_t* in = calloc((size_t)cfg->node_count * words, sizeof(uint64_t));
+    uint64_t* out = calloc(words, sizeof(uint64_t));
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = cfg->node_count - 1; i >= 0; i--) {
+            CFGNode* node = cfg->nodes[i];
+            memset(out, 0, words * sizeof(uint64_t));
+            for (int j = 0; j < node->succ_count; j++) {
+                for (int w = 0; w < words; w++) out[w] |= in[(size_t)node->succs[j]->id * words + w];
+            }
+            if (node->def >= 0) out[node->def / 64] &= ~(1ULL << (node->def % 64));
+            for (int j = 0; j < node->use_count; j++) out[node->uses[j] / 64] |= 1ULL << (node->uses[j] % 64);
+            if (memcmp(out, &in[(size_t)i * words], words * sizeof(uint64_t)) != 0) {
+                memcpy(&in[(size_t)i * words], out, words * sizeof(uint64_t));
+                changed = 1;
+            }
+        }
+    }
+    int ok = 1;
+    for (int i = 0; i < cfg->node_count && ok; i++) {
+        ok = memcmp(cfg->nodes[i]->live_in, &in[(size_t)i * words], words * sizeof(uint64_t)) == 0;
+    }
+    free(in);
+    free(out);
+    return ok;
+}
+
+static void test_straight_line(void) {
+    TEST(straight_line);
+
+    CFG* cfg = build_src("(let ((a (cons 1 2))) (let ((b (f a))) (g b)))");
+    if (!cfg) { FAIL("no CFG"); return; }
+    if (!frees_at(cfg, "a", "(f a)")) { FAIL("a not freed after its last use"); free_cfg(cfg); return; }
+    if (!frees_at(cfg, "b", "(g b)")) { FAIL("b not freed after its last use"); free_cfg(cfg); return; }
+    if (is_live_in(cfg, cfg->exit, "a") || !is_live_out(cfg, cfg->entry, "f")) { FAIL("wrong live sets"); free_cfg(cfg); return; }
+    free_cfg(cfg);
+
+    PASS();
+}
+
+static void test_branches(void) {
+    TEST(branches);
+
+    // a dies on the else edge of the test, and after (f a) on the other
+    CFG* cfg = build_src("(let ((a (lift 1))) (if c (f a) (g 1)))");
+    if (!cfg) { FAIL("no CFG"); return; }
+    FreePoint* fp = find_free_points(cfg, "a");
+    int conditional = 0, unconditional = 0;
+    char buf[256];
+    for (FreePoint* p = fp; p; p = p->next) {
+        const char* at = node_str(cfg->nodes[p->node_id], buf, sizeof(buf));
+        if (p->is_conditional && strcmp(at, "c") == 0) conditional++;
+        if (!p->is_conditional && strcmp(at, "(f a)") == 0) unconditional++;
+    }
+    int n = count_points(fp);
+    free_free_points(fp);
+    free_cfg(cfg);
+    if (n != 2 || conditional != 1 || unconditional != 1) { FAIL("wrong free points"); return; }
+
+    PASS();
+}
+
+static void test_shadowing_and_capture(void) {
+    TEST(shadowing_and_capture);
+
+    // The inner a must not end the outer one's lifetime
+    CFG* cfg = build_src("(let ((a (lift 1))) (f (let ((a 2)) a) a))");
+    if (!cfg) { FAIL("no CFG"); return; }
+    int ok = frees_at(cfg, "a", "(f (let ((a 2)) a) a)");
+    free_cfg(cfg);
+    if (!ok) { FAIL("outer binding killed by the inner one"); return; }
+
+    // Captured by a closure: live until the closure is built
+    cfg = build_src("(let ((a (lift 1))) (let ((k (lambda () a))) (k)))");
+    if (!cfg) { FAIL("no CFG"); return; }
+    ok = frees_at(cfg, "a", "(lambda () a)") && frees_at(cfg, "k", "(k)");
+    free_cfg(cfg);
+    if (!ok) { FAIL("capture not counted as a use"); return; }
+
+    // letrec names are bound before their values capture them
+    cfg = build_src("(letrec ((loop (lambda (n) (loop n)))) (loop 1))");
+    if (!cfg) { FAIL("no CFG"); return; }
+    ok = is_live_in(cfg, cfg->nodes[cfg->node_count - 1], "loop") && frees_at(cfg, "loop", "(loop 1)");
+    free_cfg(cfg);
+    if (!ok) { FAIL("letrec binding"); return; }
+
+    PASS();
+}
+
+static void test_matches_fixpoint(void) {
+    TEST(matches_fixpoint);
+
+    static const char* corpus[] = {
+        "(let ((a (cons x y)) (b a)) (if b (cons a b) (f a)))",
+        "(let ((x (lift 1))) (do (set! x (f x)) (if x (g x) (h y))))",
+        "(letrec ((a (lambda () b)) (b (lambda () a))) (if (a) (b) (a)))",
+        "(let ((p (if q (cons 1 2) (cons 3 4)))) (if p (if r p 0) (quote p)))",
+    };
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        CFG* cfg = build_src(corpus[i]);
+        if (!cfg) { FAIL("no CFG"); return; }
+        int ok = matches_round_robin(cfg);
+        free_cfg(cfg);
+        if (!ok) { printf("[%s] ", corpus[i]); FAIL("worklist result differs"); return; }
+    }
+
+    PASS();
+}
+
+static void test_large_function(void) {
+    TEST(large_function);
+
+    // A chain of 3000 bindings, each used once by the next, with a branch
+    // per binding: every node is visited a bounded number of times
+    enum { N = 3000 };
+    char* src = malloc(N * 64 + 64);
+    char* p = src;
+    for (int i = 0; i < N; i++) p += sprintf(p, "(let ((v%d (if c (f v%d) (g v%d)))) ", i + 1, i, i);
+    p += sprintf(p, "v%d", N);
+    for (int i = 0; i < N; i++) *p++ = ')';
+    *p = '\0';
+    CFG* cfg = build_src(src);
+    free(src);
+    if (!cfg) { FAIL("no CFG"); return; }
+
+    int ok = cfg->var_count >= N && cfg->visits <= 2 * cfg->node_count;
+    if (!ok) printf("[%d visits for %d nodes] ", cfg->visits, cfg->node_count);
+    // v1 is read on both branches of the next binding
+    FreePoint* fp = find_free_points(cfg, "v1");
+    ok = ok && count_points(fp) == 2;
+    free_free_points(fp);
+    free_cfg(cfg);
+    if (!ok) { FAIL("not linear"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Liveness Unit Tests...\n");
+    init_syms();
+
+    test_straight_line();
+    test_branches();
+    test_shadowing_and_capture();
+    test_matches_fixpoint();
+    test_large_function();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
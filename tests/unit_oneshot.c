@@ -0,0 +1,133 @@
+// Unit tests for oneshot.c - escape-only continuations
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/analysis/oneshot.h"
+#include "../src/eval/eval.h"
+#include "../src/eval/vm.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* root_menv = NULL;
+
+static Value* parse_str(const char* src) {
+    set_parse_input(src);
+    return parse();
+}
+
+static void test_analysis(void) {
+    TEST(analysis);
+
+    static const struct { const char* proc; int escape_only; } cases[] = {
+        { "(lambda (k) 1)", 1 },
+        { "(lambda (k) (k 5))", 1 },
+        { "(lambda (k) (if (f x) (k 1) (g 2)))", 1 },
+        { "(lambda (k) (do (f x) (let ((y (g x))) (and y (k y)))))", 1 },
+        { "(lambda (k) (letrec ((loop (lambda (i) (if (f i) (k i) (loop (+ i 1)))))) (loop 0)))", 1 },
+        { "(lambda (k) (letrec ((a (lambda (i) (b i))) (b (lambda (i) (k i)))) (a 0)))", 1 },
+        { "(lambda (k) (let ((k 1)) (f k)))", 1 },
+        { "(lambda (k) (letrec ((h (lambda (i) (* i 2)))) (+ (h 1) (k 2))))", 0 },
+        { "(lambda (k) (+ 1 (k 7)))", 0 },
+        { "(lambda (k) (f k))", 0 },
+        { "(lambda (k) (k (k 1)))", 0 },
+        { "(lambda (k) (set! g k))", 0 },
+        { "(lambda (k) (map (lambda (x) (k x)) xs))", 0 },
+        { "(lambda (k) (letrec ((loop (lambda (i) (if (f i) (k i) (loop (+ i 1)))))) (+ 1 (loop 0))))", 0 },
+        { "(lambda (k) (letrec ((loop (lambda (i) (k i)))) (f loop)))", 0 },
+        { "(lambda (k j) (k 1))", 0 },
+        { "(lambda k (k 1))", 0 },
+        { "f", 0 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (cont_escape_only(parse_str(cases[i].proc)) != cases[i].escape_only) {
+            printf("[%s] ", cases[i].proc);
+            FAIL("wrong verdict");
+            return;
+        }
+    }
+
+    PASS();
+}
+
+// The same result from the VM and the tree-walker
+static int runs_to(const char* src, const char* expected) {
+    Value* results[2] = { vm_eval(parse_str(src), root_menv), eval(parse_str(src), root_menv) };
+    for (int i = 0; i < 2; i++) {
+        char* s = val_to_str(results[i]);
+        int ok = s && strcmp(s, expected) == 0;
+        if (!ok) printf("[%s => %s in the %s] ", src, s ? s : "(null)", i ? "evaluator" : "VM");
+        free(s);
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+static void test_escapes(void) {
+    TEST(escapes);
+
+    // Early exit from a loop, also run where the call/cc is not in tail position
+    if (!runs_to("(call/cc (lambda (k) (letrec ((loop (lambda (i) (if (= i 10) (k i) (loop (+ i 1)))))) (loop 0))))", "10") ||
+        !runs_to("(+ 1 (call/cc (lambda (k) (letrec ((loop (lambda (i) (if (= i 3) (k (* i 2)) (loop (+ i 1)))))) (loop 0)))))", "7")) {
+        FAIL("loop exit");
+        return;
+    }
+    if (!runs_to("(letrec ((f (lambda (n acc) (if (= n 0) acc (f (- n 1) (+ acc (call/cc (lambda (k) (if (= n 2) (k 100) n))))))))) (f 4 0))", "108")) {
+        FAIL("call/cc in a loop");
+        return;
+    }
+    // Under a call: the general continuation unwinds it
+    if (!runs_to("(+ 1 (call/cc (lambda (k) (+ 1 (k 7)))))", "8")) { FAIL("non-tail escape"); return; }
+    // An outer k called from a nested call/cc
+    if (!runs_to("(call/cc (lambda (k) (+ 1 (call/cc (lambda (j) (+ 1 (k 42)))))))", "42")) { FAIL("outer escape"); return; }
+
+    PASS();
+}
+
+static void test_deep_prompts(void) {
+    TEST(deep_prompts);
+
+    // control returns to the innermost prompt however deep it is
+    enum { DEPTH = 200 };
+    char* src = malloc(DEPTH * 16 + 64);
+    if (!src) { FAIL("out of memory"); return; }
+    char* p = src;
+    for (int i = 0; i < DEPTH; i++) p += sprintf(p, "(+ 1 (prompt ");
+    p += sprintf(p, "(+ 1 (control k 7))");
+    for (int i = 0; i < DEPTH; i++) p += sprintf(p, "))");
+    char expected[16];
+    snprintf(expected, sizeof(expected), "%d", 7 + DEPTH);
+    int ok = runs_to(src, expected);
+    free(src);
+    if (!ok) { FAIL("wrong prompt"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running One-Shot Continuation Unit Tests...\n");
+    init_syms();
+    Value* env = NIL;
+    env = env_extend(env, mk_sym("t"), SYM_T);
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("-"), mk_prim2(prim_sub, prim_sub2));
+    env = env_extend(env, mk_sym("*"), mk_prim2(prim_mul, prim_mul2));
+    env = env_extend(env, mk_sym("="), mk_prim2(prim_eq, prim_eq2));
+    root_menv = mk_menv(NIL, env);
+
+    test_analysis();
+    test_escapes();
+    test_deep_prompts();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
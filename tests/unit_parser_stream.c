@@ -0,0 +1,177 @@
+// Unit tests for the reentrant, chunk-fed parser
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static int prints_as(Value* v, const char* expected) {
+    char* s = val_to_str(v);
+    int ok = s && strcmp(s, expected) == 0;
+    if (!ok) printf("[got %s] ", s ? s : "(null)");
+    free(s);
+    return ok;
+}
+
+static void test_form_per_closing_paren(void) {
+    TEST(form_per_closing_paren);
+
+    Parser p;
+    parser_init(&p);
+    const char* input = "(+ 1 (* 2 3)) (car '(a b))";
+    const char* expected[] = { "(+ 1 (* 2 3))", "(car (quote (a b)))" };
+    int got = 0;
+    Value* v = NULL;
+
+    // One byte at a time: a form is ready exactly when its ')' arrives
+    for (size_t i = 0; input[i]; i++) {
+        parser_feed(&p, &input[i], 1);
+        ParseStatus st = parser_next(&p, &v);
+        if (st == PARSE_FORM) {
+            if (got >= 2 || !prints_as(v, expected[got])) { FAIL("wrong form"); parser_destroy(&p); return; }
+            if (input[i] != ')') { FAIL("form completed before its closing paren"); parser_destroy(&p); return; }
+            got++;
+        } else if (st != PARSE_NEED_MORE) {
+            FAIL("unexpected status"); parser_destroy(&p); return;
+        }
+    }
+    parser_finish(&p);
+    if (got != 2 || parser_next(&p, &v) != PARSE_EOF) { FAIL("expected two forms then EOF"); parser_destroy(&p); return; }
+    parser_destroy(&p);
+
+    PASS();
+}
+
+static void test_split_atoms_and_comments(void) {
+    TEST(split_atoms_and_comments);
+
+    Parser* p = parser_new();
+    Value* v = NULL;
+    parser_feed(p, "; a comment ( that", 18);
+    if (parser_next(p, &v) != PARSE_NEED_MORE) { FAIL("comment produced a form"); parser_free(p); return; }
+    parser_feed(p, " spans chunks\n(foo 12", 21);
+    if (parser_next(p, &v) != PARSE_NEED_MORE) { FAIL("open list produced a form"); parser_free(p); return; }
+    parser_feed(p, "34 bar)", 7);
+    if (parser_next(p, &v) != PARSE_FORM || !prints_as(v, "(foo 1234 bar)")) { FAIL("split integer"); parser_free(p); return; }
+
+    // A top-level atom is only complete once its delimiter (or EOF) arrives
+    parser_feed(p, "sym", 3);
+    if (parser_next(p, &v) != PARSE_NEED_MORE) { FAIL("atom completed early"); parser_free(p); return; }
+    parser_feed(p, "bol", 3);
+    parser_finish(p);
+    if (parser_next(p, &v) != PARSE_FORM || !prints_as(v, "symbol")) { FAIL("atom at EOF"); parser_free(p); return; }
+    parser_free(p);
+
+    PASS();
+}
+
+static void test_truncated_input(void) {
+    TEST(truncated_input);
+
+    Parser p;
+    parser_init(&p);
+    Value* v = NULL;
+    parser_feed(&p, "(a (b", 5);
+    parser_finish(&p);
+    if (parser_next(&p, &v) != PARSE_ERROR) { FAIL("unclosed list accepted"); parser_destroy(&p); return; }
+    if (parser_next(&p, &v) != PARSE_EOF) { FAIL("state not reset after error"); parser_destroy(&p); return; }
+    parser_destroy(&p);
+
+    PASS();
+}
+
+static void test_independent_contexts(void) {
+    TEST(independent_contexts);
+
+    // Two parsers interleaved, plus the global one, share no state
+    Parser a, b;
+    parser_init(&a);
+    parser_init(&b);
+    Value* v = NULL;
+    set_parse_input("(global 1) (global 2)");
+    parser_feed(&a, "(a ", 3);
+    parser_feed(&b, "(b ", 3);
+    if (!prints_as(parse(), "(global 1)")) { FAIL("global parser"); return; }
+    parser_feed(&a, "1)", 2);
+    parser_feed(&b, "2)", 2);
+    if (parser_next(&b, &v) != PARSE_FORM || !prints_as(v, "(b 2)")) { FAIL("second context"); return; }
+    if (parser_next(&a, &v) != PARSE_FORM || !prints_as(v, "(a 1)")) { FAIL("first context"); return; }
+    if (!prints_as(parse(), "(global 2)")) { FAIL("global parser resumed"); return; }
+    parser_destroy(&a);
+    parser_destroy(&b);
+
+    PASS();
+}
+
+static int at(Value* form, int line, int col) {
+    SourcePos pos;
+    if (!source_pos(form, &pos)) {
+        printf("[no position] ");
+        return 0;
+    }
+    if (pos.line != line || pos.col != col) printf("[at %d:%d] ", pos.line, pos.col);
+    return pos.line == line && pos.col == col;
+}
+
+static void test_source_positions(void) {
+    TEST(source_positions);
+
+    // Fed in small chunks, so consumed input is dropped between forms
+    Parser p;
+    parser_init(&p);
+    source_positions_enable(1);
+    const char* input = "; header\n(let ((x 1))\n  (f x))\n\n  '(a)";
+    Value* forms[2] = { NULL, NULL };
+    int got = 0;
+    for (size_t i = 0, len = strlen(input); i < len; i += 3) {
+        parser_feed(&p, input + i, len - i < 3 ? len - i : 3);
+        while (got < 2 && parser_next(&p, &forms[got]) == PARSE_FORM) got++;
+    }
+    parser_finish(&p);
+    if (got < 2 && parser_next(&p, &forms[got]) == PARSE_FORM) got++;
+    if (got != 2) { FAIL("forms lost"); parser_destroy(&p); return; }
+
+    Value* let = forms[0];
+    if (!at(let, 2, 1) || !at(car(cdr(let)), 2, 6) || !at(car(car(cdr(let))), 2, 7)) {
+        FAIL("let form");
+        parser_destroy(&p);
+        return;
+    }
+    if (!at(car(cdr(cdr(let))), 3, 3)) { FAIL("next line"); parser_destroy(&p); return; }
+    // A quote sits where its ' is
+    if (!at(forms[1], 5, 3) || !at(car(cdr(forms[1])), 5, 4)) { FAIL("quote"); parser_destroy(&p); return; }
+    parser_destroy(&p);
+
+    // Off, nothing is recorded
+    source_positions_enable(0);
+    set_parse_input("(g 1)");
+    SourcePos pos;
+    if (source_pos(parse(), &pos)) { FAIL("recorded while off"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Streaming Parser Unit Tests...\n");
+    init_syms();
+    test_form_per_closing_paren();
+    test_split_atoms_and_comments();
+    test_truncated_input();
+    test_independent_contexts();
+    test_source_positions();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
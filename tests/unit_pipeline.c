@@ -0,0 +1,223 @@
+// Unit tests for pipeline.c - fused escape/shape/rcopt traversal
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/analysis/pipeline.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+// Names every context starts with, as the let compiler adds its bindings
+static const char* outer_vars[] = { "x", "y", "f", "g", "loop", "if", "quote", "letrec" };
+
+// Forms that exercise every case, including the ones where the separate
+// walks disagree about which children to visit
+static const char* corpus[] = {
+    "(+ x y)",
+    "(cons x y)",
+    "(cons x x)",
+    "(cons (cons 1 2) y)",
+    "(let ((a (cons x y)) (b a)) (cons a b))",
+    "(let ((x (lift 1)) (y x)) (f x y))",
+    "(lambda (x) (cons x y))",
+    "((lambda (a) (g a x)) y)",
+    "(letrec ((loop (lambda (n) (if n (loop y) x)))) (loop f))",
+    "(letrec ((a (cons b 1)) (b (cons a 2))) (f a b) y)",
+    "(set! x y)",
+    "(set! x (cons y y) g)",
+    "(if x (cons y 1) (lift y))",
+    "(if x y)",
+    "(quote (x y (lambda (z) x)))",
+    "(lift (cons x y))",
+    "(f (lambda (y) (set! x y)) (let ((g x)) (g g)))",
+    "(let ((a 1)) (let ((a (cons a x))) (lambda () (set! a y))))",
+    "(let (x (y 2)) x)",
+    "(g . x)",
+    "(let ((k (lambda (a b) (cons a (+ b 1))))) (let ((c (cons x 1))) (k c y)))",
+    "(let ((id (lambda (a) a))) (let ((b (id x))) (f b (id b))))",
+    "(letrec ((ev (lambda (n a) (if n (od n a) 0))) (od (lambda (n a) (ev n (cons a 1))))) (ev x y))",
+};
+
+static void setup(AnalysisContext** esc, ShapeContext** shape, RCOptContext** rc) {
+    *esc = mk_analysis_ctx();
+    *shape = mk_shape_context();
+    *rc = mk_rcopt_context();
+    for (size_t i = 0; i < sizeof(outer_vars) / sizeof(outer_vars[0]); i++) {
+        add_var(*esc, outer_vars[i]);
+        add_shape(*shape, outer_vars[i], SHAPE_TREE);
+        rcopt_define_var(*rc, outer_vars[i]);
+    }
+}
+
+static void teardown(AnalysisContext* esc, ShapeContext* shape, RCOptContext* rc) {
+    free_analysis_ctx(esc);
+    free_shape_context(shape);
+    free_rcopt_context(rc);
+}
+
+static int same_usage(AnalysisContext* a, AnalysisContext* b) {
+    VarUsage* u = a->vars;
+    VarUsage* v = b->vars;
+    for (; u && v; u = u->next, v = v->next) {
+        if (strcmp(u->name, v->name) != 0 || u->use_count != v->use_count ||
+            u->last_use_depth != v->last_use_depth || u->escape_class != v->escape_class ||
+            u->captured_by_lambda != v->captured_by_lambda) {
+            printf("[var %s differs] ", u->name);
+            return 0;
+        }
+    }
+    return !u && !v && a->current_depth == b->current_depth && a->in_lambda == b->in_lambda;
+}
+
+static int same_shapes(ShapeContext* a, ShapeContext* b) {
+    ShapeInfo* s = a->shapes;
+    ShapeInfo* t = b->shapes;
+    for (; s && t; s = s->next, t = t->next) {
+        if (strcmp(s->var_name, t->var_name) != 0 || s->shape != t->shape || s->alias_group != t->alias_group) {
+            printf("[shape %s differs] ", s->var_name);
+            return 0;
+        }
+    }
+    return !s && !t && a->result_shape == b->result_shape && a->changed == b->changed;
+}
+
+static int same_rcopt(RCOptContext* a, RCOptContext* b) {
+    RCOptInfo* s = a->vars;
+    RCOptInfo* t = b->vars;
+    for (; s && t; s = s->next, t = t->next) {
+        if (strcmp(s->var_name, t->var_name) != 0 || s->is_unique != t->is_unique ||
+            s->is_borrowed != t->is_borrowed || s->defined_at != t->defined_at ||
+            s->last_used_at != t->last_used_at || s->alias_count != t->alias_count ||
+            s->consumed_at != t->consumed_at || !s->summary != !t->summary) {
+            printf("[rcopt %s differs] ", s->var_name);
+            return 0;
+        }
+    }
+    return !s && !t && a->current_point == b->current_point && a->defined == b->defined;
+}
+
+static Value* parse_src(const char* src) {
+    set_parse_input(src);
+    return parse();
+}
+
+static void test_matches_separate_walks(void) {
+    TEST(matches_separate_walks);
+
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        Value* form = parse_src(corpus[i]);
+        AnalysisContext *e1, *e2;
+        ShapeContext *s1, *s2;
+        RCOptContext *r1, *r2;
+        setup(&e1, &s1, &r1);
+        setup(&e2, &s2, &r2);
+
+        analyze_expr(form, e1);
+        analyze_escape(form, e1, ESCAPE_NONE);
+        analyze_shapes_expr(form, s1);
+        rcopt_analyze_expr(r1, form);
+
+        AnalysisPipeline p;
+        pipeline_init(&p, e2, s2, r2);
+        pipeline_run(&p, form, ESCAPE_NONE);
+        pipeline_destroy(&p);
+
+        int ok = same_usage(e1, e2) && same_shapes(s1, s2) && same_rcopt(r1, r2);
+        teardown(e1, s1, r1);
+        teardown(e2, s2, r2);
+        if (!ok) { printf("[%s] ", corpus[i]); FAIL("fused walk differs"); return; }
+    }
+
+    PASS();
+}
+
+static void test_let_entry(void) {
+    TEST(let_entry);
+
+    // The let compiler: usage and escape of the body, shapes of the form
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        if (strncmp(corpus[i], "(let ", 5) != 0) continue;
+        Value* form = parse_src(corpus[i]);
+        Value* body = car(cdr(cdr(form)));
+        AnalysisContext *e1, *e2;
+        ShapeContext *s1, *s2;
+        RCOptContext *r1, *r2;
+        setup(&e1, &s1, &r1);
+        setup(&e2, &s2, &r2);
+
+        analyze_expr(body, e1);
+        analyze_escape(body, e1, ESCAPE_GLOBAL);
+        analyze_shapes_expr(form, s1);
+        rcopt_analyze_expr(r1, body);
+
+        AnalysisPipeline p;
+        pipeline_init(&p, e2, s2, r2);
+        pipeline_run_let(&p, form, ESCAPE_GLOBAL);
+        pipeline_destroy(&p);
+
+        int ok = same_usage(e1, e2) && same_shapes(s1, s2) && same_rcopt(r1, r2);
+        teardown(e1, s1, r1);
+        teardown(e2, s2, r2);
+        if (!ok) { printf("[%s] ", corpus[i]); FAIL("let entry differs"); return; }
+    }
+
+    PASS();
+}
+
+static void test_facts_and_free_vars(void) {
+    TEST(facts_and_free_vars);
+
+    Value* form = parse_src("(let ((a (cons 1 2))) (f (lambda (z) (cons z a)) a))");
+    Value* bind_val = car(cdr(car(car(cdr(form)))));
+    Value* call = car(cdr(cdr(form)));
+    Value* lambda = car(cdr(call));
+
+    AnalysisContext* esc;
+    ShapeContext* shape;
+    RCOptContext* rc;
+    setup(&esc, &shape, &rc);
+    AnalysisPipeline p;
+    pipeline_init(&p, esc, shape, rc);
+    if (!pipeline_keep_facts(&p)) { FAIL("keep_facts failed"); teardown(esc, shape, rc); return; }
+    pipeline_run(&p, form, ESCAPE_GLOBAL);
+
+    NodeFacts* f = pipeline_facts(&p, bind_val);
+    if (!f || !f->fresh || f->shape != SHAPE_TREE) { FAIL("binding facts"); goto done; }
+    f = pipeline_facts(&p, lambda);
+    if (!f || f->fresh || f->escape != ESCAPE_ARG || f->shape != SHAPE_TREE) { FAIL("lambda facts"); goto done; }
+    if (pipeline_facts(&p, parse_src("(never visited)"))) { FAIL("facts for an unvisited node"); goto done; }
+
+    // Computed once, then the same array (operators count as free)
+    int n = 0;
+    char** vars = pipeline_free_vars(&p, lambda, &n);
+    if (n != 2 || strcmp(vars[0], "cons") != 0 || strcmp(vars[1], "a") != 0) { FAIL("wrong free vars"); goto done; }
+    int n2 = 0;
+    if (pipeline_free_vars(&p, lambda, &n2) != vars || n2 != 2) { FAIL("free vars not cached"); goto done; }
+
+    PASS();
+done:
+    pipeline_destroy(&p);
+    teardown(esc, shape, rc);
+}
+
+int main(void) {
+    printf("Running Analysis Pipeline Unit Tests...\n");
+    init_syms();
+
+    test_matches_separate_walks();
+    test_let_entry();
+    test_facts_and_free_vars();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Unit tests for profile.c - shadow stacks and folded output
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/eval/eval.h"
+#include "../src/eval/vm.h"
+#include "../src/eval/profile.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* root_menv = NULL;
+
+// (sample!) takes a sample where it is called
+static Value* prim_sample(Value* args, Value* menv) {
+    (void)args; (void)menv;
+    profile_sample();
+    return mk_int(0);
+}
+
+// Evaluate each top-level form in the VM or the tree-walker
+static void run(const char* src, int in_vm) {
+    set_parse_input(src);
+    while (!parse_at_end()) {
+        Value* form = parse();
+        if (!form) break;
+        profile_set_root(form);
+        if (in_vm) vm_eval(form, root_menv);
+        else eval(form, root_menv);
+        profile_collect();
+    }
+}
+
+static char* folded(void) {
+    char* buf = NULL;
+    size_t len = 0;
+    FILE* f = open_memstream(&buf, &len);
+    if (!f) return NULL;
+    profile_write(f);
+    fclose(f);
+    return buf;
+}
+
+// Exactly `expected` after running setup then src in each executor
+static int profiles_as(const char* setup, const char* src, const char* expected[2]) {
+    for (int in_vm = 1; in_vm >= 0; in_vm--) {
+        profile_start(0);
+        if (setup) run(setup, in_vm);
+        run(src, in_vm);
+        char* out = folded();
+        profile_stop();
+        int ok = out && strcmp(out, expected[in_vm]) == 0;
+        if (!ok) printf("[%s in the %s: %s] ", src, in_vm ? "VM" : "evaluator", out ? out : "(null)");
+        free(out);
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+static void test_named_frames(void) {
+    TEST(named_frames);
+
+    const char* expect[2] = { "toplevel@1:1;outer;inner 1\n", "toplevel@1:1;outer;inner 1\n" };
+    if (!profiles_as("(define (inner x) (sample!)) (define (outer x) (+ 1 (inner x)))", "(outer 1)", expect)) {
+        FAIL("wrong stack");
+        return;
+    }
+    // Unnamed: where its body is
+    const char* lambda[2] = { "toplevel@1:1;lambda@1:14 1\n", "toplevel@1:1;lambda@1:14 1\n" };
+    if (!profiles_as(NULL, "((lambda (x) (+ x (sample!))) 1)", lambda)) { FAIL("unnamed lambda"); return; }
+
+    PASS();
+}
+
+static void test_tail_calls_replace(void) {
+    TEST(tail_calls_replace);
+
+    // The evaluator also names the special form it is in
+    const char* count[2] = { "toplevel@1:1;count;if@1:19 1\n", "toplevel@1:1;count 1\n" };
+    if (!profiles_as("(define (count n) (if (= n 0) (sample!) (count (- n 1))))", "(count 50)", count)) {
+        FAIL("tail calls stacked");
+        return;
+    }
+    const char* loop[2] = { "toplevel@1:1;loop;if@1:28 1\n", "toplevel@1:1;loop 1\n" };
+    if (!profiles_as(NULL, "(letrec ((loop (lambda (i) (if (= i 0) (sample!) (loop (- i 1)))))) (loop 3))", loop)) {
+        FAIL("letrec binder");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_escapes_unwind(void) {
+    TEST(escapes_unwind);
+
+    const char* expect[2] = { "toplevel@1:1 1\n", "toplevel@1:1 1\n" };
+    if (!profiles_as("(define (deep k n) (if (= n 0) (k 0) (+ 1 (deep k (- n 1)))))",
+                     "(+ (call/cc (lambda (k) (deep k 10))) (sample!))", expect)) {
+        FAIL("frames left behind");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_timer_samples(void) {
+    TEST(timer_samples);
+
+    profile_start(1000);
+    run("(define (spin n) (if (= n 0) 0 (+ 1 (spin (- n 1)))))", 1);
+    char* out = NULL;
+    for (int i = 0; i < 2000 && (!out || !*out); i++) {
+        free(out);
+        run("(spin 2000)", 1);
+        out = folded();
+    }
+    profile_stop();
+    int ok = out && strncmp(out, "toplevel@1:1;spin", 17) == 0;
+    if (!ok) printf("[%s] ", out ? out : "(null)");
+    free(out);
+    if (!ok) { FAIL("no timer samples"); return; }
+
+    PASS();
+}
+
+static void test_off_by_default(void) {
+    TEST(off_by_default);
+
+    if (profile_active) { FAIL("on without profile_start"); return; }
+    run("(sample!)", 1);
+    char* out = folded();
+    int ok = out && *out == '\0';
+    free(out);
+    if (!ok) { FAIL("sampled while off"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Profiler Unit Tests...\n");
+    init_syms();
+    source_positions_enable(1);
+    Value* env = NIL;
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("-"), mk_prim2(prim_sub, prim_sub2));
+    env = env_extend(env, mk_sym("="), mk_prim2(prim_eq, prim_eq2));
+    env = env_extend(env, mk_sym("sample!"), mk_prim(prim_sample));
+    root_menv = mk_menv(NIL, env);
+
+    test_off_by_default();
+    test_named_frames();
+    test_tail_calls_replace();
+    test_escapes_unwind();
+    test_timer_samples();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
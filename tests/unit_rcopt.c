@@ -13,6 +13,19 @@ static int tests_failed = 0;
 #define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
 #define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
 
+// Local NIL for tests (not using eval.c's global)
+static Value nil_value = { .tag = T_NIL };
+#define NIL (&nil_value)
+
+// (a b ...) from n elements
+static Value* list_of(int n, Value** items) {
+    Value* l = NIL;
+    while (n > 0) l = mk_cell(items[--n], l);
+    return l;
+}
+#define L(...) list_of(sizeof((Value*[]){ __VA_ARGS__ }) / sizeof(Value*), (Value*[]){ __VA_ARGS__ })
+#define S(name) mk_sym(name)
+
 // Test context lifecycle
 void test_context_lifecycle(void) {
     TEST(context_lifecycle);
@@ -414,9 +427,142 @@ void test_alias_capacity_overflow(void) {
     PASS();
 }
 
+// Test that scoped variables restore the names they shadowed
+void test_scopes(void) {
+    TEST(scopes);
+
+    RCOptContext* ctx = mk_rcopt_context();
+    if (!ctx) { FAIL("mk_rcopt_context returned NULL"); return; }
+
+    RCOptInfo* outer = rcopt_define_var(ctx, "x");
+    if (!rcopt_push_scope(ctx)) { FAIL("push failed"); free_rcopt_context(ctx); return; }
+    RCOptInfo* inner = rcopt_define_borrowed(ctx, "x");
+    if (rcopt_find_var(ctx, "x") != inner) { FAIL("inner x not innermost"); free_rcopt_context(ctx); return; }
+    rcopt_pop_scope(ctx);
+    if (rcopt_find_var(ctx, "x") != outer) { FAIL("outer x not restored"); free_rcopt_context(ctx); return; }
+
+    // Popped variables still count toward the stats
+    int total = 0;
+    rcopt_get_stats(ctx, &total, NULL);
+    if (total != 4) { FAIL("popped variable not counted"); free_rcopt_context(ctx); return; }
+
+    // Lambda parameters shadow only inside the body
+    Value* lam = LIST3(mk_sym("lambda"), LIST1(mk_sym("x")), mk_sym("x"));
+    rcopt_analyze_expr(ctx, lam);
+    RCOptInfo* x = rcopt_find_var(ctx, "x");
+    if (x != outer || x->is_borrowed || x->last_used_at != 0) { FAIL("parameter leaked out of lambda"); free_rcopt_context(ctx); return; }
+
+    free_rcopt_context(ctx);
+    PASS();
+}
+
+// Test per-function summaries of what a call does with its arguments
+void test_summaries(void) {
+    TEST(summaries);
+
+    RCOptContext* ctx = mk_rcopt_context();
+    if (!ctx) { FAIL("mk_rcopt_context returned NULL"); return; }
+
+    // Stores x, only reads y, returns a fresh cell
+    RCOptSummary* s = rcopt_summarize_lambda(ctx,
+        L(S("lambda"), L(S("x"), S("y")), L(S("cons"), S("x"), L(S("+"), S("y"), mk_int(1)))));
+    int ok = s && s->param_count == 2 && s->params[0] == RC_PARAM_CONSUMED &&
+             s->params[1] == RC_PARAM_BORROWED && s->returns_unique && s->returns_param == -1;
+    rcopt_free_summary(s);
+    if (!ok) { FAIL("cons summary"); free_rcopt_context(ctx); return; }
+
+    // Identity hands its argument back
+    s = rcopt_summarize_lambda(ctx, L(S("lambda"), L(S("x")), S("x")));
+    ok = s && s->params[0] == RC_PARAM_CONSUMED && !s->returns_unique && s->returns_param == 0;
+    rcopt_free_summary(s);
+    if (!ok) { FAIL("identity summary"); free_rcopt_context(ctx); return; }
+
+    // car borrows, but its result is shared
+    s = rcopt_summarize_lambda(ctx, L(S("lambda"), L(S("x")), L(S("car"), S("x"))));
+    ok = s && s->params[0] == RC_PARAM_BORROWED && !s->returns_unique;
+    rcopt_free_summary(s);
+    if (!ok) { FAIL("car summary"); free_rcopt_context(ctx); return; }
+
+    // Captured by a closure; unknown callees may keep their arguments
+    s = rcopt_summarize_lambda(ctx, L(S("lambda"), L(S("x"), S("y")),
+        L(S("f"), L(S("lambda"), NIL, S("x")), S("y"))));
+    ok = s && s->params[0] == RC_PARAM_CONSUMED && s->params[1] == RC_PARAM_CONSUMED && !s->returns_unique;
+    rcopt_free_summary(s);
+    if (!ok) { FAIL("capture summary"); free_rcopt_context(ctx); return; }
+
+    free_rcopt_context(ctx);
+    PASS();
+}
+
+// Test that summaries propagate through letrec recursion
+void test_letrec_summaries(void) {
+    TEST(letrec_summaries);
+
+    RCOptContext* ctx = mk_rcopt_context();
+    if (!ctx) { FAIL("mk_rcopt_context returned NULL"); return; }
+
+    // ev only passes a to od, which stores it: both consume a
+    Value* dec = L(S("-"), S("n"), mk_int(1));
+    Value* ev = L(S("lambda"), L(S("n"), S("a")), L(S("if"), S("n"), L(S("od"), dec, S("a")), mk_int(0)));
+    Value* od = L(S("lambda"), L(S("n"), S("a")),
+                  L(S("if"), S("n"), L(S("ev"), dec, S("a")), L(S("cons"), S("a"), mk_int(1))));
+    rcopt_analyze_expr(ctx, L(S("letrec"), L(L(S("ev"), ev), L(S("od"), od)), L(S("ev"), mk_int(3), NIL)));
+
+    RCOptSummary* e = rcopt_find_summary(ctx, "ev");
+    RCOptSummary* o = rcopt_find_summary(ctx, "od");
+    if (!e || !o) { FAIL("no summaries"); free_rcopt_context(ctx); return; }
+    if (e->params[0] != RC_PARAM_BORROWED || e->params[1] != RC_PARAM_CONSUMED ||
+        o->params[0] != RC_PARAM_BORROWED || o->params[1] != RC_PARAM_CONSUMED) {
+        FAIL("consumption not propagated"); free_rcopt_context(ctx); return;
+    }
+    if (!e->returns_unique || !o->returns_unique) { FAIL("results should be unique"); free_rcopt_context(ctx); return; }
+
+    free_rcopt_context(ctx);
+    PASS();
+}
+
+// Test RC decisions across calls to summarized functions
+void test_call_boundaries(void) {
+    TEST(call_boundaries);
+
+    RCOptContext* ctx = mk_rcopt_context();
+    if (!ctx) { FAIL("mk_rcopt_context returned NULL"); return; }
+    Value* pair = L(S("cons"), mk_int(1), mk_int(2));
+    Value* borrow = L(S("lambda"), L(S("x")), L(S("car"), S("x")));
+    Value* keep = L(S("lambda"), L(S("x")), L(S("cons"), S("x"), mk_int(1)));
+    Value* id = L(S("lambda"), L(S("x")), S("x"));
+
+    // Lent to a borrowing callee: no inc for the call, caller frees directly
+    rcopt_analyze_expr(ctx, L(S("let"), L(L(S("f"), borrow), L(S("a"), pair)), L(S("f"), S("a"))));
+    if (rcopt_get_call_arg(ctx, "f", 0) != RC_OPT_ELIDE_INC) { FAIL("borrowed argument needs inc"); free_rcopt_context(ctx); return; }
+    if (rcopt_get_dec_ref(ctx, "a") != RC_OPT_DIRECT_FREE) { FAIL("lent value not freed directly"); free_rcopt_context(ctx); return; }
+
+    // Moved into a consuming callee at its last use: no RC at all
+    rcopt_analyze_expr(ctx, L(S("let"), L(L(S("g"), keep), L(S("b"), pair)), L(S("g"), S("b"))));
+    if (rcopt_get_call_arg(ctx, "g", 0) != RC_OPT_NONE) { FAIL("consumed argument elided"); free_rcopt_context(ctx); return; }
+    if (rcopt_get_inc_ref(ctx, "b") != RC_OPT_ELIDE_ALL || rcopt_get_dec_ref(ctx, "b") != RC_OPT_ELIDE_ALL) {
+        FAIL("moved value not elided"); free_rcopt_context(ctx); return;
+    }
+
+    // Used again after the move: shared with the callee from then on
+    rcopt_analyze_expr(ctx, L(S("let"), L(L(S("c"), pair)), L(S("h"), L(S("g"), S("c")), S("c"))));
+    if (rcopt_get_dec_ref(ctx, "c") != RC_OPT_NONE) { FAIL("shared value freed directly"); free_rcopt_context(ctx); return; }
+
+    // A call returning its argument makes an alias
+    rcopt_analyze_expr(ctx, L(S("let"), L(L(S("id"), id), L(S("d"), pair), L(S("e"), L(S("id"), S("d")))), S("e")));
+    RCOptInfo* e = rcopt_find_var(ctx, "e");
+    if (!e || !e->alias_of || strcmp(e->alias_of, "d") != 0) { FAIL("returned argument not an alias"); free_rcopt_context(ctx); return; }
+
+    free_rcopt_context(ctx);
+    PASS();
+}
+
 int main(void) {
     printf("Running RC Optimization Unit Tests...\n\n");
 
+    // Initialize types system for mk_* functions
+    compiler_arena_init();
+
     test_context_lifecycle();
     test_define_var();
     test_find_var();
@@ -434,7 +580,12 @@ int main(void) {
     test_rcopt_string();
     test_null_handling();
     test_alias_capacity_overflow();
+    test_scopes();
+    test_summaries();
+    test_letrec_summaries();
+    test_call_boundaries();
 
     printf("\n%d tests passed, %d tests failed\n", tests_passed, tests_failed);
+    compiler_arena_cleanup();
     return tests_failed > 0 ? 1 : 0;
 }
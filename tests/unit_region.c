@@ -204,6 +204,194 @@ static void test_can_reference(void) {
     PASS();
 }
 
+static int destroyed = 0;
+static void count_destroy(void* data) {
+    destroyed++;
+    free(data);
+}
+
+/* Test that exit invalidates objects and refs into the region */
+static void test_exit_invalidates(void) {
+    TEST("exit_invalidates");
+
+    RegionContext* ctx = region_context_new();
+    if (!ctx) {
+        FAIL("Failed to create context");
+        return;
+    }
+
+    region_enter(ctx);
+    RegionObj* outer = region_alloc(ctx, NULL, NULL);
+    region_enter(ctx);
+    RegionObj* inner = region_alloc(ctx, malloc(sizeof(int)), count_destroy);
+    RegionRef* ref = NULL;
+    if (region_create_ref(ctx, inner, outer, &ref) != REGION_OK || !region_ref_is_valid(ref)) {
+        region_context_free(ctx);
+        FAIL("Inner to outer reference should be valid");
+        return;
+    }
+
+    /* Exiting the inner region runs its destructors, once */
+    destroyed = 0;
+    region_exit(ctx);
+    if (destroyed != 1 || region_can_reference(inner, outer)) {
+        region_context_free(ctx);
+        FAIL("Inner object still live after exit");
+        return;
+    }
+
+    /* A ref into a region goes stale when that region exits */
+    region_enter(ctx);
+    RegionObj* next = region_alloc(ctx, NULL, NULL);
+    RegionRef* ref2 = NULL;
+    region_create_ref(ctx, next, outer, &ref2);
+    region_exit(ctx);
+    region_exit(ctx);
+    RegionError err = REGION_OK;
+    if (region_ref_is_valid(ref2) || region_ref_deref(ref2, &err) != NULL || err != REGION_ERR_CLOSED) {
+        region_context_free(ctx);
+        FAIL("Reference into exited region still valid");
+        return;
+    }
+
+    region_context_free(ctx);
+    if (destroyed != 1) {
+        FAIL("Destructor ran twice");
+        return;
+    }
+    PASS();
+}
+
+/* Test that a region per request reuses its Region */
+static void test_region_recycled(void) {
+    TEST("region_recycled");
+
+    RegionContext* ctx = region_context_new();
+    if (!ctx) {
+        FAIL("Failed to create context");
+        return;
+    }
+
+    Region* first = NULL;
+    uint64_t last_epoch = 0;
+    for (int request = 0; request < 50; request++) {
+        Region* r = region_enter(ctx);
+        if (!first) first = r;
+        for (int i = 0; i < 10000; i++) region_alloc(ctx, NULL, NULL);
+        if (region_get_object_count(r) != 10000) {
+            region_context_free(ctx);
+            FAIL("Wrong object count");
+            return;
+        }
+        if (r != first || r->epoch == last_epoch) {
+            region_context_free(ctx);
+            FAIL("Region not reused under a new epoch");
+            return;
+        }
+        last_epoch = r->epoch;
+        region_exit(ctx);
+    }
+
+    region_context_free(ctx);
+    PASS();
+}
+
+/* Test that handles from an earlier use of a recycled region stay dead */
+static void test_stale_after_reuse(void) {
+    TEST("stale_after_reuse");
+
+    RegionContext* ctx = region_context_new();
+    if (!ctx) {
+        FAIL("Failed to create context");
+        return;
+    }
+
+    RegionObj* outer = region_alloc(ctx, NULL, NULL);
+    Region* first = region_enter(ctx);
+    RegionObj* stale = region_alloc(ctx, NULL, NULL);
+    RegionRef* stale_ref = NULL;
+    region_create_ref(ctx, stale, outer, &stale_ref);
+    region_enter(ctx);
+    RegionObj* deep = region_alloc(ctx, NULL, NULL);
+    RegionRef* into = NULL;
+    region_create_ref(ctx, deep, stale, &into);
+    region_exit(ctx);
+    region_exit(ctx);
+
+    /* Same Region, a new object where the old ones may have been */
+    Region* again = region_enter(ctx);
+    RegionObj* fresh = region_alloc(ctx, NULL, NULL);
+    if (again != first || !fresh || fresh == stale) {
+        region_context_free(ctx);
+        FAIL("Region not reused, or its old object's memory was");
+        return;
+    }
+
+    RegionRef* ref = NULL;
+    RegionError err = REGION_OK;
+    if (region_can_reference(stale, outer) || region_create_ref(ctx, stale, outer, &ref) != REGION_ERR_CLOSED) {
+        region_context_free(ctx);
+        FAIL("Stale object accepted");
+        return;
+    }
+    /* Refs go stale with their target's region, as before reuse */
+    if (!region_ref_is_valid(stale_ref) || region_ref_is_valid(into) ||
+        region_ref_deref(into, &err) != NULL || err != REGION_ERR_CLOSED) {
+        region_context_free(ctx);
+        FAIL("Ref into the earlier use still valid");
+        return;
+    }
+    if (!region_can_reference(fresh, outer)) {
+        region_context_free(ctx);
+        FAIL("New object rejected");
+        return;
+    }
+
+    region_context_free(ctx);
+    PASS();
+}
+
+/* Test ancestry across deep nesting and sibling regions */
+static void test_ancestry(void) {
+    TEST("ancestry");
+
+    RegionContext* ctx = region_context_new();
+    if (!ctx) {
+        FAIL("Failed to create context");
+        return;
+    }
+
+    Region* outer = region_enter(ctx);
+    RegionObj* outer_obj = region_alloc(ctx, NULL, NULL);
+    Region* deepest = NULL;
+    for (int i = 0; i < 10000; i++) deepest = region_enter(ctx);
+    RegionObj* deep_obj = region_alloc(ctx, NULL, NULL);
+    if (!region_is_ancestor(ctx->root, deepest) || !region_is_ancestor(outer, deepest) ||
+        region_is_ancestor(deepest, outer) || !region_is_ancestor(deepest, deepest)) {
+        region_context_free(ctx);
+        FAIL("Wrong ancestry in a deep chain");
+        return;
+    }
+    if (!region_can_reference(deep_obj, outer_obj)) {
+        region_context_free(ctx);
+        FAIL("Deep object should reference outer");
+        return;
+    }
+    for (int i = 0; i < 10000; i++) region_exit(ctx);
+
+    /* Siblings at the same depth do not enclose each other */
+    Region* sibling = region_enter(ctx);
+    if (region_is_ancestor(deepest, sibling) || region_is_ancestor(sibling, deepest) ||
+        !region_is_ancestor(outer, sibling)) {
+        region_context_free(ctx);
+        FAIL("Siblings treated as ancestors");
+        return;
+    }
+
+    region_context_free(ctx);
+    PASS();
+}
+
 int main(void) {
     printf("Running Region Unit Tests...\n\n");
 
@@ -212,6 +400,10 @@ int main(void) {
     test_region_alloc();
     test_scope_violation();
     test_can_reference();
+    test_exit_invalidates();
+    test_region_recycled();
+    test_stale_after_reuse();
+    test_ancestry();
 
     printf("\n%d tests passed, %d tests failed\n", tests_passed, tests_failed);
     return tests_failed > 0 ? 1 : 0;
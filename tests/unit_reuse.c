@@ -0,0 +1,102 @@
+// Unit tests for reuse.c - FBIP in-place reuse matching
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/analysis/reuse.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static int match_src(const char* src, ReuseMatch* m) {
+    set_parse_input(src);
+    return find_inplace_reuse(parse(), m);
+}
+
+static int is_match(const char* src, ReuseField ka, ReuseField kb, int ra, int rb) {
+    ReuseMatch m;
+    if (!match_src(src, &m)) return 0;
+    return strcmp(m.var->s, "x") == 0 && m.kind[0] == ka && m.kind[1] == kb &&
+           m.release[0] == ra && m.release[1] == rb;
+}
+
+static void test_keep_and_fresh(void) {
+    TEST(keep_and_fresh);
+
+    // New car, old cdr kept: only the old car is dropped
+    if (!is_match("(let ((x (cons a b))) (cons (+ (car x) 1) (cdr x)))", REUSE_FRESH, REUSE_KEEP, 1, 0)) {
+        FAIL("fresh car"); return;
+    }
+    if (!is_match("(let ((x (cons a b))) (cons 0 7))", REUSE_FRESH, REUSE_FRESH, 1, 1)) {
+        FAIL("both fresh"); return;
+    }
+    if (!is_match("(let ((x (cons a b))) (cons (car x) (cdr x)))", REUSE_KEEP, REUSE_KEEP, 0, 0)) {
+        FAIL("identity"); return;
+    }
+
+    PASS();
+}
+
+static void test_swap(void) {
+    TEST(swap);
+
+    // Both children move: neither is released
+    if (!is_match("(let ((x (cons a b))) (cons (cdr x) (car x)))", REUSE_SWAP, REUSE_SWAP, 0, 0)) {
+        FAIL("swap"); return;
+    }
+    // The old car moves to the cdr, the old cdr is dropped
+    if (!is_match("(let ((x (cons a b))) (cons 1 (car x)))", REUSE_FRESH, REUSE_SWAP, 0, 1)) {
+        FAIL("half swap"); return;
+    }
+
+    PASS();
+}
+
+static void test_rejects(void) {
+    TEST(rejects);
+
+    ReuseMatch m;
+    static const char* corpus[] = {
+        "(let ((x (cons a b))) (cons (car x) (car x)))",        // one child in both fields
+        "(let ((x (cons a b))) (cons (car x) (f (cdr x))))",    // f's result may share
+        "(let ((x (cons a b))) (cons x 1))",                    // x itself is stored
+        "(let ((x (cons a b))) (cons (+ x 1) 2))",              // x read whole
+        "(let ((x (f a))) (cons (car x) 1))",                   // not a cell this let made
+        "(let ((x (cons a b)) (y x)) (cons 1 (cdr x)))",        // aliased by a binding
+        "(let ((x (cons a b)) (y (car x))) (cons 1 (cdr x)))",  // child shared by a binding
+        "(let ((x (cons a b)) (car cdr)) (cons (car x) 1))",    // accessors rebound
+        "(let ((x (cons a b))) (f (car x) (cdr x)))",           // body is not a cons
+        "(let ((x (cons a b))) (cons 1 2 3))",
+    };
+    for (size_t i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        if (match_src(corpus[i], &m)) { printf("[%s] ", corpus[i]); FAIL("reused"); return; }
+    }
+
+    // The first binding that qualifies wins
+    if (!match_src("(let ((y (f a)) (x (cons a b))) (cons (car x) 3))", &m) || strcmp(m.var->s, "x") != 0) {
+        FAIL("later binding not found"); return;
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Reuse Unit Tests...\n");
+    init_syms();
+
+    test_keep_and_fresh();
+    test_swap();
+    test_rejects();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
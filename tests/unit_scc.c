@@ -422,6 +422,89 @@ void test_release_scc_frees_members(void) {
     PASS();
 }
 
+// Test freezing a layer on top of a frozen SCC: the base is not revisited
+void test_scc_incremental_freeze(void) {
+    TEST(scc_incremental_freeze);
+
+    SCCRegistry* reg = mk_scc_registry();
+    if (!reg) { FAIL("mk_scc_registry returned NULL"); return; }
+
+    // Frozen base: A <-> B
+    Obj* a = mk_test_pair(NULL, NULL);
+    Obj* b = mk_test_pair(a, NULL);
+    a->a = b;
+    SCC* base = compute_sccs(reg, a);
+    if (!base || base->member_count != 2) { FAIL("base should be one 2-member SCC"); free(a); free(b); free_scc_registry(reg); return; }
+    base->frozen = 1;
+    int base_id = a->scc_id;
+
+    // New layer: C <-> D, both pointing into the base
+    Obj* c = mk_test_pair(a, NULL);
+    Obj* d = mk_test_pair(b, c);
+    c->b = d;
+    SCC* layer = compute_sccs(reg, c);
+
+    if (!layer || layer->result_next) { FAIL("layer should be a single SCC"); goto cleanup; }
+    if (layer->member_count != 2) { FAIL("layer should hold only C and D"); goto cleanup; }
+    if (a->scc_id != base_id || b->scc_id != base_id) { FAIL("base members were recomputed"); goto cleanup; }
+    if (layer->dep_count != 2 || base->ref_count != 3) { FAIL("each edge into the base should hold a reference"); goto cleanup; }
+
+    // A frozen root returns its own SCC
+    if (compute_sccs(reg, b) != base || base->ref_count != 4) { FAIL("frozen root should return its SCC"); goto cleanup; }
+    release_scc(base);
+
+    // The base outlives its own reference while the layer points into it
+    release_scc(base);
+    if (!base->members) { FAIL("base freed while referenced"); goto cleanup; }
+    layer->frozen = 1;
+    release_scc(layer);
+    if (base->members || base->ref_count != 0) { FAIL("releasing the layer should free the base"); goto cleanup; }
+    if (layer->members) { FAIL("layer should be freed"); goto cleanup; }
+
+    free_scc_registry(reg);
+    PASS();
+    return;
+
+cleanup:
+    if (base->members) { free(a); free(b); }
+    if (layer && layer->members) { free(c); free(d); }
+    free_scc_registry(reg);
+}
+
+// Test that re-freezing a frozen root leaves earlier result lists whole
+void test_frozen_root_keeps_result_list(void) {
+    TEST(frozen_root_keeps_result_list);
+
+    SCCRegistry* reg = mk_scc_registry();
+    if (!reg) { FAIL("mk_scc_registry returned NULL"); return; }
+
+    // A -> B -> C: three SCCs, B's in the middle of the list
+    Obj* c = mk_test_int(3);
+    Obj* b = mk_test_pair(c, NULL);
+    Obj* a = mk_test_pair(b, NULL);
+    SCC* result = compute_sccs(reg, a);
+    for (SCC* scc = result; scc; scc = scc->result_next) scc->frozen = 1;
+
+    SCC* mid = find_scc(reg, b->scc_id);
+    int refs = mid ? mid->ref_count : 0;
+    if (!mid || compute_sccs(reg, b) != mid || mid->ref_count != refs + 1) {
+        FAIL("frozen root should return its SCC with one more reference");
+        goto cleanup;
+    }
+    int count = 0;
+    for (SCC* scc = result; scc; scc = scc->result_next) count++;
+    if (count != 3) { FAIL("earlier result list was cut short"); goto cleanup; }
+
+    free(a); free(b); free(c);
+    free_scc_registry(reg);
+    PASS();
+    return;
+
+cleanup:
+    free(a); free(b); free(c);
+    free_scc_registry(reg);
+}
+
 int main(void) {
     printf("Running SCC Unit Tests...\n\n");
 
@@ -440,6 +523,8 @@ int main(void) {
     test_detect_freeze_points();
     test_scc_dag();
     test_release_scc_frees_members();
+    test_scc_incremental_freeze();
+    test_frozen_root_keeps_result_list();
 
     printf("\n========================================\n");
     printf("Results: %d passed, %d failed\n", tests_passed, tests_failed);
@@ -0,0 +1,292 @@
+// Unit tests for the work-stealing go scheduler and channel parking
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* root_menv = NULL;
+
+static Value* run(const char* src) {
+    set_parse_input(src);
+    return eval(parse(), root_menv);
+}
+
+static int prints_as(Value* v, const char* expected) {
+    char* s = val_to_str(v);
+    int ok = s && strcmp(s, expected) == 0;
+    if (!ok) printf("[got %s] ", s ? s : "(null)");
+    free(s);
+    return ok;
+}
+
+static void test_pure_processes_wait_for_sync(void) {
+    TEST(pure_processes_wait_for_sync);
+
+    Value* p = run("(go (fib 15))");
+    if (!p || val_tag(p) != T_PROCESS) { FAIL("no process"); return; }
+    if (p->proc.state != PROC_READY) { FAIL("pure process ran at spawn"); return; }
+    scheduler_sync();
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "610")) { FAIL("wrong result"); return; }
+
+    PASS();
+}
+
+static void test_impure_processes_run_serially(void) {
+    TEST(impure_processes_run_serially);
+
+    // Writes run at spawn, as they always did
+    run("(define counter (box 0))");
+    Value* p = run("(go (set-box! counter 5))");
+    if (!p || val_tag(p) != T_PROCESS || p->proc.state != PROC_DONE) { FAIL("impure process deferred"); return; }
+    if (!prints_as(run("(unbox counter)"), "5")) { FAIL("write lost"); return; }
+
+    // Calls through a parameter bound inside the process cannot be checked
+    p = run("(go ((lambda (f) (f 1)) (lambda (x) x)))");
+    if (!p || p->proc.state != PROC_DONE) { FAIL("unchecked call ran in parallel"); return; }
+
+    PASS();
+}
+
+static void test_writes_sync_first(void) {
+    TEST(writes_sync_first);
+
+    // The process reads the box as it was when spawned
+    run("(define cell (box 1))");
+    Value* p = run("(go (+ (unbox cell) 10))");
+    if (!p || p->proc.state != PROC_READY) { FAIL("not deferred"); return; }
+    run("(set-box! cell 2)");
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "11")) { FAIL("ran after the write"); return; }
+
+    PASS();
+}
+
+static void test_nested_fan_out(void) {
+    TEST(nested_fan_out);
+
+    // Children go on the spawning worker's deque, past its first ring
+    Value* p = run("(go (letrec ((fan (lambda (n acc) (if (= n 0) acc "
+                   "(fan (- n 1) (cons (go (fib 8)) acc)))))) (fan 300 ())))");
+    scheduler_sync();
+    if (!p || p->proc.state != PROC_DONE) { FAIL("parent not done"); return; }
+    int n = 0;
+    for (Value* l = p->proc.result; !is_nil(l); l = cdr(l), n++) {
+        Value* child = car(l);
+        if (child->proc.state != PROC_DONE || !prints_as(child->proc.result, "21")) { FAIL("child not done"); return; }
+    }
+    if (n != 300) { FAIL("children lost"); return; }
+
+    PASS();
+}
+
+static void test_parked_until_handoff(void) {
+    TEST(parked_until_handoff);
+
+    run("(define ch (make-chan))");
+    Value* p = run("(go (+ 1 (chan-recv! ch)))");
+    if (!p || p->proc.state != PROC_PARKED) { FAIL("receiver not parked"); return; }
+    run("(chan-send! ch 6)");
+    if (p->proc.state != PROC_READY) { FAIL("handoff did not wake it"); return; }
+    scheduler_run(root_menv);
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "7")) { FAIL("wrong result"); return; }
+
+    // A sender parks until the top level takes its value
+    p = run("(go (chan-send! ch 9))");
+    if (p->proc.state != PROC_PARKED) { FAIL("sender not parked"); return; }
+    if (!prints_as(run("(chan-recv! ch)"), "9")) { FAIL("value not handed off"); return; }
+
+    PASS();
+}
+
+static void test_close_wakes_waiters(void) {
+    TEST(close_wakes_waiters);
+
+    run("(define cl (make-chan))");
+    Value* p = run("(go (chan-recv! cl))");
+    if (p->proc.state != PROC_PARKED) { FAIL("not parked"); return; }
+    run("(chan-close! cl)");
+    scheduler_run(root_menv);
+    if (p->proc.state != PROC_DONE || !is_nil(p->proc.result)) { FAIL("receiver not woken with nil"); return; }
+
+    // Nothing left that could send: an error, not a hang
+    Value* v = run("(chan-recv! (make-chan))");
+    if (!v || val_tag(v) != T_ERROR) { FAIL("no deadlock error"); return; }
+
+    PASS();
+}
+
+static void test_long_pipeline(void) {
+    TEST(long_pipeline);
+
+    // Every stage is parked on its input until the value reaches it
+    run("(define (stage in) (let ((out (make-chan))) "
+        "(let ((p (go (chan-send! out (+ 1 (chan-recv! in)))))) out)))");
+    run("(define (build n in) (if (= n 0) in (build (- n 1) (stage in))))");
+    run("(define head (make-chan))");
+    run("(define tail (build 3000 head))");
+    run("(chan-send! head 0)");
+    if (!prints_as(run("(chan-recv! tail)"), "3000")) { FAIL("value lost in the pipeline"); return; }
+
+    PASS();
+}
+
+static void test_batches_wake_once(void) {
+    TEST(batches_wake_once);
+
+    run("(define bc (make-chan))");
+    Value* p = run("(go (chan-recv-many! bc 3))");
+    if (p->proc.state != PROC_PARKED) { FAIL("batch receiver not parked"); return; }
+    if (!prints_as(run("(chan-send-many! bc '(1 2 3))"), "3")) { FAIL("batch not taken"); return; }
+    scheduler_run(root_menv);
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "(1 2 3)")) { FAIL("wrong batch"); return; }
+
+    // A batch sender stays parked until its last value is taken
+    p = run("(go (chan-send-many! bc '(5 6 7)))");
+    run("(chan-recv! bc)");
+    run("(chan-recv! bc)");
+    if (p->proc.state != PROC_PARKED) { FAIL("sender woken early"); return; }
+    if (!prints_as(run("(chan-recv-many! bc 5)"), "(7)")) { FAIL("last value lost"); return; }
+    if (p->proc.state != PROC_READY) { FAIL("sender not woken"); return; }
+    scheduler_run(root_menv);
+
+    PASS();
+}
+
+static void test_select_fair_and_parks(void) {
+    TEST(select_fair_and_parks);
+
+    // Both always ready: neither case may starve the other
+    run("(define sa (make-chan 64))");
+    run("(define sb (make-chan 64))");
+    for (int i = 0; i < 4; i++) {
+        run("(chan-send-many! sa '(1 1 1 1 1 1 1 1))");
+        run("(chan-send-many! sb '(1 1 1 1 1 1 1 1))");
+    }
+    run("(define (pick n) (if (= n 0) 0 (+ (select ((recv sa) => 1) ((recv sb) => 100)) (pick (- n 1)))))");
+    Value* v = run("(pick 32)");
+    if (!v || val_tag(v) != T_INT || val_int(v) % 100 == 0 || val_int(v) < 100) { FAIL("one case starved"); return; }
+    run("(chan-recv-many! sa 64)");
+    run("(chan-recv-many! sb 64)");
+
+    // Nothing ready: parked on both, and off both once one fires
+    Value* p = run("(go (select ((recv sa) => 1) ((recv sb) => 2)))");
+    if (p->proc.state != PROC_PARKED) { FAIL("select did not park"); return; }
+    run("(chan-send! sb 0)");
+    scheduler_run(root_menv);
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "2")) { FAIL("wrong case ran"); return; }
+    if (run("sa")->chan.ch->receivers.head) { FAIL("left on the other channel"); return; }
+
+    PASS();
+}
+
+static void test_stacks_reused(void) {
+    TEST(stacks_reused);
+
+    // A deep run parks on top of what it left, then its stack is pooled
+    run("(define (depth n) (if (= n 0) 0 (+ 1 (depth (- n 1)))))");
+    run("(define dc (make-chan))");
+    Value* p = run("(go (+ (depth 3000) (+ (chan-recv! dc) (depth 3000))))");
+    if (p->proc.state != PROC_PARKED) { FAIL("deep process not parked"); return; }
+    run("(chan-send! dc 1)");
+    scheduler_run(root_menv);
+    if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "6001")) { FAIL("deep process lost its stack"); return; }
+
+    // One after another on reused stacks, each suspended and resumed
+    for (int i = 0; i < 2000; i++) {
+        p = run("(go (+ 1 (chan-recv! dc)))");
+        if (p->proc.state != PROC_PARKED) { FAIL("reused stack cannot park"); return; }
+        run("(chan-send! dc 5)");
+        scheduler_run(root_menv);
+        if (p->proc.state != PROC_DONE || !prints_as(p->proc.result, "6")) { FAIL("wrong result on a reused stack"); return; }
+    }
+
+    PASS();
+}
+
+static void test_independent_forms(void) {
+    TEST(independent_forms);
+
+    static const struct { const char* form; int safe; } cases[] = {
+        { "(fib 10)", 1 },
+        { "(+ (fib 5) (fib 6))", 1 },
+        { "(define y 1)", 0 },
+        { "(set-box! counter 1)", 0 },
+        { "(lift 1)", 0 },
+        { "(chan-recv! ch)", 0 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        set_parse_input(cases[i].form);
+        if (eval_parallel_safe(parse(), root_menv) != cases[i].safe) {
+            printf("[%s] ", cases[i].form);
+            FAIL("wrong verdict");
+            return;
+        }
+    }
+
+    // Values come back in the forms' order, each from a VM of its own
+    static const char* srcs[] = { "(fib 20)", "(fib 3)", "(+ 1 (fib 12))", "(cons (fib 4) (cons 1 ()))" };
+    static const char* expected[] = { "6765", "2", "145", "(3 1)" };
+    enum { N = sizeof(srcs) / sizeof(srcs[0]) };
+    Value* forms[N];
+    Value* results[N];
+    for (int i = 0; i < N; i++) {
+        set_parse_input(srcs[i]);
+        forms[i] = parse();
+    }
+    eval_parallel(forms, N, root_menv, results);
+    for (int i = 0; i < N; i++) {
+        if (!prints_as(results[i], expected[i])) { FAIL("wrong value"); return; }
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Scheduler Unit Tests...\n");
+    init_syms();
+    Value* env = NIL;
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("-"), mk_prim2(prim_sub, prim_sub2));
+    env = env_extend(env, mk_sym("="), mk_prim2(prim_eq, prim_eq2));
+    env = env_extend(env, mk_sym("<"), mk_prim2(prim_lt, prim_lt2));
+    env = env_extend(env, mk_sym("cons"), mk_prim2(prim_cons, prim_cons2));
+    env = env_extend(env, mk_sym("box"), mk_prim(prim_box));
+    env = env_extend(env, mk_sym("unbox"), mk_prim(prim_unbox));
+    env = env_extend(env, mk_sym("set-box!"), mk_prim(prim_set_box));
+    env = env_extend(env, mk_sym("make-chan"), mk_prim(prim_make_chan));
+    env = env_extend(env, mk_sym("chan-send!"), mk_prim(prim_chan_send));
+    env = env_extend(env, mk_sym("chan-recv!"), mk_prim(prim_chan_recv));
+    env = env_extend(env, mk_sym("chan-close!"), mk_prim(prim_chan_close));
+    env = env_extend(env, mk_sym("chan-send-many!"), mk_prim(prim_chan_send_many));
+    env = env_extend(env, mk_sym("chan-recv-many!"), mk_prim(prim_chan_recv_many));
+    root_menv = mk_menv(NIL, env);
+    scheduler_set_workers(4);
+    run("(define (fib n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))");
+
+    test_pure_processes_wait_for_sync();
+    test_impure_processes_run_serially();
+    test_writes_sync_first();
+    test_nested_fan_out();
+    test_parked_until_handoff();
+    test_close_wakes_waiters();
+    test_long_pipeline();
+    test_batches_wake_once();
+    test_select_fair_and_parks();
+    test_stacks_reused();
+    test_independent_forms();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
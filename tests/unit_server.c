@@ -0,0 +1,123 @@
+// Unit tests for the compile server transport
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../src/util/server.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static char path[64];
+
+// Echo the request length and text back; "stop" ends the server
+static int echo_handler(const char* request, size_t len, void* ctx) {
+    int* served = ctx;
+    (*served)++;
+    printf("%zu:%s", len, request);
+    return strcmp(request, "stop") == 0;
+}
+
+// Response to request, malloc'd; NULL if the request failed
+static char* ask(const char* request, size_t len) {
+    char* text = NULL;
+    size_t text_len = 0;
+    FILE* out = open_memstream(&text, &text_len);
+    if (!out) return NULL;
+    int rc = server_request(path, request, len, out);
+    fclose(out);
+    if (rc != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+static pid_t start_server(void) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int served = 0;
+        int rc = server_run(path, echo_handler, &served);
+        _exit(rc == 0 ? served : 255);
+    }
+    // Wait for the socket to appear
+    struct timespec tick = {0, 10000000};
+    for (int i = 0; i < 100 && access(path, F_OK) != 0; i++) nanosleep(&tick, NULL);
+    return pid;
+}
+
+static void test_round_trip(void) {
+    TEST(round_trip);
+
+    char* resp = ask("(+ 1 2)", 7);
+    if (!resp || strcmp(resp, "7:(+ 1 2)") != 0) { FAIL(resp ? resp : "no response"); free(resp); return; }
+    free(resp);
+
+    // Requests are independent connections
+    resp = ask("", 0);
+    if (!resp || strcmp(resp, "0:") != 0) { FAIL("empty request"); free(resp); return; }
+    free(resp);
+
+    PASS();
+}
+
+static void test_large_request(void) {
+    TEST(large_request);
+
+    // Larger than both the read and the copy buffers
+    size_t len = 300000;
+    char* req = malloc(len + 1);
+    if (!req) { FAIL("OOM"); return; }
+    for (size_t i = 0; i < len; i++) req[i] = (char)('a' + i % 26);
+    req[len] = '\0';
+
+    char prefix[32];
+    int plen = snprintf(prefix, sizeof(prefix), "%zu:", len);
+    char* resp = ask(req, len);
+    int ok = resp && strncmp(resp, prefix, (size_t)plen) == 0 && strcmp(resp + plen, req) == 0;
+    free(resp);
+    free(req);
+    if (!ok) { FAIL("response mismatch"); return; }
+
+    PASS();
+}
+
+static void test_shutdown(pid_t pid) {
+    TEST(shutdown);
+
+    char* resp = ask("stop", 4);
+    free(resp);
+    int status = 0;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) { FAIL("server did not exit"); return; }
+    if (WEXITSTATUS(status) != 4) { FAIL("wrong request count"); return; }
+    if (access(path, F_OK) == 0) { FAIL("socket left behind"); return; }
+    if (server_request(path, "x", 1, stdout) == 0) { FAIL("connected after shutdown"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Compile Server Unit Tests...\n");
+    snprintf(path, sizeof(path), "/tmp/purple_server_%d.sock", (int)getpid());
+
+    pid_t pid = start_server();
+    if (pid < 0) return 1;
+    test_round_trip();
+    test_large_request();
+    test_shutdown(pid);
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Unit tests for mapped source loading
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../src/util/source.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static char path[] = "/tmp/purple_source_XXXXXX";
+
+static int write_file(const char* text, size_t len) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+    fwrite(text, 1, len, f);
+    fclose(f);
+    return 1;
+}
+
+static void test_small_file(void) {
+    TEST(small_file);
+
+    const char* text = "(define x 1)\n(+ x 2)\n";
+    if (!write_file(text, strlen(text))) { FAIL("write"); return; }
+    Source* src = source_load(path);
+    if (!src) { FAIL("load"); return; }
+    if (src->len != strlen(text) || strcmp(src->text, text) != 0) { FAIL("contents"); source_free(src); return; }
+    if (!src->map_len) { FAIL("regular file should be mapped"); source_free(src); return; }
+    source_free(src);
+
+    PASS();
+}
+
+static void test_page_sized_file(void) {
+    TEST(page_sized_file);
+
+    // No slack in the last file page: the terminator comes from the zero page
+    size_t len = (size_t)sysconf(_SC_PAGESIZE) * 2;
+    char* text = malloc(len);
+    if (!text) { FAIL("alloc"); return; }
+    memset(text, ' ', len);
+    text[0] = '1';
+    if (!write_file(text, len)) { free(text); FAIL("write"); return; }
+    free(text);
+
+    Source* src = source_load(path);
+    if (!src) { FAIL("load"); return; }
+    if (src->len != len || src->text[0] != '1' || src->text[len] != '\0') {
+        FAIL("terminator after full pages"); source_free(src); return;
+    }
+    source_free(src);
+
+    PASS();
+}
+
+static void test_empty_and_missing(void) {
+    TEST(empty_and_missing);
+
+    if (!write_file("", 0)) { FAIL("write"); return; }
+    Source* src = source_load(path);
+    if (!src || src->len != 0 || src->text[0] != '\0') { FAIL("empty file"); source_free(src); return; }
+    source_free(src);
+
+    if (source_load("/nonexistent/purple/source")) { FAIL("missing file loaded"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Source Loading Unit Tests...\n");
+    int fd = mkstemp(path);
+    if (fd < 0) return 1;
+    close(fd);
+
+    test_small_file();
+    test_page_sized_file();
+    test_empty_and_missing();
+    unlink(path);
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,109 @@
+// Unit tests for swissmap.c - open-addressing HashMap variant
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/util/swissmap.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define K(i) ((void*)(uintptr_t)((i) * 8 + 8))
+#define V(i) ((void*)(uintptr_t)((i) + 1))
+
+void test_put_get_overwrite(void) {
+    TEST(put_get_overwrite);
+
+    SwissMap* map = swissmap_new();
+    if (!map) { FAIL("swissmap_new returned NULL"); return; }
+    for (int i = 0; i < 10000; i++) swissmap_put(map, K(i), V(i));
+    if (swissmap_size(map) != 10000) { FAIL("wrong size"); swissmap_free(map); return; }
+    for (int i = 0; i < 10000; i++) {
+        if (swissmap_get(map, K(i)) != V(i)) { FAIL("wrong value"); swissmap_free(map); return; }
+    }
+    if (swissmap_get(map, K(10000)) || swissmap_contains(map, K(-5))) { FAIL("found a missing key"); swissmap_free(map); return; }
+
+    // Overwrite keeps the size; NULL is an ordinary key
+    swissmap_put(map, K(7), V(70));
+    swissmap_put(map, NULL, V(3));
+    if (swissmap_get(map, K(7)) != V(70) || swissmap_get(map, NULL) != V(3) || swissmap_size(map) != 10001) {
+        FAIL("overwrite");
+        swissmap_free(map);
+        return;
+    }
+    if (swissmap_had_alloc_failure(map)) { FAIL("alloc failure"); swissmap_free(map); return; }
+
+    swissmap_free(map);
+    swissmap_free(NULL);
+    PASS();
+}
+
+void test_remove_without_tombstones(void) {
+    TEST(remove_without_tombstones);
+
+    // A small table, churned far past its capacity: only works if removal
+    // leaves nothing behind
+    SwissMap* map = swissmap_with_capacity(8);
+    size_t cap = map->capacity;
+    for (int round = 0; round < 200; round++) {
+        for (int i = 0; i < 12; i++) swissmap_put(map, K(round * 12 + i), V(i));
+        for (int i = 0; i < 12; i += 2) {
+            if (swissmap_remove(map, K(round * 12 + i)) != V(i)) { FAIL("remove returned wrong value"); swissmap_free(map); return; }
+        }
+        for (int i = 1; i < 12; i += 2) {
+            if (swissmap_get(map, K(round * 12 + i)) != V(i)) { FAIL("entry lost by a removal"); swissmap_free(map); return; }
+            swissmap_remove(map, K(round * 12 + i));
+        }
+        if (swissmap_size(map) != 0) { FAIL("size drift"); swissmap_free(map); return; }
+    }
+    if (map->capacity != cap) { FAIL("churn grew the table"); swissmap_free(map); return; }
+    if (swissmap_remove(map, K(1))) { FAIL("removed a missing key"); swissmap_free(map); return; }
+
+    swissmap_free(map);
+    PASS();
+}
+
+static void sum_values(void* key, void* value, void* ctx) {
+    (void)key;
+    *(uintptr_t*)ctx += (uintptr_t)value;
+}
+
+void test_reserve_clear_foreach(void) {
+    TEST(reserve_clear_foreach);
+
+    SwissMap* map = swissmap_new();
+    if (!swissmap_reserve(map, 5000)) { FAIL("reserve failed"); swissmap_free(map); return; }
+    size_t cap = map->capacity;
+    for (int i = 0; i < 5000; i++) swissmap_put(map, K(i), V(i));
+    if (map->capacity != cap) { FAIL("grew after reserve"); swissmap_free(map); return; }
+
+    uintptr_t sum = 0;
+    swissmap_foreach(map, sum_values, &sum);
+    if (sum != 5000u * 5001u / 2) { FAIL("foreach missed entries"); swissmap_free(map); return; }
+
+    swissmap_clear(map);
+    if (swissmap_size(map) != 0 || swissmap_get(map, K(1)) || map->capacity != cap) { FAIL("clear"); swissmap_free(map); return; }
+    swissmap_put(map, K(1), V(1));
+    if (swissmap_get(map, K(1)) != V(1)) { FAIL("put after clear"); swissmap_free(map); return; }
+
+    swissmap_free(map);
+    PASS();
+}
+
+int main(void) {
+    printf("Running SwissMap Unit Tests...\n");
+
+    test_put_get_overwrite();
+    test_remove_without_tombstones();
+    test_reserve_clear_foreach();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Unit tests for symindex.c - name-keyed index of the analysis contexts
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/util/symindex.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+#define N 20000
+
+static char names[N][12];
+
+void test_put_get_replace(void) {
+    TEST(put_get_replace);
+
+    SymIndex index;
+    symindex_init(&index);
+    if (symindex_get(&index, "a")) { FAIL("empty index found a name"); return; }
+
+    for (int i = 0; i < N; i++) {
+        if (!symindex_put(&index, names[i], &names[i])) { FAIL("put failed"); symindex_destroy(&index); return; }
+    }
+    if (index.size != N) { FAIL("wrong size"); symindex_destroy(&index); return; }
+
+    // Lookups compare contents, not just the pointer
+    char probe[12];
+    for (int i = 0; i < N; i++) {
+        strcpy(probe, names[i]);
+        if (symindex_get(&index, probe) != &names[i]) { FAIL("wrong binding"); symindex_destroy(&index); return; }
+    }
+    if (symindex_get(&index, "missing")) { FAIL("found a missing name"); symindex_destroy(&index); return; }
+
+    // Replacing keeps the size
+    symindex_put(&index, names[5], &names[6]);
+    if (symindex_get(&index, names[5]) != &names[6] || index.size != N) { FAIL("replace"); symindex_destroy(&index); return; }
+
+    symindex_destroy(&index);
+    PASS();
+}
+
+void test_remove(void) {
+    TEST(remove);
+
+    SymIndex index;
+    symindex_init(&index);
+    for (int i = 0; i < N; i++) symindex_put(&index, names[i], &names[i]);
+
+    // Remove every other name; the rest must survive the backward shifts
+    for (int i = 0; i < N; i += 2) symindex_remove(&index, names[i]);
+    symindex_remove(&index, "missing");
+    if (index.size != N / 2) { FAIL("wrong size"); symindex_destroy(&index); return; }
+    for (int i = 0; i < N; i++) {
+        void* want = (i % 2) ? &names[i] : NULL;
+        if (symindex_get(&index, names[i]) != want) { FAIL("wrong binding after remove"); symindex_destroy(&index); return; }
+    }
+
+    // Removed names can come back
+    symindex_put(&index, names[0], &names[1]);
+    if (symindex_get(&index, names[0]) != &names[1]) { FAIL("re-put"); symindex_destroy(&index); return; }
+
+    symindex_destroy(&index);
+    symindex_remove(&index, names[0]);
+    PASS();
+}
+
+int main(void) {
+    printf("Running SymIndex Unit Tests...\n\n");
+    for (int i = 0; i < N; i++) snprintf(names[i], sizeof(names[i]), "x%d", i);
+
+    test_put_get_replace();
+    test_remove();
+
+    printf("\n%d tests passed, %d tests failed\n", tests_passed, tests_failed);
+    return tests_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+// Unit tests for the runtime feature-usage pass
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+#include "../src/analysis/usage.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static unsigned usage_of(const char* src) {
+    set_parse_input(src);
+    return analyze_runtime_usage(parse());
+}
+
+static void test_interpreted_needs_nothing(void) {
+    TEST(interpreted_needs_nothing);
+
+    if (usage_of("(+ 1 2)") != 0) { FAIL("arithmetic"); return; }
+    // letrec alone cannot reach deferred_release: nothing is compiled
+    if (usage_of("(letrec ((f (lambda (n) n))) (f 1))") != 0) { FAIL("letrec without lift"); return; }
+
+    PASS();
+}
+
+static void test_lift_needs_core(void) {
+    TEST(lift_needs_core);
+
+    unsigned f = usage_of("(let ((x (lift 1))) (+ x 2))");
+    if (!(f & RT_CORE)) { FAIL("core missing"); return; }
+    if (f & (RT_ARENA | RT_CONCURRENT | RT_DEFERRED)) { FAIL("unused sections kept"); return; }
+    // Quoted code is still reachable through run/EM
+    if (!(usage_of("(run (quote (lift 1)))") & RT_CORE)) { FAIL("quoted lift"); return; }
+
+    PASS();
+}
+
+static void test_dependencies(void) {
+    TEST(dependencies);
+
+    unsigned f = usage_of("(letrec ((f (lambda (x) x))) (f (lift 1)))");
+    if (!(f & RT_DEFERRED) || !(f & RT_CORE)) { FAIL("deferred with core"); return; }
+    if (!(usage_of("(let ((x 1)) (scan 'List x))") & RT_CORE)) { FAIL("scanner pulls in core"); return; }
+    if (runtime_with_deps(RT_SCC) != (RT_SCC | RT_CORE)) { FAIL("SCC depends on core"); return; }
+    if (usage_of("(run (read))") != RT_ALL) { FAIL("read keeps everything"); return; }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Runtime Usage Unit Tests...\n");
+    init_syms();
+    test_interpreted_needs_nothing();
+    test_lift_needs_core();
+    test_dependencies();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// Unit tests for val_write - printing into one output buffer
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/util/dstring.h"
+#include "../src/codegen/codegen.h"
+#include "../src/eval/eval.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* parse_src(const char* src) {
+    set_parse_input(src);
+    return parse();
+}
+
+static void test_appends(void) {
+    TEST(appends);
+
+    // Values land after whatever the buffer already holds
+    DString* ds = ds_from("x = ");
+    val_write(ds, parse_src("(1 (2 3) foo ())"));
+    ds_append(ds, "; ");
+    list_write(ds, mk_cell(mk_int(-4), NIL));
+    int ok = strcmp(ds_cstr(ds), "x = (1 (2 3) foo ()); (-4)") == 0;
+    if (!ok) printf("[%s] ", ds_cstr(ds));
+    ds_free(ds);
+    if (!ok) { FAIL("wrong text"); return; }
+
+    PASS();
+}
+
+static void test_matches_to_str(void) {
+    TEST(matches_to_str);
+
+    Value* box = mk_box(mk_int(7));
+    Value* values[] = {
+        NULL, NIL, mk_int(42), mk_sym("sym"), mk_code("add(x, y)"), mk_error("bad"),
+        box, mk_cell(box, mk_cell(mk_box(NULL), NIL)), parse_src("((a b) (c))"),
+    };
+    const char* expected[] = {
+        "NULL", "()", "42", "sym", "add(x, y)", "#<error: bad>",
+        "#<box 7>", "(#<box 7> #<box nil>)", "((a b) (c))",
+    };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        char* s = val_to_str(values[i]);
+        int ok = s && strcmp(s, expected[i]) == 0;
+        if (!ok) printf("[%s, expected %s] ", s ? s : "(null)", expected[i]);
+        free(s);
+        if (!ok) { FAIL("val_to_str differs"); return; }
+    }
+
+    PASS();
+}
+
+static void test_large_values(void) {
+    TEST(large_values);
+
+    // A long list and a deeply nested one, each built in one buffer
+    enum { N = 200000, DEPTH = 2000 };
+    Value* list = NIL;
+    for (int i = 0; i < N; i++) list = mk_cell(mk_int(i % 10), list);
+    char* s = list_to_str(list);
+    int ok = s && strlen(s) == (size_t)N * 2 + 1 && s[0] == '(' && s[N * 2] == ')';
+    free(s);
+    if (!ok) { FAIL("long list"); return; }
+
+    Value* nested = NIL;
+    for (int i = 0; i < DEPTH; i++) nested = mk_cell(nested, NIL);
+    s = val_to_str(nested);
+    ok = s && strlen(s) == (size_t)DEPTH * 2 + 2;
+    free(s);
+    if (!ok) { FAIL("nested list"); return; }
+
+    // The same list as a lifted value: one mk_pair chain
+    char* c = val_to_c_expr(mk_cell(mk_int(1), mk_cell(mk_int(2), NIL)));
+    ok = c && strcmp(c, "mk_pair(mk_int(1), mk_pair(mk_int(2), NULL))") == 0;
+    free(c);
+    if (!ok) { FAIL("lifted list"); return; }
+    if (strcmp(code_text(emit_c_call("mk_pair", mk_code("x"), mk_cell(mk_int(3), NIL))), "mk_pair(x, mk_pair(mk_int(3), NULL))") != 0) {
+        FAIL("emit_c_call operands");
+        return;
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running val_write Unit Tests...\n");
+    init_syms();
+
+    test_appends();
+    test_matches_to_str();
+    test_large_values();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,251 @@
+// Unit tests for vector.c - the vector primitives and their staged loops
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/eval/eval.h"
+#include "../src/eval/vector.h"
+#include "../src/codegen/codegen.h"
+#include "../src/parser/parser.h"
+#include "../src/util/emit.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* root_menv = NULL;
+
+static Value* run(const char* src) {
+    set_parse_input(src);
+    Value* form = parse();
+    return form ? eval(form, root_menv) : NULL;
+}
+
+// The value src evaluates to, written out, is `expected`
+static int evaluates_to(const char* src, const char* expected) {
+    Value* v = run(src);
+    char* s = v ? val_to_str(v) : NULL;
+    int ok = s && strcmp(s, expected) == 0;
+    if (!ok) printf("[%s: %s] ", src, s ? s : "(null)");
+    free(s);
+    return ok;
+}
+
+static void test_interpreted(void) {
+    TEST(interpreted);
+
+    static const char* cases[][2] = {
+        { "(vector 1 2 3)", "#(1 2 3)" },
+        { "(make-vector 3 7)", "#(7 7 7)" },
+        { "(vector-length (vector))", "0" },
+        { "(vector-ref (vector 4 5 6) 2)", "6" },
+        { "(vector->list (list->vector (quote (1 2 3))))", "(1 2 3)" },
+        { "(vector-map (lambda (x) (* x x)) (vector 1 2 3))", "#(1 4 9)" },
+        { "(vector-fold (lambda (a x) (+ a x)) 0 (vector 1 2 3 4))", "10" },
+        { "(vector-filter (lambda (x) (> x 2)) (vector 1 2 3 4 5))", "#(3 4 5)" },
+        { "(vector-add (vector 1 2) (vector 10 20))", "#(11 22)" },
+        { "(vector-dot (vector 1 2 3) (vector 4 5 6))", "32" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        if (!evaluates_to(cases[i][0], cases[i][1])) { FAIL("wrong value"); return; }
+    }
+
+    PASS();
+}
+
+static void test_errors(void) {
+    TEST(errors);
+
+    static const char* bad[] = {
+        "(vector-ref (vector 1) 1)",
+        "(vector-add (vector 1) (vector 1 2))",
+        "(vector-dot (vector 1) (quote (1)))",
+        "(vector 1 (quote a))",
+        "(vector-map (lambda (x) (quote a)) (vector 1))",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        if (!is_error(run(bad[i]))) { printf("[%s] ", bad[i]); FAIL("no error"); return; }
+    }
+
+    PASS();
+}
+
+static void test_wraps(void) {
+    TEST(wraps);
+
+    // As the compiled loops do: two's complement, not 0
+    if (!evaluates_to("(vector-add (vector 9223372036854775807) (vector 1))", "#(-9223372036854775808)")) {
+        FAIL("vector-add did not wrap");
+        return;
+    }
+    if (!evaluates_to("(vector-dot (vector 4611686018427387904) (vector 2))", "-9223372036854775808")) {
+        FAIL("vector-dot did not wrap");
+        return;
+    }
+
+    PASS();
+}
+
+// Staged: one C loop, the function's body inlined unboxed
+static void test_staged_loops(void) {
+    TEST(staged_loops);
+
+    Value* map = run("(vector-map (lambda (x) (* x x)) (lift (vector 1 2 3)))");
+    if (!map || !is_code(map)) { FAIL("map not staged"); return; }
+    const char* s = code_text(map);
+    if (!strstr(s, "_d1[_k1] = mul_l(_x1, _x1);") || strstr(s, "mk_int")) {
+        printf("[%s] ", s);
+        FAIL("map body not unboxed");
+        return;
+    }
+    // The lifted operand is a temporary only the loop reads
+    if (!strstr(s, "free_tree(_v1);")) { FAIL("temporary not freed"); return; }
+
+    Value* fold = run("(vector-fold (lambda (a x) (+ a (vector-fold (lambda (b y) (+ b y)) x (lift (vector 1 2))))) 0 (lift (vector 1 2)))");
+    s = fold && is_code(fold) ? code_text(fold) : "";
+    if (!strstr(s, "long _a1 = 0;") || !strstr(s, "long _a2 = _x1;") || !strstr(s, "_a1 = add_l(_a1, ({ /* vector-fold */")) {
+        printf("[%s] ", s);
+        FAIL("nested fold");
+        return;
+    }
+
+    Value* dot = run("(vector-dot (lift (vector 1 2)) (vector 3 4))");
+    s = dot && is_code(dot) ? code_text(dot) : "";
+    if (strncmp(s, "({ /* vector-dot */ Obj* _t0 = vec_of(2, (long[]){1, 2});", 57) != 0) {
+        printf("[%s] ", s);
+        FAIL("dot operands");
+        return;
+    }
+
+    PASS();
+}
+
+static void test_shape_is_tree(void) {
+    TEST(shape_is_tree);
+
+    Value* let = run("(let ((v (vector-map (lambda (x) (+ x 1)) (lift (vector 1 2))))) (vector-dot v v))");
+    const char* s = let && is_code(let) ? code_text(let) : "";
+    if (!strstr(s, "free_tree(v); // ASAP Clean (shape: TREE)")) {
+        printf("[%s] ", s);
+        FAIL("not freed as a TREE");
+        return;
+    }
+
+    PASS();
+}
+
+// -- Compiled --
+
+static Value* compiled_body = NULL;
+
+static void gen_program(void) {
+    gen_runtime_header();
+    gen_weak_ref_stub();
+    gen_arith_runtime();
+    gen_vector_runtime();
+    emit("int main(void) {\n");
+    emit("    Obj* r = ");
+    emit("%s", code_text(compiled_body));
+    emit(";\n");
+    emit("    vec_write(stdout, r);\n");
+    emit("    Obj* big = vec_make(1003, 5);\n");
+    emit("    Obj* sum = vec_add(big, big);\n");
+    emit("    long ok = vec_len(sum) == 1003 && vec_ref(sum, 1002)->i == 10 && vec_dot(sum, big)->i == 50150;\n");
+    emit("    printf(\" %%ld\", ok);\n");
+    emit("    free_tree(sum);\n");
+    emit("    free_tree(big);\n");
+    emit("    free_tree(r);\n");
+    emit("    return 0;\n");
+    emit("}\n");
+}
+
+// Build with `defines`, run, and return what the program printed
+static char* run_program(const char* defines) {
+    EmitSink* sink = emit_to_memory();
+    if (!sink) return NULL;
+    EmitSink* prev = emit_set_sink(sink);
+    gen_program();
+    emit_set_sink(prev);
+    char* prog = emit_take(sink);
+    if (!prog) return NULL;
+
+    char src[] = "/tmp/purple_vector_XXXXXX";
+    int fd = mkstemp(src);
+    if (fd < 0) { free(prog); return NULL; }
+    FILE* f = fdopen(fd, "w");
+    fputs(prog, f);
+    fclose(f);
+    free(prog);
+
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd), "gcc -O2 -w %s -x c -o %s.bin %s && %s.bin > %s.out", defines, src, src, src, src);
+    int status = system(cmd);
+    snprintf(cmd, sizeof(cmd), "%s.out", src);
+    char* out = NULL;
+    FILE* in = status == 0 ? fopen(cmd, "r") : NULL;
+    if (in) {
+        out = calloc(1, 256);
+        if (out) fread(out, 1, 255, in);
+        fclose(in);
+    }
+    remove(cmd);
+    snprintf(cmd, sizeof(cmd), "%s.bin", src);
+    remove(cmd);
+    remove(src);
+    return out;
+}
+
+static void test_compiled(void) {
+    TEST(compiled);
+
+    compiled_body = run("(vector-filter (lambda (x) (> x 4)) (vector-map (lambda (x) (* x x)) "
+                        "(vector-add (lift (vector 1 2 3 4)) (vector 0 0 0 1))))");
+    if (!compiled_body || !is_code(compiled_body)) { FAIL("not staged"); return; }
+    static const char* layouts[] = { "", "-DPURPLE_COMPACT_OBJ" };
+    for (int i = 0; i < 2; i++) {
+        char* out = run_program(layouts[i]);
+        int ok = out && strcmp(out, "#(9 25) 1") == 0;
+        if (!ok) printf("[%s: %s] ", layouts[i], out ? out : "(null)");
+        free(out);
+        if (!ok) { FAIL("wrong output"); return; }
+    }
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Vector Unit Tests...\n");
+    init_syms();
+    Value* env = NIL;
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("*"), mk_prim2(prim_mul, prim_mul2));
+    env = env_extend(env, mk_sym(">"), mk_prim2(prim_gt, prim_gt2));
+    env = env_extend(env, mk_sym("vector"), mk_prim(prim_vector));
+    env = env_extend(env, mk_sym("make-vector"), mk_prim(prim_make_vector));
+    env = env_extend(env, mk_sym("vector-length"), mk_prim(prim_vector_length));
+    env = env_extend(env, mk_sym("vector-ref"), mk_prim(prim_vector_ref));
+    env = env_extend(env, mk_sym("list->vector"), mk_prim(prim_list_to_vector));
+    env = env_extend(env, mk_sym("vector->list"), mk_prim(prim_vector_to_list));
+    env = env_extend(env, mk_sym("vector-map"), mk_prim(prim_vector_map));
+    env = env_extend(env, mk_sym("vector-fold"), mk_prim(prim_vector_fold));
+    env = env_extend(env, mk_sym("vector-filter"), mk_prim(prim_vector_filter));
+    env = env_extend(env, mk_sym("vector-add"), mk_prim(prim_vector_add));
+    env = env_extend(env, mk_sym("vector-dot"), mk_prim(prim_vector_dot));
+    root_menv = mk_menv(NIL, env);
+
+    test_interpreted();
+    test_errors();
+    test_wraps();
+    test_staged_loops();
+    test_shape_is_tree();
+    test_compiled();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Unit tests for the bytecode VM
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../src/types.h"
+#include "../src/eval/eval.h"
+#include "../src/eval/vm.h"
+#include "../src/parser/parser.h"
+
+static int tests_passed = 0;
+static int tests_failed = 0;
+
+#define TEST(name) printf("  Testing %s... ", #name);
+#define PASS() do { printf("PASS\n"); tests_passed++; } while(0)
+#define FAIL(msg) do { printf("FAIL: %s\n", msg); tests_failed++; } while(0)
+
+static Value* root_menv = NULL;
+
+static Value* parse_str(const char* src) {
+    set_parse_input(src);
+    return parse();
+}
+
+// Result of running src in the VM, printed
+static int runs_to(const char* src, const char* expected) {
+    Value* result = vm_eval(parse_str(src), root_menv);
+    char* s = val_to_str(result);
+    int ok = s && strcmp(s, expected) == 0;
+    if (!ok) printf("[%s => %s] ", src, s ? s : "(null)");
+    free(s);
+    return ok;
+}
+
+static void test_accepts(void) {
+    TEST(accepts);
+
+    if (!vm_accepts(parse_str("(+ 1 2)"), root_menv)) { FAIL("plain program rejected"); return; }
+    if (vm_accepts(parse_str("(+ 1 (lift 2))"), root_menv)) { FAIL("staged program accepted"); return; }
+    if (vm_accepts(parse_str("(run (quote (EM 1)))"), root_menv)) { FAIL("quoted staging accepted"); return; }
+
+    PASS();
+}
+
+static void test_core_forms(void) {
+    TEST(core_forms);
+
+    if (!runs_to("(let ((x 2) (y 3)) (* x y))", "6")) { FAIL("let"); return; }
+    if (!runs_to("(((lambda (x) (lambda (y) (+ x y))) 1) 2)", "3")) { FAIL("closure call"); return; }
+    if (!runs_to("(and 1 () 3)", "()")) { FAIL("and"); return; }
+    if (!runs_to("(or () 4)", "4")) { FAIL("or"); return; }
+    if (!runs_to("(let ((x 1)) (do (set! x 5) x))", "5")) { FAIL("set!"); return; }
+    if (!runs_to("(letrec ((ev (lambda (n) (if (= n 0) t (od (- n 1))))) "
+                 "(od (lambda (n) (if (= n 0) () (ev (- n 1)))))) (ev 10))", "t")) { FAIL("letrec"); return; }
+
+    PASS();
+}
+
+static void test_deep_recursion(void) {
+    TEST(deep_recursion);
+
+    // Non-tail recursion uses VM frames, not the C stack
+    if (!runs_to("(letrec ((f (lambda (n) (if (= n 0) 0 (+ 1 (f (- n 1))))))) (f 200000))", "200000")) {
+        FAIL("deep non-tail recursion"); return;
+    }
+
+    PASS();
+}
+
+static void test_control(void) {
+    TEST(control);
+
+    if (!runs_to("(+ 1 (call/cc (lambda (k) (+ 10 (k 5)))))", "6")) { FAIL("call/cc escape"); return; }
+    if (!runs_to("(letrec ((f (lambda (n) (if (= n 0) (call/cc (lambda (k) (k 7))) (+ 1 (f (- n 1))))))) (f 50))", "57")) {
+        FAIL("call/cc under VM frames"); return;
+    }
+    if (!runs_to("((lambda (x) (prompt (+ x 1))) 5)", "6")) { FAIL("prompt"); return; }
+    if (!runs_to("(prompt (+ 1 (control k 42)))", "42")) { FAIL("control"); return; }
+
+    PASS();
+}
+
+static void test_disassemble(void) {
+    TEST(disassemble);
+
+    char* listing = vm_disassemble(parse_str("(if (= 1 1) (+ 1 2) 0)"));
+    if (!listing) { FAIL("no listing"); return; }
+    if (!strstr(listing, "JUMP_NIL") || !strstr(listing, "TAIL_CALL")) {
+        printf("%s", listing);
+        free(listing);
+        FAIL("expected conditional jump and tail call");
+        return;
+    }
+    free(listing);
+
+    PASS();
+}
+
+int main(void) {
+    printf("Running Bytecode VM Unit Tests...\n");
+    init_syms();
+    Value* env = NIL;
+    env = env_extend(env, mk_sym("t"), SYM_T);
+    env = env_extend(env, mk_sym("+"), mk_prim2(prim_add, prim_add2));
+    env = env_extend(env, mk_sym("-"), mk_prim2(prim_sub, prim_sub2));
+    env = env_extend(env, mk_sym("*"), mk_prim2(prim_mul, prim_mul2));
+    env = env_extend(env, mk_sym("="), mk_prim2(prim_eq, prim_eq2));
+    root_menv = mk_menv(NIL, env);
+
+    test_accepts();
+    test_core_forms();
+    test_deep_recursion();
+    test_control();
+    test_disassemble();
+
+    if (tests_failed) {
+        fprintf(stderr, "%d tests failed\n", tests_failed);
+        return 1;
+    }
+    printf("%d tests passed\n", tests_passed);
+    return 0;
+}